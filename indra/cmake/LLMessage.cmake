@@ -6,6 +6,7 @@ include(XmlRpcEpi)
 
 set(LLMESSAGE_INCLUDE_DIRS
     ${LIBS_OPEN_DIR}/llmessage
+    ${CMAKE_BINARY_DIR}/llmessage
     ${CURL_INCLUDE_DIRS}
     ${OPENSSL_INCLUDE_DIRS}
     )
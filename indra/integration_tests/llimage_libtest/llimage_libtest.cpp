@@ -40,13 +40,18 @@
 #include "llimagebmp.h"
 #include "llimagetga.h"
 #include "llimagej2c.h"
+#include "llimageworker.h"
+#include "llcommon.h"
 #include "lldir.h"
 #include "lldiriterator.h"
 #include "v4coloru.h"
 #include "llsdserialize.h"
 #include "llcleanup.h"
+#include "llrand.h"
 
 // system libraries
+#include <atomic>
+#include <functional>
 #include <iostream>
 
 // doc string provided when invoking the program with --help 
@@ -99,6 +104,15 @@ static const char USAGE[] = "\n"
 "        Results in <metric>_report.csv\n"
 " -s, --image-stats\n"
 "        Output stats for each input and output image.\n"
+" -bench, --decode-benchmark <n>\n"
+"        Decode the input files on LLImageDecodeThread pools of 1, 2, 4... up to <n> threads\n"
+"        and report the decoded megapixels per second for each pool size.\n"
+"        The discard level (see -d) is honored. No output files are written in this mode.\n"
+" -pbench, --pixel-benchmark <n>\n"
+"        Run the LLImageRaw scaling and compositing routines <n> times on 256, 512, 1024\n"
+"        and 2048 pixels wide random images, once with the scalar code and once with the\n"
+"        SIMD kernels. Reports the time per call, the speedup and whether the results match.\n"
+"        No input file is needed for this mode.\n"
 "\n";
 
 // true when all image loading is done. Used by metric logging thread to know when to stop the thread.
@@ -315,6 +329,172 @@ void store_output_file(std::list<std::string> &output_filenames, std::list<std::
 	}
 }
 
+// Counts the decoded pixels of the requests of one benchmark run
+class BenchmarkResponder : public LLImageDecodeThread::Responder
+{
+public:
+	BenchmarkResponder(std::atomic<S64>& pixels, std::atomic<S32>& done) : mPixels(pixels), mDone(done) {}
+	void completed(bool success, LLImageRaw* raw, LLImageRaw* aux) override
+	{
+		if (success && raw)
+		{
+			mPixels += (S64)raw->getWidth() * raw->getHeight();
+		}
+		++mDone;
+	}
+private:
+	std::atomic<S64>& mPixels;
+	std::atomic<S32>& mDone;
+};
+
+// Decode every input file on pools of increasing size and print the throughput of each
+void decode_benchmark(const std::list<std::string> &input_filenames, int max_threads, int discard_level)
+{
+	// Enough requests to keep every worker of the largest pool busy for a while
+	const S32 requests_per_thread = 8;
+	S32 count = llmax((S32)input_filenames.size(), max_threads * requests_per_thread);
+
+	std::vector<int> pool_sizes;
+	for (int threads = 1; threads < max_threads; threads *= 2)
+	{
+		pool_sizes.push_back(threads);
+	}
+	pool_sizes.push_back(max_threads);
+
+	for (int threads : pool_sizes)
+	{
+		// Load the compressed data up front, each request needs its own image instance
+		std::vector<LLPointer<LLImageFormatted> > images;
+		std::list<std::string>::const_iterator in_file = input_filenames.begin();
+		for (S32 i = 0; i < count; ++i, ++in_file)
+		{
+			if (in_file == input_filenames.end())
+			{
+				in_file = input_filenames.begin();
+			}
+			LLPointer<LLImageFormatted> image = create_image(*in_file);
+			if (image.notNull() && image->load(*in_file))
+			{
+				images.push_back(image);
+			}
+		}
+		if (images.empty())
+		{
+			std::cout << "No input file could be loaded, nothing to benchmark" << std::endl;
+			return;
+		}
+
+		LLImageDecodeThread* pool = new LLImageDecodeThread(true, threads);
+		std::atomic<S64> pixels(0);
+		std::atomic<S32> done(0);
+		LLTimer timer;
+		for (LLPointer<LLImageFormatted>& image : images)
+		{
+			pool->decodeImage(image, LLQueuedThread::PRIORITY_NORMAL, discard_level, FALSE, new BenchmarkResponder(pixels, done));
+		}
+		while (done < (S32)images.size())
+		{
+			pool->update(0);
+			ms_sleep(1);
+		}
+		F64 seconds = timer.getElapsedTimeF64();
+		pool->shutdown();
+		delete pool;
+
+		std::cout << "Decode threads : " << threads << ", images : " << images.size()
+			<< ", time : " << seconds << " s, " << (seconds > 0.0 ? (F64)pixels / seconds / 1000000.0 : 0.0)
+			<< " MPix/s" << std::endl;
+	}
+}
+
+// One routine of the pixel benchmark: setup() builds a fresh destination image, run() is timed
+struct PixelBenchmark
+{
+	const char* mName;
+	std::function<LLPointer<LLImageRaw>()> mSetup;
+	std::function<void(LLImageRaw*)> mRun;
+};
+
+// Time a routine with the SIMD kernels on or off, returns the seconds per call and the last result
+F64 time_pixel_routine(const PixelBenchmark& routine, int iterations, bool use_simd, LLPointer<LLImageRaw>& result)
+{
+	LLImageRaw::setUseSIMD(use_simd);
+	F64 seconds = 0.0;
+	LLTimer timer;
+	for (int i = 0; i < iterations; ++i)
+	{
+		result = routine.mSetup();
+		timer.reset();
+		routine.mRun(result);
+		seconds += timer.getElapsedTimeF64();
+	}
+	return seconds / iterations;
+}
+
+LLPointer<LLImageRaw> create_random_image(S32 size, S8 components)
+{
+	LLPointer<LLImageRaw> image = new LLImageRaw(size, size, components);
+	U8* data = image->getData();
+	for (S32 i = 0; i < image->getDataSize(); ++i)
+	{
+		data[i] = (U8)ll_rand(256);
+	}
+	if (components == 4)
+	{
+		// Make sure the transparent and opaque shortcuts get their share
+		for (S32 i = 3; i < image->getDataSize(); i += 16)
+		{
+			data[i] = 0;
+			data[i + 4] = 255;
+		}
+	}
+	return image;
+}
+
+// Compare the scalar and SIMD versions of the LLImageRaw pixel routines
+void pixel_benchmark(int iterations)
+{
+	const S32 sizes[] = { 256, 512, 1024, 2048 };
+	bool all_match = true;
+
+	for (S32 size : sizes)
+	{
+		LLPointer<LLImageRaw> rgba = create_random_image(size, 4);
+		LLPointer<LLImageRaw> rgb = create_random_image(size, 3);
+		LLPointer<LLImageRaw> rgba_small = create_random_image(size / 2, 4);
+
+		PixelBenchmark routines[] = {
+			{ "scale down", [&]() { return new LLImageRaw(rgba->getData(), size, size, 4); },
+				[&](LLImageRaw* image) { image->scale(size / 2, size / 2); } },
+			{ "scale up", [&]() { return new LLImageRaw(rgba_small->getData(), size / 2, size / 2, 4); },
+				[&](LLImageRaw* image) { image->scale(size, size); } },
+			{ "composite", [&]() { return new LLImageRaw(rgb->getData(), size, size, 3); },
+				[&](LLImageRaw* image) { image->compositeUnscaled4onto3(rgba); } },
+			{ "composite scaled", [&]() { return new LLImageRaw(rgb->getData(), size, size, 3); },
+				[&](LLImageRaw* image) { image->compositeScaled4onto3(rgba_small); } },
+		};
+
+		for (const PixelBenchmark& routine : routines)
+		{
+			LLPointer<LLImageRaw> scalar_result;
+			LLPointer<LLImageRaw> simd_result;
+			F64 scalar_time = time_pixel_routine(routine, iterations, false, scalar_result);
+			F64 simd_time = time_pixel_routine(routine, iterations, true, simd_result);
+
+			bool match = (scalar_result->getDataSize() == simd_result->getDataSize())
+				&& !memcmp(scalar_result->getData(), simd_result->getData(), scalar_result->getDataSize());
+			all_match = all_match && match;
+
+			std::cout << routine.mName << " " << size << "x" << size
+				<< " : scalar " << scalar_time * 1000.0 << " ms, simd " << simd_time * 1000.0 << " ms, speedup "
+				<< (simd_time > 0.0 ? scalar_time / simd_time : 0.0) << (match ? "" : ", RESULTS DIFFER") << std::endl;
+		}
+	}
+
+	LLImageRaw::setUseSIMD(true);
+	std::cout << (all_match ? "All results match" : "Some results differ") << std::endl;
+}
+
 // Holds the metric gathering output in a thread safe way
 class LogThread : public LLThread
 {
@@ -359,9 +539,11 @@ int main(int argc, char** argv)
 	int levels = 0;
 	bool reversible = false;
     std::string filter_name = "";
+	int benchmark_threads = 0;
+	int pixel_benchmark_iterations = 0;
 
 	// Init whatever is necessary
-	ll_init_apr();
+	LLCommon::initClass();
 	LLImage::initClass();
 	LogThread* fast_timer_log_thread = NULL;	// For performance and metric gathering
 
@@ -559,8 +741,48 @@ int main(int argc, char** argv)
 		{
 			image_stats = true;
 		}
+		else if (!strcmp(argv[arg], "--decode-benchmark") || !strcmp(argv[arg], "-bench"))
+		{
+			std::string value_str;
+			if ((arg + 1) < argc)
+			{
+				value_str = argv[arg+1];
+			}
+			if (((arg + 1) >= argc) || (value_str[0] == '-'))
+			{
+				std::cout << "No valid --decode-benchmark argument given, benchmark skipped" << std::endl;
+			}
+			else
+			{
+				benchmark_threads = llmax(atoi(value_str.c_str()), 1);
+			}
+		}
+		else if (!strcmp(argv[arg], "--pixel-benchmark") || !strcmp(argv[arg], "-pbench"))
+		{
+			std::string value_str;
+			if ((arg + 1) < argc)
+			{
+				value_str = argv[arg+1];
+			}
+			if (((arg + 1) >= argc) || (value_str[0] == '-'))
+			{
+				std::cout << "No valid --pixel-benchmark argument given, benchmark skipped" << std::endl;
+			}
+			else
+			{
+				pixel_benchmark_iterations = llmax(atoi(value_str.c_str()), 1);
+			}
+		}
 	}
 		
+	if (pixel_benchmark_iterations)
+	{
+		pixel_benchmark(pixel_benchmark_iterations);
+		SUBSYSTEM_CLEANUP(LLImage);
+		SUBSYSTEM_CLEANUP(LLCommon);
+		return 0;
+	}
+
 	// Check arguments consistency. Exit with proper message if inconsistent.
 	if (input_filenames.size() == 0)
 	{
@@ -574,6 +796,14 @@ int main(int argc, char** argv)
 	}
 	
 
+	if (benchmark_threads)
+	{
+		decode_benchmark(input_filenames, benchmark_threads, discard_level);
+		SUBSYSTEM_CLEANUP(LLImage);
+		SUBSYSTEM_CLEANUP(LLCommon);
+		return 0;
+	}
+
 	// Create the logging thread if required
 	if (LLFastTimer::sMetricLog)
 	{
@@ -642,6 +872,7 @@ int main(int argc, char** argv)
 	{
 		fast_timer_log_thread->shutdown();
 	}
+	SUBSYSTEM_CLEANUP(LLCommon);
 	
 	return 0;
 }
@@ -0,0 +1,666 @@
+/**
+ * @file llmessage_libtest.cpp
+ * @brief Replays a packet capture through the llmessage library and
+ * reports where the time went
+ *
+ * $LicenseInfo:firstyear=2011&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2011, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#include "linden_common.h"
+
+// Linden library includes
+#include "indra_constants.h"
+#include "llbitpack.h"
+#include "llcleanup.h"
+#include "llcommon.h"
+#include "llfasttimer.h"
+#include "llfile.h"
+#include "llhost.h"
+#include "llmessagedecoders.h"
+#include "llmessagereplay.h"
+#include "llmessagetemplate.h"
+#include "llquantize.h"
+#include "llterseupdatebatch.h"
+#include "lltracerecording.h"
+#include "message.h"
+#include "message_prehash.h"
+#include "net.h"
+#include "patch_code.h"
+#include "patch_dct.h"
+#include "xform.h"
+
+// system libraries
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+
+// doc string provided when invoking the program with --help
+static const char USAGE[] = "\n"
+"usage:\tllmessage_libtest [options]\n"
+"\n"
+" -h, --help\n"
+"        Print this help\n"
+" -t, --template <file>\n"
+"        message_template.msg to decode with. Should be the one the capture was made with.\n"
+" -r, --replay <file>\n"
+"        Packet capture to replay, as written by the viewer's --capturepackets.\n"
+" -p, --passes <n>\n"
+"        Number of times to replay the capture. Default is 1.\n"
+" -b, --batch <n>\n"
+"        Packets queued between calls to processAcks(), standing in for a frame. Default is 64.\n"
+" -o, --output <file>\n"
+"        Also write the report to this file.\n"
+" -d, --decode-only\n"
+"        Only decode object, terrain and avatar updates, don't apply them.\n"
+"\n"
+" The viewer's own handlers need a logged in agent and a region, so object,\n"
+" terrain and avatar updates are applied here by stand-ins for them: objects\n"
+" are unpacked as LLViewerObject::processUpdateMessage() does, terse updates\n"
+" through the viewer's own LLTerseUpdateBatch, terrain patches are\n"
+" decompressed as LLSurface does and avatar animations are kept as LLVOAvatar\n"
+" keeps them, into tables of plain values rather than the scene.\n"
+" Each stand-in has its own LLTrace timer, and comparing a run with one made\n"
+" with --decode-only gives the cost of applying the updates.  Every other\n"
+" message is handled by reading each of its fields.\n";
+
+// One timer per stand-in, covering its decode and apply
+static LLTrace::BlockTimerStatHandle FTM_OBJECT_UPDATE("ObjectUpdate");
+static LLTrace::BlockTimerStatHandle FTM_TERSE_OBJECT_UPDATE("ImprovedTerseObjectUpdate");
+static LLTrace::BlockTimerStatHandle FTM_LAYER_DATA("LayerData");
+static LLTrace::BlockTimerStatHandle FTM_COARSE_LOCATION_UPDATE("CoarseLocationUpdate");
+static LLTrace::BlockTimerStatHandle FTM_AVATAR_ANIMATION("AvatarAnimation");
+static LLTrace::BlockTimerStatHandle FTM_READ_ALL_FIELDS("Other messages");
+
+static LLTrace::BlockTimerStatHandle* const HANDLER_TIMERS[] =
+{
+	&FTM_OBJECT_UPDATE,
+	&FTM_TERSE_OBJECT_UPDATE,
+	&FTM_LAYER_DATA,
+	&FTM_COARSE_LOCATION_UPDATE,
+	&FTM_AVATAR_ANIMATION,
+	&FTM_READ_ALL_FIELDS
+};
+
+// The layers LLVLManager::unpackData() decompresses
+static const char LAND_LAYER_CODE = 'L';
+static const char WIND_LAYER_CODE = '7';
+static const char AURORA_LAND_LAYER_CODE = 'M';
+static const char AURORA_WIND_LAYER_CODE = '9';
+
+// LLSurface's grid for a default sized region.  Patches of larger
+// regions are dropped, as LLSurface drops ones past its edge.
+static const S32 GRIDS_PER_EDGE = REGION_WIDTH_UNITS + 1;
+
+// What the stand-ins keep of an object
+struct ReplayObject
+{
+	ReplayObject() : mCRC(0), mParentID(0), mUpdateFlags(0), mPCode(0), mMaterial(0), mState(0) {}
+
+	LLUUID mFullID;
+	U32 mCRC;
+	U32 mParentID;
+	U32 mUpdateFlags;
+	U8 mPCode;
+	U8 mMaterial;
+	U8 mState;
+	LLVector3 mScale;
+	LLVector4 mFootPlane;
+	LLVector3 mPosition;
+	LLVector3 mVelocity;
+	LLVector3 mAcceleration;
+	LLQuaternion mRotation;
+	LLVector3 mAngularVelocity;
+	std::vector<U8> mTextureEntry;
+};
+
+// What the stand-ins keep of a region, by the host it's simulated on
+struct ReplayRegion
+{
+	std::map<U32, ReplayObject> mObjects;
+	std::vector<F32> mLand;
+	std::vector<F32> mWindX;
+	std::vector<F32> mWindY;
+	std::vector<U32> mMapAvatars;
+	std::vector<LLUUID> mMapAvatarIDs;
+};
+
+// What the stand-ins keep of an avatar
+struct ReplayAvatar
+{
+	std::map<LLUUID, S32> mSignaledAnimations;
+	std::multimap<LLUUID, LLUUID> mAnimationSources;
+};
+
+static bool sApplyUpdates = true;
+static std::map<LLHost, ReplayRegion> sRegions;
+static std::map<LLUUID, ReplayAvatar> sAvatars;
+static S32 sBadPatches = 0;
+static S32 sUndecodedTerseBlocks = 0;
+
+// Reads every variable of every block, as a handler that wanted all of
+// it would
+static void read_all_fields(LLMessageSystem* msg, const LLMessageTemplate* msg_template)
+{
+	U8 buffer[MAX_BUFFER_SIZE];
+	for (LLMessageTemplate::message_block_map_t::const_iterator block_iter = msg_template->mMemberBlocks.begin();
+		 block_iter != msg_template->mMemberBlocks.end(); ++block_iter)
+	{
+		const LLMessageBlock* block = *block_iter;
+		S32 count = msg->getNumberOfBlocksFast(block->mName);
+		for (S32 i = 0; i < count; ++i)
+		{
+			for (LLMessageBlock::message_variable_map_t::const_iterator var_iter = block->mMemberVariables.begin();
+				 var_iter != block->mMemberVariables.end(); ++var_iter)
+			{
+				msg->getBinaryDataFast(block->mName, (*var_iter)->getName(), buffer, 0, i, sizeof(buffer));
+			}
+		}
+	}
+}
+
+template<class DECODED>
+static void parse_decoded(LLMessageSystem* msg, void**)
+{
+	static DECODED decoded;
+	decoded.parse(msg);
+}
+
+// As LLViewerObject::processUpdateMessage() unpacks ObjectUpdate's
+// ObjectData for OUT_FULL
+static void unpack_object_data(const U8* data, S32 length, ReplayObject& object)
+{
+	const F32 size = REGION_WIDTH_METERS;
+	const F32 MAX_HEIGHT = SL_MAX_OBJECT_Z;
+	const F32 MIN_HEIGHT = -REGION_WIDTH_METERS;
+	U16 val[4];
+	S32 count = 0;
+
+	switch (length)
+	{
+	case (60 + 16):
+		// collision normal for avatars
+		htonmemcpy(object.mFootPlane.mV, &data[count], MVT_LLVector4, sizeof(LLVector4));
+		count += sizeof(LLVector4);
+		// fall through
+	case 60:
+		htonmemcpy(object.mPosition.mV, &data[count], MVT_LLVector3, sizeof(LLVector3));
+		count += sizeof(LLVector3);
+		htonmemcpy(object.mVelocity.mV, &data[count], MVT_LLVector3, sizeof(LLVector3));
+		count += sizeof(LLVector3);
+		htonmemcpy(object.mAcceleration.mV, &data[count], MVT_LLVector3, sizeof(LLVector3));
+		count += sizeof(LLVector3);
+		{
+			LLVector3 vec;
+			htonmemcpy(vec.mV, &data[count], MVT_LLVector3, sizeof(LLVector3));
+			object.mRotation.unpackFromVector3(vec);
+		}
+		count += sizeof(LLVector3);
+		htonmemcpy(object.mAngularVelocity.mV, &data[count], MVT_LLVector3, sizeof(LLVector3));
+		break;
+	case (32 + 16):
+		htonmemcpy(object.mFootPlane.mV, &data[count], MVT_LLVector4, sizeof(LLVector4));
+		count += sizeof(LLVector4);
+		// fall through
+	case 32:
+		htonmemcpy(val, &data[count], MVT_U16Vec3, 6);
+		count += sizeof(U16) * 3;
+		object.mPosition.set(U16_to_F32(val[VX], -0.5f * size, 1.5f * size),
+							 U16_to_F32(val[VY], -0.5f * size, 1.5f * size),
+							 U16_to_F32(val[VZ], MIN_HEIGHT, MAX_HEIGHT));
+		htonmemcpy(val, &data[count], MVT_U16Vec3, 6);
+		count += sizeof(U16) * 3;
+		object.mVelocity.set(U16_to_F32(val[VX], -size, size),
+							 U16_to_F32(val[VY], -size, size),
+							 U16_to_F32(val[VZ], -size, size));
+		htonmemcpy(val, &data[count], MVT_U16Vec3, 6);
+		count += sizeof(U16) * 3;
+		object.mAcceleration.set(U16_to_F32(val[VX], -size, size),
+								 U16_to_F32(val[VY], -size, size),
+								 U16_to_F32(val[VZ], -size, size));
+		htonmemcpy(val, &data[count], MVT_U16Quat, 8);
+		count += sizeof(U16) * 4;
+		object.mRotation.mQ[VX] = U16_to_F32(val[VX], -1.f, 1.f);
+		object.mRotation.mQ[VY] = U16_to_F32(val[VY], -1.f, 1.f);
+		object.mRotation.mQ[VZ] = U16_to_F32(val[VZ], -1.f, 1.f);
+		object.mRotation.mQ[VW] = U16_to_F32(val[VW], -1.f, 1.f);
+		htonmemcpy(val, &data[count], MVT_U16Vec3, 6);
+		object.mAngularVelocity.set(U16_to_F32(val[VX], -size, size),
+									U16_to_F32(val[VY], -size, size),
+									U16_to_F32(val[VZ], -size, size));
+		break;
+	case 16:
+		object.mPosition.set(U8_to_F32(data[0], -0.5f * size, 1.5f * size),
+							 U8_to_F32(data[1], -0.5f * size, 1.5f * size),
+							 U8_to_F32(data[2], MIN_HEIGHT, MAX_HEIGHT));
+		object.mVelocity.set(U8_to_F32(data[3], -size, size),
+							 U8_to_F32(data[4], -size, size),
+							 U8_to_F32(data[5], -size, size));
+		object.mAcceleration.set(U8_to_F32(data[6], -size, size),
+								 U8_to_F32(data[7], -size, size),
+								 U8_to_F32(data[8], -size, size));
+		object.mRotation.mQ[VX] = U8_to_F32(data[9], -1.f, 1.f);
+		object.mRotation.mQ[VY] = U8_to_F32(data[10], -1.f, 1.f);
+		object.mRotation.mQ[VZ] = U8_to_F32(data[11], -1.f, 1.f);
+		object.mRotation.mQ[VW] = U8_to_F32(data[12], -1.f, 1.f);
+		object.mAngularVelocity.set(U8_to_F32(data[13], -size, size),
+									U8_to_F32(data[14], -size, size),
+									U8_to_F32(data[15], -size, size));
+		break;
+	}
+}
+
+static void apply_object_update(LLMessageSystem* msg, void**)
+{
+	LL_RECORD_BLOCK_TIME(FTM_OBJECT_UPDATE);
+	static LLDecodedObjectUpdate decoded;
+	if (!decoded.parse(msg) || !sApplyUpdates)
+	{
+		return;
+	}
+
+	ReplayRegion& region = sRegions[msg->getSender()];
+	for (S32 i = 0; i < decoded.mNumObjectData; ++i)
+	{
+		const LLDecodedObjectUpdate::ObjectDataBlock& block = decoded.mObjectData[i];
+		ReplayObject& object = region.mObjects[block.mID];
+		object.mFullID = block.mFullID;
+		object.mCRC = block.mCRC;
+		object.mParentID = block.mParentID;
+		object.mUpdateFlags = block.mUpdateFlags;
+		object.mPCode = block.mPCode;
+		object.mMaterial = block.mMaterial;
+		object.mState = block.mState;
+		object.mScale = block.mScale;
+		unpack_object_data(block.mObjectData, block.mObjectDataSize, object);
+		object.mTextureEntry.assign(block.mTextureEntry, block.mTextureEntry + block.mTextureEntrySize);
+	}
+}
+
+// As LLViewerObjectList::processObjectUpdate() decodes the message with
+// LLTerseUpdateBatch and LLViewerObject::processUpdateMessage() takes
+// each block from it.  Objects the capture has no full update for are
+// made by their first terse one.
+static void apply_terse_object_update(LLMessageSystem* msg, void**)
+{
+	LL_RECORD_BLOCK_TIME(FTM_TERSE_OBJECT_UPDATE);
+	static LLDecodedImprovedTerseObjectUpdate decoded;
+	static LLTerseUpdateBatch batch;
+	if (!decoded.parse(msg) || !sApplyUpdates)
+	{
+		return;
+	}
+
+	batch.decode(decoded);
+	ReplayRegion& region = sRegions[msg->getSender()];
+	for (S32 i = 0; i < decoded.mNumObjectData; ++i)
+	{
+		if (!batch.isDecoded(i))
+		{
+			// Left to processUpdateMessage()'s own unpacking, which
+			// the server doesn't send in practice
+			++sUndecodedTerseBlocks;
+			continue;
+		}
+
+		ReplayObject& object = region.mObjects[batch.getLocalID(i)];
+		object.mState = batch.getState(i);
+		if (batch.hasFootPlane(i))
+		{
+			object.mFootPlane = batch.getFootPlane(i);
+		}
+		object.mPosition = batch.getPosition(i);
+		object.mVelocity = batch.getVelocity(i);
+		object.mAcceleration = batch.getAcceleration(i);
+		batch.getRotation(i, object.mRotation);
+		object.mAngularVelocity = batch.getAngularVelocity(i);
+
+		const LLDecodedImprovedTerseObjectUpdate::ObjectDataBlock& block = decoded.mObjectData[i];
+		if (block.mTextureEntrySize)
+		{
+			object.mTextureEntry.assign(block.mTextureEntry, block.mTextureEntry + block.mTextureEntrySize);
+		}
+	}
+}
+
+// As LLSurface::decompressDCTPatch() does
+static void decompress_land(LLBitPack& bit_pack, LLGroupHeader& group_header, bool large_patch, std::vector<F32>& land)
+{
+	land.resize(GRIDS_PER_EDGE * GRIDS_PER_EDGE);
+	const S32 patches_per_edge = REGION_WIDTH_UNITS / llmax((S32)group_header.patch_size, 1);
+	S32 patch[LARGE_PATCH_SIZE * LARGE_PATCH_SIZE];
+	LLPatchHeader patch_header;
+
+	init_patch_decompressor(group_header.patch_size);
+	group_header.stride = GRIDS_PER_EDGE;
+	set_group_of_patch_header(&group_header);
+
+	while (true)
+	{
+		decode_patch_header(bit_pack, &patch_header, large_patch);
+		if (patch_header.quant_wbits == END_OF_PATCHES)
+		{
+			break;
+		}
+
+		S32 i = large_patch ? patch_header.patchids >> 16 : patch_header.patchids >> 5;
+		S32 j = large_patch ? patch_header.patchids & 0xFFFF : patch_header.patchids & 0x1F;
+		if ((i >= patches_per_edge) || (j >= patches_per_edge))
+		{
+			++sBadPatches;
+			return;
+		}
+
+		decode_patch(bit_pack, patch);
+		decompress_patch(&land[(j * GRIDS_PER_EDGE + i) * group_header.patch_size], patch, &patch_header);
+	}
+}
+
+// As LLWind::decompress() does
+static void decompress_wind(LLBitPack& bit_pack, LLGroupHeader& group_header, ReplayRegion& region)
+{
+	S32 patch[LARGE_PATCH_SIZE * LARGE_PATCH_SIZE];
+	LLPatchHeader patch_header;
+
+	init_patch_decompressor(group_header.patch_size);
+	group_header.stride = group_header.patch_size;
+	set_group_of_patch_header(&group_header);
+
+	region.mWindX.resize(group_header.patch_size * group_header.patch_size);
+	region.mWindY.resize(group_header.patch_size * group_header.patch_size);
+
+	decode_patch_header(bit_pack, &patch_header);
+	decode_patch(bit_pack, patch);
+	decompress_patch(&region.mWindX[0], patch, &patch_header);
+
+	decode_patch_header(bit_pack, &patch_header);
+	decode_patch(bit_pack, patch);
+	decompress_patch(&region.mWindY[0], patch, &patch_header);
+}
+
+// What process_layer_data() queues and LLVLManager::unpackData()
+// decompresses in the same frame
+static void apply_layer_data(LLMessageSystem* msg, void**)
+{
+	LL_RECORD_BLOCK_TIME(FTM_LAYER_DATA);
+	static LLDecodedLayerData decoded;
+	if (!decoded.parse(msg) || !sApplyUpdates || !decoded.mLayerData.mDataSize)
+	{
+		return;
+	}
+
+	// The bit packer doesn't write, but doesn't take const either
+	std::vector<U8> data(decoded.mLayerData.mData, decoded.mLayerData.mData + decoded.mLayerData.mDataSize);
+	LLBitPack bit_pack(&data[0], (U32)data.size());
+	LLGroupHeader group_header;
+	decode_patch_group_header(bit_pack, &group_header);
+	if ((group_header.patch_size < 1) || (group_header.patch_size > LARGE_PATCH_SIZE))
+	{
+		++sBadPatches;
+		return;
+	}
+
+	ReplayRegion& region = sRegions[msg->getSender()];
+	char type = (char)decoded.mLayerID.mType;
+	if ((LAND_LAYER_CODE == type) || (AURORA_LAND_LAYER_CODE == type))
+	{
+		decompress_land(bit_pack, group_header, AURORA_LAND_LAYER_CODE == type, region.mLand);
+	}
+	else if ((WIND_LAYER_CODE == type) || (AURORA_WIND_LAYER_CODE == type))
+	{
+		decompress_wind(bit_pack, group_header, region);
+	}
+	// Water and cloud layers are ignored, as they are by the viewer
+}
+
+// As LLViewerRegion::updateCoarseLocations() does
+static void apply_coarse_location_update(LLMessageSystem* msg, void**)
+{
+	LL_RECORD_BLOCK_TIME(FTM_COARSE_LOCATION_UPDATE);
+	static LLDecodedCoarseLocationUpdate decoded;
+	if (!decoded.parse(msg) || !sApplyUpdates)
+	{
+		return;
+	}
+
+	ReplayRegion& region = sRegions[msg->getSender()];
+	region.mMapAvatars.clear();
+	region.mMapAvatarIDs.clear();
+	for (S32 i = 0; i < decoded.mNumLocation; ++i)
+	{
+		if (i == decoded.mIndex.mYou)
+		{
+			// The agent is kept track of elsewhere
+			continue;
+		}
+		const LLDecodedCoarseLocationUpdate::LocationBlock& location = decoded.mLocation[i];
+		U32 pos = location.mX;
+		pos <<= 8;
+		pos |= location.mY;
+		pos <<= 8;
+		pos |= location.mZ;
+		region.mMapAvatars.push_back(pos);
+		region.mMapAvatarIDs.push_back(i < decoded.mNumAgentData ? decoded.mAgentData[i].mAgentID : LLUUID::null);
+	}
+}
+
+// As process_avatar_animation() does.  Avatars the capture has no full
+// update for are made by their first animation update.
+static void apply_avatar_animation(LLMessageSystem* msg, void**)
+{
+	LL_RECORD_BLOCK_TIME(FTM_AVATAR_ANIMATION);
+	static LLDecodedAvatarAnimation decoded;
+	if (!decoded.parse(msg) || !sApplyUpdates)
+	{
+		return;
+	}
+
+	ReplayAvatar& avatar = sAvatars[decoded.mSender.mID];
+	avatar.mSignaledAnimations.clear();
+	for (S32 i = 0; i < decoded.mNumAnimationList; ++i)
+	{
+		const LLUUID& animation_id = decoded.mAnimationList[i].mAnimID;
+		avatar.mSignaledAnimations[animation_id] = decoded.mAnimationList[i].mAnimSequenceID;
+
+		if (i < decoded.mNumAnimationSourceList)
+		{
+			const LLUUID& object_id = decoded.mAnimationSourceList[i].mObjectID;
+			bool anim_found = false;
+			for (std::multimap<LLUUID, LLUUID>::iterator iter = avatar.mAnimationSources.find(object_id);
+				 iter != avatar.mAnimationSources.end() && iter->first == object_id; ++iter)
+			{
+				if (iter->second == animation_id)
+				{
+					anim_found = true;
+					break;
+				}
+			}
+			if (!anim_found)
+			{
+				avatar.mAnimationSources.insert(std::make_pair(object_id, animation_id));
+			}
+		}
+	}
+}
+
+static void dump_handler_timers(LLTrace::Recording& recording, std::ostream& out)
+{
+	out << std::endl
+		<< std::left << std::setw(40) << (sApplyUpdates ? "Decode and apply" : "Decode only")
+		<< std::right << std::setw(10) << "Calls"
+		<< std::setw(14) << "Total ms"
+		<< std::setw(14) << "Mean us" << std::endl;
+	for (LLTrace::BlockTimerStatHandle* timer : HANDLER_TIMERS)
+	{
+		S32 calls = recording.getSum(timer->callCount());
+		F64 total = recording.getSum(*timer).value();
+		out << std::left << std::setw(40) << timer->getName()
+			<< std::right << std::setw(10) << calls
+			<< std::fixed << std::setprecision(3)
+			<< std::setw(14) << total * 1000.0
+			<< std::setw(14) << (calls ? total * 1000000.0 / calls : 0.0) << std::endl;
+	}
+
+	size_t objects = 0;
+	for (std::map<LLHost, ReplayRegion>::const_iterator iter = sRegions.begin(); iter != sRegions.end(); ++iter)
+	{
+		objects += iter->second.mObjects.size();
+	}
+	out << std::endl << objects << " objects in " << sRegions.size() << " regions, "
+		<< sAvatars.size() << " animated avatars, " << sBadPatches << " bad terrain patches, "
+		<< sUndecodedTerseBlocks << " terse blocks in an unknown layout" << std::endl;
+}
+
+static void register_handlers(LLMessageSystem* msg)
+{
+	msg->setHandlerFuncFast(_PREHASH_AgentUpdate, parse_decoded<LLDecodedAgentUpdate>);
+	msg->setHandlerFuncFast(_PREHASH_AvatarAnimation, apply_avatar_animation);
+	msg->setHandlerFuncFast(_PREHASH_CoarseLocationUpdate, apply_coarse_location_update);
+	msg->setHandlerFuncFast(_PREHASH_ImprovedTerseObjectUpdate, apply_terse_object_update);
+	msg->setHandlerFuncFast(_PREHASH_LayerData, apply_layer_data);
+	msg->setHandlerFuncFast(_PREHASH_ObjectUpdate, apply_object_update);
+
+	// As LLStartUp::registerViewerCallbacks() does
+	msg->setDecodedByHandlerFast(_PREHASH_LayerData);
+	msg->setDecodedByHandlerFast(_PREHASH_CoarseLocationUpdate);
+
+	// Everything else, leaving the message system's own handlers alone
+	for (LLMessageSystem::message_template_name_map_t::const_iterator iter = msg->mMessageTemplates.begin();
+		 iter != msg->mMessageTemplates.end(); ++iter)
+	{
+		LLMessageTemplate* msg_template = iter->second;
+		if (!msg_template->hasHandlerFunc())
+		{
+			msg_template->addHandlerFunc([msg_template](LLMessageSystem* msgsystem)
+				{
+					LL_RECORD_BLOCK_TIME(FTM_READ_ALL_FIELDS);
+					read_all_fields(msgsystem, msg_template);
+				});
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string template_filename;
+	std::string replay_filename;
+	std::string output_filename;
+	S32 passes = 1;
+	S32 batch_size = 64;
+
+	// Analyze command line arguments
+	for (int arg = 1; arg < argc; ++arg)
+	{
+		if (!strcmp(argv[arg], "--help") || !strcmp(argv[arg], "-h"))
+		{
+			// Send the usage to standard out
+			std::cout << USAGE << std::endl;
+			return 0;
+		}
+		else if ((!strcmp(argv[arg], "--template") || !strcmp(argv[arg], "-t")) && arg < argc-1)
+		{
+			template_filename = argv[++arg];
+		}
+		else if ((!strcmp(argv[arg], "--replay") || !strcmp(argv[arg], "-r")) && arg < argc-1)
+		{
+			replay_filename = argv[++arg];
+		}
+		else if ((!strcmp(argv[arg], "--passes") || !strcmp(argv[arg], "-p")) && arg < argc-1)
+		{
+			passes = llmax(1, atoi(argv[++arg]));
+		}
+		else if ((!strcmp(argv[arg], "--batch") || !strcmp(argv[arg], "-b")) && arg < argc-1)
+		{
+			batch_size = llmax(1, atoi(argv[++arg]));
+		}
+		else if ((!strcmp(argv[arg], "--output") || !strcmp(argv[arg], "-o")) && arg < argc-1)
+		{
+			output_filename = argv[++arg];
+		}
+		else if (!strcmp(argv[arg], "--decode-only") || !strcmp(argv[arg], "-d"))
+		{
+			sApplyUpdates = false;
+		}
+		else
+		{
+			std::cout << "Unknown argument " << argv[arg] << std::endl << USAGE << std::endl;
+			return 1;
+		}
+	}
+
+	if (template_filename.empty() || replay_filename.empty())
+	{
+		std::cout << "A template and a capture to replay are required" << std::endl << USAGE << std::endl;
+		return 1;
+	}
+
+	// Init whatever is necessary
+	LLCommon::initClass();
+
+	int result = 0;
+	if (!start_messaging_system(template_filename, NET_USE_OS_ASSIGNED_PORT,
+								0, 0, 0, false, "", NULL, false, 5.f, 100.f))
+	{
+		std::cout << "Unable to start the message system with " << template_filename << std::endl;
+		result = 1;
+	}
+	else
+	{
+		register_handlers(gMessageSystem);
+
+		LLMessageReplay replay(gMessageSystem);
+		if (!replay.load(replay_filename))
+		{
+			std::cout << "Unable to load " << replay_filename << std::endl;
+			result = 1;
+		}
+		else
+		{
+			LLTrace::Recording recording;
+			recording.start();
+			replay.run(passes, batch_size);
+			recording.stop();
+			replay.dumpReport(std::cout);
+			dump_handler_timers(recording, std::cout);
+
+			if (!output_filename.empty())
+			{
+				llofstream out(output_filename.c_str());
+				if (out.is_open())
+				{
+					replay.dumpReport(out);
+					dump_handler_timers(recording, out);
+				}
+				else
+				{
+					std::cout << "Unable to write " << output_filename << std::endl;
+					result = 1;
+				}
+			}
+		}
+	}
+
+	// Cleanup and exit
+	end_messaging_system(false);
+	SUBSYSTEM_CLEANUP(LLCommon);
+
+	return result;
+}
@@ -266,6 +266,26 @@ int	LLFile::rename(const std::string& filename, const std::string& newname)
 	return warnif(STRINGIZE("rename to '" << newname << "' from"), filename, rc);
 }
 
+int	LLFile::replace(const std::string& filename, const std::string& newname)
+{
+#if	LL_WINDOWS
+	// _wrename() refuses to overwrite, MoveFileEx() doesn't set errno
+	std::string utf8filename = filename;
+	std::string utf8newname = newname;
+	llutf16string utf16filename = utf8str_to_utf16str(utf8filename);
+	llutf16string utf16newname = utf8str_to_utf16str(utf8newname);
+	int rc = 0;
+	if (!MoveFileExW(utf16filename.c_str(), utf16newname.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+	{
+		errno = (GetLastError() == ERROR_FILE_NOT_FOUND) ? ENOENT : EACCES;
+		rc = -1;
+	}
+#else
+	int rc = ::rename(filename.c_str(),newname.c_str());
+#endif
+	return warnif(STRINGIZE("replace '" << newname << "' with"), filename, rc);
+}
+
 bool LLFile::copy(const std::string from, const std::string to)
 {
 	bool copied = false;
@@ -73,6 +73,9 @@ public:
 	static	int		rmdir(const std::string& filename);
 	static	int		remove(const std::string& filename, int supress_error = 0);
 	static	int		rename(const std::string& filename,const std::string&	newname);
+	// Like rename(), but newname is atomically replaced if it exists, on
+	// Windows too.
+	static	int		replace(const std::string& filename,const std::string&	newname);
 	static  bool	copy(const std::string from, const std::string to);
 
 	static	int		stat(const std::string&	filename,llstat*	file_status);
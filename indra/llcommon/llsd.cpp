@@ -32,9 +32,12 @@
 #include "linden_common.h"
 #include "llsd.h"
 
+#include <new>
+
 #include "llerror.h"
 #include "llmath.h"
 #include "llformat.h"
+#include "llsdarena.h"
 #include "llsdserialize.h"
 #include "stringize.h"
 
@@ -90,10 +93,28 @@ protected:
 	bool shared() const							{ return (mUseCount > 1) && (mUseCount != STATIC_USAGE_COUNT); }
 	
 	U32 mUseCount;
+	bool mArenaAllocated;	// came from an LLSDArena rather than the heap
 
 public:
 	static void reset(Impl*& var, Impl* impl);
 		///< safely set var to refer to the new impl (possibly shared)
+
+	template<class T, typename... Args>
+	static T* create(Args&&... args)
+		///< allocate a new impl, from this thread's LLSDArena if one is active
+	{
+		LLSDArena* arena = LLSDArena::current();
+		if (!arena)
+		{
+			return new T(std::forward<Args>(args)...);
+		}
+		T* impl = new (arena->allocate(sizeof(T))) T(std::forward<Args>(args)...);
+		static_cast<Impl*>(impl)->mArenaAllocated = true;
+		return impl;
+	}
+
+	static void destroy(Impl* impl);
+		///< counterpart to create()
 		
 	static       Impl& safe(      Impl*);
 	static const Impl& safe(const Impl*);
@@ -367,11 +388,9 @@ namespace
 		
 		DataMap mData;
 		
-	protected:
-		ImplMap(const DataMap& data) : mData(data) { }
-		
 	public:
 		ImplMap() { }
+		ImplMap(const DataMap& data) : mData(data) { }
 
 		ImplMap& makeMap(LLSD::Impl*&) override;
 
@@ -405,7 +424,7 @@ namespace
 	{
 		if (shared())
 		{
-			ImplMap* i = new ImplMap(mData);
+			ImplMap* i = create<ImplMap>(mData);
 			Impl::assign(var, i);
 			return *i;
 		}
@@ -488,11 +507,9 @@ namespace
 		
 		DataVector mData;
 		
-	protected:
-		ImplArray(const DataVector& data) : mData(data) { }
-		
 	public:
 		ImplArray() { }
+		ImplArray(const DataVector& data) : mData(data) { }
 
 		ImplArray& makeArray(Impl*&) override;
 
@@ -526,7 +543,7 @@ namespace
 	{
 		if (shared())
 		{
-			ImplArray* i = new ImplArray(mData);
+			ImplArray* i = create<ImplArray>(mData);
 			Impl::assign(var, i);
 			return *i;
 		}
@@ -631,14 +648,16 @@ namespace
 }
 
 LLSD::Impl::Impl()
-	: mUseCount(0)
+	: mUseCount(0),
+	  mArenaAllocated(false)
 {
 	++sAllocationCount;
 	++sOutstandingCount;
 }
 
 LLSD::Impl::Impl(StaticAllocationMarker)
-	: mUseCount(0)
+	: mUseCount(0),
+	  mArenaAllocated(false)
 {
 }
 
@@ -655,11 +674,24 @@ void LLSD::Impl::reset(Impl*& var, Impl* impl)
 	}
 	if (var  &&  var->mUseCount != STATIC_USAGE_COUNT && --var->mUseCount == 0)
 	{
-		delete var;
+		destroy(var);
 	}
 	var = impl;
 }
 
+void LLSD::Impl::destroy(Impl* impl)
+{
+	if (impl->mArenaAllocated)
+	{
+		impl->~Impl();
+		LLSDArena::release(impl);
+	}
+	else
+	{
+		delete impl;
+	}
+}
+
 LLSD::Impl& LLSD::Impl::safe(Impl* impl)
 {
 	static Impl theUndefined(STATIC_USAGE_COUNT);
@@ -674,14 +706,14 @@ const LLSD::Impl& LLSD::Impl::safe(const Impl* impl)
 
 ImplMap& LLSD::Impl::makeMap(Impl*& var)
 {
-	ImplMap* im = new ImplMap;
+	ImplMap* im = create<ImplMap>();
 	reset(var, im);
 	return *im;
 }
 
 ImplArray& LLSD::Impl::makeArray(Impl*& var)
 {
-	ImplArray* ia = new ImplArray;
+	ImplArray* ia = create<ImplArray>();
 	reset(var, ia);
 	return *ia;
 }
@@ -699,42 +731,42 @@ void LLSD::Impl::assignUndefined(Impl*& var)
 
 void LLSD::Impl::assign(Impl*& var, LLSD::Boolean v)
 {
-	reset(var, new ImplBoolean(v));
+	reset(var, create<ImplBoolean>(v));
 }
 
 void LLSD::Impl::assign(Impl*& var, LLSD::Integer v)
 {
-	reset(var, new ImplInteger(v));
+	reset(var, create<ImplInteger>(v));
 }
 
 void LLSD::Impl::assign(Impl*& var, LLSD::Real v)
 {
-	reset(var, new ImplReal(v));
+	reset(var, create<ImplReal>(v));
 }
 
 void LLSD::Impl::assign(Impl*& var, const LLSD::String& v)
 {
-	reset(var, new ImplString(v));
+	reset(var, create<ImplString>(v));
 }
 
 void LLSD::Impl::assign(Impl*& var, const LLSD::UUID& v)
 {
-	reset(var, new ImplUUID(v));
+	reset(var, create<ImplUUID>(v));
 }
 
 void LLSD::Impl::assign(Impl*& var, const LLSD::Date& v)
 {
-	reset(var, new ImplDate(v));
+	reset(var, create<ImplDate>(v));
 }
 
 void LLSD::Impl::assign(Impl*& var, const LLSD::URI& v)
 {
-	reset(var, new ImplURI(v));
+	reset(var, create<ImplURI>(v));
 }
 
 void LLSD::Impl::assign(Impl*& var, const LLSD::Binary& v)
 {
-	reset(var, new ImplBinary(v));
+	reset(var, create<ImplBinary>(v));
 }
 
 
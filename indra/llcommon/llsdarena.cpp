@@ -0,0 +1,163 @@
+/**
+ * @file llsdarena.cpp
+ * @brief Slab allocator for LLSD value nodes built in bulk.
+ *
+ * $LicenseInfo:firstyear=2006&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "llsdarena.h"
+
+#include "llthreadlocalstorage.h"
+
+#include <new>
+
+#if LL_WINDOWS
+#include "llwin32headerslean.h"
+#else
+#include <stdlib.h>
+#endif
+
+// Slabs are aligned to their own size, so the slab that owns a node can
+// be found by masking the node's address.
+struct LLSDArena::Slab
+{
+	// One reference while the arena is still allocating from the slab,
+	// plus one per live node.
+	LLAtomicS32 mRefs;
+};
+
+namespace
+{
+	const size_t NODE_ALIGN = 16;
+
+	typedef LLThreadLocalSingletonPointer<LLSDArena> current_arena_t;
+
+	// VirtualAlloc() hands out memory on 64KB boundaries anyway, and
+	// posix_memalign() gives back the slack it needs for the alignment, so
+	// neither wastes a second slab's worth of memory the way an over-sized
+	// malloc would.
+	void* allocate_slab()
+	{
+#if LL_WINDOWS
+		return VirtualAlloc(NULL, LLSDArena::SLAB_SIZE, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+		void* slab = NULL;
+		return posix_memalign(&slab, LLSDArena::SLAB_SIZE, LLSDArena::SLAB_SIZE) ? NULL : slab;
+#endif
+	}
+
+	void free_slab(void* slab)
+	{
+#if LL_WINDOWS
+		VirtualFree(slab, 0, MEM_RELEASE);
+#else
+		free(slab);
+#endif
+	}
+}
+
+/**
+ * LLSDArena::Scope
+ */
+LLSDArena::Scope::Scope()
+	: mArena(new LLSDArena),
+	  mPrevious(current_arena_t::getInstance())
+{
+	current_arena_t::setInstance(mArena);
+}
+
+LLSDArena::Scope::~Scope()
+{
+	current_arena_t::setInstance(mPrevious);
+	delete mArena;
+}
+
+/**
+ * LLSDArena
+ */
+LLSDArena::LLSDArena()
+	: mSlab(NULL),
+	  mNext(NULL),
+	  mEnd(NULL)
+{
+}
+
+LLSDArena::~LLSDArena()
+{
+	if (mSlab)
+	{
+		unref(mSlab);
+	}
+}
+
+//static
+LLSDArena* LLSDArena::current()
+{
+	return current_arena_t::getInstance();
+}
+
+void* LLSDArena::allocate(size_t size)
+{
+	llassert(size <= MAX_NODE_SIZE);
+	size = (size + NODE_ALIGN - 1) & ~(NODE_ALIGN - 1);
+	if ((size_t) (mEnd - mNext) < size)
+	{
+		const size_t header_size = (sizeof(Slab) + NODE_ALIGN - 1) & ~(NODE_ALIGN - 1);
+
+		void* memory = allocate_slab();
+		if (!memory)
+		{
+			LL_ERRS() << "Failed to allocate LLSD arena slab" << LL_ENDL;
+		}
+		if (mSlab)
+		{
+			// Nothing more comes from the old slab, so its nodes alone
+			// keep it alive now
+			unref(mSlab);
+		}
+		mSlab = new (memory) Slab;
+		mSlab->mRefs = 1;
+		mNext = (U8*) mSlab + header_size;
+		mEnd = (U8*) mSlab + SLAB_SIZE;
+	}
+	void* node = mNext;
+	mNext += size;
+	mSlab->mRefs.fetch_add(1, boost::memory_order_relaxed);
+	return node;
+}
+
+//static
+void LLSDArena::release(void* node)
+{
+	unref((Slab*) ((uintptr_t) node & ~(uintptr_t) (SLAB_SIZE - 1)));
+}
+
+//static
+void LLSDArena::unref(Slab* slab)
+{
+	if (slab->mRefs.fetch_sub(1, boost::memory_order_acq_rel) == 1)
+	{
+		slab->~Slab();
+		free_slab(slab);
+	}
+}
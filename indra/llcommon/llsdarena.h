@@ -0,0 +1,113 @@
+/**
+ * @file llsdarena.h
+ * @brief Slab allocator for LLSD value nodes built in bulk.
+ *
+ * $LicenseInfo:firstyear=2006&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLSDARENA_H
+#define LL_LLSDARENA_H
+
+#include "llatomic.h"
+
+/**
+ * @class LLSDArena
+ * @brief Bump allocator for the value nodes of LLSD trees built in bulk.
+ *
+ * While an LLSDArena::Scope is alive on a thread, every LLSD value node
+ * created on that thread is carved out of large slabs instead of being
+ * allocated from the heap one at a time. Nodes may be destroyed on any
+ * thread. Each slab goes back to the heap once the arena has moved on
+ * from it and the last node allocated from it has been destroyed.
+ *
+ * Freed nodes are not reused, and one node that outlives the rest keeps
+ * its whole slab alive. Use a scope for trees that are built,
+ * read and dropped together, such as large HTTP response bodies, and not
+ * for long lived, frequently edited data:
+ * <code>
+ *   LLSD body;
+ *   {
+ *       LLSDArena::Scope arena;
+ *       LLSDSerialize::fromXML(body, istr);
+ *   }
+ * </code>
+ */
+class LL_COMMON_API LLSDArena
+{
+public:
+	/**
+	 * @brief Routes LLSD node allocations on this thread to a new arena
+	 * for the lifetime of the scope. Scopes nest.
+	 */
+	class LL_COMMON_API Scope
+	{
+	public:
+		Scope();
+		~Scope();
+
+	private:
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+		LLSDArena* mArena;
+		LLSDArena* mPrevious;
+	};
+
+	/**
+	 * @brief The arena new LLSD nodes on this thread come from, or NULL.
+	 */
+	static LLSDArena* current();
+
+	/**
+	 * @brief Allocate memory for one node. The size must not exceed
+	 * MAX_NODE_SIZE.
+	 */
+	void* allocate(size_t size);
+
+	/**
+	 * @brief Give back a node returned by allocate(), from any thread.
+	 * The node's destructor must already have run.
+	 */
+	static void release(void* node);
+
+	enum
+	{
+		SLAB_SIZE = 64 * 1024,
+		MAX_NODE_SIZE = 1024
+	};
+
+private:
+	LLSDArena();
+	~LLSDArena();
+	LLSDArena(const LLSDArena&) = delete;
+	LLSDArena& operator=(const LLSDArena&) = delete;
+
+	struct Slab;
+
+	static void unref(Slab* slab);
+
+	Slab* mSlab;	// the slab being carved up
+	U8* mNext;
+	U8* mEnd;
+};
+
+#endif // LL_LLSDARENA_H
@@ -2139,95 +2139,107 @@ std::string zip_llsd(LLSD& data)
 //decompress a block of LLSD from provided istream
 // not very efficient -- creats a copy of decompressed LLSD block in memory
 // and deserializes from that copy using LLSDSerialize
-bool unzip_llsd(LLSD& data, std::istream& is, S32 size)
+bool unzip_llsd_binary(std::vector<U8>& out, std::istream& is, S32 size)
 {
-	U8* result = NULL;
-	U32 cur_size = 0;
+	out.clear();
+	if (size <= 0)
+	{
+		return false;
+	}
+
+	std::vector<U8> in(size);
+	is.read((char*) &in[0], size); 
+
+	return unzip_llsd_binary(out, &in[0], size);
+}
+
+bool unzip_llsd_binary(std::vector<U8>& out, const U8* in, S32 size)
+{
+	out.clear();
+	if (!in || size <= 0)
+	{
+		return false;
+	}
+
 	z_stream strm;
 		
 	const U32 CHUNK = 65536;
 
-	U8 *in = new U8[size];
-	is.read((char*) in, size); 
-
-	U8 out[CHUNK];
-		
 	strm.zalloc = Z_NULL;
 	strm.zfree = Z_NULL;
 	strm.opaque = Z_NULL;
 	strm.avail_in = size;
-	strm.next_in = in;
+	// zlib doesn't write to its input
+	strm.next_in = const_cast<U8*>(in);
 
 	S32 ret = inflateInit(&strm);
-	
+	if (ret != Z_OK)
+	{
+		return false;
+	}
+
+	// Inflate straight into the output; the vector grows geometrically
+	// rather than being reallocated for every chunk.
+	U32 cur_size = 0;
 	do
 	{
+		out.resize(cur_size + CHUNK);
 		strm.avail_out = CHUNK;
-		strm.next_out = out;
+		strm.next_out = &out[cur_size];
 		ret = inflate(&strm, Z_NO_FLUSH);
 		
 		switch (ret)
 		{
 		case Z_NEED_DICT:
-			ret = Z_DATA_ERROR;
 		case Z_DATA_ERROR:
 		case Z_MEM_ERROR:
 		case Z_STREAM_ERROR:
 			inflateEnd(&strm);
-			free(result);
-			delete [] in;
+			out.clear();
 			return false;
-			break;
 		}
 
-		U32 have = CHUNK-strm.avail_out;
-
-		U8* tmp = (U8*) realloc(result, cur_size + have);
-		if (!tmp)
-		{
-			inflateEnd(&strm);
-			free(result);
-			delete [] in;
-			return false;
-		}
-		result = tmp;
-		memcpy(result+cur_size, out, have);
-		cur_size += have;
+		cur_size += CHUNK - strm.avail_out;
 
 	} while (ret == Z_OK);
 
 	inflateEnd(&strm);
-	delete [] in;
+	out.resize(cur_size);
 
 	if (ret != Z_STREAM_END)
 	{
-		free(result);
+		out.clear();
 		return false;
 	}
 
-	//result now points to the decompressed LLSD block
+	//out now holds the decompressed LLSD block
+	static const std::string deprecated_header("<? LLSD/Binary ?>");
+	if (cur_size > deprecated_header.size()
+		&& !memcmp(&out[0], deprecated_header.data(), deprecated_header.size()))
 	{
-		std::string res_str((char*) result, cur_size);
+		out.erase(out.begin(), out.begin() + deprecated_header.size() + 1);
+	}
 
-		std::string deprecated_header("<? LLSD/Binary ?>");
+	return true;
+}
 
-		if (res_str.substr(0, deprecated_header.size()) == deprecated_header)
-		{
-			res_str = res_str.substr(deprecated_header.size()+1, cur_size);
-		}
-		cur_size = res_str.size();
+bool unzip_llsd(LLSD& data, std::istream& is, S32 size)
+{
+	std::vector<U8> block;
+	if (!unzip_llsd_binary(block, is, size))
+	{
+		return false;
+	}
 
-		std::istringstream istr(res_str);
-		
-		if (!LLSDSerialize::fromBinary(data, istr, cur_size))
-		{
-			LL_WARNS() << "Failed to unzip LLSD block" << LL_ENDL;
-			free(result);
-			return false;
-		}		
+	std::string res_str(block.begin(), block.end());
+	std::istringstream istr(res_str);
+
+	if (!LLSDSerialize::fromBinary(data, istr, (S32) res_str.size()))
+	{
+		LL_WARNS() << "Failed to unzip LLSD block" << LL_ENDL;
+		return false;
 	}
 
-	free(result);
 	return true;
 }
 
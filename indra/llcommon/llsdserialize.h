@@ -302,6 +302,30 @@ public:
 	 */
 	LLSDXMLParser(bool emit_errors=true);
 
+	/**
+	 * @brief Feed one piece of a document that arrives incrementally.
+	 *
+	 * On a new parser, or after reset(), call this method with each
+	 * piece in order, then finishParse(). Pieces are handed to expat exactly as they
+	 * are, so there is no need to gather a response into one string or
+	 * wrap it in a stream first. Pieces may split tokens anywhere.
+	 * @param buf The next bytes of the document.
+	 * @param len The number of bytes at buf.
+	 * @return Returns false once the closing llsd element has been seen
+	 * or the document turned out to be malformed. Later pieces are
+	 * ignored, so the caller can stop feeding.
+	 */
+	bool parseChunk(const char* buf, S32 len);
+
+	/**
+	 * @brief Complete an incremental parse started with parseChunk().
+	 *
+	 * @param data[out] The newly parsed structured data.
+	 * @return Returns the number of LLSD objects parsed into data.
+	 * Returns PARSE_FAILURE (-1) on parse failure.
+	 */
+	S32 finishParse(LLSD& data);
+
 protected:
 	/** 
 	 * @brief Call this method to parse a stream for LLSD.
@@ -817,5 +841,11 @@ public:
 //dirty little zip functions -- yell at davep
 LL_COMMON_API std::string zip_llsd(LLSD& data);
 LL_COMMON_API bool unzip_llsd(LLSD& data, std::istream& is, S32 size);
+// Inflates a zlib compressed binary LLSD block into out without parsing it,
+// dropping the deprecated "<? LLSD/Binary ?>" header if present. Pair with
+// LLSDView to read the result in place.
+LL_COMMON_API bool unzip_llsd_binary(std::vector<U8>& out, std::istream& is, S32 size);
+// As above, straight from a buffer that already holds the block.
+LL_COMMON_API bool unzip_llsd_binary(std::vector<U8>& out, const U8* in, S32 size);
 LL_COMMON_API U8* unzip_llsdNavMesh( bool& valid, unsigned int& outsize,std::istream& is, S32 size);
 #endif // LL_LLSDSERIALIZE_H
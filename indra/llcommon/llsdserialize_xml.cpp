@@ -32,6 +32,7 @@
 
 #include <iostream>
 #include <deque>
+#include <sstream>
 
 #include <boost/type_traits.hpp>
 #include <boost/regex.hpp>
@@ -251,6 +252,9 @@ public:
 	S32 parseLines(std::istream& input, LLSD& data);
 
 	void parsePart(const char *buf, int len);
+
+	bool parseChunk(const char* buf, int len);
+	S32 finishParse(LLSD& data);
 	
 	void reset();
 
@@ -297,6 +301,7 @@ private:
 	
 	bool mInLLSDElement;			// true if we're on LLSD
 	bool mGracefullStop;			// true if we found the </llsd
+	bool mChunkError;				// true if parseChunk() hit malformed XML
 	
 	typedef std::deque<LLSD*> LLSDRefStack;
 	LLSDRefStack mStack;
@@ -499,6 +504,7 @@ void LLSDXMLParser::Impl::reset()
 	mDepth = 0;
 
 	mGracefullStop = false;
+	mChunkError = false;
 
 	mStack.clear();
 	
@@ -546,6 +552,60 @@ void LLSDXMLParser::Impl::parsePart(const char* buf, int len)
 	}
 }
 
+bool LLSDXMLParser::Impl::parseChunk(const char* buf, int len)
+{
+	if (mGracefullStop || mChunkError)
+	{
+		return false;
+	}
+	if (!buf || len <= 0)
+	{
+		return true;
+	}
+
+	// expat parses straight out of buf, only buffering a token that is
+	// split across two chunks.
+	if (XML_Parse(mParser, buf, len, false) == XML_STATUS_ERROR)
+	{
+		// Stopping the parser at </llsd> is also reported as an error.
+		if (!mGracefullStop)
+		{
+			mChunkError = true;
+			if (mEmitErrors)
+			{
+				LL_INFOS() << "LLSDXMLParser::Impl::parseChunk: XML_STATUS_ERROR "
+						   << XML_ErrorString(XML_GetErrorCode(mParser)) << LL_ENDL;
+			}
+		}
+		return false;
+	}
+	return true;
+}
+
+S32 LLSDXMLParser::Impl::finishParse(LLSD& data)
+{
+	if (!mGracefullStop && !mChunkError
+		&& XML_Parse(mParser, nullptr, 0, true) == XML_STATUS_ERROR
+		&& !mGracefullStop)
+	{
+		mChunkError = true;
+		if (mEmitErrors)
+		{
+			LL_INFOS() << "LLSDXMLParser::Impl::finishParse: XML_STATUS_ERROR "
+					   << XML_ErrorString(XML_GetErrorCode(mParser)) << LL_ENDL;
+		}
+	}
+
+	if (mChunkError)
+	{
+		data = LLSD();
+		return LLSDParser::PARSE_FAILURE;
+	}
+
+	data = mResult;
+	return mParseCount;
+}
+
 // Performance testing code
 //#define	XML_PARSER_PERFORMANCE_TESTS
 
@@ -575,6 +635,17 @@ public:
 };
 #endif // XML_PARSER_PERFORMANCE_TESTS
 
+// Same conversion as LLSD(str).asReal(), without building a temporary
+// LLSD string node for every <real> element.
+static F64 string_to_real(const std::string& str)
+{
+	F64 v = 0.0;
+	std::istringstream i_stream(str);
+	i_stream >> v;
+	int c = i_stream.get();
+	return ((EOF == c) ? v : 0.0);
+}
+
 void LLSDXMLParser::Impl::startElementHandler(const XML_Char* name, const XML_Char** attributes)
 {
 	#ifdef XML_PARSER_PERFORMANCE_TESTS
@@ -733,7 +804,7 @@ void LLSDXMLParser::Impl::endElementHandler(const XML_Char* name)
 		
 		case ELEMENT_REAL:
 			{
-				value = LLSD(mCurrentContent).asReal();
+				value = string_to_real(mCurrentContent);
 				// removed since this breaks when locale has decimal separator that isn't '.'
 				// investigated changing local to something compatible each time but deemed higher
 				// risk that just using LLSD.asReal() each time.
@@ -754,15 +825,15 @@ void LLSDXMLParser::Impl::endElementHandler(const XML_Char* name)
 			break;
 		
 		case ELEMENT_UUID:
-			value = LLSD(mCurrentContent).asUUID();
+			value = LLUUID(mCurrentContent);
 			break;
 		
 		case ELEMENT_DATE:
-			value = LLSD(mCurrentContent).asDate();
+			value = LLDate(mCurrentContent);
 			break;
 		
 		case ELEMENT_URI:
-			value = LLSD(mCurrentContent).asURI();
+			value = LLURI(mCurrentContent);
 			break;
 		
 		case ELEMENT_BINARY:
@@ -911,6 +982,16 @@ void LLSDXMLParser::parsePart(const char *buf, int len)
 	impl.parsePart(buf, len);
 }
 
+bool LLSDXMLParser::parseChunk(const char* buf, S32 len)
+{
+	return impl.parseChunk(buf, len);
+}
+
+S32 LLSDXMLParser::finishParse(LLSD& data)
+{
+	return impl.finishParse(data);
+}
+
 // virtual
 S32 LLSDXMLParser::doParse(std::istream& input, LLSD& data) const
 {
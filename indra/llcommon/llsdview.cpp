@@ -0,0 +1,665 @@
+/**
+ * @file llsdview.cpp
+ * @brief Read-only, zero-copy view over a binary serialized LLSD buffer.
+ *
+ * $LicenseInfo:firstyear=2006&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "llsdview.h"
+
+#include "llmath.h"
+#include "llstring.h"
+
+/**
+ * Local functions.
+ *
+ * The wire format is the one written by LLSDBinaryFormatter; see
+ * LLSDBinaryParser::doParse() for the reference reader. Sizes and counts
+ * are 4 byte network order integers, and values are not aligned, so
+ * everything is assembled a byte at a time.
+ */
+namespace
+{
+	// Containers nested deeper than this are treated as malformed, so a
+	// hostile buffer cannot run the recursive walkers out of stack.
+	const S32 MAX_VIEW_DEPTH = 256;
+
+	inline U32 read_u32(const U8* p)
+	{
+		return ((U32)p[0] << 24) | ((U32)p[1] << 16) | ((U32)p[2] << 8) | (U32)p[3];
+	}
+
+	inline F64 read_f64(const U8* p)
+	{
+		F64 value;
+		memcpy(&value, p, sizeof(F64));
+		return value;
+	}
+
+	inline F64 read_nbo_f64(const U8* p)
+	{
+		U64 bits = ((U64)read_u32(p) << 32) | (U64)read_u32(p + 4);
+		F64 value;
+		memcpy(&value, &bits, sizeof(F64));
+		return value;
+	}
+
+	// Element count of the map or array at p. Negative counts parse as
+	// empty containers in LLSDBinaryParser.
+	inline U32 read_count(const U8* p)
+	{
+		S32 count = (S32)read_u32(p + 1);
+		return count > 0 ? (U32)count : 0;
+	}
+
+	// Returns one past the closing delimiter of the quoted string that
+	// opens at p, following the escape rules of deserialize_string_delim(),
+	// or NULL if end comes first. A NULL end means the string has already
+	// been validated.
+	const U8* skip_delim(const U8* p, const U8* end)
+	{
+		const U8 delim = *p++;
+		while (!end || p < end)
+		{
+			U8 c = *p++;
+			if (c == '\\')
+			{
+				// "\xNN" swallows two hex digits, anything else one character.
+				ptrdiff_t skip = (end && p == end) ? 1 : ((*p == 'x') ? 3 : 1);
+				if (end && (end - p) < skip)
+				{
+					return NULL;
+				}
+				p += skip;
+			}
+			else if (c == delim)
+			{
+				return p;
+			}
+		}
+		return NULL;
+	}
+
+	// Decodes a quoted string, without its delimiters, into value.
+	void unescape_delim(const U8* begin, const U8* end, std::string& value)
+	{
+		value.clear();
+		value.reserve(end - begin);
+		while (begin < end)
+		{
+			char c = (char)*begin++;
+			if (c != '\\' || begin == end)
+			{
+				value += c;
+				continue;
+			}
+			c = (char)*begin++;
+			switch (c)
+			{
+			case 'a': value += '\a'; break;
+			case 'b': value += '\b'; break;
+			case 'f': value += '\f'; break;
+			case 'n': value += '\n'; break;
+			case 'r': value += '\r'; break;
+			case 't': value += '\t'; break;
+			case 'v': value += '\v'; break;
+			case 'x':
+				if (end - begin >= 2)
+				{
+					value += (char)((hex_as_nybble((char)begin[0]) << 4) | hex_as_nybble((char)begin[1]));
+					begin += 2;
+				}
+				break;
+			default: value += c; break;
+			}
+		}
+	}
+
+	// Returns one past the end of the value starting at p, or NULL if it is
+	// malformed or does not fit before end.
+	const U8* validate_value(const U8* p, const U8* end, S32 depth)
+	{
+		if (p >= end)
+		{
+			return NULL;
+		}
+		const ptrdiff_t avail = end - p;
+		switch (*p)
+		{
+		case '!':
+		case '0':
+		case '1':
+			return p + 1;
+
+		case 'i':
+			return avail >= 5 ? p + 5 : NULL;
+
+		case 'r':
+		case 'd':
+			return avail >= 9 ? p + 9 : NULL;
+
+		case 'u':
+			return avail >= 1 + UUID_BYTES ? p + 1 + UUID_BYTES : NULL;
+
+		case 's':
+		case 'l':
+		case 'b':
+		{
+			if (avail < 5)
+			{
+				return NULL;
+			}
+			S32 size = (S32)read_u32(p + 1);
+			if (size < 0)
+			{
+				// LLSDBinaryParser rejects negative string sizes but reads a
+				// negative binary size as an empty blob.
+				return (*p == 'b') ? p + 5 : NULL;
+			}
+			return (avail - 5 >= (ptrdiff_t)size) ? p + 5 + size : NULL;
+		}
+
+		case '\'':
+		case '"':
+			return skip_delim(p, end);
+
+		case '[':
+		{
+			if (avail < 5 || depth >= MAX_VIEW_DEPTH)
+			{
+				return NULL;
+			}
+			U32 count = read_count(p);
+			p += 5;
+			for (U32 i = 0; i < count && p; ++i)
+			{
+				p = validate_value(p, end, depth + 1);
+			}
+			return (p && p < end && *p == ']') ? p + 1 : NULL;
+		}
+
+		case '{':
+		{
+			if (avail < 5 || depth >= MAX_VIEW_DEPTH)
+			{
+				return NULL;
+			}
+			U32 count = read_count(p);
+			p += 5;
+			for (U32 i = 0; i < count && p; ++i)
+			{
+				if (p >= end)
+				{
+					return NULL;
+				}
+				switch (*p)
+				{
+				case 'k':
+					if (end - p < 5 || (S32)read_u32(p + 1) < 0
+						|| (end - p - 5) < (ptrdiff_t)read_u32(p + 1))
+					{
+						return NULL;
+					}
+					p += 5 + read_u32(p + 1);
+					break;
+				case '\'':
+				case '"':
+					p = skip_delim(p, end);
+					break;
+				default:
+					return NULL;
+				}
+				if (p)
+				{
+					p = validate_value(p, end, depth + 1);
+				}
+			}
+			return (p && p < end && *p == '}') ? p + 1 : NULL;
+		}
+
+		default:
+			return NULL;
+		}
+	}
+
+	// Returns one past the end of an already validated value or map key.
+	const U8* skip_value(const U8* p)
+	{
+		switch (*p)
+		{
+		case 'i':
+			return p + 5;
+
+		case 'r':
+		case 'd':
+			return p + 9;
+
+		case 'u':
+			return p + 1 + UUID_BYTES;
+
+		case 's':
+		case 'l':
+		case 'k':
+			return p + 5 + read_u32(p + 1);
+
+		case 'b':
+		{
+			S32 size = (S32)read_u32(p + 1);
+			return p + 5 + llmax(size, 0);
+		}
+
+		case '\'':
+		case '"':
+			return skip_delim(p, NULL);
+
+		case '[':
+		{
+			U32 count = read_count(p);
+			p += 5;
+			for (U32 i = 0; i < count; ++i)
+			{
+				p = skip_value(p);
+			}
+			return p + 1;
+		}
+
+		case '{':
+		{
+			U32 count = read_count(p);
+			p += 5;
+			for (U32 i = 0; i < count; ++i)
+			{
+				p = skip_value(skip_value(p));
+			}
+			return p + 1;
+		}
+
+		default:
+			return p + 1;
+		}
+	}
+
+	// Raw key bytes of the map key at p.
+	boost::string_ref key_ref(const U8* p)
+	{
+		if (*p == 'k')
+		{
+			return boost::string_ref((const char*)p + 5, read_u32(p + 1));
+		}
+		const U8* end = skip_delim(p, NULL);
+		return boost::string_ref((const char*)p + 1, end - p - 2);
+	}
+
+	bool key_matches(const U8* p, const boost::string_ref& key)
+	{
+		boost::string_ref raw = key_ref(p);
+		if (*p == 'k' || raw.find('\\') == boost::string_ref::npos)
+		{
+			return raw == key;
+		}
+		std::string unescaped;
+		unescape_delim((const U8*)raw.data(), (const U8*)raw.data() + raw.size(), unescaped);
+		return boost::string_ref(unescaped) == key;
+	}
+}
+
+/**
+ * LLSDView
+ */
+LLSDView::LLSDView()
+	: mData(NULL)
+{
+}
+
+LLSDView::LLSDView(const U8* data, size_t size)
+	: mData(NULL)
+{
+	if (data && size && validate_value(data, data + size, 0))
+	{
+		mData = data;
+	}
+}
+
+size_t LLSDView::byteSize() const
+{
+	return mData ? skip_value(mData) - mData : 0;
+}
+
+LLSD::Type LLSDView::type() const
+{
+	if (!mData)
+	{
+		return LLSD::TypeUndefined;
+	}
+	switch (*mData)
+	{
+	case '0':
+	case '1':
+		return LLSD::TypeBoolean;
+	case 'i':
+		return LLSD::TypeInteger;
+	case 'r':
+		return LLSD::TypeReal;
+	case 'u':
+		return LLSD::TypeUUID;
+	case 's':
+	case '\'':
+	case '"':
+		return LLSD::TypeString;
+	case 'l':
+		return LLSD::TypeURI;
+	case 'd':
+		return LLSD::TypeDate;
+	case 'b':
+		return LLSD::TypeBinary;
+	case '[':
+		return LLSD::TypeArray;
+	case '{':
+		return LLSD::TypeMap;
+	default:
+		return LLSD::TypeUndefined;
+	}
+}
+
+LLSD::Boolean LLSDView::asBoolean() const
+{
+	if (!mData)
+	{
+		return false;
+	}
+	switch (*mData)
+	{
+	case '0':
+	case '!':
+		return false;
+	case '1':
+		return true;
+	case 'i':
+		return read_u32(mData + 1) != 0;
+	default:
+		return toLLSD().asBoolean();
+	}
+}
+
+LLSD::Integer LLSDView::asInteger() const
+{
+	if (!mData)
+	{
+		return 0;
+	}
+	switch (*mData)
+	{
+	case 'i':
+		return (S32)read_u32(mData + 1);
+	case 'r':
+	{
+		F64 value = read_nbo_f64(mData + 1);
+		return !llisnan(value) ? (LLSD::Integer)value : 0;
+	}
+	default:
+		return toLLSD().asInteger();
+	}
+}
+
+LLSD::Real LLSDView::asReal() const
+{
+	if (!mData)
+	{
+		return 0.0;
+	}
+	switch (*mData)
+	{
+	case 'r':
+		return read_nbo_f64(mData + 1);
+	case 'i':
+		return (LLSD::Real)(S32)read_u32(mData + 1);
+	default:
+		return toLLSD().asReal();
+	}
+}
+
+LLUUID LLSDView::asUUID() const
+{
+	if (mData && *mData == 'u')
+	{
+		LLUUID id;
+		memcpy(id.mData, mData + 1, UUID_BYTES);
+		return id;
+	}
+	return mData ? toLLSD().asUUID() : LLUUID::null;
+}
+
+LLSD::Date LLSDView::asDate() const
+{
+	if (mData && *mData == 'd')
+	{
+		return LLDate(read_f64(mData + 1));
+	}
+	return mData ? toLLSD().asDate() : LLDate();
+}
+
+LLSD::String LLSDView::asString() const
+{
+	if (!mData)
+	{
+		return LLStringUtil::null;
+	}
+	switch (*mData)
+	{
+	case 's':
+	case 'l':
+		return std::string((const char*)mData + 5, read_u32(mData + 1));
+	case '\'':
+	case '"':
+	{
+		std::string value;
+		unescape_delim(mData + 1, skip_value(mData) - 1, value);
+		return value;
+	}
+	default:
+		return toLLSD().asString();
+	}
+}
+
+boost::string_ref LLSDView::asStringRef() const
+{
+	if (mData && (*mData == 's' || *mData == 'l'))
+	{
+		return boost::string_ref((const char*)mData + 5, read_u32(mData + 1));
+	}
+	return boost::string_ref();
+}
+
+const U8* LLSDView::binaryData() const
+{
+	return binarySize() ? mData + 5 : NULL;
+}
+
+size_t LLSDView::binarySize() const
+{
+	if (mData && *mData == 'b')
+	{
+		S32 size = (S32)read_u32(mData + 1);
+		return size > 0 ? (size_t)size : 0;
+	}
+	return 0;
+}
+
+S32 LLSDView::size() const
+{
+	return (mData && (*mData == '[' || *mData == '{')) ? (S32)read_count(mData) : 0;
+}
+
+LLSDView LLSDView::operator[](S32 index) const
+{
+	if (index < 0 || !isArray() || index >= size())
+	{
+		return LLSDView();
+	}
+	const U8* p = mData + 5;
+	for (S32 i = 0; i < index; ++i)
+	{
+		p = skip_value(p);
+	}
+	return LLSDView(p);
+}
+
+LLSDView LLSDView::operator[](const boost::string_ref& key) const
+{
+	if (!isMap())
+	{
+		return LLSDView();
+	}
+	const U8* p = mData + 5;
+	for (U32 i = 0, count = read_count(mData); i < count; ++i)
+	{
+		const U8* value = skip_value(p);
+		if (key_matches(p, key))
+		{
+			return LLSDView(value);
+		}
+		p = skip_value(value);
+	}
+	return LLSDView();
+}
+
+bool LLSDView::has(const boost::string_ref& key) const
+{
+	return (*this)[key].isValid();
+}
+
+LLSDView::map_const_iterator LLSDView::beginMap() const
+{
+	return isMap() ? map_const_iterator(mData + 5, read_count(mData)) : map_const_iterator();
+}
+
+LLSDView::array_const_iterator LLSDView::beginArray() const
+{
+	return isArray() ? array_const_iterator(mData + 5, read_count(mData)) : array_const_iterator();
+}
+
+LLSD LLSDView::toLLSD() const
+{
+	if (!mData)
+	{
+		return LLSD();
+	}
+	switch (*mData)
+	{
+	case '0':
+		return LLSD(false);
+	case '1':
+		return LLSD(true);
+	case 'i':
+		return LLSD(asInteger());
+	case 'r':
+		return LLSD(asReal());
+	case 'u':
+		return LLSD(asUUID());
+	case 's':
+	case '\'':
+	case '"':
+		return LLSD(asString());
+	case 'l':
+		return LLSD(LLURI(asString()));
+	case 'd':
+		return LLSD(asDate());
+	case 'b':
+	{
+		const U8* data = mData + 5;
+		return LLSD(LLSD::Binary(data, data + binarySize()));
+	}
+	case '[':
+	{
+		LLSD array = LLSD::emptyArray();
+		for (array_const_iterator it = beginArray(), end = endArray(); it != end; ++it)
+		{
+			array.append((*it).toLLSD());
+		}
+		return array;
+	}
+	case '{':
+	{
+		LLSD map = LLSD::emptyMap();
+		for (map_const_iterator it = beginMap(), end = endMap(); it != end; ++it)
+		{
+			map.insert(it.keyString(), it.value().toLLSD());
+		}
+		return map;
+	}
+	default:
+		return LLSD();
+	}
+}
+
+/**
+ * LLSDView::map_const_iterator
+ */
+boost::string_ref LLSDView::map_const_iterator::key() const
+{
+	return mRemaining ? key_ref(mPos) : boost::string_ref();
+}
+
+std::string LLSDView::map_const_iterator::keyString() const
+{
+	if (!mRemaining)
+	{
+		return std::string();
+	}
+	boost::string_ref raw = key_ref(mPos);
+	if (*mPos == 'k')
+	{
+		return std::string(raw.data(), raw.size());
+	}
+	std::string value;
+	unescape_delim((const U8*)raw.data(), (const U8*)raw.data() + raw.size(), value);
+	return value;
+}
+
+LLSDView LLSDView::map_const_iterator::value() const
+{
+	return mRemaining ? LLSDView(skip_value(mPos)) : LLSDView();
+}
+
+LLSDView::map_const_iterator& LLSDView::map_const_iterator::operator++()
+{
+	if (mRemaining)
+	{
+		mPos = skip_value(skip_value(mPos));
+		--mRemaining;
+	}
+	return *this;
+}
+
+/**
+ * LLSDView::array_const_iterator
+ */
+LLSDView::array_const_iterator& LLSDView::array_const_iterator::operator++()
+{
+	if (mRemaining)
+	{
+		mPos = skip_value(mPos);
+		--mRemaining;
+	}
+	return *this;
+}
@@ -0,0 +1,208 @@
+/**
+ * @file llsdview.h
+ * @brief Read-only, zero-copy view over a binary serialized LLSD buffer.
+ *
+ * $LicenseInfo:firstyear=2006&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLSDVIEW_H
+#define LL_LLSDVIEW_H
+
+#include <boost/utility/string_ref.hpp>
+#include "llsd.h"
+
+/**
+ * @class LLSDView
+ * @brief Walks a binary LLSD buffer in place without building an LLSD tree.
+ *
+ * The view reads the same wire format as LLSDBinaryParser, but nothing is
+ * copied: strings come back as boost::string_ref and binary values as a
+ * pointer/size pair into the source buffer, and map and array children are
+ * found by skipping over their siblings. Constructing a root view validates
+ * the whole value once, so every view derived from it can be read without
+ * further checks. The caller keeps the buffer alive for as long as any view
+ * or string_ref derived from it is in use.
+ *
+ * A view over malformed data, a missing map key or an out of range array
+ * index is undefined, so lookups can be chained the same way as on LLSD:
+ * <code>
+ *   LLSDView header(data, size);
+ *   S32 offset = header["high_lod"]["offset"].asInteger();
+ * </code>
+ */
+class LL_COMMON_API LLSDView
+{
+public:
+	/**
+	 * @brief Construct an undefined view.
+	 */
+	LLSDView();
+
+	/**
+	 * @brief Construct a view over the first value in a buffer.
+	 *
+	 * Trailing bytes after the value are ignored; byteSize() tells how
+	 * far the value extends. If the value is truncated or malformed the
+	 * view is undefined and isValid() returns false.
+	 * @param data The binary serialized LLSD, without the deprecated
+	 * "<? LLSD/Binary ?>" header.
+	 * @param size The number of readable bytes at data.
+	 */
+	LLSDView(const U8* data, size_t size);
+
+	/**
+	 * @brief Returns true if the view refers to a well formed value.
+	 */
+	bool isValid() const { return mData != NULL; }
+
+	/**
+	 * @brief Returns the number of buffer bytes spanned by the value.
+	 */
+	size_t byteSize() const;
+
+	LLSD::Type type() const;
+	bool isUndefined() const	{ return type() == LLSD::TypeUndefined; }
+	bool isDefined() const		{ return type() != LLSD::TypeUndefined; }
+	bool isMap() const			{ return type() == LLSD::TypeMap; }
+	bool isArray() const		{ return type() == LLSD::TypeArray; }
+	bool isBinary() const		{ return type() == LLSD::TypeBinary; }
+	bool isString() const		{ return type() == LLSD::TypeString; }
+
+	/**
+	 * @name Scalar accessors
+	 *
+	 * These convert between types exactly like the matching LLSD
+	 * accessors. Values already of the requested type are decoded
+	 * straight from the buffer; anything else goes through toLLSD().
+	 */
+	//@{
+	LLSD::Boolean	asBoolean() const;
+	LLSD::Integer	asInteger() const;
+	LLSD::Real		asReal() const;
+	LLUUID			asUUID() const;
+	LLSD::Date		asDate() const;
+	LLSD::String	asString() const;
+	//@}
+
+	/**
+	 * @brief Returns the raw bytes of a string or URI without copying.
+	 *
+	 * Only length prefixed strings can be referenced in place. Quoted
+	 * (notation style) strings may contain escapes and return an empty
+	 * string_ref; use asString() for those.
+	 */
+	boost::string_ref asStringRef() const;
+
+	/**
+	 * @brief Binary value accessors. NULL and 0 for any other type.
+	 */
+	const U8* binaryData() const;
+	size_t binarySize() const;
+
+	/**
+	 * @brief Number of children of a map or array, otherwise 0.
+	 */
+	S32 size() const;
+
+	/**
+	 * @brief Array element lookup. Walks the array from the start.
+	 */
+	LLSDView operator[](S32 index) const;
+
+	/**
+	 * @brief Map lookup. Walks the map from the start and returns the
+	 * first matching entry, as LLSD::insert() keeps the first as well.
+	 */
+	LLSDView operator[](const boost::string_ref& key) const;
+	LLSDView operator[](const char* key) const { return (*this)[boost::string_ref(key)]; }
+	LLSDView operator[](const std::string& key) const { return (*this)[boost::string_ref(key)]; }
+	bool has(const boost::string_ref& key) const;
+
+	/**
+	 * @brief Materialize the view into an LLSD tree.
+	 */
+	LLSD toLLSD() const;
+
+	/**
+	 * @brief Forward cursor over the entries of a map.
+	 */
+	class LL_COMMON_API map_const_iterator
+	{
+	public:
+		map_const_iterator() : mPos(NULL), mRemaining(0) {}
+
+		/**
+		 * @brief Raw key bytes. For quoted keys with escapes use keyString().
+		 */
+		boost::string_ref key() const;
+		std::string keyString() const;
+		LLSDView value() const;
+
+		map_const_iterator& operator++();
+		bool operator==(const map_const_iterator& rhs) const { return mRemaining == rhs.mRemaining; }
+		bool operator!=(const map_const_iterator& rhs) const { return mRemaining != rhs.mRemaining; }
+
+	private:
+		friend class LLSDView;
+		map_const_iterator(const U8* pos, U32 remaining) : mPos(pos), mRemaining(remaining) {}
+
+		const U8* mPos;
+		U32 mRemaining;
+	};
+
+	/**
+	 * @brief Forward cursor over the elements of an array.
+	 */
+	class LL_COMMON_API array_const_iterator
+	{
+	public:
+		array_const_iterator() : mPos(NULL), mRemaining(0) {}
+
+		LLSDView operator*() const { return LLSDView(mPos); }
+
+		array_const_iterator& operator++();
+		bool operator==(const array_const_iterator& rhs) const { return mRemaining == rhs.mRemaining; }
+		bool operator!=(const array_const_iterator& rhs) const { return mRemaining != rhs.mRemaining; }
+
+	private:
+		friend class LLSDView;
+		array_const_iterator(const U8* pos, U32 remaining) : mPos(pos), mRemaining(remaining) {}
+
+		const U8* mPos;
+		U32 mRemaining;
+	};
+
+	map_const_iterator beginMap() const;
+	map_const_iterator endMap() const { return map_const_iterator(); }
+	array_const_iterator beginArray() const;
+	array_const_iterator endArray() const { return array_const_iterator(); }
+
+private:
+	// Wraps a value that has already been validated as part of a root view.
+	explicit LLSDView(const U8* data) : mData(data) {}
+
+	// Start of the value, at its type marker. NULL for an undefined or
+	// invalid view.
+	const U8* mData;
+};
+
+#endif // LL_LLSDVIEW_H
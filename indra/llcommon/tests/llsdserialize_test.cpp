@@ -54,6 +54,7 @@ using namespace boost::phoenix;
 
 #include "../llsd.h"
 #include "../llsdserialize.h"
+#include "../llsdarena.h"
 #include "llsdutil.h"
 #include "../llformat.h"
 
@@ -715,6 +716,79 @@ namespace tut
 			expected,
 			1);
 	}
+
+	template<> template<>
+	void TestLLSDXMLParsingObject::test<5>()
+	{
+		// test that a document fed in pieces parses the same as one fed
+		// all at once, wherever it is split
+		LLSD v;
+		v["amy"] = 23;
+		v["bob"] = "some <text> & more";
+		v["cam"] = 1.23;
+		v["dan"] = LLUUID("60e44ec5-305c-43c2-9a19-b4b89b1ae2a6");
+		v["eve"] = LLSD::emptyArray();
+		v["eve"].append(LLDate(1234567890.0));
+		v["eve"].append(string_to_vector("hello"));
+
+		std::ostringstream ostr;
+		LLSDSerialize::toXML(v, ostr);
+		std::string xml(ostr.str());
+
+		for (size_t split = 0; split <= xml.size(); ++split)
+		{
+			std::string msg(llformat("split at %d", (S32) split));
+			LLSD parsed_result;
+			mParser->reset();
+			// parseChunk() returns false once </llsd> has been seen, so its
+			// result is not checked here.
+			mParser->parseChunk(xml.data(), (S32) split);
+			mParser->parseChunk(xml.data() + split, (S32) (xml.size() - split));
+			ensure_equals(msg + " (count)", mParser->finishParse(parsed_result), 8);
+			ensure_equals(msg, parsed_result, v);
+		}
+
+		LLSD parsed_result;
+		mParser->reset();
+		mParser->parseChunk("<llsd><map><key>amy</key>", 25);
+		ensure_equals("truncated document", mParser->finishParse(parsed_result), LLSDParser::PARSE_FAILURE);
+		ensure_equals("truncated document (value)", parsed_result, LLSD());
+	}
+
+	template<> template<>
+	void TestLLSDXMLParsingObject::test<6>()
+	{
+		// test that values parsed into an arena outlive the arena scope and
+		// behave like any other LLSD
+		LLSD v;
+		v["amy"] = 23;
+		v["bob"] = LLSD::emptyArray();
+		for (S32 i = 0; i < 5000; ++i)
+		{
+			v["bob"].append(llformat("value %d", i));
+		}
+
+		std::ostringstream ostr;
+		LLSDSerialize::toXML(v, ostr);
+
+		LLSD parsed_result;
+		{
+			LLSDArena::Scope arena;
+			std::istringstream istr(ostr.str());
+			mParser->reset();
+			mParser->parse(istr, parsed_result, ostr.str().size());
+			ensure("arena in use", LLSDArena::current() != NULL);
+		}
+		ensure("arena out of use", LLSDArena::current() == NULL);
+		ensure_equals("parsed in arena", parsed_result, v);
+
+		LLSD copy(parsed_result);
+		parsed_result["bob"][17] = "changed";
+		parsed_result["cam"] = 1.23;
+		ensure_equals("copy is unchanged", copy, v);
+		parsed_result.clear();
+		ensure_equals("copy survives", copy["bob"][4999].asString(), "value 4999");
+	}
 	/*
 	TODO:
 		test XML parsing
@@ -0,0 +1,352 @@
+/**
+ * @file llsdview_test.cpp
+ * @brief LLSDView unit tests
+ *
+ * $LicenseInfo:firstyear=2006&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include <iostream>
+#include <sstream>
+
+#include "../llsdview.h"
+#include "../llsdserialize.h"
+#include "llsdutil.h"
+#include "lltimer.h"
+
+#include "../test/lltut.h"
+
+namespace tut
+{
+	struct sd_view_data
+	{
+		std::string mBuffer;
+
+		LLSDView view(const LLSD& sd)
+		{
+			std::ostringstream ostr;
+			LLSDSerialize::toBinary(sd, ostr);
+			mBuffer = ostr.str();
+			return LLSDView((const U8*)mBuffer.data(), mBuffer.size());
+		}
+
+		LLSDView view(const std::string& raw)
+		{
+			mBuffer = raw;
+			return LLSDView((const U8*)mBuffer.data(), mBuffer.size());
+		}
+
+		// Something shaped like a mesh asset header.
+		static LLSD meshHeader()
+		{
+			LLSD header;
+			header["version"] = 1;
+			header["creator"] = LLUUID("c96f9b1e-f589-4100-9774-d98643ce0bed");
+			header["date"] = LLDate("2016-04-24T16:11:33Z");
+			const char* lods[] = { "lowest_lod", "low_lod", "medium_lod", "high_lod", "physics_convex", "skin" };
+			S32 offset = 0;
+			for (U32 i = 0; i < sizeof(lods) / sizeof(lods[0]); ++i)
+			{
+				header[lods[i]]["offset"] = offset;
+				header[lods[i]]["size"] = 1000 + (S32)i * 517;
+				offset += header[lods[i]]["size"].asInteger();
+			}
+			return header;
+		}
+
+		// Something shaped like a decompressed mesh LOD block.
+		static LLSD meshLOD(U32 faces, U32 verts)
+		{
+			LLSD lod = LLSD::emptyArray();
+			for (U32 f = 0; f < faces; ++f)
+			{
+				LLSD face;
+				LLSD::Binary pos(verts * 6), norm(verts * 6), tc(verts * 4), idx(verts * 6);
+				for (U32 i = 0; i < pos.size(); ++i)
+				{
+					pos[i] = norm[i] = (U8)(i * 7 + f);
+				}
+				for (U32 i = 0; i < tc.size(); ++i)
+				{
+					tc[i] = (U8)(i * 3);
+				}
+				for (U32 i = 0; i < idx.size() / 2; ++i)
+				{
+					U16 v = (U16)(i % verts);
+					memcpy(&idx[i * 2], &v, sizeof(U16));
+				}
+				face["Position"] = pos;
+				face["Normal"] = norm;
+				face["TexCoord0"] = tc;
+				face["TriangleList"] = idx;
+				LLSD min = LLSD::emptyArray(), max = LLSD::emptyArray();
+				min.append(-0.5); min.append(-0.5); min.append(-0.5);
+				max.append(0.5); max.append(0.5); max.append(0.5);
+				face["PositionDomain"]["Min"] = min;
+				face["PositionDomain"]["Max"] = max;
+				face["TexCoord0Domain"]["Min"] = min;
+				face["TexCoord0Domain"]["Max"] = max;
+				lod.append(face);
+			}
+			return lod;
+		}
+	};
+
+	typedef test_group<sd_view_data> sd_view_test;
+	typedef sd_view_test::object sd_view_object;
+	tut::sd_view_test sd_view("LLSDView");
+
+	template<> template<>
+	void sd_view_object::test<1>()
+	{
+		// scalars
+		ensure("default undefined", LLSDView().isUndefined());
+		ensure("default invalid", !LLSDView().isValid());
+		ensure("undef", view(LLSD()).isUndefined());
+		ensure("undef is valid", view(LLSD()).isValid());
+		ensure_equals("true", view(LLSD(true)).asBoolean(), true);
+		ensure_equals("false", view(LLSD(false)).asBoolean(), false);
+		ensure_equals("integer", view(LLSD(-3463)).asInteger(), -3463);
+		ensure_equals("real", view(LLSD(-34379.0438)).asReal(), -34379.0438);
+		ensure_equals("real as integer", view(LLSD(12.9)).asInteger(), 12);
+		ensure_equals("string", view(LLSD("foobar")).asString(), "foobar");
+		ensure_equals("string ref", std::string(view(LLSD("foobar")).asStringRef()), "foobar");
+		ensure_equals("integer as string", view(LLSD(42)).asString(), "42");
+
+		LLUUID id("c96f9b1e-f589-4100-9774-d98643ce0bed");
+		ensure_equals("uuid", view(LLSD(id)).asUUID(), id);
+
+		LLDate date("2006-04-24T16:11:33Z");
+		ensure_equals("date", view(LLSD(date)).asDate().secondsSinceEpoch(), date.secondsSinceEpoch());
+
+		LLSDView uri = view(LLSD(LLURI("https://secondlife.com/login")));
+		ensure_equals("uri type", uri.type(), LLSD::TypeURI);
+		ensure_equals("uri", uri.asString(), "https://secondlife.com/login");
+	}
+
+	template<> template<>
+	void sd_view_object::test<2>()
+	{
+		// binary values point into the buffer
+		LLSD::Binary data;
+		for (U32 i = 0; i < 100; ++i)
+		{
+			data.push_back((U8)i);
+		}
+		LLSDView v = view(LLSD(data));
+		ensure("binary", v.isBinary());
+		ensure_equals("binary size", v.binarySize(), data.size());
+		ensure("binary in place", v.binaryData() >= (const U8*)mBuffer.data()
+			   && v.binaryData() + v.binarySize() <= (const U8*)mBuffer.data() + mBuffer.size());
+		ensure("binary contents", !memcmp(v.binaryData(), &data[0], data.size()));
+		ensure("empty binary", view(LLSD(LLSD::Binary())).binaryData() == NULL);
+		ensure("not binary", view(LLSD(1)).binaryData() == NULL);
+	}
+
+	template<> template<>
+	void sd_view_object::test<3>()
+	{
+		// map and array lookup
+		LLSD header = meshHeader();
+		LLSDView v = view(header);
+		ensure("map", v.isMap());
+		ensure_equals("map size", v.size(), header.size());
+		ensure_equals("nested lookup", v["high_lod"]["size"].asInteger(), header["high_lod"]["size"].asInteger());
+		ensure_equals("std::string lookup", v[std::string("version")].asInteger(), 1);
+		ensure("has", v.has("skin"));
+		ensure("missing key", !v.has("nope"));
+		ensure("missing key undefined", v["nope"]["offset"].isUndefined());
+		ensure("index into map", v[0].isUndefined());
+
+		S32 entries = 0;
+		for (LLSDView::map_const_iterator it = v.beginMap(); it != v.endMap(); ++it, ++entries)
+		{
+			ensure(it.keyString(), header.has(it.keyString()));
+			ensure(it.keyString(), llsd_equals(it.value().toLLSD(), header[it.keyString()]));
+		}
+		ensure_equals("map entries", entries, header.size());
+
+		LLSD lod = meshLOD(3, 10);
+		v = view(lod);
+		ensure("array", v.isArray());
+		ensure_equals("array size", v.size(), 3);
+		ensure("out of range", v[3].isUndefined());
+		ensure("negative index", v[-1].isUndefined());
+		ensure("key into array", v["Position"].isUndefined());
+		ensure_equals("array element", v[2]["TexCoord0"].binarySize(), lod[2]["TexCoord0"].asBinary().size());
+		ensure_equals("domain", v[1]["PositionDomain"]["Max"][2].asReal(), 0.5);
+
+		S32 elements = 0;
+		for (LLSDView::array_const_iterator it = v.beginArray(); it != v.endArray(); ++it, ++elements)
+		{
+			ensure("element", llsd_equals((*it).toLLSD(), lod[elements]));
+		}
+		ensure_equals("array elements", elements, 3);
+
+		ensure("materialize", llsd_equals(v.toLLSD(), lod));
+	}
+
+	template<> template<>
+	void sd_view_object::test<4>()
+	{
+		// byteSize matches what the stream parser consumes, and trailing
+		// data after the value is ignored
+		LLSD header = meshHeader();
+		std::ostringstream ostr;
+		LLSDSerialize::toBinary(header, ostr);
+		std::string serialized = ostr.str();
+
+		LLSDView v = view(serialized + "trailing lod data");
+		ensure("valid with trailing data", v.isValid());
+		ensure_equals("byte size", v.byteSize(), serialized.size());
+
+		std::istringstream istr(mBuffer);
+		LLSD parsed;
+		LLSDSerialize::fromBinary(parsed, istr, (S32) mBuffer.size());
+		ensure_equals("parser agrees", (size_t)istr.tellg(), v.byteSize());
+	}
+
+	template<> template<>
+	void sd_view_object::test<5>()
+	{
+		// truncated or corrupt buffers are rejected rather than read past
+		std::ostringstream ostr;
+		LLSDSerialize::toBinary(meshLOD(2, 4), ostr);
+		std::string serialized = ostr.str();
+
+		for (size_t len = 0; len < serialized.size(); ++len)
+		{
+			LLSDView v((const U8*)serialized.data(), len);
+			ensure("truncated", !v.isValid());
+			ensure("truncated undefined", v.isUndefined());
+		}
+		ensure("complete", LLSDView((const U8*)serialized.data(), serialized.size()).isValid());
+
+		ensure("bad tag", !view(std::string("x")).isValid());
+		ensure("missing terminator", !view(std::string("[\0\0\0\1!}", 7)).isValid());
+		ensure("short count", !view(std::string("[\0\0\0\2!]", 7)).isValid());
+		ensure("bad key", !view(std::string("{\0\0\0\1i\0\0\0\1!}", 12)).isValid());
+		ensure("oversized string", !view(std::string("s\0\0\1\0abc", 8)).isValid());
+
+		std::string deep;
+		for (S32 i = 0; i < 1000; ++i)
+		{
+			deep += std::string("[\0\0\0\1", 5);
+		}
+		deep += "!" + std::string(1000, ']');
+		ensure("runaway nesting", !view(deep).isValid());
+	}
+
+	template<> template<>
+	void sd_view_object::test<6>()
+	{
+		// the binary format also accepts notation style quoted strings
+		LLSDView v = view(std::string("'a\\x41\\n\\'b'"));
+		ensure("quoted", v.isString());
+		ensure_equals("quoted string", v.asString(), "aA\n'b");
+		ensure("quoted string ref", v.asStringRef().empty());
+
+		v = view(std::string("{\0\0\0\2'ke\\x79'i\0\0\0\7\"two\"s\0\0\0\2ok}", 31));
+		ensure("quoted keys", v.isValid());
+		ensure_equals("escaped key", v["key"].asInteger(), 7);
+		ensure_equals("plain key", v["two"].asString(), "ok");
+
+		std::istringstream istr(mBuffer);
+		LLSD parsed;
+		LLSDSerialize::fromBinary(parsed, istr, (S32) mBuffer.size());
+		ensure("parser agrees", llsd_equals(v.toLLSD(), parsed));
+	}
+
+	template<> template<>
+	void sd_view_object::test<7>()
+	{
+		// Compare reading a few fields with the view against a full parse,
+		// on payloads shaped like a mesh header and a mesh LOD block.
+		struct Payload
+		{
+			const char* mName;
+			LLSD mSD;
+			S32 mIterations;
+		};
+		Payload payloads[] =
+		{
+			{ "mesh header", meshHeader(), 20000 },
+			{ "mesh lod", meshLOD(8, 2000), 200 },
+		};
+
+		for (U32 p = 0; p < sizeof(payloads) / sizeof(payloads[0]); ++p)
+		{
+			std::ostringstream ostr;
+			LLSDSerialize::toBinary(payloads[p].mSD, ostr);
+			const std::string serialized = ostr.str();
+			const bool is_header = payloads[p].mSD.isMap();
+
+			// keep the optimizer from dropping either loop
+			S64 parse_sum = 0;
+			S64 view_sum = 0;
+
+			LLTimer timer;
+			for (S32 i = 0; i < payloads[p].mIterations; ++i)
+			{
+				std::istringstream istr(serialized);
+				LLSD sd;
+				LLSDSerialize::fromBinary(sd, istr, (S32) serialized.size());
+				if (is_header)
+				{
+					parse_sum += sd["high_lod"]["offset"].asInteger() + sd["high_lod"]["size"].asInteger();
+				}
+				else
+				{
+					for (S32 f = 0; f < sd.size(); ++f)
+					{
+						parse_sum += sd[f]["Position"].asBinary().size() + sd[f]["TriangleList"].asBinary().size();
+					}
+				}
+			}
+			F64 parse_time = timer.getElapsedTimeF64();
+
+			timer.reset();
+			for (S32 i = 0; i < payloads[p].mIterations; ++i)
+			{
+				LLSDView sd((const U8*)serialized.data(), serialized.size());
+				if (is_header)
+				{
+					view_sum += sd["high_lod"]["offset"].asInteger() + sd["high_lod"]["size"].asInteger();
+				}
+				else
+				{
+					for (LLSDView::array_const_iterator it = sd.beginArray(); it != sd.endArray(); ++it)
+					{
+						view_sum += (*it)["Position"].binarySize() + (*it)["TriangleList"].binarySize();
+					}
+				}
+			}
+			F64 view_time = timer.getElapsedTimeF64();
+
+			ensure_equals(payloads[p].mName, view_sum, parse_sum);
+			std::cout << "LLSDView " << payloads[p].mName << " (" << serialized.size() << " bytes x "
+					  << payloads[p].mIterations << "): parser " << parse_time * 1000.0
+					  << " ms, view " << view_time * 1000.0 << " ms" << std::endl;
+		}
+	}
+}
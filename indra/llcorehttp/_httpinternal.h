@@ -150,6 +150,19 @@ const int HTTP_CONNECTION_LIMIT_MAX = 256;
 const long HTTP_PIPELINING_DEFAULT = 0L;
 const long HTTP_PIPELINING_MAX = 20L;
 
+// Extra transport threads policy classes can be moved onto
+// with PO_TRANSPORT_THREAD.  Zero is the main service thread.
+const long HTTP_TRANSPORT_THREAD_DEFAULT = 0L;
+const long HTTP_TRANSPORT_THREAD_MAX = 4L;
+
+// HTTP/2 concurrent stream limits, zero disables HTTP/2
+const long HTTP_STREAMS_DEFAULT = 0L;
+const long HTTP_STREAMS_MAX = 256L;
+
+// Largest response body storage reserved up front from the
+// expected length.  Beyond this, bodies are gathered in slabs.
+const size_t HTTP_REPLY_RESERVE_MAX = 16 * 1024 * 1024;
+
 // Miscellaneous defaults
 const bool HTTP_USE_RETRY_AFTER_DEFAULT = true;
 const long HTTP_THROTTLE_RATE_DEFAULT = 0L;
@@ -57,7 +57,9 @@ HttpLibcurl::HttpLibcurl(HttpService * service)
 	  mPolicyCount(0),
 	  mMultiHandles(nullptr),
 	  mActiveHandles(nullptr),
-	  mDirtyPolicy(nullptr)
+	  mDirtyPolicy(nullptr),
+	  mMultiplexed(nullptr),
+	  mHttp2Available(false)
 {}
 
 
@@ -98,6 +100,9 @@ void HttpLibcurl::shutdown()
 
 		delete [] mDirtyPolicy;
 		mDirtyPolicy = nullptr;
+
+		delete [] mMultiplexed;
+		mMultiplexed = nullptr;
 	}
 
 	mPolicyCount = 0;
@@ -113,6 +118,12 @@ void HttpLibcurl::start(int policy_count)
 	mMultiHandles = new CURLM * [mPolicyCount];
 	mActiveHandles = new int [mPolicyCount];
 	mDirtyPolicy = new bool [mPolicyCount];
+	mMultiplexed = new bool [mPolicyCount];
+
+#if LLCORE_HTTP_HTTP2_SUPPORTED
+	const curl_version_info_data * curl_info(curl_version_info(CURLVERSION_NOW));
+	mHttp2Available = curl_info && (curl_info->features & CURL_VERSION_HTTP2);
+#endif
 	
 	for (int policy_class(0); policy_class < mPolicyCount; ++policy_class)
 	{
@@ -123,6 +134,7 @@ void HttpLibcurl::start(int policy_count)
 		}
 		mActiveHandles[policy_class] = 0;
 		mDirtyPolicy[policy_class] = false;
+		mMultiplexed[policy_class] = false;
 		policyUpdated(policy_class);
 	}
 }
@@ -268,6 +280,44 @@ bool HttpLibcurl::cancel(HttpHandle handle)
 }
 
 
+bool HttpLibcurl::changePriority(HttpHandle handle, HttpRequest::priority_t priority)
+{
+    HttpOpRequest::ptr_t op = HttpOpRequest::fromHandle<HttpOpRequest>(handle);
+	if (! op || mActiveOps.end() == mActiveOps.find(op) || ! isMultiplexed(op->mReqPolicy))
+	{
+		return false;
+	}
+
+	op->mReqPriority = priority;
+#if LLCORE_HTTP_HTTP2_SUPPORTED
+	// libcurl sends a PRIORITY frame when it next services the stream
+	CURLcode code = curl_easy_setopt(op->mCurlHandle, CURLOPT_STREAM_WEIGHT, getStreamWeight(priority));
+	if (CURLE_OK != code)
+	{
+		LL_WARNS(LOG_CORE) << "libcurl error setting stream weight:  " << code
+						   << ", " << curl_easy_strerror(code)
+						   << LL_ENDL;
+	}
+#endif
+	return true;
+}
+
+
+bool HttpLibcurl::isMultiplexed(int policy_class) const
+{
+	return mMultiplexed && policy_class < mPolicyCount && mMultiplexed[policy_class];
+}
+
+
+// static
+long HttpLibcurl::getStreamWeight(HttpRequest::priority_t priority)
+{
+	// URGENT (0x40000000) maps to 256, LOW (0x10000000) to 64
+	// with the low bits ordering requests within a level.
+	return llclamp(long(priority >> 22), 1L, 256L);
+}
+
+
 // *NOTE:  cancelRequest logic parallels completeRequest logic.
 // Keep them synchronized as necessary.  Caller is expected to
 // remove the op from the active list and release the op *after*
@@ -468,8 +518,42 @@ void HttpLibcurl::policyUpdated(int policy_class)
 		// Enable policy if stalled
 		policy.stallPolicy(policy_class, false);
 		mDirtyPolicy[policy_class] = false;
+		mMultiplexed[policy_class] = mHttp2Available && options.mHttp2Streams > 0L;
+		if (options.mHttp2Streams > 0L && ! mHttp2Available)
+		{
+			LL_WARNS_ONCE(LOG_CORE) << "HTTP/2 requested but libcurl wasn't built with it.  Using HTTP/1.1."
+									<< LL_ENDL;
+		}
 		
-		if (options.mPipelining > 1)
+		if (mMultiplexed[policy_class])
+		{
+#if LLCORE_HTTP_HTTP2_SUPPORTED
+			// Requests wait for the host's first connection
+			// (CURLOPT_PIPEWAIT) and, once it negotiates HTTP/2,
+			// all ride it as streams.  Hosts that stay on HTTP/1.1
+			// still get the per-host connection limit.  Policy keeps
+			// streams in flight under mHttp2Streams.
+			code = curl_multi_setopt(multi_handle,
+									 CURLMOPT_PIPELINING,
+									 long(CURLPIPE_MULTIPLEX));
+			check_curl_multi_code(code, CURLMOPT_PIPELINING);
+			code = curl_multi_setopt(multi_handle,
+									 CURLMOPT_MAX_HOST_CONNECTIONS,
+									 long(options.mPerHostConnectionLimit));
+			check_curl_multi_code(code, CURLMOPT_MAX_HOST_CONNECTIONS);
+			code = curl_multi_setopt(multi_handle,
+									 CURLMOPT_MAX_TOTAL_CONNECTIONS,
+									 long(options.mConnectionLimit));
+			check_curl_multi_code(code, CURLMOPT_MAX_TOTAL_CONNECTIONS);
+#if LIBCURL_VERSION_NUM >= 0x074300
+			code = curl_multi_setopt(multi_handle,
+									 CURLMOPT_MAX_CONCURRENT_STREAMS,
+									 long(options.mHttp2Streams));
+			check_curl_multi_code(code, CURLMOPT_MAX_CONCURRENT_STREAMS);
+#endif
+#endif // LLCORE_HTTP_HTTP2_SUPPORTED
+		}
+		else if (options.mPipelining > 1)
 		{
 			// We'll try to do pipelining on this multihandle
 			code = curl_multi_setopt(multi_handle,
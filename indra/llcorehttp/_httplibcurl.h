@@ -39,6 +39,12 @@
 #include "_httpinternal.h"
 
 
+// HTTP/2 multiplexing (CURLPIPE_MULTIPLEX, CURLOPT_PIPEWAIT,
+// CURLOPT_STREAM_WEIGHT and CURL_HTTP_VERSION_2TLS) arrived
+// by libcurl 7.47.0.  The library must also be built with it.
+#define LLCORE_HTTP_HTTP2_SUPPORTED		(LIBCURL_VERSION_NUM >= 0x072f00)
+
+
 namespace LLCore
 {
 
@@ -118,6 +124,26 @@ public:
 	/// Threading:  called by worker thread.
 	bool cancel(HttpHandle handle);
 
+	/// Reweight an active request's HTTP/2 stream.  Requests on
+	/// HTTP/1.1 connections are left alone.
+	///
+	/// @return			True if handle was found on a multiplexed class.
+	///
+	/// Threading:  called by worker thread.
+	bool changePriority(HttpHandle handle, HttpRequest::priority_t priority);
+
+	/// True if requests in the class are sent as HTTP/2 streams
+	/// (PO_HTTP2_STREAMS is set and libcurl supports it).  Follows
+	/// the options last applied to the class's multi handle.
+	///
+	/// Threading:  called by worker thread.
+	bool isMultiplexed(int policy_class) const;
+
+	/// Map a request priority onto an HTTP/2 stream weight in
+	/// [1..256].  Indra priorities keep their level in the top
+	/// bits (LOW through URGENT) so those spread across the range.
+	static long getStreamWeight(HttpRequest::priority_t priority);
+
 	/// Informs transport that a particular policy class has had
 	/// options changed and so should effect any transport state
 	/// change necessary to effect those changes.  Used mainly for
@@ -215,6 +241,8 @@ protected:
 	CURLM **			mMultiHandles;		// One handle per policy class
 	int *				mActiveHandles;		// Active count per policy class
 	bool *				mDirtyPolicy;		// Dirty policy update waiting for stall (per pc)
+	bool *				mMultiplexed;		// HTTP/2 applied to multi handle (per pc)
+	bool				mHttp2Available;	// libcurl was built with HTTP/2
 	
 }; // end class HttpLibcurl
 
@@ -54,6 +54,15 @@ HttpOpCancel::~HttpOpCancel()
 {}
 
 
+// Staged wherever the request it cancels lives.
+HttpRequest::policy_t HttpOpCancel::getStagingPolicy()
+{
+	HttpOperation::ptr_t op(HttpOperation::fromHandle<HttpOperation>(mHandle));
+
+	return op ? op->getStagingPolicy() : HttpRequest::GLOBAL_POLICY_ID;
+}
+
+
 // Immediately search for the request on various queues
 // and cancel operations if found.  Return the status of
 // the search and cancel as the status of this request.
@@ -60,6 +60,7 @@ public:
 	
 public:
 	void stageFromRequest(HttpService *) override;
+	HttpRequest::policy_t getStagingPolicy() override;
 			
 public:
 	// Request data
@@ -140,6 +140,12 @@ HttpStatus HttpOperation::cancel()
 	return status;
 }
 
+
+HttpRequest::policy_t HttpOperation::getStagingPolicy()
+{
+	return HttpRequest::GLOBAL_POLICY_ID;
+}
+
 // Handle methods
 HttpHandle HttpOperation::getHandle()
 {
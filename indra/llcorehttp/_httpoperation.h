@@ -156,6 +156,14 @@ public:
 	///
 	virtual HttpStatus cancel();
 
+	/// Policy class whose transport thread stages this operation.
+	/// The default, GLOBAL_POLICY_ID, keeps it on the main service
+	/// thread.  @see HttpRequest::PO_TRANSPORT_THREAD
+	///
+	/// Threading:  called by worker thread.
+	///
+	virtual HttpRequest::policy_t getStagingPolicy();
+
     /// Retrieves a unique handle for this operation.
     HttpHandle getHandle();
 
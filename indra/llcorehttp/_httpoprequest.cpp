@@ -143,7 +143,8 @@ HttpOpRequest::HttpOpRequest()
 	  mPolicyRetries(0),
 	  mPolicy503Retries(0),
 	  mPolicyRetryAt(HttpTime(0)),
-	  mPolicyRetryLimit(HTTP_RETRY_COUNT_DEFAULT)
+	  mPolicyRetryLimit(HTTP_RETRY_COUNT_DEFAULT),
+	  mPolicyReadyPos(0)
 {
 	// *NOTE:  As members are added, retry initialization/cleanup
 	// may need to be extended in @see prepareRequest().
@@ -188,6 +189,12 @@ HttpOpRequest::~HttpOpRequest()
 }
 
 
+HttpRequest::policy_t HttpOpRequest::getStagingPolicy()
+{
+	return mReqPolicy;
+}
+
+
 void HttpOpRequest::stageFromRequest(HttpService * service)
 {
     HttpOpRequest::ptr_t self(boost::dynamic_pointer_cast<HttpOpRequest>(shared_from_this()));
@@ -602,6 +609,27 @@ HttpStatus HttpOpRequest::prepareRequest(HttpService * service)
 		code = curl_easy_setopt(mCurlHandle, CURLOPT_CAINFO, gpolicy.mCAFile.c_str());
 		check_curl_easy_code(code, CURLOPT_CAINFO);
 	}
+
+#if LLCORE_HTTP_HTTP2_SUPPORTED
+	if (service->getTransport().isMultiplexed(mReqPolicy))
+	{
+		// HTTP/2 where TLS negotiates it.  Wait to see if the host's
+		// connection multiplexes instead of opening another.
+		code = curl_easy_setopt(mCurlHandle, CURLOPT_HTTP_VERSION, long(CURL_HTTP_VERSION_2TLS));
+		check_curl_easy_code(code, CURLOPT_HTTP_VERSION);
+		code = curl_easy_setopt(mCurlHandle, CURLOPT_PIPEWAIT, 1L);
+		check_curl_easy_code(code, CURLOPT_PIPEWAIT);
+		code = curl_easy_setopt(mCurlHandle, CURLOPT_STREAM_WEIGHT, HttpLibcurl::getStreamWeight(mReqPriority));
+		check_curl_easy_code(code, CURLOPT_STREAM_WEIGHT);
+	}
+	else
+	{
+		// Newer libcurl defaults to HTTP/2 over TLS, keep classes
+		// that haven't asked for it on their connection limits.
+		code = curl_easy_setopt(mCurlHandle, CURLOPT_HTTP_VERSION, long(CURL_HTTP_VERSION_1_1));
+		check_curl_easy_code(code, CURLOPT_HTTP_VERSION);
+	}
+#endif // LLCORE_HTTP_HTTP2_SUPPORTED
 	
 	switch (mReqMethod)
 	{
@@ -805,6 +833,24 @@ size_t HttpOpRequest::writeCallback(void * data, size_t size, size_t nmemb, void
 	if (! op->mReplyBody)
 	{
 		op->mReplyBody = new BufferArray();
+
+		// Headers are in by now.  If they tell us how much is
+		// coming, get it into one block the consumer can adopt
+		// rather than copy.
+		size_t expected(op->mReplyLength);
+		if (! expected)
+		{
+			double content_length(-1.0);
+			if (CURLE_OK == curl_easy_getinfo(op->mCurlHandle, CURLINFO_CONTENT_LENGTH_DOWNLOAD, &content_length)
+				&& content_length > 0.0)
+			{
+				expected = size_t(content_length);
+			}
+		}
+		if (expected && expected <= HTTP_REPLY_RESERVE_MAX)
+		{
+			op->mReplyBody->reserve(expected);
+		}
 	}
 	const size_t req_size(size * nmemb);
 	const size_t write_size(op->mReplyBody->append(static_cast<char *>(data), req_size));
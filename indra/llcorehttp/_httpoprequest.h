@@ -89,6 +89,7 @@ public:
 	};
 
 	void stageFromRequest(HttpService *) override;
+	HttpRequest::policy_t getStagingPolicy() override;
 	void stageFromReady(HttpService *) override;
 	void stageFromActive(HttpService *) override;
 
@@ -232,22 +233,10 @@ public:
 	int					mPolicy503Retries;
 	HttpTime			mPolicyRetryAt;
 	int					mPolicyRetryLimit;
+	size_t				mPolicyReadyPos;		// Slot in HttpReadyQueue while queued
 };  // end class HttpOpRequest
 
 
-/// HttpOpRequestCompare isn't an operation but a uniform comparison
-/// functor for STL containers that order by priority.  Mainly
-/// used for the ready queue container but defined here.
-class HttpOpRequestCompare
-{
-public:
-	bool operator()(const HttpOpRequest * lhs, const HttpOpRequest * rhs)
-		{
-			return lhs->mReqPriority > rhs->mReqPriority;
-		}
-};  // end class HttpOpRequestCompare
-
-
 // ---------------------------------------
 // Free functions
 // ---------------------------------------
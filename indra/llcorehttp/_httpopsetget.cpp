@@ -112,6 +112,15 @@ HttpStatus HttpOpSetGet::setupSet(HttpRequest::EPolicyOption opt, HttpRequest::p
 }
 
 
+// Class options live with the class's transport thread.  Global
+// options are kept by the main service thread which passes sets
+// on to the other transport threads.
+HttpRequest::policy_t HttpOpSetGet::getStagingPolicy()
+{
+	return mReqClass;
+}
+
+
 void HttpOpSetGet::stageFromRequest(HttpService * service)
 {
 	if (mReqDoSet)
@@ -70,6 +70,7 @@ public:
 	HttpStatus setupSet(HttpRequest::EPolicyOption opt, HttpRequest::policy_t pclass, const std::string & value);
 
 	void stageFromRequest(HttpService *) override;
+	HttpRequest::policy_t getStagingPolicy() override;
 
 public:
 	// Request data
@@ -48,6 +48,15 @@ HttpOpSetPriority::~HttpOpSetPriority()
 {}
 
 
+// Staged wherever the request it reprioritizes lives.
+HttpRequest::policy_t HttpOpSetPriority::getStagingPolicy()
+{
+	HttpOperation::ptr_t op(HttpOperation::fromHandle<HttpOperation>(mHandle));
+
+	return op ? op->getStagingPolicy() : HttpRequest::GLOBAL_POLICY_ID;
+}
+
+
 void HttpOpSetPriority::stageFromRequest(HttpService * service)
 {
 	// Do operations
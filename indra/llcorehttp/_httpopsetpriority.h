@@ -59,6 +59,7 @@ private:
 
 public:
 	void stageFromRequest(HttpService *) override;
+	HttpRequest::policy_t getStagingPolicy() override;
 
 protected:
 	// Request Data
@@ -253,10 +253,12 @@ HttpService::ELoopSpeed HttpPolicy::processReadyQueue()
 		}
 
 		int active(transport.getActiveCountInClass(policy_class));
-		int active_limit(state.mOptions.mPipelining > 1L
-						 ? (state.mOptions.mPerHostConnectionLimit
-							* state.mOptions.mPipelining)
-						 : state.mOptions.mConnectionLimit);
+		int active_limit(transport.isMultiplexed(policy_class)
+						 ? state.mOptions.mHttp2Streams
+						 : (state.mOptions.mPipelining > 1L
+							? (state.mOptions.mPerHostConnectionLimit
+							   * state.mOptions.mPipelining)
+							: state.mOptions.mConnectionLimit));
 		int needed(active_limit - active);		// Expect negatives here
 
 		if (needed > 0)
@@ -345,20 +347,9 @@ bool HttpPolicy::changePriority(HttpHandle handle, HttpRequest::priority_t prior
 		// is meaningless.  The request will be issued based on retry
 		// intervals not priority value, which is now moot.
 		
-		// Scan ready queue for requests that match policy
-		HttpReadyQueue::container_type & c(state.mReadyQueue.get_container());
-		for (HttpReadyQueue::container_type::iterator iter(c.begin()); c.end() != iter;)
+		if (state.mReadyQueue.changePriority(handle, priority))
 		{
-			HttpReadyQueue::container_type::iterator cur(iter++);
-
-			if ((*cur)->getHandle() == handle)
-			{
-				HttpOpRequest::ptr_t op(*cur);
-				c.erase(cur);									// All iterators are now invalidated
-				op->mReqPriority = priority;
-				state.mReadyQueue.push(op);						// Re-insert using adapter class
-				return true;
-			}
+			return true;
 		}
 	}
 	
@@ -387,19 +378,12 @@ bool HttpPolicy::cancel(HttpHandle handle)
 			}
 		}
 		
-		// Scan ready queue
-		HttpReadyQueue::container_type & c2(state.mReadyQueue.get_container());
-		for (HttpReadyQueue::container_type::iterator iter(c2.begin()); c2.end() != iter;)
+		// Ready queue finds it directly
+		HttpOpRequest::ptr_t op(state.mReadyQueue.remove(handle));
+		if (op)
 		{
-			HttpReadyQueue::container_type::iterator cur(iter++);
-
-			if ((*cur)->getHandle() == handle)
-			{
-				HttpOpRequest::ptr_t op(*cur);
-				c2.erase(cur);									// All iterators are now invalidated
-				op->cancel();
-				return true;
-			}
+			op->cancel();
+			return true;
 		}
 	}
 	
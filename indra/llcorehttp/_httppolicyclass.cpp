@@ -39,7 +39,9 @@ HttpPolicyClass::HttpPolicyClass()
 	: mConnectionLimit(HTTP_CONNECTION_LIMIT_DEFAULT),
 	  mPerHostConnectionLimit(HTTP_CONNECTION_LIMIT_DEFAULT),
 	  mPipelining(HTTP_PIPELINING_DEFAULT),
-	  mThrottleRate(HTTP_THROTTLE_RATE_DEFAULT)
+	  mThrottleRate(HTTP_THROTTLE_RATE_DEFAULT),
+	  mTransportThread(HTTP_TRANSPORT_THREAD_DEFAULT),
+	  mHttp2Streams(HTTP_STREAMS_DEFAULT)
 {}
 
 
@@ -55,6 +57,8 @@ HttpPolicyClass & HttpPolicyClass::operator=(const HttpPolicyClass & other)
 		mPerHostConnectionLimit = other.mPerHostConnectionLimit;
 		mPipelining = other.mPipelining;
 		mThrottleRate = other.mThrottleRate;
+		mTransportThread = other.mTransportThread;
+		mHttp2Streams = other.mHttp2Streams;
 	}
 	return *this;
 }
@@ -64,7 +68,9 @@ HttpPolicyClass::HttpPolicyClass(const HttpPolicyClass & other)
 	: mConnectionLimit(other.mConnectionLimit),
 	  mPerHostConnectionLimit(other.mPerHostConnectionLimit),
 	  mPipelining(other.mPipelining),
-	  mThrottleRate(other.mThrottleRate)
+	  mThrottleRate(other.mThrottleRate),
+	  mTransportThread(other.mTransportThread),
+	  mHttp2Streams(other.mHttp2Streams)
 {}
 
 
@@ -88,6 +94,14 @@ HttpStatus HttpPolicyClass::set(HttpRequest::EPolicyOption opt, long value)
 		mThrottleRate = llclamp(value, 0L, 1000000L);
 		break;
 
+	case HttpRequest::PO_TRANSPORT_THREAD:
+		mTransportThread = llclamp(value, 0L, HTTP_TRANSPORT_THREAD_MAX);
+		break;
+
+	case HttpRequest::PO_HTTP2_STREAMS:
+		mHttp2Streams = llclamp(value, 0L, HTTP_STREAMS_MAX);
+		break;
+
 	default:
 		return HttpStatus(HttpStatus::LLCORE, HE_INVALID_ARG);
 	}
@@ -116,6 +130,14 @@ HttpStatus HttpPolicyClass::get(HttpRequest::EPolicyOption opt, long * value) co
 		*value = mThrottleRate;
 		break;
 
+	case HttpRequest::PO_TRANSPORT_THREAD:
+		*value = mTransportThread;
+		break;
+
+	case HttpRequest::PO_HTTP2_STREAMS:
+		*value = mHttp2Streams;
+		break;
+
 	default:
 		return HttpStatus(HttpStatus::LLCORE, HE_INVALID_ARG);
 	}
@@ -64,6 +64,8 @@ public:
 	long						mPerHostConnectionLimit;
 	long						mPipelining;
 	long						mThrottleRate;
+	long						mTransportThread;
+	long						mHttp2Streams;
 };  // end class HttpPolicyClass
 
 }  // end namespace LLCore
@@ -56,6 +56,7 @@ HttpPolicyGlobal & HttpPolicyGlobal::operator=(const HttpPolicyGlobal & other)
 		mHttpProxy = other.mHttpProxy;
 		mTrace = other.mTrace;
 		mUseLLProxy = other.mUseLLProxy;
+		mSslCtxCallback = other.mSslCtxCallback;
 	}
 	return *this;
 }
@@ -28,7 +28,10 @@
 #define	_LLCORE_HTTP_READY_QUEUE_H_
 
 
-#include <queue>
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include <unordered_map>
 
 #include "_httpinternal.h"
 #include "_httpoprequest.h"
@@ -37,40 +40,32 @@
 namespace LLCore
 {
 
-/// HttpReadyQueue provides a simple priority queue for HttpOpRequest objects.
+/// HttpReadyQueue provides a priority queue for HttpOpRequest objects
+/// that also supports finding, reprioritizing and removing any queued
+/// request by handle in O(log n).  Callers like texture fetch adjust
+/// priorities on thousands of queued requests as the camera moves,
+/// so a linear scan per change isn't acceptable.
 ///
-/// This uses the priority_queue adaptor class to provide the queue
-/// as well as the ordering scheme while allowing us access to the
-/// raw container if we follow a few simple rules.  One of the more
-/// important of those rules is that any iterator becomes invalid
-/// on element erasure.  So pay attention.
+/// Implemented as a 4-ary heap in a vector with a handle-to-request
+/// map.  Each request records its own slot in the heap in
+/// mPolicyReadyPos which is updated as entries move.  A request may
+/// be in only one ready queue at a time.
 ///
-/// If LLCORE_HTTP_READY_QUEUE_IGNORES_PRIORITY tests true, the class
-/// implements a std::priority_queue interface but on std::deque
-/// behavior to eliminate sensitivity to priority.  In the future,
-/// this will likely become the only behavior or it may become
-/// a run-time election.
+/// Requests of equal priority come out in the order they went in.
+/// If LLCORE_HTTP_READY_QUEUE_IGNORES_PRIORITY tests true, priority
+/// is ignored entirely and the queue is first-come-first-served with
+/// a reprioritized request going to the back.
 ///
 /// Threading:  not thread-safe.  Expected to be used entirely by
 /// a single thread, typically a worker thread of some sort.
 
-#if LLCORE_HTTP_READY_QUEUE_IGNORES_PRIORITY
-
-typedef std::deque<HttpOpRequest::ptr_t> HttpReadyQueueBase;
-
-#else
-
-typedef std::priority_queue<HttpOpRequest::ptr_t,
-							std::deque<HttpOpRequest::ptr_t>,
-							LLCore::HttpOpRequestCompare> HttpReadyQueueBase;
-
-#endif // LLCORE_HTTP_READY_QUEUE_IGNORES_PRIORITY
-
-class HttpReadyQueue : public HttpReadyQueueBase
+class HttpReadyQueue
 {
 public:
+	typedef HttpOpRequest::ptr_t value_type;
+
 	HttpReadyQueue()
-		: HttpReadyQueueBase()
+		: mNextSeq(0)
 		{}
 	
 	~HttpReadyQueue()
@@ -81,39 +76,194 @@ protected:
 	HttpReadyQueue& operator=(const HttpReadyQueue &) = delete;		// Not defined
 
 public:
+	bool empty() const
+		{
+			return mHeap.empty();
+		}
 
-#if LLCORE_HTTP_READY_QUEUE_IGNORES_PRIORITY
-	// Types and methods needed to make a std::deque look
-	// more like a std::priority_queue, at least for our
-	// purposes.
-	typedef HttpReadyQueueBase container_type;
-	
-	const_reference top() const
+	size_t size() const
+		{
+			return mHeap.size();
+		}
+
+	/// Highest priority, earliest queued request.  Queue must
+	/// not be empty.
+	const value_type & top() const
+		{
+			return mHeap.front().mOp;
+		}
+
+	void push(const value_type & op)
 		{
-			return front();
+			const size_t pos(mHeap.size());
+
+			mHeap.push_back(Node(op, mNextSeq++));
+			mHandles[op->getHandle()] = op.get();
+			op->mPolicyReadyPos = pos;
+			siftUp(pos);
 		}
 
 	void pop()
 		{
-			pop_front();
+			removeAt(0);
 		}
 
-	void push(const value_type & v)
+	/// Whether the request with the given handle is queued here.
+	bool contains(HttpHandle handle) const
 		{
-			push_back(v);
+			return mHandles.end() != mHandles.find(handle);
+		}
+
+	/// Changes the priority of a queued request and moves it
+	/// to its new place.
+	///
+	/// @return			False if the request isn't queued here
+	bool changePriority(HttpHandle handle, HttpRequest::priority_t priority)
+		{
+			handle_map_t::iterator it(mHandles.find(handle));
+			if (mHandles.end() == it)
+			{
+				return false;
+			}
+
+			const size_t pos(it->second->mPolicyReadyPos);
+			Node & node(mHeap[pos]);
+			node.mOp->mReqPriority = priority;
+			node.mSeq = mNextSeq++;
+			// Goes behind anything already queued at the new priority
+			siftDown(siftUp(pos));
+			return true;
+		}
+
+	/// Takes the request with the given handle out of the queue.
+	///
+	/// @return			The removed request or an empty pointer if
+	///					it isn't queued here.
+	value_type remove(HttpHandle handle)
+		{
+			handle_map_t::iterator it(mHandles.find(handle));
+			if (mHandles.end() == it)
+			{
+				return value_type();
+			}
+
+			const size_t pos(it->second->mPolicyReadyPos);
+			value_type op(mHeap[pos].mOp);
+			removeAt(pos);
+			return op;
 		}
 	
-#endif // LLCORE_HTTP_READY_QUEUE_IGNORES_PRIORITY
-	
-	const container_type & get_container() const
+protected:
+	struct Node
+	{
+		Node(const value_type & op, U64 seq)
+			: mOp(op),
+			  mSeq(seq)
+			{}
+
+		value_type		mOp;
+		U64				mSeq;			// Queue order among equal priorities
+	};
+
+	typedef std::vector<Node> container_t;
+	typedef std::unordered_map<HttpHandle, HttpOpRequest *> handle_map_t;
+
+	static const size_t ARITY = 4;
+
+	// True if 'lhs' should come out of the queue before 'rhs'
+	static bool before(const Node & lhs, const Node & rhs)
 		{
-			return *this;
+#if ! LLCORE_HTTP_READY_QUEUE_IGNORES_PRIORITY
+			if (lhs.mOp->mReqPriority != rhs.mOp->mReqPriority)
+			{
+				return lhs.mOp->mReqPriority > rhs.mOp->mReqPriority;
+			}
+#endif // ! LLCORE_HTTP_READY_QUEUE_IGNORES_PRIORITY
+			return lhs.mSeq < rhs.mSeq;
 		}
 
-	container_type & get_container()
+	void place(size_t pos, Node & node)
 		{
-			return *this;
+			node.mOp->mPolicyReadyPos = pos;
+			mHeap[pos] = std::move(node);
 		}
+
+	// @return		Final position of the node
+	size_t siftUp(size_t pos)
+		{
+			if (! pos)
+			{
+				return pos;
+			}
+
+			Node node(std::move(mHeap[pos]));
+			while (pos)
+			{
+				const size_t parent((pos - 1) / ARITY);
+				if (! before(node, mHeap[parent]))
+				{
+					break;
+				}
+				place(pos, mHeap[parent]);
+				pos = parent;
+			}
+			place(pos, node);
+			return pos;
+		}
+
+	// @return		Final position of the node
+	size_t siftDown(size_t pos)
+		{
+			const size_t count(mHeap.size());
+			Node node(std::move(mHeap[pos]));
+			while (true)
+			{
+				const size_t first(pos * ARITY + 1);
+				if (first >= count)
+				{
+					break;
+				}
+				const size_t last((std::min)(first + ARITY, count));
+				size_t best(first);
+				for (size_t child(first + 1); child < last; ++child)
+				{
+					if (before(mHeap[child], mHeap[best]))
+					{
+						best = child;
+					}
+				}
+				if (! before(mHeap[best], node))
+				{
+					break;
+				}
+				place(pos, mHeap[best]);
+				pos = best;
+			}
+			place(pos, node);
+			return pos;
+		}
+
+	void removeAt(size_t pos)
+		{
+			mHandles.erase(mHeap[pos].mOp->getHandle());
+
+			const size_t last(mHeap.size() - 1);
+			if (pos != last)
+			{
+				place(pos, mHeap[last]);
+				mHeap.pop_back();
+				siftDown(siftUp(pos));
+			}
+			else
+			{
+				mHeap.pop_back();
+			}
+		}
+
+protected:
+	container_t			mHeap;
+	handle_map_t		mHandles;
+	U64					mNextSeq;
 	
 }; // end class HttpReadyQueue
 
@@ -49,6 +49,9 @@ class HttpOperation;
 
 class HttpRequestQueue : public LLCoreInt::RefCounted
 {
+	// Transport threads get a queue of their own
+	friend class HttpService;
+
 protected:
 	/// Caller acquires a Refcount on construction
 	HttpRequestQueue();
@@ -29,6 +29,7 @@
 #include "_httpservice.h"
 
 #include "_httpoperation.h"
+#include "_httpopsetget.h"
 #include "_httprequestqueue.h"
 #include "_httppolicy.h"
 #include "_httplibcurl.h"
@@ -61,7 +62,9 @@ const HttpService::OptionDescriptor HttpService::sOptionDesc[] =
 	{	true,		true,		true,		false,		false	},		// PO_TRACE
 	{	true,		true,		false,		true,		false	},		// PO_ENABLE_PIPELINING
 	{	true,		true,		false,		true,		false	},		// PO_THROTTLE_RATE
-	{   false,		false,		true,		false,		true	}		// PO_SSL_VERIFY_CALLBACK
+	{   false,		false,		true,		false,		true	},		// PO_SSL_VERIFY_CALLBACK
+	{	true,		false,		false,		true,		false	},		// PO_TRANSPORT_THREAD
+	{	true,		true,		false,		true,		false	}		// PO_HTTP2_STREAMS
 };
 HttpService * HttpService::sInstance(nullptr);
 volatile HttpService::EState HttpService::sState(NOT_INITIALIZED);
@@ -72,7 +75,8 @@ HttpService::HttpService()
 	  mThread(nullptr),
 	  mPolicy(nullptr),
 	  mTransport(nullptr),
-	  mLastPolicy(0)
+	  mLastPolicy(0),
+	  mIsTransportThread(false)
 {}
 
 
@@ -117,6 +121,13 @@ HttpService::~HttpService()
 		}
 	}
 	
+	// After the worker thread that feeds them
+	for (service_list_t::iterator it(mTransportThreads.begin()); it != mTransportThreads.end(); ++it)
+	{
+		delete *it;
+	}
+	mTransportThreads.clear();
+
 	if (mRequestQueue)
 	{
 		mRequestQueue->release();
@@ -215,12 +226,97 @@ void HttpService::startThread()
 	// Push current policy definitions, enable policy & transport components
 	mPolicy->start();
 	mTransport->start(mLastPolicy + 1);
+	startTransportThreads();
 
 	mThread = new LLCoreInt::HttpThread(std::bind(&HttpService::threadRun, this, std::placeholders::_1));
 	sState = RUNNING;
 }
 
 
+/// Threading:  callable by init thread.
+void HttpService::startTransportThreads()
+{
+	// Left over from an earlier run, already joined
+	for (service_list_t::iterator it(mTransportThreads.begin()); it != mTransportThreads.end(); ++it)
+	{
+		delete *it;
+	}
+	mTransportThreads.clear();
+
+	long thread_count(0L);
+	for (HttpRequest::policy_t pclass(0); pclass <= mLastPolicy; ++pclass)
+	{
+		thread_count = (std::max)(thread_count, mPolicy->getClassOptions(pclass).mTransportThread);
+	}
+
+	for (long i(0); i < thread_count; ++i)
+	{
+		// Same classes and options as ours.  Only the classes
+		// assigned to this thread will ever see requests.
+		HttpService * service(new HttpService());
+		service->mIsTransportThread = true;
+		service->mRequestQueue = new HttpRequestQueue();
+		service->mPolicy = new HttpPolicy(service);
+		service->mTransport = new HttpLibcurl(service);
+
+		service->mPolicy->getGlobalOptions() = mPolicy->getGlobalOptions();
+		while (service->mLastPolicy < mLastPolicy)
+		{
+			service->createPolicyClass();
+		}
+		for (HttpRequest::policy_t pclass(0); pclass <= mLastPolicy; ++pclass)
+		{
+			service->mPolicy->getClassOptions(pclass) = mPolicy->getClassOptions(pclass);
+		}
+
+		service->mPolicy->start();
+		service->mTransport->start(mLastPolicy + 1);
+		service->mThread = new LLCoreInt::HttpThread(std::bind(&HttpService::threadRun, service, std::placeholders::_1));
+		mTransportThreads.push_back(service);
+	}
+
+	if (thread_count)
+	{
+		LL_INFOS(LOG_CORE) << "Started " << thread_count << " additional transport threads." << LL_ENDL;
+	}
+}
+
+
+/// Threading:  callable by worker thread.
+void HttpService::stopTransportThreads()
+{
+	for (service_list_t::iterator it(mTransportThreads.begin()); it != mTransportThreads.end(); ++it)
+	{
+		(*it)->mExitRequested = 1U;
+		(*it)->mRequestQueue->stopQueue();
+	}
+
+	// Each cancels its own requests on the way out
+	for (service_list_t::iterator it(mTransportThreads.begin()); it != mTransportThreads.end(); ++it)
+	{
+		if ((*it)->mThread && (*it)->mThread->joinable())
+		{
+			(*it)->mThread->join();
+		}
+	}
+}
+
+
+/// Threading:  callable by worker thread.
+HttpService * HttpService::getStagingService(HttpRequest::policy_t pclass)
+{
+	if (mTransportThreads.empty()
+		|| HttpRequest::GLOBAL_POLICY_ID == pclass
+		|| pclass > mLastPolicy)
+	{
+		return this;
+	}
+
+	const long thread(mPolicy->getClassOptions(pclass).mTransportThread);
+	return thread ? mTransportThreads[thread - 1] : this;
+}
+
+
 /// Threading:  callable by worker thread.
 void HttpService::stopRequested()
 {
@@ -237,8 +333,11 @@ bool HttpService::changePriority(HttpHandle handle, HttpRequest::priority_t prio
 	// requests sitting there.  Start with the ready queue...
 	found = mPolicy->changePriority(handle, priority);
 
-	// If not there, we could try the transport/active queue but priority
-	// doesn't really have much effect there so we don't waste cycles.
+	if (! found)
+	{
+		// Only HTTP/2 streams can be reweighted once active
+		found = mTransport->changePriority(handle, priority);
+	}
 	
 	return found;
 }
@@ -286,6 +385,9 @@ void HttpService::shutdown()
     }
     ops.clear();
 
+	// Stop transport threads, they won't get anything more from us
+	stopTransportThreads();
+
 	// Shutdown transport canceling requests, freeing resources
 	mTransport->shutdown();
 
@@ -324,7 +426,10 @@ void HttpService::threadRun(LLCoreInt::HttpThread * thread)
 	}
 
 	shutdown();
-	sState = STOPPED;
+	if (! mIsTransportThread)
+	{
+		sState = STOPPED;
+	}
 }
 
 
@@ -354,8 +459,16 @@ HttpService::ELoopSpeed HttpService::processRequestQueue(ELoopSpeed loop)
 								   << LL_ENDL;
 			}
 
-			// Stage
-			op->stageFromRequest(this);
+			// Stage here or on the class's own transport thread
+			HttpService * service(getStagingService(op->getStagingPolicy()));
+			if (this == service)
+			{
+				op->stageFromRequest(this);
+			}
+			else if (! service->mRequestQueue->addOp(op))
+			{
+				op->cancel();
+			}
 		}
 				
 		// Done with operation
@@ -476,9 +589,13 @@ HttpStatus HttpService::setPolicyOption(HttpRequest::EPolicyOption opt, HttpRequ
 		HttpPolicyGlobal & opts(mPolicy->getGlobalOptions());
 		
 		status = opts.set(opt, value);
-		if (status && ret_value)
+		if (status)
 		{
-			status = opts.get(opt, ret_value);
+			forwardGlobalOption(opt, value);
+			if (ret_value)
+			{
+				status = opts.get(opt, ret_value);
+			}
 		}
 	}
 	else
@@ -522,9 +639,13 @@ HttpStatus HttpService::setPolicyOption(HttpRequest::EPolicyOption opt, HttpRequ
 		HttpPolicyGlobal & opts(mPolicy->getGlobalOptions());
 		
 		status = opts.set(opt, value);
-		if (status && ret_value)
+		if (status)
 		{
-			status = opts.get(opt, ret_value);
+			forwardGlobalOption(opt, value);
+			if (ret_value)
+			{
+				status = opts.get(opt, ret_value);
+			}
 		}
 	}
 
@@ -563,4 +684,20 @@ HttpStatus HttpService::setPolicyOption(HttpRequest::EPolicyOption opt, HttpRequ
 }
 
 
+template <typename T>
+void HttpService::forwardGlobalOption(HttpRequest::EPolicyOption opt, const T & value)
+{
+	// Transport threads keep their own copy of the global options.
+	// Before they start, startThread() copies the lot.
+	for (service_list_t::iterator it(mTransportThreads.begin()); it != mTransportThreads.end(); ++it)
+	{
+		HttpOpSetGet::ptr_t op(new HttpOpSetGet());
+		if (op->setupSet(opt, HttpRequest::GLOBAL_POLICY_ID, value))
+		{
+			(*it)->mRequestQueue->addOp(op);
+		}
+	}
+}
+
+
 }  // end namespace LLCore
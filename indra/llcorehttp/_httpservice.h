@@ -78,6 +78,18 @@ class HttpOpSetGet;
 /// 1:1:1 relationship with HttpService managing instances of the other
 /// two.  So, these classes do not use reference counting to refer
 /// to one another, their lifecycles are always managed together.
+///
+/// Transport Threads
+///
+/// Policy classes given a non-zero PO_TRANSPORT_THREAD are serviced
+/// by additional HttpService instances, each with its own request
+/// queue, policy, transport (and so libcurl multi handles) and
+/// thread.  The singleton's worker thread still pulls everything
+/// off the global request queue but hands operations for those
+/// classes on to the owning instance's queue.  Global option
+/// changes are copied to every instance.  These instances are
+/// created by startThread() and stopped by the singleton's
+/// shutdown().
 
 class HttpService
 {
@@ -189,6 +201,19 @@ protected:
 	
 	ELoopSpeed processRequestQueue(ELoopSpeed loop);
 
+	/// Threading:  callable by init thread.
+	void startTransportThreads();
+
+	/// Threading:  callable by worker thread.
+	void stopTransportThreads();
+
+	/// Service whose worker stages operations for the given
+	/// class.  Returns this for global operations and for
+	/// classes left on the main service thread.
+	///
+	/// Threading:  callable by worker thread.
+	HttpService * getStagingService(HttpRequest::policy_t pclass);
+
 protected:
 	friend class HttpOpSetGet;
 	friend class HttpRequest;
@@ -219,6 +244,9 @@ protected:
 								HttpRequest::policyCallback_t value, 
 								HttpRequest::policyCallback_t * ret_value);
 
+	template <typename T>
+	void forwardGlobalOption(HttpRequest::EPolicyOption opt, const T & value);
+
 protected:
 	static const OptionDescriptor		sOptionDesc[HttpRequest::PO_LAST];
 	static HttpService *				sInstance;
@@ -235,6 +263,11 @@ protected:
 	
 	// === main-thread-only data ===
 	HttpRequest::policy_t				mLastPolicy;
+
+	// === transport threads, fixed once the worker starts ===
+	typedef std::vector<HttpService *> service_list_t;
+	service_list_t						mTransportThreads;	// Simple pointers, has ownership
+	bool								mIsTransportThread;
 	
 };  // end class HttpService
 
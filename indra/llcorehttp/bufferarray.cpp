@@ -28,11 +28,14 @@
 
 #include "bufferarray.h"
 
+#include "llmemory.h"
+#include "_mutex.h"
+
 
 // BufferArray is a list of chunks, each a BufferArray::Block, of contiguous
 // data presented as a single array.  Chunks are at least BufferArray::BLOCK_ALLOC_SIZE
-// in length and can be larger.  Any chunk may be partially filled or even
-// empty.
+// in length and can be larger, except those sized by reserve().  Any chunk may
+// be partially filled or even empty.
 //
 // The BufferArray itself is sharable as a RefCounted entity.  As shared
 // reads don't work with the concept of a current position/seek value,
@@ -40,6 +43,12 @@
 // all take position arguments.  Single write/shared read isn't supported
 // directly and any such attempts have to be serialized outside of this
 // implementation.
+//
+// Block storage is separate from the Block itself so that it can be
+// handed to a consumer with adoptData() instead of being copied out.
+// Full-sized storage ("slabs") goes back to a small process-wide free
+// list on release, as the transport threads churn through them at a
+// high rate while bodies arrive.
 
 namespace LLCore
 {
@@ -54,34 +63,134 @@ class BufferArray::Block
 public:
 	~Block();
 
-	void operator delete(void *);
-	void operator delete(void *, size_t len);
-
 protected:
 	Block(size_t len);
 
 	Block(const Block &) = delete;						// Not defined
 	Block& operator=(const Block &) = delete;				// Not defined
 
-	// Allocate the block with the additional space for the
-	// buffered data at the end of the object.
-	void * operator new(size_t len, size_t addl_len);
-	
 public:
 	// Only public entry to get a block.
 	static Block * alloc(size_t len);
 
+	// Gives up the storage, which the caller now frees
+	// with ll_aligned_free_16().
+	char * release();
+	
 public:
 	size_t mUsed;
 	size_t mAlloced;
+	char * mData;
+};
+
+
+namespace
+{
+
+// Free list of BLOCK_ALLOC_SIZE slabs shared by all BufferArrays.
+// Bodies are written on the transport threads and released on
+// whatever thread drops the last reference so everything here
+// is done under the lock.
+class SlabPool
+{
+public:
+	SlabPool()
+		: mLimit(0)
+		{
+			memset(&mStats, 0, sizeof(mStats));
+		}
+
+	~SlabPool()
+		{
+			setLimit(0);
+		}
+
+	char * get()
+		{
+			{
+				LLCoreInt::HttpScopedLock lock(mMutex);
+
+				++mStats.mSlabAllocs;
+				if (! mFree.empty())
+				{
+					char * slab(mFree.back());
+					mFree.pop_back();
+					++mStats.mPoolHits;
+					mStats.mPooledBytes -= BufferArray::BLOCK_ALLOC_SIZE;
+					return slab;
+				}
+			}
+			return static_cast<char *>(ll_aligned_malloc_16(BufferArray::BLOCK_ALLOC_SIZE));
+		}
+
+	void put(char * slab)
+		{
+			{
+				LLCoreInt::HttpScopedLock lock(mMutex);
+
+				if (mStats.mPooledBytes + BufferArray::BLOCK_ALLOC_SIZE <= mLimit)
+				{
+					mFree.push_back(slab);
+					mStats.mPooledBytes += BufferArray::BLOCK_ALLOC_SIZE;
+					return;
+				}
+			}
+			ll_aligned_free_16(slab);
+		}
+
+	void adopted(size_t len)
+		{
+			LLCoreInt::HttpScopedLock lock(mMutex);
+
+			++mStats.mAdopted;
+			mStats.mAdoptedBytes += len;
+		}
 
-	// *NOTE:  Must be last member of the object.  We'll
-	// overallocate as requested via operator new and index
-	// into the array at will.
-	char mData[1];		
+	void setLimit(size_t limit)
+		{
+			std::vector<char *> excess;
+			{
+				LLCoreInt::HttpScopedLock lock(mMutex);
+
+				mLimit = limit;
+				while (mStats.mPooledBytes > mLimit)
+				{
+					excess.push_back(mFree.back());
+					mFree.pop_back();
+					mStats.mPooledBytes -= BufferArray::BLOCK_ALLOC_SIZE;
+				}
+			}
+			for (std::vector<char *>::iterator it(excess.begin()); excess.end() != it; ++it)
+			{
+				ll_aligned_free_16(*it);
+			}
+		}
+
+	void getStats(BufferArray::SlabStats & stats)
+		{
+			LLCoreInt::HttpScopedLock lock(mMutex);
+
+			stats = mStats;
+			stats.mPoolLimit = mLimit;
+		}
+
+protected:
+	LLCoreInt::HttpMutex		mMutex;
+	std::vector<char *>			mFree;
+	size_t						mLimit;
+	BufferArray::SlabStats		mStats;
 };
 
 
+SlabPool & slab_pool()
+{
+	static SlabPool pool;
+	return pool;
+}
+
+}  // end anonymous namespace
+
+
 // ==================================
 // BufferArray Definitions
 // ==================================
@@ -163,6 +272,7 @@ void * BufferArray::appendBufferAlloc(size_t len)
 		mBlocks.reserve(mBlocks.size() + 5);
 	}
 	Block * block = Block::alloc((std::max)(BLOCK_ALLOC_SIZE, len));
+	memset(block->mData, 0, len);
 	block->mUsed = len;
 	mBlocks.push_back(block);
 	mLen += len;
@@ -304,6 +414,81 @@ bool BufferArray::getBlockStartEnd(int block, const char ** start, const char **
 }
 
 
+void BufferArray::reserve(size_t len)
+{
+	if (mLen || ! len)
+	{
+		return;
+	}
+
+	// Drop any empty blocks from an earlier reserve()
+	for (container_t::iterator it(mBlocks.begin());
+		 it != mBlocks.end();
+		 ++it)
+	{
+		delete *it;
+	}
+	mBlocks.clear();
+	mBlocks.push_back(Block::alloc(len));
+}
+
+
+void * BufferArray::adoptData(size_t * len)
+{
+	// Empty blocks may surround the data, find the one block
+	// that has everything.
+	Block * data_block(nullptr);
+	for (container_t::iterator it(mBlocks.begin());
+		 it != mBlocks.end();
+		 ++it)
+	{
+		if ((*it)->mUsed)
+		{
+			if (data_block)
+			{
+				return nullptr;		// Scattered, must be copied
+			}
+			data_block = *it;
+		}
+	}
+	if (! data_block)
+	{
+		return nullptr;
+	}
+
+	// Don't let a small body pin down a whole slab, the
+	// caller copying it out is cheaper than the waste.
+	if (data_block->mUsed < data_block->mAlloced / 2)
+	{
+		return nullptr;
+	}
+
+	*len = data_block->mUsed;
+	void * data(data_block->release());
+	for (container_t::iterator it(mBlocks.begin());
+		 it != mBlocks.end();
+		 ++it)
+	{
+		delete *it;
+	}
+	mBlocks.clear();
+	mLen = 0;
+	return data;
+}
+
+
+void BufferArray::setSlabPoolLimit(size_t limit)
+{
+	slab_pool().setLimit(limit);
+}
+
+
+void BufferArray::getSlabStats(SlabStats & stats)
+{
+	slab_pool().getStats(stats);
+}
+
+
 // ==================================
 // BufferArray::Block Definitions
 // ==================================
@@ -311,42 +496,57 @@ bool BufferArray::getBlockStartEnd(int block, const char ** start, const char **
 
 BufferArray::Block::Block(size_t len)
 	: mUsed(0),
-	  mAlloced(len)
+	  mAlloced(len),
+	  mData(nullptr)
 {
-	memset(mData, 0, len);
+	// Contents are not cleared, everything up to mUsed
+	// is written before it can be read.
+	if (BLOCK_ALLOC_SIZE == len)
+	{
+		mData = slab_pool().get();
+	}
+	else
+	{
+		mData = static_cast<char *>(ll_aligned_malloc_16(len ? len : 1));
+	}
+	llassert_always(mData);
 }
 			
 
 BufferArray::Block::~Block()
 {
+	if (mData)
+	{
+		if (BLOCK_ALLOC_SIZE == mAlloced)
+		{
+			slab_pool().put(mData);
+		}
+		else
+		{
+			ll_aligned_free_16(mData);
+		}
+	}
+	mData = nullptr;
 	mUsed = 0;
 	mAlloced = 0;
 }
 
 
-void * BufferArray::Block::operator new(size_t len, size_t addl_len)
+char * BufferArray::Block::release()
 {
-	void * mem = new char[len + addl_len + sizeof(void *)];
-	return mem;
-}
-
+	char * data(mData);
 
-void BufferArray::Block::operator delete(void * mem)
-{
-	char * cmem = static_cast<char *>(mem);
-	delete [] cmem;
-}
-
-
-void BufferArray::Block::operator delete(void * mem, size_t)
-{
-	operator delete(mem);
+	slab_pool().adopted(mUsed);
+	mData = nullptr;
+	mUsed = 0;
+	mAlloced = 0;
+	return data;
 }
 
 
 BufferArray::Block * BufferArray::Block::alloc(size_t len)
 {
-	Block * block = new (len) Block(len);
+	Block * block = new Block(len);
 	return block;
 }
 	
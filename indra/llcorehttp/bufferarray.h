@@ -59,10 +59,13 @@ class BufferArrayStreamBuf;
 /// write and append operations and beyond which the current position
 /// cannot be set.
 ///
-/// Threading:  not thread-safe
+/// Threading:  not thread-safe, except for the static slab pool
+/// methods which may be called from any thread.
 ///
 /// Allocation:  Refcounted, heap only.  Caller of the constructor
-/// is given a single refcount.
+/// is given a single refcount.  Block storage comes from
+/// ll_aligned_malloc_16().  Full-sized blocks are recycled through
+/// a process-wide pool of slabs, capped by setSlabPoolLimit().
 ///
 class BufferArray : public LLCoreInt::RefCounted
 {
@@ -120,11 +123,57 @@ public:
 	/// append data when current position is equal to the
 	/// size of the instance or do a mix of both.
 	size_t write(size_t pos, const void * src, size_t len);
-	
-protected:
-	int findBlock(size_t pos, size_t * ret_offset);
 
+	/// Returns the bounds of the storage block with the
+	/// given index, letting callers such as streaming parsers
+	/// read the contents in place without copying them out.
+	/// Blocks are numbered from zero in data order.
+	///
+	/// @return			False if 'block' is out of range
 	bool getBlockStartEnd(int block, const char ** start, const char ** end);
+
+	/// Hint that about 'len' bytes are about to be appended
+	/// to an empty instance.  A single block of exactly that
+	/// size is allocated so the data lands contiguously and
+	/// can later be taken with adoptData().  Does nothing if
+	/// the instance already has data.
+	void reserve(size_t len);
+
+	/// Hands the caller the storage holding the entire
+	/// contents without copying it, leaving the instance
+	/// empty.  Only possible when all the data is in one
+	/// block that isn't mostly slack, which is the normal
+	/// case after reserve().  On success, the caller owns
+	/// the returned memory and must free it with
+	/// ll_aligned_free_16().
+	///
+	/// @param len		Set to the size of the data on success
+	/// @return			Pointer to the data or nullptr if it
+	///					must be read() out instead.
+	void * adoptData(size_t * len);
+
+	/// Counters for the process-wide slab pool.
+	struct SlabStats
+	{
+		size_t		mSlabAllocs;		// Slabs taken, pooled or new
+		size_t		mPoolHits;			// Slabs taken from the pool
+		size_t		mAdopted;			// Blocks handed out by adoptData()
+		size_t		mAdoptedBytes;
+		size_t		mPooledBytes;		// Free slab memory held by the pool
+		size_t		mPoolLimit;
+	};
+
+	/// Caps the free slab memory kept for reuse.  Zero, the
+	/// default, frees slabs as soon as they're released.
+	///
+	/// Threading:  callable by any thread.
+	static void setSlabPoolLimit(size_t limit);
+
+	/// Threading:  callable by any thread.
+	static void getSlabStats(SlabStats & stats);
+
+protected:
+	int findBlock(size_t pos, size_t * ret_offset);
 	
 protected:
 	class Block;
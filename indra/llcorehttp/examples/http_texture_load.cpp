@@ -63,6 +63,8 @@ static int concurrency_limit(40);
 static int highwater(100);
 static int pipeline_depth(0);
 static int tracing(0);
+static int transport_threads(0);
+static int http2_streams(0);
 static char url_format[1024] = "http://example.com/some/path?texture_id=%s.texture";
 
 #if defined(WIN32)
@@ -100,6 +102,7 @@ public:
 	};
 	typedef std::set<LLCore::HttpHandle> handle_set_t;
 	typedef std::vector<Spec> asset_list_t;
+	typedef std::vector<LLCore::HttpRequest::policy_t> policy_list_t;
 	
 public:
 	bool						mVerbose;
@@ -113,6 +116,7 @@ public:
 	int							mAt;
 	std::string					mUrl;
 	asset_list_t				mAssets;
+	policy_list_t				mPolicies;
 	int							mErrorsApi;
 	int							mErrorsHttp;
 	int							mErrorsHttp404;
@@ -169,7 +173,7 @@ int main(int argc, char** argv)
 	bool do_verbose(false);
 	
 	int option(-1);
-	while (-1 != (option = getopt(argc, argv, "u:c:h?RwvH:p:t:")))
+	while (-1 != (option = getopt(argc, argv, "u:c:h?RwvH:p:t:T:2:")))
 	{
 		switch (option)
 		{
@@ -238,6 +242,36 @@ int main(int argc, char** argv)
 			}
 			break;
 
+		case 'T':
+		    {
+				unsigned long value;
+				char * end;
+
+				value = strtoul(optarg, &end, 10);
+				if (value > 4 || *end != '\0')
+				{
+					usage(std::cerr);
+					return 1;
+				}
+				transport_threads = value;
+			}
+			break;
+
+		case '2':
+		    {
+				unsigned long value;
+				char * end;
+
+				value = strtoul(optarg, &end, 10);
+				if (value > 256 || *end != '\0')
+				{
+					usage(std::cerr);
+					return 1;
+				}
+				http2_streams = value;
+			}
+			break;
+
 		case 'R':
 			do_random = true;
 			do_whole = false;
@@ -278,20 +312,52 @@ int main(int argc, char** argv)
 	// Initialization
 	init_curl();
 	LLCore::HttpRequest::createService();
-	LLCore::HttpRequest::setStaticPolicyOption(LLCore::HttpRequest::PO_CONNECTION_LIMIT,
-											   LLCore::HttpRequest::DEFAULT_POLICY_ID,
-											   concurrency_limit,
-											   NULL);
-	LLCore::HttpRequest::setStaticPolicyOption(LLCore::HttpRequest::PO_PER_HOST_CONNECTION_LIMIT,
-											   LLCore::HttpRequest::DEFAULT_POLICY_ID,
-											   concurrency_limit,
-											   NULL);
-	if (pipeline_depth)
+
+	// Either everything on the default class and service thread or
+	// requests spread over one class per transport thread sharing
+	// the same connection limit.
+	WorkingSet::policy_list_t policies;
+	if (transport_threads)
 	{
-		LLCore::HttpRequest::setStaticPolicyOption(LLCore::HttpRequest::PO_PIPELINING_DEPTH,
-												   LLCore::HttpRequest::DEFAULT_POLICY_ID,
-												   pipeline_depth,
+		for (int i(0); i < transport_threads; ++i)
+		{
+			LLCore::HttpRequest::policy_t policy(LLCore::HttpRequest::createPolicyClass());
+			LLCore::HttpRequest::setStaticPolicyOption(LLCore::HttpRequest::PO_TRANSPORT_THREAD,
+													   policy,
+													   i + 1,
+													   NULL);
+			policies.push_back(policy);
+		}
+	}
+	else
+	{
+		policies.push_back(LLCore::HttpRequest::DEFAULT_POLICY_ID);
+	}
+	const int class_limit((std::max)(1, concurrency_limit / int(policies.size())));
+	for (int i(0); i < policies.size(); ++i)
+	{
+		LLCore::HttpRequest::setStaticPolicyOption(LLCore::HttpRequest::PO_CONNECTION_LIMIT,
+												   policies[i],
+												   class_limit,
+												   NULL);
+		LLCore::HttpRequest::setStaticPolicyOption(LLCore::HttpRequest::PO_PER_HOST_CONNECTION_LIMIT,
+												   policies[i],
+												   class_limit,
 												   NULL);
+		if (pipeline_depth)
+		{
+			LLCore::HttpRequest::setStaticPolicyOption(LLCore::HttpRequest::PO_PIPELINING_DEPTH,
+													   policies[i],
+													   pipeline_depth,
+													   NULL);
+		}
+		if (http2_streams)
+		{
+			LLCore::HttpRequest::setStaticPolicyOption(LLCore::HttpRequest::PO_HTTP2_STREAMS,
+													   policies[i],
+													   (std::max)(1, http2_streams / int(policies.size())),
+													   NULL);
+		}
 	}
 	if (tracing)
 	{
@@ -319,6 +385,7 @@ int main(int argc, char** argv)
 	ws.mRandomRange = do_random;
 	ws.mNoRange = do_whole;
 	ws.mVerbose = do_verbose;
+	ws.mPolicies = policies;
 	ws.mRequestHighWater = highwater;
 	ws.mRequestLowWater = ws.mRequestHighWater / 2;
 	
@@ -400,6 +467,15 @@ void usage(std::ostream & out)
 		"                       depth on HTTP requests.  Default:  " << pipeline_depth << "\n"
 		" -t <level>            If <level> is positive ([1..3]), enables and sets HTTP\n"
 		"                       tracing on HTTP requests.  Default:  " << tracing << "\n"
+		" -T <count>            Spread requests over <count> policy classes, each on\n"
+		"                       its own transport thread, dividing the connection\n"
+		"                       limit between them.  Range:  [0..4]  Default:  " << transport_threads << "\n"
+		" -2 <streams>          If <streams> is positive, use HTTP/2 where the server\n"
+		"                       negotiates it over TLS (https:// URLs), multiplexing up\n"
+		"                       to <streams> requests over one connection per host in\n"
+		"                       place of the -c connection limit.  Compare against a\n"
+		"                       run without it to measure the two modes.\n"
+		"                       Range:  [0..256]  Default:  " << http2_streams << "\n"
 		" -v                    Verbose mode.  Issue some chatter while running\n"
 		" -h                    print this help\n"
 		"\n"
@@ -468,14 +544,15 @@ bool WorkingSet::reload(LLCore::HttpRequest * hr, LLCore::HttpOptions::ptr_t & o
 				   ? 0
 				   : (mRandomRange ? ((unsigned long) rand()) % 1000000UL : mAssets[mAt].mLength));
 
+		const LLCore::HttpRequest::policy_t policy(mPolicies.empty() ? 0 : mPolicies[mAt % mPolicies.size()]);
 		LLCore::HttpHandle handle;
 		if (offset || length)
 		{
-			handle = hr->requestGetByteRange(0, 0, buffer, offset, length, opt, mHeaders, LLCore::HttpHandler::ptr_t(this, NoOpDeletor));
+			handle = hr->requestGetByteRange(policy, 0, buffer, offset, length, opt, mHeaders, LLCore::HttpHandler::ptr_t(this, NoOpDeletor));
 		}
 		else
 		{
-            handle = hr->requestGet(0, 0, buffer, opt, mHeaders, LLCore::HttpHandler::ptr_t(this, NoOpDeletor));
+            handle = hr->requestGet(policy, 0, buffer, opt, mHeaders, LLCore::HttpHandler::ptr_t(this, NoOpDeletor));
 		}
 		if (! handle)
 		{
@@ -233,6 +233,29 @@ public:
 		/// Global only
 		PO_SSL_VERIFY_CALLBACK,
 
+		/// Long value selecting the transport thread that services
+		/// this policy class.  Zero, the default, keeps the class on
+		/// the main service thread with everything else.  Classes
+		/// given the same non-zero value share a thread of their own
+		/// with a separate libcurl multi handle so busy classes (e.g.
+		/// textures) can't delay small latency-sensitive requests.
+		/// Limited to HTTP_TRANSPORT_THREAD_MAX extra threads.
+		///
+		/// Per-class only, set before startThread()
+		PO_TRANSPORT_THREAD,
+
+		/// Long value that, when positive, moves the class to HTTP/2
+		/// where TLS negotiation offers it.  Requests to a host are
+		/// multiplexed as streams over one connection with stream
+		/// weights taken from request priorities.  The value limits
+		/// the class's concurrent streams and replaces the
+		/// PO_CONNECTION_LIMIT/PO_PIPELINING_DEPTH in-flight limit.
+		/// Zero, the default, keeps HTTP/1.1 connections.  Needs a
+		/// libcurl built with HTTP/2, otherwise ignored.
+		///
+		/// Per-class only
+		PO_HTTP2_STREAMS,
+
 		PO_LAST  // Always at end
 	};
 
@@ -46,6 +46,7 @@
 #include "test_httprequest.hpp"
 #include "test_httpheaders.hpp"
 #include "test_httprequestqueue.hpp"
+#include "test_httpreadyqueue.hpp"
 
 #include "llsd.h"
 #include "lldate.h"
@@ -70,7 +70,9 @@ struct Block
 
 #define TRACE_MSG(val) std::cout << __FUNCTION__ << "(" << val << ") [" << __FILE__ << ":" << __LINE__ << "]" << std::endl;
 
-static unsigned char MemBuf[ 4096 * 1024 ];
+// Never reused, so sized for every allocation made by the whole run
+// including the ready queue stress test.
+static unsigned char MemBuf[ 128 * 1024 * 1024 ];
 Block * pNext = static_cast<Block *>(static_cast<void *>(MemBuf));
 volatile std::size_t MemTotal = 0;
 
@@ -30,6 +30,8 @@
 
 #include <iostream>
 
+#include "llmemory.h"
+
 #include "test_allocator.h"
 
 
@@ -426,6 +428,113 @@ void BufferArrayTestObjectType::test<8>()
 	ensure("All memory released", mMemTotal == GetMemTotal());
 }
 
+template <> template <>
+void BufferArrayTestObjectType::test<9>()
+{
+	set_test_name("BufferArray reserve and adoptData");
+
+	// record the total amount of dynamically allocated memory
+	mMemTotal = GetMemTotal();
+
+	// create a new ref counted object with an implicit reference
+	BufferArray * ba = new BufferArray();
+
+	size_t len(0);
+	ensure("Nothing to adopt when empty", NULL == ba->adoptData(&len));
+
+	// Reserved storage takes the whole body in one block
+	char str1[] = "abcdefghij";
+	size_t str1_len(strlen(str1));
+	ba->reserve(3 * str1_len);
+	ensure("Reserve doesn't change size", 0 == ba->size());
+	ba->append(str1, str1_len);
+	ba->append(str1, str1_len);
+	ba->append(str1, str1_len);
+
+	char * data(static_cast<char *>(ba->adoptData(&len)));
+	ensure("Reserved body adopted", NULL != data);
+	ensure("Adopted length correct", 3 * str1_len == len);
+	ensure("Adopted content correct", 0 == strncmp(data, str1, str1_len)
+		   && 0 == strncmp(data + 2 * str1_len, str1, str1_len));
+	ensure("Empty after adoption", 0 == ba->size());
+	ll_aligned_free_16(data);
+
+	// Body that outgrew its reservation must be copied
+	ba->reserve(str1_len);
+	ba->append(str1, str1_len);
+	ba->appendBufferAlloc(str1_len);
+	ensure("Scattered body not adopted", NULL == ba->adoptData(&len));
+	ensure("Scattered body intact", 2 * str1_len == ba->size());
+
+	// reserve() is ignored once there's data
+	ba->reserve(BufferArray::BLOCK_ALLOC_SIZE * 2);
+	ensure("Reserve on data harmless", 2 * str1_len == ba->size());
+
+	// release the implicit reference, causing the object to be released
+	ba->release();
+
+	// Small body in a full-sized block isn't worth adopting
+	ba = new BufferArray();
+	ba->append(str1, str1_len);
+	ensure("Mostly empty slab not adopted", NULL == ba->adoptData(&len));
+	ba->release();
+	
+	// make sure we didn't leak any memory
+	ensure("All memory released", mMemTotal == GetMemTotal());
+}
+
+template <> template <>
+void BufferArrayTestObjectType::test<10>()
+{
+	set_test_name("BufferArray slab pool");
+
+	BufferArray::SlabStats start_stats;
+	BufferArray::getSlabStats(start_stats);
+	ensure("Pool disabled by default", 0 == start_stats.mPoolLimit && 0 == start_stats.mPooledBytes);
+
+	// Two slabs worth of room
+	BufferArray::setSlabPoolLimit(2 * BufferArray::BLOCK_ALLOC_SIZE);
+
+	// Three slabs in use, only two come back to the pool
+	BufferArray * ba = new BufferArray();
+	ba->appendBufferAlloc(BufferArray::BLOCK_ALLOC_SIZE);
+	ba->appendBufferAlloc(BufferArray::BLOCK_ALLOC_SIZE);
+	ba->appendBufferAlloc(BufferArray::BLOCK_ALLOC_SIZE);
+	ba->release();
+
+	BufferArray::SlabStats stats;
+	BufferArray::getSlabStats(stats);
+	ensure("Three slabs allocated", start_stats.mSlabAllocs + 3 == stats.mSlabAllocs);
+	ensure("Pool capped", 2 * BufferArray::BLOCK_ALLOC_SIZE == stats.mPooledBytes);
+
+	// Next slabs come from the pool
+	ba = new BufferArray();
+	char str1[] = "abcdefghij";
+	ba->append(str1, strlen(str1));
+	BufferArray::getSlabStats(stats);
+	ensure("Slab reused", start_stats.mPoolHits + 1 == stats.mPoolHits);
+	ensure("Pool shrinks", BufferArray::BLOCK_ALLOC_SIZE == stats.mPooledBytes);
+
+	// Adopted slabs leave the pool for good
+	void * fill(ba->appendBufferAlloc(BufferArray::BLOCK_ALLOC_SIZE - strlen(str1)));
+	ensure("Fill allocated", NULL != fill);
+	ba->release();
+	ba = new BufferArray();
+	ba->appendBufferAlloc(BufferArray::BLOCK_ALLOC_SIZE);
+	size_t len(0);
+	void * data(ba->adoptData(&len));
+	ensure("Full slab adopted", NULL != data && BufferArray::BLOCK_ALLOC_SIZE == len);
+	ll_aligned_free_16(data);
+	ba->release();
+	BufferArray::getSlabStats(stats);
+	ensure("Adoption counted", start_stats.mAdopted + 1 == stats.mAdopted);
+
+	// Lowering the limit frees what's pooled
+	BufferArray::setSlabPoolLimit(0);
+	BufferArray::getSlabStats(stats);
+	ensure("Pool emptied", 0 == stats.mPooledBytes);
+}
+
 }  // end namespace tut
 
 
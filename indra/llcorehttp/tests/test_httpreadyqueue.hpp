@@ -0,0 +1,255 @@
+/** 
+ * @file test_httpreadyqueue.hpp
+ * @brief unit tests for the LLCore::HttpReadyQueue class
+ *
+ * $LicenseInfo:firstyear=2012&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2012, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#ifndef TEST_LLCORE_HTTP_READYQUEUE_H_
+#define TEST_LLCORE_HTTP_READYQUEUE_H_
+
+#include "_httpreadyqueue.h"
+
+#include <iostream>
+#include <vector>
+#include <unordered_map>
+
+#include "test_allocator.h"
+
+
+using namespace LLCore;
+
+
+
+namespace tut
+{
+
+struct HttpReadyqueueTestData
+{
+	// the test objects inherit from this so the member functions and variables
+	// can be referenced directly inside of the test functions.
+	size_t mMemTotal;
+};
+
+typedef test_group<HttpReadyqueueTestData> HttpReadyqueueTestGroupType;
+typedef HttpReadyqueueTestGroupType::object HttpReadyqueueTestObjectType;
+HttpReadyqueueTestGroupType HttpReadyqueueTestGroup("HttpReadyqueue Tests");
+
+namespace
+{
+
+HttpOpRequest::ptr_t make_ready_op(HttpRequest::priority_t priority)
+{
+	HttpOpRequest::ptr_t op(new HttpOpRequest());
+	op->mReqPriority = priority;
+	return op;
+}
+
+// Mirrors the queue's ordering from priorities and the order
+// requests were queued or last reprioritized.
+bool ready_before(HttpRequest::priority_t lhs_priority, U64 lhs_seq,
+				  HttpRequest::priority_t rhs_priority, U64 rhs_seq)
+{
+#if ! LLCORE_HTTP_READY_QUEUE_IGNORES_PRIORITY
+	if (lhs_priority != rhs_priority)
+	{
+		return lhs_priority > rhs_priority;
+	}
+#endif // ! LLCORE_HTTP_READY_QUEUE_IGNORES_PRIORITY
+	return lhs_seq < rhs_seq;
+}
+
+}  // end anonymous namespace
+
+template <> template <>
+void HttpReadyqueueTestObjectType::test<1>()
+{
+	set_test_name("HttpReadyQueue push/pop order");
+
+	// record the total amount of dynamically allocated memory
+	mMemTotal = GetMemTotal();
+
+	{
+		HttpReadyQueue rq;
+		ensure("Empty on construction", rq.empty());
+
+		HttpOpRequest::ptr_t op1(make_ready_op(10));
+		HttpOpRequest::ptr_t op2(make_ready_op(30));
+		HttpOpRequest::ptr_t op3(make_ready_op(30));
+		rq.push(op1);
+		rq.push(op2);
+		rq.push(op3);
+		ensure("Three queued", 3 == rq.size());
+		ensure("Queued request found", rq.contains(op2->getHandle()));
+
+#if LLCORE_HTTP_READY_QUEUE_IGNORES_PRIORITY
+		ensure("First in, first out", rq.top() == op1);
+		rq.pop();
+		ensure("Second out", rq.top() == op2);
+		rq.pop();
+#else
+		ensure("Highest priority first", rq.top() == op2);
+		rq.pop();
+		ensure("Equal priority in order queued", rq.top() == op3);
+		rq.pop();
+#endif // LLCORE_HTTP_READY_QUEUE_IGNORES_PRIORITY
+		ensure("Popped request gone", ! rq.contains(op2->getHandle()));
+		rq.pop();
+		ensure("Empty after pops", rq.empty());
+	}
+
+	// make sure we didn't leak any memory
+	ensure("All memory returned", mMemTotal == GetMemTotal());
+}
+
+template <> template <>
+void HttpReadyqueueTestObjectType::test<2>()
+{
+	set_test_name("HttpReadyQueue changePriority/remove by handle");
+
+	// record the total amount of dynamically allocated memory
+	mMemTotal = GetMemTotal();
+
+	{
+		HttpReadyQueue rq;
+
+		HttpOpRequest::ptr_t op1(make_ready_op(10));
+		HttpOpRequest::ptr_t op2(make_ready_op(20));
+		HttpOpRequest::ptr_t op3(make_ready_op(30));
+		HttpOpRequest::ptr_t stranger(make_ready_op(40));
+		rq.push(op1);
+		rq.push(op2);
+		rq.push(op3);
+
+		ensure("Unqueued request not changed", ! rq.changePriority(stranger->getHandle(), 50));
+		ensure("Unqueued request not removed", ! rq.remove(stranger->getHandle()));
+
+		// Reprioritized request goes behind its new equals
+		ensure("Priority changed", rq.changePriority(op1->getHandle(), 30));
+		ensure("New priority recorded", 30 == op1->mReqPriority);
+#if LLCORE_HTTP_READY_QUEUE_IGNORES_PRIORITY
+		ensure("Reprioritized request at the back", rq.top() == op2);
+#else
+		ensure("Reprioritized request behind equals", rq.top() == op3);
+#endif // LLCORE_HTTP_READY_QUEUE_IGNORES_PRIORITY
+
+		HttpOpRequest::ptr_t removed(rq.remove(op2->getHandle()));
+		ensure("Removed request returned", removed == op2);
+		ensure("Two left", 2 == rq.size());
+		ensure("Removed request gone", ! rq.contains(op2->getHandle()));
+
+		rq.pop();
+		ensure("Last one", rq.top() == op1);
+		rq.pop();
+		ensure("Empty", rq.empty());
+	}
+
+	// make sure we didn't leak any memory
+	ensure("All memory returned", mMemTotal == GetMemTotal());
+}
+
+template <> template <>
+void HttpReadyqueueTestObjectType::test<3>()
+{
+	set_test_name("HttpReadyQueue 50k request stress");
+
+	// record the total amount of dynamically allocated memory
+	mMemTotal = GetMemTotal();
+
+	{
+		static const size_t OP_COUNT(50000);
+		
+		HttpReadyQueue rq;
+		std::vector<HttpOpRequest::ptr_t> ops;
+		std::vector<U64> seqs(OP_COUNT, 0);
+		std::unordered_map<HttpHandle, size_t> indexes;
+		std::vector<bool> removed(OP_COUNT, false);
+		U64 next_seq(0);
+
+		// Fixed LCG so failures reproduce
+		U32 rand_state(12345);
+		auto next_rand = [&rand_state]()
+			{
+				rand_state = rand_state * 1664525U + 1013904223U;
+				return rand_state >> 8;
+			};
+
+		ops.reserve(OP_COUNT);
+		for (size_t i(0); i < OP_COUNT; ++i)
+		{
+			HttpOpRequest::ptr_t op(make_ready_op(next_rand() % 1000));
+			ops.push_back(op);
+			indexes[op->getHandle()] = i;
+			seqs[i] = next_seq++;
+			rq.push(op);
+		}
+		ensure_equals("All queued", rq.size(), OP_COUNT);
+
+		// Camera movement:  reprioritize everything, some twice
+		for (size_t i(0); i < OP_COUNT + OP_COUNT / 2; ++i)
+		{
+			const size_t index(next_rand() % OP_COUNT);
+			ensure("Reprioritized", rq.changePriority(ops[index]->getHandle(), next_rand() % 1000));
+			seqs[index] = next_seq++;
+		}
+
+		// Cancel a fifth of them
+		size_t removed_count(0);
+		for (size_t i(0); i < OP_COUNT / 5; ++i)
+		{
+			const size_t index(next_rand() % OP_COUNT);
+			HttpOpRequest::ptr_t op(rq.remove(ops[index]->getHandle()));
+			ensure("Removed only once", removed[index] != static_cast<bool>(op));
+			if (op)
+			{
+				removed[index] = true;
+				++removed_count;
+			}
+		}
+		ensure_equals("Removals counted", rq.size(), OP_COUNT - removed_count);
+
+		// Drain and check the order
+		size_t drained(0);
+		size_t last_index(OP_COUNT);
+		while (! rq.empty())
+		{
+			const size_t index(indexes[rq.top()->getHandle()]);
+			ensure("Removed request not drained", ! removed[index]);
+			if (OP_COUNT != last_index)
+			{
+				ensure("Drained in order", ! ready_before(ops[index]->mReqPriority, seqs[index],
+														  ops[last_index]->mReqPriority, seqs[last_index]));
+			}
+			last_index = index;
+			rq.pop();
+			++drained;
+		}
+		ensure_equals("Everything else drained", drained, OP_COUNT - removed_count);
+	}
+
+	// make sure we didn't leak any memory
+	ensure("All memory returned", mMemTotal == GetMemTotal());
+}
+
+}  // end namespace tut
+
+
+#endif  // TEST_LLCORE_HTTP_READYQUEUE_H_
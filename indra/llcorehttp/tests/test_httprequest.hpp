@@ -3217,6 +3217,233 @@ void HttpRequestTestObjectType::test<23>()
 }
 
 
+template <> template <>
+void HttpRequestTestObjectType::test<24>()
+{
+	ScopedCurlInit ready;
+
+	std::string url_base(get_base_url());
+	
+	set_test_name("HttpRequest GET on a transport thread");
+
+	// Handler can be stack-allocated *if* there are no dangling
+	// references to it after completion of this method.
+	// Create before memory record as the string copy will bump numbers.
+	TestHandler2 handler(this, "handler");
+    LLCore::HttpHandler::ptr_t handlerp(&handler, NoOpDeletor);
+
+	mHandlerCalls = 0;
+
+	HttpRequest * req = NULL;
+
+	try
+	{
+        // Get singletons created
+		HttpRequest::createService();
+
+		// Move a new class onto a transport thread of its own
+		HttpRequest::policy_t policy(HttpRequest::createPolicyClass());
+		ensure("Policy class created", policy != HttpRequest::INVALID_POLICY_ID);
+		long thread(0L);
+		HttpStatus status = HttpRequest::setStaticPolicyOption(HttpRequest::PO_TRANSPORT_THREAD,
+															   policy,
+															   1L,
+															   &thread);
+		ensure("Transport thread set", bool(status));
+		ensure("Transport thread value", 1L == thread);
+		
+		HttpRequest::startThread();
+
+		// Not dynamic
+		status = HttpRequest::setStaticPolicyOption(HttpRequest::PO_TRANSPORT_THREAD,
+													policy,
+													0L,
+													NULL);
+		ensure("Transport thread can't change once running", ! status);
+
+		// create a new ref counted object with an implicit reference
+		req = new HttpRequest();
+
+		// One GET on each thread
+		mStatus = HttpStatus(200);
+		HttpHandle handle = req->requestGet(policy,
+											0U,
+											url_base,
+											HttpOptions::ptr_t(),
+                                            HttpHeaders::ptr_t(),
+											handlerp);
+		ensure("Valid handle returned for transport thread request", handle != LLCORE_HTTP_HANDLE_INVALID);
+		handle = req->requestGet(HttpRequest::DEFAULT_POLICY_ID,
+								 0U,
+								 url_base,
+								 HttpOptions::ptr_t(),
+								 HttpHeaders::ptr_t(),
+								 handlerp);
+		ensure("Valid handle returned for service thread request", handle != LLCORE_HTTP_HANDLE_INVALID);
+
+		// Run the notification pump.
+		int count(0);
+		int limit(LOOP_COUNT_LONG);
+		while (count++ < limit && mHandlerCalls < 2)
+		{
+			req->update(1000000);
+			usleep(LOOP_SLEEP_INTERVAL);
+		}
+		ensure("Requests executed in reasonable time", count < limit);
+		ensure("One handler invocation for each request", mHandlerCalls == 2);
+
+		// Okay, request a shutdown of the servicing threads
+		mStatus = HttpStatus();
+		handle = req->requestStopThread(handlerp);
+		ensure("Valid handle returned for stop request", handle != LLCORE_HTTP_HANDLE_INVALID);
+	
+		// Run the notification pump again
+		count = 0;
+		limit = LOOP_COUNT_LONG;
+		while (count++ < limit && mHandlerCalls < 3)
+		{
+			req->update(1000000);
+			usleep(LOOP_SLEEP_INTERVAL);
+		}
+		ensure("Stop request executed in reasonable time", count < limit);
+		ensure("Stop handler invocation", mHandlerCalls == 3);
+
+		// See that we actually shutdown the thread
+		count = 0;
+		limit = LOOP_COUNT_SHORT;
+		while (count++ < limit && ! HttpService::isStopped())
+		{
+			usleep(LOOP_SLEEP_INTERVAL);
+		}
+		ensure("Thread actually stopped running", HttpService::isStopped());
+	
+		// release the request object
+		delete req;
+		req = NULL;
+
+		// Shut down service
+		HttpRequest::destroyService();
+	
+		ensure("Three handler calls on the way out", 3 == mHandlerCalls);
+	}
+	catch (...)
+	{
+		stop_thread(req);
+		delete req;
+		HttpRequest::destroyService();
+		throw;
+	}
+}
+
+
+template <> template <>
+void HttpRequestTestObjectType::test<25>()
+{
+	ScopedCurlInit ready;
+
+	std::string url_base(get_base_url());
+	
+	set_test_name("HttpRequest GET on an HTTP/2 class to an HTTP/1.1 service");
+
+	// Handler can be stack-allocated *if* there are no dangling
+	// references to it after completion of this method.
+	// Create before memory record as the string copy will bump numbers.
+	TestHandler2 handler(this, "handler");
+    LLCore::HttpHandler::ptr_t handlerp(&handler, NoOpDeletor);
+
+	mHandlerCalls = 0;
+
+	HttpRequest * req = NULL;
+
+	try
+	{
+        // Get singletons created
+		HttpRequest::createService();
+
+		long streams(0L);
+		HttpStatus status = HttpRequest::setStaticPolicyOption(HttpRequest::PO_HTTP2_STREAMS,
+															   HttpRequest::DEFAULT_POLICY_ID,
+															   1000L,
+															   &streams);
+		ensure("HTTP/2 streams set", bool(status));
+		ensure("HTTP/2 streams clamped", 256L == streams);
+		status = HttpRequest::setStaticPolicyOption(HttpRequest::PO_HTTP2_STREAMS,
+													HttpRequest::GLOBAL_POLICY_ID,
+													10L,
+													NULL);
+		ensure("HTTP/2 streams are per-class", ! status);
+		
+		HttpRequest::startThread();
+
+		// create a new ref counted object with an implicit reference
+		req = new HttpRequest();
+
+		// Cleartext stays on HTTP/1.1 and must still work
+		mStatus = HttpStatus(200);
+		for (int i(0); i < 3; ++i)
+		{
+			HttpHandle handle = req->requestGet(HttpRequest::DEFAULT_POLICY_ID,
+												0U,
+												url_base,
+												HttpOptions::ptr_t(),
+												HttpHeaders::ptr_t(),
+												handlerp);
+			ensure("Valid handle returned for request", handle != LLCORE_HTTP_HANDLE_INVALID);
+		}
+
+		// Run the notification pump.
+		int count(0);
+		int limit(LOOP_COUNT_LONG);
+		while (count++ < limit && mHandlerCalls < 3)
+		{
+			req->update(1000000);
+			usleep(LOOP_SLEEP_INTERVAL);
+		}
+		ensure("Requests executed in reasonable time", count < limit);
+		ensure("One handler invocation for each request", mHandlerCalls == 3);
+
+		// Okay, request a shutdown of the servicing thread
+		mStatus = HttpStatus();
+		HttpHandle handle = req->requestStopThread(handlerp);
+		ensure("Valid handle returned for stop request", handle != LLCORE_HTTP_HANDLE_INVALID);
+	
+		// Run the notification pump again
+		count = 0;
+		limit = LOOP_COUNT_LONG;
+		while (count++ < limit && mHandlerCalls < 4)
+		{
+			req->update(1000000);
+			usleep(LOOP_SLEEP_INTERVAL);
+		}
+		ensure("Stop request executed in reasonable time", count < limit);
+		ensure("Stop handler invocation", mHandlerCalls == 4);
+
+		// See that we actually shutdown the thread
+		count = 0;
+		limit = LOOP_COUNT_SHORT;
+		while (count++ < limit && ! HttpService::isStopped())
+		{
+			usleep(LOOP_SLEEP_INTERVAL);
+		}
+		ensure("Thread actually stopped running", HttpService::isStopped());
+	
+		// release the request object
+		delete req;
+		req = NULL;
+
+		// Shut down service
+		HttpRequest::destroyService();
+	}
+	catch (...)
+	{
+		stop_thread(req);
+		delete req;
+		HttpRequest::destroyService();
+		throw;
+	}
+}
+
+
 }  // end namespace tut
 
 namespace
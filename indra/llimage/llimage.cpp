@@ -30,6 +30,7 @@
 
 #include "llimageworker.h"
 #include "llimage.h"
+#include "llimagefilter.h"
 
 #include "llmath.h"
 #include "v4coloru.h"
@@ -44,6 +45,8 @@
 
 #include <boost/preprocessor.hpp>
 
+#include "llimagesimd.h"
+
 //..................................................................................
 //..................................................................................
 // Helper macrose's for generate cycle unwrap templates
@@ -220,15 +223,253 @@ private:
 	}
 };
 
+//..................................................................................
+// SSE2 pixel kernels
+//
+// SSE2 is the baseline for every supported build (see llsimdmath.h), builds
+// configured with USE_AVX2 also get 256 bit variants where they pay off.  All
+// integer kernels are bit-exact with the scalar paths above and below, the float
+// resamplers perform the same operations in the same order per channel.
+// LLImageRaw::setUseSIMD(false) switches back to the scalar code for reference.
+// The per lane helpers they are built from live in llimagesimd.h.
+//..................................................................................
 
-template<U8 ch>
+// Box filter over the input pixels spanning [index0 + 1 - fract0, index1 + fract1),
+// see LLImageRaw::copyLineScaled().
+inline __m128 resample_pixel_ps(const U8 *in, S32 stride, S32 components, S32 in_pixel_len,
+								S32 index0, S32 index1, F32 fract0, F32 fract1, F32 norm_factor)
+{
+	__m128 v = _mm_mul_ps(load_pixel_ps(in + index0 * stride, components), _mm_set1_ps(fract0));
+
+	for (S32 u = index0 + 1; u < index1; u++)
+	{
+		v = _mm_add_ps(v, load_pixel_ps(in + u * stride, components));
+	}
+
+	// Watch out for reading off of end of input array.
+	if (fract1 && index1 < in_pixel_len)
+	{
+		v = _mm_add_ps(v, _mm_mul_ps(load_pixel_ps(in + index1 * stride, components), _mm_set1_ps(fract1)));
+	}
+
+	return _mm_mul_ps(v, _mm_set1_ps(norm_factor));
+}
+
+// Composites 4 component src pixels onto 3 component dst pixels and returns how
+// many were done.  The dst pixels are moved as 4 byte words that reach into the
+// following pixel, so the last one is always left to the scalar loop.  That extra
+// byte gets an alpha of 0 and is written back unchanged before its own pixel is.
+static S32 composite_4onto3_simd(const U8 *src, U8 *dst, S32 pixels)
+{
+	S32 done = 0;
+	U32 words[4];
+
+#if defined(__AVX2__)
+	{
+		const __m256i ff = _mm256_set1_epi16(255);
+		const __m256i rgb_mask = _mm256_setr_epi16(-1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1, 0);
+
+		for (; done + 4 < pixels; done += 4, src += 16, dst += 12)
+		{
+			memcpy(&words[0], dst, 4);
+			memcpy(&words[1], dst + 3, 4);
+			memcpy(&words[2], dst + 6, 4);
+			memcpy(&words[3], dst + 9, 4);
+
+			__m256i s = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)src));
+			__m256i d = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)words));
+			__m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+			a = _mm256_and_si256(a, rgb_mask);
+
+			__m256i r = _mm256_add_epi16(fast_fractional_mult_epi16(d, _mm256_sub_epi16(ff, a)), fast_fractional_mult_epi16(s, a));
+			r = _mm256_packus_epi16(r, r);
+			__m128i lo = _mm256_castsi256_si128(r);
+			__m128i hi = _mm256_extracti128_si256(r, 1);
+
+			words[0] = _mm_cvtsi128_si32(lo);
+			words[1] = _mm_cvtsi128_si32(_mm_srli_si128(lo, 4));
+			words[2] = _mm_cvtsi128_si32(hi);
+			words[3] = _mm_cvtsi128_si32(_mm_srli_si128(hi, 4));
+			memcpy(dst, &words[0], 4);
+			memcpy(dst + 3, &words[1], 4);
+			memcpy(dst + 6, &words[2], 4);
+			memcpy(dst + 9, &words[3], 4);
+		}
+	}
+#endif
+
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i ff = _mm_set1_epi16(255);
+	const __m128i rgb_mask = _mm_setr_epi16(-1, -1, -1, 0, -1, -1, -1, 0);
+
+	for (; done + 2 < pixels; done += 2, src += 8, dst += 6)
+	{
+		memcpy(&words[0], dst, 4);
+		memcpy(&words[1], dst + 3, 4);
+
+		__m128i s = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)src), zero);
+		__m128i d = _mm_unpacklo_epi8(_mm_unpacklo_epi32(_mm_cvtsi32_si128(words[0]), _mm_cvtsi32_si128(words[1])), zero);
+		__m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+		a = _mm_and_si128(a, rgb_mask);
+
+		__m128i r = _mm_add_epi16(fast_fractional_mult_epi16(d, _mm_sub_epi16(ff, a)), fast_fractional_mult_epi16(s, a));
+		r = _mm_packus_epi16(r, r);
+
+		words[0] = _mm_cvtsi128_si32(r);
+		words[1] = _mm_cvtsi128_si32(_mm_srli_si128(r, 4));
+		memcpy(dst, &words[0], 4);
+		memcpy(dst + 3, &words[1], 4);
+	}
+
+	return done;
+}
+
+//..................................................................................
+// SSE2 versions of the 4 channel unrolled loops used by bilinear_scale(), one
+// pixel per register.
+//..................................................................................
+struct sse2_zeroze_cx_comp
+{
+	inline void operator()(S32 *cx, S32 *comp)
+	{
+		_mm_storeu_si128((__m128i*)cx, _mm_setzero_si128());
+		_mm_storeu_si128((__m128i*)comp, _mm_setzero_si128());
+	}
+};
+
+struct sse2_comp_rshftasgn_constval
+{
+	inline void operator()(S32 *comp, const S32 cval)
+	{
+		__m128i c = _mm_loadu_si128((const __m128i*)comp);
+		_mm_storeu_si128((__m128i*)comp, _mm_sra_epi32(c, _mm_cvtsi32_si128(cval)));
+	}
+};
+
+struct sse2_comp_asgn_cx_rshft_cval_all_mul_val
+{
+	inline void operator()(S32 *comp, S32 *cx, const S32 cval, S32 val)
+	{
+		__m128i x = _mm_sra_epi32(_mm_loadu_si128((const __m128i*)cx), _mm_cvtsi32_si128(cval));
+		_mm_storeu_si128((__m128i*)comp, ll_mullo_epi32(x, _mm_set1_epi32(val)));
+	}
+};
+
+struct sse2_comp_plusasgn_cx_rshft_cval_all_mul_val
+{
+	inline void operator()(S32 *comp, S32 *cx, const S32 cval, S32 val)
+	{
+		__m128i x = _mm_sra_epi32(_mm_loadu_si128((const __m128i*)cx), _mm_cvtsi32_si128(cval));
+		__m128i c = _mm_loadu_si128((const __m128i*)comp);
+		_mm_storeu_si128((__m128i*)comp, _mm_add_epi32(c, ll_mullo_epi32(x, _mm_set1_epi32(val))));
+	}
+};
+
+struct sse2_inp_plusasgn_pix_mul_val
+{
+	inline void operator()(S32 *comp, const U8 *pix, S32 val)
+	{
+		__m128i c = _mm_loadu_si128((const __m128i*)comp);
+		_mm_storeu_si128((__m128i*)comp, _mm_add_epi32(c, ll_mullo_epi32(load_pixel_epi32(pix), _mm_set1_epi32(val))));
+	}
+};
+
+struct sse2_inp_asgn_pix_mul_val
+{
+	inline void operator()(S32 *comp, const U8 *pix, S32 val)
+	{
+		_mm_storeu_si128((__m128i*)comp, ll_mullo_epi32(load_pixel_epi32(pix), _mm_set1_epi32(val)));
+	}
+};
+
+struct sse2_comp_asgn_cx_mul_apoint_plus_comp_mul_inv_apoint_allshifted_16_r
+{
+	inline void operator()(S32 *comp, S32 *cx, S32 apoint)
+	{
+		__m128i x = ll_mullo_epi32(_mm_loadu_si128((const __m128i*)cx), _mm_set1_epi32(apoint));
+		__m128i c = ll_mullo_epi32(_mm_loadu_si128((const __m128i*)comp), _mm_set1_epi32(256 - apoint));
+		_mm_storeu_si128((__m128i*)comp, _mm_srai_epi32(_mm_add_epi32(x, c), 16));
+	}
+};
+
+struct sse2_comp_asgn_comp_plus_pix_mul_apoint_allshifted_8_r
+{
+	inline void operator()(S32 *comp, const U8 *pix, S32 apoint)
+	{
+		__m128i c = _mm_loadu_si128((const __m128i*)comp);
+		c = _mm_add_epi32(c, ll_mullo_epi32(load_pixel_epi32(pix), _mm_set1_epi32(apoint)));
+		_mm_storeu_si128((__m128i*)comp, _mm_srai_epi32(c, 8));
+	}
+};
+
+struct sse2_comp_asgn_comp_mul_inv_apoint_plus_cx_mul_apoint_allshifted_12_r
+{
+	inline void operator()(S32 *comp, S32 apoint, S32 *cx)
+	{
+		__m128i c = ll_mullo_epi32(_mm_loadu_si128((const __m128i*)comp), _mm_set1_epi32(256 - apoint));
+		__m128i x = ll_mullo_epi32(_mm_loadu_si128((const __m128i*)cx), _mm_set1_epi32(apoint));
+		_mm_storeu_si128((__m128i*)comp, _mm_srai_epi32(_mm_add_epi32(c, x), 12));
+	}
+};
+
+struct sse2_uref_dptr_inc_asgn_comp_and_ff
+{
+	inline void operator()(U8 *&dptr, S32 *comp)
+	{
+		store_pixel_epi32(dptr, _mm_loadu_si128((const __m128i*)comp));
+		dptr += 4;
+	}
+};
+
+struct sse2_uref_dptr_inc_asgn_sptr_apoint_plus_idx_alland_ff
+{
+	inline void operator()(U8 *&dptr, const U8 *sptr, S32 apoint)
+	{
+		memcpy(dptr, sptr + apoint, 4);
+		dptr += 4;
+	}
+};
+
+struct sse2_uref_dptr_inc_asgn_comp_rshft_cval_and_ff
+{
+	inline void operator()(U8 *&dptr, S32 *comp, const S32 cval)
+	{
+		__m128i c = _mm_loadu_si128((const __m128i*)comp);
+		store_pixel_epi32(dptr, _mm_sra_epi32(c, _mm_cvtsi32_si128(cval)));
+		dptr += 4;
+	}
+};
+
+struct scale_info_sse2 : public scale_info<4>
+{
+public:
+	typedef sse2_zeroze_cx_comp																uroll_zeroze_cx_comp_t;
+	typedef sse2_comp_rshftasgn_constval													uroll_comp_rshftasgn_constval_t;
+	typedef sse2_comp_asgn_cx_rshft_cval_all_mul_val										uroll_comp_asgn_cx_rshft_cval_all_mul_val_t;
+	typedef sse2_comp_plusasgn_cx_rshft_cval_all_mul_val									uroll_comp_plusasgn_cx_rshft_cval_all_mul_val_t;
+	typedef sse2_inp_plusasgn_pix_mul_val													uroll_inp_plusasgn_pix_mul_val_t;
+	typedef sse2_inp_asgn_pix_mul_val														uroll_inp_asgn_pix_mul_val_t;
+	typedef sse2_comp_asgn_cx_mul_apoint_plus_comp_mul_inv_apoint_allshifted_16_r			uroll_comp_asgn_cx_mul_apoint_plus_comp_mul_inv_apoint_allshifted_16_r_t;
+	typedef sse2_comp_asgn_comp_plus_pix_mul_apoint_allshifted_8_r							uroll_comp_asgn_comp_plus_pix_mul_apoint_allshifted_8_r_t;
+	typedef sse2_comp_asgn_comp_mul_inv_apoint_plus_cx_mul_apoint_allshifted_12_r			uroll_comp_asgn_comp_mul_inv_apoint_plus_cx_mul_apoint_allshifted_12_r_t;
+	typedef sse2_uref_dptr_inc_asgn_comp_and_ff												uroll_uref_dptr_inc_asgn_comp_and_ff_t;
+	typedef sse2_uref_dptr_inc_asgn_sptr_apoint_plus_idx_alland_ff							uroll_uref_dptr_inc_asgn_sptr_apoint_plus_idx_alland_ff_t;
+	typedef sse2_uref_dptr_inc_asgn_comp_rshft_cval_and_ff									uroll_uref_dptr_inc_asgn_comp_rshft_cval_and_ff_t;
+
+public:
+	scale_info_sse2(const U8 *src, U32 srcW, U32 srcH, U32 dstW, U32 dstH, U32 srcStride)
+		: scale_info<4>(src, srcW, srcH, dstW, dstH, srcStride)
+	{
+	}
+};
+
+
+template<U8 ch, class scale_info_t>
 inline void bilinear_scale(
 	const U8 *src, U32 srcW, U32 srcH, U32 srcStride
 	, U8 *dst, U32 dstW, U32 dstH, U32 dstStride
 	)
 {
-	typedef scale_info<ch> scale_info_t;
-
 	scale_info_t info(src, srcW, srcH, dstW, dstH, srcStride);
 
 	const U8 *sptr;
@@ -566,13 +807,20 @@ static void bilinear_scale(const U8 *src, U32 srcW, U32 srcH, U32 srcCh, U32 src
 	switch(srcCh)
 	{
 	case 1:
-		bilinear_scale<1>(src, srcW, srcH, srcStride, dst, dstW, dstH, dstStride);
+		bilinear_scale<1, scale_info<1> >(src, srcW, srcH, srcStride, dst, dstW, dstH, dstStride);
 		break;
 	case 3:
-		bilinear_scale<3>(src, srcW, srcH, srcStride, dst, dstW, dstH, dstStride);
+		bilinear_scale<3, scale_info<3> >(src, srcW, srcH, srcStride, dst, dstW, dstH, dstStride);
 		break;
 	case 4:
-		bilinear_scale<4>(src, srcW, srcH, srcStride, dst, dstW, dstH, dstStride);
+		if (LLImageRaw::useSIMD())
+		{
+			bilinear_scale<4, scale_info_sse2>(src, srcW, srcH, srcStride, dst, dstW, dstH, dstStride);
+		}
+		else
+		{
+			bilinear_scale<4, scale_info<4> >(src, srcW, srcH, srcStride, dst, dstW, dstH, dstStride);
+		}
 		break;
 	default:
 		llassert(!"Implement if need");
@@ -597,11 +845,13 @@ void LLImage::initClass(bool use_new_byte_range, S32 minimal_reverse_byte_range_
 	sUseNewByteRange = use_new_byte_range;
     sMinimalReverseByteRangePercent = minimal_reverse_byte_range_percent;
 	sMutex = new LLMutex();
+	LLImageFilter::initClass();
 }
 
 //static
 void LLImage::cleanupClass()
 {
+	LLImageFilter::cleanupClass();
 	delete sMutex;
 	sMutex = nullptr;
 }
@@ -802,6 +1052,7 @@ U8* LLImageBase::allocateDataSize(S32 width, S32 height, S32 ncomponents, S32 si
 
 S32 LLImageRaw::sGlobalRawMemory = 0;
 S32 LLImageRaw::sRawImageCount = 0;
+bool LLImageRaw::sUseSIMD = true;
 
 LLImageRaw::LLImageRaw()
 	: LLImageBase()
@@ -1137,6 +1388,13 @@ void LLImageRaw::compositeUnscaled4onto3( LLImageRaw* src )
 	U8* src_data = src->getData();
 	U8* dst_data = dst->getData();
 	S32 pixels = getWidth() * getHeight();
+	if (sUseSIMD)
+	{
+		S32 done = composite_4onto3_simd(src_data, dst_data, pixels);
+		src_data += done * 4;
+		dst_data += done * 3;
+		pixels -= done;
+	}
 	while( pixels-- )
 	{
 		U8 alpha = src_data[3];
@@ -1498,6 +1756,34 @@ void LLImageRaw::copyLineScaled( U8* in, U8* out, S32 in_pixel_len, S32 out_pixe
 	const F32 ratio = F32(in_pixel_len) / out_pixel_len; // ratio of old to new
 	const F32 norm_factor = 1.f / ratio;
 
+	if (sUseSIMD && components >= 3)
+	{
+		const S32 in_stride = in_pixel_step * components;
+		for( S32 x = 0; x < out_pixel_len; x++ )
+		{
+			const F32 sample0 = x * ratio;
+			const F32 sample1 = (x+1) * ratio;
+			const S32 index0 = llfloor(sample0);
+			const S32 index1 = llfloor(sample1);
+			U8* outp = out + x * out_pixel_step * components;
+
+			if( index0 == index1 )
+			{
+				memcpy(outp, in + index0 * in_stride, components);	/* Flawfinder: ignore */
+			}
+			else
+			{
+				const F32 fract0 = 1.f - (sample0 - F32(index0));
+				const F32 fract1 = sample1 - F32(index1);
+				__m128 v = resample_pixel_ps(in, in_stride, components, in_pixel_len, index0, index1, fract0, fract1, norm_factor);
+				U8 pixel[4];
+				store_pixel_epi32(pixel, round_ps_epi32(v));
+				memcpy(outp, pixel, components);	/* Flawfinder: ignore */
+			}
+		}
+		return;
+	}
+
 	S32 goff = components >= 2 ? 1 : 0;
 	S32 boff = components >= 3 ? 2 : 0;
 	for( S32 x = 0; x < out_pixel_len; x++ )
@@ -1615,6 +1901,48 @@ void LLImageRaw::compositeRowScaled4onto3( U8* in, U8* out, S32 in_pixel_len, S3
 	const F32 ratio = F32(in_pixel_len) / out_pixel_len; // ratio of old to new
 	const F32 norm_factor = 1.f / ratio;
 
+	if (sUseSIMD)
+	{
+		// Resample the whole row first, then composite it like an unscaled image.
+		std::vector<U8> scaled(out_pixel_len * IN_COMPONENTS);
+		U8* scaled_data = &scaled[0];
+		for( S32 x = 0; x < out_pixel_len; x++ )
+		{
+			const F32 sample0 = x * ratio;
+			const F32 sample1 = (x+1) * ratio;
+			const S32 index0 = S32(sample0);
+			const S32 index1 = S32(sample1);
+
+			if( index0 == index1 )
+			{
+				// Same as below, every channel takes the first input channel.
+				memset(scaled_data + x * IN_COMPONENTS, in[index0 * IN_COMPONENTS], IN_COMPONENTS);
+			}
+			else
+			{
+				const F32 fract0 = 1.f - (sample0 - F32(index0));
+				const F32 fract1 = sample1 - F32(index1);
+				__m128 v = resample_pixel_ps(in, IN_COMPONENTS, IN_COMPONENTS, in_pixel_len, index0, index1, fract0, fract1, norm_factor);
+				store_pixel_epi32(scaled_data + x * IN_COMPONENTS, round_ps_epi32(v));
+			}
+		}
+
+		S32 done = composite_4onto3_simd(scaled_data, out, out_pixel_len);
+		for( S32 x = done; x < out_pixel_len; x++ )
+		{
+			const U8* pixel = scaled_data + x * IN_COMPONENTS;
+			U8* outp = out + x * OUT_COMPONENTS;
+			if( pixel[3] )
+			{
+				U8 transparency = 255 - pixel[3];
+				outp[0] = fastFractionalMult( outp[0], transparency ) + fastFractionalMult( pixel[0], pixel[3] );
+				outp[1] = fastFractionalMult( outp[1], transparency ) + fastFractionalMult( pixel[1], pixel[3] );
+				outp[2] = fastFractionalMult( outp[2], transparency ) + fastFractionalMult( pixel[2], pixel[3] );
+			}
+		}
+		return;
+	}
+
 	for( S32 x = 0; x < out_pixel_len; x++ )
 	{
 		// Sample input pixels in range from sample0 to sample1.
@@ -273,8 +273,15 @@ public:
 	static S32 sGlobalRawMemory;
 	static S32 sRawImageCount;
 
+	// The SSE2/AVX2 scaling and compositing kernels are on by default.  Turning
+	// them off runs the scalar reference code, for testing and benchmarking.
+	static void setUseSIMD(bool use_simd) { sUseSIMD = use_simd; }
+	static bool useSIMD() { return sUseSIMD; }
+
 private:
 	bool validateSrcAndDst(std::string func, LLImageRaw* src, LLImageRaw* dst);
+
+	static bool sUseSIMD;
 };
 
 // Compressed representation of image.
@@ -36,24 +36,222 @@
 #include "m3math.h"
 #include "v3math.h"
 #include "llsdserialize.h"
+#include "llstl.h"
 #include "llstring.h"
+#include "llthread.h"
+
+#include <boost/thread.hpp>
+#include <emmintrin.h>
+
+//---------------------------------------------------------------------------
+// Band threads
+//---------------------------------------------------------------------------
+
+// Rows in each band handed out to a thread
+static const S32 BAND_ROWS = 16;
+
+// Threads the filter passes are spread over. They are started once by LLImageFilter::initClass() and sleep
+// between passes, the calling thread works on the bands along with them.
+class LLImageFilterThreads
+{
+public:
+    LLImageFilterThreads(U32 num_threads);
+    ~LLImageFilterThreads();
+
+    // Runs func over every band of rows, returns once they are all done. Returns false without running
+    // anything when there are no threads or another filter is using them.
+    bool run(S32 rows, const std::function<void(S32, S32)>& func);
+
+    bool hasPendingBands();
+
+private:
+    class BandThread : public LLThread
+    {
+    public:
+        BandThread(const std::string& name, LLImageFilterThreads* threads);
+
+    private:
+        bool runCondition() override;
+        void run() override;
+
+        LLImageFilterThreads* mThreads;
+    };
+
+    // Runs bands until none are left unclaimed
+    void runBands();
+
+    // Held for the whole of a run()
+    LLMutex mRunMutex;
+
+    // Guards the fields below
+    LLCondition mCondition;
+    const std::function<void(S32, S32)>* mFunc;
+    S32 mRows;
+    S32 mNumBands;
+    S32 mNextBand;
+    S32 mNumFinished;
+
+    std::vector<BandThread*> mThreads;
+};
+
+static LLImageFilterThreads* sFilterThreads = NULL;
+
+LLImageFilterThreads::LLImageFilterThreads(U32 num_threads) :
+    mFunc(NULL),
+    mRows(0),
+    mNumBands(0),
+    mNextBand(0),
+    mNumFinished(0)
+{
+    for (U32 i = 0; i < num_threads; i++)
+    {
+        BandThread* thread = new BandThread(llformat("imagefilter %d", i), this);
+        mThreads.push_back(thread);
+        thread->start();
+    }
+}
+
+LLImageFilterThreads::~LLImageFilterThreads()
+{
+    for (BandThread* thread : mThreads)
+    {
+        thread->shutdown();
+    }
+    std::for_each(mThreads.begin(), mThreads.end(), DeletePointer());
+    mThreads.clear();
+}
+
+bool LLImageFilterThreads::run(S32 rows, const std::function<void(S32, S32)>& func)
+{
+    if (mThreads.empty() || !mRunMutex.try_lock())
+    {
+        return false;
+    }
+
+    {
+        LLMutexLock lock(&mCondition);
+        mFunc = &func;
+        mRows = rows;
+        mNumBands = (rows + BAND_ROWS - 1) / BAND_ROWS;
+        mNextBand = 0;
+        mNumFinished = 0;
+    }
+    for (BandThread* thread : mThreads)
+    {
+        thread->wake();
+    }
+
+    runBands();
+
+    {
+        LLMutexLock lock(&mCondition);
+        while (mNumFinished < mNumBands)
+        {
+            mCondition.wait();
+        }
+        mFunc = NULL;
+        mNumBands = 0;
+        mNextBand = 0;
+    }
+    mRunMutex.unlock();
+    return true;
+}
+
+bool LLImageFilterThreads::hasPendingBands()
+{
+    LLMutexLock lock(&mCondition);
+    return mNextBand < mNumBands;
+}
+
+void LLImageFilterThreads::runBands()
+{
+    S32 num_run = 0;
+    while (true)
+    {
+        const std::function<void(S32, S32)>* func;
+        S32 rows;
+        S32 band;
+        {
+            LLMutexLock lock(&mCondition);
+            // Report the last band with the same lock that takes the next
+            mNumFinished += num_run;
+            if (num_run && (mNumFinished == mNumBands))
+            {
+                mCondition.broadcast();
+            }
+            if (mNextBand >= mNumBands)
+            {
+                return;
+            }
+            func = mFunc;
+            rows = mRows;
+            band = mNextBand++;
+        }
+
+        (*func)(band * BAND_ROWS, llmin(rows, (band + 1) * BAND_ROWS));
+        num_run = 1;
+    }
+}
+
+LLImageFilterThreads::BandThread::BandThread(const std::string& name, LLImageFilterThreads* threads) :
+    LLThread(name),
+    mThreads(threads)
+{
+}
+
+// virtual
+bool LLImageFilterThreads::BandThread::runCondition()
+{
+    // mDataLock is locked here; the bands have their own lock
+    return mThreads->hasPendingBands();
+}
+
+// virtual
+void LLImageFilterThreads::BandThread::run()
+{
+    while (true)
+    {
+        // Sleeps until run() wakes us with bands
+        checkPause();
+
+        if (isQuitting())
+        {
+            break;
+        }
+
+        mThreads->runBands();
+    }
+}
 
 //---------------------------------------------------------------------------
 // LLImageFilter
 //---------------------------------------------------------------------------
 
+//static
+void LLImageFilter::initClass()
+{
+    if (!sFilterThreads)
+    {
+        // Leave a core for the calling thread
+        U32 cores = boost::thread::hardware_concurrency();
+        sFilterThreads = new LLImageFilterThreads(cores > 1 ? cores - 1 : 0);
+    }
+}
+
+//static
+void LLImageFilter::cleanupClass()
+{
+    delete sFilterThreads;
+    sFilterThreads = NULL;
+}
+
 LLImageFilter::LLImageFilter(const std::string& file_path) :
     mFilterData(LLSD::emptyArray()),
     mImage(NULL),
     mHistoRed(NULL),
     mHistoGreen(NULL),
     mHistoBlue(NULL),
-    mHistoBrightness(NULL),
-    mStencilBlendMode(STENCIL_BLEND_MODE_BLEND),
-    mStencilShape(STENCIL_SHAPE_UNIFORM),
-    mStencilMin(0.0f),
-    mStencilMax(1.0f),
-    mStencilGamma(1.0f)
+    mHistoBrightness(NULL)
 {
     // Load filter description from file
 	llifstream filter_xml(file_path.c_str());
@@ -78,7 +276,6 @@ LLImageFilter::~LLImageFilter()
 /*
  *TODO 
  * Rename stencil to mask
- * Improve perf: use LUT for alpha blending in uniform case
  * Add gradient coloring as a filter
  */
 
@@ -89,6 +286,14 @@ LLImageFilter::~LLImageFilter()
 void LLImageFilter::executeFilter(LLPointer<LLImageRaw> raw_image)
 {
     mImage = raw_image;
+    mPixelOps.clear();
+
+    // The primitives read and write the red, green and blue channels of each pixel
+    if (mImage.isNull() || (mImage->getComponents() < 3))
+    {
+        LL_WARNS() << "Filters need an RGB or RGBA image, cannot execute filter" << LL_ENDL;
+        return;
+    }
     
 	//std::cout << "Filter : size = " << mFilterData.size() << std::endl;
 	for (S32 i = 0; i < mFilterData.size(); ++i)
@@ -271,93 +476,245 @@ void LLImageFilter::executeFilter(LLPointer<LLImageRaw> raw_image)
             LL_WARNS() << "Filter unknown, cannot execute filter command : " << filter_name << LL_ENDL;
         }
     }
+
+    // Apply whatever is still queued
+    flushPixelOps();
 }
 
 //============================================================================
 // Filter Primitives
 //============================================================================
 
-void LLImageFilter::blendStencil(F32 alpha, U8* pixel, U8 red, U8 green, U8 blue)
+// The primitives don't touch the image right away: per pixel operations are queued and applied
+// together in one pass by flushPixelOps(), convolve() flushes the queue since it reads neighbors.
+
+void LLImageFilter::colorCorrect(const U8* lut_red, const U8* lut_green, const U8* lut_blue)
 {
-    F32 inv_alpha = 1.0f - alpha;
-    switch (mStencilBlendMode)
+    PixelOp op;
+    op.mType = PixelOp::PIXEL_OP_LUT;
+    op.mStencil = mStencil;
+    op.mBlended = false;
+    memcpy(op.mLUT[VRED],   lut_red,   256);	/* Flawfinder: ignore */
+    memcpy(op.mLUT[VGREEN], lut_green, 256);	/* Flawfinder: ignore */
+    memcpy(op.mLUT[VBLUE],  lut_blue,  256);	/* Flawfinder: ignore */
+    queuePixelOp(op);
+}
+
+void LLImageFilter::colorTransform(const LLMatrix3 &transform)
+{
+    PixelOp op;
+    op.mType = PixelOp::PIXEL_OP_TRANSFORM;
+    op.mStencil = mStencil;
+    op.mBlended = false;
+    // Row k holds the contributions of input channel k to the 3 output channels (see LLVector3 * LLMatrix3)
+    for (S32 k = 0; k < NUM_VALUES_IN_MAT3; k++)
     {
-        case STENCIL_BLEND_MODE_BLEND:
-            // Classic blend of incoming color with the background image
-            pixel[VRED]   = inv_alpha * pixel[VRED]   + alpha * red;
-            pixel[VGREEN] = inv_alpha * pixel[VGREEN] + alpha * green;
-            pixel[VBLUE]  = inv_alpha * pixel[VBLUE]  + alpha * blue;
-            break;
-        case STENCIL_BLEND_MODE_ADD:
-            // Add incoming color to the background image
-            pixel[VRED]   = llclampb(pixel[VRED]   + alpha * red);
-            pixel[VGREEN] = llclampb(pixel[VGREEN] + alpha * green);
-            pixel[VBLUE]  = llclampb(pixel[VBLUE]  + alpha * blue);
-            break;
-        case STENCIL_BLEND_MODE_ABACK:
-            // Add back background image to the incoming color
-            pixel[VRED]   = llclampb(inv_alpha * pixel[VRED]   + red);
-            pixel[VGREEN] = llclampb(inv_alpha * pixel[VGREEN] + green);
-            pixel[VBLUE]  = llclampb(inv_alpha * pixel[VBLUE]  + blue);
-            break;
-        case STENCIL_BLEND_MODE_FADE:
-            // Fade incoming color to black
-            pixel[VRED]   = alpha * red;
-            pixel[VGREEN] = alpha * green;
-            pixel[VBLUE]  = alpha * blue;
-            break;
+        for (S32 c = 0; c < NUM_VALUES_IN_MAT3; c++)
+        {
+            op.mTransform[k][c] = transform.mMatrix[k][c];
+        }
+        op.mTransform[k][3] = 0.0f;
     }
+    queuePixelOp(op);
 }
 
-void LLImageFilter::colorCorrect(const U8* lut_red, const U8* lut_green, const U8* lut_blue)
+void LLImageFilter::filterScreen(EScreenMode mode, const F32 wave_length, const F32 angle)
 {
-	const S32 components = mImage->getComponents();
-	llassert( components >= 1 && components <= 4 );
-    
-	S32 width  = mImage->getWidth();
+    PixelOp op;
+    op.mType = PixelOp::PIXEL_OP_SCREEN;
+    op.mStencil = mStencil;
+    op.mBlended = false;
+    op.mScreenMode = mode;
+    op.mWaveLength = wave_length * (F32)(mImage->getHeight()) / 2.0;
+    op.mSine = sinf(angle*DEG_TO_RAD);
+    op.mCosine = cosf(angle*DEG_TO_RAD);
+
+    // Precompute the gamma table : gives us the gray level to use when cutting outside the screen (prevents strong aliasing on the screen)
+    for (S32 i = 0; i < 256; i++)
+    {
+        F32 gamma_i = llclampf((float)(powf((float)(i)/255.0,1.0f/4.0)));
+        op.mLUT[0][i] = (U8)(255.0f* gamma_i);
+    }
+    queuePixelOp(op);
+}
+
+void LLImageFilter::convolve(const LLMatrix3 &kernel, bool normalize, bool abs_value)
+{
+    // Everything queued so far must be in the image before reading the neighbors
+    flushPixelOps();
+
+    S32 width  = mImage->getWidth();
     S32 height = mImage->getHeight();
-    
-	U8* dst_data = mImage->getData();
-	for (S32 j = 0; j < height; j++)
-	{
-        for (S32 i = 0; i < width; i++)
+    if ((width < 2) || (height < 2))
+    {
+        return;
+    }
+
+    // Bands are convolved from a copy of the source so they can be done in any order
+    S32 data_size = width * height * mImage->getComponents();
+    std::vector<U8> src(mImage->getData(), mImage->getData() + data_size);
+    runRowBands(height, [&](S32 first_row, S32 last_row)
+    {
+        convolveRows(kernel, normalize, abs_value, &src[0], first_row, last_row);
+    });
+}
+
+//============================================================================
+// Pipeline
+//============================================================================
+
+void LLImageFilter::queuePixelOp(const PixelOp& op)
+{
+    mPixelOps.push_back(op);
+    PixelOp& queued = mPixelOps.back();
+    if ((queued.mType != PixelOp::PIXEL_OP_LUT) || !queued.mStencil.isUniform())
+    {
+        return;
+    }
+
+    // With a constant alpha, the blended value of a channel only depends on the channel value: fold the blending in the tables
+    F32 alpha = queued.mStencil.getAlpha(0, 0);
+    for (S32 i = 0; i < 256; i++)
+    {
+        U8 pixel[3] = { (U8)i, (U8)i, (U8)i };
+        queued.mStencil.blend(alpha, pixel, op.mLUT[VRED][i], op.mLUT[VGREEN][i], op.mLUT[VBLUE][i]);
+        queued.mLUT[VRED][i]   = pixel[VRED];
+        queued.mLUT[VGREEN][i] = pixel[VGREEN];
+        queued.mLUT[VBLUE][i]  = pixel[VBLUE];
+    }
+    queued.mBlended = true;
+
+    // Successive blended tables collapse into one
+    S32 count = (S32)mPixelOps.size();
+    if ((count > 1) && (mPixelOps[count-2].mType == PixelOp::PIXEL_OP_LUT) && mPixelOps[count-2].mBlended)
+    {
+        PixelOp& previous = mPixelOps[count-2];
+        for (S32 c = 0; c < 3; c++)
         {
-            // Blend LUT value
-            blendStencil(getStencilAlpha(i,j), dst_data, lut_red[dst_data[VRED]], lut_green[dst_data[VGREEN]], lut_blue[dst_data[VBLUE]]);
-            dst_data += components;
+            for (S32 i = 0; i < 256; i++)
+            {
+                previous.mLUT[c][i] = queued.mLUT[c][previous.mLUT[c][i]];
+            }
         }
-	}
+        mPixelOps.pop_back();
+    }
 }
 
-void LLImageFilter::colorTransform(const LLMatrix3 &transform)
+void LLImageFilter::flushPixelOps()
 {
-	const S32 components = mImage->getComponents();
-	llassert( components >= 1 && components <= 4 );
-    
-	S32 width  = mImage->getWidth();
-    S32 height = mImage->getHeight();
-    
-	U8* dst_data = mImage->getData();
-	for (S32 j = 0; j < height; j++)
-	{
-        for (S32 i = 0; i < width; i++)
+    if (mPixelOps.empty())
+    {
+        return;
+    }
+
+    const S32 row_size = mImage->getWidth() * mImage->getComponents();
+    U8* data = mImage->getData();
+    runRowBands(mImage->getHeight(), [&](S32 first_row, S32 last_row)
+    {
+        // Every operation is done on a row before moving to the next one so the row stays in cache
+        for (S32 j = first_row; j < last_row; j++)
         {
-            // Compute transform
-            LLVector3 src((F32)(dst_data[VRED]),(F32)(dst_data[VGREEN]),(F32)(dst_data[VBLUE]));
-            LLVector3 dst = src * transform;
-            dst.clamp(0.0f,255.0f);
-            
-            // Blend result
-            blendStencil(getStencilAlpha(i,j), dst_data, dst.mV[VRED], dst.mV[VGREEN], dst.mV[VBLUE]);
-            dst_data += components;
+            for (const PixelOp& op : mPixelOps)
+            {
+                applyPixelOp(op, data + j * row_size, j);
+            }
         }
-	}
+    });
+    mPixelOps.clear();
 }
 
-void LLImageFilter::convolve(const LLMatrix3 &kernel, bool normalize, bool abs_value)
+void LLImageFilter::applyPixelOp(const PixelOp& op, U8* row, S32 j) const
+{
+    const S32 components = mImage->getComponents();
+    const S32 width = mImage->getWidth();
+    const Stencil& stencil = op.mStencil;
+    const bool uniform = stencil.isUniform();
+    const F32 uniform_alpha = stencil.getAlpha(0, j);
+
+    switch (op.mType)
+    {
+        case PixelOp::PIXEL_OP_LUT:
+        {
+            const U8* lut_red   = op.mLUT[VRED];
+            const U8* lut_green = op.mLUT[VGREEN];
+            const U8* lut_blue  = op.mLUT[VBLUE];
+            if (op.mBlended)
+            {
+                for (S32 i = 0; i < width; i++, row += components)
+                {
+                    row[VRED]   = lut_red[row[VRED]];
+                    row[VGREEN] = lut_green[row[VGREEN]];
+                    row[VBLUE]  = lut_blue[row[VBLUE]];
+                }
+            }
+            else
+            {
+                for (S32 i = 0; i < width; i++, row += components)
+                {
+                    stencil.blend(stencil.getAlpha(i, j), row, lut_red[row[VRED]], lut_green[row[VGREEN]], lut_blue[row[VBLUE]]);
+                }
+            }
+            break;
+        }
+        case PixelOp::PIXEL_OP_TRANSFORM:
+        {
+            // Same operations, in the same order, as LLVector3 * LLMatrix3 then LLVector3::clamp()
+            const __m128 red_row   = _mm_loadu_ps(op.mTransform[VRED]);
+            const __m128 green_row = _mm_loadu_ps(op.mTransform[VGREEN]);
+            const __m128 blue_row  = _mm_loadu_ps(op.mTransform[VBLUE]);
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 max_value = _mm_set1_ps(255.0f);
+            F32 dst[4];
+            for (S32 i = 0; i < width; i++, row += components)
+            {
+                __m128 value = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps((F32)(row[VRED])), red_row),
+                                                     _mm_mul_ps(_mm_set1_ps((F32)(row[VGREEN])), green_row)),
+                                          _mm_mul_ps(_mm_set1_ps((F32)(row[VBLUE])), blue_row));
+                // Operands ordered so that NaN goes through like in LLVector3::clamp()
+                value = _mm_min_ps(max_value, _mm_max_ps(zero, value));
+                _mm_storeu_ps(dst, value);
+                stencil.blend(uniform ? uniform_alpha : stencil.getAlpha(i, j), row, dst[VRED], dst[VGREEN], dst[VBLUE]);
+            }
+            break;
+        }
+        case PixelOp::PIXEL_OP_SCREEN:
+        {
+            const F32 wave_length_pixels = op.mWaveLength;
+            const F32 sin = op.mSine;
+            const F32 cos = op.mCosine;
+            const U8* gamma = op.mLUT[0];
+            for (S32 i = 0; i < width; i++, row += components)
+            {
+                // Compute screen value
+                F32 value = 0.0f;
+                F32 di = 0.0f;
+                F32 dj = 0.0f;
+                switch (op.mScreenMode)
+                {
+                    case SCREEN_MODE_2DSINE:
+                        di =  cos*i + sin*j;
+                        dj = -sin*i + cos*j;
+                        value = (sinf(2*F_PI*di/wave_length_pixels)*sinf(2*F_PI*dj/wave_length_pixels)+1.0f)*255.0/2.0;
+                        break;
+                    case SCREEN_MODE_LINE:
+                        dj = sin*i - cos*j;
+                        value = (sinf(2*F_PI*dj/wave_length_pixels)+1.0f)*255.0/2.0;
+                        break;
+                }
+                U8 dst_value = (row[VRED] >= (U8)(value) ? gamma[row[VRED] - (U8)(value)] : 0);
+
+                // Blend result
+                stencil.blend(uniform ? uniform_alpha : stencil.getAlpha(i, j), row, dst_value, dst_value, dst_value);
+            }
+            break;
+        }
+    }
+}
+
+void LLImageFilter::convolveRows(const LLMatrix3& kernel, bool normalize, bool abs_value, const U8* src, S32 first_row, S32 last_row) const
 {
 	const S32 components = mImage->getComponents();
-	llassert( components >= 1 && components <= 4 );
+	llassert( components >= 3 && components <= 4 );
     
     // Compute normalization factors
     F32 kernel_min = 0.0f;
@@ -380,74 +737,137 @@ void LLImageFilter::convolve(const LLMatrix3 &kernel, bool normalize, bool abs_v
         kernel_min = 0.0f;
     }
     F32 kernel_range = kernel_max - kernel_min;
-    
-    // Allocate temporary buffers and initialize algorithm's data
-	S32 width  = mImage->getWidth();
-    S32 height = mImage->getHeight();
-    
-	U8* dst_data = mImage->getData();
 
-	S32 buffer_size = width * components;
-	llassert_always(buffer_size > 0);
-	std::vector<U8> even_buffer(buffer_size);
-	std::vector<U8> odd_buffer(buffer_size);
-	
-    U8* south_data = dst_data + buffer_size;
-    U8* east_west_data;
-    U8* north_data;
-    
-    // Line 0 : we set the line to 0 (debatable)
-    memcpy( &even_buffer[0], dst_data, buffer_size );	/* Flawfinder: ignore */
-    for (S32 i = 0; i < width; i++)
+    // Kernels made of a box and a center weight (blur, sharpen, gradient...) with integer weights are separable.
+    // All the partial sums are then exact integers, in floats too, so the result is the same in any order.
+    const F32 box_weight = kernel.mMatrix[0][0];
+    const F32 center_weight = kernel.mMatrix[1][1] - box_weight;
+    bool separable = (box_weight == (F32)(S32)(box_weight)) && (center_weight == (F32)(S32)(center_weight)) &&
+                     ((llabs(box_weight) * 9.0f + llabs(center_weight)) * 255.0f < 16777216.0f) &&
+                     (llabs(box_weight) < 32768.0f) && (llabs(center_weight) < 32768.0f);
+    for (S32 k = 0; separable && (k < NUM_VALUES_IN_MAT3); k++)
     {
-        blendStencil(getStencilAlpha(i,0), dst_data, 0, 0, 0);
-        dst_data += components;
+        for (S32 l = 0; l < NUM_VALUES_IN_MAT3; l++)
+        {
+            if (((k != 1) || (l != 1)) && (kernel.mMatrix[k][l] != box_weight))
+            {
+                separable = false;
+                break;
+            }
+        }
     }
-    south_data += buffer_size;
-    
-    // All other lines
-    for (S32 j = 1; j < (height-1); j++)
-	{
-        // We need to buffer 2 lines. We flip north and east-west (current) to avoid moving too much memory around
-        if (j % 2)
+    // madd weights: box sum and center value interleaved in 16 bits lanes
+    const S16 box_w = (separable ? (S16)(box_weight) : 0);
+    const S16 center_w = (separable ? (S16)(center_weight) : 0);
+    const __m128i weights = _mm_setr_epi16(box_w, center_w, box_w, center_w, box_w, center_w, box_w, center_w);
+
+    const S32 width = mImage->getWidth();
+    const S32 height = mImage->getHeight();
+    const S32 row_size = width * components;
+    const Stencil& stencil = mStencil;
+
+    // Convolution of each channel of the row, indexed like the row bytes. Only the inner pixels are computed.
+    const S32 begin = components;
+    const S32 end = (width - 1) * components;
+    std::vector<F32> sums(row_size);
+    std::vector<S16> box(row_size);
+
+    for (S32 j = first_row; j < last_row; j++)
+    {
+        U8* dst_data = mImage.get()->getData() + j * row_size;
+        if ((j == 0) || (j == height - 1))
         {
-            memcpy( &odd_buffer[0], dst_data, buffer_size );	/* Flawfinder: ignore */
-            east_west_data = &odd_buffer[0];
-            north_data = &even_buffer[0];
+            // First and last lines : we set the line to 0 (debatable). The stencil alpha of line 0 is used for both.
+            for (S32 i = 0; i < width; i++)
+            {
+                stencil.blend(stencil.getAlpha(i,0), dst_data, 0, 0, 0);
+                dst_data += components;
+            }
+            continue;
+        }
+
+        const U8* north = src + (j - 1) * row_size;
+        const U8* center = north + row_size;
+        const U8* south = center + row_size;
+        S32 x = begin;
+
+        if (separable)
+        {
+            // Box sums of 3x3 pixels, horizontal then vertical, 8 channels at a time
+            const __m128i zero = _mm_setzero_si128();
+            for (; x + 8 <= end; x += 8)
+            {
+                __m128i sum = zero;
+                const U8* rows[3] = { north, center, south };
+                for (S32 k = 0; k < 3; k++)
+                {
+                    sum = _mm_add_epi16(sum, _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(rows[k] + x - components)), zero));
+                    sum = _mm_add_epi16(sum, _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(rows[k] + x)), zero));
+                    sum = _mm_add_epi16(sum, _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(rows[k] + x + components)), zero));
+                }
+                __m128i middle = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(center + x)), zero);
+                __m128i result_lo = _mm_madd_epi16(_mm_unpacklo_epi16(sum, middle), weights);
+                __m128i result_hi = _mm_madd_epi16(_mm_unpackhi_epi16(sum, middle), weights);
+                _mm_storeu_ps(&sums[x], _mm_cvtepi32_ps(result_lo));
+                _mm_storeu_ps(&sums[x + 4], _mm_cvtepi32_ps(result_hi));
+            }
+            for (; x < end; x++)
+            {
+                S32 sum = 0;
+                for (S32 k = -1; k <= 1; k++)
+                {
+                    sum += center[x + k * row_size - components] + center[x + k * row_size] + center[x + k * row_size + components];
+                }
+                sums[x] = (F32)(box_w * sum + center_w * center[x]);
+            }
         }
         else
         {
-            memcpy( &even_buffer[0], dst_data, buffer_size );	/* Flawfinder: ignore */
-            east_west_data = &even_buffer[0];
-            north_data = &odd_buffer[0];
+            // Same sum, in the same order, as the scalar formula for each channel, 4 channels at a time
+            __m128 k[NUM_VALUES_IN_MAT3][NUM_VALUES_IN_MAT3];
+            for (S32 k_row = 0; k_row < NUM_VALUES_IN_MAT3; k_row++)
+            {
+                for (S32 k_col = 0; k_col < NUM_VALUES_IN_MAT3; k_col++)
+                {
+                    k[k_row][k_col] = _mm_set1_ps(kernel.mMatrix[k_row][k_col]);
+                }
+            }
+            const __m128i zero = _mm_setzero_si128();
+            for (; x + 4 <= end; x += 4)
+            {
+                __m128 sum = _mm_setzero_ps();
+                bool first = true;
+                const U8* rows[3] = { north, center, south };
+                for (S32 k_row = 0; k_row < NUM_VALUES_IN_MAT3; k_row++)
+                {
+                    for (S32 k_col = 0; k_col < NUM_VALUES_IN_MAT3; k_col++)
+                    {
+                        S32 packed;
+                        memcpy(&packed, rows[k_row] + x + (k_col - 1) * components, sizeof(packed));	/* Flawfinder: ignore */
+                        __m128i values = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+                        __m128 term = _mm_mul_ps(k[k_row][k_col], _mm_cvtepi32_ps(values));
+                        sum = (first ? term : _mm_add_ps(sum, term));
+                        first = false;
+                    }
+                }
+                _mm_storeu_ps(&sums[x], sum);
+            }
+            for (; x < end; x++)
+            {
+                sums[x] = (kernel.mMatrix[0][0]*north[x-components]  + kernel.mMatrix[0][1]*north[x]  + kernel.mMatrix[0][2]*north[x+components] +
+                           kernel.mMatrix[1][0]*center[x-components] + kernel.mMatrix[1][1]*center[x] + kernel.mMatrix[1][2]*center[x+components] +
+                           kernel.mMatrix[2][0]*south[x-components]  + kernel.mMatrix[2][1]*south[x]  + kernel.mMatrix[2][2]*south[x+components]);
+            }
         }
+
         // First pixel : set to 0
-        blendStencil(getStencilAlpha(0,j), dst_data, 0, 0, 0);
+        stencil.blend(stencil.getAlpha(0,j), dst_data, 0, 0, 0);
         dst_data += components;
-        // Set pointers to kernel
-        U8* NW = north_data;
-        U8* N = NW+components;
-        U8* NE = N+components;
-        U8* W = east_west_data;
-        U8* C = W+components;
-        U8* E = C+components;
-        U8* SW = south_data;
-        U8* S = SW+components;
-        U8* SE = S+components;
         // All other pixels
         for (S32 i = 1; i < (width-1); i++)
         {
-            // Compute convolution
-            LLVector3 dst;
-            dst.mV[VRED] = (kernel.mMatrix[0][0]*NW[VRED] + kernel.mMatrix[0][1]*N[VRED] + kernel.mMatrix[0][2]*NE[VRED] +
-                            kernel.mMatrix[1][0]*W[VRED]  + kernel.mMatrix[1][1]*C[VRED] + kernel.mMatrix[1][2]*E[VRED] +
-                            kernel.mMatrix[2][0]*SW[VRED] + kernel.mMatrix[2][1]*S[VRED] + kernel.mMatrix[2][2]*SE[VRED]);
-            dst.mV[VGREEN] = (kernel.mMatrix[0][0]*NW[VGREEN] + kernel.mMatrix[0][1]*N[VGREEN] + kernel.mMatrix[0][2]*NE[VGREEN] +
-                              kernel.mMatrix[1][0]*W[VGREEN]  + kernel.mMatrix[1][1]*C[VGREEN] + kernel.mMatrix[1][2]*E[VGREEN] +
-                              kernel.mMatrix[2][0]*SW[VGREEN] + kernel.mMatrix[2][1]*S[VGREEN] + kernel.mMatrix[2][2]*SE[VGREEN]);
-            dst.mV[VBLUE] = (kernel.mMatrix[0][0]*NW[VBLUE] + kernel.mMatrix[0][1]*N[VBLUE] + kernel.mMatrix[0][2]*NE[VBLUE] +
-                             kernel.mMatrix[1][0]*W[VBLUE]  + kernel.mMatrix[1][1]*C[VBLUE] + kernel.mMatrix[1][2]*E[VBLUE] +
-                             kernel.mMatrix[2][0]*SW[VBLUE] + kernel.mMatrix[2][1]*S[VBLUE] + kernel.mMatrix[2][2]*SE[VBLUE]);
+            const F32* sum = &sums[i * components];
+            LLVector3 dst(sum[VRED], sum[VGREEN], sum[VBLUE]);
             if (abs_value)
             {
                 dst.mV[VRED]   = llabs(dst.mV[VRED]);
@@ -463,138 +883,132 @@ void LLImageFilter::convolve(const LLMatrix3 &kernel, bool normalize, bool abs_v
             dst.clamp(0.0f,255.0f);
             
             // Blend result
-            blendStencil(getStencilAlpha(i,j), dst_data, dst.mV[VRED], dst.mV[VGREEN], dst.mV[VBLUE]);
-            
-            // Next pixel
+            stencil.blend(stencil.getAlpha(i,j), dst_data, dst.mV[VRED], dst.mV[VGREEN], dst.mV[VBLUE]);
             dst_data += components;
-            NW += components;
-            N += components;
-            NE += components;
-            W += components;
-            C += components;
-            E += components;
-            SW += components;
-            S += components;
-            SE += components;
         }
         // Last pixel : set to 0
-        blendStencil(getStencilAlpha(width-1,j), dst_data, 0, 0, 0);
-        dst_data += components;
-        south_data += buffer_size;
-	}
-    
-    // Last line
-    for (S32 i = 0; i < width; i++)
-    {
-        blendStencil(getStencilAlpha(i,0), dst_data, 0, 0, 0);
-        dst_data += components;
+        stencil.blend(stencil.getAlpha(width-1,j), dst_data, 0, 0, 0);
     }
 }
 
-void LLImageFilter::filterScreen(EScreenMode mode, const F32 wave_length, const F32 angle)
+void LLImageFilter::runRowBands(S32 rows, const std::function<void(S32, S32)>& func) const
 {
-	const S32 components = mImage->getComponents();
-	llassert( components >= 1 && components <= 4 );
-    
-	S32 width  = mImage->getWidth();
-    S32 height = mImage->getHeight();
-    
-    F32 wave_length_pixels = wave_length * (F32)(height) / 2.0;
-    F32 sin = sinf(angle*DEG_TO_RAD);
-    F32 cos = cosf(angle*DEG_TO_RAD);
-
-    // Precompute the gamma table : gives us the gray level to use when cutting outside the screen (prevents strong aliasing on the screen)
-    U8 gamma[256];
-    for (S32 i = 0; i < 256; i++)
+    // Bands of a few rows are handed out to the filter threads, small images are done on the calling thread,
+    // as are passes made while another filter has the threads
+    if (!sFilterThreads || (rows <= BAND_ROWS) || (rows * mImage->getWidth() < 256 * 256)
+        || !sFilterThreads->run(rows, func))
     {
-        F32 gamma_i = llclampf((float)(powf((float)(i)/255.0,1.0f/4.0)));
-        gamma[i] = (U8)(255.0f* gamma_i);
+        func(0, rows);
     }
-    
-	U8* dst_data = mImage->getData();
-	for (S32 j = 0; j < height; j++)
-	{
-        for (S32 i = 0; i < width; i++)
-        {
-            // Compute screen value
-            F32 value = 0.0f;
-            F32 di = 0.0f;
-            F32 dj = 0.0f;
-            switch (mode)
-            {
-                case SCREEN_MODE_2DSINE:
-                    di =  cos*i + sin*j;
-                    dj = -sin*i + cos*j;
-                    value = (sinf(2*F_PI*di/wave_length_pixels)*sinf(2*F_PI*dj/wave_length_pixels)+1.0f)*255.0/2.0;
-                    break;
-                case SCREEN_MODE_LINE:
-                    dj = sin*i - cos*j;
-                    value = (sinf(2*F_PI*dj/wave_length_pixels)+1.0f)*255.0/2.0;
-                    break;
-            }
-            U8 dst_value = (dst_data[VRED] >= (U8)(value) ? gamma[dst_data[VRED] - (U8)(value)] : 0);
-            
-            // Blend result
-            blendStencil(getStencilAlpha(i,j), dst_data, dst_value, dst_value, dst_value);
-            dst_data += components;
-        }
-	}
 }
 
 //============================================================================
 // Procedural Stencils
 //============================================================================
+
+LLImageFilter::Stencil::Stencil() :
+    mBlendMode(STENCIL_BLEND_MODE_BLEND),
+    mShape(STENCIL_SHAPE_UNIFORM),
+    mMin(0.0f),
+    mMax(1.0f),
+    mCenterX(0),
+    mCenterY(0),
+    mWidth(0),
+    mGamma(1.0f),
+    mWavelength(10.0f),
+    mSine(0.0f),
+    mCosine(1.0f),
+    mStartX(0.0f),
+    mStartY(0.0f),
+    mGradX(0.0f),
+    mGradY(0.0f),
+    mGradN(0.0f)
+{
+}
+
+void LLImageFilter::Stencil::blend(F32 alpha, U8* pixel, U8 red, U8 green, U8 blue) const
+{
+    F32 inv_alpha = 1.0f - alpha;
+    switch (mBlendMode)
+    {
+        case STENCIL_BLEND_MODE_BLEND:
+            // Classic blend of incoming color with the background image
+            pixel[VRED]   = inv_alpha * pixel[VRED]   + alpha * red;
+            pixel[VGREEN] = inv_alpha * pixel[VGREEN] + alpha * green;
+            pixel[VBLUE]  = inv_alpha * pixel[VBLUE]  + alpha * blue;
+            break;
+        case STENCIL_BLEND_MODE_ADD:
+            // Add incoming color to the background image
+            pixel[VRED]   = llclampb(pixel[VRED]   + alpha * red);
+            pixel[VGREEN] = llclampb(pixel[VGREEN] + alpha * green);
+            pixel[VBLUE]  = llclampb(pixel[VBLUE]  + alpha * blue);
+            break;
+        case STENCIL_BLEND_MODE_ABACK:
+            // Add back background image to the incoming color
+            pixel[VRED]   = llclampb(inv_alpha * pixel[VRED]   + red);
+            pixel[VGREEN] = llclampb(inv_alpha * pixel[VGREEN] + green);
+            pixel[VBLUE]  = llclampb(inv_alpha * pixel[VBLUE]  + blue);
+            break;
+        case STENCIL_BLEND_MODE_FADE:
+            // Fade incoming color to black
+            pixel[VRED]   = alpha * red;
+            pixel[VGREEN] = alpha * green;
+            pixel[VBLUE]  = alpha * blue;
+            break;
+    }
+}
+
 void LLImageFilter::setStencil(EStencilShape shape, EStencilBlendMode mode, F32 min, F32 max, F32* params)
 {
-    mStencilShape = shape;
-    mStencilBlendMode = mode;
-    mStencilMin = llmin(llmax(min, -1.0f), 1.0f);
-    mStencilMax = llmin(llmax(max, -1.0f), 1.0f);
+    mStencil.mShape = shape;
+    mStencil.mBlendMode = mode;
+    mStencil.mMin = llmin(llmax(min, -1.0f), 1.0f);
+    mStencil.mMax = llmin(llmax(max, -1.0f), 1.0f);
     
     // Each shape will interpret the 4 params differenly.
     // We compute each systematically, though, clearly, values are meaningless when the shape doesn't correspond to the parameters
-    mStencilCenterX = (S32)(mImage->getWidth()  + params[0] * (F32)(mImage->getHeight()))/2;
-    mStencilCenterY = (S32)(mImage->getHeight() + params[1] * (F32)(mImage->getHeight()))/2;
-    mStencilWidth = (S32)(params[2] * (F32)(mImage->getHeight()))/2;
-    mStencilGamma = (params[3] <= 0.0f ? 1.0f : params[3]);
+    mStencil.mCenterX = (S32)(mImage->getWidth()  + params[0] * (F32)(mImage->getHeight()))/2;
+    mStencil.mCenterY = (S32)(mImage->getHeight() + params[1] * (F32)(mImage->getHeight()))/2;
+    mStencil.mWidth = (S32)(params[2] * (F32)(mImage->getHeight()))/2;
+    mStencil.mGamma = (params[3] <= 0.0f ? 1.0f : params[3]);
 
-    mStencilWavelength = (params[0] <= 0.0f ? 10.0f : params[0] * (F32)(mImage->getHeight()) / 2.0f);
-    mStencilSine   = sinf(params[1]*DEG_TO_RAD);
-    mStencilCosine = cosf(params[1]*DEG_TO_RAD);
+    mStencil.mWavelength = (params[0] <= 0.0f ? 10.0f : params[0] * (F32)(mImage->getHeight()) / 2.0f);
+    mStencil.mSine   = sinf(params[1]*DEG_TO_RAD);
+    mStencil.mCosine = cosf(params[1]*DEG_TO_RAD);
 
-    mStencilStartX = ((F32)(mImage->getWidth())  + params[0] * (F32)(mImage->getHeight()))/2.0f;
-    mStencilStartY = ((F32)(mImage->getHeight()) + params[1] * (F32)(mImage->getHeight()))/2.0f;
+    mStencil.mStartX = ((F32)(mImage->getWidth())  + params[0] * (F32)(mImage->getHeight()))/2.0f;
+    mStencil.mStartY = ((F32)(mImage->getHeight()) + params[1] * (F32)(mImage->getHeight()))/2.0f;
     F32 end_x      = ((F32)(mImage->getWidth())  + params[2] * (F32)(mImage->getHeight()))/2.0f;
     F32 end_y      = ((F32)(mImage->getHeight()) + params[3] * (F32)(mImage->getHeight()))/2.0f;
-    mStencilGradX  = end_x - mStencilStartX;
-    mStencilGradY  = end_y - mStencilStartY;
-    mStencilGradN  = mStencilGradX*mStencilGradX + mStencilGradY*mStencilGradY;
+    mStencil.mGradX  = end_x - mStencil.mStartX;
+    mStencil.mGradY  = end_y - mStencil.mStartY;
+    mStencil.mGradN  = mStencil.mGradX*mStencil.mGradX + mStencil.mGradY*mStencil.mGradY;
 }
 
-F32 LLImageFilter::getStencilAlpha(S32 i, S32 j)
+F32 LLImageFilter::Stencil::getAlpha(S32 i, S32 j) const
 {
     F32 alpha = 1.0f;    // That init actually takes care of the STENCIL_SHAPE_UNIFORM case...
-    if (mStencilShape == STENCIL_SHAPE_VIGNETTE)
+    if (mShape == STENCIL_SHAPE_VIGNETTE)
     {
         // alpha is a modified gaussian value, with a center and fading in a circular pattern toward the edges
         // The gamma parameter controls the intensity of the drop down from alpha 1.0 (center) to 0.0f
-        F32 d_center_square = (i - mStencilCenterX)*(i - mStencilCenterX) + (j - mStencilCenterY)*(j - mStencilCenterY);
-        alpha = powf(F_E, -(powf((d_center_square/(mStencilWidth*mStencilWidth)),mStencilGamma)/2.0f));
+        F32 d_center_square = (i - mCenterX)*(i - mCenterX) + (j - mCenterY)*(j - mCenterY);
+        alpha = powf(F_E, -(powf((d_center_square/(mWidth*mWidth)),mGamma)/2.0f));
     }
-    else if (mStencilShape == STENCIL_SHAPE_SCAN_LINES)
+    else if (mShape == STENCIL_SHAPE_SCAN_LINES)
     {
         // alpha varies according to a squared sine function.
-        F32 d = mStencilSine*i - mStencilCosine*j;
-        alpha = (sinf(2*F_PI*d/mStencilWavelength) > 0.0f ? 1.0f : 0.0f);
+        F32 d = mSine*i - mCosine*j;
+        alpha = (sinf(2*F_PI*d/mWavelength) > 0.0f ? 1.0f : 0.0f);
     }
-    else if (mStencilShape == STENCIL_SHAPE_GRADIENT)
+    else if (mShape == STENCIL_SHAPE_GRADIENT)
     {
-        alpha = (((F32)(i) - mStencilStartX)*mStencilGradX + ((F32)(j) - mStencilStartY)*mStencilGradY) / mStencilGradN;
+        alpha = (((F32)(i) - mStartX)*mGradX + ((F32)(j) - mStartY)*mGradY) / mGradN;
         alpha = llclampf(alpha);
     }
     
     // We rescale alpha between min and max
-    return (mStencilMin + alpha * (mStencilMax - mStencilMin));
+    return (mMin + alpha * (mMax - mMin));
 }
 
 //============================================================================
@@ -605,6 +1019,8 @@ U32* LLImageFilter::getBrightnessHistogram()
 {
     if (!mHistoBrightness)
     {
+        // The histograms are computed on the image as it is at this step of the filter
+        flushPixelOps();
         computeHistograms();
     }
     return mHistoBrightness;
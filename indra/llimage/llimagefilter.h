@@ -30,6 +30,9 @@
 #include "llsd.h"
 #include "llimage.h"
 
+#include <functional>
+#include <vector>
+
 class LLImageRaw;
 class LLColor4U;
 class LLColor3;
@@ -67,6 +70,10 @@ public:
     LLImageFilter(const std::string& file_path);
     ~LLImageFilter();
     
+    // Starts and stops the threads filter passes are spread over, without them filters run on the calling thread
+    static void initClass();
+    static void cleanupClass();
+
     void executeFilter(LLPointer<LLImageRaw> raw_image);
     
 private:
@@ -87,16 +94,72 @@ private:
     void filterContrast(F32 slope, const LLColor3& alpha);      // Change contrast according to slope: > 1.0 more contrast, < 1.0 less contrast
     void filterBrightness(F32 add, const LLColor3& alpha);      // Change brightness according to add: > 0 brighter, < 0 darker
     
+    // Procedural stencil settings. Each queued operation keeps a copy of the stencil current when it was queued.
+    struct Stencil
+    {
+        Stencil();
+        F32 getAlpha(S32 i, S32 j) const;
+        void blend(F32 alpha, U8* pixel, U8 red, U8 green, U8 blue) const;
+        bool isUniform() const { return mShape == STENCIL_SHAPE_UNIFORM; }
+
+        EStencilBlendMode mBlendMode;
+        EStencilShape mShape;
+        F32 mMin;
+        F32 mMax;
+
+        S32 mCenterX;
+        S32 mCenterY;
+        S32 mWidth;
+        F32 mGamma;
+
+        F32 mWavelength;
+        F32 mSine;
+        F32 mCosine;
+
+        F32 mStartX;
+        F32 mStartY;
+        F32 mGradX;
+        F32 mGradY;
+        F32 mGradN;
+    };
+
+    // Per pixel operation waiting in the pipeline. Consecutive operations are applied in a single pass
+    // over the image, see flushPixelOps().
+    struct PixelOp
+    {
+        enum EType
+        {
+            PIXEL_OP_LUT,           // Color correction lookup tables
+            PIXEL_OP_TRANSFORM,     // Color matrix
+            PIXEL_OP_SCREEN         // Screen pattern
+        };
+
+        EType mType;
+        Stencil mStencil;
+        bool mBlended;              // mLUT already includes the (uniform) stencil blending
+        U8 mLUT[3][256];            // Per channel lookup tables, the screen gamma table uses the first one
+        F32 mTransform[3][4];       // Rows of the color matrix, padded for SSE
+        EScreenMode mScreenMode;
+        F32 mWaveLength;
+        F32 mSine;
+        F32 mCosine;
+    };
+
     // Filter Primitives
     void colorTransform(const LLMatrix3 &transform);
     void colorCorrect(const U8* lut_red, const U8* lut_green, const U8* lut_blue);
     void filterScreen(EScreenMode mode, const F32 wave_length, const F32 angle);
-    void blendStencil(F32 alpha, U8* pixel, U8 red, U8 green, U8 blue);
     void convolve(const LLMatrix3 &kernel, bool normalize, bool abs_value);
 
+    // Pipeline
+    void queuePixelOp(const PixelOp& op);
+    void flushPixelOps();
+    void applyPixelOp(const PixelOp& op, U8* row, S32 j) const;
+    void convolveRows(const LLMatrix3& kernel, bool normalize, bool abs_value, const U8* src, S32 first_row, S32 last_row) const;
+    void runRowBands(S32 rows, const std::function<void(S32, S32)>& func) const;
+
     // Procedural Stencils
     void setStencil(EStencilShape shape, EStencilBlendMode mode, F32 min, F32 max, F32* params);
-    F32 getStencilAlpha(S32 i, S32 j);
 
     // Histograms
     U32* getBrightnessHistogram();
@@ -112,25 +175,10 @@ private:
     U32 *mHistoBrightness;
     
     // Current Stencil Settings
-    EStencilBlendMode mStencilBlendMode;
-    EStencilShape mStencilShape;
-    F32 mStencilMin;
-    F32 mStencilMax;
-    
-    S32 mStencilCenterX;
-    S32 mStencilCenterY;
-    S32 mStencilWidth;
-    F32 mStencilGamma;
-    
-    F32 mStencilWavelength;
-    F32 mStencilSine;
-    F32 mStencilCosine;
-    
-    F32 mStencilStartX;
-    F32 mStencilStartY;
-    F32 mStencilGradX;
-    F32 mStencilGradY;
-    F32 mStencilGradN;
+    Stencil mStencil;
+
+    // Operations not applied to mImage yet
+    std::vector<PixelOp> mPixelOps;
 };
 
 
@@ -0,0 +1,111 @@
+/**
+ * @file llimagesimd.h
+ * @brief SSE2 helpers shared by the LLImageRaw pixel kernels.
+ *
+ * $LicenseInfo:firstyear=2001&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLIMAGESIMD_H
+#define LL_LLIMAGESIMD_H
+
+#include "stdtypes.h"
+
+#include <string.h>
+
+#include <emmintrin.h>
+#if defined(__SSE4_1__) || defined(__AVX__)
+#include <smmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Low 32 bits of a * b for each lane, same as S32 multiplication.
+inline __m128i ll_mullo_epi32(__m128i a, __m128i b)
+{
+#if defined(__SSE4_1__) || defined(__AVX__)
+	return _mm_mullo_epi32(a, b);
+#else
+	__m128i even = _mm_mul_epu32(a, b);
+	__m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+#endif
+}
+
+// LLImageRaw::fastFractionalMult() on eight 16 bit lanes.  a * b + 128 + 254
+// never exceeds 0xffff so the unsigned lanes can't wrap.
+inline __m128i fast_fractional_mult_epi16(__m128i a, __m128i b)
+{
+	__m128i i = _mm_add_epi16(_mm_mullo_epi16(a, b), _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(i, _mm_srli_epi16(i, 8)), 8);
+}
+
+#if defined(__AVX2__)
+inline __m256i fast_fractional_mult_epi16(__m256i a, __m256i b)
+{
+	__m256i i = _mm256_add_epi16(_mm256_mullo_epi16(a, b), _mm256_set1_epi16(128));
+	return _mm256_srli_epi16(_mm256_add_epi16(i, _mm256_srli_epi16(i, 8)), 8);
+}
+#endif
+
+// One 4 component pixel widened to 32 bit lanes.
+inline __m128i load_pixel_epi32(const U8 *pix)
+{
+	S32 packed;
+	memcpy(&packed, pix, sizeof(packed));
+	const __m128i zero = _mm_setzero_si128();
+	return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+}
+
+// Stores the low byte of each lane, like *dptr = comp & 0xff.
+inline void store_pixel_epi32(U8 *dptr, __m128i v)
+{
+	v = _mm_and_si128(v, _mm_set1_epi32(0xff));
+	v = _mm_packs_epi32(v, v);
+	v = _mm_packus_epi16(v, v);
+	S32 packed = _mm_cvtsi128_si32(v);
+	memcpy(dptr, &packed, sizeof(packed));
+}
+
+// One 3 or 4 component pixel as floats, missing channels are zero.
+inline __m128 load_pixel_ps(const U8 *pix, S32 components)
+{
+	if (components == 4)
+	{
+		return _mm_cvtepi32_ps(load_pixel_epi32(pix));
+	}
+	return _mm_cvtepi32_ps(_mm_setr_epi32(pix[0], pix[1], pix[2], 0));
+}
+
+// Rounds half away from zero, the same as ll_round() (round()) for every
+// input the resamplers produce: they are never negative and below 2^23, so
+// v - trunc(v) is exact.  Unlike floor(v + 0.5f) this does not round the
+// largest float below one half, 0.49999997f, up to 1, since v + 0.5f rounds
+// to 1.0f there.  tests/llimagesimd_test.cpp holds it to ll_round().
+inline __m128i round_ps_epi32(__m128 v)
+{
+	__m128i t = _mm_cvttps_epi32(v);
+	__m128 frac = _mm_sub_ps(v, _mm_cvtepi32_ps(t));
+	return _mm_sub_epi32(t, _mm_castps_si128(_mm_cmpge_ps(frac, _mm_set1_ps(0.5f))));
+}
+
+#endif
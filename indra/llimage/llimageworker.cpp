@@ -30,22 +30,61 @@
 
 #include "llimageworker.h"
 #include "llimagedxt.h"
+#include "llstl.h"
+#include "llstring.h"
 
 //----------------------------------------------------------------------------
 
 // MAIN THREAD
-LLImageDecodeThread::LLImageDecodeThread(bool threaded)
+LLImageDecodeThread::LLImageDecodeThread(bool threaded, U32 pool_size)
 	: LLQueuedThread("imagedecode", threaded)
 {
 	mCreationMutex = new LLMutex();
+
+	if (threaded)
+	{
+		if (!pool_size)
+		{
+			U32 cores = boost::thread::hardware_concurrency();
+			pool_size = cores > 1 ? cores - 1 : 1;
+		}
+		for (U32 i = 1; i < pool_size; ++i)
+		{
+			PoolThread* thread = new PoolThread(llformat("imagedecode %d", i), this);
+			mPoolThreads.push_back(thread);
+			thread->start();
+		}
+		LL_INFOS() << "Image decode pool using " << getPoolSize() << " threads" << LL_ENDL;
+	}
 }
 
 //virtual 
 LLImageDecodeThread::~LLImageDecodeThread()
 {
+	shutdownPool();
 	delete mCreationMutex ;
 }
 
+// MAIN THREAD
+//virtual
+void LLImageDecodeThread::shutdown()
+{
+	// The pool threads must be gone before LLQueuedThread deletes the
+	// requests they may be working on.
+	shutdownPool();
+	LLQueuedThread::shutdown();
+}
+
+void LLImageDecodeThread::shutdownPool()
+{
+	for (PoolThread* thread : mPoolThreads)
+	{
+		thread->shutdown();
+	}
+	std::for_each(mPoolThreads.begin(), mPoolThreads.end(), DeletePointer());
+	mPoolThreads.clear();
+}
+
 // MAIN THREAD
 // virtual
 S32 LLImageDecodeThread::update(F32 max_time_ms)
@@ -67,6 +106,13 @@ S32 LLImageDecodeThread::update(F32 max_time_ms)
 	}
 	mCreationList.clear();
 	S32 res = LLQueuedThread::update(max_time_ms);
+	if (res > 0)
+	{
+		for (PoolThread* thread : mPoolThreads)
+		{
+			thread->wake();
+		}
+	}
 	return res;
 }
 
@@ -94,6 +140,39 @@ LLImageDecodeThread::Responder::~Responder()
 
 //----------------------------------------------------------------------------
 
+LLImageDecodeThread::PoolThread::PoolThread(const std::string& name, LLImageDecodeThread* queue)
+	: LLThread(name),
+	  mQueue(queue)
+{
+}
+
+// virtual
+bool LLImageDecodeThread::PoolThread::runCondition()
+{
+	// mDataLock is locked here; the queue has its own lock
+	return mQueue->getPending() > 0;
+}
+
+// virtual
+void LLImageDecodeThread::PoolThread::run()
+{
+	while (true)
+	{
+		// Sleeps until the main decode thread's update() wakes us with work
+		checkPause();
+
+		if (isQuitting())
+		{
+			break;
+		}
+
+		mQueue->processNextRequest();
+	}
+	LL_INFOS() << "Image decode pool thread " << mName << " EXITING." << LL_ENDL;
+}
+
+//----------------------------------------------------------------------------
+
 LLImageDecodeThread::ImageRequest::ImageRequest(handle_t handle, LLImageFormatted* image, 
 												U32 priority, S32 discard, BOOL needs_aux,
 												LLImageDecodeThread::Responder* responder)
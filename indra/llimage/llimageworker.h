@@ -71,19 +71,42 @@ public:
 		LLPointer<LLImageDecodeThread::Responder> mResponder;
 	};
 	
+private:
+	// Extra decode worker.  Pool threads pull from the same priority queue
+	// as the LLImageDecodeThread itself, so whichever worker is free always
+	// takes the highest priority pending request.
+	class PoolThread : public LLThread
+	{
+	public:
+		PoolThread(const std::string& name, LLImageDecodeThread* queue);
+
+	private:
+		bool runCondition() override;
+		void run() override;
+
+		LLImageDecodeThread* mQueue;
+	};
+
 public:
-	LLImageDecodeThread(bool threaded = true);
+	// pool_size is the total number of decode workers, including this
+	// thread.  0 picks one worker per core, leaving a core for the main loop.
+	LLImageDecodeThread(bool threaded = true, U32 pool_size = 0);
 	virtual ~LLImageDecodeThread();
+	void shutdown() override;
 
 	handle_t decodeImage(LLImageFormatted* image,
 						 U32 priority, S32 discard, BOOL needs_aux,
 						 Responder* responder);
 	S32 update(F32 max_time_ms) override;
 
+	U32 getPoolSize() const { return mPoolThreads.size() + 1; }
+
 	// Used by unit tests to check the consistency of the thread instance
 	S32 tut_size();
 	
 private:
+	void shutdownPool();
+
 	struct creation_info
 	{
 		handle_t handle;
@@ -99,6 +122,9 @@ private:
 	typedef std::list<creation_info> creation_list_t;
 	creation_list_t mCreationList;
 	LLMutex* mCreationMutex;
+
+	typedef std::vector<PoolThread*> pool_thread_list_t;
+	pool_thread_list_t mPoolThreads;
 };
 
 #endif
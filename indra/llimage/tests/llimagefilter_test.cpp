@@ -0,0 +1,848 @@
+/**
+ * @file llimagefilter_test.cpp
+ * @brief Compares the filter pipeline with the per step filters it replaced
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+// Class to test
+#include "../llimagefilter.h"
+// Reference filters
+#include "llmath.h"
+#include "m3math.h"
+#include "v3color.h"
+#include "v3math.h"
+#include "llsdserialize.h"
+// Tut header
+#include "../test/lltut.h"
+// For sSourceDir
+#include "../test/test.h"
+
+// -------------------------------------------------------------------------------------------
+// Stubbing: Declarations required to link and run the class being tested
+// Notes:
+// * Add here stubbed implementation of the few classes and methods used in the class to be tested
+// * Add as little as possible (let the link errors guide you)
+// * Do not make any assumption as to how those classes or methods work (i.e. don't copy/paste code)
+// * A simulator for a class can be implemented here. Please comment and document thoroughly.
+
+// Simulates a raw image: a plain buffer of width * height * components bytes
+LLImageBase::LLImageBase()
+: LLTrace::MemTrackable<LLImageBase>("LLImageBase"),
+mData(NULL),
+mDataSize(0),
+mWidth(0),
+mHeight(0),
+mComponents(0),
+mBadBufferAllocation(false),
+mAllowOverSize(false)
+{
+}
+LLImageBase::~LLImageBase() { deleteData(); }
+void LLImageBase::dump() { }
+void LLImageBase::sanityCheck() { }
+void LLImageBase::deleteData() { delete[] mData; mData = NULL; mDataSize = 0; }
+U8* LLImageBase::allocateData(S32 size) { deleteData(); mDataSize = size; mData = new U8[size]; return mData; }
+U8* LLImageBase::reallocateData(S32 size) { return NULL; }
+const U8* LLImageBase::getData() const { return mData; }
+U8* LLImageBase::getData() { return mData; }
+void LLImageBase::setSize(S32 width, S32 height, S32 ncomponents) { mWidth = width; mHeight = height; mComponents = ncomponents; }
+
+LLImageRaw::LLImageRaw(U16 width, U16 height, S8 components) { setSize(width, height, components); allocateData(width * height * components); }
+LLImageRaw::~LLImageRaw() { }
+void LLImageRaw::deleteData() { LLImageBase::deleteData(); }
+U8* LLImageRaw::allocateData(S32 size) { return LLImageBase::allocateData(size); }
+U8* LLImageRaw::reallocateData(S32 size) { return NULL; }
+
+// End Stubbing
+// -------------------------------------------------------------------------------------------
+
+namespace
+{
+	// The filters shipped with llimage_libtest
+	const char* FILTER_NAMES[] =
+	{
+		"1970colorize", "autocontrast", "badtrip", "blowhighlights", "blur", "brighten", "colorize",
+		"colortransform", "contrast", "convolve", "darken", "dodgeandburn", "edges", "focus", "gamma",
+		"grayscale", "heatwave", "horizontalscreen", "julesverne", "lensflare", "lightleak", "linearize",
+		"miniature", "newsscreen", "overcast", "pixelate", "posterize", "rotatecolors180", "saturate",
+		"sepia", "sharpen", "slantedscreen", "spotlight", "stencilgradient", "stencilscanlines",
+		"stenciluniform", "stencilvignette", "thematrix", "toycamera", "verticalscreen", "video"
+	};
+
+	std::string filter_path(const char* name)
+	{
+		return tut::sSourceDir + "../integration_tests/llimage_libtest/filters/" + name + ".xml";
+	}
+
+	LLPointer<LLImageRaw> make_image(S32 width, S32 height, S32 components)
+	{
+		LLPointer<LLImageRaw> image = new LLImageRaw(width, height, components);
+		// Smooth gradients with some noise on top, so histograms and edges have something to work with
+		U32 seed = 12345;
+		U8* data = image->getData();
+		for (S32 j = 0; j < height; j++)
+		{
+			for (S32 i = 0; i < width; i++)
+			{
+				for (S32 c = 0; c < components; c++)
+				{
+					seed = seed * 1103515245 + 12345;
+					S32 value = (i * 255) / width + ((c + 1) * j * 255) / (2 * height) + (S32)((seed >> 16) % 64) - 32;
+					*data++ = (U8)llclamp(value % 320, 0, 255);
+				}
+			}
+		}
+		return image;
+	}
+
+	LLPointer<LLImageRaw> copy_image(const LLPointer<LLImageRaw>& src)
+	{
+		LLPointer<LLImageRaw> image = new LLImageRaw(src->getWidth(), src->getHeight(), src->getComponents());
+		memcpy(image->getData(), src->getData(), src->getDataSize());
+		return image;
+	}
+
+	// The filters as they were before they became a pipeline: one full scalar pass over the image for
+	// each step. The pipeline is meant to produce the same bytes.
+	class LLImageFilterReference
+	{
+	public:
+		LLImageFilterReference(const std::string& file_path) :
+			mFilterData(LLSD::emptyArray()),
+			mImage(NULL),
+			mStencilBlendMode(STENCIL_BLEND_MODE_BLEND),
+			mStencilShape(STENCIL_SHAPE_UNIFORM),
+			mStencilMin(0.0f),
+			mStencilMax(1.0f),
+			mStencilGamma(1.0f)
+		{
+			llifstream filter_xml(file_path.c_str());
+			if (filter_xml.is_open())
+			{
+				LLPointer<LLSDXMLParser> parser = new LLSDXMLParser();
+				parser->parse(filter_xml, mFilterData, LLSDSerialize::SIZE_UNLIMITED);
+				filter_xml.close();
+			}
+		}
+
+		S32 getNumSteps() const { return mFilterData.size(); }
+
+		void executeFilter(LLImageRaw* raw_image)
+		{
+			mImage = raw_image;
+			for (S32 i = 0; i < mFilterData.size(); ++i)
+			{
+				const LLSD& step = mFilterData[i];
+				std::string filter_name = step[0].asString();
+				if (filter_name == "stencil")
+				{
+					std::string filter_shape = step[1].asString();
+					EStencilShape shape = STENCIL_SHAPE_UNIFORM;
+					if (filter_shape == "gradient")
+						shape = STENCIL_SHAPE_GRADIENT;
+					else if (filter_shape == "vignette")
+						shape = STENCIL_SHAPE_VIGNETTE;
+					else if (filter_shape == "scanlines")
+						shape = STENCIL_SHAPE_SCAN_LINES;
+					std::string filter_mode = step[2].asString();
+					EStencilBlendMode mode = STENCIL_BLEND_MODE_BLEND;
+					if (filter_mode == "add")
+						mode = STENCIL_BLEND_MODE_ADD;
+					else if (filter_mode == "add_back")
+						mode = STENCIL_BLEND_MODE_ABACK;
+					else if (filter_mode == "fade")
+						mode = STENCIL_BLEND_MODE_FADE;
+					F32 min = (F32)(step[3].asReal());
+					F32 max = (F32)(step[4].asReal());
+					F32 params[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+					for (S32 j = 5; (j < step.size()) && (j < 9); j++)
+					{
+						params[j-5] = (F32)(step[j].asReal());
+					}
+					setStencil(shape,mode,min,max,params);
+				}
+				else if (filter_name == "sepia")
+				{
+					LLMatrix3 sepia;
+					sepia.setRows(LLVector3(0.3588f, 0.7044f, 0.1368f),
+								  LLVector3(0.2990f, 0.5870f, 0.1140f),
+								  LLVector3(0.2392f, 0.4696f, 0.0912f));
+					sepia.transpose();
+					colorTransform(sepia);
+				}
+				else if (filter_name == "grayscale")
+				{
+					LLMatrix3 gray_scale;
+					LLVector3 luminosity(0.2125f, 0.7154f, 0.0721f);
+					gray_scale.setRows(luminosity, luminosity, luminosity);
+					gray_scale.transpose();
+					colorTransform(gray_scale);
+				}
+				else if (filter_name == "saturate")
+				{
+					F32 saturation = (float)(step[1].asReal());
+					LLMatrix3 s;
+					s.setRows(LLVector3(saturation, 0.0f,  0.0f),
+							  LLVector3(0.0f,  saturation, 0.0f),
+							  LLVector3(0.0f,        0.0f,  1.0f));
+					colorTransformLij(s);
+				}
+				else if (filter_name == "rotate")
+				{
+					F32 angle = (float)(step[1].asReal()) * DEG_TO_RAD;
+					LLMatrix3 r;
+					r.setRows(LLVector3( cosf(angle), sinf(angle), 0.0f),
+							  LLVector3(-sinf(angle), cosf(angle), 0.0f),
+							  LLVector3( 0.0f,         0.0f,         1.0f));
+					colorTransformLij(r);
+				}
+				else if (filter_name == "gamma")
+				{
+					filterGamma((float)(step[1].asReal()),getColor(step, 2));
+				}
+				else if (filter_name == "colorize")
+				{
+					filterColorize(getColor(step, 1),getColor(step, 4));
+				}
+				else if (filter_name == "contrast")
+				{
+					filterContrast((float)(step[1].asReal()),getColor(step, 2));
+				}
+				else if (filter_name == "brighten")
+				{
+					filterBrightness((float)(step[1].asReal()),getColor(step, 2));
+				}
+				else if (filter_name == "darken")
+				{
+					filterBrightness((float)(-step[1].asReal()),getColor(step, 2));
+				}
+				else if (filter_name == "linearize")
+				{
+					filterLinearize((float)(step[1].asReal()),getColor(step, 2));
+				}
+				else if (filter_name == "posterize")
+				{
+					filterEqualize((S32)(step[1].asReal()),getColor(step, 2));
+				}
+				else if (filter_name == "screen")
+				{
+					EScreenMode mode = (step[1].asString() == "line" ? SCREEN_MODE_LINE : SCREEN_MODE_2DSINE);
+					filterScreen(mode,(F32)(step[2].asReal()),(F32)(step[3].asReal()));
+				}
+				else if (filter_name == "blur")
+				{
+					LLMatrix3 kernel;
+					for (S32 k = 0; k < NUM_VALUES_IN_MAT3; k++)
+						for (S32 j = 0; j < NUM_VALUES_IN_MAT3; j++)
+							kernel.mMatrix[k][j] = 1.0f;
+					convolve(kernel,true,false);
+				}
+				else if (filter_name == "sharpen")
+				{
+					LLMatrix3 kernel;
+					for (S32 k = 0; k < NUM_VALUES_IN_MAT3; k++)
+						for (S32 j = 0; j < NUM_VALUES_IN_MAT3; j++)
+							kernel.mMatrix[k][j] = -1.0f;
+					kernel.mMatrix[1][1] = 9.0;
+					convolve(kernel,false,false);
+				}
+				else if (filter_name == "gradient")
+				{
+					LLMatrix3 kernel;
+					for (S32 k = 0; k < NUM_VALUES_IN_MAT3; k++)
+						for (S32 j = 0; j < NUM_VALUES_IN_MAT3; j++)
+							kernel.mMatrix[k][j] = -1.0f;
+					kernel.mMatrix[1][1] = 8.0;
+					convolve(kernel,false,true);
+				}
+				else if (filter_name == "convolve")
+				{
+					LLMatrix3 kernel;
+					S32 index = 1;
+					bool normalize = (step[index++].asReal() > 0.0f);
+					bool abs_value = (step[index++].asReal() > 0.0f);
+					for (S32 k = 0; k < NUM_VALUES_IN_MAT3; k++)
+						for (S32 j = 0; j < NUM_VALUES_IN_MAT3; j++)
+							kernel.mMatrix[k][j] = step[index++].asReal();
+					convolve(kernel,normalize,abs_value);
+				}
+				else if (filter_name == "colortransform")
+				{
+					LLMatrix3 transform;
+					S32 index = 1;
+					for (S32 k = 0; k < NUM_VALUES_IN_MAT3; k++)
+						for (S32 j = 0; j < NUM_VALUES_IN_MAT3; j++)
+							transform.mMatrix[k][j] = step[index++].asReal();
+					transform.transpose();
+					colorTransform(transform);
+				}
+			}
+		}
+
+	private:
+		static LLColor3 getColor(const LLSD& step, S32 index)
+		{
+			return LLColor3((float)(step[index].asReal()),(float)(step[index+1].asReal()),(float)(step[index+2].asReal()));
+		}
+
+		void blendStencil(F32 alpha, U8* pixel, U8 red, U8 green, U8 blue)
+		{
+			F32 inv_alpha = 1.0f - alpha;
+			switch (mStencilBlendMode)
+			{
+				case STENCIL_BLEND_MODE_BLEND:
+					pixel[VRED]   = inv_alpha * pixel[VRED]   + alpha * red;
+					pixel[VGREEN] = inv_alpha * pixel[VGREEN] + alpha * green;
+					pixel[VBLUE]  = inv_alpha * pixel[VBLUE]  + alpha * blue;
+					break;
+				case STENCIL_BLEND_MODE_ADD:
+					pixel[VRED]   = llclampb(pixel[VRED]   + alpha * red);
+					pixel[VGREEN] = llclampb(pixel[VGREEN] + alpha * green);
+					pixel[VBLUE]  = llclampb(pixel[VBLUE]  + alpha * blue);
+					break;
+				case STENCIL_BLEND_MODE_ABACK:
+					pixel[VRED]   = llclampb(inv_alpha * pixel[VRED]   + red);
+					pixel[VGREEN] = llclampb(inv_alpha * pixel[VGREEN] + green);
+					pixel[VBLUE]  = llclampb(inv_alpha * pixel[VBLUE]  + blue);
+					break;
+				case STENCIL_BLEND_MODE_FADE:
+					pixel[VRED]   = alpha * red;
+					pixel[VGREEN] = alpha * green;
+					pixel[VBLUE]  = alpha * blue;
+					break;
+			}
+		}
+
+		void colorCorrect(const U8* lut_red, const U8* lut_green, const U8* lut_blue)
+		{
+			const S32 components = mImage->getComponents();
+			U8* dst_data = mImage->getData();
+			for (S32 j = 0; j < mImage->getHeight(); j++)
+			{
+				for (S32 i = 0; i < mImage->getWidth(); i++)
+				{
+					blendStencil(getStencilAlpha(i,j), dst_data, lut_red[dst_data[VRED]], lut_green[dst_data[VGREEN]], lut_blue[dst_data[VBLUE]]);
+					dst_data += components;
+				}
+			}
+		}
+
+		void colorTransform(const LLMatrix3 &transform)
+		{
+			const S32 components = mImage->getComponents();
+			U8* dst_data = mImage->getData();
+			for (S32 j = 0; j < mImage->getHeight(); j++)
+			{
+				for (S32 i = 0; i < mImage->getWidth(); i++)
+				{
+					LLVector3 src((F32)(dst_data[VRED]),(F32)(dst_data[VGREEN]),(F32)(dst_data[VBLUE]));
+					LLVector3 dst = src * transform;
+					dst.clamp(0.0f,255.0f);
+					blendStencil(getStencilAlpha(i,j), dst_data, dst.mV[VRED], dst.mV[VGREEN], dst.mV[VBLUE]);
+					dst_data += components;
+				}
+			}
+		}
+
+		// Applies transform in the Lij color space, as saturate and rotate do
+		void colorTransformLij(const LLMatrix3& transform)
+		{
+			LLMatrix3 r_a;
+			LLMatrix3 r_b;
+			r_a.setRows(LLVector3( OO_SQRT2,  OO_SQRT2, 0.0f),
+						LLVector3(-OO_SQRT2,  OO_SQRT2, 0.0f),
+						LLVector3( 0.0f,       0.0f,      1.0f));
+			float oo_sqrt3 = 1.0f / F_SQRT3;
+			float sin_54 = F_SQRT2 * oo_sqrt3;
+			r_b.setRows(LLVector3(oo_sqrt3, 0.0f, -sin_54),
+						LLVector3(0.0f,      1.0f,  0.0f),
+						LLVector3(sin_54,   0.0f,  oo_sqrt3));
+			LLMatrix3 Lij = r_b * r_a;
+			LLMatrix3 Lij_inv = Lij;
+			Lij_inv.transpose();
+			LLMatrix3 transfo = Lij_inv * transform * Lij;
+			colorTransform(transfo);
+		}
+
+		void convolve(const LLMatrix3 &kernel, bool normalize, bool abs_value)
+		{
+			const S32 components = mImage->getComponents();
+
+			F32 kernel_min = 0.0f;
+			F32 kernel_max = 0.0f;
+			for (S32 i = 0; i < NUM_VALUES_IN_MAT3; i++)
+			{
+				for (S32 j = 0; j < NUM_VALUES_IN_MAT3; j++)
+				{
+					if (kernel.mMatrix[i][j] >= 0.0f)
+						kernel_max += kernel.mMatrix[i][j];
+					else
+						kernel_min += kernel.mMatrix[i][j];
+				}
+			}
+			if (abs_value)
+			{
+				kernel_max = llabs(kernel_max);
+				kernel_min = llabs(kernel_min);
+				kernel_max = llmax(kernel_max,kernel_min);
+				kernel_min = 0.0f;
+			}
+			F32 kernel_range = kernel_max - kernel_min;
+
+			S32 width  = mImage->getWidth();
+			S32 height = mImage->getHeight();
+			U8* dst_data = mImage->getData();
+
+			S32 buffer_size = width * components;
+			std::vector<U8> even_buffer(buffer_size);
+			std::vector<U8> odd_buffer(buffer_size);
+
+			U8* south_data = dst_data + buffer_size;
+			U8* east_west_data;
+			U8* north_data;
+
+			// Line 0 : we set the line to 0
+			memcpy( &even_buffer[0], dst_data, buffer_size );	/* Flawfinder: ignore */
+			for (S32 i = 0; i < width; i++)
+			{
+				blendStencil(getStencilAlpha(i,0), dst_data, 0, 0, 0);
+				dst_data += components;
+			}
+			south_data += buffer_size;
+
+			for (S32 j = 1; j < (height-1); j++)
+			{
+				if (j % 2)
+				{
+					memcpy( &odd_buffer[0], dst_data, buffer_size );	/* Flawfinder: ignore */
+					east_west_data = &odd_buffer[0];
+					north_data = &even_buffer[0];
+				}
+				else
+				{
+					memcpy( &even_buffer[0], dst_data, buffer_size );	/* Flawfinder: ignore */
+					east_west_data = &even_buffer[0];
+					north_data = &odd_buffer[0];
+				}
+				// First pixel : set to 0
+				blendStencil(getStencilAlpha(0,j), dst_data, 0, 0, 0);
+				dst_data += components;
+				U8* NW = north_data;
+				U8* N = NW+components;
+				U8* NE = N+components;
+				U8* W = east_west_data;
+				U8* C = W+components;
+				U8* E = C+components;
+				U8* SW = south_data;
+				U8* S = SW+components;
+				U8* SE = S+components;
+				for (S32 i = 1; i < (width-1); i++)
+				{
+					LLVector3 dst;
+					for (S32 c = VRED; c <= VBLUE; c++)
+					{
+						dst.mV[c] = (kernel.mMatrix[0][0]*NW[c] + kernel.mMatrix[0][1]*N[c] + kernel.mMatrix[0][2]*NE[c] +
+									 kernel.mMatrix[1][0]*W[c]  + kernel.mMatrix[1][1]*C[c] + kernel.mMatrix[1][2]*E[c] +
+									 kernel.mMatrix[2][0]*SW[c] + kernel.mMatrix[2][1]*S[c] + kernel.mMatrix[2][2]*SE[c]);
+						if (abs_value)
+						{
+							dst.mV[c] = llabs(dst.mV[c]);
+						}
+						if (normalize)
+						{
+							dst.mV[c] = (dst.mV[c] - kernel_min)/kernel_range;
+						}
+					}
+					dst.clamp(0.0f,255.0f);
+					blendStencil(getStencilAlpha(i,j), dst_data, dst.mV[VRED], dst.mV[VGREEN], dst.mV[VBLUE]);
+
+					dst_data += components;
+					NW += components;
+					N += components;
+					NE += components;
+					W += components;
+					C += components;
+					E += components;
+					SW += components;
+					S += components;
+					SE += components;
+				}
+				// Last pixel : set to 0
+				blendStencil(getStencilAlpha(width-1,j), dst_data, 0, 0, 0);
+				dst_data += components;
+				south_data += buffer_size;
+			}
+
+			// Last line
+			for (S32 i = 0; i < width; i++)
+			{
+				blendStencil(getStencilAlpha(i,0), dst_data, 0, 0, 0);
+				dst_data += components;
+			}
+		}
+
+		void filterScreen(EScreenMode mode, const F32 wave_length, const F32 angle)
+		{
+			const S32 components = mImage->getComponents();
+			S32 width  = mImage->getWidth();
+			S32 height = mImage->getHeight();
+
+			F32 wave_length_pixels = wave_length * (F32)(height) / 2.0;
+			F32 sin = sinf(angle*DEG_TO_RAD);
+			F32 cos = cosf(angle*DEG_TO_RAD);
+
+			U8 gamma[256];
+			for (S32 i = 0; i < 256; i++)
+			{
+				F32 gamma_i = llclampf((float)(powf((float)(i)/255.0,1.0f/4.0)));
+				gamma[i] = (U8)(255.0f* gamma_i);
+			}
+
+			U8* dst_data = mImage->getData();
+			for (S32 j = 0; j < height; j++)
+			{
+				for (S32 i = 0; i < width; i++)
+				{
+					F32 value = 0.0f;
+					F32 di = 0.0f;
+					F32 dj = 0.0f;
+					switch (mode)
+					{
+						case SCREEN_MODE_2DSINE:
+							di =  cos*i + sin*j;
+							dj = -sin*i + cos*j;
+							value = (sinf(2*F_PI*di/wave_length_pixels)*sinf(2*F_PI*dj/wave_length_pixels)+1.0f)*255.0/2.0;
+							break;
+						case SCREEN_MODE_LINE:
+							dj = sin*i - cos*j;
+							value = (sinf(2*F_PI*dj/wave_length_pixels)+1.0f)*255.0/2.0;
+							break;
+					}
+					U8 dst_value = (dst_data[VRED] >= (U8)(value) ? gamma[dst_data[VRED] - (U8)(value)] : 0);
+					blendStencil(getStencilAlpha(i,j), dst_data, dst_value, dst_value, dst_value);
+					dst_data += components;
+				}
+			}
+		}
+
+		void setStencil(EStencilShape shape, EStencilBlendMode mode, F32 min, F32 max, F32* params)
+		{
+			mStencilShape = shape;
+			mStencilBlendMode = mode;
+			mStencilMin = llmin(llmax(min, -1.0f), 1.0f);
+			mStencilMax = llmin(llmax(max, -1.0f), 1.0f);
+
+			mStencilCenterX = (S32)(mImage->getWidth()  + params[0] * (F32)(mImage->getHeight()))/2;
+			mStencilCenterY = (S32)(mImage->getHeight() + params[1] * (F32)(mImage->getHeight()))/2;
+			mStencilWidth = (S32)(params[2] * (F32)(mImage->getHeight()))/2;
+			mStencilGamma = (params[3] <= 0.0f ? 1.0f : params[3]);
+
+			mStencilWavelength = (params[0] <= 0.0f ? 10.0f : params[0] * (F32)(mImage->getHeight()) / 2.0f);
+			mStencilSine   = sinf(params[1]*DEG_TO_RAD);
+			mStencilCosine = cosf(params[1]*DEG_TO_RAD);
+
+			mStencilStartX = ((F32)(mImage->getWidth())  + params[0] * (F32)(mImage->getHeight()))/2.0f;
+			mStencilStartY = ((F32)(mImage->getHeight()) + params[1] * (F32)(mImage->getHeight()))/2.0f;
+			F32 end_x      = ((F32)(mImage->getWidth())  + params[2] * (F32)(mImage->getHeight()))/2.0f;
+			F32 end_y      = ((F32)(mImage->getHeight()) + params[3] * (F32)(mImage->getHeight()))/2.0f;
+			mStencilGradX  = end_x - mStencilStartX;
+			mStencilGradY  = end_y - mStencilStartY;
+			mStencilGradN  = mStencilGradX*mStencilGradX + mStencilGradY*mStencilGradY;
+		}
+
+		F32 getStencilAlpha(S32 i, S32 j)
+		{
+			F32 alpha = 1.0f;
+			if (mStencilShape == STENCIL_SHAPE_VIGNETTE)
+			{
+				F32 d_center_square = (i - mStencilCenterX)*(i - mStencilCenterX) + (j - mStencilCenterY)*(j - mStencilCenterY);
+				alpha = powf(F_E, -(powf((d_center_square/(mStencilWidth*mStencilWidth)),mStencilGamma)/2.0f));
+			}
+			else if (mStencilShape == STENCIL_SHAPE_SCAN_LINES)
+			{
+				F32 d = mStencilSine*i - mStencilCosine*j;
+				alpha = (sinf(2*F_PI*d/mStencilWavelength) > 0.0f ? 1.0f : 0.0f);
+			}
+			else if (mStencilShape == STENCIL_SHAPE_GRADIENT)
+			{
+				alpha = (((F32)(i) - mStencilStartX)*mStencilGradX + ((F32)(j) - mStencilStartY)*mStencilGradY) / mStencilGradN;
+				alpha = llclampf(alpha);
+			}
+			return (mStencilMin + alpha * (mStencilMax - mStencilMin));
+		}
+
+		// Cumulated brightness histogram of the image, computed once
+		const U32* getCumulatedHistogram()
+		{
+			if (mCumulatedHisto.empty())
+			{
+				mCumulatedHisto.assign(256, 0);
+				const S32 components = mImage->getComponents();
+				S32 pixels = mImage->getWidth() * mImage->getHeight();
+				U8* dst_data = mImage->getData();
+				for (S32 i = 0; i < pixels; i++)
+				{
+					S32 brightness = ((S32)(dst_data[VRED]) + (S32)(dst_data[VGREEN]) + (S32)(dst_data[VBLUE])) / 3;
+					mCumulatedHisto[brightness]++;
+					dst_data += components;
+				}
+				for (S32 i = 1; i < 256; i++)
+				{
+					mCumulatedHisto[i] += mCumulatedHisto[i-1];
+				}
+			}
+			return &mCumulatedHisto[0];
+		}
+
+		// Blends values into the identity with alpha and applies the result
+		void colorCorrectBlended(const U8* values, const LLColor3& alpha)
+		{
+			U8 red_lut[256];
+			U8 green_lut[256];
+			U8 blue_lut[256];
+			for (S32 i = 0; i < 256; i++)
+			{
+				red_lut[i]   = (U8)((1.0f - alpha.mV[0]) * (float)(i) + alpha.mV[0] * values[i]);
+				green_lut[i] = (U8)((1.0f - alpha.mV[1]) * (float)(i) + alpha.mV[1] * values[i]);
+				blue_lut[i]  = (U8)((1.0f - alpha.mV[2]) * (float)(i) + alpha.mV[2] * values[i]);
+			}
+			colorCorrect(red_lut,green_lut,blue_lut);
+		}
+
+		void filterGamma(F32 gamma, const LLColor3& alpha)
+		{
+			U8 gamma_red_lut[256];
+			U8 gamma_green_lut[256];
+			U8 gamma_blue_lut[256];
+			for (S32 i = 0; i < 256; i++)
+			{
+				F32 gamma_i = llclampf((float)(powf((float)(i)/255.0f,1.0f/gamma)));
+				gamma_red_lut[i]   = (U8)((1.0f - alpha.mV[0]) * (float)(i) + alpha.mV[0] * 255.0f * gamma_i);
+				gamma_green_lut[i] = (U8)((1.0f - alpha.mV[1]) * (float)(i) + alpha.mV[1] * 255.0f * gamma_i);
+				gamma_blue_lut[i]  = (U8)((1.0f - alpha.mV[2]) * (float)(i) + alpha.mV[2] * 255.0f * gamma_i);
+			}
+			colorCorrect(gamma_red_lut,gamma_green_lut,gamma_blue_lut);
+		}
+
+		void filterLinearize(F32 tail, const LLColor3& alpha)
+		{
+			const U32* cumulated_histo = getCumulatedHistogram();
+			tail = llclampf(tail);
+			S32 total = cumulated_histo[255];
+			S32 min_c = (S32)((F32)(total) * tail);
+			S32 max_c = (S32)((F32)(total) * (1.0f - tail));
+			S32 min_v = 0;
+			while (cumulated_histo[min_v] < min_c)
+			{
+				min_v++;
+			}
+			S32 max_v = 255;
+			while (cumulated_histo[max_v] > max_c)
+			{
+				max_v--;
+			}
+
+			U8 values[256];
+			if (max_v == min_v)
+			{
+				for (S32 i = 0; i < 256; i++)
+				{
+					values[i] = (i < min_v ? 0 : 255);
+				}
+			}
+			else
+			{
+				F32 slope = 255.0f/ (F32)(max_v - min_v);
+				F32 translate = -min_v * slope;
+				for (S32 i = 0; i < 256; i++)
+				{
+					values[i] = (U8)(llclampb((S32)(slope*i + translate)));
+				}
+			}
+			colorCorrectBlended(values, alpha);
+		}
+
+		void filterEqualize(S32 nb_classes, const LLColor3& alpha)
+		{
+			nb_classes = llmax(nb_classes,2);
+			nb_classes = llclampb(nb_classes);
+			const U32* cumulated_histo = getCumulatedHistogram();
+
+			S32 total = cumulated_histo[255];
+			S32 delta_count = total / nb_classes;
+			S32 current_count = delta_count;
+			S32 delta_value = 256 / (nb_classes - 1);
+			S32 current_value = 0;
+
+			U8 values[256];
+			for (S32 i = 0; i < 256; i++)
+			{
+				values[i] = current_value;
+				if (cumulated_histo[i] >= current_count)
+				{
+					current_count += delta_count;
+					current_value += delta_value;
+					current_value = llclampb(current_value);
+				}
+			}
+			colorCorrectBlended(values, alpha);
+		}
+
+		void filterColorize(const LLColor3& color, const LLColor3& alpha)
+		{
+			U8 red_lut[256];
+			U8 green_lut[256];
+			U8 blue_lut[256];
+			F32 red_composite   =  255.0f * alpha.mV[0] * color.mV[0];
+			F32 green_composite =  255.0f * alpha.mV[1] * color.mV[1];
+			F32 blue_composite  =  255.0f * alpha.mV[2] * color.mV[2];
+			for (S32 i = 0; i < 256; i++)
+			{
+				red_lut[i]   = (U8)(llclampb((S32)((1.0f - alpha.mV[0]) * (F32)(i) + red_composite)));
+				green_lut[i] = (U8)(llclampb((S32)((1.0f - alpha.mV[1]) * (F32)(i) + green_composite)));
+				blue_lut[i]  = (U8)(llclampb((S32)((1.0f - alpha.mV[2]) * (F32)(i) + blue_composite)));
+			}
+			colorCorrect(red_lut,green_lut,blue_lut);
+		}
+
+		void filterContrast(F32 slope, const LLColor3& alpha)
+		{
+			F32 translate = 128.0f * (1.0f - slope);
+			U8 values[256];
+			for (S32 i = 0; i < 256; i++)
+			{
+				values[i] = (U8)(llclampb((S32)(slope*i + translate)));
+			}
+			colorCorrectBlended(values, alpha);
+		}
+
+		void filterBrightness(F32 add, const LLColor3& alpha)
+		{
+			S32 add_value = (S32)(add * 255.0);
+			U8 values[256];
+			for (S32 i = 0; i < 256; i++)
+			{
+				values[i] = (U8)(llclampb(i + add_value));
+			}
+			colorCorrectBlended(values, alpha);
+		}
+
+		LLSD mFilterData;
+		LLImageRaw* mImage;
+		std::vector<U32> mCumulatedHisto;
+
+		EStencilBlendMode mStencilBlendMode;
+		EStencilShape mStencilShape;
+		F32 mStencilMin;
+		F32 mStencilMax;
+
+		S32 mStencilCenterX;
+		S32 mStencilCenterY;
+		S32 mStencilWidth;
+		F32 mStencilGamma;
+
+		F32 mStencilWavelength;
+		F32 mStencilSine;
+		F32 mStencilCosine;
+
+		F32 mStencilStartX;
+		F32 mStencilStartY;
+		F32 mStencilGradX;
+		F32 mStencilGradY;
+		F32 mStencilGradN;
+	};
+}
+
+// -------------------------------------------------------------------------------------------
+// TUT
+// -------------------------------------------------------------------------------------------
+
+namespace tut
+{
+	struct imagefilter_test
+	{
+		imagefilter_test()
+		{
+			LLImageFilter::initClass();
+		}
+		~imagefilter_test()
+		{
+			LLImageFilter::cleanupClass();
+		}
+
+		// Runs every libtest filter through the pipeline and the reference, byte for byte
+		void compareFilters(S32 width, S32 height, S32 components)
+		{
+			LLPointer<LLImageRaw> source = make_image(width, height, components);
+			for (const char* name : FILTER_NAMES)
+			{
+				std::string path = filter_path(name);
+				LLImageFilterReference reference(path);
+				ensure(std::string("loaded ") + name, reference.getNumSteps() > 0);
+
+				LLPointer<LLImageRaw> expected = copy_image(source);
+				reference.executeFilter(expected);
+
+				LLPointer<LLImageRaw> image = copy_image(source);
+				LLImageFilter filter(path);
+				filter.executeFilter(image);
+
+				S32 differences = 0;
+				for (S32 i = 0; i < source->getDataSize(); i++)
+				{
+					differences += (image->getData()[i] != expected->getData()[i]);
+				}
+				ensure_equals(llformat("%s on %dx%dx%d", name, width, height, components), differences, 0);
+			}
+		}
+	};
+
+	typedef test_group<imagefilter_test> imagefilter_t;
+	typedef imagefilter_t::object imagefilter_object_t;
+	tut::imagefilter_t tut_imagefilter("LLImageFilter");
+
+	template<> template<>
+	void imagefilter_object_t::test<1>()
+	{
+		set_test_name("large images, spread over the filter threads");
+		compareFilters(512, 300, 3);
+		compareFilters(333, 257, 4);
+	}
+
+	template<> template<>
+	void imagefilter_object_t::test<2>()
+	{
+		set_test_name("small images, on the calling thread");
+		compareFilters(64, 48, 3);
+		compareFilters(7, 5, 4);
+	}
+
+	template<> template<>
+	void imagefilter_object_t::test<3>()
+	{
+		set_test_name("large images without filter threads");
+		LLImageFilter::cleanupClass();
+		compareFilters(512, 300, 3);
+	}
+}
@@ -0,0 +1,143 @@
+/**
+ * @file llimagesimd_test.cpp
+ * @brief Holds the SSE2 pixel helpers to the scalar code they stand in for
+ *
+ * $LicenseInfo:firstyear=2014&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2014, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+// Helpers to test
+#include "../llimagesimd.h"
+// Reference code
+#include "llmath.h"
+// Tut header
+#include "../test/lltut.h"
+
+#include <cmath>
+
+namespace
+{
+	S32 simd_round(F32 v)
+	{
+		return _mm_cvtsi128_si32(round_ps_epi32(_mm_set1_ps(v)));
+	}
+
+	// v and the floats right next to it
+	void ensure_rounds_like_ll_round(F32 v)
+	{
+		const F32 values[] = { std::nextafter(v, 0.f), v, std::nextafter(v, 16777216.f) };
+		for (F32 value : values)
+		{
+			tut::ensure_equals(llformat("round %.9g", value), simd_round(value), ll_round(value));
+		}
+	}
+
+	// LLImageRaw::fastFractionalMult()
+	U8 fast_fractional_mult(U8 a, U8 b)
+	{
+		U32 i = a * b + 128;
+		return U8((i + (i>>8)) >> 8);
+	}
+}
+
+namespace tut
+{
+	struct imagesimd
+	{
+	};
+
+	typedef test_group<imagesimd> imagesimd_t;
+	typedef imagesimd_t::object imagesimd_object_t;
+	tut::imagesimd_t tut_imagesimd("LLImageSIMD");
+
+	template<> template<>
+	void imagesimd_object_t::test<1>()
+	{
+		set_test_name("round_ps_epi32 rounds like ll_round");
+
+		// The largest float below one half: floor(v + 0.5f) would give 1 here,
+		// since v + 0.5f rounds to 1.0f, round() and round_ps_epi32 give 0.
+		ensure_equals("0.49999997", simd_round(0.49999997f), 0);
+		ensure_equals("ll_round 0.49999997", ll_round(0.49999997f), 0);
+		ensure_equals("0.5", simd_round(0.5f), 1);
+		ensure_equals("0", simd_round(0.f), 0);
+
+		// Halfway points and their neighbours over the pixel range and beyond
+		for (S32 k = 0; k < 1024; ++k)
+		{
+			ensure_rounds_like_ll_round(k + 0.5f);
+			ensure_rounds_like_ll_round((F32)k);
+		}
+
+		// Everything the resamplers produce in steps finer than their weights
+		for (S32 i = 0; i < 256 * 1024; ++i)
+		{
+			F32 v = i / 1024.f;
+			ensure_equals(llformat("round %.9g", v), simd_round(v), ll_round(v));
+		}
+
+		// Top of the range, where the fraction is still exact
+		ensure_rounds_like_ll_round(8388607.5f);
+		ensure_rounds_like_ll_round(4194303.5f);
+	}
+
+	template<> template<>
+	void imagesimd_object_t::test<2>()
+	{
+		set_test_name("integer helpers match the scalar code");
+
+		for (U32 a = 0; a < 256; ++a)
+		{
+			for (U32 b = 0; b < 256; b += 8)
+			{
+				__m128i va = _mm_set1_epi16((S16)a);
+				__m128i vb = _mm_setr_epi16((S16)b, (S16)(b + 1), (S16)(b + 2), (S16)(b + 3),
+											(S16)(b + 4), (S16)(b + 5), (S16)(b + 6), (S16)(b + 7));
+				S16 result[8];
+				_mm_storeu_si128((__m128i*)result, fast_fractional_mult_epi16(va, vb));
+				for (U32 j = 0; j < 8; ++j)
+				{
+					ensure_equals(llformat("fractional mult %u * %u", a, b + j), (U32)result[j],
+								  (U32)fast_fractional_mult((U8)a, (U8)(b + j)));
+				}
+			}
+		}
+
+		S32 products[4];
+		_mm_storeu_si128((__m128i*)products,
+						 ll_mullo_epi32(_mm_setr_epi32(-3, 70000, 255, -65536), _mm_setr_epi32(7, 70000, -255, 65536)));
+		ensure_equals("mullo 0", products[0], -21);
+		ensure_equals("mullo 1", products[1], (S32)(70000U * 70000U));
+		ensure_equals("mullo 2", products[2], -65025);
+		ensure_equals("mullo 3", products[3], 0);
+
+		const U8 pixel[4] = { 0, 1, 128, 255 };
+		U8 stored[4];
+		store_pixel_epi32(stored, load_pixel_epi32(pixel));
+		ensure("pixel round trip", !memcmp(stored, pixel, sizeof(pixel)));
+		store_pixel_epi32(stored, _mm_setr_epi32(0x100, 0x1ff, -1, 0x12345));
+		ensure_equals("low byte 0", (U32)stored[0], 0x00U);
+		ensure_equals("low byte 1", (U32)stored[1], 0xffU);
+		ensure_equals("low byte 2", (U32)stored[2], 0xffU);
+		ensure_equals("low byte 3", (U32)stored[3], 0x45U);
+	}
+}
@@ -246,6 +246,39 @@ namespace tut
 		ensure("LLImageDecodeThread: threaded work unit not processed", done == true);
 	}
 
+	template<> template<>
+	void imagedecodethread_object_t::test<3>()
+	{
+		// Test a threaded instance with an explicit pool of workers
+		mThread = new LLImageDecodeThread(true, 4);
+		ensure_equals("LLImageDecodeThread: pool size incorrect", mThread->getPoolSize(), 4U);
+		// Queue more work orders than there are workers
+		const S32 NUM_REQUESTS = 8;
+		bool done[NUM_REQUESTS];
+		for (S32 i = 0; i < NUM_REQUESTS; ++i)
+		{
+			mThread->decodeImage(NULL, LLQueuedThread::PRIORITY_NORMAL, 0, FALSE, new responder_test(&done[i]));
+		}
+		mThread->update(1);
+		const U32 INCREMENT_TIME = 100;				// 100 milliseconds
+		const U32 MAX_TIME = 100 * INCREMENT_TIME;	// wait 10 seconds but no more
+		U32 total_time = 0;
+		S32 num_done = 0;
+		while ((num_done < NUM_REQUESTS) && (total_time < MAX_TIME))
+		{
+			ms_sleep(INCREMENT_TIME);
+			total_time += INCREMENT_TIME;
+			mThread->update(1);
+			num_done = 0;
+			for (S32 i = 0; i < NUM_REQUESTS; ++i)
+			{
+				num_done += done[i] ? 1 : 0;
+			}
+		}
+		// Verifies that every work order went through the pool
+		ensure_equals("LLImageDecodeThread: pool did not process every work unit", num_done, NUM_REQUESTS);
+	}
+
 	// ---------------------------------------------------------------------------------------
 	// Test the LLImageDecodeThread::ImageRequest interface
 	// ---------------------------------------------------------------------------------------
@@ -50,6 +50,7 @@
 #include "llvolumeoctree.h"
 #include "llstl.h"
 #include "llsdserialize.h"
+#include "llsdview.h"
 #include "llvector4a.h"
 #include "llmatrix4a.h"
 #include "lltimer.h"
@@ -681,7 +682,8 @@ LLProfile::Face* LLProfile::addHole(const LLProfileParams& params, BOOL flat, F3
 
 	Face *face = addFace(mTotalOut, mTotal-mTotalOut,0,LL_FACE_INNER_SIDE, flat);
 
-	static LLAlignedArray<LLVector4a,64> pt;
+	// Not static: volumes are also built on LLVolumeMgr's build threads
+	LLAlignedArray<LLVector4a,64> pt;
 	pt.resize(mTotal) ;
 
 	for (S32 i=mTotalOut;i<mTotal;i++)
@@ -2040,8 +2042,6 @@ LLProfile::~LLProfile()
 }
 
 
-S32 LLVolume::sNumMeshPoints = 0;
-
 LLVolume::LLVolume(const LLVolumeParams &params, const F32 detail, const BOOL generate_single_face, const BOOL is_unique)
 	: mParams(params)
 {
@@ -2098,7 +2098,6 @@ void LLVolume::genTangents(S32 face)
 
 LLVolume::~LLVolume()
 {
-	sNumMeshPoints -= mMesh.size();
 	delete mPathp;
 
 	profile_delete_lock.fetch_add(1);
@@ -2165,9 +2164,7 @@ BOOL LLVolume::generate()
 		S32 sizeS = mPathp->mPath.size();
 		S32 sizeT = mProfilep->mProfile.size();
 
-		sNumMeshPoints -= mMesh.size();
 		mMesh.resize(sizeT * sizeS);
-		sNumMeshPoints += mMesh.size();		
 
 		//generate vertex positions
 
@@ -2367,16 +2364,51 @@ bool LLVolumeFace::VertexData::compareNormal(const LLVolumeFace::VertexData& rhs
 	return retval;
 }
 
+// Unaligned little endian U16 from a binary LLSD blob.
+static inline U16 load_mesh_u16(const U8* p)
+{
+	U16 value;
+	memcpy(&value, p, sizeof(U16));
+	return value;
+}
+
+static void load_mesh_domain(const LLSDView& domain, F32* out, U32 count)
+{
+	for (U32 i = 0; i < count; ++i)
+	{
+		out[i] = (F32) domain[(S32) i].asReal();
+	}
+}
+
 bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
 {
 	//input stream is now pointing at a zlib compressed block of LLSD
-	//decompress block
-	LLSD mdl;
-	if (!unzip_llsd(mdl, is, size))
+	if (size <= 0)
+	{
+		return false;
+	}
+	std::vector<U8> data(size);
+	is.read((char*) &data[0], size);
+	return unpackVolumeFaces(&data[0], size);
+}
+
+bool LLVolume::unpackVolumeFaces(const U8* data, S32 size)
+{
+	//decompress block and read it in place, the vertex streams are
+	//decoded straight out of the inflated buffer
+	std::vector<U8> block;
+	if (!unzip_llsd_binary(block, data, size))
 	{
 		LL_DEBUGS("MeshStreaming") << "Failed to unzip LLSD blob for LoD, will probably fetch from sim again." << LL_ENDL;
 		return false;
 	}
+
+	LLSDView mdl(block.empty() ? NULL : &block[0], block.size());
+	if (!mdl.isValid())
+	{
+		LL_WARNS() << "Failed to unzip LLSD block" << LL_ENDL;
+		return false;
+	}
 	
 	{
 		U32 face_count = mdl.size();
@@ -2389,11 +2421,13 @@ bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
 
 		mVolumeFaces.resize(face_count);
 
-		for (U32 i = 0; i < face_count; ++i)
+		LLSDView::array_const_iterator face_iter = mdl.beginArray();
+		for (U32 i = 0; i < face_count; ++i, ++face_iter)
 		{
 			LLVolumeFace& face = mVolumeFaces[i];
+			const LLSDView face_sd = mdl.isArray() ? *face_iter : LLSDView();
 
-			if (mdl[i].has("NoGeometry"))
+			if (face_sd.has("NoGeometry"))
 			{ //face has no geometry, continue
 				face.resizeIndices(3);
 				face.resizeVertices(1);
@@ -2404,31 +2438,25 @@ bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
 				continue;
 			}
 
-			LLSD::Binary pos = mdl[i]["Position"];
-			LLSD::Binary norm = mdl[i]["Normal"];
-			LLSD::Binary tc = mdl[i]["TexCoord0"];
-			LLSD::Binary idx = mdl[i]["TriangleList"];
-
-			
+			const LLSDView pos = face_sd["Position"];
+			const LLSDView norm = face_sd["Normal"];
+			const LLSDView tc = face_sd["TexCoord0"];
+			const LLSDView idx = face_sd["TriangleList"];
 
 			//copy out indices
-			face.resizeIndices(idx.size()/2);
+			U32 count = (U32) idx.binarySize()/2;
+			face.resizeIndices(count);
 			
-			if (idx.empty() || face.mNumIndices < 3)
+			if (!count || face.mNumIndices < 3)
 			{ //why is there an empty index list?
 				LL_WARNS() <<"Empty face present!" << LL_ENDL;
 				continue;
 			}
 
-			U16* indices = (U16*) &(idx[0]);
-			U32 count = idx.size()/2;
-			for (U32 j = 0; j < count; ++j)
-			{
-				face.mIndices[j] = indices[j];
-			}
+			memcpy(face.mIndices, idx.binaryData(), count * sizeof(U16));
 
 			//copy out vertices
-			U32 num_verts = pos.size()/(3*2);
+			U32 num_verts = (U32) pos.binarySize()/(3*2);
 			face.resizeVertices(num_verts);
 
 			LLVector3 minp;
@@ -2436,14 +2464,14 @@ bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
 			LLVector2 min_tc; 
 			LLVector2 max_tc; 
 		
-			minp.setValue(mdl[i]["PositionDomain"]["Min"]);
-			maxp.setValue(mdl[i]["PositionDomain"]["Max"]);
+			load_mesh_domain(face_sd["PositionDomain"]["Min"], minp.mV, 3);
+			load_mesh_domain(face_sd["PositionDomain"]["Max"], maxp.mV, 3);
 			LLVector4a min_pos, max_pos;
 			min_pos.load3(minp.mV);
 			max_pos.load3(maxp.mV);
 
-			min_tc.setValue(mdl[i]["TexCoord0Domain"]["Min"]);
-			max_tc.setValue(mdl[i]["TexCoord0Domain"]["Max"]);
+			load_mesh_domain(face_sd["TexCoord0Domain"]["Min"], min_tc.mV, 2);
+			load_mesh_domain(face_sd["TexCoord0Domain"]["Max"], max_tc.mV, 2);
 
 			LLVector4a pos_range;
 			pos_range.setSub(max_pos, min_pos);
@@ -2458,31 +2486,33 @@ bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
 			LLVector4a* tc_out = (LLVector4a*) face.mTexCoords;
 
 			{
-				U16* v = (U16*) &(pos[0]);
+				const U8* v = pos.binaryData();
 				for (U32 j = 0; j < num_verts; ++j)
 				{
-					pos_out->set((F32) v[0], (F32) v[1], (F32) v[2]);
+					pos_out->set((F32) load_mesh_u16(v), (F32) load_mesh_u16(v + 2), (F32) load_mesh_u16(v + 4));
 					pos_out->div(65535.f);
 					pos_out->mul(pos_range);
 					pos_out->add(min_pos);
 					pos_out++;
-					v += 3;
+					v += 6;
 				}
 
 			}
 
 			{
-				if (!norm.empty())
+				// the streams point into the shared block, so a short one
+				// must not be read past its end
+				if (norm.binarySize() >= num_verts * 6)
 				{
-					U16* n = (U16*) &(norm[0]);
+					const U8* n = norm.binaryData();
 					for (U32 j = 0; j < num_verts; ++j)
 					{
-						norm_out->set((F32) n[0], (F32) n[1], (F32) n[2]);
+						norm_out->set((F32) load_mesh_u16(n), (F32) load_mesh_u16(n + 2), (F32) load_mesh_u16(n + 4));
 						norm_out->div(65535.f);
 						norm_out->mul(2.f);
 						norm_out->sub(1.f);
 						norm_out++;
-						n += 3;
+						n += 6;
 					}
 				}
 				else
@@ -2492,21 +2522,21 @@ bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
 			}
 
 			{
-				if (!tc.empty())
+				if (tc.binarySize() >= num_verts * 4)
 				{
-					U16* t = (U16*) &(tc[0]);
+					const U8* t = tc.binaryData();
 					for (U32 j = 0; j < num_verts; j+=2)
 					{
 						if (j < num_verts-1)
 						{
-							tc_out->set((F32) t[0], (F32) t[1], (F32) t[2], (F32) t[3]);
+							tc_out->set((F32) load_mesh_u16(t), (F32) load_mesh_u16(t + 2), (F32) load_mesh_u16(t + 4), (F32) load_mesh_u16(t + 6));
 						}
 						else
 						{
-							tc_out->set((F32) t[0], (F32) t[1], 0.f, 0.f);
+							tc_out->set((F32) load_mesh_u16(t), (F32) load_mesh_u16(t + 2), 0.f, 0.f);
 						}
 
-						t += 4;
+						t += 8;
 
 						tc_out->div(65535.f);
 						tc_out->mul(tc_range);
@@ -2521,16 +2551,18 @@ bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
 				}
 			}
 
-			if (mdl[i].has("Weights"))
+			const LLSDView weights_sd = face_sd["Weights"];
+			if (weights_sd.isValid())
 			{
 				face.allocateWeights(num_verts);
 
-				LLSD::Binary weights = mdl[i]["Weights"];
+				const U8* weights = weights_sd.binaryData();
+				const U32 weights_size = (U32) weights_sd.binarySize();
 
 				U32 idx = 0;
 
 				U32 cur_vertex = 0;
-				while (idx < weights.size() && cur_vertex < num_verts)
+				while (idx < weights_size && cur_vertex < num_verts)
 				{
 					const U8 END_INFLUENCES = 0xFF;
 					U8 joint = weights[idx++];
@@ -2540,7 +2572,7 @@ bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
                     U32 joints[4] = {0,0,0,0};
 					LLVector4 joints_with_weights(0,0,0,0);
 
-					while (joint != END_INFLUENCES && idx < weights.size())
+					while (joint != END_INFLUENCES && idx < weights_size)
 					{
 						U16 influence = weights[idx++];
 						influence |= ((U16) weights[idx++] << 8);
@@ -2577,7 +2609,7 @@ bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
 					cur_vertex++;
 				}
 
-				if (cur_vertex != num_verts || idx != weights.size())
+				if (cur_vertex != num_verts || idx != weights_size)
 				{
 					LL_WARNS() << "Vertex weight count does not match vertex count!" << LL_ENDL;
 				}
@@ -2690,6 +2722,188 @@ bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
 }
 
 
+// Layout written by packDecodedFaces(): a DecodedFacesHeader, then for
+// each face a DecodedFaceHeader followed by its positions, normals, texture
+// coordinates, indices and, if flagged, weights.  Each part starts on a 16
+// byte boundary.  Bump the version whenever unpackVolumeFaces() changes
+// what it produces.
+const U32 DECODED_FACES_MAGIC = 0x46444c4c; // "LLDF"
+const U32 DECODED_FACES_VERSION = 1;
+const U32 DECODED_FACE_HAS_WEIGHTS = 0x1;
+
+struct DecodedFacesHeader
+{
+	U32 mMagic;
+	U32 mVersion;
+	U32 mNumFaces;
+	U32 mPad;
+};
+
+struct DecodedFaceHeader
+{
+	S32 mNumVertices;
+	S32 mNumIndices;
+	U32 mFlags;
+	U32 mPad;
+	F32 mExtents[8];
+	F32 mTexCoordExtents[4];
+};
+
+static inline size_t pad_16(size_t size)
+{
+	return (size + 0xF) & ~(size_t) 0xF;
+}
+
+static size_t decoded_face_size(S32 num_vertices, S32 num_indices, bool weights)
+{
+	size_t size = sizeof(DecodedFaceHeader)
+		+ 2 * num_vertices * sizeof(LLVector4a)
+		+ pad_16(num_vertices * sizeof(LLVector2))
+		+ pad_16(num_indices * sizeof(U16));
+	if (weights)
+	{
+		size += num_vertices * sizeof(LLVector4a);
+	}
+	return size;
+}
+
+void LLVolume::packDecodedFaces(std::vector<U8>& data) const
+{
+	size_t size = sizeof(DecodedFacesHeader);
+	for (const LLVolumeFace& face : mVolumeFaces)
+	{
+		size += decoded_face_size(face.mPositions ? face.mNumVertices : 0, face.mIndices ? face.mNumIndices : 0, face.mWeights != nullptr);
+	}
+
+	// Zero filled, so the padding is too
+	data.assign(size, 0);
+	U8* dst = &data[0];
+
+	DecodedFacesHeader header = {};
+	header.mMagic = DECODED_FACES_MAGIC;
+	header.mVersion = DECODED_FACES_VERSION;
+	header.mNumFaces = (U32) mVolumeFaces.size();
+	memcpy(dst, &header, sizeof(header));
+	dst += sizeof(header);
+
+	for (const LLVolumeFace& face : mVolumeFaces)
+	{
+		DecodedFaceHeader face_header = {};
+		face_header.mNumVertices = face.mPositions ? face.mNumVertices : 0;
+		face_header.mNumIndices = face.mIndices ? face.mNumIndices : 0;
+		face_header.mFlags = face.mWeights ? DECODED_FACE_HAS_WEIGHTS : 0;
+		memcpy(face_header.mExtents, face.mExtents[0].getF32ptr(), 4 * sizeof(F32));
+		memcpy(face_header.mExtents + 4, face.mExtents[1].getF32ptr(), 4 * sizeof(F32));
+		memcpy(face_header.mTexCoordExtents, face.mTexCoordExtents[0].mV, 2 * sizeof(F32));
+		memcpy(face_header.mTexCoordExtents + 2, face.mTexCoordExtents[1].mV, 2 * sizeof(F32));
+		memcpy(dst, &face_header, sizeof(face_header));
+		dst += sizeof(face_header);
+
+		const size_t num_vertices = face_header.mNumVertices;
+		memcpy(dst, face.mPositions, num_vertices * sizeof(LLVector4a));
+		dst += num_vertices * sizeof(LLVector4a);
+		memcpy(dst, face.mNormals, num_vertices * sizeof(LLVector4a));
+		dst += num_vertices * sizeof(LLVector4a);
+		memcpy(dst, face.mTexCoords, num_vertices * sizeof(LLVector2));
+		dst += pad_16(num_vertices * sizeof(LLVector2));
+		memcpy(dst, face.mIndices, face_header.mNumIndices * sizeof(U16));
+		dst += pad_16(face_header.mNumIndices * sizeof(U16));
+		if (face.mWeights)
+		{
+			memcpy(dst, face.mWeights, num_vertices * sizeof(LLVector4a));
+			dst += num_vertices * sizeof(LLVector4a);
+		}
+	}
+
+	llassert(dst == &data[0] + size);
+}
+
+bool LLVolume::unpackDecodedFaces(const U8* data, size_t size)
+{
+	DecodedFacesHeader header;
+	if (!data || size < sizeof(header))
+	{
+		return false;
+	}
+	memcpy(&header, data, sizeof(header));
+	if (header.mMagic != DECODED_FACES_MAGIC
+		|| header.mVersion != DECODED_FACES_VERSION
+		|| header.mNumFaces == 0
+		|| header.mNumFaces > (size - sizeof(header)) / sizeof(DecodedFaceHeader))
+	{
+		return false;
+	}
+
+	const U8* src = data + sizeof(header);
+	const U8* end = data + size;
+
+	std::vector<LLVolumeFace> faces(header.mNumFaces);
+	for (LLVolumeFace& face : faces)
+	{
+		DecodedFaceHeader face_header;
+		if ((size_t) (end - src) < sizeof(face_header))
+		{
+			return false;
+		}
+		memcpy(&face_header, src, sizeof(face_header));
+		src += sizeof(face_header);
+
+		const bool weights = (face_header.mFlags & DECODED_FACE_HAS_WEIGHTS) != 0;
+		if (face_header.mNumVertices < 0 || face_header.mNumVertices > 65536
+			|| face_header.mNumIndices < 0
+			|| (face_header.mNumIndices > 0 && face_header.mNumVertices == 0)
+			|| decoded_face_size(face_header.mNumVertices, face_header.mNumIndices, weights) - sizeof(face_header) > (size_t) (end - src))
+		{
+			return false;
+		}
+
+		const size_t num_vertices = face_header.mNumVertices;
+		face.resizeVertices(face_header.mNumVertices);
+		face.resizeIndices(face_header.mNumIndices);
+		if (num_vertices)
+		{
+			memcpy(face.mPositions, src, num_vertices * sizeof(LLVector4a));
+			src += num_vertices * sizeof(LLVector4a);
+			memcpy(face.mNormals, src, num_vertices * sizeof(LLVector4a));
+			src += num_vertices * sizeof(LLVector4a);
+			memcpy(face.mTexCoords, src, num_vertices * sizeof(LLVector2));
+			src += pad_16(num_vertices * sizeof(LLVector2));
+		}
+		if (face_header.mNumIndices)
+		{
+			memcpy(face.mIndices, src, face_header.mNumIndices * sizeof(U16));
+			src += pad_16(face_header.mNumIndices * sizeof(U16));
+
+			// A damaged file must not send the renderer off the end of the vertices
+			for (S32 i = 0; i < face_header.mNumIndices; ++i)
+			{
+				if (face.mIndices[i] >= num_vertices)
+				{
+					return false;
+				}
+			}
+		}
+		if (weights)
+		{
+			face.allocateWeights(face_header.mNumVertices);
+			memcpy(face.mWeights, src, num_vertices * sizeof(LLVector4a));
+			src += num_vertices * sizeof(LLVector4a);
+		}
+
+		face.mExtents[0].loadua(face_header.mExtents);
+		face.mExtents[1].loadua(face_header.mExtents + 4);
+		face.mTexCoordExtents[0].set(face_header.mTexCoordExtents[0], face_header.mTexCoordExtents[1]);
+		face.mTexCoordExtents[1].set(face_header.mTexCoordExtents[2], face_header.mTexCoordExtents[3]);
+
+		// Already vertex cache optimized before it was packed
+		face.mOptimized = TRUE;
+	}
+
+	mVolumeFaces.swap(faces);
+	mSculptLevel = 0;
+	return true;
+}
+
 BOOL LLVolume::isMeshAssetLoaded()
 {
 	return mIsMeshAssetLoaded;
@@ -3136,9 +3350,7 @@ void LLVolume::sculpt(U16 sculpt_width, U16 sculpt_height, S8 sculpt_components,
 		LL_WARNS() << "sculpt bad mesh size " << sizeS << " " << sizeT << LL_ENDL;
 	}
 	
-	sNumMeshPoints -= mMesh.size();
 	mMesh.resize(sizeS * sizeT);
-	sNumMeshPoints += mMesh.size();
 
 	//generate vertex positions
 	if (!data_is_empty)
@@ -6645,7 +6857,8 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 
 	LLVector4a* norm = mNormals;
 
-	static LLAlignedArray<LLVector4a, 64> triangle_normals;
+	// Not static, see LLProfile::addHole()
+	LLAlignedArray<LLVector4a, 64> triangle_normals;
 	triangle_normals.resize(count);
 	LLVector4a* output = triangle_normals.mArray;
 	LLVector4a* end_output = output+count;
@@ -1043,7 +1043,6 @@ public:
 	LLFaceID generateFaceMask();
 
 	BOOL isFaceMaskValid(LLFaceID face_mask);
-	static S32 sNumMeshPoints;
 
 	friend std::ostream& operator<<(std::ostream &s, const LLVolume &volume);
 	friend std::ostream& operator<<(std::ostream &s, const LLVolume *volumep);		// HACK to bypass Windoze confusion over 
@@ -1075,6 +1074,14 @@ protected:
 	void createVolumeFaces();
 public:
 	virtual bool unpackVolumeFaces(std::istream& is, S32 size);
+	// As above, from the compressed block in a buffer
+	bool unpackVolumeFaces(const U8* data, S32 size);
+
+	// The faces exactly as unpackVolumeFaces() left them, in a flat
+	// versioned layout with every stream 16 byte aligned.  Loading it back
+	// is a copy per stream, for caches of already decoded meshes.
+	void packDecodedFaces(std::vector<U8>& data) const;
+	bool unpackDecodedFaces(const U8* data, size_t size);
 
 	virtual void setMeshAssetLoaded(BOOL loaded);
 	virtual BOOL isMeshAssetLoaded();
@@ -30,9 +30,38 @@
 #include "llvolumemgr.h"
 #include "llvolume.h"
 
+#include "llformat.h"
+#include "llstl.h"
+#include "lltrace.h"
+#include "llvolumeoctree.h"
+
 
 const F32 BASE_THRESHOLD = 0.03f;
 
+static LLTrace::CountStatHandle<> sRetainedHits("volumeretainedhits", "Number of prim volumes reused after their last reference went away");
+static LLTrace::CountStatHandle<> sRetainedMisses("volumeretainedmisses", "Number of prim volumes built because none was retained");
+
+// Roughly what a built volume face holds on to
+static U32 volume_face_bytes(const LLVolumeFace& face)
+{
+	U32 bytes = face.mNumVertices * 2 * sizeof(LLVector4a);
+	bytes += (face.mNumVertices * sizeof(LLVector2) + 0xF) & ~0xF;
+	bytes += face.mNumIndices * sizeof(U16);
+	if (face.mTangents)
+	{
+		bytes += face.mNumVertices * sizeof(LLVector4a);
+	}
+	if (face.mWeights)
+	{
+		bytes += face.mNumVertices * sizeof(LLVector4a);
+	}
+	if (face.mOctree)
+	{
+		bytes += face.mNumIndices / 3 * sizeof(LLVolumeTriangle);
+	}
+	return bytes;
+}
+
 //static
 F32 LLVolumeLODGroup::mDetailThresholds[NUM_LODS] = {BASE_THRESHOLD,
 													 2*BASE_THRESHOLD,
@@ -46,7 +75,10 @@ F32 LLVolumeLODGroup::mDetailScales[NUM_LODS] = {1.f, 1.5f, 2.5f, 4.f};
 //============================================================================
 
 LLVolumeMgr::LLVolumeMgr()
-:	mDataMutex(nullptr)
+:	mDataMutex(nullptr),
+	mRetainedBytes(0),
+	mRetentionBudget(0),
+	mNumPendingBuilds(0)
 {
 	// the LLMutex magic interferes with easy unit testing,
 	// so you now must manually call useMutex() to use it
@@ -63,11 +95,16 @@ LLVolumeMgr::~LLVolumeMgr()
 
 BOOL LLVolumeMgr::cleanup()
 {
+	stopBuildThreads();
+
 	BOOL no_refs = TRUE;
 	if (mDataMutex)
 	{
 		mDataMutex->lock();
 	}
+	mRetainedMap.clear();
+	mRetainedList.clear();
+	mRetainedBytes = 0;
 	for (volume_lod_group_map_t::iterator iter = mVolumeLODGroups.begin(),
 			 end = mVolumeLODGroups.end();
 		 iter != end; iter++)
@@ -102,6 +139,14 @@ LLVolume* LLVolumeMgr::refVolume(const LLVolumeParams &volume_params, const S32
 	if( iter == mVolumeLODGroups.end() )
 	{
 		volgroupp = createNewGroup(volume_params);
+		if (restoreLODs(volgroupp, detail))
+		{
+			add(sRetainedHits, 1);
+		}
+		else if (mRetentionBudget)
+		{
+			add(sRetainedMisses, 1);
+		}
 	}
 	else
 	{
@@ -164,6 +209,7 @@ void LLVolumeMgr::unrefVolume(LLVolume *volumep)
 		if (volgroupp->getNumRefs() == 0)
 		{
 			mVolumeLODGroups.erase(params);
+			retainLODs(volgroupp);
 			delete volgroupp;
 		}
 	}
@@ -220,6 +266,268 @@ void LLVolumeMgr::useMutex()
 	}
 }
 
+void LLVolumeMgr::setRetentionBudget(U32 max_bytes)
+{
+	if (mDataMutex)
+	{
+		mDataMutex->lock();
+	}
+	mRetentionBudget = max_bytes;
+	trimRetained(mRetentionBudget);
+	if (mDataMutex)
+	{
+		mDataMutex->unlock();
+	}
+}
+
+// Only procedural prims: sculpt and mesh volumes are filled in afterwards
+// from assets, and would come back in whatever state they were left.
+void LLVolumeMgr::retainLODs(LLVolumeLODGroup* volgroupp)
+{
+	const LLVolumeParams& volume_params = *volgroupp->getVolumeParams();
+	if (!mRetentionBudget
+		|| volume_params.getSculptType() != LL_SCULPT_TYPE_NONE
+		|| volume_params.getSculptID().notNull())
+	{
+		return;
+	}
+
+	for (S32 i = 0; i < LLVolumeLODGroup::NUM_LODS; ++i)
+	{
+		LLVolume* volumep = volgroupp->getLOD(i);
+		if (!volumep)
+		{
+			continue;
+		}
+
+		RetainedVolume retained;
+		retained.mVolume = volumep;
+		retained.mDetail = i;
+		retained.mBytes = 0;
+		for (S32 f = 0; f < volumep->getNumVolumeFaces(); ++f)
+		{
+			// Vertex buffers belong to the objects that drew this volume
+			volumep->getVolumeFace(f).mVertexBuffer = nullptr;
+			retained.mBytes += volume_face_bytes(volumep->getVolumeFace(f));
+		}
+		if (retained.mBytes > mRetentionBudget)
+		{
+			continue;
+		}
+
+		// A group is only created when none exists, so nothing with these
+		// params and detail can be retained already
+		mRetainedList.push_front(retained);
+		mRetainedMap[std::make_pair(volume_params, i)] = mRetainedList.begin();
+		mRetainedBytes += retained.mBytes;
+	}
+
+	trimRetained(mRetentionBudget);
+}
+
+// Moves every retained LOD of the group's params back into it.  Returns
+// true if detail was among them.
+bool LLVolumeMgr::restoreLODs(LLVolumeLODGroup* volgroupp, const S32 detail)
+{
+	if (mRetainedMap.empty())
+	{
+		return false;
+	}
+
+	bool found = false;
+	const LLVolumeParams& volume_params = *volgroupp->getVolumeParams();
+	for (S32 i = 0; i < LLVolumeLODGroup::NUM_LODS; ++i)
+	{
+		retained_map_t::iterator iter = mRetainedMap.find(std::make_pair(volume_params, i));
+		if (iter != mRetainedMap.end())
+		{
+			volgroupp->setLOD(i, iter->second->mVolume);
+			mRetainedBytes -= iter->second->mBytes;
+			mRetainedList.erase(iter->second);
+			mRetainedMap.erase(iter);
+			found |= (i == detail);
+		}
+	}
+	return found;
+}
+
+void LLVolumeMgr::trimRetained(U32 max_bytes)
+{
+	while (!mRetainedList.empty() && mRetainedBytes > max_bytes)
+	{
+		const RetainedVolume& oldest = mRetainedList.back();
+		mRetainedMap.erase(std::make_pair(oldest.mVolume->getParams(), oldest.mDetail));
+		mRetainedBytes -= oldest.mBytes;
+		mRetainedList.pop_back();
+	}
+}
+
+void LLVolumeMgr::startBuildThreads(U32 num_threads)
+{
+	for (U32 i = 0; i < num_threads; ++i)
+	{
+		BuildThread* thread = new BuildThread(llformat("volumebuild %d", i), this);
+		mBuildThreads.push_back(thread);
+		thread->start();
+	}
+	LL_INFOS() << "Volume manager using " << num_threads << " build threads" << LL_ENDL;
+}
+
+void LLVolumeMgr::stopBuildThreads()
+{
+	for (BuildThread* thread : mBuildThreads)
+	{
+		thread->shutdown();
+	}
+	std::for_each(mBuildThreads.begin(), mBuildThreads.end(), DeletePointer());
+	mBuildThreads.clear();
+
+	std::for_each(mBuilds.begin(), mBuilds.end(), DeletePointer());
+	mBuilds.clear();
+	mNumPendingBuilds = 0;
+}
+
+bool LLVolumeMgr::requestVolume(const LLVolumeParams& volume_params, const S32 detail)
+{
+	if (mBuildThreads.empty())
+	{
+		return true;
+	}
+
+	LLVolumeLODGroup* volgroupp = getGroup(volume_params);
+	if (volgroupp && volgroupp->isLODBuilt(detail))
+	{
+		return true;
+	}
+
+	{
+		LLMutexLock lock(&mBuildCondition);
+		for (const Build* build : mBuilds)
+		{
+			if (build->mDetail == detail && build->mParams == volume_params)
+			{
+				return false;
+			}
+		}
+		mBuilds.push_back(new Build(volume_params, detail));
+		++mNumPendingBuilds;
+	}
+
+	for (BuildThread* thread : mBuildThreads)
+	{
+		thread->wake();
+	}
+	return false;
+}
+
+void LLVolumeMgr::publishBuiltVolumes(std::vector<std::pair<LLVolumeParams, S32> >& built)
+{
+	std::vector<Build*> finished;
+	{
+		LLMutexLock lock(&mBuildCondition);
+		for (std::list<Build*>::iterator iter = mBuilds.begin(); iter != mBuilds.end(); )
+		{
+			if ((*iter)->mState == Build::BUILT)
+			{
+				finished.push_back(*iter);
+				iter = mBuilds.erase(iter);
+			}
+			else
+			{
+				++iter;
+			}
+		}
+	}
+
+	for (Build* build : finished)
+	{
+		// The group goes away with its last reference, in which case
+		// nobody can use this LOD any more
+		LLVolumeLODGroup* volgroupp = getGroup(build->mParams);
+		if (volgroupp)
+		{
+			volgroupp->setLOD(build->mDetail, build->mVolume);
+		}
+		built.push_back(std::make_pair(build->mParams, build->mDetail));
+		delete build;
+	}
+}
+
+bool LLVolumeMgr::hasPendingBuilds()
+{
+	LLMutexLock lock(&mBuildCondition);
+	return mNumPendingBuilds > 0;
+}
+
+LLVolumeMgr::Build* LLVolumeMgr::claimBuild()
+{
+	LLMutexLock lock(&mBuildCondition);
+	if (mNumPendingBuilds > 0)
+	{
+		for (Build* build : mBuilds)
+		{
+			if (build->mState == Build::PENDING)
+			{
+				build->mState = Build::BUILDING;
+				--mNumPendingBuilds;
+				return build;
+			}
+		}
+	}
+	return nullptr;
+}
+
+void LLVolumeMgr::finishBuild(Build* build)
+{
+	// Same volume refLOD() would have made.  Nothing else touches the
+	// build while it is BUILDING, so mVolume needs no lock until then.
+	build->mVolume = new LLVolume(build->mParams, LLVolumeLODGroup::getVolumeScaleFromDetail(build->mDetail));
+
+	LLMutexLock lock(&mBuildCondition);
+	build->mState = Build::BUILT;
+}
+
+LLVolumeMgr::Build::Build(const LLVolumeParams& volume_params, S32 detail)
+:	mParams(volume_params),
+	mDetail(detail),
+	mState(PENDING)
+{
+}
+
+LLVolumeMgr::BuildThread::BuildThread(const std::string& name, LLVolumeMgr* volume_mgr)
+:	LLThread(name),
+	mVolumeMgr(volume_mgr)
+{
+}
+
+// virtual
+bool LLVolumeMgr::BuildThread::runCondition()
+{
+	// mDataLock is locked here; the volume manager has its own lock
+	return mVolumeMgr->hasPendingBuilds();
+}
+
+// virtual
+void LLVolumeMgr::BuildThread::run()
+{
+	while (true)
+	{
+		// Sleeps until requestVolume() wakes us with work
+		checkPause();
+
+		if (isQuitting())
+		{
+			break;
+		}
+
+		while (Build* build = mVolumeMgr->claimBuild())
+		{
+			mVolumeMgr->finishBuild(build);
+		}
+	}
+	LL_INFOS() << "Volume build thread " << mName << " EXITING." << LL_ENDL;
+}
+
 std::ostream& operator<<(std::ostream& s, const LLVolumeMgr& volume_mgr)
 {
 	s << "{ numLODgroups=" << volume_mgr.mVolumeLODGroups.size() << ", ";
@@ -303,6 +611,15 @@ LLVolume* LLVolumeLODGroup::refLOD(const S32 detail)
 	return mVolumeLODs[detail];
 }
 
+void LLVolumeLODGroup::setLOD(const S32 detail, LLVolume* volumep)
+{
+	llassert(detail >=0 && detail < NUM_LODS);
+	if (mVolumeLODs[detail].isNull())
+	{
+		mVolumeLODs[detail] = volumep;
+	}
+}
+
 BOOL LLVolumeLODGroup::derefLOD(LLVolume *volumep)
 {
 	llassert_always(mRefs > 0);
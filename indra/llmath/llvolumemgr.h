@@ -27,7 +27,11 @@
 #ifndef LL_LLVOLUMEMGR_H
 #define LL_LLVOLUMEMGR_H
 
+#include <list>
+#include <vector>
+
 #include "llvolume.h"
+#include "llmutex.h"
 #include "llpointer.h"
 #include "llthread.h"
 
@@ -55,6 +59,11 @@ public:
 
 	LLVolume* refLOD(const S32 detail);
 	BOOL derefLOD(LLVolume *volumep);
+
+	bool isLODBuilt(const S32 detail) const { return mVolumeLODs[detail].notNull(); }
+	LLVolume* getLOD(const S32 detail) const { return mVolumeLODs[detail]; }
+	// Keeps volumep for detail unless that LOD was built in the meantime
+	void setLOD(const S32 detail, LLVolume* volumep);
 	S32 getNumRefs() const { return mRefs; }
 	
 	const LLVolumeParams* getVolumeParams() const { return &mVolumeParams; };
@@ -93,6 +102,30 @@ public:
 	// manually call this for mutex magic
 	void useMutex();
 
+	// MAIN THREAD.  Starts the threads requestVolume() builds on.  Without
+	// them refVolume() builds every LOD on demand.
+	void startBuildThreads(U32 num_threads);
+
+	// MAIN THREAD.  Returns true if refVolume(volume_params, detail) would
+	// return a volume without building one, or if there are no build
+	// threads.  Otherwise queues a build of that LOD, unless one is queued
+	// already, and returns false.
+	bool requestVolume(const LLVolumeParams& volume_params, const S32 detail);
+
+	// MAIN THREAD.  Hands the volumes built since the last call to their
+	// LOD groups, if those still exist, and appends the params and detail
+	// of each to built.
+	void publishBuiltVolumes(std::vector<std::pair<LLVolumeParams, S32> >& built);
+
+	bool hasPendingBuilds();
+
+	// MAIN THREAD.  Keeps up to max_bytes of built prim volumes around after
+	// the last reference to them goes away, so the next identical prim
+	// doesn't have to build them again.  The least recently released go
+	// first.  0, the default, keeps none.
+	void setRetentionBudget(U32 max_bytes);
+	U32 getRetainedBytes() const { return mRetainedBytes; }
+
 	friend std::ostream& operator<<(std::ostream& s, const LLVolumeMgr& volume_mgr);
 
 protected:
@@ -105,6 +138,67 @@ protected:
 	volume_lod_group_map_t mVolumeLODGroups;
 
 	LLMutex* mDataMutex;
+
+private:
+	void retainLODs(LLVolumeLODGroup* volgroupp);
+	bool restoreLODs(LLVolumeLODGroup* volgroupp, const S32 detail);
+	void trimRetained(U32 max_bytes);
+
+	// A volume kept by retainLODs(), most recently released at the front
+	struct RetainedVolume
+	{
+		LLPointer<LLVolume> mVolume;
+		S32 mDetail;
+		U32 mBytes;
+	};
+	typedef std::list<RetainedVolume> retained_list_t;
+	typedef std::map<std::pair<LLVolumeParams, S32>, retained_list_t::iterator> retained_map_t;
+	retained_list_t mRetainedList;
+	retained_map_t mRetainedMap;
+	U32 mRetainedBytes;
+	U32 mRetentionBudget;
+
+	// One LOD queued by requestVolume()
+	struct Build
+	{
+		Build(const LLVolumeParams& volume_params, S32 detail);
+
+		LLVolumeParams mParams;
+		S32 mDetail;
+		// Set by the build thread, read by the main thread once BUILT
+		LLPointer<LLVolume> mVolume;
+
+		enum EState
+		{
+			PENDING,
+			BUILDING,
+			BUILT
+		};
+		EState mState;
+	};
+
+	class BuildThread : public LLThread
+	{
+	public:
+		BuildThread(const std::string& name, LLVolumeMgr* volume_mgr);
+
+	private:
+		bool runCondition() override;
+		void run() override;
+
+		LLVolumeMgr* mVolumeMgr;
+	};
+
+	Build* claimBuild();
+	void finishBuild(Build* build);
+	void stopBuildThreads();
+
+	// Guards mBuilds, mNumPendingBuilds and each build's mState
+	LLCondition mBuildCondition;
+	std::list<Build*> mBuilds;
+	S32 mNumPendingBuilds;
+
+	std::vector<BuildThread*> mBuildThreads;
 };
 
 #endif // LL_LLVOLUMEMGR_H
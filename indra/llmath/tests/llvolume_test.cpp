@@ -0,0 +1,144 @@
+/**
+ * @file   llvolume_test.cpp
+ * @brief  Test for the decoded face layout in llvolume.cpp.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../test/lltut.h"
+
+#include "../llvolume.h"
+#include "../llvolumemgr.h"
+
+namespace
+{
+	LLPointer<LLVolume> make_volume(F32 hollow)
+	{
+		LLVolumeParams volume_params;
+		volume_params.setType(LL_PCODE_PROFILE_CIRCLE, LL_PCODE_PATH_CIRCLE);
+		volume_params.setBeginAndEndS(0.f, 1.f);
+		volume_params.setBeginAndEndT(0.f, 1.f);
+		volume_params.setRatio(1.f, 0.25f);
+		volume_params.setShear(0.f, 0.f);
+		volume_params.setHollow(hollow);
+		return new LLVolume(volume_params, LLVolumeLODGroup::getVolumeScaleFromDetail(2));
+	}
+
+	bool same_vectors(const LLVector4a* a, const LLVector4a* b, S32 count)
+	{
+		return !memcmp(a, b, count * sizeof(LLVector4a));
+	}
+}
+
+namespace tut
+{
+	struct LLVolumeData
+	{
+	};
+
+	typedef test_group<LLVolumeData> factory;
+	typedef factory::object object;
+}
+
+namespace
+{
+	tut::factory llvolume_test_factory("LLVolume");
+}
+
+namespace tut
+{
+	template<> template<>
+	void object::test<1>()
+	{
+		set_test_name("decoded faces come back unchanged");
+
+		LLPointer<LLVolume> volume = make_volume(0.5f);
+		LLVolumeFace& weighted = volume->getVolumeFace(0);
+		weighted.allocateWeights(weighted.mNumVertices);
+		for (S32 i = 0; i < weighted.mNumVertices; ++i)
+		{
+			weighted.mWeights[i].set(1.5f, 2.25f, 0.f, 0.f);
+		}
+
+		std::vector<U8> data;
+		volume->packDecodedFaces(data);
+
+		LLPointer<LLVolume> copy = make_volume(0.f);
+		ensure("unpacked", copy->unpackDecodedFaces(&data[0], data.size()));
+		ensure_equals("faces", copy->getNumVolumeFaces(), volume->getNumVolumeFaces());
+		for (S32 i = 0; i < volume->getNumVolumeFaces(); ++i)
+		{
+			const LLVolumeFace& face = copy->getVolumeFace(i);
+			const LLVolumeFace& expected = volume->getVolumeFace(i);
+			ensure_equals("vertices", face.mNumVertices, expected.mNumVertices);
+			ensure_equals("indices", face.mNumIndices, expected.mNumIndices);
+			ensure("positions", same_vectors(face.mPositions, expected.mPositions, face.mNumVertices));
+			ensure("normals", same_vectors(face.mNormals, expected.mNormals, face.mNumVertices));
+			ensure("texture coordinates", !memcmp(face.mTexCoords, expected.mTexCoords, face.mNumVertices * sizeof(LLVector2)));
+			ensure("index values", !memcmp(face.mIndices, expected.mIndices, face.mNumIndices * sizeof(U16)));
+			ensure("extents", same_vectors(face.mExtents, expected.mExtents, 2));
+			ensure("texture extents", face.mTexCoordExtents[1] == expected.mTexCoordExtents[1]);
+			ensure_equals("weights", face.mWeights != nullptr, expected.mWeights != nullptr);
+			if (face.mWeights)
+			{
+				ensure("weight values", same_vectors(face.mWeights, expected.mWeights, face.mNumVertices));
+			}
+		}
+	}
+
+	template<> template<>
+	void object::test<2>()
+	{
+		set_test_name("damaged decoded faces are rejected");
+
+		LLPointer<LLVolume> volume = make_volume(0.5f);
+		std::vector<U8> data;
+		volume->packDecodedFaces(data);
+
+		LLPointer<LLVolume> copy = make_volume(0.f);
+		ensure("truncated", !copy->unpackDecodedFaces(&data[0], data.size() - 1));
+		ensure("empty", !copy->unpackDecodedFaces(nullptr, 0));
+
+		std::vector<U8> bad_version(data);
+		bad_version[4] ^= 0xFF;
+		ensure("wrong version", !copy->unpackDecodedFaces(&bad_version[0], bad_version.size()));
+
+		// The first face's first index, past its vertex streams
+		const LLVolumeFace& face = volume->getVolumeFace(0);
+		size_t index_offset = 16 + 64 + 2 * face.mNumVertices * sizeof(LLVector4a) + ((face.mNumVertices * sizeof(LLVector2) + 0xF) & ~0xF);
+		std::vector<U8> bad_index(data);
+		U16 index = (U16) face.mNumVertices;
+		memcpy(&bad_index[index_offset], &index, sizeof(index));
+		ensure("index out of range", !copy->unpackDecodedFaces(&bad_index[0], bad_index.size()));
+
+		// One face with indices but no vertices for them to index
+		std::vector<U8> no_vertices(16 + 64 + 16, 0);
+		memcpy(&no_vertices[0], &data[0], 16);
+		U32 num_faces = 1;
+		memcpy(&no_vertices[8], &num_faces, sizeof(num_faces));
+		S32 counts[2] = { 0, 3 };
+		memcpy(&no_vertices[16], counts, sizeof(counts));
+		ensure("indices without vertices", !copy->unpackDecodedFaces(&no_vertices[0], no_vertices.size()));
+	}
+}
@@ -0,0 +1,216 @@
+/**
+ * @file   llvolumemgr_test.cpp
+ * @brief  Test for llvolumemgr.cpp background builds and retained volumes.
+ *
+ * $LicenseInfo:firstyear=2026&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2026, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../test/lltut.h"
+
+#include "../llvolumemgr.h"
+#include "lltimer.h"
+
+namespace
+{
+	// A hollow torus, so both the profile hole and the side faces get built
+	LLVolumeParams make_torus(F32 hollow)
+	{
+		LLVolumeParams volume_params;
+		volume_params.setType(LL_PCODE_PROFILE_CIRCLE, LL_PCODE_PATH_CIRCLE);
+		volume_params.setBeginAndEndS(0.f, 1.f);
+		volume_params.setBeginAndEndT(0.f, 1.f);
+		volume_params.setRatio(1.f, 0.25f);
+		volume_params.setShear(0.f, 0.f);
+		volume_params.setHollow(hollow);
+		return volume_params;
+	}
+
+	// Waits for the build threads and publishes what they built
+	void wait_for_builds(LLVolumeMgr& volume_mgr, std::vector<std::pair<LLVolumeParams, S32> >& built, size_t count)
+	{
+		LLTimer timer;
+		while (built.size() < count && timer.getElapsedTimeF32() < 10.f)
+		{
+			volume_mgr.publishBuiltVolumes(built);
+			ms_sleep(1);
+		}
+	}
+}
+
+namespace tut
+{
+	struct LLVolumeMgrData
+	{
+	};
+
+	typedef test_group<LLVolumeMgrData> factory;
+	typedef factory::object object;
+}
+
+namespace
+{
+	tut::factory llvolumemgr_test_factory("LLVolumeMgr");
+}
+
+namespace tut
+{
+	template<> template<>
+	void object::test<1>()
+	{
+		set_test_name("without build threads every LOD is built on demand");
+
+		LLVolumeMgr volume_mgr;
+		LLVolumeParams volume_params = make_torus(0.5f);
+		LLVolume* volumep = volume_mgr.refVolume(volume_params, 0);
+
+		ensure("no queued build", volume_mgr.requestVolume(volume_params, 3));
+		ensure("nothing pending", !volume_mgr.hasPendingBuilds());
+
+		volume_mgr.unrefVolume(volumep);
+	}
+
+	template<> template<>
+	void object::test<2>()
+	{
+		set_test_name("a LOD built in the background matches one built on demand");
+
+		LLVolumeMgr volume_mgr;
+		volume_mgr.startBuildThreads(2);
+
+		LLVolumeParams volume_params = make_torus(0.5f);
+		LLVolume* low = volume_mgr.refVolume(volume_params, 0);
+
+		ensure("first request queues a build", !volume_mgr.requestVolume(volume_params, 3));
+		ensure("second request waits on the same build", !volume_mgr.requestVolume(volume_params, 3));
+
+		std::vector<std::pair<LLVolumeParams, S32> > built;
+		wait_for_builds(volume_mgr, built, 1);
+		ensure_equals("one build published", built.size(), (size_t) 1);
+		ensure("published params", built[0].first == volume_params);
+		ensure_equals("published detail", built[0].second, 3);
+		ensure("LOD is ready", volume_mgr.requestVolume(volume_params, 3));
+
+		LLPointer<LLVolume> expected = new LLVolume(volume_params, LLVolumeLODGroup::getVolumeScaleFromDetail(3));
+		LLVolume* high = volume_mgr.refVolume(volume_params, 3);
+		ensure_equals("faces", high->getNumVolumeFaces(), expected->getNumVolumeFaces());
+		for (S32 i = 0; i < expected->getNumVolumeFaces(); ++i)
+		{
+			const LLVolumeFace& face = high->getVolumeFace(i);
+			const LLVolumeFace& expected_face = expected->getVolumeFace(i);
+			ensure_equals("vertices", face.mNumVertices, expected_face.mNumVertices);
+			ensure_equals("indices", face.mNumIndices, expected_face.mNumIndices);
+			ensure("positions", !memcmp(face.mPositions, expected_face.mPositions, face.mNumVertices * sizeof(LLVector4a)));
+			ensure("normals", !memcmp(face.mNormals, expected_face.mNormals, face.mNumVertices * sizeof(LLVector4a)));
+			ensure("indices", !memcmp(face.mIndices, expected_face.mIndices, face.mNumIndices * sizeof(U16)));
+		}
+
+		volume_mgr.unrefVolume(high);
+		volume_mgr.unrefVolume(low);
+	}
+
+	template<> template<>
+	void object::test<3>()
+	{
+		set_test_name("builds for volumes nobody references any more are dropped");
+
+		LLVolumeMgr volume_mgr;
+		volume_mgr.startBuildThreads(1);
+
+		LLVolumeParams volume_params = make_torus(0.25f);
+		LLVolume* low = volume_mgr.refVolume(volume_params, 1);
+		ensure("build queued", !volume_mgr.requestVolume(volume_params, 2));
+		volume_mgr.unrefVolume(low);
+
+		std::vector<std::pair<LLVolumeParams, S32> > built;
+		wait_for_builds(volume_mgr, built, 1);
+		ensure_equals("build still reported", built.size(), (size_t) 1);
+		ensure("group is gone", volume_mgr.getGroup(volume_params) == NULL);
+	}
+
+	template<> template<>
+	void object::test<4>()
+	{
+		set_test_name("released prims are reused by the next identical prim");
+
+		LLVolumeMgr volume_mgr;
+		volume_mgr.setRetentionBudget(64 * 1024 * 1024);
+
+		LLVolumeParams volume_params = make_torus(0.5f);
+		LLPointer<LLVolume> low = volume_mgr.refVolume(volume_params, 0);
+		LLPointer<LLVolume> high = volume_mgr.refVolume(volume_params, 3);
+		volume_mgr.unrefVolume(low);
+		volume_mgr.unrefVolume(high);
+		ensure("group is gone", volume_mgr.getGroup(volume_params) == NULL);
+		ensure("both LODs retained", volume_mgr.getRetainedBytes() > 0);
+
+		// Both LODs come back with the group, whichever one is asked for
+		LLVolume* volumep = volume_mgr.refVolume(volume_params, 3);
+		ensure("same high LOD", volumep == high.get());
+		ensure_equals("nothing retained", volume_mgr.getRetainedBytes(), (U32) 0);
+		LLVolume* other = volume_mgr.refVolume(volume_params, 0);
+		ensure("same low LOD", other == low.get());
+
+		volume_mgr.unrefVolume(volumep);
+		volume_mgr.unrefVolume(other);
+	}
+
+	template<> template<>
+	void object::test<5>()
+	{
+		set_test_name("retained prims stay within the budget, oldest out first");
+
+		LLVolumeMgr volume_mgr;
+		volume_mgr.setRetentionBudget(64 * 1024 * 1024);
+
+		LLVolumeParams first_params = make_torus(0.25f);
+		LLVolumeParams second_params = make_torus(0.5f);
+
+		volume_mgr.unrefVolume(volume_mgr.refVolume(first_params, 3));
+		U32 first_bytes = volume_mgr.getRetainedBytes();
+		volume_mgr.unrefVolume(volume_mgr.refVolume(second_params, 3));
+		U32 both_bytes = volume_mgr.getRetainedBytes();
+		ensure("both retained", both_bytes > first_bytes);
+
+		// Room for the second only
+		volume_mgr.setRetentionBudget(both_bytes - first_bytes);
+		ensure_equals("first released", volume_mgr.getRetainedBytes(), both_bytes - first_bytes);
+
+		volume_mgr.setRetentionBudget(0);
+		ensure_equals("none retained", volume_mgr.getRetainedBytes(), (U32) 0);
+	}
+
+	template<> template<>
+	void object::test<6>()
+	{
+		set_test_name("sculpted volumes are not retained");
+
+		LLVolumeMgr volume_mgr;
+		volume_mgr.setRetentionBudget(64 * 1024 * 1024);
+
+		LLVolumeParams volume_params = make_torus(0.f);
+		volume_params.setSculptID(LLUUID("1dc1368f-e8fe-f02d-a08d-9d9f11c1af6b"), LL_SCULPT_TYPE_SPHERE);
+		volume_mgr.unrefVolume(volume_mgr.refVolume(volume_params, 2));
+		ensure_equals("nothing retained", volume_mgr.getRetainedBytes(), (U32) 0);
+	}
+}
@@ -32,12 +32,14 @@
 #include <sstream>
 #include <algorithm>
 #include <iterator>
+#include <memory>
 #include <jsoncpp/reader.h> // JSON
 #include <jsoncpp/writer.h> // JSON
 #include "llcorehttputil.h"
 #include "lleventcoro.h"
 #include "llhttpconstants.h"
 #include "llsd.h"
+#include "llsdarena.h"
 #include "llsdjson.h"
 #include "llsdserialize.h"
 #include "llvfile.h"
@@ -56,6 +58,12 @@ namespace
 {
     const std::string   HTTP_LOGBODY_KEY("HTTPLogBodyOnError");
 
+    // Bodies at least this large (inventory fetches, group member
+    // lists and the like) are parsed, walked once and dropped, so their
+    // LLSD nodes are built in an arena.  Smaller bodies are more often
+    // kept around in pieces, which would pin a whole arena.
+    const size_t        LLSD_ARENA_MIN_BODY_SIZE(64 * 1024);
+
     BoolSettingQuery_t  mBoolSettingGet;
     BoolSettingUpdate_t mBoolSettingPut;
 
@@ -121,9 +129,27 @@ bool responseToLLSD(HttpResponse * response, bool log, LLSD & out_llsd)
         return false;
     }
 
-    LLCore::BufferArrayStream bas(body);
+    std::unique_ptr<LLSDArena::Scope> arena;
+    if (body->size() >= LLSD_ARENA_MIN_BODY_SIZE)
+    {
+        arena.reset(new LLSDArena::Scope);
+    }
+
+    // Feed the body's blocks to the parser in place rather than
+    // reading it a character at a time through a BufferArrayStream.
+    LLPointer<LLSDXMLParser> parser = new LLSDXMLParser(log);
+    const char * start(NULL);
+    const char * end(NULL);
+    for (int block(0); body->getBlockStartEnd(block, &start, &end); ++block)
+    {
+        if (!parser->parseChunk(start, S32(end - start)))
+        {
+            break;
+        }
+    }
+
     LLSD body_llsd;
-    S32 parse_status(LLSDSerialize::fromXML(body_llsd, bas, log));
+    S32 parse_status(parser->finishParse(body_llsd));
     if (LLSDParser::PARSE_FAILURE == parse_status){
         return false;
     }
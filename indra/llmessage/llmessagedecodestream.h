@@ -0,0 +1,214 @@
+/**
+ * @file llmessagedecodestream.h
+ * @brief Field readers for the generated template message decoders.
+ *
+ * $LicenseInfo:firstyear=2007&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMESSAGEDECODESTREAM_H
+#define LL_LLMESSAGEDECODESTREAM_H
+
+#include "llmath.h"
+#include "llquaternion.h"
+#include "lluuid.h"
+#include "message.h"
+#include "v3dmath.h"
+#include "v3math.h"
+#include "v4math.h"
+
+// Reads template message fields in order from a message body, with the
+// byte order, defaults and sanity checks of LLTemplateMessageReader's
+// decodeData() and get*() methods.  A field the body is too short for
+// reads as zeros (or empty), as it does there, and marks the stream
+// incomplete.
+class LLMessageDecodeStream
+{
+public:
+	LLMessageDecodeStream(const U8* body, S32 size)
+	:	mPos(body),
+		mEnd(body + size),
+		mComplete(true)
+	{
+	}
+
+	bool isComplete() const			{ return mComplete; }
+
+	// Repeat count of a Variable block.  Missing counts at the end of a
+	// message are legal and read as 0.
+	S32 readBlockCount()
+	{
+		return (mPos < mEnd) ? *mPos++ : 0;
+	}
+
+	void readU8(U8& d)				{ read(&d, MVT_U8, sizeof(d)); }
+	void readS8(S8& d)				{ read(&d, MVT_S8, sizeof(d)); }
+	void readU16(U16& d)			{ read(&d, MVT_U16, sizeof(d)); }
+	void readS16(S16& d)			{ read(&d, MVT_S16, sizeof(d)); }
+	void readU32(U32& d)			{ read(&d, MVT_U32, sizeof(d)); }
+	void readS32(S32& d)			{ read(&d, MVT_S32, sizeof(d)); }
+	void readU64(U64& d)			{ read(&d, MVT_U64, sizeof(d)); }
+	void readS64(S64& d)			{ read(&d, MVT_S64, sizeof(d)); }
+	void readIPAddr(U32& d)			{ read(&d, MVT_IP_ADDR, sizeof(d)); }
+	void readUUID(LLUUID& d)		{ read(d.mData, MVT_LLUUID, sizeof(d.mData)); }
+
+	void readBOOL(BOOL& d)
+	{
+		U8 value;
+		read(&value, MVT_BOOL, sizeof(value));
+		d = (BOOL)value;
+	}
+
+	void readIPPort(U16& d)
+	{
+		read(&d, MVT_IP_PORT, sizeof(d));
+		d = ntohs(d);
+	}
+
+	void readF32(F32& d)
+	{
+		read(&d, MVT_F32, sizeof(d));
+		if (!llfinite(d))
+		{
+			d = 0.f;
+		}
+	}
+
+	void readF64(F64& d)
+	{
+		read(&d, MVT_F64, sizeof(d));
+		if (!llfinite(d))
+		{
+			d = 0.0;
+		}
+	}
+
+	void readVector3(LLVector3& v)
+	{
+		read(v.mV, MVT_LLVector3, sizeof(v.mV));
+		if (!v.isFinite())
+		{
+			v.zeroVec();
+		}
+	}
+
+	void readVector3d(LLVector3d& v)
+	{
+		read(v.mdV, MVT_LLVector3d, sizeof(v.mdV));
+		if (!v.isFinite())
+		{
+			v.zeroVec();
+		}
+	}
+
+	void readVector4(LLVector4& v)
+	{
+		read(v.mV, MVT_LLVector4, sizeof(v.mV));
+		if (!v.isFinite())
+		{
+			v.zeroVec();
+		}
+	}
+
+	// Packed as the vector part, like LLTemplateMessageReader::getQuat()
+	void readQuat(LLQuaternion& q)
+	{
+		LLVector3 vec;
+		read(vec.mV, MVT_LLQuaternion, sizeof(vec.mV));
+		if (vec.isFinite())
+		{
+			q.unpackFromVector3(vec);
+		}
+		else
+		{
+			q.loadIdentity();
+		}
+	}
+
+	void readFixed(U8* data, S32 size)
+	{
+		read(data, MVT_FIXED, size);
+	}
+
+	// Points 'data' into the body rather than copying.  'size_bytes' is
+	// the width of the length prefix, 1, 2 or 4.
+	void readVariable(const U8*& data, S32& size, S32 size_bytes)
+	{
+		data = nullptr;
+		size = 0;
+		if (mEnd - mPos < size_bytes)
+		{
+			mPos = mEnd;
+			mComplete = false;
+			return;
+		}
+
+		U32 length = 0;
+		switch (size_bytes)
+		{
+		case 1:
+			length = *mPos;
+			break;
+		case 2:
+		{
+			U16 length16;
+			htonmemcpy(&length16, mPos, MVT_U16, 2);
+			length = length16;
+			break;
+		}
+		default:
+			htonmemcpy(&length, mPos, MVT_U32, 4);
+			break;
+		}
+		mPos += size_bytes;
+
+		if ((U32)(mEnd - mPos) < length)
+		{
+			// The template reader would read past the packet here
+			mPos = mEnd;
+			mComplete = false;
+			return;
+		}
+		data = length ? mPos : nullptr;
+		size = (S32)length;
+		mPos += length;
+	}
+
+private:
+	void read(void* data, EMsgVariableType type, S32 size)
+	{
+		if (mEnd - mPos < size)
+		{
+			memset(data, 0, size);
+			mPos = mEnd;
+			mComplete = false;
+			return;
+		}
+		htonmemcpy(data, mPos, type, size);
+		mPos += size;
+	}
+
+	const U8* mPos;
+	const U8* mEnd;
+	bool mComplete;
+};
+
+#endif // LL_LLMESSAGEDECODESTREAM_H
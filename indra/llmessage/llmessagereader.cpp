@@ -39,6 +39,12 @@ LLMessageReader::~LLMessageReader()
 	// even abstract base classes need a concrete destructor
 }
 
+//virtual
+bool LLMessageReader::getMessageBody(const U8*& body, S32& size) const
+{
+	return false;
+}
+
 //static 
 void LLMessageReader::setTimeDecodes(BOOL b)
 {
@@ -84,6 +84,10 @@ class LLMessageReader
 
 	virtual void copyToBuilder(LLMessageBuilder&) const = 0;
 
+	/** The current message's blocks as they came off the wire, for the
+	 *  generated decoders.  False if the message didn't come in that way. */
+	virtual bool getMessageBody(const U8*& body, S32& size) const;
+
 	static void setTimeDecodes(BOOL b);
 	static BOOL getTimeDecodes();
 	static void setTimeDecodesSpamThreshold(F32 seconds);
@@ -0,0 +1,257 @@
+/**
+ * @file llmessagereplay.cpp
+ * @brief Replays a packet capture through the message system and times
+ * the handlers.
+ *
+ * $LicenseInfo:firstyear=2001&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llmessagereplay.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+
+#include "lltimer.h"
+#include "lltrace.h"
+#include "lltracerecording.h"
+#include "message.h"
+
+// LLTrace stats have to exist before any recording that might see them
+// starts, so there can't be one per message name.  These cover all of
+// them, the per handler figures are kept alongside.
+static LLTrace::EventStatHandle<F64Seconds> sHandlerTime("message_replay_handler_time",
+														 "Time in one message or event handler during replay");
+static LLTrace::CountStatHandle<> sPacketsReplayed("message_replay_packets",
+												   "Packets replayed from a capture");
+
+namespace
+{
+	bool more_total_time(const LLMessageReplay::HandlerStats& a, const LLMessageReplay::HandlerStats& b)
+	{
+		return a.mTotal > b.mTotal;
+	}
+}
+
+LLMessageReplay::LLMessageReplay(LLMessageSystem* msg)
+:	mMsg(msg),
+	mFrame(0),
+	mPacketsReplayed(0),
+	mBytesReplayed(0),
+	mEventsReplayed(0),
+	mMessagesHandled(0)
+{
+}
+
+bool LLMessageReplay::load(const std::string& filename)
+{
+	F32 template_version = 0.f;
+	if (!LLPacketCapture::load(filename, mRecords, &template_version))
+	{
+		return false;
+	}
+	if (template_version != mMsg->mMessageFileVersionNumber)
+	{
+		// Messages that changed won't decode the same, or at all
+		LL_WARNS("Messaging") << filename << " was captured with message template version "
+			<< template_version << ", replaying with " << mMsg->mMessageFileVersionNumber << LL_ENDL;
+	}
+
+	mHosts.clear();
+	for (LLPacketCapture::record_list_t::const_iterator iter = mRecords.begin();
+		 iter != mRecords.end(); ++iter)
+	{
+		if (iter->mType == LLPacketCapture::PACKET)
+		{
+			mHosts.insert(iter->mSender);
+		}
+	}
+	LL_INFOS("Messaging") << "Loaded " << mRecords.size() << " records from " << mHosts.size()
+		<< " hosts out of " << filename << LL_ENDL;
+	return true;
+}
+
+void LLMessageReplay::run(S32 passes, S32 batch_size)
+{
+	LLMessageSystem::msg_timing_callback old_callback = mMsg->getTimingCallback();
+	void* old_callback_data = mMsg->getTimingCallbackData();
+	mMsg->setTimingFunc(timingCallback, this);
+	mMsg->mPacketRing.setReplaying(true);
+
+	mPacketsReplayed = 0;
+	mBytesReplayed = 0;
+	mEventsReplayed = 0;
+	mMessagesHandled = 0;
+	mMessageStats.clear();
+	mEventStats.clear();
+
+	LLTrace::Recording recording;
+	recording.start();
+	LLTimer timer;
+
+	for (S32 pass = 0; pass < passes; ++pass)
+	{
+		for (std::set<LLHost>::const_iterator iter = mHosts.begin(); iter != mHosts.end(); ++iter)
+		{
+			mMsg->enableCircuit(*iter, TRUE);
+		}
+
+		S32 queued = 0;
+		for (LLPacketCapture::record_list_t::const_iterator iter = mRecords.begin();
+			 iter != mRecords.end(); ++iter)
+		{
+			if (iter->mType == LLPacketCapture::EVENT)
+			{
+				// Whatever came in over UDP before it is handled first
+				pump();
+				queued = 0;
+				dispatchEvent(*iter);
+				continue;
+			}
+
+			if (iter->mData.empty())
+			{
+				continue;
+			}
+			mMsg->mPacketRing.queueReplayPacket(iter->mSender, &iter->mData[0], (S32)iter->mData.size());
+			++mPacketsReplayed;
+			add(sPacketsReplayed, 1);
+			mBytesReplayed += iter->mData.size();
+			if (++queued >= batch_size)
+			{
+				pump();
+				queued = 0;
+			}
+		}
+		pump();
+
+		// So the next pass isn't all duplicates
+		for (std::set<LLHost>::const_iterator iter = mHosts.begin(); iter != mHosts.end(); ++iter)
+		{
+			mMsg->mCircuitInfo.removeCircuitData(*iter);
+		}
+	}
+
+	mElapsed = F64Seconds(timer.getElapsedTimeF64());
+	recording.stop();
+
+	mMsg->mPacketRing.setReplaying(false);
+	mMsg->setTimingFunc(old_callback, old_callback_data);
+
+	mHandlerTotal = recording.getSum(sHandlerTime);
+	mHandlerMax = recording.getMax(sHandlerTime);
+
+	mHandlerStats.clear();
+	for (message_stats_map_t::iterator iter = mMessageStats.begin(); iter != mMessageStats.end(); ++iter)
+	{
+		mHandlerStats.push_back(iter->second);
+	}
+	for (event_stats_map_t::iterator iter = mEventStats.begin(); iter != mEventStats.end(); ++iter)
+	{
+		mHandlerStats.push_back(iter->second);
+	}
+	std::sort(mHandlerStats.begin(), mHandlerStats.end(), more_total_time);
+}
+
+void LLMessageReplay::pump()
+{
+	// checkMessages() only returns false once it's out of packets
+	while (mMsg->checkMessages(mFrame))
+	{
+	}
+	mMsg->processAcks();
+	++mFrame;
+}
+
+void LLMessageReplay::dispatchEvent(const LLPacketCapture::Record& record)
+{
+	LLTimer timer;
+	LLMessageSystem::dispatch(record.mName, record.mMessage);
+	F64Seconds time(timer.getElapsedTimeF64());
+
+	HandlerStats& stats = mEventStats[record.mName];
+	if (!stats.mCount)
+	{
+		stats.mName = record.mName;
+		stats.mIsEvent = true;
+	}
+	addHandlerTime(stats, time);
+	++mEventsReplayed;
+}
+
+//static
+void LLMessageReplay::timingCallback(const char* hashed_name, F32 time, void* data)
+{
+	LLMessageReplay* self = (LLMessageReplay*)data;
+	HandlerStats& stats = self->mMessageStats[hashed_name];
+	if (!stats.mCount)
+	{
+		stats.mName = hashed_name;
+		stats.mIsEvent = false;
+	}
+	addHandlerTime(stats, F64Seconds(time));
+	++self->mMessagesHandled;
+}
+
+//static
+void LLMessageReplay::addHandlerTime(HandlerStats& stats, F64Seconds time)
+{
+	++stats.mCount;
+	stats.mTotal += time;
+	stats.mMax = llmax(stats.mMax, time);
+	record(sHandlerTime, time);
+}
+
+void LLMessageReplay::dumpReport(std::ostream& out) const
+{
+	const F64 seconds = mElapsed.value();
+	out << "Replayed " << mPacketsReplayed << " packets (" << mBytesReplayed << " bytes) and "
+		<< mEventsReplayed << " events in " << std::fixed << std::setprecision(3) << seconds << "s" << std::endl;
+	if (seconds > 0.0)
+	{
+		out << std::setprecision(0)
+			<< "    " << (mPacketsReplayed / seconds) << " packets/s, "
+			<< (mMessagesHandled / seconds) << " messages/s, "
+			<< (mBytesReplayed / seconds / 1024.0 / 1024.0 * 8.0) << " Mbit/s" << std::endl;
+	}
+	out << std::setprecision(3)
+		<< "    " << mHandlerTotal.value() * 1000.0 << "ms in handlers, longest "
+		<< mHandlerMax.value() * 1000000.0 << "us" << std::endl;
+
+	out << std::endl
+		<< std::left << std::setw(40) << "Handler"
+		<< std::right << std::setw(10) << "Count"
+		<< std::setw(14) << "Total ms"
+		<< std::setw(14) << "Mean us"
+		<< std::setw(14) << "Max us" << std::endl;
+	for (stats_list_t::const_iterator iter = mHandlerStats.begin(); iter != mHandlerStats.end(); ++iter)
+	{
+		out << std::left << std::setw(40) << ((iter->mIsEvent ? "event " : "") + iter->mName)
+			<< std::right << std::setw(10) << iter->mCount
+			<< std::setprecision(3)
+			<< std::setw(14) << iter->mTotal.value() * 1000.0
+			<< std::setw(14) << iter->mTotal.value() * 1000000.0 / iter->mCount
+			<< std::setw(14) << iter->mMax.value() * 1000000.0 << std::endl;
+	}
+}
@@ -0,0 +1,124 @@
+/**
+ * @file llmessagereplay.h
+ * @brief Replays a packet capture through the message system and times
+ * the handlers.
+ *
+ * $LicenseInfo:firstyear=2001&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMESSAGEREPLAY_H
+#define LL_LLMESSAGEREPLAY_H
+
+#include <iosfwd>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "llhost.h"
+#include "llpacketcapture.h"
+#include "llunits.h"
+
+class LLMessageSystem;
+
+// Feeds a capture from LLMessageSystem::startPacketCapture() back
+// through 'msg' as fast as it will go, with whatever handlers are
+// registered on it.  Packets go in through the packet ring, so they
+// take the same path through checkMessages() as live ones: ack
+// handling, zero-code expansion, circuit checks and dispatch.  Events
+// go through LLMessageSystem::dispatch() in the order they were
+// captured relative to the packets.
+//
+// Nothing is sent while replaying.  Every host in the capture gets a
+// trusted circuit for each pass, and loses it again afterwards.
+//
+// Handler times come from the message system's timing callback.  Each
+// goes into an LLTrace event stat for the whole replay, and into the
+// per message name figures in getHandlerStats().
+class LLMessageReplay
+{
+public:
+	struct HandlerStats
+	{
+		HandlerStats() : mIsEvent(false), mCount(0) {}
+
+		std::string	mName;
+		bool		mIsEvent;	// Came from the event queue, not UDP
+		S32			mCount;
+		F64Seconds	mTotal;
+		F64Seconds	mMax;
+	};
+	typedef std::vector<HandlerStats> stats_list_t;
+
+	LLMessageReplay(LLMessageSystem* msg);
+
+	bool load(const std::string& filename);
+	S32 getNumRecords() const						{ return (S32)mRecords.size(); }
+
+	// Replays the capture 'passes' times, running processAcks() after
+	// every 'batch_size' packets as the viewer does once a frame.
+	void run(S32 passes = 1, S32 batch_size = 64);
+
+	U32 getPacketsReplayed() const					{ return mPacketsReplayed; }
+	U64 getBytesReplayed() const					{ return mBytesReplayed; }
+	U32 getEventsReplayed() const					{ return mEventsReplayed; }
+	// Template messages that reached a handler
+	U32 getMessagesHandled() const					{ return mMessagesHandled; }
+	F64Seconds getElapsed() const					{ return mElapsed; }
+	// In all handlers, from the LLTrace recording of the run
+	F64Seconds getHandlerTime() const				{ return mHandlerTotal; }
+
+	// Most total time first
+	const stats_list_t& getHandlerStats() const		{ return mHandlerStats; }
+
+	// Throughput and the handler table, for people
+	void dumpReport(std::ostream& out) const;
+
+private:
+	static void timingCallback(const char* hashed_name, F32 time, void* data);
+	static void addHandlerTime(HandlerStats& stats, F64Seconds time);
+
+	void pump();
+	void dispatchEvent(const LLPacketCapture::Record& record);
+
+	LLMessageSystem* mMsg;
+	LLPacketCapture::record_list_t mRecords;
+	std::set<LLHost> mHosts;
+	S64 mFrame;
+
+	U32 mPacketsReplayed;
+	U64 mBytesReplayed;
+	U32 mEventsReplayed;
+	U32 mMessagesHandled;
+	F64Seconds mElapsed;
+	F64Seconds mHandlerTotal;
+	F64Seconds mHandlerMax;
+
+	// By prehashed name
+	typedef std::map<const char*, HandlerStats> message_stats_map_t;
+	typedef std::map<std::string, HandlerStats> event_stats_map_t;
+	message_stats_map_t mMessageStats;
+	event_stats_map_t mEventStats;
+	stats_list_t mHandlerStats;
+};
+
+#endif // LL_LLMESSAGEREPLAY_H
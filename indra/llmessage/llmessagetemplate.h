@@ -285,7 +285,8 @@ public:
 		mTotalDecodeTime(0.f),
 		mMaxDecodeTimePerMsg(0.f),
 		mBanFromTrusted(false),
-		mBanFromUntrusted(false)
+		mBanFromUntrusted(false),
+		mDecodedByHandler(false)
 	{
 		mName = LLMessageStringTable::getInstance()->getString(name);
 	}
@@ -353,6 +354,18 @@ public:
 		return mDeprecation;
 	}
 
+	// The handlers parse the message body with a generated decoder, so
+	// the reader doesn't build the data the get*() methods read
+	void setDecodedByHandler(bool decoded)
+	{
+		mDecodedByHandler = decoded;
+	}
+
+	bool getDecodedByHandler() const
+	{
+		return mDecodedByHandler;
+	}
+
 	void setHandlerFunc(void(*handler_func)(LLMessageSystem *msgsystem, void **user_data), void **user_data)
 	{
 		mMessageCallbacks.clear();
@@ -372,6 +385,11 @@ public:
 		return (BOOL)!mMessageCallbacks.empty();
 	}
 
+	bool hasHandlerFunc() const
+	{
+		return !mMessageCallbacks.empty();
+	}
+
 	bool isUdpBanned() const
 	{
 		return mDeprecation == MD_UDPBLACKLISTED;
@@ -412,6 +430,7 @@ public:
 
 	bool									mBanFromTrusted;
 	bool									mBanFromUntrusted;
+	bool									mDecodedByHandler;
 
 private:
 	// message handler function (this is set by each application)
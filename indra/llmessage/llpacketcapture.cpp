@@ -0,0 +1,306 @@
+/**
+ * @file llpacketcapture.cpp
+ * @brief Records inbound UDP and event queue traffic to disk and reads
+ * it back for replay.
+ *
+ * $LicenseInfo:firstyear=2001&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llpacketcapture.h"
+
+#include <sstream>
+
+#include "llsdserialize.h"
+#include "lltimer.h"
+#include "net.h"
+
+static const char CAPTURE_MAGIC[8] = { 'L', 'L', 'P', 'C', 'A', 'P', '\r', '\n' };
+
+// Biggest event message written, so a corrupt size can't make load()
+// allocate the world
+static const U32 MAX_EVENT_SIZE = 16 * 1024 * 1024;
+
+namespace
+{
+	// Reads the whole capture into memory and takes fields off the front
+	class CaptureBuffer
+	{
+	public:
+		CaptureBuffer(const std::vector<U8>& data)
+		:	mData(data),
+			mPos(0)
+		{
+		}
+
+		template<typename T>
+		bool read(T& value)
+		{
+			return read(&value, sizeof(T));
+		}
+
+		bool read(void* out, size_t size)
+		{
+			if (mData.size() - mPos < size)
+			{
+				return false;
+			}
+			memcpy(out, &mData[mPos], size);	/* Flawfinder: ignore */
+			mPos += size;
+			return true;
+		}
+
+		bool atEnd() const		{ return mPos == mData.size(); }
+
+	private:
+		const std::vector<U8>& mData;
+		size_t mPos;
+	};
+
+	bool read_file(const std::string& filename, std::vector<U8>& data)
+	{
+		LLFILE* file = LLFile::fopen(filename, "rb");	/* Flawfinder: ignore */
+		if (!file)
+		{
+			return false;
+		}
+		fseek(file, 0, SEEK_END);
+		long size = ftell(file);
+		fseek(file, 0, SEEK_SET);
+		bool ok = size >= 0;
+		if (ok)
+		{
+			data.resize((size_t)size);
+			ok = !size || fread(&data[0], 1, (size_t)size, file) == (size_t)size;
+		}
+		LLFile::close(file);
+		return ok;
+	}
+}
+
+//static
+bool LLPacketCapture::load(const std::string& filename, record_list_t& records,
+						   F32* template_version)
+{
+	std::vector<U8> data;
+	if (!read_file(filename, data))
+	{
+		LL_WARNS("Messaging") << "Unable to read packet capture " << filename << LL_ENDL;
+		return false;
+	}
+
+	CaptureBuffer buffer(data);
+	char magic[sizeof(CAPTURE_MAGIC)];
+	U32 version = 0;
+	F32 file_template_version = 0.f;
+	U64 start_time = 0;
+	if (!buffer.read(magic, sizeof(magic))
+		|| memcmp(magic, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC))
+		|| !buffer.read(version)
+		|| !buffer.read(file_template_version)
+		|| !buffer.read(start_time))
+	{
+		LL_WARNS("Messaging") << filename << " is not a packet capture" << LL_ENDL;
+		return false;
+	}
+	if (version != FORMAT_VERSION)
+	{
+		LL_WARNS("Messaging") << filename << " is capture format " << version
+			<< ", expected " << (U32)FORMAT_VERSION << LL_ENDL;
+		return false;
+	}
+	if (template_version)
+	{
+		*template_version = file_template_version;
+	}
+
+	records.clear();
+	while (!buffer.atEnd())
+	{
+		Record record;
+		U8 type = 0;
+		if (!buffer.read(type) || !buffer.read(record.mTime))
+		{
+			break;
+		}
+
+		bool complete = false;
+		if (type == PACKET)
+		{
+			U32 address = 0;
+			U16 port = 0;
+			U16 size = 0;
+			if (buffer.read(address) && buffer.read(port) && buffer.read(size)
+				&& size <= NET_BUFFER_SIZE)
+			{
+				record.mType = PACKET;
+				record.mSender = LLHost(address, port);
+				record.mData.resize(size);
+				complete = !size || buffer.read(&record.mData[0], size);
+			}
+		}
+		else if (type == EVENT)
+		{
+			U16 name_size = 0;
+			U32 size = 0;
+			std::vector<char> name;
+			if (buffer.read(name_size))
+			{
+				name.resize(name_size);
+				if ((!name_size || buffer.read(&name[0], name_size))
+					&& buffer.read(size) && size <= MAX_EVENT_SIZE)
+				{
+					std::string serialized(size, '\0');
+					if (!size || buffer.read(&serialized[0], size))
+					{
+						record.mType = EVENT;
+						record.mName.assign(name.begin(), name.end());
+						std::istringstream istr(serialized);
+						complete = LLSDSerialize::fromBinary(record.mMessage, istr, size) > 0;
+					}
+				}
+			}
+		}
+
+		if (!complete)
+		{
+			LL_WARNS("Messaging") << "Packet capture " << filename << " ends in a bad record after "
+				<< records.size() << " records" << LL_ENDL;
+			break;
+		}
+		records.push_back(record);
+	}
+	return true;
+}
+
+LLPacketCaptureWriter::LLPacketCaptureWriter()
+:	mFile(NULL),
+	mStartTime(0),
+	mRecordCount(0)
+{
+}
+
+LLPacketCaptureWriter::~LLPacketCaptureWriter()
+{
+	close();
+}
+
+bool LLPacketCaptureWriter::open(const std::string& filename, F32 template_version)
+{
+	close();
+
+	mFile = LLFile::fopen(filename, "wb");	/* Flawfinder: ignore */
+	if (!mFile)
+	{
+		LL_WARNS("Messaging") << "Unable to create packet capture " << filename << LL_ENDL;
+		return false;
+	}
+
+	mStartTime = totalTime();
+	mRecordCount = 0;
+	U32 version = LLPacketCapture::FORMAT_VERSION;
+	write(CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+	write(&version, sizeof(version));
+	write(&template_version, sizeof(template_version));
+	write(&mStartTime, sizeof(mStartTime));
+	if (mFile)
+	{
+		LL_INFOS("Messaging") << "Capturing packets to " << filename << LL_ENDL;
+	}
+	return mFile != NULL;
+}
+
+void LLPacketCaptureWriter::close()
+{
+	if (mFile)
+	{
+		LLFile::close(mFile);
+		mFile = NULL;
+		LL_INFOS("Messaging") << "Packet capture closed after " << mRecordCount << " records" << LL_ENDL;
+	}
+}
+
+void LLPacketCaptureWriter::writePacket(const LLHost& sender, const U8* data, S32 size)
+{
+	if (!mFile || !data || size <= 0 || size > NET_BUFFER_SIZE)
+	{
+		return;
+	}
+
+	U32 address = sender.getAddress();
+	U16 port = (U16)sender.getPort();
+	U16 packet_size = (U16)size;
+	writeRecordHeader(LLPacketCapture::PACKET);
+	write(&address, sizeof(address));
+	write(&port, sizeof(port));
+	write(&packet_size, sizeof(packet_size));
+	write(data, size);
+}
+
+void LLPacketCaptureWriter::writeEvent(const std::string& name, const LLSD& message)
+{
+	if (!mFile || name.size() > U16_MAX)
+	{
+		return;
+	}
+
+	std::ostringstream ostr;
+	LLSDSerialize::toBinary(message, ostr);
+	const std::string serialized = ostr.str();
+	if (serialized.size() > MAX_EVENT_SIZE)
+	{
+		LL_WARNS("Messaging") << "Not capturing " << serialized.size() << " byte " << name
+			<< " event" << LL_ENDL;
+		return;
+	}
+
+	U16 name_size = (U16)name.size();
+	U32 size = (U32)serialized.size();
+	writeRecordHeader(LLPacketCapture::EVENT);
+	write(&name_size, sizeof(name_size));
+	write(name.data(), name_size);
+	write(&size, sizeof(size));
+	write(serialized.data(), size);
+}
+
+void LLPacketCaptureWriter::writeRecordHeader(LLPacketCapture::ERecordType type)
+{
+	U8 record_type = (U8)type;
+	U64 time = totalTime() - mStartTime;
+	write(&record_type, sizeof(record_type));
+	write(&time, sizeof(time));
+	++mRecordCount;
+}
+
+void LLPacketCaptureWriter::write(const void* data, size_t size)
+{
+	if (mFile && size && fwrite(data, 1, size, mFile) != size)
+	{
+		// Most likely out of disk.  What's there so far can still be
+		// replayed, load() drops the partial record.
+		LL_WARNS("Messaging") << "Stopping packet capture, write failed after "
+			<< mRecordCount << " records" << LL_ENDL;
+		LLFile::close(mFile);
+		mFile = NULL;
+	}
+}
@@ -0,0 +1,114 @@
+/**
+ * @file llpacketcapture.h
+ * @brief Records inbound UDP and event queue traffic to disk and reads
+ * it back for replay.
+ *
+ * $LicenseInfo:firstyear=2001&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLPACKETCAPTURE_H
+#define LL_LLPACKETCAPTURE_H
+
+#include <string>
+#include <vector>
+
+#include "llfile.h"
+#include "llhost.h"
+#include "llsd.h"
+
+// A capture file is a header followed by one record per packet or
+// event, in the order the message system was handed them.  Everything
+// is little-endian.
+//
+// Header:
+//	char[8]	"LLPCAP\r\n"
+//	U32		format version
+//	F32		message template version the capture was made with
+//	U64		capture start, microseconds since the epoch
+//
+// Record:
+//	U8		record type
+//	U64		microseconds since the capture started
+//	PACKET:	U32 sender address, U16 sender port, U16 size, then the
+//			datagram as received, zero-coded and with any acks appended
+//	EVENT:	U16 name length, the name, U32 size, then the message as
+//			binary LLSD
+class LLPacketCapture
+{
+public:
+	enum
+	{
+		FORMAT_VERSION = 1
+	};
+
+	enum ERecordType
+	{
+		PACKET = 1,
+		EVENT = 2
+	};
+
+	struct Record
+	{
+		Record() : mType(PACKET), mTime(0) {}
+
+		ERecordType			mType;
+		U64					mTime;
+		LLHost				mSender;	// PACKET
+		std::vector<U8>		mData;		// PACKET
+		std::string			mName;		// EVENT
+		LLSD				mMessage;	// EVENT
+	};
+	typedef std::vector<Record> record_list_t;
+
+	// Reads every record of 'filename' into 'records'.  False if the file
+	// can't be read or isn't a capture.  A record cut short, as the last
+	// one is when the viewer didn't shut down cleanly, ends the list.
+	static bool load(const std::string& filename, record_list_t& records,
+					 F32* template_version = NULL);
+};
+
+class LLPacketCaptureWriter
+{
+public:
+	LLPacketCaptureWriter();
+	~LLPacketCaptureWriter();
+
+	// Creates 'filename', replacing anything already there
+	bool open(const std::string& filename, F32 template_version);
+	void close();
+	bool isOpen() const								{ return mFile != NULL; }
+
+	void writePacket(const LLHost& sender, const U8* data, S32 size);
+	void writeEvent(const std::string& name, const LLSD& message);
+
+	U32 getRecordCount() const						{ return mRecordCount; }
+
+private:
+	void writeRecordHeader(LLPacketCapture::ERecordType type);
+	void write(const void* data, size_t size);
+
+	LLFILE*	mFile;
+	U64		mStartTime;
+	U32		mRecordCount;
+};
+
+#endif // LL_LLPACKETCAPTURE_H
@@ -0,0 +1,231 @@
+/** 
+ * @file llpacketreceiver.cpp
+ * @brief Network thread that drains the message system's UDP socket
+ *
+ * $LicenseInfo:firstyear=2001&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+
+#include "linden_common.h"
+
+#include "llpacketreceiver.h"
+
+#if LL_WINDOWS
+	#include "llwin32headerslean.h"
+#else
+	#include <netinet/in.h>
+#endif
+
+#include "lltimer.h"
+#include "message.h"
+
+// Power of two.  About twice what the socket buffer holds in full
+// sized packets.
+const U32 RECEIVE_RING_SIZE = 256;
+
+// Most datagrams taken per receive call
+const S32 RECEIVE_BATCH_SIZE = 32;
+
+// How long the thread sleeps in select() between checks for shutdown
+const S32 RECEIVE_WAIT_MS = 50;
+
+LLReceivedPacket::LLReceivedPacket()
+:	mSize(0),
+	mBody(mData),
+	mBodySize(0),
+	mCompressedSize(0),
+	mMalformed(false),
+	mOverflowed(false),
+	mNumAcks(0)
+{
+}
+
+// Same parsing checkMessages() does inline for packets it reads itself
+void LLReceivedPacket::process()
+{
+	mBody = mData;
+	mBodySize = mSize;
+	mCompressedSize = 0;
+	mMalformed = false;
+	mOverflowed = false;
+	mNumAcks = 0;
+
+	if (mSize < (S32)LL_MINIMUM_VALID_PACKET_SIZE)
+	{
+		// Reported by checkMessages()
+		return;
+	}
+
+	if (mData[0] & LL_ACK_FLAG)
+	{
+		const S32 acks = mData[--mBodySize];
+		if (mBodySize < (S32)(acks * sizeof(TPACKETID) + LL_MINIMUM_VALID_PACKET_SIZE))
+		{
+			mMalformed = true;
+			mNumAcks = acks;
+			return;
+		}
+
+		S32 ack_pos = mBodySize;
+		mBodySize -= acks * sizeof(TPACKETID);
+		for (S32 i = 0; i < acks; ++i)
+		{
+			U32 mem_id = 0;
+			ack_pos -= sizeof(TPACKETID);
+			memcpy(&mem_id, &mData[ack_pos], sizeof(TPACKETID));	/* Flawfinder: ignore */
+			mAcks[i] = ntohl(mem_id);
+		}
+		mNumAcks = acks;
+	}
+
+	if (mData[0] & LL_ZERO_CODE_FLAG)
+	{
+		mCompressedSize = mBodySize;
+		mBodySize = LLMessageSystem::zeroCodeExpand(mData, mBodySize, mExpanded, mOverflowed);
+		mBody = mExpanded;
+	}
+}
+
+//----------------------------------------------------------------------------
+
+LLPacketReceiveThread::LLPacketReceiveThread(S32 socket)
+:	LLThread("UDP receive"),
+	mSocket(socket),
+	mSlots(RECEIVE_RING_SIZE),
+	mSlotMask(RECEIVE_RING_SIZE - 1),
+	mHead(0),
+	mTail(0),
+	mFullWarnings(0)
+{
+}
+
+LLPacketReceiveThread::~LLPacketReceiveThread()
+{
+	// Before the slots go away
+	shutdown();
+}
+
+// MAIN THREAD
+LLReceivedPacket* LLPacketReceiveThread::frontPacket()
+{
+	const U32 tail = mTail.load(std::memory_order_relaxed);
+	if (tail == mHead.load(std::memory_order_acquire))
+	{
+		return NULL;
+	}
+	return &mSlots[tail & mSlotMask];
+}
+
+// MAIN THREAD
+void LLPacketReceiveThread::popPacket()
+{
+	const U32 tail = mTail.load(std::memory_order_relaxed);
+	llassert(tail != mHead.load(std::memory_order_acquire));
+	mTail.store(tail + 1, std::memory_order_release);
+}
+
+U32 LLPacketReceiveThread::getBacklog() const
+{
+	return mHead.load(std::memory_order_acquire) - mTail.load(std::memory_order_acquire);
+}
+
+S32 LLPacketReceiveThread::receiveBatch()
+{
+	const U32 head = mHead.load(std::memory_order_relaxed);
+	const U32 free_slots = RECEIVE_RING_SIZE - (head - mTail.load(std::memory_order_acquire));
+	if (!free_slots)
+	{
+		return -1;
+	}
+
+	char* buffers[RECEIVE_BATCH_SIZE];
+	S32 sizes[RECEIVE_BATCH_SIZE];
+	LLHost senders[RECEIVE_BATCH_SIZE];
+	U32 receiving_ips[RECEIVE_BATCH_SIZE];
+
+	const S32 count = llmin((S32)free_slots, RECEIVE_BATCH_SIZE);
+	for (S32 i = 0; i < count; ++i)
+	{
+		buffers[i] = (char*)mSlots[(head + i) & mSlotMask].mData;
+	}
+
+	const S32 received = receive_packets(mSocket, buffers, sizeof(LLReceivedPacket::mData), sizes,
+										 senders, receiving_ips, count);
+	for (S32 i = 0; i < received; ++i)
+	{
+		LLReceivedPacket& packet = mSlots[(head + i) & mSlotMask];
+		packet.mSize = sizes[i];
+		packet.mSender = senders[i];
+		packet.mReceivingIF = LLHost(receiving_ips[i], INVALID_PORT);
+
+		if (LLProxy::isSOCKSProxyEnabled())
+		{
+			if (packet.mSize > SOCKS_HEADER_SIZE)
+			{
+				// *FIX We are assuming ATYP is 0x01 (IPv4), not 0x03 (hostname) or 0x04 (IPv6)
+				proxywrap_t* header = static_cast<proxywrap_t*>(static_cast<void*>(packet.mData));
+				packet.mSender.setAddress(header->addr);
+				packet.mSender.setPort(ntohs(header->port));
+				packet.mSize -= SOCKS_HEADER_SIZE;
+				memmove(packet.mData, packet.mData + SOCKS_HEADER_SIZE, packet.mSize);
+			}
+			else
+			{
+				packet.mSize = 0;
+			}
+		}
+
+		packet.process();
+	}
+
+	if (received > 0)
+	{
+		mHead.store(head + received, std::memory_order_release);
+	}
+	return received;
+}
+
+// virtual
+void LLPacketReceiveThread::run()
+{
+	LL_INFOS("Messaging") << "UDP receive thread started" << LL_ENDL;
+
+	while (!isQuitting())
+	{
+		const S32 received = receiveBatch();
+		if (received < 0)
+		{
+			// Main thread is behind, let the socket buffer take up the slack
+			if (!(mFullWarnings++ % 1000))
+			{
+				LL_WARNS("Messaging") << "UDP receive ring full" << LL_ENDL;
+			}
+			ms_sleep(1);
+		}
+		else if (!received)
+		{
+			wait_for_packet(mSocket, RECEIVE_WAIT_MS);
+		}
+	}
+
+	LL_INFOS("Messaging") << "UDP receive thread exiting" << LL_ENDL;
+}
@@ -0,0 +1,106 @@
+/** 
+ * @file llpacketreceiver.h
+ * @brief Network thread that drains the message system's UDP socket
+ *
+ * $LicenseInfo:firstyear=2001&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLPACKETRECEIVER_H
+#define LL_LLPACKETRECEIVER_H
+
+#include <atomic>
+#include <vector>
+
+#include "llhost.h"
+#include "llproxy.h"
+#include "llthread.h"
+#include "net.h"
+
+// A datagram as taken off the socket, with the work checkMessages()
+// would otherwise do first already done:  appended acks split off and
+// the body zero-code expanded.
+struct LLReceivedPacket
+{
+	LLReceivedPacket();
+
+	// Fills in the fields below mSize from mData
+	void process();
+
+	// As received, less any SOCKS header.  Room for the header so
+	// it can be received in place.
+	U8		mData[NET_BUFFER_SIZE + SOCKS_HEADER_SIZE];
+	S32		mSize;
+	LLHost	mSender;
+	LLHost	mReceivingIF;
+
+	// The message itself, without appended acks, pointing into
+	// mData or mExpanded.
+	U8*		mBody;
+	S32		mBodySize;
+	S32		mCompressedSize;	// Body size before expansion, 0 if not zero-coded
+	bool	mMalformed;			// Ack count runs past the packet
+	bool	mOverflowed;		// Zero-coding expanded past MAX_BUFFER_SIZE
+
+	S32			mNumAcks;
+	TPACKETID	mAcks[255];		// Host order, as appended
+
+	U8		mExpanded[NET_BUFFER_SIZE];
+};
+
+// Drains the socket on its own thread so packets queue up in memory
+// instead of overflowing the socket buffer while the main thread is
+// busy.  Hands them to the main thread through a single-producer,
+// single-consumer ring.  Where the platform has recvmmsg() a batch
+// of waiting datagrams is taken per system call.
+class LLPacketReceiveThread : public LLThread
+{
+public:
+	LLPacketReceiveThread(S32 socket);
+	~LLPacketReceiveThread();
+
+	// MAIN THREAD.  Oldest received packet or NULL if none.  Stays
+	// valid until popPacket().
+	LLReceivedPacket* frontPacket();
+	void popPacket();
+
+	// Packets waiting for the main thread
+	U32 getBacklog() const;
+
+	U32 getCapacity() const			{ return (U32)mSlots.size(); }
+
+private:
+	void run() override;
+
+	// Receives what's waiting into free slots, returns the count
+	S32 receiveBatch();
+
+	S32 mSocket;
+
+	std::vector<LLReceivedPacket> mSlots;
+	U32 mSlotMask;
+	std::atomic<U32> mHead;		// Next slot to fill, written by this thread only
+	std::atomic<U32> mTail;		// Next slot to read, written by the main thread only
+
+	U32 mFullWarnings;
+};
+
+#endif // LL_LLPACKETRECEIVER_H
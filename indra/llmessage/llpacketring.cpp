@@ -46,6 +46,14 @@
 #include "u64.h"
 
 #include "llmessagelog.h"
+#include "llpacketcapture.h"
+#include "llpacketreceiver.h"
+
+// Packets held per send_packets() call
+const S32 SEND_BATCH_SIZE = 64;
+
+// Most acks appended to one packet, as in LLMessageSystem::sendMessage()
+const S32 MAX_APPENDED_ACKS = 250;
 
 ///////////////////////////////////////////////////////////
 LLPacketRing::LLPacketRing () :
@@ -59,7 +67,15 @@ LLPacketRing::LLPacketRing () :
 	mInBufferLength(0),
 	mOutBufferLength(0),
 	mDropPercentage(0.0f),
-	mPacketsToDrop(0x0)
+	mPacketsToDrop(0x0),
+	mCaptureWriter(nullptr),
+	mReplaying(false),
+	mReceiveThread(nullptr),
+	mHoldingPacket(false),
+	mBatchSends(false),
+	mNumQueuedSends(0),
+	mQueuedSendFailures(0),
+	mSendCalls(0)
 {
 }
 
@@ -72,6 +88,8 @@ LLPacketRing::~LLPacketRing ()
 ///////////////////////////////////////////////////////////
 void LLPacketRing::cleanup ()
 {
+	stopReceiveThread();
+
 	LLPacketBuffer *packetp;
 
 	while (!mReceiveQueue.empty())
@@ -87,6 +105,9 @@ void LLPacketRing::cleanup ()
 		delete packetp;
 		mSendQueue.pop();
 	}
+
+	mNumQueuedSends = 0;
+	mReplayQueue.clear();
 }
 
 ///////////////////////////////////////////////////////////
@@ -162,6 +183,20 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
 {
 	S32 packet_size = 0;
 
+	if (mReplaying)
+	{
+		if (!mReplayQueue.empty())
+		{
+			const ReplayPacket& packet = mReplayQueue.front();
+			packet_size = packet.mSize;
+			memcpy(datap, packet.mData, packet_size);	/* Flawfinder: ignore */
+			mLastSender = packet.mSender;
+			mLastReceivingIF = LLHost();
+			mReplayQueue.pop_front();
+		}
+		return packet_size;
+	}
+
 	// If using the throttle, simulate a limited size input buffer.
 	if (mUseInThrottle)
 	{
@@ -271,17 +306,130 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
 		}
 	}
 
+	if (packet_size && mCaptureWriter)
+	{
+		mCaptureWriter->writePacket(mLastSender, (U8*)datap, packet_size);
+	}
+
 	return packet_size;
 }
 
-BOOL LLPacketRing::sendPacket(int h_socket, char * send_buffer, S32 buf_size, LLHost host)
+void LLPacketRing::setReplaying(bool replaying)
+{
+	mReplaying = replaying;
+	if (!mReplaying)
+	{
+		mReplayQueue.clear();
+	}
+}
+
+void LLPacketRing::queueReplayPacket(const LLHost& sender, const U8* data, S32 size)
+{
+	if (size <= 0 || size > NET_BUFFER_SIZE)
+	{
+		return;
+	}
+	ReplayPacket packet;
+	packet.mSender = sender;
+	packet.mData = data;
+	packet.mSize = size;
+	mReplayQueue.push_back(packet);
+}
+
+///////////////////////////////////////////////////////////
+void LLPacketRing::startReceiveThread(S32 socket)
+{
+	if (mReceiveThread)
+	{
+		return;
+	}
+	if (mUseInThrottle)
+	{
+		LL_WARNS() << "Not using a UDP receive thread with the inbound throttle on" << LL_ENDL;
+		return;
+	}
+
+	mReceiveThread = new LLPacketReceiveThread(socket);
+	mReceiveThread->start();
+}
+
+void LLPacketRing::stopReceiveThread()
+{
+	delete mReceiveThread;
+	mReceiveThread = nullptr;
+	mHoldingPacket = false;
+}
+
+LLReceivedPacket* LLPacketRing::receiveProcessedPacket()
+{
+	if (!mReceiveThread)
+	{
+		return nullptr;
+	}
+
+	if (mHoldingPacket)
+	{
+		mReceiveThread->popPacket();
+		mHoldingPacket = false;
+	}
+
+	while (LLReceivedPacket* packetp = mReceiveThread->frontPacket())
+	{
+		if (packetp->mSize)
+		{
+			if (mDropPercentage && (ll_frand(100.f) < mDropPercentage))
+			{
+				mPacketsToDrop++;
+			}
+
+			if (!mPacketsToDrop)
+			{
+				mLastSender = packetp->mSender;
+				mLastReceivingIF = packetp->mReceivingIF;
+				mHoldingPacket = true;
+				if (mCaptureWriter)
+				{
+					mCaptureWriter->writePacket(mLastSender, packetp->mData, packetp->mSize);
+				}
+				return packetp;
+			}
+			mPacketsToDrop--;
+		}
+		mReceiveThread->popPacket();
+	}
+	return nullptr;
+}
+
+U32 LLPacketRing::getReceiveBacklog() const
+{
+	return mReceiveThread ? mReceiveThread->getBacklog() : 0;
+}
+
+bool LLPacketRing::isReceiveBacklogged() const
+{
+	return mReceiveThread && mReceiveThread->getBacklog() > mReceiveThread->getCapacity() / 2;
+}
+
+BOOL LLPacketRing::sendPacket(int h_socket, char * send_buffer, S32 buf_size, LLHost host, bool can_carry_acks)
 {
 #define LOCALHOST_ADDR 16777343
 	LLMessageLog::log(LLHost(LOCALHOST_ADDR, gMessageSystem->getListenPort()), host, (U8*)send_buffer, buf_size);
 #undef LOCALHOST_ADDR
+	if (mReplaying)
+	{
+		// Replies to replayed packets would go to the real hosts
+		return TRUE;
+	}
+
 	BOOL status = TRUE;
 	if (!mUseOutThrottle)
 	{
+		if (mBatchSends)
+		{
+			// Failures are counted when the batch goes out
+			queuePacket(h_socket, send_buffer, buf_size, host, can_carry_acks);
+			return TRUE;
+		}
 		return sendPacketImpl(h_socket, send_buffer, buf_size, host );
 	}
 	else
@@ -351,9 +499,132 @@ BOOL LLPacketRing::sendPacket(int h_socket, char * send_buffer, S32 buf_size, LL
 	return status;
 }
 
+S32 LLPacketRing::setBatchSends(int h_socket, bool batch_sends)
+{
+	mBatchSends = batch_sends;
+	if (!mBatchSends)
+	{
+		return flushSends(h_socket);
+	}
+	if (mSendBatch.empty())
+	{
+		mSendBatch.resize(SEND_BATCH_SIZE);
+	}
+	return 0;
+}
+
+void LLPacketRing::queuePacket(int h_socket, const char * send_buffer, S32 buf_size, LLHost host, bool can_carry_acks)
+{
+	if (mSendBatch.empty())
+	{
+		mSendBatch.resize(SEND_BATCH_SIZE);
+	}
+	if (mNumQueuedSends == (S32)mSendBatch.size())
+	{
+		mQueuedSendFailures += flushSends(h_socket);
+	}
+
+	QueuedPacket& packet = mSendBatch[mNumQueuedSends++];
+	packet.mHost = host;
+	packet.mSize = buf_size;
+	packet.mCanCarryAcks = can_carry_acks;
+	memcpy(packet.mData + SOCKS_HEADER_SIZE, send_buffer, buf_size);	/* Flawfinder: ignore */
+}
+
+// Same layout LLMessageSystem::sendMessage() appends: packet IDs in
+// network order, then the count in the last byte.
+S32 LLPacketRing::appendQueuedAcks(const LLHost& host, std::vector<TPACKETID>& acks)
+{
+	S32 appended = 0;
+	for (S32 i = 0; i < mNumQueuedSends && !acks.empty(); ++i)
+	{
+		QueuedPacket& packet = mSendBatch[i];
+		if (!packet.mCanCarryAcks || packet.mHost != host)
+		{
+			continue;
+		}
+
+		U8* data = (U8*)packet.mData + SOCKS_HEADER_SIZE;
+		S32 size = packet.mSize;
+		S32 count = 0;
+		if (data[0] & LL_ACK_FLAG)
+		{
+			// Add to the acks already there, the count moves to the end
+			count = data[--size];
+		}
+
+		S32 space_left = (MTUBYTES - size - 1) / (S32)sizeof(TPACKETID);
+		S32 append_count = llmin(llmin(space_left, (S32)acks.size()), MAX_APPENDED_ACKS - count);
+		if (append_count <= 0)
+		{
+			continue;
+		}
+
+		for (S32 j = 0; j < append_count; ++j)
+		{
+			TPACKETID packet_id = htonl(acks[j]);
+			memcpy(data + size, &packet_id, sizeof(TPACKETID));	/* Flawfinder: ignore */
+			size += sizeof(TPACKETID);
+		}
+		data[size++] = (U8)(count + append_count);
+		data[0] |= LL_ACK_FLAG;
+		packet.mSize = size;
+
+		acks.erase(acks.begin(), acks.begin() + append_count);
+		appended += append_count;
+	}
+	return appended;
+}
+
+S32 LLPacketRing::flushSends(int h_socket)
+{
+	S32 failures = mQueuedSendFailures;
+	mQueuedSendFailures = 0;
+	if (!mNumQueuedSends)
+	{
+		return failures;
+	}
+
+	const char* buffers[SEND_BATCH_SIZE];
+	S32 sizes[SEND_BATCH_SIZE];
+	LLHost recipients[SEND_BATCH_SIZE];
+
+	const bool use_proxy = LLProxy::isSOCKSProxyEnabled();
+	for (S32 i = 0; i < mNumQueuedSends; ++i)
+	{
+		QueuedPacket& packet = mSendBatch[i];
+		if (use_proxy)
+		{
+			// Wrapped in place, as sendPacketImpl() does in a copy
+			proxywrap_t *socks_header = static_cast<proxywrap_t*>(static_cast<void*>(packet.mData));
+			socks_header->rsv   = 0;
+			socks_header->addr  = packet.mHost.getAddress();
+			socks_header->port  = htons(packet.mHost.getPort());
+			socks_header->atype = ADDRESS_IPV4;
+			socks_header->frag  = 0;
+
+			buffers[i] = packet.mData;
+			sizes[i] = packet.mSize + SOCKS_HEADER_SIZE;
+			recipients[i] = LLProxy::getInstance()->getUDPProxy();
+		}
+		else
+		{
+			buffers[i] = packet.mData + SOCKS_HEADER_SIZE;
+			sizes[i] = packet.mSize;
+			recipients[i] = packet.mHost;
+		}
+	}
+
+	S32 sent = send_packets(h_socket, buffers, sizes, recipients, mNumQueuedSends, mSendCalls);
+	failures += mNumQueuedSends - sent;
+	mNumQueuedSends = 0;
+	return failures;
+}
+
 BOOL LLPacketRing::sendPacketImpl(int h_socket, const char * send_buffer, S32 buf_size, LLHost host)
 {
-	
+	++mSendCalls;
+
 	if (!LLProxy::isSOCKSProxyEnabled())
 	{
 		return send_packet(h_socket, send_buffer, buf_size, host.getAddress(), host.getPort());
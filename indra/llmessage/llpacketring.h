@@ -28,7 +28,9 @@
 #ifndef LL_LLPACKETRING_H
 #define LL_LLPACKETRING_H
 
+#include <deque>
 #include <queue>
+#include <vector>
 
 #include "llhost.h"
 #include "llpacketbuffer.h"
@@ -36,6 +38,10 @@
 #include "llthrottle.h"
 #include "net.h"
 
+class LLPacketCaptureWriter;
+class LLPacketReceiveThread;
+struct LLReceivedPacket;
+
 class LLPacketRing
 {
 public:
@@ -53,7 +59,61 @@ public:
 	S32  receivePacket (S32 socket, char *datap);
 	S32  receiveFromRing (S32 socket, char *datap);
 
-	BOOL sendPacket(int h_socket, char * send_buffer, S32 buf_size, LLHost host);
+	// can_carry_acks:  acks may be appended to the packet while it waits
+	// in the send batch.
+	BOOL sendPacket(int h_socket, char * send_buffer, S32 buf_size, LLHost host, bool can_carry_acks = false);
+
+	// MAIN THREAD.  Holds outgoing packets until flushSends() so they go
+	// out in one send_packets() call.  Turning it off sends what is held
+	// and returns flushSends()'s failure count.
+	// Ignored while the outbound throttle is in use.
+	S32 setBatchSends(int h_socket, bool batch_sends);
+	bool getBatchSends() const					{ return mBatchSends; }
+
+	// Adds a packet to the send batch, flushing first if it's full
+	void queuePacket(int h_socket, const char * send_buffer, S32 buf_size, LLHost host, bool can_carry_acks);
+	S32 getNumQueuedSends() const				{ return mNumQueuedSends; }
+
+	// Appends as many of 'acks' as fit to batched packets bound for
+	// 'host', removing them from 'acks'.  Returns the number appended.
+	S32 appendQueuedAcks(const LLHost& host, std::vector<TPACKETID>& acks);
+
+	// Sends the batch.  Returns the number of packets that failed since
+	// the last flush.
+	S32 flushSends(int h_socket);
+
+	// System calls made to send packets since the last reset
+	U32 getAndResetSendCalls()					{ U32 calls = mSendCalls; mSendCalls = 0; return calls; }
+
+	// Moves socket reads onto a network thread.  Not for use with the
+	// simulated inbound throttle, which reads on the main thread.
+	void startReceiveThread(S32 socket);
+	void stopReceiveThread();
+	bool hasReceiveThread() const				{ return mReceiveThread != nullptr; }
+
+	// MAIN THREAD.  Next packet from the receive thread or NULL if none
+	// are waiting.  Valid until the next call.
+	LLReceivedPacket* receiveProcessedPacket();
+
+	// Packets the receive thread has waiting
+	U32 getReceiveBacklog() const;
+
+	// Receive thread's ring is more than half full
+	bool isReceiveBacklogged() const;
+
+	// MAIN THREAD.  Every packet handed on to the message system is
+	// also written to 'writer', NULL to stop.  The caller owns it.
+	void setCaptureWriter(LLPacketCaptureWriter* writer)	{ mCaptureWriter = writer; }
+
+	// While replaying, receivePacket() only returns packets queued with
+	// queueReplayPacket(), and outgoing packets are dropped so nothing
+	// reaches the hosts in the capture.  Queued packets aren't copied,
+	// their data has to stay put until they're received.  They're read
+	// here on the main thread even if the receive thread is running.
+	void setReplaying(bool replaying);
+	bool isReplaying() const					{ return mReplaying; }
+	void queueReplayPacket(const LLHost& sender, const U8* data, S32 size);
+	S32 getNumReplayPackets() const				{ return (S32)mReplayQueue.size(); }
 
 	inline LLHost getLastSender();
 	inline LLHost getLastReceivingInterface();
@@ -83,6 +143,36 @@ protected:
 	LLHost mLastSender;
 	LLHost mLastReceivingIF;
 
+	LLPacketCaptureWriter* mCaptureWriter;
+
+	struct ReplayPacket
+	{
+		LLHost		mSender;
+		const U8*	mData;
+		S32			mSize;
+	};
+	bool mReplaying;
+	std::deque<ReplayPacket> mReplayQueue;
+
+	LLPacketReceiveThread* mReceiveThread;
+	bool mHoldingPacket;			// Front packet of mReceiveThread is out
+
+	// Outgoing packet held for the next flushSends(), with room in front
+	// for a SOCKS header
+	struct QueuedPacket
+	{
+		LLHost	mHost;
+		S32		mSize;
+		bool	mCanCarryAcks;
+		char	mData[SOCKS_HEADER_SIZE + NET_BUFFER_SIZE];
+	};
+
+	bool mBatchSends;
+	std::vector<QueuedPacket> mSendBatch;
+	S32 mNumQueuedSends;
+	S32 mQueuedSendFailures;		// From flushes queuePacket() did
+	U32 mSendCalls;
+
 private:
 	BOOL sendPacketImpl(int h_socket, const char * send_buffer, S32 buf_size, LLHost host);
 };
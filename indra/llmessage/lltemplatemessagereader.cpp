@@ -45,6 +45,8 @@ LLTemplateMessageReader::LLTemplateMessageReader(message_template_number_map_t&
 	mReceiveSize(0),
 	mCurrentRMessageTemplate(nullptr),
 	mCurrentRMessageData(nullptr),
+	mCurrentRMessageBody(nullptr),
+	mCurrentRMessageBodySize(0),
 	mMessageNumbers(number_template_map)
 {
 }
@@ -63,6 +65,8 @@ void LLTemplateMessageReader::clearMessage()
 	mCurrentRMessageTemplate = nullptr;
 	delete mCurrentRMessageData;
 	mCurrentRMessageData = nullptr;
+	mCurrentRMessageBody = nullptr;
+	mCurrentRMessageBodySize = 0;
 }
 
 void LLTemplateMessageReader::getData(const char *blockname, const char *varname, void *datap, S32 size, S32 blocknum, S32 max_size)
@@ -538,6 +542,57 @@ void LLTemplateMessageReader::logRanOffEndOfPacket( const LLHost& host, const S3
 
 static LLTrace::BlockTimerStatHandle FTM_PROCESS_MESSAGES("Process Messages");
 
+void LLTemplateMessageReader::callHandler(const LLHost& sender)
+{
+	static LLTimer decode_timer;
+
+	if(LLMessageReader::getTimeDecodes() || gMessageSystem->getTimingCallback())
+	{
+		decode_timer.reset();
+	}
+
+	{
+		LL_RECORD_BLOCK_TIME(FTM_PROCESS_MESSAGES);
+		if( !mCurrentRMessageTemplate->callHandlerFunc(gMessageSystem) )
+		{
+			LL_WARNS() << "Message from " << sender << " with no handler function received: " << mCurrentRMessageTemplate->mName << LL_ENDL;
+		}
+	}
+
+	if(LLMessageReader::getTimeDecodes() || gMessageSystem->getTimingCallback())
+	{
+		F32 decode_time = decode_timer.getElapsedTimeF32();
+
+		if (gMessageSystem->getTimingCallback())
+		{
+			(gMessageSystem->getTimingCallback())(mCurrentRMessageTemplate->mName,
+							decode_time,
+							gMessageSystem->getTimingCallbackData());
+		}
+
+		if (LLMessageReader::getTimeDecodes())
+		{
+			mCurrentRMessageTemplate->mDecodeTimeThisFrame += decode_time;
+
+			mCurrentRMessageTemplate->mTotalDecoded++;
+			mCurrentRMessageTemplate->mTotalDecodeTime += decode_time;
+
+			if( mCurrentRMessageTemplate->mMaxDecodeTimePerMsg < decode_time )
+			{
+				mCurrentRMessageTemplate->mMaxDecodeTimePerMsg = decode_time;
+			}
+
+
+			if(decode_time > LLMessageReader::getTimeDecodesSpamThreshold())
+			{
+				LL_DEBUGS() << "--------- Message " << mCurrentRMessageTemplate->mName << " decode took " << decode_time << " seconds. (" <<
+					mCurrentRMessageTemplate->mMaxDecodeTimePerMsg << " max, " <<
+					(mCurrentRMessageTemplate->mTotalDecodeTime / mCurrentRMessageTemplate->mTotalDecoded) << " avg)" << LL_ENDL;
+			}
+		}
+	}
+}
+
 // decode a given message
 BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender, BOOL custom)
 {
@@ -551,6 +606,19 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender,
 	U8 offset = buffer[PHL_OFFSET];
 	S32 decode_pos = LL_PACKET_ID_SIZE + (S32)(mCurrentRMessageTemplate->mFrequency) + offset;
 
+	mCurrentRMessageBody = buffer + decode_pos;
+	mCurrentRMessageBodySize = llmax(mReceiveSize - decode_pos, 0);
+
+	// Handlers with a generated decoder read mCurrentRMessageBody
+	// themselves, skip building the generic data set for them.  Their
+	// parse() reports a short body through
+	// LLMessageSystem::logRanOffEndOfPacket().
+	if (!custom && mCurrentRMessageTemplate->getDecodedByHandler())
+	{
+		callHandler(sender);
+		return TRUE;
+	}
+
 	// create base working data set
 	mCurrentRMessageData = new LLMsgData(mCurrentRMessageTemplate->mName);
 	
@@ -712,53 +780,7 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender,
 
 	if (!custom)
 	{
-		static LLTimer decode_timer;
-
-		if(LLMessageReader::getTimeDecodes() || gMessageSystem->getTimingCallback())
-		{
-			decode_timer.reset();
-		}
-
-		{
-			LL_RECORD_BLOCK_TIME(FTM_PROCESS_MESSAGES);
-			if( !mCurrentRMessageTemplate->callHandlerFunc(gMessageSystem) )
-			{
-				LL_WARNS() << "Message from " << sender << " with no handler function received: " << mCurrentRMessageTemplate->mName << LL_ENDL;
-			}
-		}
-
-		if(LLMessageReader::getTimeDecodes() || gMessageSystem->getTimingCallback())
-		{
-			F32 decode_time = decode_timer.getElapsedTimeF32();
-
-			if (gMessageSystem->getTimingCallback())
-			{
-				(gMessageSystem->getTimingCallback())(mCurrentRMessageTemplate->mName,
-								decode_time,
-								gMessageSystem->getTimingCallbackData());
-			}
-
-			if (LLMessageReader::getTimeDecodes())
-			{
-				mCurrentRMessageTemplate->mDecodeTimeThisFrame += decode_time;
-
-				mCurrentRMessageTemplate->mTotalDecoded++;
-				mCurrentRMessageTemplate->mTotalDecodeTime += decode_time;
-
-				if( mCurrentRMessageTemplate->mMaxDecodeTimePerMsg < decode_time )
-				{
-					mCurrentRMessageTemplate->mMaxDecodeTimePerMsg = decode_time;
-				}
-
-
-				if(decode_time > LLMessageReader::getTimeDecodesSpamThreshold())
-				{
-					LL_DEBUGS() << "--------- Message " << mCurrentRMessageTemplate->mName << " decode took " << decode_time << " seconds. (" <<
-						mCurrentRMessageTemplate->mMaxDecodeTimePerMsg << " max, " <<
-						(mCurrentRMessageTemplate->mTotalDecodeTime / mCurrentRMessageTemplate->mTotalDecoded) << " avg)" << LL_ENDL;
-				}
-			}
-		}
+		callHandler(sender);
 	}
 	return TRUE;
 }
@@ -836,13 +858,25 @@ bool LLTemplateMessageReader::isUdpBanned() const
 //virtual 
 void LLTemplateMessageReader::copyToBuilder(LLMessageBuilder& builder) const
 {
-	if(nullptr == mCurrentRMessageTemplate)
+	if(nullptr == mCurrentRMessageTemplate || nullptr == mCurrentRMessageData)
     {
         return;
     }
 	builder.copyFromMessageData(*mCurrentRMessageData);
 }
 
+//virtual
+bool LLTemplateMessageReader::getMessageBody(const U8*& body, S32& size) const
+{
+	if (!mCurrentRMessageBody)
+	{
+		return false;
+	}
+	body = mCurrentRMessageBody;
+	size = mCurrentRMessageBodySize;
+	return true;
+}
+
 LLMessageTemplate* LLTemplateMessageReader::getTemplate()
 {
 	return mCurrentRMessageTemplate;
@@ -96,6 +96,8 @@ public:
 
 	void copyToBuilder(LLMessageBuilder&) const override;
 
+	bool getMessageBody(const U8*& body, S32& size) const override;
+
 	BOOL validateMessage(const U8* buffer, S32 buffer_size, 
 						 const LLHost& sender, bool trusted = false, BOOL custom = FALSE);
 	BOOL readMessage(const U8* buffer, const LLHost& sender);
@@ -105,6 +107,7 @@ public:
 	bool isUdpBanned() const;
 
 	BOOL decodeData(const U8* buffer, const LLHost& sender, BOOL custom = FALSE);
+	void callHandler(const LLHost& sender);
 	LLMessageTemplate* getTemplate();
 
 private:
@@ -120,6 +123,8 @@ private:
 	S32	mReceiveSize;
 	LLMessageTemplate* mCurrentRMessageTemplate;
 	LLMsgData* mCurrentRMessageData;
+	const U8* mCurrentRMessageBody;		// Blocks of the message being decoded
+	S32 mCurrentRMessageBodySize;
 	message_template_number_map_t& mMessageNumbers;
 };
 
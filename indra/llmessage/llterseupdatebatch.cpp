@@ -0,0 +1,162 @@
+/**
+ * @file llterseupdatebatch.cpp
+ * @brief Dequantizes every block of an ImprovedTerseObjectUpdate at once.
+ *
+ * $LicenseInfo:firstyear=2026&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2026, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llterseupdatebatch.h"
+
+#include "llmessagedecoders.h"
+#include "llquantize.h"
+#include "llvector4a.h"
+#include "message.h"
+
+namespace
+{
+	// Data sizes without and with the avatar foot plane
+	const S32 TERSE_SIZE = 4 + 1 + 1 + 12 + LLTerseUpdateBatch::NUM_COMPONENTS * 2;
+	const S32 TERSE_AVATAR_SIZE = TERSE_SIZE + 16;
+
+	struct ComponentRange
+	{
+		F32 mLower;
+		F32 mUpper;
+	};
+
+	// Ranges processUpdateMessage() dequantizes each component with
+	const ComponentRange COMPONENT_RANGES[LLTerseUpdateBatch::NUM_COMPONENTS] =
+	{
+		{ -128.f, 128.f }, { -128.f, 128.f }, { -128.f, 128.f },	// velocity
+		{ -64.f, 64.f }, { -64.f, 64.f }, { -64.f, 64.f },			// acceleration
+		{ -1.f, 1.f }, { -1.f, 1.f }, { -1.f, 1.f }, { -1.f, 1.f },	// rotation
+		{ -64.f, 64.f }, { -64.f, 64.f }, { -64.f, 64.f }			// angular velocity
+	};
+}
+
+LLTerseUpdateBatch::LLTerseUpdateBatch()
+:	mCount(0)
+{
+}
+
+void LLTerseUpdateBatch::decode(const LLDecodedImprovedTerseObjectUpdate& msg)
+{
+	mCount = llmin(msg.mNumObjectData, (S32)MAX_BLOCKS);
+
+	// Scatter each block into the rows
+	for (S32 i = 0; i < mCount; ++i)
+	{
+		const LLDecodedImprovedTerseObjectUpdate::ObjectDataBlock& block = msg.mObjectData[i];
+		mDecoded[i] = unpackBlock(i, block.mData, block.mDataSize);
+		if (!mDecoded[i])
+		{
+			for (S32 c = 0; c < NUM_COMPONENTS; ++c)
+			{
+				mQuantized[c][i] = 0;
+			}
+		}
+	}
+
+	// Then convert a row at a time
+	for (S32 c = 0; c < NUM_COMPONENTS; ++c)
+	{
+		dequantize(mQuantized[c], mValues[c], mCount,
+				   COMPONENT_RANGES[c].mLower, COMPONENT_RANGES[c].mUpper);
+	}
+}
+
+bool LLTerseUpdateBatch::unpackBlock(S32 i, const U8* data, S32 size)
+{
+	if (!data || (size != TERSE_SIZE && size != TERSE_AVATAR_SIZE))
+	{
+		return false;
+	}
+
+	htonmemcpy(&mLocalID[i], data, MVT_U32, 4);
+	data += 4;
+	mState[i] = *data++;
+	// The avatar flag and the size have to agree
+	mHasFootPlane[i] = (*data++ != 0);
+	if (mHasFootPlane[i] != (size == TERSE_AVATAR_SIZE))
+	{
+		return false;
+	}
+	if (mHasFootPlane[i])
+	{
+		htonmemcpy(mFootPlane[i].mV, data, MVT_LLVector4, 16);
+		data += 16;
+	}
+	htonmemcpy(mPosition[i].mV, data, MVT_LLVector3, 12);
+	data += 12;
+	for (S32 c = 0; c < NUM_COMPONENTS; ++c)
+	{
+		htonmemcpy(&mQuantized[c][i], data, MVT_U16, 2);
+		data += 2;
+	}
+	return true;
+}
+
+//static
+void LLTerseUpdateBatch::dequantize(const U16* in, F32* out, S32 count, F32 lower, F32 upper)
+{
+	// The same operations in the same order as U16_to_F32(), so the
+	// results are identical
+	const F32 delta = upper - lower;
+	LLVector4a oo_u16max(OOU16MAX);
+	LLVector4a delta4(delta);
+	LLVector4a lower4(lower);
+	LLVector4a max_error(delta * OOU16MAX);
+	LLVector4a zero;
+	zero.clear();
+
+	S32 i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i quantized = _mm_loadu_si128((const __m128i*)(in + i));
+		__m128i halves[2] =
+		{
+			_mm_unpacklo_epi16(quantized, _mm_setzero_si128()),
+			_mm_unpackhi_epi16(quantized, _mm_setzero_si128())
+		};
+		for (S32 h = 0; h < 2; ++h)
+		{
+			LLVector4a val = _mm_cvtepi32_ps(halves[h]);
+			val.mul(oo_u16max);
+			val.mul(delta4);
+			val.add(lower4);
+
+			// make sure that zero's come through as zero
+			LLVector4a abs_val;
+			abs_val.setAbs(val);
+			val.setSelectWithMask(abs_val.lessThan(max_error), zero, val);
+
+			_mm_storeu_ps(out + i + 4 * h, val);
+		}
+	}
+
+	for (; i < count; ++i)
+	{
+		out[i] = U16_to_F32(in[i], lower, upper);
+	}
+}
@@ -0,0 +1,126 @@
+/**
+ * @file llterseupdatebatch.h
+ * @brief Dequantizes every block of an ImprovedTerseObjectUpdate at once.
+ *
+ * $LicenseInfo:firstyear=2026&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2026, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLTERSEUPDATEBATCH_H
+#define LL_LLTERSEUPDATEBATCH_H
+
+#include "llmath.h"
+#include "llquaternion.h"
+#include "v3math.h"
+#include "v4math.h"
+
+struct LLDecodedImprovedTerseObjectUpdate;
+
+// The ObjectData blocks of one ImprovedTerseObjectUpdate, unpacked into
+// one array per component.  The quantized velocities, rotations and so
+// on of every block are converted together, four at a time, rather than
+// one U16_to_F32() per component per object in processUpdateMessage().
+//
+// Each block's Data is laid out as LLViewerObject::processUpdateMessage()
+// unpacks it for OUT_TERSE_IMPROVED:
+//	LocalID U32, State U8, IsAvatar U8, [FootPlane LLVector4],
+//	Position LLVector3, Velocity U16*3, Acceleration U16*3,
+//	Rotation U16*4, AngularVelocity U16*3
+// Blocks of any other size are left for that code to handle.
+class LLTerseUpdateBatch
+{
+public:
+	enum
+	{
+		MAX_BLOCKS = 255,
+		// Rows are padded to a whole number of vectors
+		ROW_SIZE = 256
+	};
+
+	// The U16 quantized components, one row each
+	enum EComponent
+	{
+		VEL_X, VEL_Y, VEL_Z,
+		ACC_X, ACC_Y, ACC_Z,
+		ROT_X, ROT_Y, ROT_Z, ROT_W,
+		ANGV_X, ANGV_Y, ANGV_Z,
+		NUM_COMPONENTS
+	};
+
+	LLTerseUpdateBatch();
+
+	// Unpacks and dequantizes every ObjectData block of 'msg'.
+	void decode(const LLDecodedImprovedTerseObjectUpdate& msg);
+
+	S32 getCount() const						{ return mCount; }
+
+	// False if block i wasn't in the expected layout
+	bool isDecoded(S32 i) const					{ return i < mCount && mDecoded[i]; }
+
+	U32 getLocalID(S32 i) const					{ return mLocalID[i]; }
+	U8 getState(S32 i) const					{ return mState[i]; }
+	bool hasFootPlane(S32 i) const				{ return mHasFootPlane[i]; }
+	const LLVector4& getFootPlane(S32 i) const	{ return mFootPlane[i]; }
+	const LLVector3& getPosition(S32 i) const	{ return mPosition[i]; }
+
+	LLVector3 getVelocity(S32 i) const
+	{
+		return LLVector3(mValues[VEL_X][i], mValues[VEL_Y][i], mValues[VEL_Z][i]);
+	}
+
+	LLVector3 getAcceleration(S32 i) const
+	{
+		return LLVector3(mValues[ACC_X][i], mValues[ACC_Y][i], mValues[ACC_Z][i]);
+	}
+
+	// Not normalized, as processUpdateMessage() leaves it
+	void getRotation(S32 i, LLQuaternion& rot) const
+	{
+		rot.mQ[VX] = mValues[ROT_X][i];
+		rot.mQ[VY] = mValues[ROT_Y][i];
+		rot.mQ[VZ] = mValues[ROT_Z][i];
+		rot.mQ[VW] = mValues[ROT_W][i];
+	}
+
+	LLVector3 getAngularVelocity(S32 i) const
+	{
+		return LLVector3(mValues[ANGV_X][i], mValues[ANGV_Y][i], mValues[ANGV_Z][i]);
+	}
+
+	// Same results as U16_to_F32() on each of 'count' values.
+	static void dequantize(const U16* in, F32* out, S32 count, F32 lower, F32 upper);
+
+private:
+	bool unpackBlock(S32 i, const U8* data, S32 size);
+
+	S32 mCount;
+	bool mDecoded[MAX_BLOCKS];
+	U32 mLocalID[MAX_BLOCKS];
+	U8 mState[MAX_BLOCKS];
+	bool mHasFootPlane[MAX_BLOCKS];
+	LLVector4 mFootPlane[MAX_BLOCKS];
+	LLVector3 mPosition[MAX_BLOCKS];
+
+	U16 mQuantized[NUM_COMPONENTS][ROW_SIZE];
+	F32 mValues[NUM_COMPONENTS][ROW_SIZE];
+};
+
+#endif // LL_LLTERSEUPDATEBATCH_H
@@ -60,6 +60,8 @@
 #include "lltrustedmessageservice.h"
 #include "llmessagetemplate.h"
 #include "llmessagetemplateparser.h"
+#include "llpacketcapture.h"
+#include "llpacketreceiver.h"
 #include "llsd.h"
 #include "llsdmessagebuilder.h"
 #include "llsdmessagereader.h"
@@ -189,6 +191,8 @@ void LLMessageSystem::init()
 	mTimingCallback = nullptr;
 	mTimingCallbackData = nullptr;
 
+	mPacketCapture = nullptr;
+
 	mMessageBuilder = nullptr;
 	mMessageReader = nullptr;
 }
@@ -323,8 +327,13 @@ LLMessageSystem::~LLMessageSystem()
 	for_each(mMessageNumbers.begin(), mMessageNumbers.end(), DeletePairedPointer());
 	mMessageNumbers.clear();
 	
+	// The receive thread reads the socket, stop it first
+	mPacketRing.stopReceiveThread();
+	stopPacketCapture();
+
 	if (!mbError)
 	{
+		flushSends();
 		end_net(mSocket);
 	}
 	mSocket = 0;
@@ -363,6 +372,11 @@ void LLMessageSystem::clearReceiveState()
 
 BOOL LLMessageSystem::poll(F32 seconds)
 {
+	if (mPacketRing.getReceiveBacklog())
+	{
+		return TRUE;
+	}
+
 	S32 num_socks;
 	apr_status_t status;
 	status = apr_poll(&(mPollInfop->mPollFD), 1, &num_socks,(U64)(seconds*1000000.f));
@@ -510,11 +524,25 @@ BOOL LLMessageSystem::checkMessages( S64 frame_count, bool faked_message, U8 fak
 		S32 true_rcv_size = 0;
 
 		U8* buffer = mTrueReceiveBuffer;
+		LLReceivedPacket* packetp = nullptr;
 
 		if(!faked_message)
 		{
-		
-			mTrueReceiveSize = mPacketRing.receivePacket(mSocket, (char *)mTrueReceiveBuffer);
+			if (mPacketRing.hasReceiveThread() && !mPacketRing.isReplaying())
+			{
+				// Read off the socket, acks split off and expanded on the
+				// network thread already
+				packetp = mPacketRing.receiveProcessedPacket();
+				if (packetp)
+				{
+					buffer = packetp->mData;
+				}
+				mTrueReceiveSize = packetp ? packetp->mSize : 0;
+			}
+			else
+			{
+				mTrueReceiveSize = mPacketRing.receivePacket(mSocket, (char *)mTrueReceiveBuffer);
+			}
 		
 			receive_size = mTrueReceiveSize;
 			mLastSender = mPacketRing.getLastSender();
@@ -554,8 +582,43 @@ BOOL LLMessageSystem::checkMessages( S64 frame_count, bool faked_message, U8 fak
 			LLHost host;
 			LLCircuitData* cdp;
 			
+			if (packetp)
+			{
+				if (buffer[0] & LL_ACK_FLAG)
+				{
+					acks = packetp->mNumAcks;
+					true_rcv_size = receive_size - 1;
+				}
+				if (packetp->mMalformed)
+				{
+					LL_WARNS("Messaging") << "Malformed packet received. Packet size "
+						<< true_rcv_size << " with invalid no. of acks " << acks
+						<< LL_ENDL;
+					valid_packet = FALSE;
+					continue;
+				}
+
+				mIncomingCompressedSize = packetp->mCompressedSize;
+				if (mIncomingCompressedSize)
+				{
+					mTotalBytesIn += mIncomingCompressedSize;
+					mCompressedPacketsIn++;
+					mCompressedBytesIn += mIncomingCompressedSize;
+					mUncompressedBytesIn += packetp->mBodySize;
+				}
+				else
+				{
+					mTotalBytesIn += packetp->mBodySize;
+				}
+				if (packetp->mOverflowed)
+				{
+					callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
+				}
+				buffer = packetp->mBody;
+				receive_size = packetp->mBodySize;
+			}
 			// note if packet acks are appended.
-			if((buffer[0] & LL_ACK_FLAG) && !faked_message)
+			else if((buffer[0] & LL_ACK_FLAG) && !faked_message)
 			{
 				acks += buffer[--receive_size];
 				true_rcv_size = receive_size;
@@ -576,7 +639,10 @@ BOOL LLMessageSystem::checkMessages( S64 frame_count, bool faked_message, U8 fak
 			}
 
 			// process the message as normal
-			mIncomingCompressedSize = zeroCodeExpand(&buffer, &receive_size);
+			if (!packetp)
+			{
+				mIncomingCompressedSize = zeroCodeExpand(&buffer, &receive_size);
+			}
 			U32 cur_rec_pkt_id = 0U;
 			memcpy(&cur_rec_pkt_id, buffer + PHL_PACKET_ID, sizeof(cur_rec_pkt_id));
 			mCurrentRecvPacketID = ntohl(cur_rec_pkt_id);
@@ -595,10 +661,17 @@ BOOL LLMessageSystem::checkMessages( S64 frame_count, bool faked_message, U8 fak
 				U32 mem_id=0;
 				for(S32 i = 0; i < acks; ++i)
 				{
-					true_rcv_size -= sizeof(TPACKETID);
-					memcpy(&mem_id, &buffer[true_rcv_size], /* Flawfinder: ignore*/
-					     sizeof(TPACKETID));
-					packet_id = ntohl(mem_id);
+					if (packetp)
+					{
+						packet_id = packetp->mAcks[i];
+					}
+					else
+					{
+						true_rcv_size -= sizeof(TPACKETID);
+						memcpy(&mem_id, &buffer[true_rcv_size], /* Flawfinder: ignore*/
+							 sizeof(TPACKETID));
+						packet_id = ntohl(mem_id);
+					}
 					//LL_INFOS("Messaging") << "got ack: " << packet_id << LL_ENDL;
 					cdp->ackReliablePacket(packet_id);
 				}
@@ -794,6 +867,9 @@ void LLMessageSystem::processAcks(F32 collect_time)
 		//resend any necessary packets
 		mCircuitInfo.resendUnackedPackets(mUnackedListDepth, mUnackedListSize);
 
+		// Acks that fit on packets already going out don't need a PacketAck
+		appendQueuedAcks();
+
 		//cycle through ack list for each host we need to send acks to
 		mCircuitInfo.sendAcks(collect_time);
 
@@ -807,6 +883,8 @@ void LLMessageSystem::processAcks(F32 collect_time)
 			mDenyTrustedCircuitSet.clear();
 		}
 
+		flushSends();
+
 		if (mMaxMessageCounts >= 0)
 		{
 			if (mNumMessageCounts >= mMaxMessageCounts)
@@ -839,6 +917,65 @@ void LLMessageSystem::processAcks(F32 collect_time)
 	}
 }
 
+void LLMessageSystem::appendQueuedAcks()
+{
+	if (!mPacketRing.getNumQueuedSends())
+	{
+		return;
+	}
+
+	for (LLCircuit::circuit_data_map::iterator it = mCircuitInfo.mSendAckMap.begin();
+		 it != mCircuitInfo.mSendAckMap.end(); ++it)
+	{
+		LLCircuitData* cdp = it->second;
+		if (!cdp->mAcks.empty()
+			&& mPacketRing.appendQueuedAcks(cdp->mHost, cdp->mAcks)
+			&& cdp->mAcks.empty())
+		{
+			// sendAcks() drops the circuit from mSendAckMap
+			cdp->mAckCreationTime = 0.f;
+		}
+	}
+}
+
+void LLMessageSystem::setBatchSends(bool batch_sends)
+{
+	if (!batch_sends)
+	{
+		// Last chance for waiting acks to ride on held packets
+		appendQueuedAcks();
+	}
+	mSendPacketFailureCount += mPacketRing.setBatchSends(mSocket, batch_sends);
+}
+
+void LLMessageSystem::flushSends()
+{
+	appendQueuedAcks();
+	mSendPacketFailureCount += mPacketRing.flushSends(mSocket);
+}
+
+bool LLMessageSystem::startPacketCapture(const std::string& filename)
+{
+	stopPacketCapture();
+
+	LLPacketCaptureWriter* capture = new LLPacketCaptureWriter();
+	if (!capture->open(filename, mMessageFileVersionNumber))
+	{
+		delete capture;
+		return false;
+	}
+	mPacketCapture = capture;
+	mPacketRing.setCaptureWriter(mPacketCapture);
+	return true;
+}
+
+void LLMessageSystem::stopPacketCapture()
+{
+	mPacketRing.setCaptureWriter(nullptr);
+	delete mPacketCapture;
+	mPacketCapture = nullptr;
+}
+
 void LLMessageSystem::copyMessageReceivedToSend()
 {
 	// NOTE: babbage: switch builder to match reader to avoid
@@ -1292,7 +1429,8 @@ S32 LLMessageSystem::sendMessage(const LLHost &host)
 	}
 
 	BOOL success;
-	success = mPacketRing.sendPacket(mSocket, (char *)buf_ptr, buffer_length, host);
+	success = mPacketRing.sendPacket(mSocket, (char *)buf_ptr, buffer_length, host,
+									 mMessageBuilder->getMessageName() != _PREHASH_PacketAck);
 
 	if (!success)
 	{
@@ -2054,6 +2192,10 @@ void LLMessageSystem::dispatch(
 	const std::string& msg_name,
 	const LLSD& message)
 {
+	if (gMessageSystem && gMessageSystem->mPacketCapture)
+	{
+		gMessageSystem->mPacketCapture->writeEvent(msg_name, message);
+	}
 	LLPointer<LLSimpleResponse>	responsep =	LLSimpleResponse::create();
 	dispatch(msg_name, message, responsep);
 }
@@ -2901,10 +3043,27 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 	
 	*data[0] &= (~LL_ZERO_CODE_FLAG);
 
-	S32 count = (*data_size);  
+	bool overflowed = false;
+	*data_size = zeroCodeExpand(*data, in_size, mEncodedRecvBuffer, overflowed);
+	if (overflowed)
+	{
+		callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
+	}
+	*data = mEncodedRecvBuffer;
+	mUncompressedBytesIn += *data_size;
+
+	return(in_size);
+}
+
+// static
+S32 LLMessageSystem::zeroCodeExpand(const U8* in, S32 in_size, U8* out, bool& overflowed)
+{
+	S32 count = in_size;  
 	
-	U8 *inptr = (U8 *)*data;
-	U8 *outptr = (U8 *)mEncodedRecvBuffer;
+	const U8 *inptr = in;
+	U8 *outptr = out;
+
+	overflowed = false;
 
 // skip the packet id field
 
@@ -2913,6 +3072,7 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 		count--;
 		*outptr++ = *inptr++;
 	}
+	out[0] &= (~LL_ZERO_CODE_FLAG);
 
 // reconstruct encoded packet, keeping track of net size gain
 
@@ -2921,11 +3081,11 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 
 	while (count--)
 	{
-		if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-1]))
+		if (outptr > (&out[MAX_BUFFER_SIZE-1]))
 		{
 			LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 1" << LL_ENDL;
-			callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-			outptr = mEncodedRecvBuffer;					
+			overflowed = true;
+			outptr = out;					
 			break;
 		}
 		if (!((*outptr++ = *inptr++)))
@@ -2933,11 +3093,11 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 			while (((count--)) && (!(*inptr)))
 			{
 				*outptr++ = *inptr++;
-  				if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-256]))
+  				if (outptr > (&out[MAX_BUFFER_SIZE-256]))
   				{
   					LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 2" << LL_ENDL;
-					callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-					outptr = mEncodedRecvBuffer;
+					overflowed = true;
+					outptr = out;
 					count = -1;
 					break;
   				}
@@ -2952,11 +3112,11 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 
 			else
 			{
-  				if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-(*inptr)]))
+  				if (outptr > (&out[MAX_BUFFER_SIZE-(*inptr)]))
 				{
   					LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 3" << LL_ENDL;
-					callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-					outptr = mEncodedRecvBuffer;					
+					overflowed = true;
+					outptr = out;					
 				}
 				memset(outptr,0,(*inptr) - 1);
 				outptr += ((*inptr) - 1);
@@ -2965,11 +3125,7 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 		}		
 	}
 	
-	*data = mEncodedRecvBuffer;
-	*data_size = (S32)(outptr - mEncodedRecvBuffer);
-	mUncompressedBytesIn += *data_size;
-
-	return(in_size);
+	return (S32)(outptr - out);
 }
 
 
@@ -2998,6 +3154,36 @@ void LLMessageSystem::setHandlerFuncFast(const char *name, void (*handler_func)(
 	}
 }
 
+void LLMessageSystem::setDecodedByHandlerFast(const char *name, bool decoded)
+{
+	LLMessageTemplate* msgtemplate = get_ptr_in_map(mMessageTemplates, name);
+	if (msgtemplate)
+	{
+		msgtemplate->setDecodedByHandler(decoded);
+	}
+	else
+	{
+		LL_ERRS("Messaging") << name << " is not a known message name!" << LL_ENDL;
+	}
+}
+
+bool LLMessageSystem::getMessageBody(const U8*& body, S32& size) const
+{
+	return mMessageReader && mMessageReader->getMessageBody(body, size);
+}
+
+void LLMessageSystem::logRanOffEndOfPacket(const LLHost& sender)
+{
+	LL_WARNS("Messaging") << "Ran off end of packet " << nullToEmpty(getMessageName())
+						  << " from " << sender << LL_ENDL;
+	if (mVerboseLog)
+	{
+		LL_INFOS("Messaging") << "MSG: -> " << sender << "\tREAD PAST END:\t"
+							  << nullToEmpty(getMessageName()) << LL_ENDL;
+	}
+	callExceptionFunc(MX_RAN_OFF_END_OF_PACKET);
+}
+
 void LLMessageSystem::addHandlerFuncFast(const char *name, std::function<void (LLMessageSystem *msgsystem)> handler_slot)
 {
 	LLMessageTemplate* msgtemplate = get_ptr_in_map(mMessageTemplates, name);
@@ -184,6 +184,7 @@ class LLSDMessageBuilder;
 class LLMessageReader;
 class LLTemplateMessageReader;
 class LLSDMessageReader;
+class LLPacketCaptureWriter;
 
 
 
@@ -304,6 +305,17 @@ public:
 		addHandlerFuncFast(LLMessageStringTable::getInstance()->getString(name), handler_slot);
 	}
 
+	// The handlers for this message parse it with its generated
+	// LLDecoded<name> from getMessageBody() instead of get*()
+	void setDecodedByHandlerFast(const char *name, bool decoded = true);
+
+	// Points at the body of the template message being handled, after
+	// the header and message number.  Returns false for LLSD messages.
+	bool getMessageBody(const U8*& body, S32& size) const;
+	// For handlers that found the body too short: warns and raises
+	// MX_RAN_OFF_END_OF_PACKET, as the template reader does for get*()
+	void logRanOffEndOfPacket(const LLHost& sender);
+
 	// Set a callback function for a message system exception.
 	void setExceptionFunc(EMessageException exception, msg_exception_callback func, void* data = nullptr);
 	// Call the specified exception func, and return TRUE if a
@@ -332,9 +344,27 @@ public:
 	bool addCircuitCode(U32 code, const LLUUID& session_id);
 
 	BOOL	poll(F32 seconds); // Number of seconds that we want to block waiting for data, returns if data was received
+
+	// Reads the socket on a network thread from now on, leaving
+	// checkMessages() to take packets that are already in memory.
+	void	startReceiveThread()	{ mPacketRing.startReceiveThread(mSocket); }
+	// Holds outgoing packets until flushSends().  Turning it off sends
+	// what is held.
+	void	setBatchSends(bool batch_sends);
 	BOOL	checkMessages( S64 frame_count = 0, bool faked_message = false, U8 fake_buffer[MAX_BUFFER_SIZE] = nullptr, LLHost fake_host = LLHost(), S32 fake_size = 0 );
 	void	processAcks(F32 collect_time = 0.f);
 
+	// Sends packets held while batching sends, with any acks waiting for
+	// their circuits appended.  processAcks() does this once per frame.
+	void	flushSends();
+
+	// Writes every packet checkMessages() takes, and every message
+	// dispatch() is handed from the event queue, to 'filename' for
+	// LLMessageReplay.  Replaces any capture already running.
+	bool	startPacketCapture(const std::string& filename);
+	void	stopPacketCapture();
+	bool	isCapturingPackets() const	{ return mPacketCapture != nullptr; }
+
 	BOOL	isMessageFast(const char *msg);
 	BOOL	isMessage(const char *msg)
 	{
@@ -455,6 +485,12 @@ public:
 
 	S32     zeroCode(U8 **data, S32 *data_size);
 	S32		zeroCodeExpand(U8 **data, S32 *data_size);
+
+	// Thread safe.  Expands the zero-coded packet 'in' into 'out', which
+	// must hold MAX_BUFFER_SIZE bytes, clearing the zero-code flag in the
+	// copy.  Sets 'overflowed' if the encoding wanted more room than that.
+	// Returns the expanded size.
+	static S32 zeroCodeExpand(const U8* in, S32 in_size, U8* out, bool& overflowed);
 	S32		zeroCodeAdjustCurrentSendTotal();
 
 	// Uses ping-based retry
@@ -763,7 +799,9 @@ private:
 	void		logMsgFromInvalidCircuit( const LLHost& sender, BOOL recv_reliable );
 	void		logTrustedMsgFromUntrustedCircuit( const LLHost& sender );
 	void		logValidMsg(LLCircuitData *cdp, const LLHost& sender, BOOL recv_reliable, BOOL recv_resent, BOOL recv_acks );
-	void		logRanOffEndOfPacket( const LLHost& sender );
+
+	// Moves waiting acks onto batched packets for the same circuits
+	void		appendQueuedAcks();
 
 	struct LLMessageCountInfo
 	{
@@ -808,6 +846,8 @@ private:
 	msg_timing_callback mTimingCallback;
 	void* mTimingCallbackData;
 
+	LLPacketCaptureWriter* mPacketCapture;
+
 	void init(); // ctor shared initialisation.
 
 	LLHost mLastSender;
@@ -38,6 +38,7 @@
 #else
 	#include <sys/types.h>
 	#include <sys/socket.h>
+	#include <sys/select.h>
 	#include <netinet/in.h>
 	#include <arpa/inet.h>
 	#include <fcntl.h>
@@ -108,6 +109,19 @@ U32 get_receiving_interface_ip(void)
 	return gsnReceivingIFAddr;
 }
 
+bool wait_for_packet(int hSocket, S32 timeout_ms)
+{
+	fd_set read_fds;
+	FD_ZERO(&read_fds);
+	FD_SET(hSocket, &read_fds);
+
+	struct timeval timeout;
+	timeout.tv_sec = timeout_ms / 1000;
+	timeout.tv_usec = (timeout_ms % 1000) * 1000;
+
+	return select(hSocket + 1, &read_fds, NULL, NULL, &timeout) > 0;
+}
+
 const char* u32_to_ip_string(U32 ip)
 {
 	static char buffer[MAXADDRSTR];	 /* Flawfinder: ignore */ 
@@ -338,6 +352,40 @@ S32 receive_packet(int hSocket, char * receiveBuffer)
 	return nRet;
 }
 
+S32 receive_packets(int hSocket, char * buffers[], S32 buffer_size, S32 sizes[],
+					LLHost senders[], U32 receiving_ips[], S32 count)
+{
+	S32 received = 0;
+	while (received < count)
+	{
+		SOCKADDR_IN src_addr;
+		int addr_size = sizeof(src_addr);
+		int nRet = recvfrom(hSocket, buffers[received], buffer_size, 0, (struct sockaddr*)&src_addr, &addr_size);
+		if (nRet == SOCKET_ERROR)
+		{
+			int last_error = WSAGetLastError();
+			if (WSAECONNRESET == last_error)
+			{
+				// ICMP port unreachable for an earlier send, nothing to read
+				continue;
+			}
+			if (WSAEWOULDBLOCK != last_error)
+			{
+				LL_INFOS() << "receive_packets() failed, Error: " << last_error << LL_ENDL;
+			}
+			break;
+		}
+		if (nRet > 0)
+		{
+			sizes[received] = nRet;
+			senders[received] = LLHost(src_addr.sin_addr.s_addr, ntohs(src_addr.sin_port));
+			receiving_ips[received] = INVALID_HOST_IP_ADDRESS;
+			++received;
+		}
+	}
+	return received;
+}
+
 // Returns TRUE on success.
 BOOL send_packet(int hSocket, const char *sendBuffer, int size, U32 recipient, int nPort)
 {
@@ -376,6 +424,21 @@ BOOL send_packet(int hSocket, const char *sendBuffer, int size, U32 recipient, i
 	return (nRet != SOCKET_ERROR);
 }
 
+S32 send_packets(int hSocket, const char * buffers[], const S32 sizes[],
+				 const LLHost recipients[], S32 count, U32& calls)
+{
+	S32 sent = 0;
+	for (S32 i = 0; i < count; ++i)
+	{
+		if (send_packet(hSocket, buffers[i], sizes[i], recipients[i].getAddress(), recipients[i].getPort()))
+		{
+			++sent;
+		}
+		++calls;
+	}
+	return sent;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////
 // Linux Versions
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -599,6 +662,78 @@ int receive_packet(int hSocket, char * receiveBuffer)
 	return nRet;
 }
 
+#if LL_LINUX
+S32 receive_packets(int hSocket, char * buffers[], S32 buffer_size, S32 sizes[],
+					LLHost senders[], U32 receiving_ips[], S32 count)
+{
+	// One recvmmsg() call takes the whole batch
+	const S32 MAX_BATCH = 64;
+	count = llmin(count, MAX_BATCH);
+
+	struct mmsghdr msgs[MAX_BATCH];
+	struct iovec iovs[MAX_BATCH];
+	struct sockaddr_in src_addrs[MAX_BATCH];
+	char cmsgs[MAX_BATCH][CMSG_SPACE(sizeof(struct in_pktinfo))];
+
+	memset(msgs, 0, sizeof(msgs[0]) * count);
+	for (S32 i = 0; i < count; ++i)
+	{
+		iovs[i].iov_base = buffers[i];
+		iovs[i].iov_len = buffer_size;
+		msgs[i].msg_hdr.msg_name = &src_addrs[i];
+		msgs[i].msg_hdr.msg_namelen = sizeof(src_addrs[i]);
+		msgs[i].msg_hdr.msg_iov = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		msgs[i].msg_hdr.msg_control = cmsgs[i];
+		msgs[i].msg_hdr.msg_controllen = sizeof(cmsgs[i]);
+	}
+
+	int received = recvmmsg(hSocket, msgs, count, MSG_DONTWAIT, NULL);
+	if (received <= 0)
+	{
+		return 0;
+	}
+
+	for (S32 i = 0; i < received; ++i)
+	{
+		sizes[i] = msgs[i].msg_len;
+		senders[i] = LLHost(src_addrs[i].sin_addr.s_addr, ntohs(src_addrs[i].sin_port));
+		receiving_ips[i] = INVALID_HOST_IP_ADDRESS;
+		for (struct cmsghdr* cmsgptr = CMSG_FIRSTHDR(&msgs[i].msg_hdr); cmsgptr != NULL; cmsgptr = CMSG_NXTHDR(&msgs[i].msg_hdr, cmsgptr))
+		{
+			if (cmsgptr->cmsg_level == SOL_IP && cmsgptr->cmsg_type == IP_PKTINFO)
+			{
+				// Specified rather than routed address, as in recvfrom_destip()
+				in_pktinfo* pktinfo = (in_pktinfo*)CMSG_DATA(cmsgptr);
+				receiving_ips[i] = pktinfo->ipi_spec_dst.s_addr;
+			}
+		}
+	}
+	return received;
+}
+#else
+S32 receive_packets(int hSocket, char * buffers[], S32 buffer_size, S32 sizes[],
+					LLHost senders[], U32 receiving_ips[], S32 count)
+{
+	S32 received = 0;
+	while (received < count)
+	{
+		struct sockaddr_in src_addr;
+		socklen_t addr_size = sizeof(src_addr);
+		int nRet = recvfrom(hSocket, buffers[received], buffer_size, MSG_DONTWAIT, (struct sockaddr*)&src_addr, &addr_size);
+		if (nRet <= 0)
+		{
+			break;
+		}
+		sizes[received] = nRet;
+		senders[received] = LLHost(src_addr.sin_addr.s_addr, ntohs(src_addr.sin_port));
+		receiving_ips[received] = INVALID_HOST_IP_ADDRESS;
+		++received;
+	}
+	return received;
+}
+#endif
+
 BOOL send_packet(int hSocket, const char * sendBuffer, int size, U32 recipient, int nPort)
 {
 	int		ret;
@@ -659,6 +794,76 @@ BOOL send_packet(int hSocket, const char * sendBuffer, int size, U32 recipient,
 	return success;
 }
 
+#if LL_LINUX
+S32 send_packets(int hSocket, const char * buffers[], const S32 sizes[],
+				 const LLHost recipients[], S32 count, U32& calls)
+{
+	const S32 MAX_BATCH = 64;
+
+	struct mmsghdr msgs[MAX_BATCH];
+	struct iovec iovs[MAX_BATCH];
+	struct sockaddr_in dst_addrs[MAX_BATCH];
+
+	S32 sent = 0;
+	S32 next = 0;
+	while (next < count)
+	{
+		const S32 batch = llmin(count - next, MAX_BATCH);
+		memset(msgs, 0, sizeof(msgs[0]) * batch);
+		memset(dst_addrs, 0, sizeof(dst_addrs[0]) * batch);
+		for (S32 i = 0; i < batch; ++i)
+		{
+			const LLHost& recipient = recipients[next + i];
+			dst_addrs[i].sin_family = AF_INET;
+			dst_addrs[i].sin_addr.s_addr = recipient.getAddress();
+			dst_addrs[i].sin_port = htons(recipient.getPort());
+			iovs[i].iov_base = (void*)buffers[next + i];
+			iovs[i].iov_len = sizes[next + i];
+			msgs[i].msg_hdr.msg_name = &dst_addrs[i];
+			msgs[i].msg_hdr.msg_namelen = sizeof(dst_addrs[i]);
+			msgs[i].msg_hdr.msg_iov = &iovs[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		int ret = sendmmsg(hSocket, msgs, batch, 0);
+		++calls;
+		if (ret > 0)
+		{
+			sent += ret;
+			next += ret;
+		}
+		else
+		{
+			// sendmmsg() stops at the first datagram that fails.  Let
+			// send_packet() retry and report that one, then carry on.
+			const LLHost& recipient = recipients[next];
+			if (send_packet(hSocket, buffers[next], sizes[next], recipient.getAddress(), recipient.getPort()))
+			{
+				++sent;
+			}
+			++calls;
+			++next;
+		}
+	}
+	return sent;
+}
+#else
+S32 send_packets(int hSocket, const char * buffers[], const S32 sizes[],
+				 const LLHost recipients[], S32 count, U32& calls)
+{
+	S32 sent = 0;
+	for (S32 i = 0; i < count; ++i)
+	{
+		if (send_packet(hSocket, buffers[i], sizes[i], recipients[i].getAddress(), recipients[i].getPort()))
+		{
+			++sent;
+		}
+		++calls;
+	}
+	return sent;
+}
+#endif
+
 #endif
 
 //EOF
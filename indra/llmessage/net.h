@@ -45,6 +45,26 @@ S32		receive_packet(int hSocket, char * receiveBuffer);
 
 BOOL	send_packet(int hSocket, const char *sendBuffer, int size, U32 recipient, int nPort);	// Returns TRUE on success.
 
+// Sends 'count' datagrams, each to its own recipient, in as few system
+// calls as the platform allows (sendmmsg() on Linux).  Failed datagrams
+// are retried as send_packet() would.  Adds the system calls made to
+// 'calls' and returns the number of datagrams sent.  MAIN THREAD, like
+// send_packet().
+S32		send_packets(int hSocket, const char * buffers[], const S32 sizes[],
+					 const LLHost recipients[], S32 count, U32& calls);
+
+// Batched, reentrant receive for a network thread.  Takes up to 'count'
+// datagrams already waiting on the socket, without blocking, into
+// 'buffers' of 'buffer_size' bytes each.  Sizes, senders and receiving
+// interface addresses are returned per datagram rather than through
+// get_sender() and friends.  Returns the number of datagrams received.
+S32		receive_packets(int hSocket, char * buffers[], S32 buffer_size, S32 sizes[],
+						LLHost senders[], U32 receiving_ips[], S32 count);
+
+// Waits up to timeout_ms for a datagram to arrive.  Returns true if
+// one is waiting.
+bool	wait_for_packet(int hSocket, S32 timeout_ms);
+
 //void	get_sender(char * tmp);
 LLHost	get_sender();
 U32		get_sender_port();
@@ -0,0 +1,124 @@
+/**
+ * @file   llpacketreceiver_test.cpp
+ * @brief  Test for the parsing the UDP receive thread does ahead of checkMessages().
+ *
+ * $LicenseInfo:firstyear=2009&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llpacketreceiver.h"
+#include "message.h"
+
+#include "../test/lltut.h"
+
+namespace
+{
+	// Copies a packet into the slot the way the receive thread would
+	void set_packet(LLReceivedPacket& packet, const U8* data, S32 size)
+	{
+		memcpy(packet.mData, data, size);
+		packet.mSize = size;
+		packet.process();
+	}
+}
+
+namespace tut
+{
+	struct LLPacketReceiverData
+	{
+	};
+
+	typedef test_group<LLPacketReceiverData> factory;
+	typedef factory::object object;
+}
+
+namespace
+{
+	tut::factory llpacketreceiver_test_factory("LLPacketReceiver");
+}
+
+namespace tut
+{
+	template<> template<>
+	void object::test<1>()
+	{
+		set_test_name("appended acks are split off the body");
+
+		const U8 data[] = {
+			LL_ACK_FLAG, 0x00, 0x00, 0x00, 0x01, 0x00,	// header
+			0x01, 0x02, 0x03,							// body
+			0x00, 0x00, 0x00, 0x07,						// first ack
+			0x01, 0x02, 0x03, 0x04,						// second ack
+			0x02 };										// ack count
+
+		LLReceivedPacket packet;
+		set_packet(packet, data, sizeof(data));
+
+		ensure("not malformed", !packet.mMalformed);
+		ensure_equals("body size", packet.mBodySize, 9);
+		ensure("body in place", packet.mBody == packet.mData);
+		ensure_equals("not zero coded", packet.mCompressedSize, 0);
+		ensure_equals("acks", packet.mNumAcks, 2);
+		// Read from the end back, same as checkMessages()
+		ensure_equals("last ack first", packet.mAcks[0], (TPACKETID) 0x01020304);
+		ensure_equals("first ack last", packet.mAcks[1], (TPACKETID) 7);
+	}
+
+	template<> template<>
+	void object::test<2>()
+	{
+		set_test_name("zero coded bodies are expanded");
+
+		const U8 data[] = {
+			LL_ZERO_CODE_FLAG, 0x00, 0x00, 0x00, 0x02, 0x00,
+			0x05, 0x00, 0x03, 0x06 };
+		const U8 expanded[] = {
+			0x00, 0x00, 0x00, 0x00, 0x02, 0x00,
+			0x05, 0x00, 0x00, 0x00, 0x06 };
+
+		LLReceivedPacket packet;
+		set_packet(packet, data, sizeof(data));
+
+		ensure("not overflowed", !packet.mOverflowed);
+		ensure_equals("compressed size", packet.mCompressedSize, (S32) sizeof(data));
+		ensure_equals("body size", packet.mBodySize, (S32) sizeof(expanded));
+		ensure("body expanded", packet.mBody == packet.mExpanded);
+		ensure("expanded bytes", !memcmp(packet.mBody, expanded, sizeof(expanded)));
+	}
+
+	template<> template<>
+	void object::test<3>()
+	{
+		set_test_name("an ack count past the packet is malformed");
+
+		const U8 data[] = {
+			LL_ACK_FLAG, 0x00, 0x00, 0x00, 0x03, 0x00,
+			0x01, 0x05 };
+
+		LLReceivedPacket packet;
+		set_packet(packet, data, sizeof(data));
+
+		ensure("malformed", packet.mMalformed);
+		ensure_equals("claimed acks", packet.mNumAcks, 5);
+	}
+}
@@ -0,0 +1,245 @@
+/**
+ * @file   llpacketring_test.cpp
+ * @brief  Test for batched sends and the acks appended to them.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llpacketring.h"
+#include "../llpacketreceiver.h"
+#include "lltimer.h"
+#include "message.h"
+
+#include "../test/lltut.h"
+
+namespace
+{
+	// Takes up to 'count' datagrams off the socket, giving up after a second
+	S32 receive_all(S32 socket, std::vector<LLReceivedPacket>& packets, S32 count)
+	{
+		S32 received = 0;
+		LLTimer timer;
+		while (received < count && timer.getElapsedTimeF32() < 1.f)
+		{
+			if (!wait_for_packet(socket, 10))
+			{
+				continue;
+			}
+
+			char* buffers[1];
+			S32 sizes[1];
+			LLHost senders[1];
+			U32 receiving_ips[1];
+			LLReceivedPacket& packet = packets[received];
+			buffers[0] = (char*)packet.mData;
+			if (receive_packets(socket, buffers, NET_BUFFER_SIZE, sizes, senders, receiving_ips, 1))
+			{
+				packet.mSize = sizes[0];
+				packet.process();
+				++received;
+			}
+		}
+		return received;
+	}
+
+	// Smallest valid message with the given flags
+	void make_packet(U8* data, S32 size, U8 flags)
+	{
+		memset(data, 0, size);
+		data[0] = flags;
+		data[LL_PACKET_ID_SIZE] = 0x01;
+	}
+}
+
+namespace tut
+{
+	struct LLPacketRingData
+	{
+		LLPacketRingData()
+		:	mSocket(0),
+			mPort(NET_USE_OS_ASSIGNED_PORT)
+		{
+			start_net(mSocket, mPort);
+			mHost = LLHost("127.0.0.1", mPort);
+		}
+
+		~LLPacketRingData()
+		{
+			end_net(mSocket);
+		}
+
+		S32 mSocket;
+		int mPort;
+		LLHost mHost;
+	};
+
+	typedef test_group<LLPacketRingData> factory;
+	typedef factory::object object;
+}
+
+namespace
+{
+	tut::factory llpacketring_test_factory("LLPacketRing");
+}
+
+namespace tut
+{
+	template<> template<>
+	void object::test<1>()
+	{
+		set_test_name("batched sends, system calls per 1k messages over loopback");
+
+		const S32 NUM_MESSAGES = 1000;
+		const S32 MESSAGES_PER_FLUSH = 50;
+
+		U8 data[32];
+		make_packet(data, sizeof(data), 0);
+
+		LLPacketRing ring;
+		ring.setBatchSends(mSocket, true);
+		std::vector<LLReceivedPacket> packets(MESSAGES_PER_FLUSH);
+
+		LLTimer timer;
+		S32 received = 0;
+		for (S32 i = 0; i < NUM_MESSAGES; i += MESSAGES_PER_FLUSH)
+		{
+			for (S32 j = 0; j < MESSAGES_PER_FLUSH; ++j)
+			{
+				ring.queuePacket(mSocket, (char*)data, sizeof(data), mHost, true);
+			}
+			ensure_equals("no failures", ring.flushSends(mSocket), 0);
+
+			// Drained as we go so the socket buffer can't overflow
+			received += receive_all(mSocket, packets, MESSAGES_PER_FLUSH);
+		}
+		F32 elapsed = timer.getElapsedTimeF32();
+		U32 calls = ring.getAndResetSendCalls();
+
+		LL_INFOS() << NUM_MESSAGES << " messages in " << calls << " send calls, "
+				   << elapsed * 1000.f << " ms including receives" << LL_ENDL;
+
+		ensure_equals("all received", received, NUM_MESSAGES);
+#if LL_LINUX
+		ensure_equals("one sendmmsg() per flush", calls, (U32) (NUM_MESSAGES / MESSAGES_PER_FLUSH));
+#else
+		ensure_equals("one sendto() per message", calls, (U32) NUM_MESSAGES);
+#endif
+	}
+
+	template<> template<>
+	void object::test<2>()
+	{
+		set_test_name("waiting acks ride on batched packets to the same host");
+
+		U8 data[16];
+		make_packet(data, sizeof(data), 0);
+
+		LLPacketRing ring;
+		ring.setBatchSends(mSocket, true);
+		// A PacketAck, which carries its own
+		ring.queuePacket(mSocket, (char*)data, sizeof(data), mHost, false);
+		// Another circuit's
+		ring.queuePacket(mSocket, (char*)data, sizeof(data), LLHost("127.0.0.1", mPort + 1), true);
+		ring.queuePacket(mSocket, (char*)data, sizeof(data), mHost, true);
+
+		std::vector<TPACKETID> acks;
+		acks.push_back(7);
+		acks.push_back(0x01020304);
+		ensure_equals("both appended", ring.appendQueuedAcks(mHost, acks), 2);
+		ensure("none left", acks.empty());
+		ring.flushSends(mSocket);
+
+		std::vector<LLReceivedPacket> packets(2);
+		ensure_equals("received", receive_all(mSocket, packets, 2), 2);
+		ensure_equals("none on the PacketAck", packets[0].mNumAcks, 0);
+		ensure_equals("message size", packets[0].mBodySize, (S32) sizeof(data));
+
+		const LLReceivedPacket& packet = packets[1];
+		ensure("not malformed", !packet.mMalformed);
+		ensure_equals("acks", packet.mNumAcks, 2);
+		ensure_equals("body size", packet.mBodySize, (S32) sizeof(data));
+		ensure_equals("last appended first", packet.mAcks[0], (TPACKETID) 0x01020304);
+		ensure_equals("first appended last", packet.mAcks[1], (TPACKETID) 7);
+	}
+
+	template<> template<>
+	void object::test<3>()
+	{
+		set_test_name("acks add to ones already appended, up to the MTU");
+
+		// Room for two more acks, whatever is already on the end
+		const S32 size = MTUBYTES - 2 * sizeof(TPACKETID) - 1;
+		std::vector<U8> data(size);
+		make_packet(&data[0], size, LL_ACK_FLAG);
+		TPACKETID packet_id = htonl(42);
+		memcpy(&data[size - 5], &packet_id, sizeof(packet_id));
+		data[size - 1] = 1;
+
+		LLPacketRing ring;
+		ring.setBatchSends(mSocket, true);
+		ring.queuePacket(mSocket, (char*)&data[0], size, mHost, true);
+
+		std::vector<TPACKETID> acks;
+		for (TPACKETID id = 1; id <= 5; ++id)
+		{
+			acks.push_back(id);
+		}
+		ensure_equals("two fit", ring.appendQueuedAcks(mHost, acks), 2);
+		ensure_equals("three left", acks.size(), (size_t) 3);
+		ensure_equals("oldest left for later", acks[0], (TPACKETID) 3);
+		ring.flushSends(mSocket);
+
+		std::vector<LLReceivedPacket> packets(1);
+		ensure_equals("received", receive_all(mSocket, packets, 1), 1);
+		const LLReceivedPacket& packet = packets[0];
+		ensure("within the MTU", packet.mSize <= MTUBYTES);
+		ensure_equals("acks", packet.mNumAcks, 3);
+		ensure_equals("body size", packet.mBodySize, size - 5);
+		ensure_equals("newest", packet.mAcks[0], (TPACKETID) 2);
+		ensure_equals("next", packet.mAcks[1], (TPACKETID) 1);
+		ensure_equals("original", packet.mAcks[2], (TPACKETID) 42);
+	}
+
+	template<> template<>
+	void object::test<4>()
+	{
+		set_test_name("turning batching off sends the held packets");
+
+		U8 data[16];
+		make_packet(data, sizeof(data), 0);
+
+		LLPacketRing ring;
+		ring.setBatchSends(mSocket, true);
+		ring.queuePacket(mSocket, (char*)data, sizeof(data), mHost, true);
+		ring.queuePacket(mSocket, (char*)data, sizeof(data), mHost, true);
+		ensure_equals("held", ring.getNumQueuedSends(), 2);
+
+		ensure_equals("no failures", ring.setBatchSends(mSocket, false), 0);
+		ensure("off", !ring.getBatchSends());
+		ensure_equals("none held", ring.getNumQueuedSends(), 0);
+
+		std::vector<LLReceivedPacket> packets(2);
+		ensure_equals("received", receive_all(mSocket, packets, 2), 2);
+	}
+}
@@ -0,0 +1,316 @@
+/**
+ * @file llterseupdatebatch_test.cpp
+ * @brief Tests for LLTerseUpdateBatch.
+ *
+ * $LicenseInfo:firstyear=2026&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2026, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#include "linden_common.h"
+
+#include "../llterseupdatebatch.h"
+
+#include "lldatapacker.h"
+#include "llmessagedecoders.h"
+#include "llquantize.h"
+#include "lltimer.h"
+
+#include "../test/lltut.h"
+
+namespace
+{
+	// What LLViewerObject::processUpdateMessage() makes of one terse block
+	struct Expected
+	{
+		U32 mLocalID;
+		U8 mState;
+		bool mHasFootPlane;
+		LLVector4 mFootPlane;
+		LLVector3 mPosition;
+		LLVector3 mVelocity;
+		LLVector3 mAcceleration;
+		LLQuaternion mRotation;
+		LLVector3 mAngularVelocity;
+	};
+
+	void unpack_expected(U8* data, S32 size, Expected& expected)
+	{
+		LLDataPackerBinaryBuffer dp(data, size);
+		U16 val[4];
+		dp.unpackU32(expected.mLocalID, "LocalID");
+		dp.unpackU8(expected.mState, "State");
+		U8 value;
+		dp.unpackU8(value, "agent");
+		expected.mHasFootPlane = (value != 0);
+		if (value)
+		{
+			dp.unpackVector4(expected.mFootPlane, "Plane");
+		}
+		dp.unpackVector3(expected.mPosition, "Pos");
+		dp.unpackU16(val[VX], "VelX");
+		dp.unpackU16(val[VY], "VelY");
+		dp.unpackU16(val[VZ], "VelZ");
+		expected.mVelocity.set(U16_to_F32(val[VX], -128.f, 128.f),
+							   U16_to_F32(val[VY], -128.f, 128.f),
+							   U16_to_F32(val[VZ], -128.f, 128.f));
+		dp.unpackU16(val[VX], "AccX");
+		dp.unpackU16(val[VY], "AccY");
+		dp.unpackU16(val[VZ], "AccZ");
+		expected.mAcceleration.set(U16_to_F32(val[VX], -64.f, 64.f),
+								   U16_to_F32(val[VY], -64.f, 64.f),
+								   U16_to_F32(val[VZ], -64.f, 64.f));
+		dp.unpackU16(val[VX], "ThetaX");
+		dp.unpackU16(val[VY], "ThetaY");
+		dp.unpackU16(val[VZ], "ThetaZ");
+		dp.unpackU16(val[VS], "ThetaS");
+		expected.mRotation.mQ[VX] = U16_to_F32(val[VX], -1.f, 1.f);
+		expected.mRotation.mQ[VY] = U16_to_F32(val[VY], -1.f, 1.f);
+		expected.mRotation.mQ[VZ] = U16_to_F32(val[VZ], -1.f, 1.f);
+		expected.mRotation.mQ[VS] = U16_to_F32(val[VS], -1.f, 1.f);
+		dp.unpackU16(val[VX], "AccX");
+		dp.unpackU16(val[VY], "AccY");
+		dp.unpackU16(val[VZ], "AccZ");
+		expected.mAngularVelocity.set(U16_to_F32(val[VX], -64.f, 64.f),
+									  U16_to_F32(val[VY], -64.f, 64.f),
+									  U16_to_F32(val[VZ], -64.f, 64.f));
+	}
+
+	// Packs a terse block the way the simulator does
+	S32 pack_block(U8* data, U32 local_id, bool avatar, U32& seed)
+	{
+		LLDataPackerBinaryBuffer dp(data, 60);
+		dp.packU32(local_id, "LocalID");
+		dp.packU8(local_id & 0xff, "State");
+		dp.packU8(avatar ? 1 : 0, "agent");
+		if (avatar)
+		{
+			dp.packVector4(LLVector4(0.f, 0.f, 1.f, -21.5f), "Plane");
+		}
+		dp.packVector3(LLVector3(local_id % 256, 128.5f, 22.25f), "Pos");
+		for (S32 i = 0; i < LLTerseUpdateBatch::NUM_COMPONENTS; ++i)
+		{
+			seed = seed * 1103515245 + 12345;
+			U16 value = (U16) (seed >> 16);
+			// Plenty of the exact midpoint, which has to come out as zero
+			if (i % 3 == 0)
+			{
+				value = 32767;
+			}
+			dp.packU16(value, "Component");
+		}
+		return dp.getCurrentSize();
+	}
+
+	// A captured ImprovedTerseObjectUpdate body: RegionData, then a
+	// count and the ObjectData blocks
+	S32 pack_message(U8* body, S32 blocks, U32& seed)
+	{
+		U8* pos = body;
+		U64 handle = 0x0003e80000041000ULL;
+		memcpy(pos, &handle, 8);
+		pos += 8;
+		*pos++ = 0xff;
+		*pos++ = 0xff;
+		*pos++ = (U8) blocks;
+		for (S32 i = 0; i < blocks; ++i)
+		{
+			S32 size = pack_block(pos + 1, 1000 + i, i % 5 == 0, seed);
+			*pos = (U8) size;
+			pos += 1 + size;
+			// Empty TextureEntry
+			*pos++ = 0;
+			*pos++ = 0;
+		}
+		return (S32) (pos - body);
+	}
+
+	void ensure_same(const std::string& msg, F32 actual, F32 expected)
+	{
+		// Bit for bit, so the batch can't move anything
+		tut::ensure(msg, !memcmp(&actual, &expected, sizeof(F32)));
+	}
+}
+
+namespace tut
+{
+	struct terseupdatebatch
+	{
+	};
+
+	typedef test_group<terseupdatebatch> terseupdatebatch_t;
+	typedef terseupdatebatch_t::object terseupdatebatch_object_t;
+	tut::terseupdatebatch_t tut_terseupdatebatch("LLTerseUpdateBatch");
+
+	template<> template<>
+	void terseupdatebatch_object_t::test<1>()
+	{
+		set_test_name("dequantize matches U16_to_F32 for every value");
+
+		const F32 ranges[][2] = { { -128.f, 128.f }, { -64.f, 64.f }, { -1.f, 1.f }, { -0.5f * 32.f, 1.5f * 32.f } };
+		std::vector<U16> in(65536 + 3);
+		for (S32 i = 0; i < (S32) in.size(); ++i)
+		{
+			in[i] = (U16) i;
+		}
+		std::vector<F32> out(in.size());
+
+		for (const F32* range : ranges)
+		{
+			// An odd count, so the scalar tail runs too
+			LLTerseUpdateBatch::dequantize(&in[0], &out[0], (S32) in.size(), range[0], range[1]);
+			for (S32 i = 0; i < (S32) in.size(); ++i)
+			{
+				ensure_same(llformat("value %d in [%g, %g]", in[i], range[0], range[1]),
+							out[i], U16_to_F32(in[i], range[0], range[1]));
+			}
+		}
+	}
+
+	template<> template<>
+	void terseupdatebatch_object_t::test<2>()
+	{
+		set_test_name("decoded blocks match processUpdateMessage's unpacking");
+
+		const S32 BLOCKS = 37;
+		U8 data[BLOCKS][60];
+		LLDecodedImprovedTerseObjectUpdate msg;
+		msg.mNumObjectData = BLOCKS;
+		U32 seed = 4321;
+		for (S32 i = 0; i < BLOCKS; ++i)
+		{
+			msg.mObjectData[i].mData = data[i];
+			msg.mObjectData[i].mDataSize = pack_block(data[i], 100 + i, i % 4 == 0, seed);
+		}
+		// Not a layout the batch knows, left for the old path
+		msg.mObjectData[7].mDataSize = 32;
+		// Avatar flag without the foot plane
+		data[9][5] = 1;
+
+		LLTerseUpdateBatch batch;
+		batch.decode(msg);
+		ensure_equals("count", batch.getCount(), BLOCKS);
+		ensure("odd size", !batch.isDecoded(7));
+		ensure("flag and size disagree", !batch.isDecoded(9));
+		ensure("past the end", !batch.isDecoded(BLOCKS));
+
+		for (S32 i = 0; i < BLOCKS; ++i)
+		{
+			if (i == 7 || i == 9)
+			{
+				continue;
+			}
+			ensure(llformat("block %d decoded", i), batch.isDecoded(i));
+
+			Expected expected;
+			unpack_expected(data[i], msg.mObjectData[i].mDataSize, expected);
+			ensure_equals("local id", batch.getLocalID(i), expected.mLocalID);
+			ensure_equals("state", batch.getState(i), expected.mState);
+			ensure_equals("foot plane", batch.hasFootPlane(i), expected.mHasFootPlane);
+			if (expected.mHasFootPlane)
+			{
+				ensure("plane", batch.getFootPlane(i) == expected.mFootPlane);
+			}
+			ensure("position", batch.getPosition(i) == expected.mPosition);
+
+			LLVector3 velocity = batch.getVelocity(i);
+			LLVector3 acceleration = batch.getAcceleration(i);
+			LLVector3 angular_velocity = batch.getAngularVelocity(i);
+			LLQuaternion rotation;
+			batch.getRotation(i, rotation);
+			for (S32 j = 0; j < 3; ++j)
+			{
+				ensure_same("velocity", velocity.mV[j], expected.mVelocity.mV[j]);
+				ensure_same("acceleration", acceleration.mV[j], expected.mAcceleration.mV[j]);
+				ensure_same("angular velocity", angular_velocity.mV[j], expected.mAngularVelocity.mV[j]);
+			}
+			for (S32 j = 0; j < 4; ++j)
+			{
+				ensure_same("rotation", rotation.mQ[j], expected.mRotation.mQ[j]);
+			}
+		}
+	}
+
+	template<> template<>
+	void terseupdatebatch_object_t::test<3>()
+	{
+		set_test_name("terse update replay timings");
+
+		// Not a pass/fail test.  Replays a log of full terse update
+		// messages through the per object unpacking and through the batch,
+		// for numbers to compare on whatever machine runs the tests.
+		const S32 MESSAGES = 200;
+		const S32 BLOCKS = 20;		// about what fits in a packet
+		const S32 PASSES = 20;
+
+		std::vector<std::vector<U8> > log(MESSAGES);
+		U32 seed = 777;
+		for (std::vector<U8>& body : log)
+		{
+			body.resize(11 + BLOCKS * (1 + 60 + 2));
+			body.resize(pack_message(&body[0], BLOCKS, seed));
+		}
+
+		LLDecodedImprovedTerseObjectUpdate* msg = new LLDecodedImprovedTerseObjectUpdate;
+		LLTerseUpdateBatch* batch = new LLTerseUpdateBatch;
+		F32 ref_sum = 0.f;
+		F32 batch_sum = 0.f;
+
+		LLTimer timer;
+		for (S32 pass = 0; pass < PASSES; ++pass)
+		{
+			for (std::vector<U8>& body : log)
+			{
+				msg->parse(&body[0], (S32) body.size());
+				for (S32 i = 0; i < msg->mNumObjectData; ++i)
+				{
+					U8 data[60];
+					memcpy(data, msg->mObjectData[i].mData, msg->mObjectData[i].mDataSize);
+					Expected expected;
+					unpack_expected(data, msg->mObjectData[i].mDataSize, expected);
+					ref_sum += expected.mVelocity.mV[VX];
+				}
+			}
+		}
+		F64 ref_time = timer.getElapsedTimeF64();
+
+		timer.reset();
+		for (S32 pass = 0; pass < PASSES; ++pass)
+		{
+			for (std::vector<U8>& body : log)
+			{
+				msg->parse(&body[0], (S32) body.size());
+				batch->decode(*msg);
+				for (S32 i = 0; i < batch->getCount(); ++i)
+				{
+					batch_sum += batch->getVelocity(i).mV[VX];
+				}
+			}
+		}
+		F64 batch_time = timer.getElapsedTimeF64();
+
+		ensure_same("same velocities", batch_sum, ref_sum);
+		LL_INFOS() << "Terse updates: per object " << ref_time * 1000.0
+				   << " ms, batched " << batch_time * 1000.0 << " ms for "
+				   << MESSAGES * BLOCKS * PASSES << " updates" << LL_ENDL;
+
+		delete batch;
+		delete msg;
+	}
+}
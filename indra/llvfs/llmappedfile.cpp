@@ -0,0 +1,157 @@
+/**
+ * @file llmappedfile.cpp
+ * @brief Thin cross-platform wrapper around a read/write file mapping
+ *
+ * $LicenseInfo:firstyear=2002&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llmappedfile.h"
+
+#if LL_WINDOWS
+#include "llwin32headerslean.h"
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+LLMappedFile::LLMappedFile()
+:	mData(nullptr),
+	mSize(0)
+#if LL_WINDOWS
+	, mMapping(nullptr)
+#endif
+{
+}
+
+LLMappedFile::~LLMappedFile()
+{
+	unmap();
+}
+
+// static
+bool LLMappedFile::truncate(LLFILE* fp, U32 size)
+{
+	fflush(fp);
+#if LL_WINDOWS
+	return _chsize_s(_fileno(fp), size) == 0;
+#else
+	return ftruncate(fileno(fp), size) == 0;
+#endif
+}
+
+// static
+bool LLMappedFile::sync(LLFILE* fp)
+{
+	if (fflush(fp) != 0)
+	{
+		return false;
+	}
+#if LL_WINDOWS
+	return FlushFileBuffers((HANDLE)_get_osfhandle(_fileno(fp))) != 0;
+#else
+	return fsync(fileno(fp)) == 0;
+#endif
+}
+
+bool LLMappedFile::map(LLFILE* fp, U32 size, bool read_only, const std::string& name_for_log)
+{
+	unmap();
+	if (!fp || !size)
+	{
+		return false;
+	}
+
+	fseek(fp, 0, SEEK_END);
+	U32 file_size = (U32)ftell(fp);
+	if (file_size < size)
+	{
+		if (read_only || !truncate(fp, size))
+		{
+			LL_WARNS() << "Can't map " << size << " bytes of " << name_for_log << ", file is " << file_size << " bytes" << LL_ENDL;
+			return false;
+		}
+	}
+
+#if LL_WINDOWS
+	HANDLE file = (HANDLE)_get_osfhandle(_fileno(fp));
+	HANDLE mapping = CreateFileMapping(file, nullptr, read_only ? PAGE_READONLY : PAGE_READWRITE, 0, size, nullptr);
+	if (!mapping)
+	{
+		LL_WARNS() << "CreateFileMapping failed for " << name_for_log << ": " << GetLastError() << LL_ENDL;
+		return false;
+	}
+	mData = (U8*)MapViewOfFile(mapping, read_only ? FILE_MAP_READ : FILE_MAP_WRITE, 0, 0, size);
+	if (!mData)
+	{
+		LL_WARNS() << "MapViewOfFile failed for " << name_for_log << ": " << GetLastError() << LL_ENDL;
+		CloseHandle(mapping);
+		return false;
+	}
+	mMapping = mapping;
+#else
+	void* addr = ::mmap(nullptr, size, read_only ? PROT_READ : (PROT_READ | PROT_WRITE), MAP_SHARED, fileno(fp), 0);
+	if (addr == MAP_FAILED)
+	{
+		LL_WARNS() << "mmap failed for " << name_for_log << ": " << errno << LL_ENDL;
+		return false;
+	}
+	mData = (U8*)addr;
+#endif
+
+	mSize = size;
+	return true;
+}
+
+void LLMappedFile::unmap()
+{
+	if (!mData)
+	{
+		return;
+	}
+#if LL_WINDOWS
+	UnmapViewOfFile(mData);
+	CloseHandle((HANDLE)mMapping);
+	mMapping = nullptr;
+#else
+	::munmap(mData, mSize);
+#endif
+	mData = nullptr;
+	mSize = 0;
+}
+
+void LLMappedFile::flush(bool wait)
+{
+	if (!mData)
+	{
+		return;
+	}
+#if LL_WINDOWS
+	// FlushViewOfFile only queues the writes; waiting needs the file handle
+	FlushViewOfFile(mData, 0);
+#else
+	::msync(mData, mSize, wait ? MS_SYNC : MS_ASYNC);
+#endif
+}
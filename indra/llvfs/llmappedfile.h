@@ -0,0 +1,66 @@
+/**
+ * @file llmappedfile.h
+ * @brief Thin cross-platform wrapper around a read/write file mapping
+ *
+ * $LicenseInfo:firstyear=2002&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMAPPEDFILE_H
+#define LL_LLMAPPEDFILE_H
+
+#include "llfile.h"
+
+// Maps the start of an already open file into memory.  The caller keeps
+// ownership of the LLFILE and must not close it while the mapping exists.
+class LLMappedFile
+{
+public:
+	LLMappedFile();
+	~LLMappedFile();
+
+	// Maps the first size bytes of fp.  Writable mappings grow the file to
+	// size first; read-only mappings fail if the file is shorter.
+	bool map(LLFILE* fp, U32 size, bool read_only, const std::string& name_for_log);
+	void unmap();
+
+	// Queues dirty pages for write-back.  Never blocks unless wait is set.
+	void flush(bool wait = false);
+
+	bool isMapped() const	{ return mData != nullptr; }
+	U8* getData() const		{ return mData; }
+	U32 getSize() const		{ return mSize; }
+
+	// Sets the length of fp, for callers that need to shrink or wipe a file
+	// before mapping it.
+	static bool truncate(LLFILE* fp, U32 size);
+	// Flushes fp and waits until its contents have reached the disk.
+	static bool sync(LLFILE* fp);
+
+private:
+	U8* mData;
+	U32 mSize;
+#if LL_WINDOWS
+	void* mMapping;
+#endif
+};
+
+#endif // LL_LLMAPPEDFILE_H
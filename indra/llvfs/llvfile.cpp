@@ -311,7 +311,7 @@ BOOL LLVFile::setMaxSize(S32 size)
 		return FALSE;
 	}
 
-	if (!mVFS->checkAvailable(size))
+	if (!mVFS->checkAvailable(mFileID, size))
 	{
 		//LL_RECORD_BLOCK_TIME(FTM_VFILE_WAIT);
 		S32 count = 0;
@@ -29,6 +29,7 @@
 #include "linden_common.h"
 
 #include "llvfs.h"
+#include "llvfsshard.h"
 
 #include <sys/stat.h>
 #if LL_WINDOWS
@@ -229,7 +230,8 @@ const S32 LLVFSFileBlock::SERIAL_SIZE = 34;
 LLVFS::LLVFS(const std::string& index_filename, const std::string& data_filename, const BOOL read_only, const U32 presize, const BOOL remove_after_crash)
 :	mDataFP(nullptr),
 	mIndexFP(nullptr),
-    mRemoveAfterCrash(remove_after_crash)
+    mRemoveAfterCrash(remove_after_crash),
+	mShardStore(nullptr)
 {
 	mDataMutex = new LLMutex();
 
@@ -555,12 +557,36 @@ LLVFS::LLVFS(const std::string& index_filename, const std::string& data_filename
 	mValid = VFSVALID_OK;
 }
     
+LLVFS::LLVFS(LLVFSShardStore* store)
+:	mDataFP(nullptr),
+	mIndexFP(nullptr),
+	mReadOnly(store->isReadOnly()),
+	mValid(store->getValidState()),
+	mRemoveAfterCrash(FALSE),
+	mShardStore(store)
+{
+	mDataMutex = new LLMutex();
+
+	for (S32 i = 0; i < VFSLOCK_COUNT; i++)
+	{
+		mLockCounts[i] = 0;
+	}
+}
+
 LLVFS::~LLVFS()
 {
 	if (mDataMutex->isLocked())
 	{
 		LL_ERRS("VFS") << "LLVFS destroyed with mutex locked" << LL_ENDL;
 	}
+
+	if (mShardStore)
+	{
+		delete mShardStore;
+		mShardStore = nullptr;
+		delete mDataMutex;
+		return;
+	}
 	
 	unlockAndClose(mIndexFP);
 	mIndexFP = nullptr;
@@ -629,6 +655,29 @@ LLVFS * LLVFS::createLLVFS(const std::string& index_filename,
 	return new_vfs;
 }
 
+// static
+LLVFS * LLVFS::createShardedLLVFS(const std::string& base_filename,
+		const U32 num_shards,
+		const BOOL read_only,
+		const U32 presize)
+{
+	if (!num_shards)
+	{
+		LL_WARNS("VFS") << "Can't create a sharded VFS with no shards" << LL_ENDL;
+		return nullptr;
+	}
+
+	LLVFS * new_vfs = new LLVFS(new LLVFSShardStore(base_filename, num_shards, read_only, presize));
+	if (!new_vfs->isValid())
+	{
+		LL_WARNS("VFS") << "Failed to open sharded VFS " << base_filename << ", state " << new_vfs->getValidState() << LL_ENDL;
+		delete new_vfs;
+		new_vfs = nullptr;
+	}
+
+	return new_vfs;
+}
+
 
 
 void LLVFS::presizeDataFile(const U32 size)
@@ -660,6 +709,11 @@ void LLVFS::presizeDataFile(const U32 size)
 
 BOOL LLVFS::getExists(const LLUUID &file_id, const LLAssetType::EType file_type)
 {
+	if (mShardStore)
+	{
+		return mShardStore->getExists(file_id, file_type);
+	}
+
 	LLVFSFileBlock *block = nullptr;
 		
 	if (!isValid())
@@ -686,6 +740,11 @@ BOOL LLVFS::getExists(const LLUUID &file_id, const LLAssetType::EType file_type)
     
 S32	 LLVFS::getSize(const LLUUID &file_id, const LLAssetType::EType file_type)
 {
+	if (mShardStore)
+	{
+		return mShardStore->getSize(file_id, file_type);
+	}
+
 	S32 size = 0;
 	
 	if (!isValid())
@@ -713,6 +772,11 @@ S32	 LLVFS::getSize(const LLUUID &file_id, const LLAssetType::EType file_type)
     
 S32  LLVFS::getMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type)
 {
+	if (mShardStore)
+	{
+		return mShardStore->getMaxSize(file_id, file_type);
+	}
+
 	S32 size = 0;
 	
 	if (!isValid())
@@ -737,8 +801,13 @@ S32  LLVFS::getMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type
 	return size;
 }
 
-BOOL LLVFS::checkAvailable(S32 max_size)
+BOOL LLVFS::checkAvailable(const LLUUID &file_id, S32 max_size)
 {
+	if (mShardStore)
+	{
+		return mShardStore->checkAvailable(file_id, max_size);
+	}
+
 	lockData();
 	
 	blocks_length_map_t::iterator iter = mFreeBlocksByLength.lower_bound(max_size); // first entry >= size
@@ -751,6 +820,11 @@ BOOL LLVFS::checkAvailable(S32 max_size)
 
 BOOL LLVFS::setMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type, S32 max_size)
 {
+	if (mShardStore)
+	{
+		return mShardStore->setMaxSize(file_id, file_type, max_size);
+	}
+
 	if (!isValid())
 	{
 		LL_ERRS() << "Attempting to use invalid VFS!" << LL_ENDL;
@@ -949,6 +1023,12 @@ BOOL LLVFS::setMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type
 void LLVFS::renameFile(const LLUUID &file_id, const LLAssetType::EType file_type,
 					   const LLUUID &new_id, const LLAssetType::EType &new_type)
 {
+	if (mShardStore)
+	{
+		mShardStore->renameFile(file_id, file_type, new_id, new_type);
+		return;
+	}
+
 	if (!isValid())
 	{
 		LL_ERRS() << "Attempting to use invalid VFS!" << LL_ENDL;
@@ -1037,6 +1117,12 @@ void LLVFS::removeFileBlock(LLVFSFileBlock *fileblock)
 
 void LLVFS::removeFile(const LLUUID &file_id, const LLAssetType::EType file_type)
 {
+	if (mShardStore)
+	{
+		mShardStore->removeFile(file_id, file_type);
+		return;
+	}
+
 	if (!isValid())
 	{
 		LL_ERRS() << "Attempting to use invalid VFS!" << LL_ENDL;
@@ -1066,6 +1152,11 @@ void LLVFS::removeFile(const LLUUID &file_id, const LLAssetType::EType file_type
     
 S32 LLVFS::getData(const LLUUID &file_id, const LLAssetType::EType file_type, U8 *buffer, S32 location, S32 length)
 {
+	if (mShardStore)
+	{
+		return mShardStore->getData(file_id, file_type, buffer, location, length);
+	}
+
 	S32 bytesread = 0;
 	
 	if (!isValid())
@@ -1115,6 +1206,11 @@ S32 LLVFS::getData(const LLUUID &file_id, const LLAssetType::EType file_type, U8
     
 S32 LLVFS::storeData(const LLUUID &file_id, const LLAssetType::EType file_type, const U8 *buffer, S32 location, S32 length)
 {
+	if (mShardStore)
+	{
+		return mShardStore->storeData(file_id, file_type, buffer, location, length);
+	}
+
 	if (!isValid())
 	{
 		LL_ERRS() << "Attempting to use invalid VFS!" << LL_ENDL;
@@ -1201,6 +1297,12 @@ S32 LLVFS::storeData(const LLUUID &file_id, const LLAssetType::EType file_type,
  
 void LLVFS::incLock(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock)
 {
+	if (mShardStore)
+	{
+		mShardStore->incLock(file_id, file_type, lock);
+		return;
+	}
+
 	lockData();
 
 	LLVFSFileSpecifier spec(file_id, file_type);
@@ -1227,6 +1329,12 @@ void LLVFS::incLock(const LLUUID &file_id, const LLAssetType::EType file_type, E
 
 void LLVFS::decLock(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock)
 {
+	if (mShardStore)
+	{
+		mShardStore->decLock(file_id, file_type, lock);
+		return;
+	}
+
 	lockData();
 
 	LLVFSFileSpecifier spec(file_id, file_type);
@@ -1251,6 +1359,11 @@ void LLVFS::decLock(const LLUUID &file_id, const LLAssetType::EType file_type, E
 
 BOOL LLVFS::isLocked(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock)
 {
+	if (mShardStore)
+	{
+		return mShardStore->isLocked(file_id, file_type, lock);
+	}
+
 	lockData();
 	
 	BOOL res = FALSE;
@@ -1643,6 +1756,12 @@ LLVFSBlock *LLVFS::findFreeBlock(S32 size, LLVFSFileBlock *immune)
 
 void LLVFS::pokeFiles()
 {
+	if (mShardStore)
+	{
+		// segments are memory-mapped, nothing to preload
+		return;
+	}
+
 	if (!isValid())
 	{
 		LL_ERRS() << "Attempting to use invalid VFS!" << LL_ENDL;
@@ -1677,6 +1796,12 @@ void LLVFS::pokeFiles()
     
 void LLVFS::dumpMap()
 {
+	if (mShardStore)
+	{
+		mShardStore->dumpStatistics();
+		return;
+	}
+
 	LL_INFOS() << "Files:" << LL_ENDL;
 	for (fileblock_map::iterator it = mFileBlocks.begin(); it != mFileBlocks.end(); ++it)
 	{
@@ -1698,6 +1823,12 @@ void LLVFS::dumpMap()
 // Very slow, do not call routinely. JC
 void LLVFS::audit()
 {
+	if (mShardStore)
+	{
+		mShardStore->audit();
+		return;
+	}
+
 	// Lock the mutex through this whole function.
 	LLMutexLock lock_data(mDataMutex);
 	
@@ -1841,6 +1972,12 @@ void LLVFS::audit()
 // Slow, do not call in release.
 void LLVFS::checkMem()
 {
+	if (mShardStore)
+	{
+		// shard records are validated as the index is replayed
+		return;
+	}
+
 	lockData();
 	
 	for (fileblock_map::iterator it = mFileBlocks.begin(); it != mFileBlocks.end(); ++it)
@@ -1868,6 +2005,12 @@ void LLVFS::checkMem()
 
 void LLVFS::dumpLockCounts()
 {
+	if (mShardStore)
+	{
+		mShardStore->dumpLockCounts();
+		return;
+	}
+
 	S32 i;
 	for (i = 0; i < VFSLOCK_COUNT; i++)
 	{
@@ -1877,6 +2020,12 @@ void LLVFS::dumpLockCounts()
 
 void LLVFS::dumpStatistics()
 {
+	if (mShardStore)
+	{
+		mShardStore->dumpStatistics();
+		return;
+	}
+
 	lockData();
 	
 	// Investigate file blocks.
@@ -2049,6 +2198,12 @@ std::string get_extension(LLAssetType::EType type)
 
 void LLVFS::listFiles()
 {
+	if (mShardStore)
+	{
+		mShardStore->listFiles();
+		return;
+	}
+
 	lockData();
 	
 	for (fileblock_map::iterator it = mFileBlocks.begin(); it != mFileBlocks.end(); ++it)
@@ -2073,6 +2228,12 @@ void LLVFS::listFiles()
 
 void LLVFS::dumpFiles()
 {
+	if (mShardStore)
+	{
+		mShardStore->dumpFiles();
+		return;
+	}
+
 	lockData();
 	
 	S32 files_extracted = 0;
@@ -2112,6 +2273,11 @@ void LLVFS::dumpFiles()
 
 time_t LLVFS::creationTime()
 {
+	if (mShardStore)
+	{
+		return mShardStore->creationTime();
+	}
+
     llstat data_file_stat;
     int errors = LLFile::stat(mDataFilename, &data_file_stat);
     if (0 == errors)
@@ -55,6 +55,8 @@ enum EVFSLock
 // internal classes
 class LLVFSBlock;
 class LLVFSFileBlock;
+class LLVFSShard;
+class LLVFSShardStore;
 class LLVFSFileSpecifier
 {
 public:
@@ -70,6 +72,8 @@ public:
 
 class LLVFS
 {
+	friend class LLVFSShard;
+
 private:
 	// Use createLLVFS() to open a VFS file
 	// Pass 0 to not presize
@@ -78,6 +82,8 @@ private:
 			const BOOL read_only, 
 			const U32 presize, 
 			const BOOL remove_after_crash);
+	// Use createShardedLLVFS() to open a sharded VFS; takes ownership of store
+	LLVFS(LLVFSShardStore* store);
 public:
 	~LLVFS();
 
@@ -89,6 +95,14 @@ public:
 			const U32 presize, 
 			const BOOL remove_after_crash);
 
+	// Opens a VFS backed by num_shards memory-mapped segment files named
+	// <base_filename>.NN.data, with presize bytes split evenly between them.
+	// Same LLVFile API, but every shard has its own lock.
+	static LLVFS * createShardedLLVFS(const std::string& base_filename,
+			const U32 num_shards,
+			const BOOL read_only,
+			const U32 presize);
+
 	BOOL isValid() const			{ return (VFSVALID_OK == mValid); }
 	EVFSValid getValidState() const	{ return mValid; }
 
@@ -96,7 +110,7 @@ public:
 	BOOL getExists(const LLUUID &file_id, const LLAssetType::EType file_type);
 	S32	 getSize(const LLUUID &file_id, const LLAssetType::EType file_type);
 
-	BOOL checkAvailable(S32 max_size);
+	BOOL checkAvailable(const LLUUID &file_id, S32 max_size);
 	
 	S32  getMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type);
 	BOOL setMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type, S32 max_size);
@@ -175,6 +189,9 @@ protected:
 
 	S32 mLockCounts[VFSLOCK_COUNT];
 	BOOL mRemoveAfterCrash;
+
+	// When set, all data calls are forwarded here and the members above are unused
+	LLVFSShardStore* mShardStore;
 };
 
 extern LLVFS *gVFS;
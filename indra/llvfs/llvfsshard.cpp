@@ -0,0 +1,1755 @@
+/**
+ * @file llvfsshard.cpp
+ * @brief Memory-mapped, hash-sharded backing store for LLVFS
+ *
+ * $LicenseInfo:firstyear=2002&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llvfsshard.h"
+
+#include <algorithm>
+
+#include "llapr.h"
+#include "llmappedfile.h"
+#include "llstl.h"
+#include "llthread.h"
+
+// llvfs.cpp
+extern std::string get_extension(LLAssetType::EType type);
+
+const S32 SHARD_BLOCK_MASK = 0x000003FF;		// 1024-byte blocks, same rounding as LLVFS
+const S32 SHARD_LENGTH_INVALID = -1;			// mLength for dummy entries that only carry locks
+const S32 SHARD_CLEANUP_SIZE = 1048576;			// how much space we evict from a shard in a single stroke
+const S32 SHARD_RECORD_SIZE = 34;				// same layout as LLVFSFileBlock::serialize()
+const S32 SHARD_HEADER_SIZE = 16;
+const U32 SHARD_MAGIC = 0x53534656;				// 'VFSS'
+const U32 SHARD_VERSION = 1;
+const F32 SHARD_COMPACT_DEAD_RATIO = 0.25f;		// compact in the background once a quarter of the used space is dead...
+const U32 SHARD_COMPACT_MIN_DEAD = 4194304;		// ...and at least 4MB can be reclaimed
+const U32 SHARD_ACCESS_GRANULARITY = 300;		// access times reach the journal at most this often per file
+const char SHARD_COMPACT_SUFFIX[] = ".compact";	// segment and index being built by compact()
+const char SHARD_REWRITE_SUFFIX[] = ".tmp";		// index being built by rewriteIndex()
+
+//============================================================================
+// LLVFSShardEntry
+//============================================================================
+
+class LLVFSShardEntry
+{
+public:
+	LLVFSShardEntry()
+	:	mLocation(0),
+		mLength(SHARD_LENGTH_INVALID),
+		mSize(0),
+		mAccessTime((U32)time(nullptr))
+	{
+		for (S32 i = 0; i < (S32)VFSLOCK_COUNT; i++)
+		{
+			mLocks[i] = 0;
+		}
+	}
+
+	bool hasData() const { return mLength > 0; }
+
+	bool hasLocks() const
+	{
+		for (S32 i = 0; i < (S32)VFSLOCK_COUNT; i++)
+		{
+			if (mLocks[i])
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Index records are stored in host (little endian) order, with the same
+	// layout LLVFS uses for its index file.
+	void serialize(const LLVFSFileSpecifier& spec, U8 *buffer) const
+	{
+		memcpy(buffer, &mLocation, 4);	/* Flawfinder: ignore */
+		buffer += 4;
+		memcpy(buffer, &mLength, 4);	/* Flawfinder: ignore */
+		buffer += 4;
+		memcpy(buffer, &mAccessTime, 4);	/* Flawfinder: ignore */
+		buffer += 4;
+		memcpy(buffer, &spec.mFileID.mData, 16);	/* Flawfinder: ignore */
+		buffer += 16;
+		S16 temp_type = spec.mFileType;
+		memcpy(buffer, &temp_type, 2);	/* Flawfinder: ignore */
+		buffer += 2;
+		memcpy(buffer, &mSize, 4);	/* Flawfinder: ignore */
+	}
+
+	void deserialize(LLVFSFileSpecifier& spec, const U8 *buffer)
+	{
+		memcpy(&mLocation, buffer, 4);	/* Flawfinder: ignore */
+		buffer += 4;
+		memcpy(&mLength, buffer, 4);	/* Flawfinder: ignore */
+		buffer += 4;
+		memcpy(&mAccessTime, buffer, 4);	/* Flawfinder: ignore */
+		buffer += 4;
+		memcpy(&spec.mFileID.mData, buffer, 16);	/* Flawfinder: ignore */
+		buffer += 16;
+		S16 temp_type;
+		memcpy(&temp_type, buffer, 2);	/* Flawfinder: ignore */
+		spec.mFileType = (LLAssetType::EType)temp_type;
+		buffer += 2;
+		memcpy(&mSize, buffer, 4);	/* Flawfinder: ignore */
+	}
+
+public:
+	U32 mLocation;	// offset in the segment
+	S32 mLength;	// allocated extent
+	S32 mSize;		// bytes actually written
+	U32 mAccessTime;
+	S32 mLocks[VFSLOCK_COUNT];
+};
+
+//============================================================================
+// LLVFSShard
+//============================================================================
+
+class LLVFSShard
+{
+public:
+	typedef std::map<LLVFSFileSpecifier, LLVFSShardEntry> entry_map_t;
+	typedef std::map<LLVFSFileSpecifier, S32> record_map_t;
+
+	LLVFSShard(const std::string& data_filename, const std::string& index_filename,
+			   const U32 shard_count, const BOOL read_only, const U32 capacity);
+	~LLVFSShard();
+
+	EVFSValid getValidState() const { return mValid; }
+
+	// ---------- mMutex must be LOCKED before calling these ----------
+	LLVFSShardEntry* find(const LLVFSFileSpecifier& spec);
+
+	// Reserves length bytes at the head of the segment and returns the
+	// offset in location.  When the head is full this evicts LRU entries,
+	// never immune, and fails if that still leaves no room; the dead space
+	// is then reclaimed by the next background compaction, never here on
+	// the writer's thread.  Entries other than immune may be gone afterwards.
+	BOOL allocate(S32 length, U32& location, const LLVFSFileSpecifier* immune);
+	// Gives back the extent of entry.  Does not touch the entry itself.
+	void release(const LLVFSShardEntry& entry);
+	// Appends entry to the index journal.  A non-positive length marks spec as removed.
+	void journal(const LLVFSFileSpecifier& spec, const LLVFSShardEntry& entry);
+	void journalRemove(const LLVFSFileSpecifier& spec);
+	// Marks entry as used now.  The new time is only kept, and journaled,
+	// once it has moved by SHARD_ACCESS_GRANULARITY, so reads don't turn
+	// into a journal write each.
+	void touch(const LLVFSFileSpecifier& spec, LLVFSShardEntry& entry);
+	// Packs all live extents into a fresh copy of the segment and swaps it
+	// in together with a matching index.
+	void compact();
+
+	U32 getReclaimable() const	{ return mCapacity - mHead + mDeadBytes; }
+	// Past the dead space thresholds, or out of room with dead space to
+	// reclaim since allocate() last failed.
+	BOOL wantsCompaction() const
+	{
+		if (mOutOfRoom && mDeadBytes)
+		{
+			return TRUE;
+		}
+		return mDeadBytes >= SHARD_COMPACT_MIN_DEAD
+			&& (F32)mDeadBytes >= (F32)mHead * SHARD_COMPACT_DEAD_RATIO;
+	}
+	// ----------------------------------------------------------------
+
+	// Reads the on-disk index into entries.  Returns FALSE if the header
+	// does not match this shard.  If given, record_numbers receives the
+	// position in the journal of the record each entry was last read from.
+	BOOL readIndex(entry_map_t& entries, S32& record_count, record_map_t* record_numbers = nullptr);
+
+private:
+	BOOL openIndex();
+	BOOL mapSegment();
+	void unmapSegment();
+	// Finishes or discards whatever a crash interrupted in compact() or
+	// rewriteIndex().  Called before the shard files are opened.
+	void recoverSwap();
+	// Reopens both files after they were replaced.  On failure the shard
+	// is left empty with no capacity.
+	BOOL reopen();
+	void resetIndex();
+	// Writes a complete index for mEntries to filename and syncs it.
+	BOOL writeIndex(const std::string& filename, S32& record_count);
+	void rewriteIndex();
+	void trimJournal();
+	void evict(U32 target, const LLVFSFileSpecifier* immune);
+	// Pulls the head back to the end of the last live extent.
+	void trimHead();
+
+public:
+	LLMutex mMutex;
+	entry_map_t mEntries;
+	U8* mData;
+
+	std::string mDataFilename;
+	std::string mIndexFilename;
+
+	U32 mCapacity;
+	U32 mHead;			// first unallocated byte
+	U32 mDeadBytes;		// bytes below mHead no longer owned by any entry
+	S32 mLockCounts[VFSLOCK_COUNT];
+
+private:
+	LLFILE* mDataFP;
+	LLFILE* mIndexFP;
+	LLMappedFile mSegment;
+	S32 mJournalRecords;
+	U32 mShardCount;
+	BOOL mReadOnly;
+	BOOL mOutOfRoom;	// allocate() failed for want of space at the head
+	EVFSValid mValid;
+};
+
+LLVFSShard::LLVFSShard(const std::string& data_filename, const std::string& index_filename,
+					   const U32 shard_count, const BOOL read_only, const U32 capacity)
+:	mData(nullptr),
+	mDataFilename(data_filename),
+	mIndexFilename(index_filename),
+	mCapacity(capacity),
+	mHead(0),
+	mDeadBytes(0),
+	mDataFP(nullptr),
+	mIndexFP(nullptr),
+	mJournalRecords(0),
+	mShardCount(shard_count),
+	mReadOnly(read_only),
+	mOutOfRoom(FALSE),
+	mValid(VFSVALID_OK)
+{
+	for (S32 i = 0; i < (S32)VFSLOCK_COUNT; i++)
+	{
+		mLockCounts[i] = 0;
+	}
+
+	if (!mReadOnly)
+	{
+		recoverSwap();
+	}
+
+	mDataFP = LLVFS::openAndLock(mDataFilename, mReadOnly ? "rb" : "r+b", mReadOnly);
+	BOOL created = FALSE;
+	if (!mDataFP)
+	{
+		if (mReadOnly)
+		{
+			LL_WARNS("VFS") << "Can't find " << mDataFilename << " to open read-only VFS shard" << LL_ENDL;
+			mValid = VFSVALID_BAD_CANNOT_OPEN_READONLY;
+			return;
+		}
+
+		mDataFP = LLVFS::openAndLock(mDataFilename, "w+b", FALSE);
+		if (!mDataFP)
+		{
+			LL_WARNS("VFS") << "Couldn't open vfs shard data file " << mDataFilename << LL_ENDL;
+			mValid = VFSVALID_BAD_CANNOT_CREATE;
+			return;
+		}
+		created = TRUE;
+	}
+
+	fseek(mDataFP, 0, SEEK_END);
+	U32 file_size = (U32)ftell(mDataFP);
+	if (mReadOnly || !mCapacity)
+	{
+		mCapacity = file_size;
+	}
+	else if (file_size != mCapacity)
+	{
+		// New or resized segment, anything in the index is bogus.
+		if (!created)
+		{
+			LL_INFOS("VFS") << "Resizing VFS shard " << mDataFilename << " from " << file_size
+				<< " to " << mCapacity << " bytes" << LL_ENDL;
+		}
+		if (!LLMappedFile::truncate(mDataFP, 0) || !LLMappedFile::truncate(mDataFP, mCapacity))
+		{
+			LL_WARNS("VFS") << "Failed to pre-size VFS shard " << mDataFilename << LL_ENDL;
+			mValid = VFSVALID_BAD_CANNOT_CREATE;
+			return;
+		}
+		created = TRUE;
+	}
+
+	if (created)
+	{
+		LLFile::remove(mIndexFilename);
+	}
+
+	if (!mCapacity || !mapSegment())
+	{
+		mValid = mReadOnly ? VFSVALID_BAD_CANNOT_OPEN_READONLY : VFSVALID_BAD_CANNOT_CREATE;
+		return;
+	}
+
+	if (!openIndex())
+	{
+		mValid = VFSVALID_BAD_CORRUPT;
+	}
+}
+
+LLVFSShard::~LLVFSShard()
+{
+	if (mIndexFP)
+	{
+		fflush(mIndexFP);
+	}
+	unmapSegment();
+	LLVFS::unlockAndClose(mIndexFP);
+	mIndexFP = nullptr;
+	LLVFS::unlockAndClose(mDataFP);
+	mDataFP = nullptr;
+}
+
+BOOL LLVFSShard::mapSegment()
+{
+	if (!mSegment.map(mDataFP, mCapacity, mReadOnly, mDataFilename))
+	{
+		return FALSE;
+	}
+	mData = mSegment.getData();
+	return TRUE;
+}
+
+void LLVFSShard::unmapSegment()
+{
+	mSegment.unmap();
+	mData = nullptr;
+}
+
+void LLVFSShard::recoverSwap()
+{
+	std::string rewrite_index = mIndexFilename + SHARD_REWRITE_SUFFIX;
+	if (LLFile::isfile(rewrite_index))
+	{
+		// never renamed over the index, which is still complete
+		LLFile::remove(rewrite_index);
+	}
+
+	// The segment is renamed first, so its presence means nothing was
+	// committed, and its absence with the index still waiting means the
+	// segment was swapped but its index wasn't.
+	std::string compact_data = mDataFilename + SHARD_COMPACT_SUFFIX;
+	std::string compact_index = mIndexFilename + SHARD_COMPACT_SUFFIX;
+	if (LLFile::isfile(compact_data))
+	{
+		LL_INFOS("VFS") << "Discarding interrupted compaction of " << mDataFilename << LL_ENDL;
+		LLFile::remove(compact_data);
+		if (LLFile::isfile(compact_index))
+		{
+			LLFile::remove(compact_index);
+		}
+	}
+	else if (LLFile::isfile(compact_index))
+	{
+		LL_INFOS("VFS") << "Finishing interrupted compaction of " << mDataFilename << LL_ENDL;
+		LLFile::replace(compact_index, mIndexFilename);
+	}
+}
+
+BOOL LLVFSShard::reopen()
+{
+	mDataFP = LLVFS::openAndLock(mDataFilename, "r+b", FALSE);
+	mIndexFP = LLVFS::openAndLock(mIndexFilename, "r+b", FALSE);
+	if (mDataFP && mIndexFP && mapSegment())
+	{
+		fseek(mIndexFP, 0, SEEK_END);
+		return TRUE;
+	}
+
+	LL_WARNS("VFS") << "Lost VFS shard " << mDataFilename << ", no longer caching in it" << LL_ENDL;
+	unmapSegment();
+	LLVFS::unlockAndClose(mIndexFP);
+	mIndexFP = nullptr;
+	LLVFS::unlockAndClose(mDataFP);
+	mDataFP = nullptr;
+
+	// Only dummy entries carrying locks survive
+	for (entry_map_t::iterator it = mEntries.begin(); it != mEntries.end(); )
+	{
+		if (it->second.hasLocks())
+		{
+			it->second.mLocation = 0;
+			it->second.mSize = 0;
+			it->second.mLength = SHARD_LENGTH_INVALID;
+			++it;
+		}
+		else
+		{
+			it = mEntries.erase(it);
+		}
+	}
+	mCapacity = 0;
+	mHead = 0;
+	mDeadBytes = 0;
+	mOutOfRoom = FALSE;
+	return FALSE;
+}
+
+BOOL LLVFSShard::readIndex(entry_map_t& entries, S32& record_count, record_map_t* record_numbers)
+{
+	record_count = 0;
+	if (!mIndexFP)
+	{
+		return TRUE;
+	}
+
+	fseek(mIndexFP, 0, SEEK_END);
+	long size = ftell(mIndexFP);
+	fseek(mIndexFP, 0, SEEK_SET);
+	if (size == 0)
+	{
+		return TRUE;
+	}
+	if (size < SHARD_HEADER_SIZE)
+	{
+		return FALSE;
+	}
+
+	std::vector<U8> buffer(size);
+	size_t read = fread(&buffer[0], size, 1, mIndexFP);
+	// leave the file positioned for appending journal records
+	fseek(mIndexFP, 0, SEEK_END);
+	if (read != 1)
+	{
+		LL_WARNS("VFS") << "Short read of VFS shard index " << mIndexFilename << LL_ENDL;
+		return FALSE;
+	}
+
+	U32 header[4];
+	memcpy(header, &buffer[0], SHARD_HEADER_SIZE);	/* Flawfinder: ignore */
+	if (header[0] != SHARD_MAGIC || header[1] != SHARD_VERSION
+		|| header[2] != mShardCount || header[3] != mCapacity)
+	{
+		return FALSE;
+	}
+
+	// Replay the journal; the last record for a file wins.  A torn record
+	// at the end (crash mid-write) is ignored.
+	const U8* ptr = &buffer[SHARD_HEADER_SIZE];
+	const U8* end = &buffer[0] + size;
+	while (ptr + SHARD_RECORD_SIZE <= end)
+	{
+		LLVFSFileSpecifier spec;
+		LLVFSShardEntry entry;
+		entry.deserialize(spec, ptr);
+		ptr += SHARD_RECORD_SIZE;
+		record_count++;
+
+		if (entry.mLength <= 0)
+		{
+			entries.erase(spec);
+		}
+		else if (spec.mFileType < LLAssetType::AT_NONE
+				 || spec.mFileType >= LLAssetType::AT_COUNT
+				 || spec.mFileID.isNull()
+				 || entry.mSize < 0
+				 || entry.mSize > entry.mLength
+				 || (U64)entry.mLocation + (U64)entry.mLength > (U64)mCapacity)
+		{
+			LL_WARNS("VFS") << "Removing corrupt VFS shard record for " << spec.mFileID << LL_ENDL;
+			entries.erase(spec);
+		}
+		else
+		{
+			entries[spec] = entry;
+			if (record_numbers)
+			{
+				(*record_numbers)[spec] = record_count;
+			}
+		}
+	}
+	return TRUE;
+}
+
+BOOL LLVFSShard::openIndex()
+{
+	mIndexFP = LLVFS::openAndLock(mIndexFilename, mReadOnly ? "rb" : "r+b", mReadOnly);
+	if (!mIndexFP)
+	{
+		if (mReadOnly)
+		{
+			// a read-only shard without an index is simply empty
+			return TRUE;
+		}
+		mIndexFP = LLVFS::openAndLock(mIndexFilename, "w+b", FALSE);
+		if (!mIndexFP)
+		{
+			LL_WARNS("VFS") << "Couldn't open vfs shard index file " << mIndexFilename << LL_ENDL;
+			return FALSE;
+		}
+	}
+
+	record_map_t record_numbers;
+	if (!readIndex(mEntries, mJournalRecords, &record_numbers))
+	{
+		if (mReadOnly)
+		{
+			LL_WARNS("VFS") << "VFS shard index " << mIndexFilename << " does not match its segment" << LL_ENDL;
+			return FALSE;
+		}
+		LL_INFOS("VFS") << "Discarding stale VFS shard index " << mIndexFilename << LL_ENDL;
+		mEntries.clear();
+		resetIndex();
+		return TRUE;
+	}
+
+	if (!mReadOnly && ftell(mIndexFP) == 0)
+	{
+		// brand new index, stamp the header
+		resetIndex();
+	}
+
+	// Rebuild the allocator state.  Overlapping extents can only be the
+	// result of a crash between reusing space and journaling the removal of
+	// its previous owner, so of two overlapping entries the one journaled
+	// last owns the bytes and the other is dropped.
+	typedef std::vector<std::pair<U32, LLVFSFileSpecifier> > location_list_t;
+	location_list_t by_location;
+	by_location.reserve(mEntries.size());
+	for (entry_map_t::iterator it = mEntries.begin(); it != mEntries.end(); ++it)
+	{
+		by_location.push_back(std::make_pair(it->second.mLocation, it->first));
+	}
+	std::sort(by_location.begin(), by_location.end(),
+			  [](const location_list_t::value_type& lhs, const location_list_t::value_type& rhs)
+			  { return lhs.first < rhs.first; });
+
+	U32 live_bytes = 0;
+	U32 end = 0;
+	S32 dropped = 0;
+	const LLVFSFileSpecifier* last = nullptr;
+	for (location_list_t::iterator it = by_location.begin(); it != by_location.end(); ++it)
+	{
+		LLVFSShardEntry& entry = mEntries[it->second];
+		if (last && entry.mLocation < end)
+		{
+			dropped++;
+			if (record_numbers[it->second] < record_numbers[*last])
+			{
+				mEntries.erase(it->second);
+				continue;
+			}
+			// Every extent before last ends at or below its start, and so
+			// at or below this one's
+			live_bytes -= mEntries[*last].mLength;
+			mEntries.erase(*last);
+		}
+		end = entry.mLocation + entry.mLength;
+		live_bytes += entry.mLength;
+		last = &it->second;
+	}
+	mHead = end;
+	mDeadBytes = mHead - live_bytes;
+
+	if (dropped)
+	{
+		LL_WARNS("VFS") << "Dropped " << dropped << " overlapping entries from " << mIndexFilename << LL_ENDL;
+	}
+
+	if (!mReadOnly && (dropped || mJournalRecords > 2 * (S32)mEntries.size() + 1024))
+	{
+		rewriteIndex();
+	}
+
+	LL_INFOS("VFS") << "Opened VFS shard " << mDataFilename << ": " << mEntries.size() << " files, "
+		<< (live_bytes >> 10) << "K used, " << (mDeadBytes >> 10) << "K dead, "
+		<< ((mCapacity - mHead) >> 10) << "K free" << LL_ENDL;
+	return TRUE;
+}
+
+void LLVFSShard::resetIndex()
+{
+	LLMappedFile::truncate(mIndexFP, 0);
+	fseek(mIndexFP, 0, SEEK_SET);
+
+	U32 header[4] = { SHARD_MAGIC, SHARD_VERSION, mShardCount, mCapacity };
+	if (fwrite(header, SHARD_HEADER_SIZE, 1, mIndexFP) != 1)
+	{
+		LL_WARNS("VFS") << "Short write" << LL_ENDL;
+	}
+	mJournalRecords = 0;
+	mHead = 0;
+	mDeadBytes = 0;
+}
+
+BOOL LLVFSShard::writeIndex(const std::string& filename, S32& record_count)
+{
+	LLFILE* fp = LLFile::fopen(filename, "wb");
+	if (!fp)
+	{
+		LL_WARNS("VFS") << "Couldn't create " << filename << LL_ENDL;
+		return FALSE;
+	}
+
+	record_count = 0;
+	U32 header[4] = { SHARD_MAGIC, SHARD_VERSION, mShardCount, mCapacity };
+	BOOL ok = (fwrite(header, SHARD_HEADER_SIZE, 1, fp) == 1);
+	U8 buffer[SHARD_RECORD_SIZE];
+	for (entry_map_t::iterator it = mEntries.begin(); ok && it != mEntries.end(); ++it)
+	{
+		if (it->second.hasData())
+		{
+			it->second.serialize(it->first, buffer);
+			ok = (fwrite(buffer, SHARD_RECORD_SIZE, 1, fp) == 1);
+			record_count++;
+		}
+	}
+	ok = ok && LLMappedFile::sync(fp);
+	fclose(fp);
+
+	if (!ok)
+	{
+		LL_WARNS("VFS") << "Short write to " << filename << LL_ENDL;
+		LLFile::remove(filename);
+	}
+	return ok;
+}
+
+// Built beside the live journal and renamed over it, so that a crash part
+// way through leaves the old journal in place.
+void LLVFSShard::rewriteIndex()
+{
+	std::string filename = mIndexFilename + SHARD_REWRITE_SUFFIX;
+	S32 record_count;
+	if (!mIndexFP || !writeIndex(filename, record_count))
+	{
+		return;
+	}
+
+	LLVFS::unlockAndClose(mIndexFP);
+	if (LLFile::replace(filename, mIndexFilename) == 0)
+	{
+		mJournalRecords = record_count;
+	}
+	else
+	{
+		LLFile::remove(filename);
+	}
+
+	mIndexFP = LLVFS::openAndLock(mIndexFilename, "r+b", FALSE);
+	if (mIndexFP)
+	{
+		fseek(mIndexFP, 0, SEEK_END);
+	}
+	else
+	{
+		LL_WARNS("VFS") << "Couldn't reopen " << mIndexFilename << ", changes to " << mDataFilename
+			<< " will not be saved" << LL_ENDL;
+	}
+}
+
+void LLVFSShard::trimJournal()
+{
+	// Keep the journal from growing without bound between compactions
+	if (mJournalRecords > 4 * (S32)mEntries.size() + 4096)
+	{
+		rewriteIndex();
+	}
+}
+
+LLVFSShardEntry* LLVFSShard::find(const LLVFSFileSpecifier& spec)
+{
+	entry_map_t::iterator it = mEntries.find(spec);
+	return (it != mEntries.end()) ? &it->second : nullptr;
+}
+
+void LLVFSShard::journal(const LLVFSFileSpecifier& spec, const LLVFSShardEntry& entry)
+{
+	if (mReadOnly)
+	{
+		LL_WARNS() << "Attempt to sync read-only VFS" << LL_ENDL;
+		return;
+	}
+	if (!mIndexFP)
+	{
+		return;
+	}
+
+	U8 buffer[SHARD_RECORD_SIZE];
+	entry.serialize(spec, buffer);
+	// Flushed right away so the record outlives a crash of the process.
+	// The segment is a shared mapping, so the data it describes already
+	// does.
+	if (fwrite(buffer, SHARD_RECORD_SIZE, 1, mIndexFP) != 1 || fflush(mIndexFP) != 0)
+	{
+		LL_WARNS() << "Short write" << LL_ENDL;
+	}
+	mJournalRecords++;
+}
+
+void LLVFSShard::journalRemove(const LLVFSFileSpecifier& spec)
+{
+	LLVFSShardEntry tombstone;
+	tombstone.mLength = 0;
+	journal(spec, tombstone);
+	trimJournal();
+}
+
+void LLVFSShard::touch(const LLVFSFileSpecifier& spec, LLVFSShardEntry& entry)
+{
+	U32 now = (U32)time(nullptr);
+	if (now >= entry.mAccessTime && now - entry.mAccessTime < SHARD_ACCESS_GRANULARITY)
+	{
+		return;
+	}
+
+	entry.mAccessTime = now;
+	if (entry.hasData() && !mReadOnly)
+	{
+		journal(spec, entry);
+		trimJournal();
+	}
+}
+
+void LLVFSShard::release(const LLVFSShardEntry& entry)
+{
+	if (!entry.hasData())
+	{
+		return;
+	}
+	if (entry.mLocation + entry.mLength == mHead)
+	{
+		// last extent, just pull the head back
+		mHead = entry.mLocation;
+	}
+	else
+	{
+		mDeadBytes += entry.mLength;
+	}
+}
+
+BOOL LLVFSShard::allocate(S32 length, U32& location, const LLVFSFileSpecifier* immune)
+{
+	if (length <= 0 || (U32)length > mCapacity)
+	{
+		return FALSE;
+	}
+
+	if (mHead + (U32)length > mCapacity)
+	{
+		if (getReclaimable() < (U32)length)
+		{
+			evict(llmax((U32)length, (U32)SHARD_CLEANUP_SIZE), immune);
+		}
+		trimHead();
+
+		if (mHead + (U32)length > mCapacity)
+		{
+			LL_WARNS("VFS") << "VFS: No room for " << length << " bytes in " << mDataFilename << " until it is compacted" << LL_ENDL;
+			mOutOfRoom = TRUE;
+			return FALSE;
+		}
+	}
+
+	location = mHead;
+	mHead += length;
+	return TRUE;
+}
+
+void LLVFSShard::evict(U32 target, const LLVFSFileSpecifier* immune)
+{
+	typedef std::vector<std::pair<U32, LLVFSFileSpecifier> > lru_list_t;
+	lru_list_t lru_list;
+	for (entry_map_t::iterator it = mEntries.begin(); it != mEntries.end(); ++it)
+	{
+		const LLVFSShardEntry& entry = it->second;
+		if (entry.hasData() && !entry.hasLocks() && !(immune && *immune == it->first))
+		{
+			lru_list.push_back(std::make_pair(entry.mAccessTime, it->first));
+		}
+	}
+	std::sort(lru_list.begin(), lru_list.end(),
+			  [](const lru_list_t::value_type& lhs, const lru_list_t::value_type& rhs)
+			  { return (lhs.first == rhs.first) ? lhs.second < rhs.second : lhs.first < rhs.first; });
+
+	S32 removed = 0;
+	for (lru_list_t::iterator it = lru_list.begin(); it != lru_list.end() && getReclaimable() < target; ++it)
+	{
+		entry_map_t::iterator entry_it = mEntries.find(it->second);
+		release(entry_it->second);
+		mEntries.erase(entry_it);
+		journalRemove(it->second);
+		removed++;
+	}
+
+	LL_INFOS("VFS") << "VFS: LRU: Removed " << removed << " files from " << mDataFilename << LL_ENDL;
+}
+
+void LLVFSShard::trimHead()
+{
+	U32 end = 0;
+	for (entry_map_t::iterator it = mEntries.begin(); it != mEntries.end(); ++it)
+	{
+		if (it->second.hasData())
+		{
+			end = llmax(end, it->second.mLocation + (U32)it->second.mLength);
+		}
+	}
+	// Nothing between the last live extent and the head is owned
+	mDeadBytes -= mHead - end;
+	mHead = end;
+}
+
+void LLVFSShard::compact()
+{
+	// Asked for once; a later allocate() that still can't fit asks again
+	mOutOfRoom = FALSE;
+	if (mReadOnly || !mDeadBytes || !mIndexFP)
+	{
+		return;
+	}
+
+	typedef std::vector<std::pair<U32, LLVFSShardEntry*> > location_list_t;
+	location_list_t by_location;
+	by_location.reserve(mEntries.size());
+	for (entry_map_t::iterator it = mEntries.begin(); it != mEntries.end(); ++it)
+	{
+		if (it->second.hasData())
+		{
+			by_location.push_back(std::make_pair(it->second.mLocation, &it->second));
+		}
+	}
+	std::sort(by_location.begin(), by_location.end(),
+			  [](const location_list_t::value_type& lhs, const location_list_t::value_type& rhs)
+			  { return lhs.first < rhs.first; });
+
+	// The live segment is never written to.  Its packed copy and the index
+	// describing it are both synced before the copy is renamed over it,
+	// which is the commit point; recoverSwap() handles a crash either side.
+	std::string compact_data = mDataFilename + SHARD_COMPACT_SUFFIX;
+	std::string compact_index = mIndexFilename + SHARD_COMPACT_SUFFIX;
+	LLFILE* data_fp = LLFile::fopen(compact_data, "wb");
+	if (!data_fp)
+	{
+		LL_WARNS("VFS") << "Couldn't create " << compact_data << ", not compacting" << LL_ENDL;
+		return;
+	}
+
+	U32 write_location = 0;
+	BOOL ok = TRUE;
+	for (location_list_t::iterator it = by_location.begin(); ok && it != by_location.end(); ++it)
+	{
+		LLVFSShardEntry* entry = it->second;
+		if (entry->mSize > 0)
+		{
+			ok = fseek(data_fp, write_location, SEEK_SET) == 0
+				&& fwrite(mData + entry->mLocation, entry->mSize, 1, data_fp) == 1;
+		}
+		entry->mLocation = write_location;
+		write_location += entry->mLength;
+	}
+	ok = ok && LLMappedFile::truncate(data_fp, mCapacity) && LLMappedFile::sync(data_fp);
+	fclose(data_fp);
+
+	S32 record_count = 0;
+	ok = ok && writeIndex(compact_index, record_count);
+
+	BOOL index_swapped = FALSE;
+	if (ok)
+	{
+		unmapSegment();
+		LLVFS::unlockAndClose(mIndexFP);
+		mIndexFP = nullptr;
+		LLVFS::unlockAndClose(mDataFP);
+		mDataFP = nullptr;
+
+		ok = (LLFile::replace(compact_data, mDataFilename) == 0);
+		index_swapped = ok && (LLFile::replace(compact_index, mIndexFilename) == 0);
+	}
+
+	if (!ok)
+	{
+		LL_WARNS("VFS") << "Failed to compact " << mDataFilename << LL_ENDL;
+		for (location_list_t::iterator it = by_location.begin(); it != by_location.end(); ++it)
+		{
+			it->second->mLocation = it->first;
+		}
+		LLFile::remove(compact_data, ENOENT);
+		LLFile::remove(compact_index, ENOENT);
+		if (!mDataFP)
+		{
+			reopen();
+		}
+		return;
+	}
+
+	LL_DEBUGS("VFS") << "Compacted " << mDataFilename << ", reclaimed " << (mDeadBytes >> 10) << "K" << LL_ENDL;
+
+	if (!reopen())
+	{
+		return;
+	}
+	if (!index_swapped)
+	{
+		// The segment is already committed, so its index has to be
+		// written in place.  Until that is synced, recoverSwap() can still
+		// finish the job from the copy.
+		resetIndex();
+		for (entry_map_t::iterator it = mEntries.begin(); it != mEntries.end(); ++it)
+		{
+			if (it->second.hasData())
+			{
+				journal(it->first, it->second);
+			}
+		}
+		if (LLMappedFile::sync(mIndexFP))
+		{
+			LLFile::remove(compact_index);
+		}
+	}
+	mHead = write_location;
+	mDeadBytes = 0;
+	mJournalRecords = record_count;
+}
+
+//============================================================================
+// LLVFSCompactThread
+//============================================================================
+
+class LLVFSCompactThread : public LLThread
+{
+public:
+	LLVFSCompactThread(LLVFSShardStore* store)
+	:	LLThread("VFS Compaction"),
+		mStore(store),
+		mPending(false)
+	{
+	}
+
+	void requestCompaction()
+	{
+		lockData();
+		mPending = true;
+		wakeLocked();
+		unlockData();
+	}
+
+protected:
+	/*virtual*/ bool runCondition() override
+	{
+		return mPending;
+	}
+
+	/*virtual*/ void run() override
+	{
+		while (true)
+		{
+			checkPause();
+			if (isQuitting())
+			{
+				break;
+			}
+
+			lockData();
+			mPending = false;
+			unlockData();
+
+			// One shard per pass, so a burst of removals never holds up
+			// shutdown for more than a single compaction.
+			while (!isQuitting() && mStore->compactNext())
+			{
+			}
+		}
+	}
+
+private:
+	LLVFSShardStore* mStore;
+	bool mPending;
+};
+
+//============================================================================
+// LLVFSShardStore
+//============================================================================
+
+LLVFSShardStore::LLVFSShardStore(const std::string& base_filename,
+								 const U32 num_shards,
+								 const BOOL read_only,
+								 const U32 presize)
+:	mBaseFilename(base_filename),
+	mReadOnly(read_only),
+	mValid(VFSVALID_OK)
+{
+	llassert(num_shards > 0);
+
+	// Keep every shard a whole number of blocks
+	U32 capacity = (presize / num_shards) & ~SHARD_BLOCK_MASK;
+
+	for (U32 i = 0; i < num_shards; i++)
+	{
+		std::string data_filename = mBaseFilename + llformat(".%02u.data", i);
+		std::string index_filename = mBaseFilename + llformat(".%02u.index", i);
+		LL_INFOS("VFS") << "Attempting to open VFS shard " << data_filename << LL_ENDL;
+
+		LLVFSShard* shard = new LLVFSShard(data_filename, index_filename, num_shards, mReadOnly, capacity);
+		mShards.push_back(shard);
+		if (shard->getValidState() != VFSVALID_OK)
+		{
+			mValid = shard->getValidState();
+			return;
+		}
+	}
+
+	if (!mReadOnly)
+	{
+		// Shards past the end belong to a previous, larger shard count
+		for (U32 i = num_shards; ; i++)
+		{
+			std::string data_filename = mBaseFilename + llformat(".%02u.data", i);
+			if (!LLFile::isfile(data_filename))
+			{
+				break;
+			}
+			LLFile::remove(data_filename);
+			LLFile::remove(mBaseFilename + llformat(".%02u.index", i));
+		}
+
+		mCompactThread.reset(new LLVFSCompactThread(this));
+		mCompactThread->start();
+		if (needsCompaction())
+		{
+			mCompactThread->requestCompaction();
+		}
+	}
+}
+
+LLVFSShardStore::~LLVFSShardStore()
+{
+	if (mCompactThread)
+	{
+		mCompactThread->shutdown();
+		mCompactThread.reset();
+	}
+	std::for_each(mShards.begin(), mShards.end(), DeletePointer());
+	mShards.clear();
+}
+
+LLVFSShard* LLVFSShardStore::getShard(const LLUUID &file_id) const
+{
+	return mShards[file_id.hash() % mShards.size()];
+}
+
+BOOL LLVFSShardStore::getExists(const LLUUID &file_id, const LLAssetType::EType file_type)
+{
+	LLVFSShard* shard = getShard(file_id);
+	LLMutexLock lock(&shard->mMutex);
+
+	LLVFSFileSpecifier spec(file_id, file_type);
+	LLVFSShardEntry* entry = shard->find(spec);
+	if (entry)
+	{
+		shard->touch(spec, *entry);
+	}
+	return (entry && entry->hasData()) ? TRUE : FALSE;
+}
+
+S32 LLVFSShardStore::getSize(const LLUUID &file_id, const LLAssetType::EType file_type)
+{
+	LLVFSShard* shard = getShard(file_id);
+	LLMutexLock lock(&shard->mMutex);
+
+	LLVFSFileSpecifier spec(file_id, file_type);
+	LLVFSShardEntry* entry = shard->find(spec);
+	if (entry)
+	{
+		shard->touch(spec, *entry);
+		return entry->mSize;
+	}
+	return 0;
+}
+
+S32 LLVFSShardStore::getMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type)
+{
+	LLVFSShard* shard = getShard(file_id);
+	LLMutexLock lock(&shard->mMutex);
+
+	LLVFSFileSpecifier spec(file_id, file_type);
+	LLVFSShardEntry* entry = shard->find(spec);
+	if (entry)
+	{
+		shard->touch(spec, *entry);
+		return entry->mLength;
+	}
+	return 0;
+}
+
+BOOL LLVFSShardStore::checkAvailable(const LLUUID &file_id, S32 max_size)
+{
+	// A file only ever lives in the shard its id hashes to
+	LLVFSShard* shard = getShard(file_id);
+	LLMutexLock lock(&shard->mMutex);
+	return (shard->getReclaimable() >= (U32)max_size) ? TRUE : FALSE;
+}
+
+BOOL LLVFSShardStore::setMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type, S32 max_size)
+{
+	if (mReadOnly)
+	{
+		LL_ERRS() << "Attempt to write to read-only VFS" << LL_ENDL;
+	}
+	if (max_size <= 0)
+	{
+		LL_WARNS() << "VFS: Attempt to assign size " << max_size << " to vfile " << file_id << LL_ENDL;
+		return FALSE;
+	}
+
+	// round all sizes upward to KB increments, except textures (see LLVFS::setMaxSize)
+	if (file_type != LLAssetType::AT_TEXTURE)
+	{
+		if (max_size & SHARD_BLOCK_MASK)
+		{
+			max_size += SHARD_BLOCK_MASK;
+			max_size &= ~SHARD_BLOCK_MASK;
+		}
+	}
+
+	LLVFSShard* shard = getShard(file_id);
+	BOOL wants_compaction = FALSE;
+	BOOL res = TRUE;
+	{
+		LLMutexLock lock(&shard->mMutex);
+
+		LLVFSFileSpecifier spec(file_id, file_type);
+		LLVFSShardEntry* entry = shard->find(spec);
+		if (entry && entry->hasData())
+		{
+			shard->touch(spec, *entry);
+
+			if (max_size < entry->mLength)
+			{
+				// this file is shrinking, the tail becomes dead space
+				LLVFSShardEntry tail;
+				tail.mLocation = entry->mLocation + max_size;
+				tail.mLength = entry->mLength - max_size;
+				shard->release(tail);
+
+				entry->mLength = max_size;
+				if (entry->mLength < entry->mSize)
+				{
+					LL_ERRS() << "Truncating virtual file " << file_id << " to " << entry->mLength << " bytes" << LL_ENDL;
+					entry->mSize = entry->mLength;
+				}
+				shard->journal(spec, *entry);
+			}
+			else if (max_size > entry->mLength)
+			{
+				// this file is growing
+				U32 size_increase = max_size - entry->mLength;
+				U32 new_location;
+				if (entry->mLocation + entry->mLength == shard->mHead
+					&& shard->mHead + size_increase <= shard->mCapacity)
+				{
+					// last extent in the segment, grow in place
+					shard->mHead += size_increase;
+					entry->mLength = max_size;
+					shard->journal(spec, *entry);
+				}
+				else if (shard->allocate(max_size, new_location, &spec))
+				{
+					// allocate() may have compacted, entry->mLocation is current
+					memcpy(shard->mData + new_location, shard->mData + entry->mLocation, entry->mSize);	/* Flawfinder: ignore */
+					shard->release(*entry);
+					entry->mLocation = new_location;
+					entry->mLength = max_size;
+					shard->journal(spec, *entry);
+				}
+				else
+				{
+					LL_WARNS() << "VFS: No space (" << max_size << ") to resize existing vfile " << file_id << LL_ENDL;
+					res = FALSE;
+				}
+			}
+		}
+		else
+		{
+			U32 new_location;
+			if (shard->allocate(max_size, new_location, &spec))
+			{
+				// allocate() may have evicted other entries, look this one up again
+				LLVFSShardEntry& new_entry = shard->mEntries[spec];
+				new_entry.mLocation = new_location;
+				new_entry.mLength = max_size;
+				new_entry.mSize = 0;
+				new_entry.mAccessTime = (U32)time(nullptr);
+				shard->journal(spec, new_entry);
+			}
+			else
+			{
+				LL_WARNS() << "VFS: No space (" << max_size << ") for new virtual file " << file_id << LL_ENDL;
+				res = FALSE;
+			}
+		}
+		wants_compaction = shard->wantsCompaction();
+	}
+
+	if (wants_compaction && mCompactThread)
+	{
+		mCompactThread->requestCompaction();
+	}
+	return res;
+}
+
+// As with LLVFS, the file moves but its locks come along with it and the
+// old name is forgotten entirely.
+void LLVFSShardStore::renameFile(const LLUUID &file_id, const LLAssetType::EType file_type,
+								 const LLUUID &new_id, const LLAssetType::EType &new_type)
+{
+	if (mReadOnly)
+	{
+		LL_ERRS() << "Attempt to write to read-only VFS" << LL_ENDL;
+	}
+
+	LLVFSShard* src_shard = getShard(file_id);
+	LLVFSShard* dst_shard = getShard(new_id);
+
+	// Always lock in address order so two crossing renames can't deadlock
+	LLMutex* first_mutex = &src_shard->mMutex;
+	LLMutex* second_mutex = (src_shard == dst_shard) ? nullptr : &dst_shard->mMutex;
+	if (second_mutex && second_mutex < first_mutex)
+	{
+		std::swap(first_mutex, second_mutex);
+	}
+	BOOL wants_compaction = FALSE;
+	{
+		LLMutexLock first_lock(first_mutex);
+		LLMutexLock second_lock(second_mutex);
+		renameLocked(src_shard, dst_shard, file_id, file_type, new_id, new_type);
+		wants_compaction = dst_shard->wantsCompaction() || src_shard->wantsCompaction();
+	}
+
+	if (wants_compaction && mCompactThread)
+	{
+		mCompactThread->requestCompaction();
+	}
+}
+
+void LLVFSShardStore::renameLocked(LLVFSShard* src_shard, LLVFSShard* dst_shard,
+								   const LLUUID &file_id, const LLAssetType::EType file_type,
+								   const LLUUID &new_id, const LLAssetType::EType &new_type)
+{
+	LLVFSFileSpecifier old_spec(file_id, file_type);
+	LLVFSFileSpecifier new_spec(new_id, new_type);
+	if (old_spec == new_spec)
+	{
+		return;
+	}
+
+	LLVFSShardEntry* src_entry = src_shard->find(old_spec);
+	if (!src_entry)
+	{
+		LL_WARNS() << "VFS: Attempt to rename nonexistent vfile " << file_id << ":" << file_type << LL_ENDL;
+		return;
+	}
+
+	// if there's something in the target location, remove it
+	LLVFSShardEntry* dest_entry = dst_shard->find(new_spec);
+	if (dest_entry)
+	{
+		if (dest_entry->hasLocks())
+		{
+			LL_ERRS() << "Renaming VFS block to a locked file." << LL_ENDL;
+		}
+		dst_shard->release(*dest_entry);
+		dst_shard->mEntries.erase(new_spec);
+		dst_shard->journalRemove(new_spec);
+	}
+
+	LLVFSShardEntry moved = *src_entry;
+	moved.mAccessTime = (U32)time(nullptr);
+
+	if (src_shard != dst_shard && moved.hasData())
+	{
+		U32 new_location;
+		if (dst_shard->allocate(moved.mLength, new_location, &new_spec))
+		{
+			memcpy(dst_shard->mData + new_location, src_shard->mData + src_entry->mLocation, src_entry->mSize);	/* Flawfinder: ignore */
+			moved.mLocation = new_location;
+		}
+		else
+		{
+			// The data is lost, but the locks still follow the new name
+			LL_WARNS() << "VFS: No space (" << moved.mLength << ") to rename vfile " << file_id << " to " << new_id << LL_ENDL;
+			moved.mLocation = 0;
+			moved.mSize = 0;
+			moved.mLength = SHARD_LENGTH_INVALID;
+		}
+		src_shard->release(*src_entry);
+	}
+
+	for (S32 i = 0; i < (S32)VFSLOCK_COUNT; i++)
+	{
+		src_shard->mLockCounts[i] -= moved.mLocks[i];
+		dst_shard->mLockCounts[i] += moved.mLocks[i];
+	}
+
+	src_shard->mEntries.erase(old_spec);
+	src_shard->journalRemove(old_spec);
+
+	if (moved.hasData())
+	{
+		dst_shard->mEntries[new_spec] = moved;
+		dst_shard->journal(new_spec, moved);
+	}
+	else if (moved.hasLocks())
+	{
+		dst_shard->mEntries[new_spec] = moved;
+	}
+}
+
+void LLVFSShardStore::removeFile(const LLUUID &file_id, const LLAssetType::EType file_type)
+{
+	if (mReadOnly)
+	{
+		LL_ERRS() << "Attempt to write to read-only VFS" << LL_ENDL;
+	}
+
+	LLVFSShard* shard = getShard(file_id);
+	BOOL wants_compaction = FALSE;
+	{
+		LLMutexLock lock(&shard->mMutex);
+
+		LLVFSFileSpecifier spec(file_id, file_type);
+		LLVFSShardEntry* entry = shard->find(spec);
+		if (!entry)
+		{
+			LL_WARNS() << "VFS: attempting to remove nonexistent file " << file_id << " type " << file_type << LL_ENDL;
+			return;
+		}
+
+		shard->release(*entry);
+		if (entry->hasLocks())
+		{
+			// keep a dummy entry around to carry the locks
+			entry->mLocation = 0;
+			entry->mSize = 0;
+			entry->mLength = SHARD_LENGTH_INVALID;
+		}
+		else
+		{
+			shard->mEntries.erase(spec);
+		}
+		shard->journalRemove(spec);
+		wants_compaction = shard->wantsCompaction();
+	}
+
+	if (wants_compaction && mCompactThread)
+	{
+		mCompactThread->requestCompaction();
+	}
+}
+
+S32 LLVFSShardStore::getData(const LLUUID &file_id, const LLAssetType::EType file_type, U8 *buffer, S32 location, S32 length)
+{
+	llassert(location >= 0);
+	llassert(length >= 0);
+
+	LLVFSShard* shard = getShard(file_id);
+	LLMutexLock lock(&shard->mMutex);
+
+	LLVFSFileSpecifier spec(file_id, file_type);
+	LLVFSShardEntry* entry = shard->find(spec);
+	if (!entry)
+	{
+		return 0;
+	}
+
+	shard->touch(spec, *entry);
+	if (location > entry->mSize)
+	{
+		LL_WARNS() << "VFS: Attempt to read location " << location << " in file " << file_id << " of length " << entry->mSize << LL_ENDL;
+		return 0;
+	}
+
+	if (length > entry->mSize - location)
+	{
+		length = entry->mSize - location;
+	}
+	memcpy(buffer, shard->mData + entry->mLocation + location, length);	/* Flawfinder: ignore */
+	return length;
+}
+
+S32 LLVFSShardStore::storeData(const LLUUID &file_id, const LLAssetType::EType file_type, const U8 *buffer, S32 location, S32 length)
+{
+	if (mReadOnly)
+	{
+		LL_ERRS() << "Attempt to write to read-only VFS" << LL_ENDL;
+	}
+	llassert(length > 0);
+
+	LLVFSShard* shard = getShard(file_id);
+	LLMutexLock lock(&shard->mMutex);
+
+	LLVFSFileSpecifier spec(file_id, file_type);
+	LLVFSShardEntry* entry = shard->find(spec);
+	if (!entry)
+	{
+		return 0;
+	}
+
+	S32 in_loc = location;
+	if (location == -1)
+	{
+		location = entry->mSize;
+	}
+	llassert(location >= 0);
+
+	shard->touch(spec, *entry);
+
+	if (!entry->hasData())
+	{
+		// Block was removed, ignore write
+		LL_WARNS() << "VFS: Attempt to write to invalid block"
+				<< " in file " << file_id
+				<< " location: " << in_loc
+				<< " bytes: " << length
+				<< LL_ENDL;
+		return length;
+	}
+	else if (location > entry->mLength)
+	{
+		LL_WARNS() << "VFS: Attempt to write to location " << location
+				<< " in file " << file_id
+				<< " type " << S32(file_type)
+				<< " of size " << entry->mSize
+				<< " block length " << entry->mLength
+				<< LL_ENDL;
+		return length;
+	}
+
+	if (length > entry->mLength - location)
+	{
+		LL_WARNS() << "VFS: Truncating write to virtual file " << file_id << " type " << S32(file_type) << LL_ENDL;
+		length = entry->mLength - location;
+	}
+
+	memcpy(shard->mData + entry->mLocation + location, buffer, length);	/* Flawfinder: ignore */
+
+	if (location + length > entry->mSize)
+	{
+		entry->mSize = location + length;
+		shard->journal(spec, *entry);
+	}
+	return length;
+}
+
+void LLVFSShardStore::incLock(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock)
+{
+	LLVFSShard* shard = getShard(file_id);
+	LLMutexLock mutex_lock(&shard->mMutex);
+
+	// Creates a dummy entry which isn't saved if the file doesn't exist
+	LLVFSShardEntry& entry = shard->mEntries[LLVFSFileSpecifier(file_id, file_type)];
+	entry.mLocks[lock]++;
+	shard->mLockCounts[lock]++;
+}
+
+void LLVFSShardStore::decLock(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock)
+{
+	LLVFSShard* shard = getShard(file_id);
+	LLMutexLock mutex_lock(&shard->mMutex);
+
+	LLVFSFileSpecifier spec(file_id, file_type);
+	LLVFSShardEntry* entry = shard->find(spec);
+	if (!entry)
+	{
+		return;
+	}
+
+	if (entry->mLocks[lock] > 0)
+	{
+		entry->mLocks[lock]--;
+	}
+	else
+	{
+		LL_WARNS() << "VFS: Decrementing zero-value lock " << lock << LL_ENDL;
+	}
+	shard->mLockCounts[lock]--;
+
+	if (!entry->hasData() && !entry->hasLocks())
+	{
+		// last lock on a dummy entry
+		shard->mEntries.erase(spec);
+	}
+}
+
+BOOL LLVFSShardStore::isLocked(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock)
+{
+	LLVFSShard* shard = getShard(file_id);
+	LLMutexLock mutex_lock(&shard->mMutex);
+
+	LLVFSShardEntry* entry = shard->find(LLVFSFileSpecifier(file_id, file_type));
+	return (entry && entry->mLocks[lock] > 0) ? TRUE : FALSE;
+}
+
+BOOL LLVFSShardStore::needsCompaction()
+{
+	for (std::vector<LLVFSShard*>::iterator it = mShards.begin(); it != mShards.end(); ++it)
+	{
+		LLMutexLock lock(&(*it)->mMutex);
+		if ((*it)->wantsCompaction())
+		{
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+BOOL LLVFSShardStore::compactNext()
+{
+	LLVFSShard* worst = nullptr;
+	U32 worst_dead = 0;
+	for (std::vector<LLVFSShard*>::iterator it = mShards.begin(); it != mShards.end(); ++it)
+	{
+		LLMutexLock lock(&(*it)->mMutex);
+		if ((*it)->wantsCompaction() && (*it)->mDeadBytes > worst_dead)
+		{
+			worst = *it;
+			worst_dead = (*it)->mDeadBytes;
+		}
+	}
+
+	if (!worst)
+	{
+		return FALSE;
+	}
+
+	LLMutexLock lock(&worst->mMutex);
+	worst->compact();
+	return TRUE;
+}
+
+void LLVFSShardStore::audit()
+{
+	BOOL vfs_corrupt = FALSE;
+
+	for (std::vector<LLVFSShard*>::iterator it = mShards.begin(); it != mShards.end(); ++it)
+	{
+		LLVFSShard* shard = *it;
+		LLMutexLock lock(&shard->mMutex);
+
+		// Re-read the journal and check it against memory
+		LLVFSShard::entry_map_t on_disk;
+		S32 records = 0;
+		if (!shard->readIndex(on_disk, records))
+		{
+			LL_WARNS("VFS") << "VFile index header mismatch in " << shard->mIndexFilename << LL_ENDL;
+			vfs_corrupt = TRUE;
+			continue;
+		}
+
+		U32 live_bytes = 0;
+		for (LLVFSShard::entry_map_t::iterator entry_it = shard->mEntries.begin(); entry_it != shard->mEntries.end(); ++entry_it)
+		{
+			const LLVFSShardEntry& entry = entry_it->second;
+			if (!entry.hasData())
+			{
+				continue;
+			}
+			live_bytes += entry.mLength;
+
+			if (entry.mLocation + entry.mLength > shard->mHead)
+			{
+				LL_WARNS("VFS") << "VFile " << entry_it->first.mFileID << " extends past the segment head" << LL_ENDL;
+				vfs_corrupt = TRUE;
+			}
+
+			LLVFSShard::entry_map_t::iterator disk_it = on_disk.find(entry_it->first);
+			if (disk_it == on_disk.end())
+			{
+				LL_WARNS("VFS") << "VFile " << entry_it->first.mFileID << ":" << entry_it->first.mFileType << " in memory, not in index" << LL_ENDL;
+				vfs_corrupt = TRUE;
+			}
+			else if (disk_it->second.mLocation != entry.mLocation
+					 || disk_it->second.mLength != entry.mLength
+					 || disk_it->second.mSize != entry.mSize)
+			{
+				LL_WARNS("VFS") << "VFile " << entry_it->first.mFileID << ":" << entry_it->first.mFileType << " index/memory mismatch" << LL_ENDL;
+				vfs_corrupt = TRUE;
+			}
+			if (disk_it != on_disk.end())
+			{
+				on_disk.erase(disk_it);
+			}
+		}
+
+		if (!on_disk.empty())
+		{
+			LL_WARNS("VFS") << on_disk.size() << " files in " << shard->mIndexFilename << " are not in memory" << LL_ENDL;
+			vfs_corrupt = TRUE;
+		}
+		if (live_bytes + shard->mDeadBytes != shard->mHead)
+		{
+			LL_WARNS("VFS") << "Space accounting mismatch in " << shard->mDataFilename << LL_ENDL;
+			vfs_corrupt = TRUE;
+		}
+	}
+
+	if (vfs_corrupt)
+	{
+		LL_WARNS("VFS") << "VFS corruption detected" << LL_ENDL;
+	}
+	else
+	{
+		LL_INFOS("VFS") << "Index and memory match" << LL_ENDL;
+	}
+}
+
+S32 LLVFSShardStore::getLockCount(EVFSLock lock)
+{
+	S32 count = 0;
+	for (std::vector<LLVFSShard*>::iterator it = mShards.begin(); it != mShards.end(); ++it)
+	{
+		LLMutexLock mutex_lock(&(*it)->mMutex);
+		count += (*it)->mLockCounts[lock];
+	}
+	return count;
+}
+
+void LLVFSShardStore::dumpLockCounts()
+{
+	for (S32 i = 0; i < (S32)VFSLOCK_COUNT; i++)
+	{
+		LL_INFOS() << "LockType: " << i << ": " << getLockCount((EVFSLock)i) << LL_ENDL;
+	}
+}
+
+void LLVFSShardStore::dumpStatistics()
+{
+	std::map<LLAssetType::EType, std::pair<S32,S32> > filetype_counts;
+	U64 total_live = 0;
+	U64 total_dead = 0;
+	U64 total_free = 0;
+	S32 total_files = 0;
+
+	for (U32 i = 0; i < mShards.size(); i++)
+	{
+		LLVFSShard* shard = mShards[i];
+		LLMutexLock lock(&shard->mMutex);
+
+		U32 live_bytes = 0;
+		S32 files = 0;
+		for (LLVFSShard::entry_map_t::iterator it = shard->mEntries.begin(); it != shard->mEntries.end(); ++it)
+		{
+			if (it->second.hasData())
+			{
+				live_bytes += it->second.mLength;
+				files++;
+				filetype_counts[it->first.mFileType].first++;
+				filetype_counts[it->first.mFileType].second += it->second.mLength;
+			}
+		}
+
+		LL_INFOS() << "Shard " << i << ": " << files << " files, "
+				<< (live_bytes >> 10) << "K used, "
+				<< (shard->mDeadBytes >> 10) << "K dead, "
+				<< ((shard->mCapacity - shard->mHead) >> 10) << "K free" << LL_ENDL;
+
+		total_files += files;
+		total_live += live_bytes;
+		total_dead += shard->mDeadBytes;
+		total_free += shard->mCapacity - shard->mHead;
+	}
+
+	LL_INFOS() << "File blocks:     " << total_files << LL_ENDL;
+	LL_INFOS() << "Total file size: " << (total_live >> 10) << "K" << LL_ENDL;
+	LL_INFOS() << "Total dead size: " << (total_dead >> 10) << "K" << LL_ENDL;
+	LL_INFOS() << "Total free size: " << (total_free >> 10) << "K" << LL_ENDL;
+	LL_INFOS() << llformat("%.0f%% full", ((F32)total_live / (F32)llmax(total_live + total_dead + total_free, (U64)1)) * 100.f) << LL_ENDL;
+
+	LL_INFOS() << " " << LL_ENDL;
+	for (std::map<LLAssetType::EType, std::pair<S32,S32> >::iterator iter = filetype_counts.begin();
+		 iter != filetype_counts.end(); ++iter)
+	{
+		LL_INFOS() << "Type: " << LLAssetType::getDesc(iter->first)
+				<< " Count: " << iter->second.first
+				<< " Bytes: " << (iter->second.second>>20) << " MB" << LL_ENDL;
+	}
+}
+
+void LLVFSShardStore::listFiles()
+{
+	for (std::vector<LLVFSShard*>::iterator it = mShards.begin(); it != mShards.end(); ++it)
+	{
+		LLVFSShard* shard = *it;
+		LLMutexLock lock(&shard->mMutex);
+
+		for (LLVFSShard::entry_map_t::iterator entry_it = shard->mEntries.begin(); entry_it != shard->mEntries.end(); ++entry_it)
+		{
+			if (entry_it->second.hasData() && entry_it->second.mSize > 0)
+			{
+				LL_INFOS() << " File: " << entry_it->first.mFileID
+						<< " Type: " << LLAssetType::getDesc(entry_it->first.mFileType)
+						<< " Size: " << entry_it->second.mSize
+						<< LL_ENDL;
+			}
+		}
+	}
+}
+
+void LLVFSShardStore::dumpFiles()
+{
+	S32 files_extracted = 0;
+	for (std::vector<LLVFSShard*>::iterator it = mShards.begin(); it != mShards.end(); ++it)
+	{
+		LLVFSShard* shard = *it;
+		LLMutexLock lock(&shard->mMutex);
+
+		for (LLVFSShard::entry_map_t::iterator entry_it = shard->mEntries.begin(); entry_it != shard->mEntries.end(); ++entry_it)
+		{
+			const LLVFSShardEntry& entry = entry_it->second;
+			if (!entry.hasData() || entry.mSize <= 0)
+			{
+				continue;
+			}
+
+			std::string filename = entry_it->first.mFileID.asString() + get_extension(entry_it->first.mFileType);
+			LL_INFOS() << " Writing " << filename << LL_ENDL;
+
+			// Straight out of the mapping, no intermediate buffer needed
+			LLAPRFile outfile;
+			outfile.open(filename, LL_APR_WB);
+			outfile.write(shard->mData + entry.mLocation, entry.mSize);
+			outfile.close();
+
+			files_extracted++;
+		}
+	}
+
+	LL_INFOS() << "Extracted " << files_extracted << " files" << LL_ENDL;
+}
+
+time_t LLVFSShardStore::creationTime()
+{
+	llstat data_file_stat;
+	if (!mShards.empty() && 0 == LLFile::stat(mShards[0]->mDataFilename, &data_file_stat))
+	{
+		return data_file_stat.st_ctime;
+	}
+	return 0;
+}
@@ -0,0 +1,115 @@
+/**
+ * @file llvfsshard.h
+ * @brief Memory-mapped, hash-sharded backing store for LLVFS
+ *
+ * $LicenseInfo:firstyear=2002&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLVFSSHARD_H
+#define LL_LLVFSSHARD_H
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "llvfs.h"
+
+class LLVFSShard;
+class LLVFSCompactThread;
+
+// Backing store used by LLVFS::createShardedLLVFS().
+//
+// Files are distributed over N shards by UUID hash.  Each shard owns one
+// memory-mapped segment file and one append-only index journal, and is
+// protected by its own mutex, so that readers and writers on different
+// shards never contend.  Space inside a segment is handed out by bumping a
+// head pointer; freed or relocated extents are only accounted as dead bytes
+// and reclaimed during compaction, which only ever runs on a background
+// thread; a shard that runs out of room evicts what it can and asks for one
+// rather than stalling the writer.  Compaction writes a packed copy of the
+// segment and its index beside the originals and renames them into place,
+// so a crash at any point leaves one consistent pair on disk.
+//
+// All entry points mirror the public LLVFS data API and are called through
+// LLVFS, so LLVFile and friends are unaware of which backend is in use.
+class LLVFSShardStore
+{
+public:
+	LLVFSShardStore(const std::string& base_filename,
+					const U32 num_shards,
+					const BOOL read_only,
+					const U32 presize);
+	~LLVFSShardStore();
+
+	EVFSValid getValidState() const	{ return mValid; }
+	BOOL isReadOnly() const			{ return mReadOnly; }
+	U32 getNumShards() const		{ return (U32)mShards.size(); }
+
+	BOOL getExists(const LLUUID &file_id, const LLAssetType::EType file_type);
+	S32	 getSize(const LLUUID &file_id, const LLAssetType::EType file_type);
+	S32  getMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type);
+	BOOL checkAvailable(const LLUUID &file_id, S32 max_size);
+	BOOL setMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type, S32 max_size);
+
+	void renameFile(const LLUUID &file_id, const LLAssetType::EType file_type,
+		const LLUUID &new_id, const LLAssetType::EType &new_type);
+	void removeFile(const LLUUID &file_id, const LLAssetType::EType file_type);
+
+	S32 getData(const LLUUID &file_id, const LLAssetType::EType file_type, U8 *buffer, S32 location, S32 length);
+	S32 storeData(const LLUUID &file_id, const LLAssetType::EType file_type, const U8 *buffer, S32 location, S32 length);
+
+	void incLock(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock);
+	void decLock(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock);
+	BOOL isLocked(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock);
+	// Number of lock references of this type held over all shards
+	S32 getLockCount(EVFSLock lock);
+
+	// Compacts the most fragmented shard, if any is over the dead space
+	// threshold.  Returns TRUE if a shard was compacted.  Called from the
+	// compaction thread.
+	BOOL compactNext();
+	// TRUE if at least one shard would benefit from compaction
+	BOOL needsCompaction();
+
+	void audit();
+	void dumpLockCounts();
+	void dumpStatistics();
+	void listFiles();
+	void dumpFiles();
+	time_t creationTime();
+
+private:
+	LLVFSShard* getShard(const LLUUID &file_id) const;
+	// renameFile() with both shard mutexes held
+	void renameLocked(LLVFSShard* src_shard, LLVFSShard* dst_shard,
+					  const LLUUID &file_id, const LLAssetType::EType file_type,
+					  const LLUUID &new_id, const LLAssetType::EType &new_type);
+
+private:
+	std::vector<LLVFSShard*> mShards;
+	std::unique_ptr<LLVFSCompactThread> mCompactThread;
+	std::string mBaseFilename;
+	BOOL mReadOnly;
+	EVFSValid mValid;
+};
+
+#endif // LL_LLVFSSHARD_H
@@ -0,0 +1,356 @@
+/**
+ * @file llvfsshard_test.cpp
+ * @brief Tests for the sharded LLVFS backing store.
+ *
+ * $LicenseInfo:firstyear=2002&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llvfsshard.h"
+
+#include "llfile.h"
+#include "lluuid.h"
+
+#include "../test/lltut.h"
+
+#include <vector>
+
+namespace
+{
+	const U32 NUM_SHARDS = 2;
+	const S32 SHARD_SIZE = 16 * 1024 * 1024;
+	const S32 FILE_SIZE = 1024 * 1024;
+
+	// A fresh id that LLVFSShardStore puts in shard
+	LLUUID id_in_shard(U32 shard)
+	{
+		LLUUID id;
+		do
+		{
+			id.generate();
+		}
+		while (id.hash() % NUM_SHARDS != shard);
+		return id;
+	}
+
+	std::vector<U8> file_data(const LLUUID& id, S32 size)
+	{
+		std::vector<U8> data(size);
+		for (S32 i = 0; i < size; ++i)
+		{
+			data[i] = id.mData[i % UUID_BYTES] + (U8)(i >> 10);
+		}
+		return data;
+	}
+
+	void write_file(LLVFSShardStore& store, const LLUUID& id, S32 size)
+	{
+		std::vector<U8> data = file_data(id, size);
+		tut::ensure("set max size", store.setMaxSize(id, LLAssetType::AT_TEXTURE, size));
+		tut::ensure_equals("store", store.storeData(id, LLAssetType::AT_TEXTURE, &data[0], 0, size), size);
+	}
+
+	// id holds the bytes write_file() wrote for written_as
+	bool has_file(LLVFSShardStore& store, const LLUUID& id, S32 size, const LLUUID& written_as)
+	{
+		if (!store.getExists(id, LLAssetType::AT_TEXTURE) || store.getSize(id, LLAssetType::AT_TEXTURE) != size)
+		{
+			return false;
+		}
+		std::vector<U8> data(size);
+		return store.getData(id, LLAssetType::AT_TEXTURE, &data[0], 0, size) == size
+			&& data == file_data(written_as, size);
+	}
+
+	bool has_file(LLVFSShardStore& store, const LLUUID& id, S32 size)
+	{
+		return has_file(store, id, size, id);
+	}
+
+	void wait_for_compaction(LLVFSShardStore& store)
+	{
+		// The compaction thread may get there first
+		while (store.needsCompaction())
+		{
+			store.compactNext();
+		}
+	}
+}
+
+namespace tut
+{
+	struct vfsshard
+	{
+		vfsshard()
+		:	mBaseFilename(std::string(LLFile::tmpdir()) + "llvfsshard_test_" + LLUUID::generateNewID().asString())
+		{
+		}
+
+		~vfsshard()
+		{
+			for (U32 i = 0; i < NUM_SHARDS; ++i)
+			{
+				std::string data_filename = filename(i, "data");
+				std::string index_filename = filename(i, "index");
+				LLFile::remove(data_filename, ENOENT);
+				LLFile::remove(data_filename + ".compact", ENOENT);
+				LLFile::remove(index_filename, ENOENT);
+				LLFile::remove(index_filename + ".compact", ENOENT);
+				LLFile::remove(index_filename + ".tmp", ENOENT);
+			}
+		}
+
+		LLVFSShardStore* open()
+		{
+			LLVFSShardStore* store = new LLVFSShardStore(mBaseFilename, NUM_SHARDS, FALSE, NUM_SHARDS * SHARD_SIZE);
+			ensure_equals("valid", (S32)store->getValidState(), (S32)VFSVALID_OK);
+			return store;
+		}
+
+		std::string filename(U32 shard, const char* type) const
+		{
+			return mBaseFilename + llformat(".%02u.", shard) + type;
+		}
+
+		std::string mBaseFilename;
+	};
+
+	typedef test_group<vfsshard> vfsshard_t;
+	typedef vfsshard_t::object vfsshard_object_t;
+	tut::vfsshard_t tut_vfsshard("LLVFSShardStore");
+
+	template<> template<>
+	void vfsshard_object_t::test<1>()
+	{
+		set_test_name("journal replays across a restart");
+
+		LLUUID kept = id_in_shard(0);
+		LLUUID removed = id_in_shard(0);
+		LLUUID last = id_in_shard(0);
+		LLUUID other = id_in_shard(1);
+
+		std::unique_ptr<LLVFSShardStore> store(open());
+		write_file(*store, kept, 5000);
+		write_file(*store, removed, 7000);
+		write_file(*store, last, 3000);
+		write_file(*store, other, 4000);
+		store->removeFile(removed, LLAssetType::AT_TEXTURE);
+		// Moves the file to a new extent, behind the one written after it
+		write_file(*store, kept, 9000);
+		store.reset();
+
+		store.reset(open());
+		ensure("kept", has_file(*store, kept, 9000));
+		ensure("last", has_file(*store, last, 3000));
+		ensure("other shard", has_file(*store, other, 4000));
+		ensure("removed", !store->getExists(removed, LLAssetType::AT_TEXTURE));
+	}
+
+	template<> template<>
+	void vfsshard_object_t::test<2>()
+	{
+		set_test_name("recoverSwap finishes or discards interrupted compactions");
+
+		LLUUID id = id_in_shard(0);
+		std::unique_ptr<LLVFSShardStore> store(open());
+		write_file(*store, id, 20000);
+		store.reset();
+
+		// Crash before the packed segment was renamed into place: both
+		// copies are thrown away and the live pair is used
+		std::string data_filename = filename(0, "data");
+		std::string index_filename = filename(0, "index");
+		LLFILE* fp = LLFile::fopen(data_filename + ".compact", "wb");
+		fputs("partial segment", fp);
+		fclose(fp);
+		fp = LLFile::fopen(index_filename + ".compact", "wb");
+		fputs("partial index", fp);
+		fclose(fp);
+
+		store.reset(open());
+		ensure("data after discarding", has_file(*store, id, 20000));
+		ensure("segment copy removed", !LLFile::isfile(data_filename + ".compact"));
+		ensure("index copy removed", !LLFile::isfile(index_filename + ".compact"));
+		store.reset();
+
+		// Crash after the segment was renamed but before its index was: the
+		// waiting index replaces the stale one
+		ensure("copy index", LLFile::copy(index_filename, index_filename + ".compact"));
+		fp = LLFile::fopen(index_filename, "wb");
+		fputs("stale index from before the swap", fp);
+		fclose(fp);
+
+		store.reset(open());
+		ensure("data after finishing", has_file(*store, id, 20000));
+		ensure("index copy consumed", !LLFile::isfile(index_filename + ".compact"));
+	}
+
+	template<> template<>
+	void vfsshard_object_t::test<3>()
+	{
+		set_test_name("compaction packs live files and survives a restart");
+
+		std::vector<LLUUID> ids;
+		std::unique_ptr<LLVFSShardStore> store(open());
+		for (S32 i = 0; i < SHARD_SIZE / FILE_SIZE; ++i)
+		{
+			ids.push_back(id_in_shard(0));
+			write_file(*store, ids.back(), FILE_SIZE);
+		}
+
+		// A full shard no longer makes room inline, the writer is told no
+		// and the compaction thread catches up
+		store->removeFile(ids[0], LLAssetType::AT_TEXTURE);
+		LLUUID late = id_in_shard(0);
+		ensure("no room before compaction", !store->setMaxSize(late, LLAssetType::AT_TEXTURE, FILE_SIZE));
+		wait_for_compaction(*store);
+		write_file(*store, late, FILE_SIZE);
+
+		// Past the dead space thresholds
+		for (size_t i = 1; i < ids.size(); i += 2)
+		{
+			store->removeFile(ids[i], LLAssetType::AT_TEXTURE);
+		}
+		wait_for_compaction(*store);
+		ensure("no segment copy left", !LLFile::isfile(filename(0, "data") + ".compact"));
+		ensure("no index copy left", !LLFile::isfile(filename(0, "index") + ".compact"));
+
+		for (S32 pass = 0; pass < 2; ++pass)
+		{
+			for (size_t i = 1; i < ids.size(); ++i)
+			{
+				ensure(llformat("file %d pass %d", (S32)i, pass), has_file(*store, ids[i], FILE_SIZE) == (i % 2 == 0));
+			}
+			ensure(llformat("late file pass %d", pass), has_file(*store, late, FILE_SIZE));
+			store.reset();
+			store.reset(open());
+		}
+	}
+
+	template<> template<>
+	void vfsshard_object_t::test<4>()
+	{
+		set_test_name("renames across shards carry data and locks");
+
+		LLUUID src = id_in_shard(0);
+		LLUUID dst = id_in_shard(1);
+		std::unique_ptr<LLVFSShardStore> store(open());
+		write_file(*store, src, 30000);
+		store->incLock(src, LLAssetType::AT_TEXTURE, VFSLOCK_READ);
+
+		store->renameFile(src, LLAssetType::AT_TEXTURE, dst, LLAssetType::AT_TEXTURE);
+		ensure("old name gone", !store->getExists(src, LLAssetType::AT_TEXTURE));
+		ensure("new name", has_file(*store, dst, 30000, src));
+		ensure("lock moved", store->isLocked(dst, LLAssetType::AT_TEXTURE, VFSLOCK_READ));
+		ensure_equals("lock count", store->getLockCount(VFSLOCK_READ), 1);
+		store->decLock(dst, LLAssetType::AT_TEXTURE, VFSLOCK_READ);
+		ensure_equals("unlocked", store->getLockCount(VFSLOCK_READ), 0);
+
+		store.reset();
+		store.reset(open());
+		ensure("renamed after restart", has_file(*store, dst, 30000, src));
+		ensure("old name after restart", !store->getExists(src, LLAssetType::AT_TEXTURE));
+	}
+
+	template<> template<>
+	void vfsshard_object_t::test<5>()
+	{
+		set_test_name("a rename into a full shard loses the data but not the locks");
+
+		LLUUID src = id_in_shard(0);
+		LLUUID filler = id_in_shard(1);
+		LLUUID dst = id_in_shard(1);
+		std::unique_ptr<LLVFSShardStore> store(open());
+
+		// Locked, so it can't be evicted to make room
+		write_file(*store, filler, SHARD_SIZE);
+		store->incLock(filler, LLAssetType::AT_TEXTURE, VFSLOCK_OPEN);
+
+		write_file(*store, src, 30000);
+		store->incLock(src, LLAssetType::AT_TEXTURE, VFSLOCK_READ);
+		store->incLock(src, LLAssetType::AT_TEXTURE, VFSLOCK_READ);
+
+		store->renameFile(src, LLAssetType::AT_TEXTURE, dst, LLAssetType::AT_TEXTURE);
+		ensure("old name gone", !store->getExists(src, LLAssetType::AT_TEXTURE));
+		ensure("no data", !store->getExists(dst, LLAssetType::AT_TEXTURE));
+		ensure("filler kept", has_file(*store, filler, SHARD_SIZE));
+		ensure("lock moved", store->isLocked(dst, LLAssetType::AT_TEXTURE, VFSLOCK_READ));
+		ensure("old name unlocked", !store->isLocked(src, LLAssetType::AT_TEXTURE, VFSLOCK_READ));
+		ensure_equals("lock count", store->getLockCount(VFSLOCK_READ), 2);
+
+		store->decLock(dst, LLAssetType::AT_TEXTURE, VFSLOCK_READ);
+		store->decLock(dst, LLAssetType::AT_TEXTURE, VFSLOCK_READ);
+		ensure_equals("unlocked", store->getLockCount(VFSLOCK_READ), 0);
+		ensure("dummy entry gone", !store->isLocked(dst, LLAssetType::AT_TEXTURE, VFSLOCK_READ));
+
+		store->decLock(filler, LLAssetType::AT_TEXTURE, VFSLOCK_OPEN);
+		ensure_equals("open locks", store->getLockCount(VFSLOCK_OPEN), 0);
+	}
+
+	template<> template<>
+	void vfsshard_object_t::test<6>()
+	{
+		set_test_name("overlapping extents go to the entry journaled last");
+
+		LLUUID stale = id_in_shard(0);
+		LLUUID kept = id_in_shard(0);
+		LLUUID fresh = id_in_shard(0);
+		std::unique_ptr<LLVFSShardStore> store(open());
+		write_file(*store, stale, 4096);
+		write_file(*store, kept, 4096);
+		store.reset();
+
+		// As if fresh had reused stale's extent but the removal of stale
+		// never reached the journal
+		std::vector<U8> data = file_data(fresh, 2048);
+		LLFILE* fp = LLFile::fopen(filename(0, "data"), "r+b");
+		fwrite(&data[0], data.size(), 1, fp);
+		fclose(fp);
+
+		U8 record[34];
+		U32 location = 0;
+		S32 length = 2048;
+		U32 access_time = (U32)time(nullptr);
+		S16 type = LLAssetType::AT_TEXTURE;
+		memcpy(record, &location, 4);
+		memcpy(record + 4, &length, 4);
+		memcpy(record + 8, &access_time, 4);
+		memcpy(record + 12, fresh.mData, 16);
+		memcpy(record + 28, &type, 2);
+		memcpy(record + 30, &length, 4);
+		fp = LLFile::fopen(filename(0, "index"), "ab");
+		fwrite(record, sizeof(record), 1, fp);
+		fclose(fp);
+
+		store.reset(open());
+		ensure("journaled last", has_file(*store, fresh, 2048));
+		ensure("overlapped", !store->getExists(stale, LLAssetType::AT_TEXTURE));
+		ensure("untouched", has_file(*store, kept, 4096));
+
+		// The dropped entry stays dropped
+		store.reset();
+		store.reset(open());
+		ensure("journaled last after rewrite", has_file(*store, fresh, 2048));
+		ensure("overlapped after rewrite", !store->getExists(stale, LLAssetType::AT_TEXTURE));
+	}
+}
@@ -41,6 +41,7 @@
 #include <curl/curl.h>
 
 #include "llcorehttputil.h"
+#include "bufferarray.h"
 
 // Here is where we begin to get our connection usage under control.
 // This establishes llcorehttp policy classes that, among other
@@ -60,62 +61,63 @@ static const struct
 	U32							mMax;
 	U32							mRate;
 	bool						mPipelined;
+	bool						mMultiplexed;
 	std::string					mKey;
 	const char *				mUsage;
 } init_data[LLAppCoreHttp::AP_COUNT] =
 {
 	{ // AP_DEFAULT
-		8,		8,		8,		0,		false,
+		8,		8,		8,		0,		false,		false,
 		"",
 		"other"
 	},
 	{ // AP_ASSET
-		12,		1,		16,		0,		true,
+		12,		1,		16,		0,		true,		false,
 		"AssetFetchConcurrency",
 		"asset fetch"
 	},
 	{ // AP_TEXTURE
-		12,		1,		16,		0,		true,
+		12,		1,		16,		0,		true,		true,
 		"TextureFetchConcurrency",
 		"texture fetch"
 	},
 	{ // AP_MESH1
-		32,		1,		128,	0,		false,
+		32,		1,		128,	0,		false,		true,
 		"MeshMaxConcurrentRequests",
 		"mesh fetch"
 	},
 	{ // AP_MESH2
-		8,		1,		32,		0,		true,	
+		8,		1,		32,		0,		true,		true,	
 		"Mesh2MaxConcurrentRequests",
 		"mesh2 fetch"
 	},
 	{ // AP_LARGE_MESH
-		2,		1,		8,		0,		false,
+		2,		1,		8,		0,		false,		true,
 		"",
 		"large mesh fetch"
 	},
 	{ // AP_UPLOADS 
-		2,		1,		8,		0,		false,
+		2,		1,		8,		0,		false,		false,
 		"",
 		"asset upload"
 	},
 	{ // AP_LONG_POLL
-		32,		32,		32,		0,		false,
+		32,		32,		32,		0,		false,		false,
 		"",
 		"long poll"
 	},
 	{ // AP_INVENTORY
-		4,		1,		4,		0,		false,
+		4,		1,		4,		0,		false,		false,
 		"",
 		"inventory"
 	},
 	{ // AP_MATERIALS
-		2,		1,		8,		0,		false,
+		2,		1,		8,		0,		false,		false,
 		"RenderMaterials",
 		"material manager requests"
 	},
 	{ // AP_AGENT
-		2,		1,		32,		0,		false,
+		2,		1,		32,		0,		false,		false,
 		"Agent",
 		"Agent requests"
 	}
@@ -235,6 +237,46 @@ void LLAppCoreHttp::init()
 		}
 	}
 
+	// Move bulk downloads onto transport threads of their own so they
+	// don't hold up capability and inventory traffic.  Must be done
+	// before the service starts.
+	static const struct
+	{
+		EAppPolicy	mPolicy;
+		long		mThread;
+	} transport_threads[] =
+	{
+		{ AP_TEXTURE,		1 },
+		{ AP_MESH1,			2 },
+		{ AP_MESH2,			2 },
+		{ AP_LARGE_MESH,	2 },
+		{ AP_ASSET,			2 }
+	};
+	const long thread_count(gSavedSettings.getU32("HttpTransportThreads"));
+	for (int i(0); thread_count && i < LL_ARRAY_SIZE(transport_threads); ++i)
+	{
+		const EAppPolicy app_policy(transport_threads[i].mPolicy);
+		if (mHttpClasses[app_policy].mPolicy == mHttpClasses[AP_DEFAULT].mPolicy)
+		{
+			// Fell back to the default class, leave it alone
+			continue;
+		}
+
+		status = LLCore::HttpRequest::setStaticPolicyOption(LLCore::HttpRequest::PO_TRANSPORT_THREAD,
+															mHttpClasses[app_policy].mPolicy,
+															llmin(transport_threads[i].mThread, thread_count),
+															nullptr);
+		if (! status)
+		{
+			LL_WARNS("Init") << "Unable to move HTTP policy class for " << init_data[app_policy].mUsage
+							 << " to a transport thread.  Reason:  " << status.toString()
+							 << LL_ENDL;
+		}
+	}
+
+	// Response bodies recycle their storage through a shared pool
+	LLCore::BufferArray::setSlabPoolLimit(size_t(gSavedSettings.getU32("HttpBodySlabPoolSize")) * 1024 * 1024);
+
 	// Need a request object to handle dynamic options before setting them
 	mRequest = new LLCore::HttpRequest;
 
@@ -354,6 +396,14 @@ void LLAppCoreHttp::cleanup()
 	delete mRequest;
 	mRequest = nullptr;
 
+	LLCore::BufferArray::SlabStats slab_stats;
+	LLCore::BufferArray::getSlabStats(slab_stats);
+	LL_INFOS("Cleanup") << "HTTP body slabs used:  " << slab_stats.mSlabAllocs
+						<< ", reused:  " << slab_stats.mPoolHits
+						<< ", bodies adopted:  " << slab_stats.mAdopted
+						<< " (" << slab_stats.mAdoptedBytes << " bytes)"
+						<< LL_ENDL;
+
 	LLCore::HttpStatus status = LLCore::HttpRequest::destroyService();
 	if (! status)
 	{
@@ -385,6 +435,14 @@ void LLAppCoreHttp::refreshSettings(bool initial)
         LL_INFOS("Init") << "HTTP Pipelining " << (mPipelined ? "enabled" : "disabled") << "!" << LL_ENDL;
 	}
 	
+	// Concurrent streams for classes allowed onto HTTP/2
+	static const std::string http2_streams_key("HttpHTTP2Streams");
+	long http2_streams(0L);
+	if (initial && gSavedSettings.controlExists(http2_streams_key))
+	{
+		http2_streams = long(gSavedSettings.getU32(http2_streams_key));
+	}
+	
 	for (int i(0); i < LL_ARRAY_SIZE(init_data); ++i)
 	{
 		const EAppPolicy app_policy(static_cast<EAppPolicy>(i));
@@ -393,6 +451,21 @@ void LLAppCoreHttp::refreshSettings(bool initial)
 		{
 			// Init-time only settings, can use the static setters here
 
+			if (init_data[i].mMultiplexed && http2_streams)
+			{
+				// HTTP/2 where the server offers it
+				status = LLCore::HttpRequest::setStaticPolicyOption(LLCore::HttpRequest::PO_HTTP2_STREAMS,
+																	mHttpClasses[app_policy].mPolicy,
+																	http2_streams,
+																	nullptr);
+				if (! status)
+				{
+					LL_WARNS("Init") << "Unable to set " << init_data[i].mUsage
+									 << " HTTP/2 streams.  Reason:  " << status.toString()
+									 << LL_ENDL;
+				}
+			}
+
 			if (init_data[i].mRate)
 			{
 				// Set any desired throttle
@@ -51,6 +51,7 @@
 #include "llmarketplacefunctions.h"
 #include "llmarketplacenotifications.h"
 #include "llmd5.h"
+#include "llmeshdecodedcache.h"
 #include "llmeshrepository.h"
 #include "llpumpio.h"
 #include "llmimetypes.h"
@@ -443,6 +444,7 @@ void init_default_trans_args()
 // File scope definitons
 const char *VFS_DATA_FILE_BASE = "data.db2.x.";
 const char *VFS_INDEX_FILE_BASE = "index.db2.x.";
+const char *VFS_SHARD_FILE_BASE = "vfs_shard";
 
 
 struct SettingsFile : public LLInitParam::Block<SettingsFile>
@@ -2194,7 +2196,8 @@ bool LLAppViewer::initThreads()
 	LLLFSThread::initClass(enable_threads && false);
 
 	// Image decoding
-	LLAppViewer::sImageDecodeThread = new LLImageDecodeThread(enable_threads && true);
+	LLAppViewer::sImageDecodeThread = new LLImageDecodeThread(enable_threads && true,
+															  gSavedSettings.getU32("ImageDecodeThreads"));
 	LLAppViewer::sTextureCache = new LLTextureCache(enable_threads && true);
 	LLAppViewer::sTextureFetch = new LLTextureFetch(LLAppViewer::getTextureCache(),
 													sImageDecodeThread,
@@ -2813,6 +2816,8 @@ bool LLAppViewer::initConfiguration()
 	//LLVolumeMgr::initClass();
 	LLVolumeMgr* volume_manager = new LLVolumeMgr();
 	volume_manager->useMutex();	// LLApp and LLMutex magic must be manually enabled
+	volume_manager->startBuildThreads(gSavedSettings.getU32("RenderVolumeBuildThreads"));
+	volume_manager->setRetentionBudget(gSavedSettings.getU32("RenderVolumeRetainedMB") * 1024 * 1024);
 	LLPrimitive::setVolumeManager(volume_manager);
 
 	// Note: this is where we used to initialize gFeatureManagerp.
@@ -4438,7 +4443,7 @@ U32 LLAppViewer::getObjectCacheVersion()
 {
 	// Viewer object cache version, change if object update
 	// format changes. JC
-	const U32 INDRA_OBJECT_CACHE_VERSION = 14;
+	const U32 INDRA_OBJECT_CACHE_VERSION = 15;
 
 	return INDRA_OBJECT_CACHE_VERSION;
 }
@@ -4649,11 +4654,32 @@ bool LLAppViewer::initCache()
 	// Startup the VFS...
 	gSavedSettings.setU32("VFSSalt", new_salt);
 
+	U32 vfs_shard_count = gSavedSettings.getU32("VFSShardCount");
+	if (vfs_shard_count)
+	{
+		std::string shard_base = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, VFS_SHARD_FILE_BASE);
+		gVFS = LLVFS::createShardedLLVFS(shard_base, vfs_shard_count, false, vfs_size_u32);
+		if (gVFS)
+		{
+			// The monolithic files are dead weight once the sharded store is in use
+			LLFile::remove(new_vfs_data_file, ENOENT);
+			LLFile::remove(new_vfs_index_file, ENOENT);
+		}
+		else
+		{
+			// Most likely another viewer instance holds the shard locks
+			LL_WARNS("AppCache") << "Unable to open sharded VFS, falling back to " << new_vfs_data_file << LL_ENDL;
+		}
+	}
+
 	// Don't remove VFS after viewer crashes.  If user has corrupt data, they can reinstall. JC
-	gVFS = LLVFS::createLLVFS(new_vfs_index_file, new_vfs_data_file, false, vfs_size_u32, false);
 	if (!gVFS)
 	{
-		return false;
+		gVFS = LLVFS::createLLVFS(new_vfs_index_file, new_vfs_data_file, false, vfs_size_u32, false);
+		if (!gVFS)
+		{
+			return false;
+		}
 	}
 
 	gStaticVFS = LLVFS::createLLVFS(static_vfs_index_file, static_vfs_data_file, true, 0, false);
@@ -4692,6 +4718,7 @@ void LLAppViewer::purgeCache()
 	LL_INFOS("AppCache") << "Purging Cache and Texture Cache..." << LL_ENDL;
 	LLAppViewer::getTextureCache()->purgeCache(LL_PATH_CACHE);
 	LLVOCache::getInstance()->removeCache(LL_PATH_CACHE);
+	LLMeshDecodedCache::removeCache();
 	std::string browser_cache = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "cef_cache");
 	if (LLFile::isdir(browser_cache))
 	{
@@ -5560,12 +5587,20 @@ void LLAppViewer::idleNetwork()
 #endif
 		}
 
+		// Apply the object cache updates decoded while we were reading
+		gObjectList.flushObjectUpdates();
+
 		// Handle per-frame message system processing.
         static LLCachedControl<F32> sAckCollectTime(gSavedSettings, "AckCollectTime", 0.1f);
 		gMessageSystem->processAcks(sAckCollectTime);
 
 #ifdef TIME_THROTTLE_MESSAGES
-		if (total_time >= CheckMessagesMaxTime)
+		// With the receive thread reading the socket, packets wait in its
+		// ring rather than the kernel's, so only stretch the frame when
+		// that ring is filling up.
+		if (total_time >= CheckMessagesMaxTime
+			&& (!gMessageSystem->mPacketRing.hasReceiveThread()
+				|| gMessageSystem->mPacketRing.isReceiveBacklogged()))
 		{
 			// Increase CheckMessagesMaxTime so that we will eventually catch up
 			CheckMessagesMaxTime *= 1.035f; // 3.5% ~= x2 in 20 frames, ~8x in 60 frames
@@ -5596,6 +5631,11 @@ void LLAppViewer::idleNetwork()
 			gPrintMessagesThisFrame = FALSE;
 		}
 	}
+	else
+	{
+		// processAcks() didn't run, send anything batched this frame
+		gMessageSystem->flushSends();
+	}
 	add(LLStatViewer::NUM_NEW_OBJECTS, gObjectList.mNumNewObjects);
 
 	// Retransmit unacknowledged packets.
@@ -30,6 +30,7 @@
 
 #include "lldrawable.h" // lldrawable needs to be included before llface
 #include "llface.h"
+#include "llfacegeometryjobs.h"
 #include "llviewertextureanim.h"
 
 #include "llviewercontrol.h"
@@ -749,49 +750,6 @@ static void xform(LLVector2 &tex_coord, F32 cosAng, F32 sinAng, F32 offS, F32 of
 	tex_coord.mV[1] = t;
 }
 
-// Transform the texture coordinates for this face.
-static void xform4a(LLVector4a &tex_coord, const LLVector4a& trans, const LLVector4Logical& mask, const LLVector4a& rot0, const LLVector4a& rot1, const LLVector4a& offset, const LLVector4a& scale) 
-{
-	//tex coord is two coords, <s0, t0, s1, t1>
-	LLVector4a st;
-
-	// Texture transforms are done about the center of the face.
-	st.setAdd(tex_coord, trans);
-	
-	// Handle rotation
-	LLVector4a rot_st;
-		
-	// <s0 * cosAng, s0*-sinAng, s1*cosAng, s1*-sinAng>
-	LLVector4a s0;
-	s0.splat(st, 0);
-	LLVector4a s1;
-	s1.splat(st, 2);
-	LLVector4a ss;
-	ss.setSelectWithMask(mask, s1, s0);
-
-	LLVector4a a; 
-	a.setMul(rot0, ss);
-	
-	// <t0*sinAng, t0*cosAng, t1*sinAng, t1*cosAng>
-	LLVector4a t0;
-	t0.splat(st, 1);
-	LLVector4a t1;
-	t1.splat(st, 3);
-	LLVector4a tt;
-	tt.setSelectWithMask(mask, t1, t0);
-
-	LLVector4a b;
-	b.setMul(rot1, tt);
-		
-	st.setAdd(a,b);
-
-	// Then scale
-	st.mul(scale);
-
-	// Then offset
-	tex_coord.setAdd(st, offset);
-}
-
 
 bool less_than_max_mag(const LLVector4a& vec)
 {
@@ -1175,7 +1133,6 @@ static LLTrace::BlockTimerStatHandle FTM_FACE_GEOM_FEEDBACK_EMISSIVE("Feedback
 static LLTrace::BlockTimerStatHandle FTM_FACE_GEOM_FEEDBACK_BINORMAL("Feedback Binormal");
 
 static LLTrace::BlockTimerStatHandle FTM_FACE_GEOM_INDEX("Index");
-static LLTrace::BlockTimerStatHandle FTM_FACE_GEOM_INDEX_TAIL("Tail");
 static LLTrace::BlockTimerStatHandle FTM_FACE_POSITION_STORE("Pos");
 static LLTrace::BlockTimerStatHandle FTM_FACE_TEXTURE_INDEX_STORE("TexIdx");
 static LLTrace::BlockTimerStatHandle FTM_FACE_POSITION_PAD("Pad");
@@ -1185,11 +1142,34 @@ static LLTrace::BlockTimerStatHandle FTM_FACE_TEX_QUICK_NO_XFORM("No Xform");
 static LLTrace::BlockTimerStatHandle FTM_FACE_TEX_QUICK_XFORM("Xform");
 static LLTrace::BlockTimerStatHandle FTM_FACE_TEX_QUICK_PLANAR("Quick Planar");
 
+static void run_geometry_job(const LLFaceGeometryJob& job, LLFaceGeometryBatch* batch)
+{
+	if (batch)
+	{
+		batch->add(job);
+	}
+	else
+	{
+		job.run();
+	}
+}
+
+static void set_tex_xform(LLFaceGeometryJob& job, F32 cos_ang, F32 sin_ang, F32 os, F32 ot, F32 ms, F32 mt)
+{
+	job.mTexCos = cos_ang;
+	job.mTexSin = sin_ang;
+	job.mTexOffsetS = os;
+	job.mTexOffsetT = ot;
+	job.mTexScaleS = ms;
+	job.mTexScaleT = mt;
+}
+
 BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 							   const S32 &f,
 								const LLMatrix4& mat_vert_in, const LLMatrix3& mat_norm_in,
 								const U16 &index_offset,
-								bool force_rebuild)
+								bool force_rebuild,
+								LLFaceGeometryBatch* batch)
 {
 	LL_RECORD_BLOCK_TIME(FTM_FACE_GET_GEOM);
 	llassert(verify());
@@ -1320,27 +1300,12 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 		LL_RECORD_BLOCK_TIME(FTM_FACE_GEOM_INDEX);
 		mVertexBuffer->getIndexStrider(indicesp, mIndicesIndex, mIndicesCount, map_range);
 
-		volatile __m128i* dst = (__m128i*) indicesp.get();
-		__m128i* src = (__m128i*) vf.mIndices;
-		__m128i offset = _mm_set1_epi16(index_offset);
-
-		S32 end = num_indices/8;
-		
-		for (S32 i = 0; i < end; i++)
-		{
-			__m128i res = _mm_add_epi16(src[i], offset);
-			_mm_storeu_si128((__m128i*) dst++, res);
-		}
-
-		{
-			LL_RECORD_BLOCK_TIME(FTM_FACE_GEOM_INDEX_TAIL);
-			U16* idx = (U16*) dst;
-
-			for (S32 i = end*8; i < num_indices; ++i)
-			{
-				*idx++ = vf.mIndices[i]+index_offset;
-			}
-		}
+		LLFaceGeometryJob job(LLFaceGeometryJob::INDICES);
+		job.mCount = num_indices;
+		job.mSrc = vf.mIndices;
+		job.mDst = indicesp.get();
+		job.mIndexOffset = index_offset;
+		run_geometry_job(job, batch);
 
 		if (map_range)
 		{
@@ -1517,47 +1482,23 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 					LL_RECORD_BLOCK_TIME(FTM_FACE_TEX_QUICK);
 					if (!do_tex_mat)
 					{
+						LLFaceGeometryJob job(LLFaceGeometryJob::TEXCOORDS);
+						job.mCount = num_vertices;
+						job.mSrc = vf.mTexCoords;
+						job.mDst = tex_coords0.get();
+
 						if (!do_xform)
 						{
 							LL_RECORD_BLOCK_TIME(FTM_FACE_TEX_QUICK_NO_XFORM);
-							S32 tc_size = (num_vertices*2*sizeof(F32)+0xF) & ~0xF;
-							LLVector4a::memcpyNonAliased16((F32*) tex_coords0.get(), (F32*) vf.mTexCoords, tc_size);
+							job.mTexGen = LLFaceGeometryJob::TEX_COPY;
+							run_geometry_job(job, batch);
 						}
 						else
 						{
 							LL_RECORD_BLOCK_TIME(FTM_FACE_TEX_QUICK_XFORM);
-							F32* dst = (F32*) tex_coords0.get();
-							LLVector4a* src = (LLVector4a*) vf.mTexCoords;
-
-							LLVector4a trans;
-							trans.splat(-0.5f);
-
-							LLVector4a rot0;
-							rot0.set(cos_ang, -sin_ang, cos_ang, -sin_ang);
-
-							LLVector4a rot1;
-							rot1.set(sin_ang, cos_ang, sin_ang, cos_ang);
-
-							LLVector4a scale;
-							scale.set(ms, mt, ms, mt);
-
-							LLVector4a offset;
-							offset.set(os+0.5f, ot+0.5f, os+0.5f, ot+0.5f);
-
-							LLVector4Logical mask;
-							mask.clear();
-							mask.setElement<2>();
-							mask.setElement<3>();
-
-							U32 count = num_vertices/2 + num_vertices%2;
-
-							for (S32 i = 0; i < count; i++)
-							{	
-								LLVector4a res = *src++;
-								xform4a(res, trans, mask, rot0, rot1, offset, scale);
-								res.store4a(dst);
-								dst += 4;
-							}
+							job.mTexGen = LLFaceGeometryJob::TEX_XFORM;
+							set_tex_xform(job, cos_ang, sin_ang, os, ot, ms, mt);
+							run_geometry_job(job, batch);
 						}
 					}
 					else
@@ -1600,19 +1541,15 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 					}
 					else
 					{
-						for (S32 i = 0; i < num_vertices; i++)
-						{	
-							LLVector2 tc(vf.mTexCoords[i]);
-							LLVector4a& norm = vf.mNormals[i];
-							LLVector4a& center = *(vf.mCenter);
-							LLVector4a vec = vf.mPositions[i];	
-							vec.mul(scalea);
-							planarProjection(tc, norm, center, vec);
-						
-							xform(tc, cos_ang, sin_ang, os, ot, ms, mt);
-
-							*tex_coords0++ = tc;	
-						}
+						LLFaceGeometryJob job(LLFaceGeometryJob::TEXCOORDS);
+						job.mCount = num_vertices;
+						job.mDst = tex_coords0.get();
+						job.mTexGen = LLFaceGeometryJob::TEX_PLANAR;
+						job.mPositions = vf.mPositions;
+						job.mNormals = vf.mNormals;
+						job.mScale = scale;
+						set_tex_xform(job, cos_ang, sin_ang, os, ot, ms, mt);
+						run_geometry_job(job, batch);
 					}
 				}
 
@@ -1681,7 +1618,28 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 							}
 							break;
 					}
-					
+
+					if (!do_bump && !(tex_mode && mTextureMatrix))
+					{ //no bump offsets or texture matrix, same kernels as the quick path
+						LLFaceGeometryJob job(LLFaceGeometryJob::TEXCOORDS);
+						job.mCount = num_vertices;
+						job.mSrc = vf.mTexCoords;
+						job.mDst = dst.get();
+						if (texgen == LLTextureEntry::TEX_GEN_PLANAR)
+						{
+							job.mTexGen = LLFaceGeometryJob::TEX_PLANAR;
+							job.mPositions = vf.mPositions;
+							job.mNormals = vf.mNormals;
+							job.mScale = scale;
+						}
+						else
+						{
+							job.mTexGen = LLFaceGeometryJob::TEX_XFORM;
+						}
+						set_tex_xform(job, cos_ang, sin_ang, os, ot, ms, mt);
+						run_geometry_job(job, batch);
+						continue;
+					}
 
 				for (S32 i = 0; i < num_vertices; i++)
 				{	
@@ -1774,98 +1732,22 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 
 		if (rebuild_pos)
 		{
-			LLVector4a* src = vf.mPositions;
-			
-			//_mm_prefetch((char*)src, _MM_HINT_T0);
-
-			LLVector4a* end = src+num_vertices;
-			//LLVector4a* end_64 = end-4;
-
 			//LL_RECORD_BLOCK_TIME(FTM_FACE_GEOM_POSITION);
 			llassert(num_vertices > 0);
 		
 			mVertexBuffer->getVertexStrider(vert, mGeomIndex, mGeomCount, map_range);
 			
-			LLMatrix4a mat_vert;
-			mat_vert.loadu(mat_vert_in);
-
-			F32* dst = (F32*) vert.get();
-			F32* end_f32 = dst+mGeomCount*4;
-
-			//_mm_prefetch((char*)dst, _MM_HINT_NTA);
-			//_mm_prefetch((char*)src, _MM_HINT_NTA);
-				
-			//_mm_prefetch((char*)dst, _MM_HINT_NTA);
-
-
-			LLVector4a res0; //,res1,res2,res3;
-
-			LLVector4a texIdx;
-
 			S32 index = mTextureIndex < 255 ? mTextureIndex : 0;
-
-			F32 val = 0.f;
-			S32* vp = (S32*) &val;
-			*vp = index;
-			
 			llassert(index <= LLGLSLShader::sIndexedTextureChannels-1);
 
-			LLVector4Logical mask;
-			mask.clear();
-			mask.setElement<3>();
-		
-			texIdx.set(0,0,0,val);
-
-			LLVector4a tmp;
-
-			{
-				//LL_RECORD_BLOCK_TIME(FTM_FACE_POSITION_STORE);
-
-				/*if (num_vertices > 4)
-				{ //more than 64 bytes
-					while (src < end_64)
-					{	
-						_mm_prefetch((char*)src + 64, _MM_HINT_T0);
-						_mm_prefetch((char*)dst + 64, _MM_HINT_T0);
-
-						mat_vert.affineTransform(*src, res0);
-						tmp.setSelectWithMask(mask, texIdx, res0);
-						tmp.store4a((F32*) dst);
-
-						mat_vert.affineTransform(*(src+1), res1);
-						tmp.setSelectWithMask(mask, texIdx, res1);
-						tmp.store4a((F32*) dst+4);
-
-						mat_vert.affineTransform(*(src+2), res2);
-						tmp.setSelectWithMask(mask, texIdx, res2);
-						tmp.store4a((F32*) dst+8);
-
-						mat_vert.affineTransform(*(src+3), res3);
-						tmp.setSelectWithMask(mask, texIdx, res3);
-						tmp.store4a((F32*) dst+12);
-
-						dst += 16;
-						src += 4;
-					}
-				}*/
-
-				while (src < end)
-				{	
-					mat_vert.affineTransform(*src++, res0);
-					tmp.setSelectWithMask(mask, texIdx, res0);
-					tmp.store4a((F32*) dst);
-					dst += 4;
-				}
-			}
-
-			{
-				//LL_RECORD_BLOCK_TIME(FTM_FACE_POSITION_PAD);
-				while (dst < end_f32)
-				{
-					res0.store4a((F32*) dst);
-					dst += 4;
-				}
-			}
+			LLFaceGeometryJob job(LLFaceGeometryJob::POSITIONS);
+			job.mCount = num_vertices;
+			job.mSrc = vf.mPositions;
+			job.mDst = vert.get();
+			job.mDstEnd = (F32*) vert.get() + mGeomCount*4;
+			job.mVertexMatrix = mat_vert_in;
+			job.mTextureIndex = index;
+			run_geometry_job(job, batch);
 
 			if (map_range)
 			{
@@ -1878,17 +1760,13 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 		{
 			//LL_RECORD_BLOCK_TIME(FTM_FACE_GEOM_NORMAL);
 			mVertexBuffer->getNormalStrider(norm, mGeomIndex, mGeomCount, map_range);
-			F32* normals = (F32*) norm.get();
-			LLVector4a* src = vf.mNormals;
-			LLVector4a* end = src+num_vertices;
-			
-			while (src < end)
-			{	
-				LLVector4a normal;
-				mat_normal.rotate(*src++, normal);
-				normal.store4a(normals);
-				normals += 4;
-			}
+
+			LLFaceGeometryJob job(LLFaceGeometryJob::NORMALS);
+			job.mCount = num_vertices;
+			job.mSrc = vf.mNormals;
+			job.mDst = norm.get();
+			job.mNormalMatrix = mat_norm_in;
+			run_geometry_job(job, batch);
 
 			if (map_range)
 			{
@@ -1943,10 +1821,11 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 			LL_RECORD_BLOCK_TIME(FTM_FACE_GEOM_WEIGHTS);
 			mVertexBuffer->getWeight4Strider(wght, mGeomIndex, mGeomCount, map_range);
 
-			for (S32 i = 0; i < num_vertices; ++i)
-			{
-				*(wght++) = vf.mWeights[i];
-			}
+			LLFaceGeometryJob job(LLFaceGeometryJob::WEIGHTS);
+			job.mCount = num_vertices;
+			job.mSrc = vf.mWeights;
+			job.mDst = wght.get();
+			run_geometry_job(job, batch);
 
 			if (map_range)
 			{
@@ -1959,25 +1838,11 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 			LL_RECORD_BLOCK_TIME(FTM_FACE_GEOM_COLOR);
 			mVertexBuffer->getColorStrider(colors, mGeomIndex, mGeomCount, map_range);
 
-			LLVector4a src;
-
-			U32 vec[4];
-			vec[0] = vec[1] = vec[2] = vec[3] = color.mAll;
-		
-			src.loadua((F32*) vec);
-
-			F32* dst = (F32*) colors.get();
-			S32 num_vecs = num_vertices/4;
-			if (num_vertices%4 > 0)
-			{
-				++num_vecs;
-			}
-
-			for (S32 i = 0; i < num_vecs; i++)
-			{	
-				src.store4a(dst);
-				dst += 4;
-			}
+			LLFaceGeometryJob job(LLFaceGeometryJob::FILL);
+			job.mCount = num_vertices;
+			job.mDst = colors.get();
+			job.mFillValue = color.mAll;
+			run_geometry_job(job, batch);
 
 			if (map_range)
 			{
@@ -1993,30 +1858,13 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 
 			U8 glow = (U8) llclamp((S32) (getTextureEntry()->getGlow()*255), 0, 255);
 
-			LLVector4a src;
-
-		
 			LLColor4U glow4u = LLColor4U(0,0,0,glow);
 
-			U32 glow32 = glow4u.mAll;
-
-			U32 vec[4];
-			vec[0] = vec[1] = vec[2] = vec[3] = glow32;
-		
-			src.loadua((F32*) vec);
-
-			F32* dst = (F32*) emissive.get();
-			S32 num_vecs = num_vertices/4;
-			if (num_vertices%4 > 0)
-			{
-				++num_vecs;
-			}
-
-			for (S32 i = 0; i < num_vecs; i++)
-			{	
-				src.store4a(dst);
-				dst += 4;
-			}
+			LLFaceGeometryJob job(LLFaceGeometryJob::FILL);
+			job.mCount = num_vertices;
+			job.mDst = emissive.get();
+			job.mFillValue = glow4u.mAll;
+			run_geometry_job(job, batch);
 
 			if (map_range)
 			{
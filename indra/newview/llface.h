@@ -48,6 +48,7 @@ class LLVertexProgram;
 class LLViewerTexture;
 class LLGeometryManager;
 class LLDrawInfo;
+class LLFaceGeometryBatch;
 
 const F32 MIN_ALPHA_SIZE = 1024.f;
 const F32 MIN_TEX_ANIM_SIZE = 512.f;
@@ -161,11 +162,14 @@ public:
 	//for volumes
 	void updateRebuildFlags();
 	bool canRenderAsMask(); // logic helper
+	// If batch is set, the bulk vertex streams are added to it and are not
+	// written until LLFaceGeometryQueue::run() has run it.
 	BOOL getGeometryVolume(const LLVolume& volume,
 						const S32 &f,
 						const LLMatrix4& mat_vert, const LLMatrix3& mat_normal,
 						const U16 &index_offset,
-						bool force_rebuild = false);
+						bool force_rebuild = false,
+						LLFaceGeometryBatch* batch = NULL);
 
 	// For avatar
 	U16			 getGeometryAvatar(
@@ -0,0 +1,614 @@
+/**
+ * @file llfacegeometryjobs.cpp
+ * @brief Builds face vertex data on worker threads.
+ *
+ * $LicenseInfo:firstyear=2001&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llfacegeometryjobs.h"
+
+#include "llmath.h"
+#include "llmatrix4a.h"
+#include "v2math.h"
+
+// Jobs a thread takes each time it goes to the queue.  Batches this small
+// or smaller are run on the main thread.
+const U32 JOBS_PER_CLAIM = 16;
+
+LLFaceGeometryJob::LLFaceGeometryJob(EType type)
+:	mType(type),
+	mCount(0),
+	mSrc(nullptr),
+	mDst(nullptr),
+	mDstEnd(nullptr),
+	mIndexOffset(0),
+	mTextureIndex(0),
+	mFillValue(0),
+	mTexGen(TEX_COPY),
+	mPositions(nullptr),
+	mNormals(nullptr),
+	mTexCos(1.f),
+	mTexSin(0.f),
+	mTexOffsetS(0.f),
+	mTexOffsetT(0.f),
+	mTexScaleS(1.f),
+	mTexScaleT(1.f)
+{
+}
+
+// The loops below do the same math, in the same order, as the per vertex
+// loops LLFace::getGeometryVolume() used to run inline, just several
+// vertices at a time, so the output doesn't depend on where they run.
+void LLFaceGeometryJob::run() const
+{
+	switch (mType)
+	{
+	case INDICES:
+		{
+			volatile __m128i* dst = (__m128i*) mDst;
+			const __m128i* src = (const __m128i*) mSrc;
+			__m128i offset = _mm_set1_epi16(mIndexOffset);
+
+			S32 end = mCount/8;
+
+			for (S32 i = 0; i < end; i++)
+			{
+				__m128i res = _mm_add_epi16(src[i], offset);
+				_mm_storeu_si128((__m128i*) dst++, res);
+			}
+
+			U16* idx = (U16*) dst;
+			const U16* src_idx = (const U16*) mSrc;
+
+			for (S32 i = end*8; i < mCount; ++i)
+			{
+				*idx++ = src_idx[i]+mIndexOffset;
+			}
+		}
+		break;
+
+	case POSITIONS:
+		{
+			const LLVector4a* src = (const LLVector4a*) mSrc;
+			const LLVector4a* end = src+mCount;
+
+			LLMatrix4a mat_vert;
+			mat_vert.loadu(mVertexMatrix);
+
+			F32* dst = (F32*) mDst;
+			F32* end_f32 = (F32*) mDstEnd;
+
+			LLVector4a res0;
+
+			F32 val = 0.f;
+			S32* vp = (S32*) &val;
+			*vp = mTextureIndex;
+
+			LLVector4Logical mask;
+			mask.clear();
+			mask.setElement<3>();
+
+			LLVector4a texIdx;
+			texIdx.set(0,0,0,val);
+
+			LLVector4a tmp;
+
+			// Four independent transforms per iteration keep the pipeline full
+			const LLVector4a* end_4 = src + (mCount & ~3);
+			while (src < end_4)
+			{
+				LLVector4a res1, res2, res3;
+				mat_vert.affineTransform(src[0], res0);
+				mat_vert.affineTransform(src[1], res1);
+				mat_vert.affineTransform(src[2], res2);
+				mat_vert.affineTransform(src[3], res3);
+
+				tmp.setSelectWithMask(mask, texIdx, res0);
+				tmp.store4a(dst);
+				tmp.setSelectWithMask(mask, texIdx, res1);
+				tmp.store4a(dst+4);
+				tmp.setSelectWithMask(mask, texIdx, res2);
+				tmp.store4a(dst+8);
+				tmp.setSelectWithMask(mask, texIdx, res3);
+				tmp.store4a(dst+12);
+
+				res0 = res3;
+				src += 4;
+				dst += 16;
+			}
+
+			while (src < end)
+			{
+				mat_vert.affineTransform(*src++, res0);
+				tmp.setSelectWithMask(mask, texIdx, res0);
+				tmp.store4a(dst);
+				dst += 4;
+			}
+
+			while (dst < end_f32)
+			{
+				res0.store4a(dst);
+				dst += 4;
+			}
+		}
+		break;
+
+	case NORMALS:
+		{
+			LLMatrix4a mat_normal;
+			mat_normal.loadu(mNormalMatrix);
+
+			F32* normals = (F32*) mDst;
+			const LLVector4a* src = (const LLVector4a*) mSrc;
+			const LLVector4a* end = src+mCount;
+
+			const LLVector4a* end_4 = src + (mCount & ~3);
+			while (src < end_4)
+			{
+				LLVector4a n0, n1, n2, n3;
+				mat_normal.rotate(src[0], n0);
+				mat_normal.rotate(src[1], n1);
+				mat_normal.rotate(src[2], n2);
+				mat_normal.rotate(src[3], n3);
+				n0.store4a(normals);
+				n1.store4a(normals+4);
+				n2.store4a(normals+8);
+				n3.store4a(normals+12);
+				src += 4;
+				normals += 16;
+			}
+
+			while (src < end)
+			{
+				LLVector4a normal;
+				mat_normal.rotate(*src++, normal);
+				normal.store4a(normals);
+				normals += 4;
+			}
+		}
+		break;
+
+	case WEIGHTS:
+		{
+			LLVector4a* dst = (LLVector4a*) mDst;
+			const LLVector4a* src = (const LLVector4a*) mSrc;
+
+			for (S32 i = 0; i < mCount; ++i)
+			{
+				dst[i] = src[i];
+			}
+		}
+		break;
+
+	case FILL:
+		{
+			LLVector4a src;
+
+			U32 vec[4];
+			vec[0] = vec[1] = vec[2] = vec[3] = mFillValue;
+
+			src.loadua((F32*) vec);
+
+			F32* dst = (F32*) mDst;
+			S32 num_vecs = mCount/4;
+			if (mCount%4 > 0)
+			{
+				++num_vecs;
+			}
+
+			for (S32 i = 0; i < num_vecs; i++)
+			{
+				src.store4a(dst);
+				dst += 4;
+			}
+		}
+		break;
+
+	case TEXCOORDS:
+		runTexCoords();
+		break;
+	}
+}
+
+U32 LLFaceGeometryJob::getDstSize() const
+{
+	switch (mType)
+	{
+	case INDICES:
+		return mCount * sizeof(U16);
+	case POSITIONS:
+		return (U32) ((U8*) mDstEnd - (U8*) mDst);
+	case NORMALS:
+	case WEIGHTS:
+		return mCount * sizeof(LLVector4a);
+	case FILL:
+		return ((mCount + 3) & ~3) * sizeof(U32);
+	case TEXCOORDS:
+		// TEX_XFORM writes pairs, and TEX_COPY copies the padding too
+		return mTexGen == TEX_PLANAR ? mCount * sizeof(LLVector2) : (mCount * sizeof(LLVector2) + 0xF) & ~0xF;
+	}
+	return 0;
+}
+
+// Same as LLFace's planarProjection() followed by its xform(), for one vertex.
+static void planar_xform(LLVector2& tc, const LLVector4a& normal, const LLVector4a& vec,
+						 F32 cos_ang, F32 sin_ang, F32 off_s, F32 off_t, F32 mag_s, F32 mag_t)
+{
+	LLVector4a binormal;
+	F32 d = normal[0];
+
+	if (d >= 0.5f || d <= -0.5f)
+	{
+		binormal.set(0, d < 0 ? -1.f : 1.f, 0);
+	}
+	else
+	{
+		binormal.set(normal[1] > 0 ? -1.f : 1.f, 0, 0);
+	}
+	LLVector4a tangent;
+	tangent.setCross3(binormal, normal);
+
+	F32 s = 1.0f+((binormal.dot3(vec).getF32())*2 - 0.5f);
+	F32 t = -((tangent.dot3(vec).getF32())*2 - 0.5f);
+
+	s -= 0.5f;
+	t -= 0.5f;
+	F32 temp = s;
+	s = s * cos_ang + t * sin_ang;
+	t = -temp * sin_ang + t * cos_ang;
+	tc.mV[0] = s * mag_s + (off_s + 0.5f);
+	tc.mV[1] = t * mag_t + (off_t + 0.5f);
+}
+
+void LLFaceGeometryJob::runTexCoords() const
+{
+	if (mTexGen == TEX_COPY)
+	{
+		S32 tc_size = (mCount*2*sizeof(F32)+0xF) & ~0xF;
+		LLVector4a::memcpyNonAliased16((F32*) mDst, (F32*) mSrc, tc_size);
+		return;
+	}
+
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 cos_ang = _mm_set1_ps(mTexCos);
+	const __m128 sin_ang = _mm_set1_ps(mTexSin);
+
+	if (mTexGen == TEX_XFORM)
+	{
+		// Two <s, t> pairs per register.
+		// The source is padded to 16 bytes, so an odd count reads one
+		// pair of padding and writes one extra pair into the face's
+		// 4 aligned vertex range, like the old inline loop did.
+		const __m128 neg_half = _mm_set1_ps(-0.5f);
+		const __m128 rot0 = _mm_setr_ps(mTexCos, -mTexSin, mTexCos, -mTexSin);
+		const __m128 rot1 = _mm_setr_ps(mTexSin, mTexCos, mTexSin, mTexCos);
+		const __m128 scale = _mm_setr_ps(mTexScaleS, mTexScaleT, mTexScaleS, mTexScaleT);
+		const __m128 offset = _mm_setr_ps(mTexOffsetS+0.5f, mTexOffsetT+0.5f, mTexOffsetS+0.5f, mTexOffsetT+0.5f);
+
+		const F32* src = (const F32*) mSrc;
+		F32* dst = (F32*) mDst;
+		S32 count = mCount/2 + mCount%2;
+
+		for (S32 i = 0; i < count; ++i)
+		{
+			__m128 st = _mm_add_ps(_mm_load_ps(src), neg_half);
+			// <s0, s0, s1, s1> and <t0, t0, t1, t1>
+			__m128 ss = _mm_shuffle_ps(st, st, _MM_SHUFFLE(2, 2, 0, 0));
+			__m128 tt = _mm_shuffle_ps(st, st, _MM_SHUFFLE(3, 3, 1, 1));
+			st = _mm_add_ps(_mm_mul_ps(rot0, ss), _mm_mul_ps(rot1, tt));
+			_mm_store_ps(dst, _mm_add_ps(_mm_mul_ps(st, scale), offset));
+			src += 4;
+			dst += 4;
+		}
+		return;
+	}
+
+	// TEX_PLANAR: four vertices per iteration, in structure of arrays form
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128 two = _mm_set1_ps(2.f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 sign_bit = _mm_set1_ps(-0.f);
+	const __m128 scale_x = _mm_set1_ps(mScale.mV[0]);
+	const __m128 scale_y = _mm_set1_ps(mScale.mV[1]);
+	const __m128 scale_z = _mm_set1_ps(mScale.mV[2]);
+	const __m128 mag_s = _mm_set1_ps(mTexScaleS);
+	const __m128 mag_t = _mm_set1_ps(mTexScaleT);
+	const __m128 off_s = _mm_set1_ps(mTexOffsetS+0.5f);
+	const __m128 off_t = _mm_set1_ps(mTexOffsetT+0.5f);
+
+	F32* dst = (F32*) mDst;
+	S32 end_4 = mCount & ~3;
+	for (S32 i = 0; i < end_4; i += 4)
+	{
+		__m128 nx = _mm_load_ps(mNormals[i].getF32ptr());
+		__m128 ny = _mm_load_ps(mNormals[i+1].getF32ptr());
+		__m128 nz = _mm_load_ps(mNormals[i+2].getF32ptr());
+		__m128 nw = _mm_load_ps(mNormals[i+3].getF32ptr());
+		_MM_TRANSPOSE4_PS(nx, ny, nz, nw);
+
+		__m128 vx = _mm_load_ps(mPositions[i].getF32ptr());
+		__m128 vy = _mm_load_ps(mPositions[i+1].getF32ptr());
+		__m128 vz = _mm_load_ps(mPositions[i+2].getF32ptr());
+		__m128 vw = _mm_load_ps(mPositions[i+3].getF32ptr());
+		_MM_TRANSPOSE4_PS(vx, vy, vz, vw);
+		vx = _mm_mul_ps(vx, scale_x);
+		vy = _mm_mul_ps(vy, scale_y);
+		vz = _mm_mul_ps(vz, scale_z);
+
+		// |nx| >= 0.5: binormal is <0, +-1, 0>, +1 unless nx < 0
+		//   binormal . v = b*vy, tangent . v = (b*nz)*vx + (-b*nx)*vz
+		// otherwise:   binormal is <+-1, 0, 0>, -1 if ny > 0
+		//   binormal . v = b*vx, tangent . v = (-b*nz)*vy + (b*ny)*vz
+		__m128 use_y = _mm_cmpge_ps(_mm_andnot_ps(sign_bit, nx), half);
+		__m128 b_y = _mm_or_ps(_mm_and_ps(_mm_cmplt_ps(nx, zero), sign_bit), one);
+		__m128 b_x = _mm_or_ps(_mm_and_ps(_mm_cmpgt_ps(ny, zero), sign_bit), one);
+
+		__m128 bv_y = _mm_mul_ps(b_y, vy);
+		__m128 tv_y = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(b_y, nz), vx),
+								 _mm_mul_ps(_mm_xor_ps(_mm_mul_ps(b_y, nx), sign_bit), vz));
+		__m128 bv_x = _mm_mul_ps(b_x, vx);
+		__m128 tv_x = _mm_add_ps(_mm_mul_ps(_mm_xor_ps(_mm_mul_ps(b_x, nz), sign_bit), vy),
+								 _mm_mul_ps(_mm_mul_ps(b_x, ny), vz));
+
+		__m128 bv = _mm_or_ps(_mm_and_ps(use_y, bv_y), _mm_andnot_ps(use_y, bv_x));
+		__m128 tv = _mm_or_ps(_mm_and_ps(use_y, tv_y), _mm_andnot_ps(use_y, tv_x));
+
+		// s = 1 + (b.v*2 - 0.5), t = -(t.v*2 - 0.5), then the texture
+		// transform about the face center
+		__m128 s = _mm_sub_ps(_mm_add_ps(one, _mm_sub_ps(_mm_mul_ps(bv, two), half)), half);
+		__m128 t = _mm_sub_ps(_mm_xor_ps(_mm_sub_ps(_mm_mul_ps(tv, two), half), sign_bit), half);
+
+		__m128 rs = _mm_add_ps(_mm_mul_ps(s, cos_ang), _mm_mul_ps(t, sin_ang));
+		__m128 rt = _mm_add_ps(_mm_mul_ps(_mm_xor_ps(s, sign_bit), sin_ang), _mm_mul_ps(t, cos_ang));
+		s = _mm_add_ps(_mm_mul_ps(rs, mag_s), off_s);
+		t = _mm_add_ps(_mm_mul_ps(rt, mag_t), off_t);
+
+		_mm_store_ps(dst, _mm_unpacklo_ps(s, t));
+		_mm_store_ps(dst+4, _mm_unpackhi_ps(s, t));
+		dst += 8;
+	}
+
+	// The normals are followed by the texture coordinates, which are only
+	// padded to 16 bytes, so the last few vertices can't be read four wide.
+	LLVector4a scalea;
+	scalea.load3(mScale.mV);
+	LLVector2* tc = (LLVector2*) dst;
+	for (S32 i = end_4; i < mCount; ++i)
+	{
+		LLVector4a vec = mPositions[i];
+		vec.mul(scalea);
+		planar_xform(*tc++, mNormals[i], vec, mTexCos, mTexSin, mTexOffsetS, mTexOffsetT, mTexScaleS, mTexScaleT);
+	}
+}
+
+//----------------------------------------------------------------------------
+
+LLFaceGeometryBatch::LLFaceGeometryBatch()
+:	mStagingSize(0),
+	mStaging(nullptr),
+	mStagingCapacity(0)
+{
+}
+
+LLFaceGeometryBatch::~LLFaceGeometryBatch()
+{
+	ll_aligned_free_16(mStaging);
+}
+
+// MAIN THREAD
+void LLFaceGeometryBatch::add(const LLFaceGeometryJob& job)
+{
+	mJobs.push_back(job);
+	mDsts.push_back(job.mDst);
+	mStagingOffsets.push_back(mStagingSize);
+	// Every job's output starts 16 byte aligned, as in a vertex buffer
+	mStagingSize += (job.getDstSize() + 0xF) & ~0xF;
+}
+
+void LLFaceGeometryBatch::runInline()
+{
+	for (const LLFaceGeometryJob& job : mJobs)
+	{
+		job.run();
+	}
+	clear();
+}
+
+void LLFaceGeometryBatch::stage()
+{
+	if (mStagingSize > mStagingCapacity)
+	{
+		ll_aligned_free_16(mStaging);
+		mStagingCapacity = llmax(mStagingSize, mStagingCapacity * 2);
+		mStaging = (U8*) ll_aligned_malloc_16(mStagingCapacity);
+	}
+
+	for (size_t i = 0; i < mJobs.size(); ++i)
+	{
+		LLFaceGeometryJob& job = mJobs[i];
+		U8* staged = mStaging + mStagingOffsets[i];
+		if (job.mDstEnd)
+		{
+			job.mDstEnd = staged + ((U8*) job.mDstEnd - (U8*) job.mDst);
+		}
+		job.mDst = staged;
+	}
+}
+
+void LLFaceGeometryBatch::commit()
+{
+	for (size_t i = 0; i < mJobs.size(); ++i)
+	{
+		memcpy(mDsts[i], mStaging + mStagingOffsets[i], mJobs[i].getDstSize());
+	}
+	clear();
+}
+
+void LLFaceGeometryBatch::clear()
+{
+	mJobs.clear();
+	mDsts.clear();
+	mStagingOffsets.clear();
+	mStagingSize = 0;
+}
+
+//----------------------------------------------------------------------------
+
+LLFaceGeometryQueue::LLFaceGeometryQueue(U32 num_threads)
+:	mJobs(nullptr),
+	mNumJobs(0),
+	mNextJob(0),
+	mNumFinished(0)
+{
+	for (U32 i = 0; i < num_threads; ++i)
+	{
+		JobThread* thread = new JobThread(llformat("facegeometry %d", i), this);
+		mThreads.push_back(thread);
+		thread->start();
+	}
+	LL_INFOS() << "Face geometry queue using " << num_threads << " threads" << LL_ENDL;
+}
+
+LLFaceGeometryQueue::~LLFaceGeometryQueue()
+{
+	for (JobThread* thread : mThreads)
+	{
+		thread->shutdown();
+	}
+	std::for_each(mThreads.begin(), mThreads.end(), DeletePointer());
+	mThreads.clear();
+}
+
+// MAIN THREAD
+void LLFaceGeometryQueue::run(LLFaceGeometryBatch& batch)
+{
+	if (mThreads.empty() || batch.mJobs.size() <= JOBS_PER_CLAIM)
+	{
+		batch.runInline();
+		return;
+	}
+
+	batch.stage();
+	{
+		LLMutexLock lock(&mCondition);
+		mJobs = &batch.mJobs[0];
+		mNumJobs = (U32) batch.mJobs.size();
+		mNextJob = 0;
+		mNumFinished = 0;
+	}
+	wakeThreads();
+
+	runJobs();
+
+	{
+		LLMutexLock lock(&mCondition);
+		while (mNumFinished < mNumJobs)
+		{
+			mCondition.wait();
+		}
+		mJobs = nullptr;
+		mNumJobs = 0;
+	}
+	batch.commit();
+}
+
+bool LLFaceGeometryQueue::hasPendingJobs()
+{
+	LLMutexLock lock(&mCondition);
+	return mNextJob < mNumJobs;
+}
+
+void LLFaceGeometryQueue::runJobs()
+{
+	U32 num_run = 0;
+	while (true)
+	{
+		const LLFaceGeometryJob* jobs;
+		U32 begin, end;
+		{
+			LLMutexLock lock(&mCondition);
+			// Report the last claim with the same lock that takes the next
+			mNumFinished += num_run;
+			if (num_run && mNumFinished == mNumJobs)
+			{
+				mCondition.broadcast();
+			}
+			if (mNextJob >= mNumJobs)
+			{
+				return;
+			}
+			jobs = mJobs;
+			begin = mNextJob;
+			end = llmin(begin + JOBS_PER_CLAIM, mNumJobs);
+			mNextJob = end;
+		}
+
+		for (U32 i = begin; i < end; ++i)
+		{
+			jobs[i].run();
+		}
+		num_run = end - begin;
+	}
+}
+
+void LLFaceGeometryQueue::wakeThreads()
+{
+	for (JobThread* thread : mThreads)
+	{
+		thread->wake();
+	}
+}
+
+//----------------------------------------------------------------------------
+
+LLFaceGeometryQueue::JobThread::JobThread(const std::string& name, LLFaceGeometryQueue* queue)
+:	LLThread(name),
+	mQueue(queue)
+{
+}
+
+// virtual
+bool LLFaceGeometryQueue::JobThread::runCondition()
+{
+	// mDataLock is locked here; the queue has its own lock
+	return mQueue->hasPendingJobs();
+}
+
+// virtual
+void LLFaceGeometryQueue::JobThread::run()
+{
+	while (true)
+	{
+		// Sleeps until run() wakes us with work
+		checkPause();
+
+		if (isQuitting())
+		{
+			break;
+		}
+
+		mQueue->runJobs();
+	}
+	LL_INFOS() << "Face geometry thread " << mName << " EXITING." << LL_ENDL;
+}
@@ -0,0 +1,182 @@
+/**
+ * @file llfacegeometryjobs.h
+ * @brief Builds face vertex data on worker threads.
+ *
+ * $LicenseInfo:firstyear=2001&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLFACEGEOMETRYJOBS_H
+#define LL_LLFACEGEOMETRYJOBS_H
+
+#include <vector>
+
+#include "llmutex.h"
+#include "llthread.h"
+#include "m3math.h"
+#include "m4math.h"
+#include "v3math.h"
+
+class LLVector4a;
+
+// One vertex attribute stream of a face, copied or transformed out of an
+// LLVolumeFace into memory the main thread has already mapped, or into
+// staging memory standing in for it.  Jobs only touch their own source and
+// destination, so they can run on any thread.
+struct LLFaceGeometryJob
+{
+	enum EType
+	{
+		INDICES,	// mSrc is U16[mCount], offset by mIndexOffset
+		POSITIONS,	// mSrc is LLVector4a[mCount], transformed by mVertexMatrix,
+					// texture index in w, padded with the last position up to mDstEnd
+		NORMALS,	// mSrc is LLVector4a[mCount], rotated by mNormalMatrix
+		WEIGHTS,	// mSrc is LLVector4a[mCount], copied
+		FILL,		// mFillValue repeated over mCount vertices, rounded up to 4
+		TEXCOORDS	// mSrc is LLVector2[mCount] padded to 16 bytes, see below
+	};
+
+	// How TEXCOORDS jobs make texture coordinates.  The kernel for each
+	// combination is picked once per job, not per vertex.
+	enum ETexGen
+	{
+		TEX_COPY,		// copy mSrc
+		TEX_XFORM,		// transform mSrc by the mTex* parameters, an even number at a time
+		TEX_PLANAR		// project mPositions * mScale along mNormals, then transform
+	};
+
+	LLFaceGeometryJob(EType type = FILL);
+
+	// Thread safe
+	void run() const;
+
+	// Number of bytes run() writes from mDst on
+	U32 getDstSize() const;
+
+	EType mType;
+	S32 mCount;
+	const void* mSrc;
+	void* mDst;
+	void* mDstEnd;
+	LLMatrix4 mVertexMatrix;
+	LLMatrix3 mNormalMatrix;
+	U16 mIndexOffset;
+	S32 mTextureIndex;
+	U32 mFillValue;
+
+	// TEXCOORDS
+	ETexGen mTexGen;
+	const LLVector4a* mPositions;
+	const LLVector4a* mNormals;
+	LLVector3 mScale;
+	F32 mTexCos;
+	F32 mTexSin;
+	F32 mTexOffsetS;
+	F32 mTexOffsetT;
+	F32 mTexScaleS;
+	F32 mTexScaleT;
+
+private:
+	void runTexCoords() const;
+};
+
+// The jobs for one spatial group's rebuild.  The main thread adds them
+// without taking any locks, and LLFaceGeometryQueue::run() runs them all at
+// once.  When they run on worker threads they write into one block of
+// staging memory owned by the batch, which is copied out to the mapped
+// buffers afterwards, so the workers never touch vertex buffer memory.
+class LLFaceGeometryBatch
+{
+public:
+	LLFaceGeometryBatch();
+	~LLFaceGeometryBatch();
+
+	// MAIN THREAD.  The job's source and destination must stay valid
+	// until LLFaceGeometryQueue::run() returns.
+	void add(const LLFaceGeometryJob& job);
+
+	bool isEmpty() const { return mJobs.empty(); }
+
+private:
+	friend class LLFaceGeometryQueue;
+
+	// Runs the jobs in order, straight into their destinations
+	void runInline();
+	// Points the jobs at the staging memory
+	void stage();
+	// Copies what the jobs wrote into their destinations
+	void commit();
+	void clear();
+
+	std::vector<LLFaceGeometryJob> mJobs;
+	// Where each job's output goes, and where it is staged
+	std::vector<void*> mDsts;
+	std::vector<U32> mStagingOffsets;
+	U32 mStagingSize;
+
+	U8* mStaging;
+	U32 mStagingCapacity;
+};
+
+// Runs batches of face geometry jobs on a small pool of threads.  The
+// threads take several jobs at a time, so a batch costs a handful of
+// lock round trips rather than a few per job.
+class LLFaceGeometryQueue
+{
+public:
+	// MAIN THREAD.  With no threads, run() runs jobs as they come.
+	LLFaceGeometryQueue(U32 num_threads);
+	~LLFaceGeometryQueue();
+
+	// MAIN THREAD.  Runs every job in batch, on the worker threads and
+	// this one, then writes the results out and empties the batch.
+	void run(LLFaceGeometryBatch& batch);
+
+	bool hasPendingJobs();
+
+private:
+	class JobThread : public LLThread
+	{
+	public:
+		JobThread(const std::string& name, LLFaceGeometryQueue* queue);
+
+	private:
+		bool runCondition() override;
+		void run() override;
+
+		LLFaceGeometryQueue* mQueue;
+	};
+
+	// Runs jobs until none are left unclaimed
+	void runJobs();
+	void wakeThreads();
+
+	// Guards the fields below
+	LLCondition mCondition;
+	const LLFaceGeometryJob* mJobs;
+	U32 mNumJobs;
+	U32 mNextJob;
+	U32 mNumFinished;
+
+	std::vector<JobThread*> mThreads;
+};
+
+#endif // LL_LLFACEGEOMETRYJOBS_H
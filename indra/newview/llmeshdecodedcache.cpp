@@ -0,0 +1,312 @@
+/**
+ * @file llmeshdecodedcache.cpp
+ * @brief On-disk cache of unpacked mesh LODs.
+ *
+ * $LicenseInfo:firstyear=2001&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llmeshdecodedcache.h"
+
+#include "llatomic.h"
+#include "lldir.h"
+#include "lldiriterator.h"
+#include "llfile.h"
+#include "llmappedfile.h"
+#include "lltrace.h"
+#include "llvolume.h"
+
+static LLTrace::CountStatHandle<> sDecodedCacheHits("meshdecodedcachehits", "Mesh LODs loaded from the decoded mesh cache");
+static LLTrace::CountStatHandle<> sDecodedCacheMisses("meshdecodedcachemisses", "Mesh LODs that had to be unpacked");
+
+// File header, padded so the faces that follow start 16 byte aligned
+const U32 DECODED_CACHE_MAGIC = 0x434d4c4c; // "LLMC"
+const U32 DECODED_CACHE_VERSION = 1;
+const U32 DECODED_CACHE_HEADER_SIZE = 48;
+
+struct DecodedCacheHeader
+{
+	U32 mMagic;
+	U32 mVersion;
+	U8 mMeshID[UUID_BYTES];
+	S32 mLOD;
+	U32 mSculptType;
+	U32 mSize;
+};
+
+static LLAtomicU32 sTempSerial;
+
+LLMeshDecodedCache::LLMeshDecodedCache(U64 max_bytes, const std::string& cache_dir)
+:	mCacheDir(cache_dir),
+	mMaxBytes(max_bytes),
+	mCacheBytes(0)
+{
+	if (mMaxBytes > 0)
+	{
+		LLFile::mkdir(mCacheDir);
+		trimCache();
+	}
+	LL_INFOS("MeshCache") << "Decoded mesh cache using " << mCacheBytes << " of " << mMaxBytes << " bytes" << LL_ENDL;
+}
+
+// static
+std::string LLMeshDecodedCache::getCacheDir()
+{
+	return gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "meshcache");
+}
+
+// static
+void LLMeshDecodedCache::removeCache()
+{
+	std::string cache_dir = getCacheDir();
+	if (LLFile::isdir(cache_dir))
+	{
+		gDirUtilp->deleteDirAndContents(cache_dir);
+	}
+}
+
+// Mirrored and inverted meshes unpack differently, so the sculpt flags
+// are part of the key.
+std::string LLMeshDecodedCache::getFilename(const LLVolumeParams& mesh_params, S32 lod) const
+{
+	return gDirUtilp->add(mCacheDir, llformat("%s_%d_%02x.mesh", mesh_params.getSculptID().asString().c_str(),
+											  lod, (U32) mesh_params.getSculptType()));
+}
+
+bool LLMeshDecodedCache::loadLOD(const LLVolumeParams& mesh_params, S32 lod, LLVolume* volume)
+{
+	if (mMaxBytes == 0)
+	{
+		return false;
+	}
+
+	std::string filename = getFilename(mesh_params, lod);
+	LLFILE* fp = LLFile::fopen(filename, "rb");
+	if (!fp)
+	{
+		add(sDecodedCacheMisses, 1);
+		return false;
+	}
+	fseek(fp, 0, SEEK_END);
+	long size = ftell(fp);
+
+	LLMappedFile file;
+	bool success = size >= (long) DECODED_CACHE_HEADER_SIZE && file.map(fp, (U32) size, true, filename);
+	// The mapping keeps the file open
+	fclose(fp);
+
+	if (success)
+	{
+		DecodedCacheHeader header;
+		memcpy(&header, file.getData(), sizeof(header));
+		success = header.mMagic == DECODED_CACHE_MAGIC
+			&& header.mVersion == DECODED_CACHE_VERSION
+			&& !memcmp(header.mMeshID, mesh_params.getSculptID().mData, UUID_BYTES)
+			&& header.mLOD == lod
+			&& header.mSculptType == (U32) mesh_params.getSculptType()
+			&& header.mSize == file.getSize() - DECODED_CACHE_HEADER_SIZE
+			&& volume->unpackDecodedFaces(file.getData() + DECODED_CACHE_HEADER_SIZE, header.mSize);
+	}
+	file.unmap();
+
+	if (!success)
+	{
+		// Stale or damaged, unpack the asset again and replace it
+		LL_WARNS("MeshCache") << "Discarding decoded mesh cache file " << filename << LL_ENDL;
+		LLFile::remove(filename, ENOENT);
+		{
+			LLMutexLock lock(&mMutex);
+			forgetFile(filename);
+		}
+		add(sDecodedCacheMisses, 1);
+		return false;
+	}
+
+	{
+		LLMutexLock lock(&mMutex);
+		touchFile(filename);
+	}
+	add(sDecodedCacheHits, 1);
+	return true;
+}
+
+bool LLMeshDecodedCache::packLOD(const LLVolume* volume, std::vector<U8>& faces) const
+{
+	if (mMaxBytes == 0)
+	{
+		return false;
+	}
+
+	volume->packDecodedFaces(faces);
+	return DECODED_CACHE_HEADER_SIZE + faces.size() <= mMaxBytes;
+}
+
+void LLMeshDecodedCache::storeLOD(const LLVolumeParams& mesh_params, S32 lod, const std::vector<U8>& faces)
+{
+	const U64 size = DECODED_CACHE_HEADER_SIZE + faces.size();
+	if (faces.empty() || size > mMaxBytes)
+	{
+		return;
+	}
+
+	// Make room by dropping the least recently used files, and count this
+	// one in before writing it so other threads make room for it too
+	std::string filename = getFilename(mesh_params, lod);
+	std::vector<std::string> evicted;
+	{
+		LLMutexLock lock(&mMutex);
+		forgetFile(filename);
+		while (mCacheBytes + size > mMaxBytes && !mLRU.empty())
+		{
+			evicted.push_back(mLRU.back());
+			forgetFile(mLRU.back());
+		}
+		addFile(filename, size);
+	}
+	for (std::vector<std::string>::iterator iter = evicted.begin(); iter != evicted.end(); ++iter)
+	{
+		LLFile::remove(*iter, ENOENT);
+	}
+
+	std::vector<U8> header_data(DECODED_CACHE_HEADER_SIZE, 0);
+	DecodedCacheHeader header;
+	header.mMagic = DECODED_CACHE_MAGIC;
+	header.mVersion = DECODED_CACHE_VERSION;
+	memcpy(header.mMeshID, mesh_params.getSculptID().mData, UUID_BYTES);
+	header.mLOD = lod;
+	header.mSculptType = (U32) mesh_params.getSculptType();
+	header.mSize = (U32) faces.size();
+	memcpy(&header_data[0], &header, sizeof(header));
+
+	// Write the file next to the old one and swap it in, so readers never
+	// see half a file.  Two threads may decode the same LOD, hence the
+	// serial.
+	std::string temp_filename = llformat("%s.%u.tmp", filename.c_str(), (U32) ++sTempSerial);
+	LLFILE* fp = LLFile::fopen(temp_filename, "wb");
+	bool success = fp != nullptr;
+	if (success)
+	{
+		success = fwrite(&header_data[0], 1, header_data.size(), fp) == header_data.size()
+			&& fwrite(&faces[0], 1, faces.size(), fp) == faces.size();
+		success = (fclose(fp) == 0) && success;
+	}
+	success = success && LLFile::replace(temp_filename, filename) == 0;
+	if (!success)
+	{
+		LL_WARNS("MeshCache") << "Failed to write decoded mesh cache file " << filename << LL_ENDL;
+		LLFile::remove(temp_filename, ENOENT);
+
+		LLMutexLock lock(&mMutex);
+		forgetFile(filename);
+	}
+}
+
+void LLMeshDecodedCache::addFile(const std::string& filename, U64 size)
+{
+	mLRU.push_front(filename);
+	CacheEntry& entry = mEntries[filename];
+	entry.mSize = size;
+	entry.mLRU = mLRU.begin();
+	mCacheBytes += size;
+}
+
+void LLMeshDecodedCache::forgetFile(const std::string& filename)
+{
+	entry_map_t::iterator iter = mEntries.find(filename);
+	if (iter != mEntries.end())
+	{
+		mCacheBytes -= iter->second.mSize;
+		mLRU.erase(iter->second.mLRU);
+		mEntries.erase(iter);
+	}
+}
+
+void LLMeshDecodedCache::touchFile(const std::string& filename)
+{
+	entry_map_t::iterator iter = mEntries.find(filename);
+	if (iter != mEntries.end())
+	{
+		mLRU.splice(mLRU.begin(), mLRU, iter->second.mLRU);
+	}
+}
+
+// Removes the oldest files until the cache is at half its limit, along
+// with anything left over from an interrupted write, and ranks the rest
+// by age.
+void LLMeshDecodedCache::trimCache()
+{
+	struct CacheFile
+	{
+		std::string mName;
+		time_t mTime;
+		U64 mSize;
+
+		bool operator<(const CacheFile& rhs) const { return mTime < rhs.mTime; }
+	};
+
+	std::vector<CacheFile> files;
+	U64 total_bytes = 0;
+	std::string name;
+	LLDirIterator iter(mCacheDir, "*");
+	while (iter.next(name))
+	{
+		std::string filename = gDirUtilp->add(mCacheDir, name);
+		llstat stat_data;
+		if (name.size() < 5 || name.compare(name.size() - 5, 5, ".mesh") != 0
+			|| LLFile::stat(filename, &stat_data) != 0)
+		{
+			LLFile::remove(filename, ENOENT);
+			continue;
+		}
+
+		CacheFile file;
+		file.mName = filename;
+		file.mTime = stat_data.st_mtime;
+		file.mSize = stat_data.st_size;
+		files.push_back(file);
+		total_bytes += file.mSize;
+	}
+
+	std::sort(files.begin(), files.end());
+	U32 removed = 0;
+	LLMutexLock lock(&mMutex);
+	for (std::vector<CacheFile>::iterator file = files.begin(); file != files.end(); ++file)
+	{
+		if (total_bytes > mMaxBytes / 2)
+		{
+			LLFile::remove(file->mName, ENOENT);
+			total_bytes -= file->mSize;
+			++removed;
+		}
+		else
+		{
+			// Oldest first, so the newest ends up most recently used
+			addFile(file->mName, file->mSize);
+		}
+	}
+
+	if (removed)
+	{
+		LL_INFOS("MeshCache") << "Removed " << removed << " old decoded mesh cache files" << LL_ENDL;
+	}
+}
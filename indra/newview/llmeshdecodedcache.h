@@ -0,0 +1,98 @@
+/**
+ * @file llmeshdecodedcache.h
+ * @brief On-disk cache of unpacked mesh LODs.
+ *
+ * $LicenseInfo:firstyear=2001&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMESHDECODEDCACHE_H
+#define LL_LLMESHDECODEDCACHE_H
+
+#include <list>
+#include <map>
+#include <vector>
+
+#include "llmutex.h"
+
+class LLVolume;
+class LLVolumeParams;
+
+// Second tier of the mesh cache, next to the raw assets in the VFS.  Holds
+// one file per mesh LOD with the faces exactly as unpackVolumeFaces() left
+// them (see LLVolume::packDecodedFaces()), so a hit maps the file and
+// copies the streams out instead of inflating and parsing the asset.
+//
+// Files are kept in least recently used order, the order being that of
+// their modification times at startup.  Storing a LOD that would take the
+// cache past its size limit removes the least recently used files first,
+// and at startup the cache is trimmed to half its limit.  Files are not
+// synced; one cut short by a crash fails validation and is unpacked again.
+// Safe to use from any thread.
+class LLMeshDecodedCache
+{
+public:
+	// A size of 0 disables the cache
+	LLMeshDecodedCache(U64 max_bytes, const std::string& cache_dir = getCacheDir());
+
+	// Fills volume with the cached LOD, false on a miss
+	bool loadLOD(const LLVolumeParams& mesh_params, S32 lod, LLVolume* volume);
+
+	// Packs a freshly unpacked LOD for storeLOD(), false if it won't be
+	// cached.  Call it before the volume is handed to anyone else.
+	bool packLOD(const LLVolume* volume, std::vector<U8>& faces) const;
+
+	// Writes faces from packLOD() out, making room if needed.  This is the
+	// slow part, so do it after the volume has been handed on.
+	void storeLOD(const LLVolumeParams& mesh_params, S32 lod, const std::vector<U8>& faces);
+
+	static std::string getCacheDir();
+	static void removeCache();
+
+private:
+	std::string getFilename(const LLVolumeParams& mesh_params, S32 lod) const;
+	void trimCache();
+
+	// These expect mMutex to be held
+	void addFile(const std::string& filename, U64 size);
+	void forgetFile(const std::string& filename);
+	void touchFile(const std::string& filename);
+
+	std::string mCacheDir;
+	U64 mMaxBytes;
+
+	typedef std::list<std::string> lru_list_t;
+	struct CacheEntry
+	{
+		U64 mSize;
+		lru_list_t::iterator mLRU;
+	};
+	typedef std::map<std::string, CacheEntry> entry_map_t;
+
+	// Guards the fields below
+	LLMutex mMutex;
+	U64 mCacheBytes;
+	// Most recently used first
+	lru_list_t mLRU;
+	entry_map_t mEntries;
+};
+
+#endif // LL_LLMESHDECODEDCACHE_H
@@ -0,0 +1,218 @@
+/**
+ * @file llmeshdecoder.cpp
+ * @brief Pool of threads decoding downloaded mesh data.
+ *
+ * $LicenseInfo:firstyear=2026&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2026, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llmeshdecoder.h"
+
+#include "llmemory.h"
+#include "llstl.h"
+
+const char * const LOG_MESH = "Mesh";
+
+LLMeshDecoder::Request::Request(EType type, const LLUUID& mesh_id)
+:	mType(type),
+	mMeshID(mesh_id),
+	mLOD(0),
+	mData(nullptr),
+	mDataSize(0),
+	mCacheOffset(0),
+	mCacheSize(0),
+	mScore(0.f)
+{
+}
+
+LLMeshDecoder::Request::~Request()
+{
+	ll_aligned_free_16(mData);
+}
+
+void LLMeshDecoder::Request::adoptData(U8*& data, S32 data_size)
+{
+	ll_aligned_free_16(mData);
+	mData = data;
+	mDataSize = data ? data_size : 0;
+	data = nullptr;
+}
+
+LLMeshDecoder::LLMeshDecoder(Responder* responder, U32 num_threads)
+:	mResponder(responder),
+	mCondition(new LLCondition()),
+	mNumRequests(0)
+{
+	for (U32 i = 0; i < num_threads; ++i)
+	{
+		DecodeThread* thread = new DecodeThread(llformat("meshdecode %d", i), this);
+		mThreads.push_back(thread);
+		thread->start();
+	}
+	LL_INFOS(LOG_MESH) << "Mesh decoder using " << num_threads << " threads" << LL_ENDL;
+}
+
+LLMeshDecoder::~LLMeshDecoder()
+{
+	for (DecodeThread* thread : mThreads)
+	{
+		thread->shutdown();
+	}
+	std::for_each(mThreads.begin(), mThreads.end(), DeletePointer());
+	mThreads.clear();
+
+	// Whatever is left was never going to be used
+	std::for_each(mRequests.begin(), mRequests.end(), DeletePointer());
+	mRequests.clear();
+
+	delete mCondition;
+	mCondition = nullptr;
+}
+
+// REPO THREAD
+void LLMeshDecoder::addRequest(Request* request)
+{
+	if (mThreads.empty())
+	{
+		decodeRequest(request);
+		return;
+	}
+
+	{
+		LLMutexLock lock(mCondition);
+		mRequests.push_back(request);
+		++mNumRequests;
+	}
+
+	for (DecodeThread* thread : mThreads)
+	{
+		thread->wake();
+	}
+}
+
+bool LLMeshDecoder::hasPendingRequests()
+{
+	LLMutexLock lock(mCondition);
+	return !mRequests.empty();
+}
+
+S32 LLMeshDecoder::getNumRequests()
+{
+	LLMutexLock lock(mCondition);
+	return mNumRequests;
+}
+
+// MAIN THREAD
+void LLMeshDecoder::getPendingMeshIDs(std::map<LLUUID, F32>& scores)
+{
+	LLMutexLock lock(mCondition);
+	for (const Request* request : mRequests)
+	{
+		scores[request->mMeshID] = 0.f;
+	}
+}
+
+// MAIN THREAD
+void LLMeshDecoder::setScores(const std::map<LLUUID, F32>& scores)
+{
+	LLMutexLock lock(mCondition);
+	for (Request* request : mRequests)
+	{
+		std::map<LLUUID, F32>::const_iterator iter = scores.find(request->mMeshID);
+		if (iter != scores.end())
+		{
+			request->mScore = iter->second;
+		}
+	}
+}
+
+LLMeshDecoder::Request* LLMeshDecoder::claimRequest()
+{
+	LLMutexLock lock(mCondition);
+	if (mRequests.empty())
+	{
+		return nullptr;
+	}
+
+	// Oldest first among equals, so unscored requests keep arrival order
+	std::list<Request*>::iterator best = mRequests.begin();
+	for (std::list<Request*>::iterator iter = std::next(best); iter != mRequests.end(); ++iter)
+	{
+		if ((*iter)->mScore > (*best)->mScore)
+		{
+			best = iter;
+		}
+	}
+
+	Request* request = *best;
+	mRequests.erase(best);
+	return request;
+}
+
+void LLMeshDecoder::decodeRequest(Request* request)
+{
+	mResponder->decode(request);
+
+	// Also releases the handler, and its request slot, outside our lock
+	delete request;
+}
+
+LLMeshDecoder::DecodeThread::DecodeThread(const std::string& name, LLMeshDecoder* decoder)
+:	LLThread(name),
+	mDecoder(decoder)
+{
+}
+
+// virtual
+bool LLMeshDecoder::DecodeThread::runCondition()
+{
+	// mDataLock is locked here; the decoder has its own lock
+	return mDecoder->hasPendingRequests();
+}
+
+// virtual
+void LLMeshDecoder::DecodeThread::run()
+{
+	while (true)
+	{
+		// Sleeps until addRequest() wakes us with work
+		checkPause();
+
+		if (isQuitting())
+		{
+			break;
+		}
+
+		// Leaves what is still queued at shutdown to the decoder's destructor
+		Request* request;
+		while (!isQuitting() && (request = mDecoder->claimRequest()))
+		{
+			mDecoder->decodeRequest(request);
+
+			LLMutexLock lock(mDecoder->mCondition);
+			--mDecoder->mNumRequests;
+		}
+	}
+	LL_INFOS(LOG_MESH) << "Mesh decode thread " << mName << " EXITING." << LL_ENDL;
+}
+
@@ -0,0 +1,145 @@
+/**
+ * @file llmeshdecoder.h
+ * @brief Pool of threads decoding downloaded mesh data.
+ *
+ * $LicenseInfo:firstyear=2026&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2026, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMESHDECODER_H
+#define LL_LLMESHDECODER_H
+
+#include "httphandler.h"
+#include "llthread.h"
+#include "lluuid.h"
+#include "llvolume.h"
+
+#include <list>
+#include <map>
+#include <vector>
+
+// Decompresses and unpacks downloaded mesh data on a pool of worker
+// threads, so the repo thread can go straight back to servicing HTTP.
+// The responder does the decoding, and LLMeshRepoThread's puts the
+// results in its usual completion queues.  Requests for the meshes with
+// the highest score, as kept up to date by the main thread, are decoded
+// first.
+//
+// A request keeps the HTTP handler that fetched it, and with it the
+// handler's request slot, until it has been decoded, so the repo thread
+// stops fetching when the decoder falls behind.
+class LLMeshDecoder
+{
+public:
+	// Requests queued or being decoded at once before the repo thread
+	// holds off further fetches
+	static const S32 MAX_REQUESTS = 32;
+
+	enum EType
+	{
+		LOD,
+		SKIN_INFO,
+		DECOMPOSITION,
+		PHYSICS_SHAPE
+	};
+
+	struct Request
+	{
+		Request(EType type, const LLUUID& mesh_id);
+		~Request();
+
+		// Takes ownership of an ll_aligned_malloc_16() buffer, such as
+		// one adopted from the HTTP response body, and clears data.
+		void adoptData(U8*& data, S32 data_size);
+
+		EType mType;
+		LLUUID mMeshID;
+		LLVolumeParams mMeshParams;		// LOD only
+		S32 mLOD;						// LOD only
+		U8* mData;						// owned, see adoptData()
+		S32 mDataSize;
+		S32 mCacheOffset;				// where mData is written to the VFS
+		S32 mCacheSize;					// once it decodes
+		F32 mScore;
+		LLCore::HttpHandler::ptr_t mHandler;	// released once decoded
+
+	private:
+		Request(const Request&) = delete;
+		Request& operator=(const Request&) = delete;
+	};
+
+	class Responder
+	{
+	public:
+		virtual ~Responder() {}
+
+		// Called on a decode thread, several at once with more than one.
+		// The decoder deletes the request afterwards.
+		virtual void decode(Request* request) = 0;
+	};
+
+	// With no threads, addRequest() decodes on the calling thread
+	LLMeshDecoder(Responder* responder, U32 num_threads);
+	~LLMeshDecoder();
+
+	// REPO THREAD.  Takes ownership of the request.
+	void addRequest(Request* request);
+
+	bool hasPendingRequests();
+
+	// Requests queued or being decoded
+	S32 getNumRequests();
+
+	// False once MAX_REQUESTS are queued or being decoded
+	bool hasRequestSlot()						{ return getNumRequests() < MAX_REQUESTS; }
+
+	// MAIN THREAD.  Adds the mesh IDs of requests still waiting to be
+	// decoded to scores, then sets their score from it.
+	void getPendingMeshIDs(std::map<LLUUID, F32>& scores);
+	void setScores(const std::map<LLUUID, F32>& scores);
+
+private:
+	class DecodeThread : public LLThread
+	{
+	public:
+		DecodeThread(const std::string& name, LLMeshDecoder* decoder);
+
+	private:
+		bool runCondition() override;
+		void run() override;
+
+		LLMeshDecoder* mDecoder;
+	};
+
+	Request* claimRequest();
+	void decodeRequest(Request* request);
+
+	Responder* mResponder;
+
+	// Guards mRequests and mNumRequests
+	LLCondition* mCondition;
+	std::list<Request*> mRequests;
+	S32 mNumRequests;
+
+	std::vector<DecodeThread*> mThreads;
+};
+
+#endif // LL_LLMESHDECODER_H
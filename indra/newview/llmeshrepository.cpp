@@ -42,10 +42,13 @@
 #include "llimagej2c.h"
 #include "llhost.h"
 #include "llmath.h"
+#include "llmeshdecodedcache.h"
+#include "llmeshdecoder.h"
 #include "llnotificationsutil.h"
 #include "llsd.h"
 #include "llsdutil_math.h"
 #include "llsdserialize.h"
+#include "llsdview.h"
 #include "llthread.h"
 #include "llvfile.h"
 #include "llviewercontrol.h"
@@ -105,6 +108,7 @@
 //   main     Main rendering thread, very sensitive to locking and other stalls
 //   repo     Overseeing worker thread associated with the LLMeshRepoThread class
 //   decom    Worker thread for mesh decomposition requests
+//   decodeN  0-N mesh decode threads (MeshDecodeThreads), see LLMeshDecoder
 //   core     HTTP worker thread:  does the work but doesn't intrude here
 //   uploadN  0-N temporary mesh upload threads (0-1 in practice)
 //
@@ -144,9 +148,15 @@
 //                             ...
 //                             onCompleted() invoked for GET
 //                               data copied
+//                               Request added to LLMeshDecoder,
+//                                 keeping the handler's request slot
+//                             ...
+//                             decode thread claims highest-scored Request
 //                               lodReceived() invoked
 //                                 unpack data into LLVolume
 //                                 append LoadedMesh to mLoadedQ
+//                               data written to VFS
+//                               handler released, freeing its slot
 //                             ...
 //         notifyLoadedMeshes() invoked again
 //           scan mLoadedQ
@@ -164,11 +174,13 @@
 //   LLPhysicsDecomp::mSignal (LLCondition)
 //   LLPhysicsDecomp::mMutex
 //   LLMeshUploadThread::mMutex
+//   LLMeshDecoder::mCondition (LLCondition)
 //
 // Mutex Order Rules
 //
 //   1.  LLMeshRepoThread::mMutex before LLMeshRepoThread::mHeaderMutex
 //   2.  LLMeshRepository::mMeshMutex before LLMeshRepoThread::mMutex
+//   3.  LLMeshRepoThread::mMutex before LLMeshDecoder::mCondition
 //   (There are more rules, haven't been extracted.)
 //
 // Data Member Access/Locking
@@ -217,9 +229,9 @@
 //     sLODPending                     mMeshMutex [4]  rw.main.mMeshMutex
 //     sLODProcessing                  Repo::mMutex    rw.any.Repo::mMutex
 //     sCacheBytesRead                 none            rw.repo.none, ro.main.none [1]
-//     sCacheBytesWritten              "
-//     sCacheReads                     "
-//     sCacheWrites                    "
+//     sCacheBytesWritten              Decoder::mCondition  rw.decodeN.mCondition, ro.main.none [1]
+//     sCacheReads                     none            rw.repo.none, ro.main.none [1]
+//     sCacheWrites                    Decoder::mCondition  rw.decodeN.mCondition, ro.main.none [1]
 //     mLoadingMeshes                  mMeshMutex [4]  rw.main.none, rw.any.mMeshMutex
 //     mSkinMap                        none            rw.main.none
 //     mDecompositionMap               none            rw.main.none
@@ -572,7 +584,9 @@ protected:
 	
 public:
 	void onCompleted(LLCore::HttpHandle handle, LLCore::HttpResponse * response) override;
-	virtual void processData(LLCore::BufferArray * body, S32 body_offset, U8 * data, S32 data_size) = 0;
+	// data is an ll_aligned_malloc_16() buffer; a handler that keeps it
+	// sets data to NULL and frees it itself.
+	virtual void processData(LLCore::BufferArray * body, S32 body_offset, U8 *& data, S32 data_size) = 0;
 	virtual void processFailure(LLCore::HttpStatus status) = 0;
 	
 public:
@@ -604,7 +618,7 @@ protected:
 	LLMeshHeaderHandler& operator=(const LLMeshHeaderHandler &) = delete;	// Not defined
 	
 public:
-	void processData(LLCore::BufferArray * body, S32 body_offset, U8 * data, S32 data_size) override;
+	void processData(LLCore::BufferArray * body, S32 body_offset, U8 *& data, S32 data_size) override;
 	void processFailure(LLCore::HttpStatus status) override;
 };
 
@@ -630,7 +644,7 @@ protected:
 	LLMeshLODHandler& operator=(const LLMeshLODHandler &) = delete;			// Not defined
 	
 public:
-	void processData(LLCore::BufferArray * body, S32 body_offset, U8 * data, S32 data_size) override;
+	void processData(LLCore::BufferArray * body, S32 body_offset, U8 *& data, S32 data_size) override;
 	void processFailure(LLCore::HttpStatus status) override;
 
 public:
@@ -656,7 +670,7 @@ protected:
 	LLMeshSkinInfoHandler& operator=(const LLMeshSkinInfoHandler &) = delete;	// Not defined
 
 public:
-	void processData(LLCore::BufferArray * body, S32 body_offset, U8 * data, S32 data_size) override;
+	void processData(LLCore::BufferArray * body, S32 body_offset, U8 *& data, S32 data_size) override;
 	void processFailure(LLCore::HttpStatus status) override;
 
 public:
@@ -682,7 +696,7 @@ protected:
 	LLMeshDecompositionHandler& operator=(const LLMeshDecompositionHandler &) = delete;	// Not defined
 
 public:
-	void processData(LLCore::BufferArray * body, S32 body_offset, U8 * data, S32 data_size) override;
+	void processData(LLCore::BufferArray * body, S32 body_offset, U8 *& data, S32 data_size) override;
 	void processFailure(LLCore::HttpStatus status) override;
 
 public:
@@ -708,7 +722,7 @@ protected:
 	LLMeshPhysicsShapeHandler operator=(const LLMeshPhysicsShapeHandler &) = delete;	// Not defined
 
 public:
-	void processData(LLCore::BufferArray * body, S32 body_offset, U8 * data, S32 data_size) override;
+	void processData(LLCore::BufferArray * body, S32 body_offset, U8 *& data, S32 data_size) override;
 	void processFailure(LLCore::HttpStatus status) override;
 
 public:
@@ -807,7 +821,9 @@ LLMeshRepoThread::LLMeshRepoThread()
   mHttpLegacyPolicyClass(LLCore::HttpRequest::DEFAULT_POLICY_ID),
   mHttpLargePolicyClass(LLCore::HttpRequest::DEFAULT_POLICY_ID),
   mLegacyGetMeshVersion(0),
-  mHttpPriority(0)
+  mHttpPriority(0),
+  mDecoder(nullptr),
+  mDecodedCache(nullptr)
 {
 	LLAppCoreHttp & app_core_http(LLAppViewer::instance()->getAppCoreHttp());
 
@@ -826,6 +842,8 @@ LLMeshRepoThread::LLMeshRepoThread()
 	mHttpPolicyClass = app_core_http.getPolicy(LLAppCoreHttp::AP_MESH2);
 	mHttpLegacyPolicyClass = app_core_http.getPolicy(LLAppCoreHttp::AP_MESH1);
 	mHttpLargePolicyClass = app_core_http.getPolicy(LLAppCoreHttp::AP_LARGE_MESH);
+	mDecodedCache = new LLMeshDecodedCache((U64) gSavedSettings.getU32("MeshDecodedCacheSize") * 1024 * 1024);
+	mDecoder = new LLMeshDecoder(this, gSavedSettings.getU32("MeshDecodeThreads"));
 }
 
 
@@ -836,6 +854,12 @@ LLMeshRepoThread::~LLMeshRepoThread()
 					   << ", Max Lock Holdoffs:  " << LLMeshRepository::sMaxLockHoldoffs
 					   << LL_ENDL;
 
+	// Decode threads push into our queues under mMutex
+	delete mDecoder;
+	mDecoder = nullptr;
+	delete mDecodedCache;
+	mDecodedCache = nullptr;
+
 	mHttpRequestSet.clear();
     mHttpHeaders.reset();
 
@@ -884,11 +908,11 @@ void LLMeshRepoThread::run()
 			// Dispatch all HttpHandler notifications
 			mHttpRequest->update(0L);
 		}
-		sRequestWaterLevel = mHttpRequestSet.size();			// Stats data update
+		sRequestWaterLevel = mHttpRequestSet.size() + mDecoder->getNumRequests();	// Stats data update
 			
 		// NOTE: order of queue processing intentionally favors LOD requests over header requests
 
-		while (!mLODReqQ.empty() && mHttpRequestSet.size() < sRequestHighWater)
+		while (!mLODReqQ.empty() && hasRequestSlot())
 		{
 			if (! mMutex)
 			{
@@ -909,7 +933,7 @@ void LLMeshRepoThread::run()
 			}
 		}
 
-		while (!mHeaderReqQ.empty() && mHttpRequestSet.size() < sRequestHighWater)
+		while (!mHeaderReqQ.empty() && hasRequestSlot())
 		{
 			if (! mMutex)
 			{
@@ -931,7 +955,7 @@ void LLMeshRepoThread::run()
 		// slightly different queue structures.  Stay off the mutex when
 		// performing long-duration actions.
 
-		if (mHttpRequestSet.size() < sRequestHighWater
+		if (hasRequestSlot()
 			&& (! mSkinRequests.empty()
 				|| ! mDecompositionRequests.empty()
 				|| ! mPhysicsShapeRequests.empty()))
@@ -941,11 +965,11 @@ void LLMeshRepoThread::run()
 			// so we bounce it.
 
 			mMutex->lock();
-			if (! mSkinRequests.empty() && mHttpRequestSet.size() < sRequestHighWater)
+			if (! mSkinRequests.empty() && hasRequestSlot())
 			{
 				std::set<LLUUID> incomplete;
 				std::set<LLUUID>::iterator iter(mSkinRequests.begin());
-				while (iter != mSkinRequests.end() && mHttpRequestSet.size() < sRequestHighWater)
+				while (iter != mSkinRequests.end() && hasRequestSlot())
 				{
 					LLUUID mesh_id = *iter;
 					mSkinRequests.erase(iter);
@@ -970,11 +994,11 @@ void LLMeshRepoThread::run()
 			// *TODO:  For UI/debug-oriented lists, we might drop the fine-
 			// grained locking as there's a lowered expectation of smoothness
 			// in these cases.
-			if (! mDecompositionRequests.empty() && mHttpRequestSet.size() < sRequestHighWater)
+			if (! mDecompositionRequests.empty() && hasRequestSlot())
 			{
 				std::set<LLUUID> incomplete;
 				std::set<LLUUID>::iterator iter(mDecompositionRequests.begin());
-				while (iter != mDecompositionRequests.end() && mHttpRequestSet.size() < sRequestHighWater)
+				while (iter != mDecompositionRequests.end() && hasRequestSlot())
 				{
 					LLUUID mesh_id = *iter;
 					mDecompositionRequests.erase(iter);
@@ -996,11 +1020,11 @@ void LLMeshRepoThread::run()
 			}
 
 			// holding lock, final list
-			if (! mPhysicsShapeRequests.empty() && mHttpRequestSet.size() < sRequestHighWater)
+			if (! mPhysicsShapeRequests.empty() && hasRequestSlot())
 			{
 				std::set<LLUUID> incomplete;
 				std::set<LLUUID>::iterator iter(mPhysicsShapeRequests.begin());
-				while (iter != mPhysicsShapeRequests.end() && mHttpRequestSet.size() < sRequestHighWater)
+				while (iter != mPhysicsShapeRequests.end() && hasRequestSlot())
 				{
 					LLUUID mesh_id = *iter;
 					mPhysicsShapeRequests.erase(iter);
@@ -1520,6 +1544,13 @@ void LLMeshRepoThread::decActiveHeaderRequests()
 	--LLMeshRepoThread::sActiveHeaderRequests;
 }
 
+// REPO THREAD
+bool LLMeshRepoThread::hasRequestSlot()
+{
+	return mHttpRequestSet.size() + mDecoder->getNumRequests() < sRequestHighWater
+		&& mDecoder->hasRequestSlot();
+}
+
 //return false if failed to get header
 bool LLMeshRepoThread::fetchMeshHeader(const LLVolumeParams& mesh_params)
 {
@@ -1606,6 +1637,15 @@ bool LLMeshRepoThread::fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod)
 		if (version <= MAX_MESH_VERSION && offset >= 0 && size > 0)
 		{
 
+			//check the decoded cache first, a hit there needs no unpacking
+			LLPointer<LLVolume> volume = new LLVolume(mesh_params, LLVolumeLODGroup::getVolumeScaleFromDetail(lod));
+			if (mDecodedCache->loadLOD(mesh_params, lod, volume))
+			{
+				LLMutexLock lock(mMutex);
+				mLoadedQ.push(LoadedMesh(volume, mesh_params, lod));
+				return true;
+			}
+
 			//check VFS for mesh asset
 			LLVFile file(gVFS, mesh_id, LLAssetType::AT_MESH);
 			if (file.getSize() >= offset+size)
@@ -1677,6 +1717,40 @@ bool LLMeshRepoThread::fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod)
 	return retval;
 }
 
+// The parts of a mesh header the repository reads, taken from the view
+// rather than building the whole tree
+static LLSD header_from_view(const LLSDView& header_view)
+{
+	static const char* const header_blocks[] = { "lowest_lod", "low_lod", "medium_lod", "high_lod",
+												 "skin", "physics_convex", "physics_mesh" };
+	LLSD header = LLSD::emptyMap();
+	LLSDView version = header_view["version"];
+	if (version.isDefined())
+	{
+		header["version"] = version.asInteger();
+	}
+	for (const char* name : header_blocks)
+	{
+		LLSDView block = header_view[name];
+		if (block.isMap())
+		{
+			LLSD& block_sd = header[name];
+			block_sd = LLSD::emptyMap();
+			LLSDView offset = block["offset"];
+			if (offset.isDefined())
+			{
+				block_sd["offset"] = offset.asInteger();
+			}
+			LLSDView size = block["size"];
+			if (size.isDefined())
+			{
+				block_sd["size"] = size.asInteger();
+			}
+		}
+	}
+	return header;
+}
+
 bool LLMeshRepoThread::headerReceived(const LLVolumeParams& mesh_params, U8* data, S32 data_size)
 {
 	const LLUUID mesh_id = mesh_params.getSculptID();
@@ -1685,27 +1759,26 @@ bool LLMeshRepoThread::headerReceived(const LLVolumeParams& mesh_params, U8* dat
 	U32 header_size = 0;
 	if (data_size > 0)
 	{
-		std::string res_str((char*) data, data_size);
+		// Parse the header in place rather than copying the whole
+		// response into a string and a stream first.
+		static const std::string deprecated_header("<? LLSD/Binary ?>");
 
-		std::string deprecated_header("<? LLSD/Binary ?>");
-
-		if (res_str.substr(0, deprecated_header.size()) == deprecated_header)
+		if (data_size > (S32) deprecated_header.size()
+			&& !memcmp(data, deprecated_header.data(), deprecated_header.size()))
 		{
-			res_str = res_str.substr(deprecated_header.size()+1, data_size);
-			header_size = deprecated_header.size()+1;
+			header_size = (U32) deprecated_header.size()+1;
 		}
-		data_size = res_str.size();
-
-		std::istringstream stream(res_str);
 
-		if (!LLSDSerialize::fromBinary(header, stream, data_size))
+		LLSDView header_view(data + header_size, data_size - header_size);
+		if (!header_view.isValid())
 		{
 			LL_WARNS(LOG_MESH) << "Mesh header parse error.  Not a valid mesh asset!  ID:  " << mesh_id
 							   << LL_ENDL;
 			return false;
 		}
 
-		header_size += stream.tellg();
+		header = header_from_view(header_view);
+		header_size += (U32) header_view.byteSize();
 	}
 	else
 	{
@@ -1750,18 +1823,24 @@ bool LLMeshRepoThread::lodReceived(const LLVolumeParams& mesh_params, S32 lod, U
 	}
 
 	LLPointer<LLVolume> volume = new LLVolume(mesh_params, LLVolumeLODGroup::getVolumeScaleFromDetail(lod));
-	std::string mesh_string((char*) data, data_size);
-	std::istringstream stream(mesh_string);
-
-	if (volume->unpackVolumeFaces(stream, data_size))
+	if (volume->unpackVolumeFaces(data, data_size))
 	{
 		if (volume->getNumFaces() > 0)
 		{
+			// Before anyone else can see the volume
+			std::vector<U8> faces;
+			bool cache = mDecodedCache->packLOD(volume, faces);
+
 			LoadedMesh mesh(volume, mesh_params, lod);
 			{
 				LLMutexLock lock(mMutex);
 				mLoadedQ.push(mesh);
 			}
+
+			if (cache)
+			{
+				mDecodedCache->storeLOD(mesh_params, lod, faces);
+			}
 			return true;
 		}
 	}
@@ -1891,6 +1970,72 @@ bool LLMeshRepoThread::physicsShapeReceived(const LLUUID& mesh_id, U8* data, S32
 	return true;
 }
 
+//----------------------------------------------------------------------------
+
+// DECODE THREADS.  Same work and failure handling the HTTP handlers used
+// to do inline.
+void LLMeshRepoThread::decode(LLMeshDecoder::Request* request)
+{
+	U8* data = request->mData;
+	S32 data_size = request->mDataSize;
+
+	bool decoded = false;
+	const char* what = "";
+	switch (request->mType)
+	{
+	case LLMeshDecoder::LOD:
+		decoded = lodReceived(request->mMeshParams, request->mLOD, data, data_size);
+		what = "LOD";
+		break;
+	case LLMeshDecoder::SKIN_INFO:
+		decoded = skinInfoReceived(request->mMeshID, data, data_size);
+		what = "skin info";
+		break;
+	case LLMeshDecoder::DECOMPOSITION:
+		decoded = decompositionReceived(request->mMeshID, data, data_size);
+		what = "decomposition";
+		break;
+	case LLMeshDecoder::PHYSICS_SHAPE:
+		decoded = physicsShapeReceived(request->mMeshID, data, data_size);
+		what = "physics shape";
+		break;
+	}
+
+	if (decoded)
+	{
+		// good fetch from sim, write to VFS for caching
+		LLVFile file(gVFS, request->mMeshID, LLAssetType::AT_MESH, LLVFile::WRITE);
+
+		S32 offset = request->mCacheOffset;
+		S32 size = request->mCacheSize;
+
+		if (file.getSize() >= offset+size && data_size >= size)
+		{
+			file.seek(offset);
+			file.write(data, size);
+
+			// The stats are plain counters shared by every decode thread
+			LLMutexLock lock(mMutex);
+			LLMeshRepository::sCacheBytesWritten += size;
+			++LLMeshRepository::sCacheWrites;
+		}
+	}
+	else
+	{
+		LL_WARNS(LOG_MESH) << "Error during mesh " << what << " processing.  ID:  " << request->mMeshID
+						   << ", Unknown reason.  Not retrying."
+						   << LL_ENDL;
+		if (request->mType == LLMeshDecoder::LOD)
+		{
+			LLMutexLock lock(mMutex);
+			mUnavailableQ.push(LODRequest(request->mMeshParams, request->mLOD));
+		}
+		// *TODO:  Mark mesh unavailable on error for the other types
+	}
+}
+
+//----------------------------------------------------------------------------
+
 LLMeshUploadThread::LLMeshUploadThread(LLMeshUploadThread::instance_list& data, LLVector3& scale, bool upload_textures,
 									   bool upload_skin, bool upload_joints, bool lock_scale_if_joint_position,
                                        const std::string & upload_url, bool do_upload,
@@ -2936,19 +3081,28 @@ void LLMeshHandlerBase::onCompleted(LLCore::HttpHandle handle, LLCore::HttpRespo
 				goto common_exit;
 			}
 			
-			// *TODO: Try to get rid of data copying and add interfaces
-			// that support BufferArray directly.  Introduce a two-phase
-			// handler, optional first that takes a body, fallback second
-			// that requires a temporary allocation and data copy.
+			// Take the body's storage when the response starts where
+			// we asked and arrived in one piece, otherwise copy out
+			// the part we want.  Handlers don't use 'body' itself.
 			body_offset = mOffset - offset;
-			data = new U8[data_size - body_offset];
-			body->read(body_offset, (char *) data, data_size - body_offset);
+			if (! body_offset)
+			{
+				size_t adopted_size(0);
+				data = (U8 *) body->adoptData(&adopted_size);
+				llassert_always(! data || adopted_size == (size_t) data_size);
+			}
+			if (! data)
+			{
+				data = (U8 *) ll_aligned_malloc_16(data_size - body_offset);
+				body->read(body_offset, (char *) data, data_size - body_offset);
+			}
 			LLMeshRepository::sBytesReceived += data_size;
 		}
 
 		processData(body, body_offset, data, data_size - body_offset);
 
-		delete [] data;
+		// Unless a handler kept it for the mesh decoder
+		ll_aligned_free_16(data);
 	}
 
 	// Release handler
@@ -2989,7 +3143,7 @@ void LLMeshHeaderHandler::processFailure(LLCore::HttpStatus status)
 }
 
 void LLMeshHeaderHandler::processData(LLCore::BufferArray * /* body */, S32 /* body_offset */,
-									  U8 * data, S32 data_size)
+									  U8 *& data, S32 data_size)
 {
 	LLUUID mesh_id = mMeshParams.getSculptID();
 	bool success = (! MESH_HEADER_PROCESS_FAILED) && gMeshRepo.mThread->headerReceived(mMeshParams, data, data_size);
@@ -3111,23 +3265,19 @@ void LLMeshLODHandler::processFailure(LLCore::HttpStatus status)
 }
 
 void LLMeshLODHandler::processData(LLCore::BufferArray * /* body */, S32 /* body_offset */,
-								   U8 * data, S32 data_size)
+								   U8 *& data, S32 data_size)
 {
-	if ((! MESH_LOD_PROCESS_FAILED) && gMeshRepo.mThread->lodReceived(mMeshParams, mLOD, data, data_size))
-	{
-		// good fetch from sim, write to VFS for caching
-		LLVFile file(gVFS, mMeshParams.getSculptID(), LLAssetType::AT_MESH, LLVFile::WRITE);
-
-		S32 offset = mOffset;
-		S32 size = mRequestedBytes;
-
-		if (file.getSize() >= offset+size)
-		{
-			file.seek(offset);
-			file.write(data, size);
-			LLMeshRepository::sCacheBytesWritten += size;
-			++LLMeshRepository::sCacheWrites;
-		}
+	if (! MESH_LOD_PROCESS_FAILED)
+	{
+		// Decoded and written to the VFS by the mesh decoder
+		LLMeshDecoder::Request* request = new LLMeshDecoder::Request(LLMeshDecoder::LOD, mMeshParams.getSculptID());
+		request->mMeshParams = mMeshParams;
+		request->mLOD = mLOD;
+		request->adoptData(data, data_size);
+		request->mCacheOffset = mOffset;
+		request->mCacheSize = mRequestedBytes;
+		request->mHandler = shared_from_this();
+		gMeshRepo.mThread->mDecoder->addRequest(request);
 	}
 	else
 	{
@@ -3159,23 +3309,17 @@ void LLMeshSkinInfoHandler::processFailure(LLCore::HttpStatus status)
 }
 
 void LLMeshSkinInfoHandler::processData(LLCore::BufferArray * /* body */, S32 /* body_offset */,
-										U8 * data, S32 data_size)
+										U8 *& data, S32 data_size)
 {
-	if ((! MESH_SKIN_INFO_PROCESS_FAILED) && gMeshRepo.mThread->skinInfoReceived(mMeshID, data, data_size))
+	if (! MESH_SKIN_INFO_PROCESS_FAILED)
 	{
-		// good fetch from sim, write to VFS for caching
-		LLVFile file(gVFS, mMeshID, LLAssetType::AT_MESH, LLVFile::WRITE);
-
-		S32 offset = mOffset;
-		S32 size = mRequestedBytes;
-
-		if (file.getSize() >= offset+size)
-		{
-			LLMeshRepository::sCacheBytesWritten += size;
-			++LLMeshRepository::sCacheWrites;
-			file.seek(offset);
-			file.write(data, size);
-		}
+		// Decoded and written to the VFS by the mesh decoder
+		LLMeshDecoder::Request* request = new LLMeshDecoder::Request(LLMeshDecoder::SKIN_INFO, mMeshID);
+		request->adoptData(data, data_size);
+		request->mCacheOffset = mOffset;
+		request->mCacheSize = mRequestedBytes;
+		request->mHandler = shared_from_this();
+		gMeshRepo.mThread->mDecoder->addRequest(request);
 	}
 	else
 	{
@@ -3205,23 +3349,17 @@ void LLMeshDecompositionHandler::processFailure(LLCore::HttpStatus status)
 }
 
 void LLMeshDecompositionHandler::processData(LLCore::BufferArray * /* body */, S32 /* body_offset */,
-											 U8 * data, S32 data_size)
+											 U8 *& data, S32 data_size)
 {
-	if ((! MESH_DECOMP_PROCESS_FAILED) && gMeshRepo.mThread->decompositionReceived(mMeshID, data, data_size))
+	if (! MESH_DECOMP_PROCESS_FAILED)
 	{
-		// good fetch from sim, write to VFS for caching
-		LLVFile file(gVFS, mMeshID, LLAssetType::AT_MESH, LLVFile::WRITE);
-
-		S32 offset = mOffset;
-		S32 size = mRequestedBytes;
-
-		if (file.getSize() >= offset+size)
-		{
-			LLMeshRepository::sCacheBytesWritten += size;
-			++LLMeshRepository::sCacheWrites;
-			file.seek(offset);
-			file.write(data, size);
-		}
+		// Decoded and written to the VFS by the mesh decoder
+		LLMeshDecoder::Request* request = new LLMeshDecoder::Request(LLMeshDecoder::DECOMPOSITION, mMeshID);
+		request->adoptData(data, data_size);
+		request->mCacheOffset = mOffset;
+		request->mCacheSize = mRequestedBytes;
+		request->mHandler = shared_from_this();
+		gMeshRepo.mThread->mDecoder->addRequest(request);
 	}
 	else
 	{
@@ -3250,23 +3388,17 @@ void LLMeshPhysicsShapeHandler::processFailure(LLCore::HttpStatus status)
 }
 
 void LLMeshPhysicsShapeHandler::processData(LLCore::BufferArray * /* body */, S32 /* body_offset */,
-											U8 * data, S32 data_size)
+											U8 *& data, S32 data_size)
 {
-	if ((! MESH_PHYS_SHAPE_PROCESS_FAILED) && gMeshRepo.mThread->physicsShapeReceived(mMeshID, data, data_size))
+	if (! MESH_PHYS_SHAPE_PROCESS_FAILED)
 	{
-		// good fetch from sim, write to VFS for caching
-		LLVFile file(gVFS, mMeshID, LLAssetType::AT_MESH, LLVFile::WRITE);
-
-		S32 offset = mOffset;
-		S32 size = mRequestedBytes;
-
-		if (file.getSize() >= offset+size)
-		{
-			LLMeshRepository::sCacheBytesWritten += size;
-			++LLMeshRepository::sCacheWrites;
-			file.seek(offset);
-			file.write(data, size);
-		}
+		// Decoded and written to the VFS by the mesh decoder
+		LLMeshDecoder::Request* request = new LLMeshDecoder::Request(LLMeshDecoder::PHYSICS_SHAPE, mMeshID);
+		request->adoptData(data, data_size);
+		request->mCacheOffset = mOffset;
+		request->mCacheSize = mRequestedBytes;
+		request->mHandler = shared_from_this();
+		gMeshRepo.mThread->mDecoder->addRequest(request);
 	}
 	else
 	{
@@ -3461,6 +3593,28 @@ S32 LLMeshRepository::loadMesh(LLVOVolume* vobj, const LLVolumeParams& mesh_para
 	return detail;
 }
 
+// How much the objects waiting on a mesh stand to gain from it: the
+// largest of their screen-space sizes.
+static F32 get_load_score(const std::set<LLUUID>& object_ids)
+{
+	F32 max_score = 0.f;
+	for (std::set<LLUUID>::const_iterator obj_iter = object_ids.begin(); obj_iter != object_ids.end(); ++obj_iter)
+	{
+		LLViewerObject* object = gObjectList.findObject(*obj_iter);
+		
+		if (object)
+		{
+			LLDrawable* drawable = object->mDrawable;
+			if (drawable)
+			{
+				F32 cur_score = drawable->getRadius()/llmax(drawable->mDistanceWRTCamera, 1.f);
+				max_score = llmax(max_score, cur_score);
+			}
+		}
+	}
+	return max_score;
+}
+
 void LLMeshRepository::notifyLoadedMeshes()
 { //called from main thread
 	LL_RECORD_BLOCK_TIME(FTM_MESH_FETCH);
@@ -3649,23 +3803,7 @@ void LLMeshRepository::notifyLoadedMeshes()
 				{
 					for (mesh_load_map::iterator iter = mLoadingMeshes[i].begin();  iter != mLoadingMeshes[i].end(); ++iter)
 					{
-						F32 max_score = 0.f;
-						for (std::set<LLUUID>::iterator obj_iter = iter->second.begin(); obj_iter != iter->second.end(); ++obj_iter)
-						{
-							LLViewerObject* object = gObjectList.findObject(*obj_iter);
-							
-							if (object)
-							{
-								LLDrawable* drawable = object->mDrawable;
-								if (drawable)
-								{
-									F32 cur_score = drawable->getRadius()/llmax(drawable->mDistanceWRTCamera, 1.f);
-									max_score = llmax(max_score, cur_score);
-								}
-							}
-						}
-				
-						score_map[iter->first.getSculptID()] = max_score;
+						score_map[iter->first.getSculptID()] = get_load_score(iter->second);
 					}
 				}
 
@@ -3690,6 +3828,36 @@ void LLMeshRepository::notifyLoadedMeshes()
 			}
 		}
 
+		//decode the most important fetched meshes first
+		if (mThread->mDecoder->hasPendingRequests())
+		{
+			std::map<LLUUID, F32> score_map;
+			mThread->mDecoder->getPendingMeshIDs(score_map);
+
+			for (U32 i = 0; i < 4; ++i)
+			{
+				for (mesh_load_map::iterator iter = mLoadingMeshes[i].begin(); iter != mLoadingMeshes[i].end(); ++iter)
+				{
+					std::map<LLUUID, F32>::iterator score = score_map.find(iter->first.getSculptID());
+					if (score != score_map.end())
+					{
+						score->second = llmax(score->second, get_load_score(iter->second));
+					}
+				}
+			}
+
+			for (std::map<LLUUID, F32>::iterator score = score_map.begin(); score != score_map.end(); ++score)
+			{
+				skin_load_map::iterator iter = mLoadingSkins.find(score->first);
+				if (iter != mLoadingSkins.end())
+				{
+					score->second = llmax(score->second, get_load_score(iter->second));
+				}
+			}
+
+			mThread->mDecoder->setScores(score_map);
+		}
+
 		//send skin info requests
 		while (!mPendingSkinRequests.empty())
 		{
@@ -39,6 +39,7 @@
 #include "httpheaders.h"
 #include "httphandler.h"
 #include "llthread.h"
+#include "llmeshdecoder.h"
 
 #include <boost/unordered_map.hpp> // <alchemy/>
 
@@ -48,6 +49,7 @@
 #include "lluploadfloaterobservers.h"
 
 class LLVOVolume;
+class LLMeshDecodedCache;
 class LLMutex;
 class LLCondition;
 class LLVFS;
@@ -170,7 +172,7 @@ public:
 
 };
 
-class LLMeshRepoThread : public LLThread
+class LLMeshRepoThread : public LLThread, public LLMeshDecoder::Responder
 {
 public:
 
@@ -293,6 +295,12 @@ public:
 	int mLegacyGetMeshVersion;
 	std::string mGetMeshCapability;
 
+	// Decodes what the HTTP handlers fetch
+	LLMeshDecoder* mDecoder;
+
+	// Unpacked LODs, checked before the raw assets in the VFS
+	LLMeshDecodedCache* mDecodedCache;
+
 	LLMeshRepoThread();
 	~LLMeshRepoThread();
 
@@ -301,6 +309,10 @@ public:
 	void lockAndLoadMeshLOD(const LLVolumeParams& mesh_params, S32 lod);
 	void loadMeshLOD(const LLVolumeParams& mesh_params, S32 lod);
 
+	// REPO THREAD.  Whether another fetch may be issued.  Fetched data
+	// waiting on the decoder still holds its request slot.
+	bool hasRequestSlot();
+
 	bool fetchMeshHeader(const LLVolumeParams& mesh_params);
 	bool fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod);
 	bool headerReceived(const LLVolumeParams& mesh_params, U8* data, S32 data_size);
@@ -310,6 +322,10 @@ public:
 	bool physicsShapeReceived(const LLUUID& mesh_id, U8* data, S32 data_size);
 	LLSD& getMeshHeader(const LLUUID& mesh_id);
 
+	// Hands a fetched request to the matching *Received() and writes the
+	// data to the VFS once it decodes
+	void decode(LLMeshDecoder::Request* request) override;
+
 	void notifyLoadedMeshes();
 	S32 getActualMeshLOD(const LLVolumeParams& mesh_params, S32 lod);
 	
@@ -0,0 +1,275 @@
+/**
+ * @file llobjectupdatedecoder.cpp
+ * @brief Decodes the cache fields of compressed object updates on worker threads.
+ *
+ * $LicenseInfo:firstyear=2001&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llobjectupdatedecoder.h"
+
+#include "llstl.h"
+#include "lltimer.h"
+#include "message.h"
+
+// SpecialCode bits, as tested by LLViewerObject::unpackParentID()
+const U32 SPECIAL_CODE_HAS_PARENT = 0x20;
+const U32 SPECIAL_CODE_HAS_OMEGA = 0x80;
+
+LLCompressedObjectInfo::LLCompressedObjectInfo()
+:	mLocalID(0),
+	mCRC(0),
+	mParentID(0)
+{
+}
+
+LLObjectUpdateDecoder::LLObjectUpdateDecoder(const Offsets& offsets)
+:	mOffsets(offsets)
+{
+}
+
+// Same fields, in the same byte order, as LLViewerRegion::cacheFullUpdate()
+// and LLViewerObject::extractSpatialExtents() read through the data packer.
+bool LLObjectUpdateDecoder::decode(const U8* data, S32 size, LLCompressedObjectInfo& info) const
+{
+	if (!data || size < 0)
+	{
+		return false;
+	}
+
+	const U32 usize = (U32)size;
+	if (usize < mOffsets.mLocalID + sizeof(U32)
+		|| usize < mOffsets.mCRC + sizeof(U32)
+		|| usize < mOffsets.mScale + sizeof(LLVector3)
+		|| usize < mOffsets.mPos + sizeof(LLVector3)
+		|| usize < mOffsets.mRot + sizeof(LLVector3)
+		|| usize < mOffsets.mSpecialCode + sizeof(U32))
+	{
+		return false;
+	}
+
+	U32 special_code;
+	htonmemcpy(&info.mLocalID, data + mOffsets.mLocalID, MVT_U32, 4);
+	htonmemcpy(&info.mCRC, data + mOffsets.mCRC, MVT_U32, 4);
+	htonmemcpy(&special_code, data + mOffsets.mSpecialCode, MVT_U32, 4);
+	htonmemcpy(info.mScale.mV, data + mOffsets.mScale, MVT_LLVector3, 12);
+	htonmemcpy(info.mPosition.mV, data + mOffsets.mPos, MVT_LLVector3, 12);
+
+	LLVector3 rot;
+	htonmemcpy(rot.mV, data + mOffsets.mRot, MVT_LLVector3, 12);
+	info.mRotation.unpackFromVector3(rot);
+
+	info.mParentID = 0;
+	if (special_code & SPECIAL_CODE_HAS_PARENT)
+	{
+		U32 offset = mOffsets.mParentID;
+		if (!(special_code & SPECIAL_CODE_HAS_OMEGA))
+		{
+			offset -= sizeof(LLVector3);
+		}
+		if (usize < offset + sizeof(U32))
+		{
+			return false;
+		}
+		htonmemcpy(&info.mParentID, data + offset, MVT_U32, 4);
+	}
+
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+LLObjectUpdateBatch::LLObjectUpdateBatch()
+:	mRegionHandle(0)
+{
+}
+
+U8* LLObjectUpdateBatch::addBlock(U32 flags, S32 size)
+{
+	Block block;
+	block.mUpdateFlags = flags;
+	block.mOffset = (U32)mData.size();
+	block.mSize = llmax(size, 0);
+	block.mDecoded = false;
+	mBlocks.push_back(block);
+	mData.resize(mData.size() + block.mSize);
+	return block.mSize ? &mData[block.mOffset] : nullptr;
+}
+
+void LLObjectUpdateBatch::decode(const LLObjectUpdateDecoder& decoder)
+{
+	LLTimer timer;
+	for (Block& block : mBlocks)
+	{
+		block.mDecoded = decoder.decode(getData(block), block.mSize, block.mInfo);
+	}
+	mDecodeTime = F64Seconds(timer.getElapsedTimeF64());
+}
+
+//----------------------------------------------------------------------------
+
+LLObjectUpdateDecodeQueue::LLObjectUpdateDecodeQueue(const LLObjectUpdateDecoder& decoder, U32 num_threads)
+:	mDecoder(decoder),
+	mNumPending(0)
+{
+	for (U32 i = 0; i < num_threads; ++i)
+	{
+		DecodeThread* thread = new DecodeThread(llformat("objectdecode %d", i), this);
+		mThreads.push_back(thread);
+		thread->start();
+	}
+	LL_INFOS() << "Object update decoder using " << num_threads << " threads" << LL_ENDL;
+}
+
+LLObjectUpdateDecodeQueue::~LLObjectUpdateDecodeQueue()
+{
+	for (DecodeThread* thread : mThreads)
+	{
+		thread->shutdown();
+	}
+	std::for_each(mThreads.begin(), mThreads.end(), DeletePointer());
+	mThreads.clear();
+
+	for (Entry& entry : mBatches)
+	{
+		delete entry.mBatch;
+	}
+	mBatches.clear();
+}
+
+// MAIN THREAD
+void LLObjectUpdateDecodeQueue::addBatch(LLObjectUpdateBatch* batch)
+{
+	{
+		LLMutexLock lock(&mCondition);
+		Entry entry = { batch, PENDING };
+		mBatches.push_back(entry);
+		++mNumPending;
+	}
+
+	for (DecodeThread* thread : mThreads)
+	{
+		thread->wake();
+	}
+}
+
+// MAIN THREAD
+LLObjectUpdateBatch* LLObjectUpdateDecodeQueue::popBatch()
+{
+	mCondition.lock();
+	if (mBatches.empty())
+	{
+		mCondition.unlock();
+		return nullptr;
+	}
+
+	Entry* entry = &mBatches.front();
+	if (entry->mState == PENDING)
+	{
+		entry->mState = DECODING;
+		--mNumPending;
+		mCondition.unlock();
+		decodeBatch(entry);
+		mCondition.lock();
+	}
+	while (entry->mState != DECODED)
+	{
+		mCondition.wait();
+	}
+	LLObjectUpdateBatch* batch = entry->mBatch;
+	mBatches.pop_front();
+	mCondition.unlock();
+
+	return batch;
+}
+
+bool LLObjectUpdateDecodeQueue::hasPendingBatches()
+{
+	LLMutexLock lock(&mCondition);
+	return mNumPending > 0;
+}
+
+LLObjectUpdateDecodeQueue::Entry* LLObjectUpdateDecodeQueue::claimBatch()
+{
+	LLMutexLock lock(&mCondition);
+	if (mNumPending > 0)
+	{
+		for (Entry& entry : mBatches)
+		{
+			if (entry.mState == PENDING)
+			{
+				entry.mState = DECODING;
+				--mNumPending;
+				return &entry;
+			}
+		}
+	}
+	return nullptr;
+}
+
+// Entries only leave mBatches through popBatch(), which waits for them to
+// be decoded, so entry stays valid until this returns.
+void LLObjectUpdateDecodeQueue::decodeBatch(Entry* entry)
+{
+	entry->mBatch->decode(mDecoder);
+
+	LLMutexLock lock(&mCondition);
+	entry->mState = DECODED;
+	mCondition.broadcast();
+}
+
+//----------------------------------------------------------------------------
+
+LLObjectUpdateDecodeQueue::DecodeThread::DecodeThread(const std::string& name, LLObjectUpdateDecodeQueue* queue)
+:	LLThread(name),
+	mQueue(queue)
+{
+}
+
+// virtual
+bool LLObjectUpdateDecodeQueue::DecodeThread::runCondition()
+{
+	// mDataLock is locked here; the queue has its own lock
+	return mQueue->hasPendingBatches();
+}
+
+// virtual
+void LLObjectUpdateDecodeQueue::DecodeThread::run()
+{
+	while (true)
+	{
+		// Sleeps until addBatch() wakes us with work
+		checkPause();
+
+		if (isQuitting())
+		{
+			break;
+		}
+
+		while (Entry* entry = mQueue->claimBatch())
+		{
+			mQueue->decodeBatch(entry);
+		}
+	}
+	LL_INFOS() << "Object decode thread " << mName << " EXITING." << LL_ENDL;
+}
@@ -0,0 +1,174 @@
+/**
+ * @file llobjectupdatedecoder.h
+ * @brief Decodes the cache fields of compressed object updates on worker threads.
+ *
+ * $LicenseInfo:firstyear=2001&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLOBJECTUPDATEDECODER_H
+#define LL_LLOBJECTUPDATEDECODER_H
+
+#include <deque>
+#include <vector>
+
+#include "llmath.h"
+#include "llmutex.h"
+#include "llquaternion.h"
+#include "llthread.h"
+#include "llunits.h"
+#include "v3math.h"
+
+// The fields of one ObjectUpdateCompressed block that the object cache
+// needs before the object itself is created.
+struct LLCompressedObjectInfo
+{
+	LLCompressedObjectInfo();
+
+	U32 mLocalID;
+	U32 mCRC;
+	U32 mParentID;
+	LLVector3 mPosition;
+	LLVector3 mScale;
+	LLQuaternion mRotation;
+};
+
+// Reads LLCompressedObjectInfo straight out of a compressed update at
+// fixed offsets, rather than looking each field up by name in
+// LLViewerObject's data map the way unpackU32(), unpackParentID() and
+// extractSpatialExtents() do.  Stateless, so safe to share.
+class LLObjectUpdateDecoder
+{
+public:
+	// Offsets into a compressed update, as in LLViewerObject's data map
+	struct Offsets
+	{
+		U32 mLocalID;
+		U32 mCRC;
+		U32 mScale;
+		U32 mPos;
+		U32 mRot;
+		U32 mSpecialCode;
+		// Where ParentID is when Omega is present
+		U32 mParentID;
+	};
+
+	LLObjectUpdateDecoder(const Offsets& offsets);
+
+	// FALSE if the block is too short to hold the fields, in which case
+	// the caller should fall back to the data packer.
+	bool decode(const U8* data, S32 size, LLCompressedObjectInfo& info) const;
+
+private:
+	Offsets mOffsets;
+};
+
+// The cacheable blocks of one ObjectUpdateCompressed message, copied out
+// of the message into one buffer so the message system can reuse its own.
+struct LLObjectUpdateBatch
+{
+	struct Block
+	{
+		U32 mUpdateFlags;
+		U32 mOffset;		// into mData
+		S32 mSize;
+		// FALSE if the block was too short for the decoder, in which case
+		// it goes through the data packer when it is applied
+		bool mDecoded;
+		LLCompressedObjectInfo mInfo;
+	};
+
+	LLObjectUpdateBatch();
+
+	// Makes room for a block of size bytes and returns where to copy it
+	U8* addBlock(U32 flags, S32 size);
+	const U8* getData(const Block& block) const { return mData.empty() ? nullptr : &mData[block.mOffset]; }
+
+	void decode(const LLObjectUpdateDecoder& decoder);
+
+	U64 mRegionHandle;
+	std::vector<U8> mData;
+	std::vector<Block> mBlocks;
+	F64Milliseconds mDecodeTime;
+};
+
+// Decodes batches of object cache updates on a small pool of threads.
+// Batches come back out of popBatch() in the order they went in, so the
+// main thread can apply them exactly as if it had decoded each message
+// as it arrived.
+class LLObjectUpdateDecodeQueue
+{
+public:
+	// With no threads, batches are decoded by popBatch()
+	LLObjectUpdateDecodeQueue(const LLObjectUpdateDecoder& decoder, U32 num_threads);
+	~LLObjectUpdateDecodeQueue();
+
+	// MAIN THREAD.  Takes ownership of batch.
+	void addBatch(LLObjectUpdateBatch* batch);
+
+	// MAIN THREAD.  Returns the oldest batch once it is decoded, or NULL if
+	// none are queued.  If no thread has started on it yet it is decoded
+	// here rather than waited for.  The caller deletes the batch.
+	LLObjectUpdateBatch* popBatch();
+
+	bool hasPendingBatches();
+	U32 getNumThreads() const { return (U32)mThreads.size(); }
+
+private:
+	class DecodeThread : public LLThread
+	{
+	public:
+		DecodeThread(const std::string& name, LLObjectUpdateDecodeQueue* queue);
+
+	private:
+		bool runCondition() override;
+		void run() override;
+
+		LLObjectUpdateDecodeQueue* mQueue;
+	};
+
+	enum EState
+	{
+		PENDING,
+		DECODING,
+		DECODED
+	};
+	struct Entry
+	{
+		LLObjectUpdateBatch* mBatch;
+		EState mState;
+	};
+
+	// Marks the oldest pending batch as being decoded and returns it
+	Entry* claimBatch();
+	void decodeBatch(Entry* entry);
+
+	const LLObjectUpdateDecoder& mDecoder;
+
+	// Guards mBatches, mNumPending and each entry's mState
+	LLCondition mCondition;
+	std::deque<Entry> mBatches;
+	S32 mNumPending;
+
+	std::vector<DecodeThread*> mThreads;
+};
+
+#endif // LL_LLOBJECTUPDATEDECODER_H
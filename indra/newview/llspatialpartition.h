@@ -52,6 +52,8 @@ class LLSpatialPartition;
 class LLSpatialBridge;
 class LLSpatialGroup;
 class LLViewerRegion;
+class LLFaceGeometryBatch;
+class LLFaceGeometryQueue;
 
 void pushVerts(LLFace* face, U32 mask);
 
@@ -631,7 +633,13 @@ private:
 	void allocateFaces(U32 pMaxFaceCount);
 	void freeFaces();
 
+	// Buffers genDrawInfo() filled through sGeometryBatch, flushed once it has run
+	std::vector<LLPointer<LLVertexBuffer> > mLockedBuffers;
+
 	static int32_t sInstanceCount;
+	static LLFaceGeometryQueue* sGeometryQueue;
+	// The current group's geometry jobs
+	static LLFaceGeometryBatch* sGeometryBatch;
 	static LLFace** sFullbrightFaces;
 	static LLFace** sBumpFaces;
 	static LLFace** sSimpleFaces;
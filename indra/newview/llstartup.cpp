@@ -582,6 +582,31 @@ bool idle_startup()
 				msg->mPacketRing.setUseOutThrottle(TRUE);
 				msg->mPacketRing.setOutBandwidth(outBandwidth);
 			}
+
+			// Keep reading the socket while the main thread is busy.  The
+			// simulated inbound throttle needs the reads on this thread.
+			if (gSavedSettings.getBOOL("MessageReceiveThread") && inBandwidth == 0.f)
+			{
+				msg->startReceiveThread();
+			}
+
+			// Hold outgoing packets for one send per frame, which also lets
+			// waiting acks ride on them.  The simulated outbound throttle
+			// sends on its own schedule.
+			if (gSavedSettings.getBOOL("MessageBatchSends") && outBandwidth == 0.f)
+			{
+				msg->setBatchSends(true);
+			}
+
+			std::string capture_file = gSavedSettings.getString("PacketCaptureFile");
+			if (!capture_file.empty())
+			{
+				if (capture_file.find_first_of("/\\") == std::string::npos)
+				{
+					capture_file = gDirUtilp->getExpandedFilename(LL_PATH_LOGS, capture_file);
+				}
+				msg->startPacketCapture(capture_file);
+			}
 		}
 
 		// <polarity> Save and restore logging level
@@ -2356,6 +2381,7 @@ void use_circuit_callback(void**, S32 result)
 void register_viewer_callbacks(LLMessageSystem* msg)
 {
 	msg->setHandlerFuncFast(_PREHASH_LayerData,				process_layer_data );
+	msg->setDecodedByHandlerFast(_PREHASH_LayerData);
 	msg->setHandlerFuncFast(_PREHASH_ImageData,				LLViewerTextureList::receiveImageHeader );
 	msg->setHandlerFuncFast(_PREHASH_ImagePacket,				LLViewerTextureList::receiveImagePacket );
 	msg->setHandlerFuncFast(_PREHASH_ObjectUpdate,				process_object_update );
@@ -2401,6 +2427,7 @@ void register_viewer_callbacks(LLMessageSystem* msg)
 
 	msg->setHandlerFuncFast(_PREHASH_MoneyBalanceReply,		process_money_balance_reply, nullptr);
 	msg->setHandlerFuncFast(_PREHASH_CoarseLocationUpdate,		LLWorld::processCoarseUpdate, nullptr);
+	msg->setDecodedByHandlerFast(_PREHASH_CoarseLocationUpdate);
 	msg->setHandlerFuncFast(_PREHASH_ReplyTaskInventory, 		LLViewerObject::processTaskInv, nullptr);
 	msg->setHandlerFuncFast(_PREHASH_DerezContainer,			process_derez_container, nullptr);
 	msg->setHandlerFuncFast(_PREHASH_ScriptRunningReply,
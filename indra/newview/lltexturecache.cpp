@@ -796,10 +796,15 @@ LLTextureCache::LLTextureCache(bool threaded)
 	  mHeaderMutex(),
 	  mListMutex(),
 	  mFastCacheMutex(),
-	  mHeaderAPRFile(NULL),
+	  mHeaderFP(NULL),
+	  mMappedEntries(0),
 	  mReadOnly(TRUE), //do not allow to change the texture cache until setReadOnly() is called.
+	  mLRUTime(0),
+	  mHeaderIndexLoaded(false),
 	  mTexturesSizeTotal(0),
 	  mDoPurge(false),
+	  mValidateOnPurge(false),
+	  mValidateIdx(0),
 	  mFastCachep(NULL),
 	  mFastCachePoolp(NULL),
 	  mFastCachePadBuffer(NULL)
@@ -810,6 +815,7 @@ LLTextureCache::~LLTextureCache()
 {
 	clearDeleteList() ;
 	writeUpdatedEntries() ;
+	closeHeaderEntriesFile();
 	delete mFastCachep;
 	delete mFastCachePoolp;
 	ll_aligned_free_16(mFastCachePadBuffer);
@@ -817,6 +823,18 @@ LLTextureCache::~LLTextureCache()
 
 //////////////////////////////////////////////////////////////////////////////
 
+//virtual
+void LLTextureCache::threadedUpdate()
+{
+	// Build the header index here rather than on whichever thread first
+	// looks a texture up
+	if (!mHeaderIndexLoaded.load(std::memory_order_acquire))
+	{
+		LLMutexLock lock(&mHeaderMutex);
+		ensureHeaderIndex();
+	}
+}
+
 //virtual
 S32 LLTextureCache::update(F32 max_time_ms)
 {
@@ -889,10 +907,8 @@ std::string LLTextureCache::getTextureFileName(const LLUUID& id)
 //debug
 BOOL LLTextureCache::isInCache(const LLUUID& id) 
 {
-	LLMutexLock lock(&mHeaderMutex);
-	id_map_t::const_iterator iter = mHeaderIDMap.find(id);
-	
-	return (iter != mHeaderIDMap.end()) ;
+	Entry entry;
+	return findHeaderEntry(id, entry) >= 0;
 }
 
 //debug
@@ -962,7 +978,7 @@ void LLTextureCache::purgeCache(ELLPath location, bool remove_dir)
 	if (!mReadOnly)
 	{
 		setDirNames(location);
-		llassert_always(mHeaderAPRFile == NULL);
+		llassert_always(mHeaderFP == NULL);
 
 		//remove the legacy cache if exists
 		std::string texture_dir = mTexturesDirName ;
@@ -1035,7 +1051,14 @@ U64 LLTextureCache::initCache(ELLPath location, U64 max_size, BOOL texture_cache
 		}
 	}
 	readHeaderCache();
-	purgeTextures(true); // calc mTexturesSize and make some room in the texture cache if we need it
+
+	// The index and the total texture size are only known once the entries
+	// have been walked, so make room and validate 1/256th of the files on
+	// the first purge rather than here.
+	mValidateIdx = gSavedSettings.getU32("CacheValidateCounter");
+	gSavedSettings.setU32("CacheValidateCounter", (mValidateIdx + 1) % 256);
+	mValidateOnPurge = true;
+	mDoPurge = true;
 
 	llassert_always(getPending() == 0) ; //should not start accessing the texture cache before initialized.
 	openFastCache(true);
@@ -1046,34 +1069,70 @@ U64 LLTextureCache::initCache(ELLPath location, U64 max_size, BOOL texture_cache
 //----------------------------------------------------------------------------
 // mHeaderMutex must be locked for the following functions!
 
-LLAPRFile* LLTextureCache::openHeaderEntriesFile(bool readonly, S32 offset)
+// Maps texture.entries with room for at least sCacheMaxEntries records.
+// Read-only caches map whatever is on disk.
+bool LLTextureCache::openHeaderEntriesFile()
 {
-	llassert_always(mHeaderAPRFile == NULL);
-	apr_int32_t flags = readonly ? APR_READ|APR_BINARY : APR_READ|APR_WRITE|APR_BINARY;
-	mHeaderAPRFile = new LLAPRFile(mHeaderEntriesFileName, flags, getLocalAPRFilePool());
-	if(offset > 0)
+	if (mHeaderMap.isMapped())
+	{
+		return true;
+	}
+
+	const char* mode = "rb";
+	if (!mReadOnly)
+	{
+		mode = LLFile::isfile(mHeaderEntriesFileName) ? "r+b" : "w+b";
+	}
+	mHeaderFP = LLFile::fopen(mHeaderEntriesFileName, mode);
+	if (!mHeaderFP)
+	{
+		LL_WARNS("TextureCache") << "Unable to open " << mHeaderEntriesFileName << LL_ENDL;
+		return false;
+	}
+
+	fseek(mHeaderFP, 0, SEEK_END);
+	U32 file_size = (U32)ftell(mHeaderFP);
+	U32 num_entries = file_size > sizeof(EntriesInfo) ? (file_size - sizeof(EntriesInfo)) / sizeof(Entry) : 0;
+	if (!mReadOnly)
+	{
+		num_entries = llmax(num_entries, sCacheMaxEntries);
+	}
+	if (!num_entries
+		|| !mHeaderMap.map(mHeaderFP, sizeof(EntriesInfo) + num_entries * sizeof(Entry), mReadOnly, mHeaderEntriesFileName))
 	{
-		mHeaderAPRFile->seek(APR_SET, offset);
+		LLFile::close(mHeaderFP);
+		mHeaderFP = NULL;
+		return false;
 	}
-	return mHeaderAPRFile;
+	mMappedEntries = num_entries;
+	mEntrySeqs.init(mMappedEntries);
+	mHeaderIndex.init(mMappedEntries);
+	return true;
 }
 
 void LLTextureCache::closeHeaderEntriesFile()
 {
-	if(!mHeaderAPRFile)
+	if(!mHeaderFP)
 	{
 		return ;
 	}
 
-	delete mHeaderAPRFile;
-	mHeaderAPRFile = NULL;
+	mHeaderIndex.clear();
+	mHeaderMap.flush();
+	mHeaderMap.unmap();
+	mMappedEntries = 0;
+	LLFile::close(mHeaderFP);
+	mHeaderFP = NULL;
 }
 
 void LLTextureCache::readEntriesHeader()
 {
 	// mHeaderEntriesInfo initializes to default values so safe not to read it
-	llassert_always(mHeaderAPRFile == NULL);
-	if (LLAPRFile::isExist(mHeaderEntriesFileName, getLocalAPRFilePool()))
+	if (mHeaderMap.isMapped())
+	{
+		memcpy(&mHeaderEntriesInfo, mHeaderMap.getData(), sizeof(EntriesInfo));	/* Flawfinder: ignore */
+	}
+	else if (LLAPRFile::isExist(mHeaderEntriesFileName, getLocalAPRFilePool()))
 	{
 		LLAPRFile::readEx(mHeaderEntriesFileName, (U8*)&mHeaderEntriesInfo, 0, sizeof(EntriesInfo),
 						  getLocalAPRFilePool());
@@ -1088,25 +1147,32 @@ void LLTextureCache::readEntriesHeader()
 
 void LLTextureCache::writeEntriesHeader()
 {
-	llassert_always(mHeaderAPRFile == NULL);
 	if (!mReadOnly)
 	{
-		LLAPRFile::writeEx(mHeaderEntriesFileName, (U8*)&mHeaderEntriesInfo, 0, sizeof(EntriesInfo),
-						   getLocalAPRFilePool());
+		if (mHeaderMap.isMapped())
+		{
+			memcpy(mHeaderMap.getData(), &mHeaderEntriesInfo, sizeof(EntriesInfo));	/* Flawfinder: ignore */
+		}
+		else
+		{
+			LLAPRFile::writeEx(mHeaderEntriesFileName, (U8*)&mHeaderEntriesInfo, 0, sizeof(EntriesInfo),
+							   getLocalAPRFilePool());
+		}
 	}
 }
 
 //mHeaderMutex is locked before calling this.
 S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create)
 {
-	S32 idx = -1;
-	
-	id_map_t::iterator iter1 = mHeaderIDMap.find(id);
-	if (iter1 != mHeaderIDMap.end())
+	Entry* entries = getMappedEntries();
+	if (!entries)
 	{
-		idx = iter1->second;
+		return -1;
 	}
 
+	ensureHeaderIndex();
+	S32 idx = findIndexedEntry(id);
+
 	if (idx < 0)
 	{
 		if (create && !mReadOnly)
@@ -1131,12 +1197,13 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 					LLUUID oldid = *curiter2;
 					// Erase entry from LRU regardless
 					mLRU.erase(curiter2);
-					// Look up entry and use it if it is valid
-					id_map_t::iterator iter3 = mHeaderIDMap.find(oldid);
-					if (iter3 != mHeaderIDMap.end() && iter3->second >= 0)
+					// Look up entry and use it if it is valid and has not been
+					// read since the LRU was built
+					S32 oldidx = findIndexedEntry(oldid);
+					if (oldidx >= 0 && entries[oldidx].mTime <= mLRUTime)
 					{
-						idx = iter3->second;
-						removeCachedTexture(oldid) ;//remove the existing cached texture to release the entry index.
+						idx = oldidx;
+						removeCachedTexture(oldid, idx) ;//remove the existing cached texture to release the entry index.
 						break;
 					}
 				}
@@ -1157,23 +1224,14 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 		// Remove this entry from the LRU if it exists
 		mLRU.erase(id);
 		// Read the entry
-		idx_entry_map_t::iterator iter = mUpdatedEntryMap.find(idx) ;
-		if(iter != mUpdatedEntryMap.end())
-		{
-			entry = iter->second ;
-		}
-		else
-		{
-			readEntryFromHeaderImmediately(idx, entry) ;
-		}
-		if(entry.mImageSize <= entry.mBodySize)//it happens on 64-bit systems, do not know why
+		readEntryFromHeaderImmediately(idx, entry) ;
+		if(idx >= 0 && entry.mImageSize <= entry.mBodySize)//it happens on 64-bit systems, do not know why
 		{
 			LL_WARNS() << "corrupted entry: " << id << " entry image size: " << entry.mImageSize << " entry body size: " << entry.mBodySize << LL_ENDL ;
 
 			//erase this entry and the cached texture from the cache.
 			std::string tex_filename = getTextureFileName(id);
 			removeEntry(idx, entry, tex_filename) ;
-			mUpdatedEntryMap.erase(idx) ;
 			idx = -1 ;
 		}
 	}
@@ -1183,56 +1241,38 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 //mHeaderMutex is locked before calling this.
 void LLTextureCache::writeEntryToHeaderImmediately(S32& idx, Entry& entry, bool write_header)
 {	
-	LLAPRFile* aprfile ;
-	S32 bytes_written ;
-	S32 offset = sizeof(EntriesInfo) + idx * sizeof(Entry);
-	if(write_header)
-	{
-		aprfile = openHeaderEntriesFile(false, 0);		
-		bytes_written = aprfile->write((U8*)&mHeaderEntriesInfo, sizeof(EntriesInfo)) ;
-		if(bytes_written != sizeof(EntriesInfo))
-		{
-			clearCorruptedCache() ; //clear the cache.
-			idx = -1 ;//mark the idx invalid.
-			return ;
-		}
-
-		mHeaderAPRFile->seek(APR_SET, offset);
-	}
-	else
-	{
-		aprfile = openHeaderEntriesFile(false, offset);
-	}
-	bytes_written = aprfile->write((void*)&entry, (S32)sizeof(Entry));
-	if(bytes_written != sizeof(Entry))
+	if (idx < 0 || (U32)idx >= mMappedEntries)
 	{
 		clearCorruptedCache() ; //clear the cache.
 		idx = -1 ;//mark the idx invalid.
-
 		return ;
 	}
 
-	closeHeaderEntriesFile();
-	mUpdatedEntryMap.erase(idx) ;
+	beginEntryWrite(idx);
+	memcpy(getMappedEntries() + idx, &entry, sizeof(Entry));	/* Flawfinder: ignore */
+	endEntryWrite(idx);
+	if(write_header)
+	{
+		writeEntriesHeader();
+	}
 }
 
 //mHeaderMutex is locked before calling this.
 void LLTextureCache::readEntryFromHeaderImmediately(S32& idx, Entry& entry)
 {
-	S32 offset = sizeof(EntriesInfo) + idx * sizeof(Entry);
-	LLAPRFile* aprfile = openHeaderEntriesFile(true, offset);
-	S32 bytes_read = aprfile->read((void*)&entry, (S32)sizeof(Entry));
-	closeHeaderEntriesFile();
-
-	if(bytes_read != sizeof(Entry))
+	if (idx < 0 || (U32)idx >= mMappedEntries)
 	{
 		clearCorruptedCache() ; //clear the cache.
 		idx = -1 ;//mark the idx invalid.
+		return ;
 	}
+
+	memcpy(&entry, getMappedEntries() + idx, sizeof(Entry));	/* Flawfinder: ignore */
 }
 
-//mHeaderMutex is locked before calling this.
-//update an existing entry time stamp, delay writing.
+//update an existing entry time stamp in the mapped header, the OS writes it back.
+//mHeaderMutex does not need to be locked.  The stamp is skipped if another
+//thread holds it: a stale stamp only affects the LRU order.
 void LLTextureCache::updateEntryTimeStamp(S32 idx, Entry& entry)
 {
 	static const U32 MAX_ENTRIES_WITHOUT_TIME_STAMP = (U32)(LLTextureCache::sCacheMaxEntries * 0.75f) ;
@@ -1242,12 +1282,20 @@ void LLTextureCache::updateEntryTimeStamp(S32 idx, Entry& entry)
 		return ; //there are enough empty entry index space, no need to stamp time.
 	}
 
-	if (idx >= 0)
+	if (idx >= 0 && (U32)idx < mMappedEntries)
 	{
 		if (!mReadOnly)
 		{
-			entry.mTime = time(NULL);			
-			mUpdatedEntryMap[idx] = entry ;
+			entry.mTime = time(NULL);
+			LLMutexTrylock lock(&mHeaderMutex);
+			Entry* entries = getMappedEntries();
+			// The slot may have been reused since the caller read it
+			if (lock.isLocked() && entries[idx].mID == entry.mID)
+			{
+				beginEntryWrite(idx);
+				entries[idx].mTime = entry.mTime;
+				endEntryWrite(idx);
+			}
 		}
 	}
 }
@@ -1270,8 +1318,6 @@ bool LLTextureCache::updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32
 		bool update_header = false ;
 		if(entry.mImageSize < 0) //is a brand-new entry
 		{
-			mHeaderIDMap[entry.mID] = idx;
-			mTexturesSizeMap[entry.mID] = new_body_size ;
 			mTexturesSizeTotal += new_body_size ;
 			
 			// Update Header
@@ -1279,8 +1325,7 @@ bool LLTextureCache::updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32
 		}				
 		else if (entry.mBodySize != new_body_size)
 		{
-			//already in mHeaderIDMap.
-			mTexturesSizeMap[entry.mID] = new_body_size ;
+			//already in mHeaderIndex.
 			mTexturesSizeTotal -= entry.mBodySize ;
 			mTexturesSizeTotal += new_body_size ;
 		}
@@ -1289,6 +1334,12 @@ bool LLTextureCache::updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32
 		entry.mBodySize = new_body_size ;
 		
 		writeEntryToHeaderImmediately(idx, entry, update_header) ;
+		if (update_header && idx >= 0)
+		{
+			// Publish only once the mapped entry holds the new id
+			const Entry* entries = getMappedEntries();
+			mHeaderIndex.insert(entry.mID, idx, [entries](S32 i) { return entries[i].mID; });
+		}
 	
 		if (mTexturesSizeTotal > sCacheMaxTexturesSize)
 		{
@@ -1306,47 +1357,31 @@ bool LLTextureCache::updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32
 	return false ;
 }
 
-U32 LLTextureCache::openAndReadEntries(std::vector<Entry>& entries)
+//mHeaderMutex is locked and the entries file mapped before calling this.
+//Rebuilds the index, free list and total body size from the mapped entries.
+U32 LLTextureCache::loadHeaderEntries()
 {
 	U32 num_entries = mHeaderEntriesInfo.mEntries;
 
-	mHeaderIDMap.clear();
-	mTexturesSizeMap.clear();
+	mHeaderIndex.clear();
 	mFreeList.clear();
 	mTexturesSizeTotal = 0;
 
-	LLAPRFile* aprfile = NULL; 
-	if(mUpdatedEntryMap.empty())
+	if (num_entries > mMappedEntries)
 	{
-		aprfile = openHeaderEntriesFile(true, (S32)sizeof(EntriesInfo));
-	}
-	else //update the header file first.
-	{
-		aprfile = openHeaderEntriesFile(false, 0);
-		updatedHeaderEntriesFile() ;
-		if(!aprfile)
-		{
-			return 0;
-		}
-		aprfile->seek(APR_SET, (S32)sizeof(EntriesInfo));
+		LL_WARNS() << "Corrupted header entries, " << num_entries << " entries but only " << mMappedEntries << " on disk" << LL_ENDL;
+		purgeAllTextures(false);
+		return 0;
 	}
+
+	const Entry* entries = getMappedEntries();
 	for (U32 idx=0; idx<num_entries; idx++)
 	{
-		Entry entry;
-		S32 bytes_read = aprfile->read((void*)(&entry), (S32)sizeof(Entry));
-		if (bytes_read < sizeof(Entry))
-		{
-			LL_WARNS() << "Corrupted header entries, failed at " << idx << " / " << num_entries << LL_ENDL;
-			closeHeaderEntriesFile();
-			purgeAllTextures(false);
-			return 0;
-		}
-		entries.push_back(entry);
+		const Entry& entry = entries[idx];
 // 		LL_INFOS() << "ENTRY: " << entry.mTime << " TEX: " << entry.mID << " IDX: " << idx << " Size: " << entry.mImageSize << LL_ENDL;
 		if(entry.mImageSize > entry.mBodySize)
 		{
-			mHeaderIDMap[entry.mID] = idx;
-			mTexturesSizeMap[entry.mID] = entry.mBodySize;
+			mHeaderIndex.insert(entry.mID, idx, [entries](S32 i) { return entries[i].mID; });
 			mTexturesSizeTotal += entry.mBodySize;
 		}
 		else
@@ -1354,90 +1389,78 @@ U32 LLTextureCache::openAndReadEntries(std::vector<Entry>& entries)
 			mFreeList.insert(idx);
 		}
 	}
-	closeHeaderEntriesFile();
 	return num_entries;
 }
 
-void LLTextureCache::writeEntriesAndClose(const std::vector<Entry>& entries)
+//mHeaderMutex is locked before calling this.
+void LLTextureCache::buildLRU()
 {
-	S32 num_entries = entries.size();
-	llassert_always(num_entries == mHeaderEntriesInfo.mEntries);
-	
-	if (!mReadOnly)
+	mLRU.clear();
+	mLRUTime = time(NULL);
+
+	U32 num_entries = llmin(mHeaderEntriesInfo.mEntries, mMappedEntries);
+	if (!num_entries)
 	{
-		LLAPRFile* aprfile = openHeaderEntriesFile(false, (S32)sizeof(EntriesInfo));
-		for (S32 idx=0; idx<num_entries; idx++)
+		return;
+	}
+
+	const Entry* entries = getMappedEntries();
+	typedef std::pair<U32, S32> lru_data_t;
+	std::vector<lru_data_t> lru;
+	lru.reserve(num_entries);
+	for (U32 i=0; i<num_entries; i++)
+	{
+		const Entry& entry = entries[i];
+		if (entry.mImageSize > 0)
 		{
-			S32 bytes_written = aprfile->write((void*)(&entries[idx]), (S32)sizeof(Entry));
-			if(bytes_written != sizeof(Entry))
-			{
-				clearCorruptedCache() ; //clear the cache.
-				return ;
-			}
+			lru.emplace_back(entry.mTime, i);
+			// Guards against stamps from a clock that has since gone backwards,
+			// which would otherwise make every entry look recently used.
+			mLRUTime = llmax(mLRUTime, entry.mTime);
 		}
-		closeHeaderEntriesFile();
 	}
-}
 
-void LLTextureCache::writeUpdatedEntries()
-{
-	lockHeaders() ;
-	if (!mReadOnly && !mUpdatedEntryMap.empty())
+	S32 lru_entries = llmin((S32)((F32)sCacheMaxEntries * TEXTURE_CACHE_LRU_SIZE), (S32)lru.size());
+	if (lru_entries <= 0)
 	{
-		openHeaderEntriesFile(false, 0);
-		updatedHeaderEntriesFile() ;
-		closeHeaderEntriesFile();
+		return;
+	}
+	std::nth_element(lru.begin(), lru.begin() + (lru_entries - 1), lru.end());
+	for (S32 i = 0; i < lru_entries; i++)
+	{
+		mLRU.insert(entries[lru[i].second].mID);
+// 		LL_INFOS() << "LRU: " << lru[i].first << " : " << lru[i].second << LL_ENDL;
 	}
-	unlockHeaders() ;
 }
 
-//mHeaderMutex is locked and mHeaderAPRFile is created before calling this.
-void LLTextureCache::updatedHeaderEntriesFile()
+void LLTextureCache::writeUpdatedEntries()
 {
-	if (!mReadOnly && !mUpdatedEntryMap.empty() && mHeaderAPRFile)
+	lockHeaders() ;
+	if (!mReadOnly)
 	{
-		//entriesInfo
-		mHeaderAPRFile->seek(APR_SET, 0);
-		S32 bytes_written = mHeaderAPRFile->write((U8*)&mHeaderEntriesInfo, sizeof(EntriesInfo)) ;
-		if(bytes_written != sizeof(EntriesInfo))
-		{
-			clearCorruptedCache() ; //clear the cache.
-			return ;
-		}
-		
-		//write each updated entry
-		S32 entry_size = (S32)sizeof(Entry) ;
-		S32 prev_idx = -1 ;
-		S32 delta_idx ;
-		for (idx_entry_map_t::iterator iter = mUpdatedEntryMap.begin(); iter != mUpdatedEntryMap.end(); ++iter)
-		{
-			delta_idx = iter->first - prev_idx - 1;
-			prev_idx = iter->first ;
-			if(delta_idx)
-			{
-				mHeaderAPRFile->seek(APR_CUR, delta_idx * entry_size);
-			}
-			
-			bytes_written = mHeaderAPRFile->write((void*)(&iter->second), entry_size);
-			if(bytes_written != entry_size)
-			{
-				clearCorruptedCache() ; //clear the cache.
-				return ;
-			}
-		}
-		mUpdatedEntryMap.clear() ;
+		// Time stamps go straight into the mapping; just queue the dirty
+		// pages for write-back.
+		mHeaderMap.flush();
 	}
+	unlockHeaders() ;
 }
 //----------------------------------------------------------------------------
 
-// Called from either the main thread or the worker thread
+// Called from either the main thread or the worker thread.  Only maps the
+// entries and checks their version; the entries themselves are walked the
+// first time they are needed, see ensureHeaderIndex().
 void LLTextureCache::readHeaderCache()
 {
 	mHeaderMutex.lock();
 
 	mLRU.clear(); // always clear the LRU
+	mHeaderIndexLoaded.store(false, std::memory_order_relaxed);
 
 	readEntriesHeader();
+	if (openHeaderEntriesFile())
+	{
+		readEntriesHeader(); // from the mapping, in case the file was just created
+	}
 	
 	if (mHeaderEntriesInfo.mVersion != sHeaderCacheVersion)
 	{
@@ -1446,100 +1469,118 @@ void LLTextureCache::readHeaderCache()
 			purgeAllTextures(false);
 		}
 	}
-	else
+	mHeaderMutex.unlock();
+}
+
+//mHeaderMutex is locked before calling this.
+void LLTextureCache::ensureHeaderIndex()
+{
+	if (mHeaderIndexLoaded.load(std::memory_order_relaxed))
+	{
+		return;
+	}
+	loadHeaderIndex();
+	// Lock-free lookups only trust the index once this is set
+	mHeaderIndexLoaded.store(true, std::memory_order_release);
+}
+
+//mHeaderMutex is locked before calling this.
+//Builds the index, free list and LRU from the mapped entries, dropping bad
+//entries and trimming the entries to sCacheMaxEntries.
+void LLTextureCache::loadHeaderIndex()
+{
+	U32 num_entries = loadHeaderEntries();
+	if (num_entries)
 	{
-		std::vector<Entry> entries;
-		U32 num_entries = openAndReadEntries(entries);
-		if (num_entries)
+		Entry* entries = getMappedEntries();
+		U32 empty_entries = 0;
+		std::set<U32> purge_list;
+		for (U32 i=0; i<num_entries; i++)
+		{
+			Entry& entry = entries[i];
+			if (entry.mImageSize <= 0)
+			{
+				// This will be in the Free List, don't put it in the LRU
+				++empty_entries;
+			}
+			else if (entry.mBodySize > 0)
+			{
+				if (entry.mBodySize > entry.mImageSize)
+				{
+					// Shouldn't happen, failsafe only
+					LL_WARNS() << "Bad entry: " << i << ": " << entry.mID << ": BodySize: " << entry.mBodySize << LL_ENDL;
+					purge_list.insert(i);
+				}
+			}
+		}
+		if (num_entries - empty_entries > sCacheMaxEntries)
 		{
-			U32 empty_entries = 0;
+			// Special case: cache size was reduced, need to remove entries
+			// Note: After we prune entries, we will call this again and create the LRU
+			U32 entries_to_purge = (num_entries - empty_entries) - sCacheMaxEntries;
+			LL_INFOS() << "Texture Cache Entries: " << num_entries << " Max: " << sCacheMaxEntries << " Empty: " << empty_entries << " Purging: " << entries_to_purge << LL_ENDL;
 			typedef std::pair<U32, S32> lru_data_t;
 			std::set<lru_data_t> lru;
-			std::set<U32> purge_list;
 			for (U32 i=0; i<num_entries; i++)
 			{
-				Entry& entry = entries[i];
-				if (entry.mImageSize <= 0)
+				if (entries[i].mImageSize > 0)
 				{
-					// This will be in the Free List, don't put it in the LRU
-					++empty_entries;
-				}
-				else
-				{
-					lru.emplace(entry.mTime, i);
-					if (entry.mBodySize > 0)
-					{
-						if (entry.mBodySize > entry.mImageSize)
-						{
-							// Shouldn't happen, failsafe only
-							LL_WARNS() << "Bad entry: " << i << ": " << entry.mID << ": BodySize: " << entry.mBodySize << LL_ENDL;
-							purge_list.insert(i);
-						}
-					}
+					lru.emplace(entries[i].mTime, i);
 				}
 			}
-			if (num_entries - empty_entries > sCacheMaxEntries)
+			// We can exit the following loop with the given condition, since if we'd reach the end of the lru set we'd have:
+			// purge_list.size() = lru.size() = num_entries - empty_entries = entries_to_purge + sCacheMaxEntries >= entries_to_purge
+			// So, it's certain that iter will never reach lru.end() first.
+			std::set<lru_data_t>::iterator iter = lru.begin();
+			while (purge_list.size() < entries_to_purge)
 			{
-				// Special case: cache size was reduced, need to remove entries
-				// Note: After we prune entries, we will call this again and create the LRU
-				U32 entries_to_purge = (num_entries - empty_entries) - sCacheMaxEntries;
-				LL_INFOS() << "Texture Cache Entries: " << num_entries << " Max: " << sCacheMaxEntries << " Empty: " << empty_entries << " Purging: " << entries_to_purge << LL_ENDL;
-				// We can exit the following loop with the given condition, since if we'd reach the end of the lru set we'd have:
-				// purge_list.size() = lru.size() = num_entries - empty_entries = entries_to_purge + sCacheMaxEntries >= entries_to_purge
-				// So, it's certain that iter will never reach lru.end() first.
-				std::set<lru_data_t>::iterator iter = lru.begin();
-				while (purge_list.size() < entries_to_purge)
-				{
-					purge_list.insert(iter->second);
-					++iter;
-				}
+				purge_list.insert(iter->second);
+				++iter;
 			}
-			else
+		}
+		else
+		{
+			buildLRU();
+		}
+		
+		if (purge_list.size() > 0 && !mReadOnly)
+		{
+			for (std::set<U32>::iterator iter = purge_list.begin(); iter != purge_list.end(); ++iter)
 			{
-				S32 lru_entries = (S32)((F32)sCacheMaxEntries * TEXTURE_CACHE_LRU_SIZE);
-				for (std::set<lru_data_t>::iterator iter = lru.begin(); iter != lru.end(); ++iter)
-				{
-					mLRU.insert(entries[iter->second].mID);
-// 					LL_INFOS() << "LRU: " << iter->first << " : " << iter->second << LL_ENDL;
-					if (--lru_entries <= 0)
-						break;
-				}
+				S32 idx = (S32)*iter;
+				Entry entry = entries[idx];
+				std::string tex_filename = getTextureFileName(entry.mID);
+				removeEntry(idx, entry, tex_filename);
+				writeEntryToHeaderImmediately(idx, entry);
 			}
-			
-			if (purge_list.size() > 0)
+			// If we removed any entries, we need to compact the entries in
+			// place, write the header, and call this again.  Entries move,
+			// so unindex them all first.
+			mHeaderIndex.clear();
+			U32 new_entries = 0;
+			for (U32 i=0; i<num_entries; i++)
 			{
-				for (std::set<U32>::iterator iter = purge_list.begin(); iter != purge_list.end(); ++iter)
+				if (entries[i].mImageSize > 0)
 				{
-					std::string tex_filename = getTextureFileName(entries[*iter].mID);
-					removeEntry((S32)*iter, entries[*iter], tex_filename);
-				}
-				// If we removed any entries, we need to rebuild the entries list,
-				// write the header, and call this again
-				std::vector<Entry> new_entries;
-				for (U32 i=0; i<num_entries; i++)
-				{
-					const Entry& entry = entries[i];
-					if (entry.mImageSize > 0)
+					if (i != new_entries)
 					{
-						new_entries.push_back(entry);
+						S32 idx = (S32)new_entries;
+						writeEntryToHeaderImmediately(idx, entries[i]);
 					}
+					++new_entries;
 				}
-                mFreeList.clear(); // recreating list, no longer valid.
-				llassert_always(new_entries.size() <= sCacheMaxEntries);
-				mHeaderEntriesInfo.mEntries = new_entries.size();
-				writeEntriesHeader();
-				writeEntriesAndClose(new_entries);
-				mHeaderMutex.unlock(); // unlock the mutex before calling again
-				readHeaderCache(); // repeat with new entries file
-				mHeaderMutex.lock();
-			}
-			else
-			{
-				//entries are not changed, nothing here.
 			}
+			mFreeList.clear(); // recreating list, no longer valid.
+			llassert_always(new_entries <= sCacheMaxEntries);
+			mHeaderEntriesInfo.mEntries = new_entries;
+			writeEntriesHeader();
+			loadHeaderIndex(); // repeat with the compacted entries
+		}
+		else
+		{
+			//entries are not changed, nothing here.
 		}
 	}
-	mHeaderMutex.unlock();
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -1549,7 +1590,8 @@ void LLTextureCache::clearCorruptedCache()
 {
 	LL_WARNS() << "the texture cache is corrupted, need to be cleared." << LL_ENDL ;
 
-	closeHeaderEntriesFile();//close possible file handler
+	// The entries file stays mapped: lock-free readers may still hold
+	// pointers into it, and the purge resets it to zero entries anyway.
 	purgeAllTextures(false) ; //clear the cache.
 	
 	if (!mReadOnly) //regenerate the directory tree if not exists.
@@ -1593,12 +1635,11 @@ void LLTextureCache::purgeAllTextures(bool purge_directories)
 			LLFile::rmdir(mTexturesDirName);
 		}
 	}
-	mHeaderIDMap.clear();
-	mTexturesSizeMap.clear();
+	mHeaderIndex.clear();
+	mHeaderIndexLoaded.store(true, std::memory_order_release); // nothing to index
 	mTexturesSizeTotal = 0;
 	mFreeList.clear();
 	mTexturesSizeTotal = 0;
-	mUpdatedEntryMap.clear();
 
 	// Info with 0 entries
 	mHeaderEntriesInfo.mVersion = sHeaderCacheVersion;
@@ -1622,46 +1663,35 @@ void LLTextureCache::purgeTextures(bool validate)
 	}
 	
 	LLMutexLock lock(&mHeaderMutex);
+	ensureHeaderIndex(); // for mTexturesSizeTotal
 
 	LL_INFOS() << "TEXTURE CACHE: Purging." << LL_ENDL;
 
-	// Read the entries list
-	std::vector<Entry> entries;
-	U32 num_entries = openAndReadEntries(entries);
-	if (!num_entries)
+	// The entries are live in the mapped header, no need to read them in
+	Entry* entries = getMappedEntries();
+	U32 num_entries = llmin(mHeaderEntriesInfo.mEntries, mMappedEntries);
+	if (!entries || !num_entries)
 	{
 		return; // nothing to purge
 	}
 	
-	// Use mTexturesSizeMap to collect UUIDs of textures with bodies
+	// Collect the indices of textures with bodies
 	typedef std::set<std::pair<U32,S32> > time_idx_set_t;
 	std::set<std::pair<U32,S32> > time_idx_set;
-	for (size_map_t::iterator iter1 = mTexturesSizeMap.begin();
-		 iter1 != mTexturesSizeMap.end(); ++iter1)
+	for (U32 idx = 0; idx < num_entries; ++idx)
 	{
-		if (iter1->second > 0)
+		const Entry& entry = entries[idx];
+		if (entry.mImageSize > entry.mBodySize && entry.mBodySize > 0)
 		{
-			id_map_t::iterator iter2 = mHeaderIDMap.find(iter1->first);
-			if (iter2 != mHeaderIDMap.end())
-			{
-				S32 idx = iter2->second;
-				time_idx_set.emplace(entries[idx].mTime, idx);
-// 				LL_INFOS() << "TIME: " << entries[idx].mTime << " TEX: " << entries[idx].mID << " IDX: " << idx << " Size: " << entries[idx].mImageSize << LL_ENDL;
-			}
-			else
-			{
-				LL_ERRS() << "mTexturesSizeMap / mHeaderIDMap corrupted." << LL_ENDL ;
-			}
+			time_idx_set.emplace(entry.mTime, (S32)idx);
+// 			LL_INFOS() << "TIME: " << entry.mTime << " TEX: " << entry.mID << " IDX: " << idx << " Size: " << entry.mImageSize << LL_ENDL;
 		}
 	}
 	
-	// Validate 1/256th of the files on startup
-	U32 validate_idx = 0;
+	// Validate 1/256th of the files on startup, see initCache()
+	U32 validate_idx = mValidateIdx;
 	if (validate)
 	{
-		validate_idx = gSavedSettings.getU32("CacheValidateCounter");
-		U32 next_idx = (validate_idx + 1) % 256;
-		gSavedSettings.setU32("CacheValidateCounter", next_idx);
 		LL_DEBUGS("TextureCache") << "TEXTURE CACHE: Validating: " << validate_idx << LL_ENDL;
 	}
 
@@ -1704,13 +1734,15 @@ void LLTextureCache::purgeTextures(bool validate)
 			purge_count++;
 	 		LL_DEBUGS("TextureCache") << "PURGING: " << filename << LL_ENDL;
 			cache_size -= entries[idx].mBodySize;
-			removeEntry(idx, entries[idx], filename) ;			
+			Entry entry = entries[idx];
+			removeEntry(idx, entry, filename) ;
+			writeEntryToHeaderImmediately(idx, entry);
 		}
 	}
 
 	LL_DEBUGS("TextureCache") << "TEXTURE CACHE: Writing Entries: " << num_entries << LL_ENDL;
 
-	writeEntriesAndClose(entries);
+	mHeaderMap.flush();
 	
 	// *FIX:Mani - watchdog back on.
 	LLAppViewer::instance()->resumeMainloopTimeout();
@@ -1750,11 +1782,64 @@ LLTextureCacheWorker* LLTextureCache::getWriter(handle_t handle)
 //////////////////////////////////////////////////////////////////////////////
 // Called from work thread
 
+// Copies the entry for id out of the mapped header without locking, once
+// the index has been built.  Returns -1 on a miss or if the slot was reused
+// while we read it; callers that need an authoritative answer retry under
+// mHeaderMutex.
+S32 LLTextureCache::findHeaderEntry(const LLUUID& id, Entry& entry)
+{
+	if (!mHeaderIndexLoaded.load(std::memory_order_acquire))
+	{
+		LLMutexLock lock(&mHeaderMutex);
+		ensureHeaderIndex();
+	}
+	S32 idx = findIndexedEntry(id);
+	if (idx >= 0)
+	{
+		copyEntry(idx, entry);
+		if (entry.mID != id || entry.mImageSize <= entry.mBodySize)
+		{
+			idx = -1;
+		}
+	}
+	return idx;
+}
+
+// Probes the index, reading the candidates' ids under their sequence lock
+// since writers may be reusing the slots.
+S32 LLTextureCache::findIndexedEntry(const LLUUID& id) const
+{
+	const Entry* entries = getMappedEntries();
+	if (!entries)
+	{
+		return -1;
+	}
+	return mHeaderIndex.find(id, [this, entries](S32 idx)
+		{
+			LLUUID entry_id;
+			mEntrySeqs.read(idx, &entry_id, &entries[idx].mID, sizeof(LLUUID));
+			return entry_id;
+		});
+}
+
+// Seqlock read of a mapped entry: retries until it gets a copy that no
+// writer touched while it was being taken.
+void LLTextureCache::copyEntry(S32 idx, Entry& entry) const
+{
+	mEntrySeqs.read(idx, &entry, getMappedEntries() + idx, sizeof(Entry));
+}
+
 // Reads imagesize from the header, updates timestamp
 S32 LLTextureCache::getHeaderCacheEntry(const LLUUID& id, Entry& entry)
 {
-	LLMutexLock lock(&mHeaderMutex);	
-	S32 idx = openAndReadEntry(id, entry, false);
+	// Cache hits never touch mHeaderMutex.  The fresh time stamp keeps the
+	// entry from being recycled out of a stale mLRU.
+	S32 idx = findHeaderEntry(id, entry);
+	if (idx < 0)
+	{
+		LLMutexLock lock(&mHeaderMutex);
+		idx = openAndReadEntry(id, entry, false);
+	}
 	if (idx >= 0)
 	{		
 		updateEntryTimeStamp(idx, entry); // updates time
@@ -1776,9 +1861,8 @@ S32 LLTextureCache::setHeaderCacheEntry(const LLUUID& id, Entry& entry, S32 imag
 
 	if(idx < 0) // retry
 	{
-		readHeaderCache(); // We couldn't write an entry, so refresh the LRU
-	
 		mHeaderMutex.lock();
+		buildLRU(); // We couldn't write an entry, so refresh the LRU
 		llassert_always(!mLRU.empty() || mHeaderEntriesInfo.mEntries < sCacheMaxEntries);
 		mHeaderMutex.unlock();
 
@@ -1864,7 +1948,8 @@ LLTextureCache::handle_t LLTextureCache::writeToCache(const LLUUID& id, U32 prio
 		// NOTE: This may cause an occasional hiccup,
 		//  but it really needs to be done on the control thread
 		//  (i.e. here)		
-		purgeTextures(false);
+		purgeTextures(mValidateOnPurge);
+		mValidateOnPurge = false;
 		mDoPurge = false;
 	}
 	
@@ -1886,18 +1971,18 @@ LLTextureCache::handle_t LLTextureCache::writeToCache(const LLUUID& id, U32 prio
 //called in the main thread
 LLPointer<LLImageRaw> LLTextureCache::readFromFastCache(const LLUUID& id, S32& discardlevel)
 {
-	U32 offset;
+	if (!mHeaderIndexLoaded.load(std::memory_order_acquire))
 	{
-		LLMutexLock lock(&mHeaderMutex);
-		id_map_t::const_iterator iter = mHeaderIDMap.find(id);
-		if(iter == mHeaderIDMap.end())
-		{
-			return NULL; //not in the cache
-		}
+		return NULL; // don't wait here for the cache thread to build the index
+	}
 
-		offset = iter->second;
+	Entry entry;
+	S32 idx = findHeaderEntry(id, entry);
+	if (idx < 0)
+	{
+		return NULL; //not in the cache
 	}
-	offset *= TEXTURE_FAST_CACHE_ENTRY_SIZE;
+	U32 offset = (U32)idx * TEXTURE_FAST_CACHE_ENTRY_SIZE;
 
 	U8* data;
 	S32 head[4];
@@ -2098,14 +2183,10 @@ void LLTextureCache::addCompleted(Responder* responder, bool success)
 //////////////////////////////////////////////////////////////////////////////
 
 //called after mHeaderMutex is locked.
-void LLTextureCache::removeCachedTexture(const LLUUID& id)
+void LLTextureCache::removeCachedTexture(const LLUUID& id, S32 idx)
 {
-	if(mTexturesSizeMap.find(id) != mTexturesSizeMap.end())
-	{
-		mTexturesSizeTotal -= mTexturesSizeMap[id] ;
-		mTexturesSizeMap.erase(id);
-	}
-	mHeaderIDMap.erase(id);
+	mTexturesSizeTotal -= getMappedEntries()[idx].mBodySize ;
+	mHeaderIndex.remove(id, idx);
 	LLAPRFile::remove(getTextureFileName(id), getLocalAPRFilePool());		
 }
 
@@ -2131,8 +2212,7 @@ void LLTextureCache::removeEntry(S32 idx, Entry& entry, std::string& filename)
 
 		entry.mImageSize = -1;
 		entry.mBodySize = 0;
-		mHeaderIDMap.erase(entry.mID);
-		mTexturesSizeMap.erase(entry.mID);		
+		mHeaderIndex.remove(entry.mID, idx);
 		mFreeList.insert(idx);	
 	}
 
@@ -28,8 +28,13 @@
 #define LL_LLTEXTURECACHE_H
 
 #include "lldir.h"
+#include "llmappedfile.h"
+#include "lltextureheaderindex.h"
 #include "lluuid.h"
 
+#include <atomic>
+#include <memory>
+
 #include "llworkerthread.h"
 
 class LLImageFormatted;
@@ -67,7 +72,6 @@ private:
 		S32 mBodySize; // size of body file in body cache
 		U32 mTime; // seconds since 1/1/1970
 	};
-
 	
 public:
 
@@ -101,6 +105,7 @@ public:
 	~LLTextureCache();
 
 	/*virtual*/ S32 update(F32 max_time_ms) override;	
+	/*virtual*/ void threadedUpdate() override;
 	
 	void purgeCache(ELLPath location, bool remove_dir = true);
 	void setReadOnly(BOOL read_only) ;
@@ -148,26 +153,33 @@ protected:
 private:
 	void setDirNames(ELLPath location);
 	void readHeaderCache();
+	void ensureHeaderIndex();
+	void loadHeaderIndex();
 	void clearCorruptedCache();
 	void purgeAllTextures(bool purge_directories);
 	void purgeTextures(bool validate);
-	LLAPRFile* openHeaderEntriesFile(bool readonly, S32 offset);
+	bool openHeaderEntriesFile();
 	void closeHeaderEntriesFile();
+	Entry* getMappedEntries() const { return mHeaderMap.isMapped() ? (Entry*)(mHeaderMap.getData() + sizeof(EntriesInfo)) : NULL; }
 	void readEntriesHeader();
 	void writeEntriesHeader();
 	S32 openAndReadEntry(const LLUUID& id, Entry& entry, bool create);
 	bool updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32 new_body_size);
 	void updateEntryTimeStamp(S32 idx, Entry& entry) ;
-	U32 openAndReadEntries(std::vector<Entry>& entries);
-	void writeEntriesAndClose(const std::vector<Entry>& entries);
+	U32 loadHeaderEntries();
+	void buildLRU();
 	void readEntryFromHeaderImmediately(S32& idx, Entry& entry) ;
 	void writeEntryToHeaderImmediately(S32& idx, Entry& entry, bool write_header = false) ;
 	void removeEntry(S32 idx, Entry& entry, std::string& filename);
-	void removeCachedTexture(const LLUUID& id) ;
+	void removeCachedTexture(const LLUUID& id, S32 idx) ;
+	S32 findHeaderEntry(const LLUUID& id, Entry& entry);
+	S32 findIndexedEntry(const LLUUID& id) const;
+	void copyEntry(S32 idx, Entry& entry) const;
+	void beginEntryWrite(S32 idx) { mEntrySeqs.beginWrite(idx); }
+	void endEntryWrite(S32 idx) { mEntrySeqs.endWrite(idx); }
 	S32 getHeaderCacheEntry(const LLUUID& id, Entry& entry);
 	S32 setHeaderCacheEntry(const LLUUID& id, Entry& entry, S32 imagesize, S32 datasize);
 	void writeUpdatedEntries() ;
-	void updatedHeaderEntriesFile() ;
 	void lockHeaders() { mHeaderMutex.lock(); }
 	void unlockHeaders() { mHeaderMutex.unlock(); }
 	
@@ -181,7 +193,11 @@ private:
 	LLMutex mHeaderMutex;
 	LLMutex mListMutex;
 	LLMutex mFastCacheMutex;
-	LLAPRFile* mHeaderAPRFile;
+	LLFILE* mHeaderFP;
+	LLMappedFile mHeaderMap; // texture.entries: EntriesInfo followed by mMappedEntries Entry records
+	U32 mMappedEntries;
+	// Lets readers that don't hold mHeaderMutex copy mapped entries
+	LLEntrySeqLock mEntrySeqs;
 	LLVolatileAPRPool* mFastCachePoolp;
 	
 	typedef std::map<handle_t, LLTextureCacheWorker*> handle_map_t;
@@ -203,8 +219,10 @@ private:
 	EntriesInfo mHeaderEntriesInfo;
 	std::set<S32> mFreeList; // deleted entries
 	std::set<LLUUID> mLRU;
-	typedef std::map<LLUUID, S32> id_map_t;
-	id_map_t mHeaderIDMap;
+	U32 mLRUTime; // entries stamped after this have been used since mLRU was built
+	// Built from the mapped entries on first use, see ensureHeaderIndex()
+	LLTextureHeaderIndex mHeaderIndex;
+	std::atomic<bool> mHeaderIndexLoaded;
 
 	LLAPRFile*   mFastCachep;
 	LLFrameTimer mFastCacheTimer;
@@ -212,13 +230,10 @@ private:
 
 	// BODIES (TEXTURES minus headers)
 	std::string mTexturesDirName;
-	typedef std::map<LLUUID,S32> size_map_t;
-	size_map_t mTexturesSizeMap;
 	S64 mTexturesSizeTotal;
 	LLAtomic32<bool> mDoPurge;
-
-	typedef std::map<S32, Entry> idx_entry_map_t;
-	idx_entry_map_t mUpdatedEntryMap;
+	bool mValidateOnPurge;
+	U32 mValidateIdx;
 
 	// Statics
 	static F32 sHeaderCacheVersion;
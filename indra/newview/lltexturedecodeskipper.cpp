@@ -0,0 +1,53 @@
+/**
+ * @file lltexturedecodeskipper.cpp
+ * @brief Decides which texture decodes a finer discard level supersedes.
+ *
+ * $LicenseInfo:firstyear=2026&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2026, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "lltexturedecodeskipper.h"
+
+LLTextureDecodeSkipper::LLTextureDecodeSkipper()
+:	mShownDiscard(-1),
+	mSkippedSize(0)
+{
+}
+
+bool LLTextureDecodeSkipper::skipDecode(bool have_all_data, S32 desired_discard, S32 loaded_discard, S32 data_size)
+{
+	if (have_all_data
+		|| mShownDiscard < 0
+		|| desired_discard >= loaded_discard
+		|| data_size <= mSkippedSize)
+	{
+		return false;
+	}
+	mSkippedSize = data_size;
+	return true;
+}
+
+void LLTextureDecodeSkipper::decoded(S32 discard)
+{
+	mShownDiscard = discard;
+}
@@ -0,0 +1,60 @@
+/**
+ * @file lltexturedecodeskipper.h
+ * @brief Decides which texture decodes a finer discard level supersedes.
+ *
+ * $LicenseInfo:firstyear=2026&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2026, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLTEXTUREDECODESKIPPER_H
+#define LL_LLTEXTUREDECODESKIPPER_H
+
+#include "stdtypes.h"
+
+// Each texture decode starts from scratch, so decoding an intermediate
+// discard level that the desired discard has already moved past is wasted
+// work.  Once the viewer has a lower resolution decode to show, a fetch
+// worker can keep that image and go straight back for the rest of the
+// data, decoding only the final level.
+//
+// A skip only happens while the data keeps growing between rounds, so a
+// fetch that fails to get more data still decodes what it has.
+class LLTextureDecodeSkipper
+{
+public:
+	LLTextureDecodeSkipper();
+
+	// True if data_size bytes loaded for loaded_discard need not be
+	// decoded.  Remembers data_size when it returns true.
+	bool skipDecode(bool have_all_data, S32 desired_discard, S32 loaded_discard, S32 data_size);
+
+	// A decode of discard was handed to the viewer
+	void decoded(S32 discard);
+
+	// Best discard handed to the viewer so far, -1 for none
+	S32 getShownDiscard() const					{ return mShownDiscard; }
+
+private:
+	S32 mShownDiscard;
+	S32 mSkippedSize;	// data size when a decode was last skipped
+};
+
+#endif // LL_LLTEXTUREDECODESKIPPER_H
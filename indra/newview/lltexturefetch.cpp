@@ -40,6 +40,7 @@
 
 #include "llagent.h"
 #include "lltexturecache.h"
+#include "lltexturedecodeskipper.h"
 #include "llviewercontrol.h"
 #include "llviewertexturelist.h"
 #include "llviewertexture.h"
@@ -554,7 +555,8 @@ private:
 	LLTextureFetch* mFetcher;
 	LLPointer<LLImageFormatted> mFormattedImage;
 	LLPointer<LLImageRaw>       mRawImage,
-								mAuxImage;
+								mAuxImage,
+								mShownRawImage;	// Last decode handed to the viewer, survives INIT
 	FTType mFTType;
 	LLUUID mID;
 	LLHost mHost;
@@ -579,6 +581,8 @@ private:
 								mDesiredSize,
 								mFileSize,
 								mCachedSize;
+	LLTextureDecodeSkipper mDecodeSkipper;
+	bool mDecodeSkipped;		// Writing data whose decode was skipped, then back to INIT
 	e_request_state mSentRequest;
 	handle_t mDecodeHandle;
 	BOOL mLoaded;
@@ -912,6 +916,7 @@ LLTextureFetchWorker::LLTextureFetchWorker(LLTextureFetch* fetcher,
 	  mDesiredSize(TEXTURE_CACHE_ENTRY_SIZE),
 	  mFileSize(0),
 	  mCachedSize(0),
+	  mDecodeSkipped(false),
 	  mLoaded(FALSE),
 	  mSentRequest(UNSENT),
 	  mDecodeHandle(0),
@@ -1183,6 +1188,7 @@ bool LLTextureFetchWorker::doWork(S32 param)
 		mSentRequest = UNSENT;
 		mDecoded  = FALSE;
 		mWritten  = FALSE;
+		mDecodeSkipped = false;
 		if (mHttpBufferArray)
 		{
 			mHttpBufferArray->release();
@@ -1784,12 +1790,24 @@ bool LLTextureFetchWorker::doWork(S32 param)
 				mFileSize = total_size + 1 ; //flag the file is not fully loaded.
 			}
 			
-			U8 * buffer = (U8 *)ll_aligned_malloc_16(total_size);
-			if (cur_size > 0)
+			// A fresh body that arrived in one block can be taken
+			// as-is, anything else is assembled into a new buffer.
+			U8 * buffer = NULL;
+			if (0 == cur_size && 0 == src_offset)
 			{
-				memcpy(buffer, mFormattedImage->getData(), cur_size);
+				size_t adopted_size(0);
+				buffer = (U8 *) mHttpBufferArray->adoptData(&adopted_size);
+				llassert_always(! buffer || adopted_size == (size_t) total_size);
+			}
+			if (! buffer)
+			{
+				buffer = (U8 *)ll_aligned_malloc_16(total_size);
+				if (cur_size > 0)
+				{
+					memcpy(buffer, mFormattedImage->getData(), cur_size);
+				}
+				mHttpBufferArray->read(src_offset, (char *) buffer + cur_size, append_size);
 			}
-			mHttpBufferArray->read(src_offset, (char *) buffer + cur_size, append_size);
 
 			// NOTE: setData releases current data and owns new data (buffer)
 			mFormattedImage->setData(buffer, total_size);
@@ -1868,6 +1886,20 @@ bool LLTextureFetchWorker::doWork(S32 param)
 			return true;
 		}
 
+		// Keep showing the last decode while the rest of the data is
+		// fetched, but still cache what was downloaded so far
+		static LLCachedControl<bool> skip_superseded_decodes(gSavedSettings, "TextureSkipSupersededDecodes", true);
+		if (skip_superseded_decodes
+			&& mDecodeSkipper.skipDecode(mHaveAllData, mDesiredDiscard, mLoadedDiscard, mFormattedImage->getDataSize()))
+		{
+			LL_DEBUGS(LOG_TXT) << mID << ": Skipping superseded decode. Loaded discard: " << mLoadedDiscard
+							   << " Desired discard: " << mDesiredDiscard << " Shown discard: " << mDecodeSkipper.getShownDiscard() << LL_ENDL;
+			mDecodeSkipped = true;
+			setState(WRITE_TO_CACHE);
+			setPriority(LLWorkerThread::PRIORITY_HIGH | mWorkPriority);
+			return false;
+		}
+
 		mRawImage = NULL;
 		mAuxImage = NULL;
 		llassert_always(mFormattedImage.notNull());
@@ -1955,9 +1987,12 @@ bool LLTextureFetchWorker::doWork(S32 param)
 		setState(WAIT_ON_WRITE);
 		++mCacheWriteCount;
 		CacheWriteResponder* responder = new CacheWriteResponder(mFetcher, mID);
+		// A skipped decode has no raw image of its own for the fast cache
+		LLPointer<LLImageRaw> raw = mDecodeSkipped ? mShownRawImage : mRawImage;
+		S32 raw_discard = mDecodeSkipped ? mDecodeSkipper.getShownDiscard() : mDecodedDiscard;
 		mCacheWriteHandle = mFetcher->mTextureCache->writeToCache(mID, cache_priority,
 																  mFormattedImage->getData(), datasize,
-																  mFileSize, mRawImage, mDecodedDiscard, responder);
+																  mFileSize, raw, raw_discard, responder);
 		// fall through
 	}
 	
@@ -1970,7 +2005,7 @@ bool LLTextureFetchWorker::doWork(S32 param)
 		}
 		else
 		{
-			if (mDesiredDiscard < mDecodedDiscard)
+			if (mDecodeSkipped || mDesiredDiscard < mDecodedDiscard)
 			{
 				// We're waiting for this write to complete before we can receive more data
 				// (we can't touch mFormattedImage until the write completes)
@@ -1983,7 +2018,14 @@ bool LLTextureFetchWorker::doWork(S32 param)
 
 	if (mState == DONE)
 	{
-		if (mDecodedDiscard >= 0 && mDesiredDiscard < mDecodedDiscard)
+		if (mDecodeSkipped)
+		{
+			// Back for the rest of the data
+			setState(INIT);
+			setPriority(LLWorkerThread::PRIORITY_HIGH | mWorkPriority);
+			return false;
+		}
+		else if (mDecodedDiscard >= 0 && mDesiredDiscard < mDecodedDiscard)
 		{
 			// More data was requested, return to INIT
 			setState(INIT);
@@ -2456,6 +2498,8 @@ void LLTextureFetchWorker::callbackDecoded(bool success, LLImageRaw* raw, LLImag
 		mRawImage = raw;
 		mAuxImage = aux;
 		mDecodedDiscard = mFormattedImage->getDiscardLevel();
+		mShownRawImage = raw;
+		mDecodeSkipper.decoded(mDecodedDiscard);
  		LL_DEBUGS(LOG_TXT) << mID << ": Decode Finished. Discard: " << mDecodedDiscard
 						   << " Raw Image: " << llformat("%dx%d",mRawImage->getWidth(),mRawImage->getHeight()) << LL_ENDL;
 	}
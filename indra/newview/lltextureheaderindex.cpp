@@ -0,0 +1,163 @@
+/**
+ * @file lltextureheaderindex.cpp
+ * @brief Lock-free lookup of texture cache header entries.
+ *
+ * $LicenseInfo:firstyear=2026&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2026, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "lltextureheaderindex.h"
+
+#include <thread>
+
+//----------------------------------------------------------------------------
+// LLEntrySeqLock
+
+void LLEntrySeqLock::init(U32 count)
+{
+	mSeqs.reset(new std::atomic<U32>[count]);
+	for (U32 i = 0; i < count; ++i)
+	{
+		mSeqs[i].store(0, std::memory_order_relaxed);
+	}
+}
+
+void LLEntrySeqLock::read(U32 idx, void* dst, const void* src, size_t size) const
+{
+	std::atomic<U32>& seq = mSeqs[idx];
+	while (true)
+	{
+		U32 before = seq.load(std::memory_order_acquire);
+		if (!(before & 1))
+		{
+			memcpy(dst, src, size);	/* Flawfinder: ignore */
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (seq.load(std::memory_order_relaxed) == before)
+			{
+				return;
+			}
+		}
+		std::this_thread::yield();
+	}
+}
+
+void LLEntrySeqLock::beginWrite(U32 idx)
+{
+	std::atomic<U32>& seq = mSeqs[idx];
+	seq.store(seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+}
+
+void LLEntrySeqLock::endWrite(U32 idx)
+{
+	std::atomic<U32>& seq = mSeqs[idx];
+	seq.store(seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+//----------------------------------------------------------------------------
+// LLTextureHeaderIndex
+// Readers probe with plain atomic loads.  Removal uses backward shift
+// deletion instead of tombstones.
+
+LLTextureHeaderIndex::LLTextureHeaderIndex()
+:	mMask(0)
+{
+}
+
+void LLTextureHeaderIndex::init(U32 max_entries)
+{
+	// Keep the load factor at or below 1/2 so probe sequences stay short
+	U32 size = 16;
+	while (size < max_entries * 2)
+	{
+		size <<= 1;
+	}
+	mSlots.reset(new std::atomic<U64>[size]);
+	mMask = size - 1;
+	clear();
+}
+
+void LLTextureHeaderIndex::clear()
+{
+	if (!mSlots)
+	{
+		return;
+	}
+	for (U32 i = 0; i <= mMask; ++i)
+	{
+		mSlots[i].store(0, std::memory_order_relaxed);
+	}
+	std::atomic_thread_fence(std::memory_order_release);
+}
+
+void LLTextureHeaderIndex::remove(const LLUUID& id, S32 idx)
+{
+	if (!mSlots)
+	{
+		return;
+	}
+	U32 hash = hashID(id);
+	U64 value = makeSlot(hash, idx);
+	U32 pos = hash & mMask;
+	U32 probes = 0;
+	for (; probes <= mMask; ++probes)
+	{
+		U64 slot = mSlots[pos].load(std::memory_order_relaxed);
+		if (!slot)
+		{
+			return; // not indexed
+		}
+		if (slot == value)
+		{
+			break;
+		}
+		pos = (pos + 1) & mMask;
+	}
+	if (probes > mMask)
+	{
+		return;
+	}
+
+	// Pull later members of the probe run back over the hole
+	U32 hole = pos;
+	U32 next = (hole + 1) & mMask;
+	for (; ; next = (next + 1) & mMask)
+	{
+		U64 slot = mSlots[next].load(std::memory_order_relaxed);
+		if (!slot)
+		{
+			break;
+		}
+		U32 home = slotHash(slot) & mMask;
+		// The slot may move to the hole only if its home is not cyclically
+		// within (hole, next]
+		bool movable = (hole <= next) ? (home <= hole || home > next)
+									  : (home <= hole && home > next);
+		if (movable)
+		{
+			mSlots[hole].store(slot, std::memory_order_release);
+			hole = next;
+		}
+	}
+	mSlots[hole].store(0, std::memory_order_release);
+}
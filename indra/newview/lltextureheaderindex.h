@@ -0,0 +1,142 @@
+/**
+ * @file lltextureheaderindex.h
+ * @brief Lock-free lookup of texture cache header entries.
+ *
+ * $LicenseInfo:firstyear=2026&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2026, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLTEXTUREHEADERINDEX_H
+#define LL_LLTEXTUREHEADERINDEX_H
+
+#include "llerror.h"
+#include "lluuid.h"
+
+#include <atomic>
+#include <memory>
+
+// One sequence number per record of a shared array, odd while a writer is
+// changing the record, so readers that don't hold the writers' mutex can
+// detect a torn copy and retry.  Writers must be serialized per record.
+class LLEntrySeqLock
+{
+public:
+	// Sizes the lock for count records.  Not thread safe.
+	void init(U32 count);
+
+	// Copies size bytes from src, which belongs to record idx, retrying
+	// until no writer touched the record while they were copied.
+	void read(U32 idx, void* dst, const void* src, size_t size) const;
+
+	void beginWrite(U32 idx);
+	void endWrite(U32 idx);
+
+private:
+	std::unique_ptr<std::atomic<U32>[]> mSeqs;
+};
+
+// Open-addressed UUID -> entry index table.  Lookups never lock and never
+// allocate; insert, remove and clear must be serialized by the caller.
+// A lookup that races a remove can miss an entry that is present, so a
+// miss is only a hint until it is repeated under the writers' lock.
+//
+// The table only holds hashes; the ids themselves stay in the caller's
+// entries, which lookups read through get_id(idx) -> LLUUID.  For lookups
+// that don't hold the writers' lock, get_id must read the id consistently,
+// e.g. through an LLEntrySeqLock.
+class LLTextureHeaderIndex
+{
+public:
+	LLTextureHeaderIndex();
+
+	// Sizes the table for max_entries and empties it.  Not thread safe.
+	void init(U32 max_entries);
+	void clear();
+
+	template<typename GetID>
+	S32 find(const LLUUID& id, GetID get_id) const;
+	// The entry at idx must already hold id.  Replaces any stale slot for id.
+	template<typename GetID>
+	void insert(const LLUUID& id, S32 idx, GetID get_id);
+	void remove(const LLUUID& id, S32 idx);
+
+private:
+	static U32 hashID(const LLUUID& id) { return (U32)id.hash(); }
+	// Each slot packs the UUID hash in the high word and idx + 1 in the
+	// low word, so an empty slot is 0.
+	static U64 makeSlot(U32 hash, S32 idx) { return ((U64)hash << 32) | (U32)(idx + 1); }
+	static U32 slotHash(U64 slot) { return (U32)(slot >> 32); }
+	static S32 slotIndex(U64 slot) { return (S32)(U32)slot - 1; }
+
+	std::unique_ptr<std::atomic<U64>[]> mSlots;
+	U32 mMask;
+};
+
+template<typename GetID>
+S32 LLTextureHeaderIndex::find(const LLUUID& id, GetID get_id) const
+{
+	if (!mSlots)
+	{
+		return -1;
+	}
+	U32 hash = hashID(id);
+	U32 pos = hash & mMask;
+	for (U32 probes = 0; probes <= mMask; ++probes)
+	{
+		U64 slot = mSlots[pos].load(std::memory_order_acquire);
+		if (!slot)
+		{
+			break;
+		}
+		if (slotHash(slot) == hash && get_id(slotIndex(slot)) == id)
+		{
+			return slotIndex(slot);
+		}
+		pos = (pos + 1) & mMask;
+	}
+	return -1;
+}
+
+template<typename GetID>
+void LLTextureHeaderIndex::insert(const LLUUID& id, S32 idx, GetID get_id)
+{
+	if (!mSlots)
+	{
+		return;
+	}
+	U32 hash = hashID(id);
+	U32 pos = hash & mMask;
+	for (U32 probes = 0; probes <= mMask; ++probes)
+	{
+		U64 slot = mSlots[pos].load(std::memory_order_relaxed);
+		if (!slot
+			|| (slotHash(slot) == hash
+				&& (slotIndex(slot) == idx || get_id(slotIndex(slot)) == id)))
+		{
+			mSlots[pos].store(makeSlot(hash, idx), std::memory_order_release);
+			return;
+		}
+		pos = (pos + 1) & mMask;
+	}
+	LL_WARNS("TextureCache") << "Header index full, dropping " << id << LL_ENDL;
+}
+
+#endif // LL_LLTEXTUREHEADERINDEX_H
@@ -49,6 +49,7 @@
 #include "llfollowcamparams.h"
 #include "llinventorydefines.h"
 #include "lllslconstants.h"
+#include "llmessagedecoders.h"
 #include "llregionhandle.h"
 #include "llsd.h"
 #include "llsdserialize.h"
@@ -350,26 +351,21 @@ void process_layer_data(LLMessageSystem* mesgsys, void** user_data)
 		LL_WARNS() << "Invalid region for layer data." << LL_ENDL;
 		return;
 	}
-	S32 size;
-	S8 type;
-
-	mesgsys->getS8Fast(_PREHASH_LayerID, _PREHASH_Type, type);
-	size = mesgsys->getSizeFast(_PREHASH_LayerData, _PREHASH_Data);
-	if (0 == size)
+	LLDecodedLayerData decoded;
+	if (!decoded.parse(mesgsys))
 	{
-		LL_WARNS("Messaging") << "Layer data has zero size." << LL_ENDL;
+		LL_WARNS("Messaging") << "Could not parse layer data." << LL_ENDL;
 		return;
 	}
-	if (size < 0)
+	S8 type = (S8)decoded.mLayerID.mType;
+	S32 size = decoded.mLayerData.mDataSize;
+	if (0 == size)
 	{
-		// getSizeFast() is probably trying to tell us about an error
-		LL_WARNS("Messaging") << "getSizeFast() returned negative result: "
-			<< size
-			<< LL_ENDL;
+		LL_WARNS("Messaging") << "Layer data has zero size." << LL_ENDL;
 		return;
 	}
 	U8* datap = new U8[size];
-	mesgsys->getBinaryDataFast(_PREHASH_LayerData, _PREHASH_Data, datap, size);
+	memcpy(datap, decoded.mLayerData.mData, size);		/* Flawfinder: ignore */
 	LLVLData* vl_datap = new LLVLData(regionp, type, datap, size);
 	if (mesgsys->getReceiveCompressedSize())
 	{
@@ -4711,6 +4707,9 @@ void process_kill_object(LLMessageSystem* mesgsys, void** user_data)
 {
 	LL_RECORD_BLOCK_TIME(FTM_PROCESS_OBJECTS);
 
+	// Kill the cache entries that queued updates may still add
+	gObjectList.flushObjectUpdates();
+
 	LLUUID id;
 
 	U32 ip = mesgsys->getSenderIP();
@@ -106,11 +106,13 @@
 #include "llvocache.h"
 #include "llviewernetwork.h"
 #include "llcleanup.h"
+#include "llterseupdatebatch.h"
 
 //#define DEBUG_UPDATE_TYPE
 
 BOOL		LLViewerObject::sVelocityInterpolate = TRUE;
 BOOL		LLViewerObject::sPingInterpolate = TRUE; 
+const LLTerseUpdateBatch* LLViewerObject::sTerseUpdateBatch = NULL;
 
 U32			LLViewerObject::sNumZombieObjects = 0;
 S32			LLViewerObject::sNumObjects = 0;
@@ -633,6 +635,14 @@ void LLViewerObject::unpackU8(LLDataPackerBinaryBuffer* dp, U8& value, std::stri
 	dp->reset();
 }
 
+//static 
+U32 LLViewerObject::getObjectDataOffset(const std::string& name)
+{
+	std::map<std::string, U32>::const_iterator iter = sObjectDataMap.find(name);
+	llassert(iter != sObjectDataMap.end());
+	return iter != sObjectDataMap.end() ? iter->second : 0;
+}
+
 //static 
 U32 LLViewerObject::unpackParentID(LLDataPackerBinaryBuffer* dp, U32& parent_id)
 {
@@ -1677,7 +1687,16 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 
 		U8		state;
 
-		dp->unpackU8(state, "State");
+		const LLTerseUpdateBatch* batch = sTerseUpdateBatch;
+		if (update_type != OUT_TERSE_IMPROVED || !batch || !batch->isDecoded(block_num))
+		{
+			batch = NULL;
+			dp->unpackU8(state, "State");
+		}
+		else
+		{
+			state = batch->getState(block_num);
+		}
 		mState = state;
 
 		switch(update_type)
@@ -1687,6 +1706,23 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 #ifdef DEBUG_UPDATE_TYPE
 				LL_INFOS() << "CompTI:" << getID() << LL_ENDL;
 #endif
+				if (batch)
+				{
+					// Already unpacked and dequantized with the rest of the message
+					if (batch->hasFootPlane(block_num))
+					{
+						((LLVOAvatar*)this)->setFootPlane(batch->getFootPlane(block_num));
+					}
+					test_pos_parent = getPosition();
+					new_pos_parent = batch->getPosition(block_num);
+					setVelocity(batch->getVelocity(block_num));
+					setAcceleration(batch->getAcceleration(block_num));
+					batch->getRotation(block_num, new_rot);
+					new_angv = batch->getAngularVelocity(block_num);
+					setAngularVelocity(new_angv);
+					break;
+				}
+
 				U8		value;
 				dp->unpackU8(value, "agent");
 				if (value)
@@ -54,6 +54,7 @@ class LLMessageSystem;
 class LLNameValue;
 class LLPartSysData;
 class LLPipeline;
+class LLTerseUpdateBatch;
 class LLTextureEntry;
 class LLVOAvatar;
 class LLVOInventoryListener;
@@ -570,6 +571,8 @@ public:
 	static void unpackU32(LLDataPackerBinaryBuffer* dp, U32& value, std::string name);
 	static void unpackU8(LLDataPackerBinaryBuffer* dp, U8& value, std::string name);
 	static U32 unpackParentID(LLDataPackerBinaryBuffer* dp, U32& parent_id);
+	// Offset of a named field in a compressed object update
+	static U32 getObjectDataOffset(const std::string& name);
 
 public:
 	//counter-translation
@@ -812,8 +815,14 @@ protected:
 	static void	setVelocityInterpolate(BOOL value)		{ sVelocityInterpolate = value;	}
 	static void	setPingInterpolate(BOOL value)			{ sPingInterpolate = value;	}
 
+	// Set by LLViewerObjectList while it applies an ImprovedTerseObjectUpdate
+	// it has already dequantized, NULL otherwise.  processUpdateMessage()
+	// takes OUT_TERSE_IMPROVED blocks from here rather than the data packer.
+	static void setTerseUpdateBatch(const LLTerseUpdateBatch* batch)	{ sTerseUpdateBatch = batch; }
+
 private:	
 	static S32 sNumObjects;
+	static const LLTerseUpdateBatch* sTerseUpdateBatch;
 
 	static F64Seconds sPhaseOutUpdateInterpolationTime;	// For motion interpolation
 	static F64Seconds sMaxUpdateInterpolationTime;			// For motion interpolation
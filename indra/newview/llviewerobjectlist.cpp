@@ -29,8 +29,11 @@
 #include "llviewerprecompiledheaders.h"
 
 #include "llviewerobjectlist.h"
+#include "llobjectupdatedecoder.h"
+#include "llterseupdatebatch.h"
 
 #include "message.h"
+#include "llmessagedecoders.h"
 #include "llfasttimer.h"
 #include "llrender.h"
 #include "llwindow.h"		// decBusyCount()
@@ -121,6 +124,8 @@ LLViewerObjectList::~LLViewerObjectList()
 
 void LLViewerObjectList::destroy()
 {
+	mUpdateQueue.reset();
+
 	killAllObjects();
 
 	resetObjectBeacons();
@@ -297,6 +302,9 @@ void LLViewerObjectList::processUpdateCore(LLViewerObject* objectp,
 }
 
 static LLTrace::BlockTimerStatHandle FTM_PROCESS_OBJECTS("Process Objects");
+static LLTrace::BlockTimerStatHandle FTM_COPY_OBJECT_UPDATES("Copy Object Updates");
+static LLTrace::BlockTimerStatHandle FTM_DECODE_OBJECT_UPDATES("Decode Object Updates");
+static LLTrace::BlockTimerStatHandle FTM_APPLY_OBJECT_UPDATES("Apply Object Updates");
 
 LLViewerObject* LLViewerObjectList::processObjectUpdateFromCache(LLVOCacheEntry* entry, LLViewerRegion* regionp)
 {
@@ -455,6 +463,26 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 		return;
 	}
 
+	// Messages that only carry object cache updates are decoded off the
+	// main thread and applied by flushObjectUpdates().
+	if (compressed && update_type == OUT_FULL_COMPRESSED
+		&& queueObjectUpdates(mesgsys, regionp, num_objects))
+	{
+		return;
+	}
+
+	// Everything else is applied now, after any updates still queued.
+	flushObjectUpdates();
+
+	// Terse updates are dequantized for the whole message here, then
+	// processUpdateMessage() picks each object's values up from the batch
+	const bool terse_batch = compressed && update_type == OUT_TERSE_IMPROVED
+		&& decodeTerseUpdates(mesgsys);
+	if (terse_batch)
+	{
+		LLViewerObject::setTerseUpdateBatch(mTerseBatch.get());
+	}
+
 	U8 compressed_dpbuffer[2048];
 	LLDataPackerBinaryBuffer compressed_dp(compressed_dpbuffer, 2048);
 	LLViewerStatsRecorder& recorder = LLViewerStatsRecorder::instance();
@@ -467,7 +495,24 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 		S32	msg_size = 0;
 		bool update_cache = false; //update object cache if it is a full-update or terse update
 
-		if (compressed)
+		if (terse_batch && mTerseBatch->isDecoded(i))
+		{
+			update_cache = true;
+			local_id = mTerseBatch->getLocalID(i);
+			fullid = mTerseIDs[i];
+			if (fullid.isNull())
+			{
+				LL_DEBUGS() << "update for unknown localid " << local_id << " host " << gMessageSystem->getSender() << ":" << gMessageSystem->getSenderPort() << LL_ENDL;
+				mNumUnknownUpdates++;
+			}
+
+			// Start loading the next object while this one is applied
+			if (i + 1 < mTerseBatch->getCount() && mTerseObjects[i + 1])
+			{
+				_mm_prefetch((const char*)mTerseObjects[i + 1], _MM_HINT_T0);
+			}
+		}
+		else if (compressed)
 		{
 			S32							uncompressed_length = 2048;
 			compressed_dp.reset();
@@ -532,7 +577,21 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 			msg_size += sizeof(U32);
 			// LL_INFOS() << "Full Update, obj " << local_id << ", global ID" << fullid << "from " << mesgsys->getSender() << LL_ENDL;
 		}
-		objectp = findObject(fullid);
+
+		if (terse_batch && mTerseBatch->isDecoded(i))
+		{
+			// Looked up by decodeTerseUpdates(), but an earlier block may
+			// have killed it since
+			objectp = mTerseObjects[i];
+			if (objectp && objectp->isDead())
+			{
+				objectp = NULL;
+			}
+		}
+		else
+		{
+			objectp = findObject(fullid);
+		}
 
 		if(update_cache)
 		{
@@ -660,11 +719,140 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 		objectp->setLastUpdateType(update_type);
 	}
 
+	LLViewerObject::setTerseUpdateBatch(NULL);
+
 	recorder.log(0.2f);
 
 	LLVOAvatar::cullAvatarsByPixelArea();
 }
 
+bool LLViewerObjectList::decodeTerseUpdates(LLMessageSystem* mesgsys)
+{
+	static LLCachedControl<bool> batch_terse_updates(gSavedSettings, "BatchTerseObjectUpdates", true);
+	if (!batch_terse_updates)
+	{
+		return false;
+	}
+
+	if (!mTerseMessage)
+	{
+		mTerseMessage.reset(new LLDecodedImprovedTerseObjectUpdate);
+		mTerseBatch.reset(new LLTerseUpdateBatch);
+	}
+	if (!mTerseMessage->parse(mesgsys))
+	{
+		return false;
+	}
+	mTerseBatch->decode(*mTerseMessage);
+
+	// Look every object up before applying any, so each one can be
+	// prefetched while the one before it is applied
+	const S32 count = mTerseBatch->getCount();
+	const U32 ip = mesgsys->getSenderIP();
+	const U32 port = mesgsys->getSenderPort();
+	mTerseIDs.resize(count);
+	mTerseObjects.resize(count);
+	for (S32 i = 0; i < count; ++i)
+	{
+		mTerseIDs[i].setNull();
+		mTerseObjects[i] = NULL;
+		if (mTerseBatch->isDecoded(i))
+		{
+			getUUIDFromLocal(mTerseIDs[i], mTerseBatch->getLocalID(i), ip, port);
+			mTerseObjects[i] = findObject(mTerseIDs[i]);
+		}
+	}
+	return true;
+}
+
+bool LLViewerObjectList::queueObjectUpdates(LLMessageSystem* mesgsys, LLViewerRegion* regionp, S32 num_objects)
+{
+	static LLCachedControl<U32> decode_threads(gSavedSettings, "ObjectUpdateDecodeThreads", 1);
+	if (!decode_threads)
+	{
+		return false;
+	}
+
+	LL_RECORD_BLOCK_TIME(FTM_COPY_OBJECT_UPDATES);
+
+	// Size the batch's buffer once for the whole message
+	S32 total_size = 0;
+	for (S32 i = 0; i < num_objects; i++)
+	{
+		U32 flags = 0;
+		mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_UpdateFlags, flags, i);
+		S32 size = mesgsys->getSizeFast(_PREHASH_ObjectData, i, _PREHASH_Data);
+		if ((flags & FLAGS_TEMPORARY_ON_REZ) || size < 0)
+		{
+			// Temporary objects skip the cache and are created right away,
+			// so the whole message is handled in order on the main thread.
+			return false;
+		}
+		total_size += size;
+	}
+
+	std::unique_ptr<LLObjectUpdateBatch> batch(new LLObjectUpdateBatch);
+	batch->mRegionHandle = regionp->getHandle();
+	batch->mData.reserve(total_size);
+	batch->mBlocks.reserve(num_objects);
+	for (S32 i = 0; i < num_objects; i++)
+	{
+		U32 flags = 0;
+		mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_UpdateFlags, flags, i);
+		S32 size = mesgsys->getSizeFast(_PREHASH_ObjectData, i, _PREHASH_Data);
+		U8* data = batch->addBlock(flags, size);
+		if (data)
+		{
+			mesgsys->getBinaryDataFast(_PREHASH_ObjectData, _PREHASH_Data, data, size, i, size);
+		}
+	}
+
+	// The pool keeps the size it was started with until restart
+	if (!mUpdateQueue)
+	{
+		mUpdateQueue.reset(new LLObjectUpdateDecodeQueue(LLViewerRegion::getObjectUpdateDecoder(), decode_threads));
+	}
+	mUpdateQueue->addBatch(batch.release());
+	return true;
+}
+
+void LLViewerObjectList::flushObjectUpdates()
+{
+	if (!mUpdateQueue)
+	{
+		return;
+	}
+
+	while (true)
+	{
+		LLObjectUpdateBatch* batch;
+		{
+			// Only takes time if the batch is still waiting for a thread
+			LL_RECORD_BLOCK_TIME(FTM_DECODE_OBJECT_UPDATES);
+			batch = mUpdateQueue->popBatch();
+		}
+		if (!batch)
+		{
+			break;
+		}
+
+		LL_RECORD_BLOCK_TIME(FTM_APPLY_OBJECT_UPDATES);
+		record(LLStatViewer::OBJECT_UPDATE_DECODE_TIME, batch->mDecodeTime);
+
+		// The region may have gone away while the batch was queued
+		LLViewerRegion* regionp = LLWorld::getInstance()->getRegionFromHandle(batch->mRegionHandle);
+		if (regionp)
+		{
+			for (const LLObjectUpdateBatch::Block& block : batch->mBlocks)
+			{
+				LLDataPackerBinaryBuffer dp(const_cast<U8*>(batch->getData(block)), block.mSize);
+				regionp->cacheFullUpdate(dp, block.mUpdateFlags, block.mDecoded ? &block.mInfo : nullptr);
+			}
+		}
+		delete batch;
+	}
+}
+
 void LLViewerObjectList::processCompressedObjectUpdate(LLMessageSystem *mesgsys,
 											 void **user_data,
 											 const EObjectUpdateType update_type)
@@ -678,6 +866,9 @@ void LLViewerObjectList::processCachedObjectUpdate(LLMessageSystem *mesgsys,
 {
 	//processObjectUpdate(mesgsys, user_data, update_type, true, false);
 
+	// probeCache() must see the cache updates that came before this message
+	flushObjectUpdates();
+
 	S32 num_objects = mesgsys->getNumberOfBlocksFast(_PREHASH_ObjectData);
 	gFullObjectUpdates += num_objects;
 
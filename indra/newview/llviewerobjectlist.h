@@ -27,6 +27,7 @@
 #ifndef LL_LLVIEWEROBJECTLIST_H
 #define LL_LLVIEWEROBJECTLIST_H
 
+#include <memory>
 #include <boost/unordered_map.hpp>
 
 // common includes
@@ -41,6 +42,9 @@ class LLCamera;
 class LLNetMap;
 class LLDebugBeacon;
 class LLVOCacheEntry;
+class LLObjectUpdateDecodeQueue;
+class LLTerseUpdateBatch;
+struct LLDecodedImprovedTerseObjectUpdate;
 
 constexpr U32 CLOSE_BIN_SIZE = 10;
 constexpr U32 NUM_BINS = 128;
@@ -86,6 +90,9 @@ public:
 	void processObjectUpdate(LLMessageSystem *mesgsys, void **user_data, EObjectUpdateType update_type, bool compressed=false);
 	void processCompressedObjectUpdate(LLMessageSystem *mesgsys, void **user_data, EObjectUpdateType update_type);
 	void processCachedObjectUpdate(LLMessageSystem *mesgsys, void **user_data, EObjectUpdateType update_type);
+	// Apply cache updates still queued for decoding.  Call this before
+	// anything that must see object and cache state in message order.
+	void flushObjectUpdates();
 	void updateApparentAngles(LLAgent &agent);
 	void update(LLAgent &agent);
 
@@ -229,6 +236,22 @@ protected:
 	friend class LLViewerObject;
 
 private:
+	// Unpacks and dequantizes a whole ImprovedTerseObjectUpdate into
+	// mTerseBatch and looks up the objects it updates.  False if the
+	// message has to be applied the old way.
+	bool decodeTerseUpdates(LLMessageSystem* mesgsys);
+
+	std::unique_ptr<LLDecodedImprovedTerseObjectUpdate> mTerseMessage;
+	std::unique_ptr<LLTerseUpdateBatch> mTerseBatch;
+	std::vector<LLUUID> mTerseIDs;
+	std::vector<LLViewerObject*> mTerseObjects;
+
+	// Queues a message that only carries object cache updates for
+	// decoding off the main thread.  False if it has to be applied now.
+	bool queueObjectUpdates(LLMessageSystem* mesgsys, LLViewerRegion* regionp, S32 num_objects);
+
+	std::unique_ptr<LLObjectUpdateDecodeQueue> mUpdateQueue;
+
     static void reportObjectCostFailure(LLSD &objectList);
     void fetchObjectCostsCoro(std::string url);
 
@@ -36,6 +36,7 @@
 #include "llavatarnamecache.h"		// name lookup cap url
 #include "llfloaterreg.h"
 #include "llmath.h"
+#include "llmessagedecoders.h"
 #include "llregionflags.h"
 #include "llregionhandle.h"
 #include "llsurface.h"
@@ -55,6 +56,7 @@
 #include "llhttpnode.h"
 #include "lllogininstance.h"
 #include "llnotificationsutil.h"
+#include "llobjectupdatedecoder.h"
 #include "llregioninfomodel.h"
 #include "llslurl.h"
 #include "llstartup.h"
@@ -188,6 +190,7 @@ public:
 	LLVLComposition *mCompositionp;		// Composition layer for the surface
 
 	LLVOCacheEntry::vocache_entry_map_t	  mCacheMap; //all cached entries
+	LLPointer<LLVOCacheFile>              mCacheFile; //entries not yet read out of the cache file
 	LLVOCacheEntry::vocache_entry_set_t   mActiveSet; //all active entries;
 	LLVOCacheEntry::vocache_entry_set_t   mWaitingSet; //entries waiting for LLDrawable to be generated.	
 	std::set< LLPointer<LLViewerOctreeGroup> >      mVisibleGroups; //visible groupa
@@ -676,8 +679,8 @@ void LLViewerRegion::loadObjectCache()
 
 	if(LLVOCache::instanceExists())
 	{
-		LLVOCache::getInstance()->readFromCache(mHandle, mImpl->mCacheID, mImpl->mCacheMap) ;
-		if (mImpl->mCacheMap.empty())
+		mImpl->mCacheFile = LLVOCache::getInstance()->readFromCache(mHandle, mImpl->mCacheID) ;
+		if (isCacheEmpty())
 		{
 			mCacheDirty = TRUE;
 		}
@@ -692,7 +695,7 @@ void LLViewerRegion::saveObjectCache()
 		return;
 	}
 
-	if (mImpl->mCacheMap.empty())
+	if (isCacheEmpty())
 	{
 		return;
 	}
@@ -702,11 +705,17 @@ void LLViewerRegion::saveObjectCache()
 		const F32 start_time_threshold = 600.0f; //seconds
 		bool removal_enabled = sVOCacheCullingEnabled && (mRegionTimer.getElapsedTimeF32() > start_time_threshold); //allow to remove invalid objects from object cache file.
 		
-		LLVOCache::getInstance()->writeToCache(mHandle, mImpl->mCacheID, mImpl->mCacheMap, mCacheDirty, removal_enabled) ;
+		LLVOCache::getInstance()->writeToCache(mHandle, mImpl->mCacheID, mImpl->mCacheMap, mImpl->mCacheFile, mCacheDirty, removal_enabled) ;
 		mCacheDirty = FALSE;
 	}
 
 	mImpl->mCacheMap.clear();
+	mImpl->mCacheFile = nullptr;
+}
+
+bool LLViewerRegion::isCacheEmpty() const
+{
+	return mImpl->mCacheMap.empty() && (mImpl->mCacheFile.isNull() || !mImpl->mCacheFile->getNumEntries());
 }
 
 void LLViewerRegion::sendMessage()
@@ -2113,28 +2122,29 @@ void LLViewerRegion::updateCoarseLocations(LLMessageSystem* msg)
 	LLViewerRegion* cur_region = gAgent.getRegion();
 	uuid_vec_t region_agents;
 
-	U8 x_pos = 0;
-	U8 y_pos = 0;
-	U8 z_pos = 0;
+	// Large enough to keep off the stack
+	static LLDecodedCoarseLocationUpdate decoded;
+	if (!decoded.parse(msg))
+	{
+		return;
+	}
 
 	U32 pos = 0x0;
 
-	S16 agent_index;
-	S16 target_index;
-	msg->getS16Fast(_PREHASH_Index, _PREHASH_You, agent_index);
-	msg->getS16Fast(_PREHASH_Index, _PREHASH_Prey, target_index);
+	S16 agent_index = decoded.mIndex.mYou;
+	S16 target_index = decoded.mIndex.mPrey;
 
-	BOOL has_agent_data = msg->has(_PREHASH_AgentData);
-	S32 count = msg->getNumberOfBlocksFast(_PREHASH_Location);
+	BOOL has_agent_data = decoded.mNumAgentData > 0;
+	S32 count = decoded.mNumLocation;
 	for(S32 i = 0; i < count; i++)
 	{
-		msg->getU8Fast(_PREHASH_Location, _PREHASH_X, x_pos, i);
-		msg->getU8Fast(_PREHASH_Location, _PREHASH_Y, y_pos, i);
-		msg->getU8Fast(_PREHASH_Location, _PREHASH_Z, z_pos, i);
+		U8 x_pos = decoded.mLocation[i].mX;
+		U8 y_pos = decoded.mLocation[i].mY;
+		U8 z_pos = decoded.mLocation[i].mZ;
 		LLUUID agent_id = LLUUID::null;
-		if(has_agent_data)
+		if(has_agent_data && i < decoded.mNumAgentData)
 		{
-			msg->getUUIDFast(_PREHASH_AgentData, _PREHASH_AgentID, agent_id, i);
+			agent_id = decoded.mAgentData[i].mAgentID;
 		}
 
 		//LL_INFOS() << "  object X: " << (S32)x_pos << " Y: " << (S32)y_pos
@@ -2278,7 +2288,7 @@ void LLViewerRegion::findOrphans(U32 parent_id)
 	}
 }
 
-void LLViewerRegion::decodeBoundingInfo(LLVOCacheEntry* entry)
+void LLViewerRegion::decodeBoundingInfo(LLVOCacheEntry* entry, const LLCompressedObjectInfo* info)
 {
 	if(!sVOCacheCullingEnabled)
 	{
@@ -2315,7 +2325,14 @@ void LLViewerRegion::decodeBoundingInfo(LLVOCacheEntry* entry)
 
 		//set parent id
 		U32	parent_id = 0;
-		LLViewerObject::unpackParentID(entry->getDP(), parent_id);
+		if (info)
+		{
+			parent_id = info->mParentID;
+		}
+		else
+		{
+			LLViewerObject::unpackParentID(entry->getDP(), parent_id);
+		}
 		if(parent_id != entry->getParentID())
 		{				
 			entry->setParentID(parent_id);
@@ -2335,7 +2352,18 @@ void LLViewerRegion::decodeBoundingInfo(LLVOCacheEntry* entry)
 	LLQuaternion rot;
 
 	//decode spatial info and parent info
-	U32 parent_id = LLViewerObject::extractSpatialExtents(entry->getDP(), pos, scale, rot);
+	U32 parent_id;
+	if (info)
+	{
+		parent_id = info->mParentID;
+		pos = info->mPosition;
+		scale = info->mScale;
+		rot = info->mRotation;
+	}
+	else
+	{
+		parent_id = LLViewerObject::extractSpatialExtents(entry->getDP(), pos, scale, rot);
+	}
 	
 	U32 old_parent_id = entry->getParentID();
 	bool same_old_parent = false;
@@ -2444,14 +2472,49 @@ void LLViewerRegion::decodeBoundingInfo(LLVOCacheEntry* entry)
 	return ;
 }
 
+//static
+const LLObjectUpdateDecoder& LLViewerRegion::getObjectUpdateDecoder()
+{
+	static LLObjectUpdateDecoder::Offsets offsets;
+	static bool initialized = false;
+	if (!initialized)
+	{
+		offsets.mLocalID = LLViewerObject::getObjectDataOffset("LocalID");
+		offsets.mCRC = LLViewerObject::getObjectDataOffset("CRC");
+		offsets.mScale = LLViewerObject::getObjectDataOffset("Scale");
+		offsets.mPos = LLViewerObject::getObjectDataOffset("Pos");
+		offsets.mRot = LLViewerObject::getObjectDataOffset("Rot");
+		offsets.mSpecialCode = LLViewerObject::getObjectDataOffset("SpecialCode");
+		offsets.mParentID = LLViewerObject::getObjectDataOffset("ParentID");
+		initialized = true;
+	}
+	static LLObjectUpdateDecoder decoder(offsets);
+	return decoder;
+}
+
 LLViewerRegion::eCacheUpdateResult LLViewerRegion::cacheFullUpdate(LLDataPackerBinaryBuffer &dp, U32 flags)
+{
+	LLCompressedObjectInfo info;
+	const bool decoded = getObjectUpdateDecoder().decode(dp.getBuffer(), dp.getBufferSize(), info);
+	return cacheFullUpdate(dp, flags, decoded ? &info : nullptr);
+}
+
+LLViewerRegion::eCacheUpdateResult LLViewerRegion::cacheFullUpdate(LLDataPackerBinaryBuffer &dp, U32 flags, const LLCompressedObjectInfo* info)
 {
 	eCacheUpdateResult result;
 	U32 crc;
 	U32 local_id;
 
-	LLViewerObject::unpackU32(&dp, local_id, "LocalID");
-	LLViewerObject::unpackU32(&dp, crc, "CRC");
+	if (info)
+	{
+		local_id = info->mLocalID;
+		crc = info->mCRC;
+	}
+	else
+	{
+		LLViewerObject::unpackU32(&dp, local_id, "LocalID");
+		LLViewerObject::unpackU32(&dp, crc, "CRC");
+	}
 
 	LLVOCacheEntry* entry = getCacheEntry(local_id, false);
 
@@ -2471,7 +2534,7 @@ LLViewerRegion::eCacheUpdateResult LLViewerRegion::cacheFullUpdate(LLDataPackerB
 			// Update the cache entry
 			entry->updateEntry(crc, dp);
 
-			decodeBoundingInfo(entry);
+			decodeBoundingInfo(entry, info);
 
 			result = CACHE_UPDATE_CHANGED;
 		}		
@@ -2486,7 +2549,7 @@ LLViewerRegion::eCacheUpdateResult LLViewerRegion::cacheFullUpdate(LLDataPackerB
 		
 		mImpl->mCacheMap[local_id] = entry;
 		
-		decodeBoundingInfo(entry);
+		decodeBoundingInfo(entry, info);
 	}
 	entry->setUpdateFlags(flags);
 
@@ -2516,6 +2579,17 @@ LLVOCacheEntry* LLViewerRegion::getCacheEntryForOctree(U32 local_id)
 LLVOCacheEntry* LLViewerRegion::getCacheEntry(U32 local_id, bool valid)
 {
 	LLVOCacheEntry::vocache_entry_map_t::iterator iter = mImpl->mCacheMap.find(local_id);
+	if(iter == mImpl->mCacheMap.end() && mImpl->mCacheFile.notNull())
+	{
+		// Entries come out of the cache file the first time they are asked for
+		const U8* data;
+		U32 size;
+		if(mImpl->mCacheFile->takeRecord(local_id, data, size))
+		{
+			LLPointer<LLVOCacheEntry> entry = new LLVOCacheEntry(data, size);
+			iter = mImpl->mCacheMap.insert(std::make_pair(local_id, entry)).first;
+		}
+	}
 	if(iter != mImpl->mCacheMap.end())
 	{
 		if(!valid || iter->second->isValid())
@@ -2880,7 +2954,7 @@ void LLViewerRegion::unpackRegionHandshake()
 	{
 		flags |= 0x00000001; //set the bit 0 to be 1 to ask sim to send all cacheable objects.		
 	}
-	if(mImpl->mCacheMap.empty())
+	if(isCacheEmpty())
 	{
 		flags |= 0x00000002; //set the bit 1 to be 1 to tell sim the cache file is empty, no need to send cache probes.
 	}
@@ -68,6 +68,8 @@ class LLDrawable;
 class LLViewerRegionImpl;
 class LLViewerOctreeGroup;
 class LLVOCachePartition;
+struct LLCompressedObjectInfo;
+class LLObjectUpdateDecoder;
 
 class LLViewerRegion: public LLCapabilityProvider // implements this interface
 {
@@ -102,6 +104,8 @@ public:
 	// Call this after you have the region name and handle.
 	void loadObjectCache();
 	void saveObjectCache();
+	// TRUE if there are no cache entries, loaded or still in the cache file
+	bool isCacheEmpty() const;
 
 	void sendMessage(); // Send the current message to this region's simulator
 	void sendReliableMessage(); // Send the current message to this region's simulator
@@ -337,6 +341,11 @@ public:
 	// handle a full update message
 	eCacheUpdateResult cacheFullUpdate(LLDataPackerBinaryBuffer &dp, U32 flags);
 	eCacheUpdateResult cacheFullUpdate(LLViewerObject* objectp, LLDataPackerBinaryBuffer &dp, U32 flags);	
+	// handle one cacheable block of a full update, already read by the
+	// decoder below, or by the data packer if info is NULL
+	eCacheUpdateResult cacheFullUpdate(LLDataPackerBinaryBuffer &dp, U32 flags, const LLCompressedObjectInfo* info);
+	// Reads the cache fields of ObjectUpdateCompressed blocks
+	static const LLObjectUpdateDecoder& getObjectUpdateDecoder();
 	LLVOCacheEntry* getCacheEntryForOctree(U32 local_id);
 	LLVOCacheEntry* getCacheEntry(U32 local_id, bool valid = true);
 	bool probeCache(U32 local_id, U32 crc, U32 flags, U8 &cache_miss_type);
@@ -425,7 +434,8 @@ private:
 	void updateVisibleEntries(F32 max_time); //update visible entries
 
 	void addCacheMiss(U32 id, LLViewerRegion::eCacheMissType miss_type);
-	void decodeBoundingInfo(LLVOCacheEntry* entry);
+	// info, if given, holds the entry's parent and spatial extents
+	void decodeBoundingInfo(LLVOCacheEntry* entry, const LLCompressedObjectInfo* info = nullptr);
 	bool isNonCacheableObjectCreated(U32 local_id);
 	void setGodnames();
 
@@ -197,7 +197,8 @@ LLTrace::EventStatHandle<F64Milliseconds >	REGION_CROSSING_TIME("regioncrossingt
 																NETWORK_STACKTIME("networkstacktime", "NETWORK_SECS"),
 																IMAGE_STACKTIME("imagestacktime", "IMAGE_SECS"),
 																REBUILD_STACKTIME("rebuildstacktime", "REBUILD_SECS"),
-																RENDER_STACKTIME("renderstacktime", "RENDER_SECS");
+																RENDER_STACKTIME("renderstacktime", "RENDER_SECS"),
+																OBJECT_UPDATE_DECODE_TIME("objectupdatedecodetime", "Time spent decoding each batch of object cache updates");
 	
 LLTrace::EventStatHandle<F64Seconds >	AVATAR_EDIT_TIME("avataredittime", "Seconds in Edit Appearance"),
 															TOOLBOX_TIME("toolboxtime", "Seconds using Toolbox"),
@@ -231,7 +231,8 @@ extern LLTrace::EventStatHandle<F64Milliseconds >	REGION_CROSSING_TIME,
 														NETWORK_STACKTIME,
 														IMAGE_STACKTIME,
 														REBUILD_STACKTIME,
-														RENDER_STACKTIME;
+														RENDER_STACKTIME,
+														OBJECT_UPDATE_DECODE_TIME;
 
 extern LLTrace::EventStatHandle<F64Seconds >	AVATAR_EDIT_TIME,
 																TOOLBOX_TIME,
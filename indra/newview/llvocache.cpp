@@ -100,80 +100,42 @@ LLVOCacheEntry::LLVOCacheEntry()
 	mDP.assignBuffer(mBuffer, 0);
 }
 
-LLVOCacheEntry::LLVOCacheEntry(LLAPRFile* apr_file)
+LLVOCacheEntry::LLVOCacheEntry(const U8* data, U32 size)
 :	LLViewerOctreeEntryData(LLViewerOctreeEntry::LLVOCACHEENTRY),
 	LLTrace::MemTrackable<LLVOCacheEntry, 16>("LLVOCacheEntry"), 
+	mLocalID(0),
 	mParentID(0),
+	mCRC(0),
 	mUpdateFlags(-1),
+	mHitCount(0),
+	mDupeCount(0),
+	mCRCChangeCount(0),
 	mBuffer(nullptr),
 	mSceneContrib(0.f),
 	mState(INACTIVE),
 	mValid(FALSE),
 	mBSphereRadius(-1.0f)
 {
-	S32 size = -1;
-	BOOL success;
-
 	mDP.assignBuffer(mBuffer, 0);
-	
-	success = check_read(apr_file, &mLocalID, sizeof(U32));
-	if(success)
-	{
-		success = check_read(apr_file, &mCRC, sizeof(U32));
-	}
-	if(success)
-	{
-		success = check_read(apr_file, &mHitCount, sizeof(S32));
-	}
-	if(success)
-	{
-		success = check_read(apr_file, &mDupeCount, sizeof(S32));
-	}
-	if(success)
-	{
-		success = check_read(apr_file, &mCRCChangeCount, sizeof(S32));
-	}
-	if(success)
-	{
-		success = check_read(apr_file, &size, sizeof(S32));
 
-		// Corruption in the cache entries
-		if ((size > 10000) || (size < 1))
-		{
-			// We've got a bogus size, skip reading it.
-			// We won't bother seeking, because the rest of this file
-			// is likely bogus, and will be tossed anyway.
-			LL_WARNS() << "Bogus cache entry, size " << size << ", aborting!" << LL_ENDL;
-			success = FALSE;
-		}
-	}
-	if(success && size > 0)
+	// Corruption in the cache entries
+	U32 record_size = LLVOCacheFile::getRecordSize(data, size);
+	if (!record_size)
 	{
-		mBuffer = new U8[size];
-		success = check_read(apr_file, mBuffer, size);
-
-		if(success)
-		{
-			mDP.assignBuffer(mBuffer, size);
-		}
-		else
-		{
-			delete[] mBuffer ;
-			mBuffer = nullptr ;
-		}
+		LL_WARNS() << "Bogus cache entry, aborting!" << LL_ENDL;
+		return;
 	}
 
-	if(!success)
-	{
-		mLocalID = 0;
-		mCRC = 0;
-		mHitCount = 0;
-		mDupeCount = 0;
-		mCRCChangeCount = 0;
-		mBuffer = nullptr;
-		mEntry = nullptr;
-		mState = INACTIVE;
-	}
+	S32 buffer_size = record_size - LLVOCacheFile::RECORD_HEADER_SIZE;
+	memcpy(&mLocalID, data, sizeof(U32));
+	memcpy(&mCRC, data + 4, sizeof(U32));
+	memcpy(&mHitCount, data + 8, sizeof(S32));
+	memcpy(&mDupeCount, data + 12, sizeof(S32));
+	memcpy(&mCRCChangeCount, data + 16, sizeof(S32));
+
+	mBuffer = new U8[buffer_size];
+	memcpy(mBuffer, data + LLVOCacheFile::RECORD_HEADER_SIZE, buffer_size);
+	mDP.assignBuffer(mBuffer, buffer_size);
 }
 
 LLVOCacheEntry::~LLVOCacheEntry()
@@ -347,38 +309,23 @@ void LLVOCacheEntry::dump() const
 		<< LL_ENDL;
 }
 
-BOOL LLVOCacheEntry::writeToFile(LLAPRFile* apr_file) const
+void LLVOCacheEntry::writeToBuffer(std::vector<U8>& buffer) const
 {
-	BOOL success;
-	success = check_write(apr_file, (void*)&mLocalID, sizeof(U32));
-	if(success)
-	{
-		success = check_write(apr_file, (void*)&mCRC, sizeof(U32));
-	}
-	if(success)
-	{
-		success = check_write(apr_file, (void*)&mHitCount, sizeof(S32));
-	}
-	if(success)
-	{
-		success = check_write(apr_file, (void*)&mDupeCount, sizeof(S32));
-	}
-	if(success)
-	{
-		success = check_write(apr_file, (void*)&mCRCChangeCount, sizeof(S32));
-	}
-	if(success)
+	S32 size = mDP.getBufferSize();
+	size_t offset = buffer.size();
+	buffer.resize(offset + LLVOCacheFile::RECORD_HEADER_SIZE + size);
+
+	U8* data = &buffer[offset];
+	memcpy(data, &mLocalID, sizeof(U32));
+	memcpy(data + 4, &mCRC, sizeof(U32));
+	memcpy(data + 8, &mHitCount, sizeof(S32));
+	memcpy(data + 12, &mDupeCount, sizeof(S32));
+	memcpy(data + 16, &mCRCChangeCount, sizeof(S32));
+	memcpy(data + 20, &size, sizeof(S32));
+	if (size > 0)
 	{
-		S32 size = mDP.getBufferSize();
-		success = check_write(apr_file, (void*)&size, sizeof(S32));
-	
-		if(success)
-		{
-			success = check_write(apr_file, (void*)mBuffer, size);
-		}
+		memcpy(data + LLVOCacheFile::RECORD_HEADER_SIZE, mBuffer, size);
 	}
-
-	return success ;
 }
 
 //static 
@@ -1054,7 +1001,8 @@ LLVOCache::LLVOCache():
 	mInitialized(false),
 	mReadOnly(true),
 	mCacheSize(1),
-	mNumEntries(0)
+	mNumEntries(0),
+	mIOThread(nullptr)
 {
 	mEnabled = gSavedSettings.getBOOL("ObjectCacheEnabled");
 	mLocalAPRFilePoolp = new LLVolatileAPRPool() ;
@@ -1062,6 +1010,17 @@ LLVOCache::LLVOCache():
 
 LLVOCache::~LLVOCache()
 {
+	if(mIOThread)
+	{
+		// Let queued writes land before the thread goes away
+		waitForIO();
+		mIOThread->shutdown();
+		delete mIOThread;
+		mIOThread = nullptr;
+	}
+	std::for_each(mIOQueue.begin(), mIOQueue.end(), DeletePointer());
+	mIOQueue.clear();
+
 	if(mEnabled)
 	{
 		writeCacheHeader();
@@ -1100,6 +1059,12 @@ void LLVOCache::initCache(ELLPath location, U32 size, U32 cache_version)
 	mMetaInfo.mVersion = cache_version;
 	readCacheHeader();	
 
+	if(!mIOThread)
+	{
+		mIOThread = new IOThread(this);
+		mIOThread->start();
+	}
+
 	if(mMetaInfo.mVersion != cache_version) 
 	{
 		mMetaInfo.mVersion = cache_version ;
@@ -1130,6 +1095,8 @@ void LLVOCache::removeCache(ELLPath location, bool started)
 
 	LL_INFOS() << "about to remove the object cache due to settings." << LL_ENDL ;
 
+	waitForIO();
+
 	std::string mask = "*";
 	std::string cache_dir = gDirUtilp->getExpandedFilename(location, object_cache_dirname);
 	LL_INFOS() << "Removing cache at " << cache_dir << LL_ENDL;
@@ -1154,6 +1121,8 @@ void LLVOCache::removeCache()
 		return ;
 	}
 
+	waitForIO();
+
 	std::string mask = "*";
 	LL_INFOS() << "Removing object cache at " << mObjectCacheDirName << LL_ENDL;
 	gDirUtilp->deleteFilesInDir(mObjectCacheDirName, mask); 
@@ -1233,6 +1202,7 @@ void LLVOCache::removeFromCache(HeaderEntryInfo* entry)
 
 	std::string filename;
 	getObjectCacheFilename(entry->mHandle, filename);
+	waitForIO(filename);
 	LLAPRFile::remove(filename, mLocalAPRFilePoolp);
 	entry->mTime = INVALID_TIME ;
 	updateEntry(entry) ; //update the head file.
@@ -1381,12 +1351,12 @@ BOOL LLVOCache::updateEntry(const HeaderEntryInfo* entry)
 	return check_write(&apr_file, (void*)entry, sizeof(HeaderEntryInfo)) ;
 }
 
-void LLVOCache::readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map) 
+LLPointer<LLVOCacheFile> LLVOCache::readFromCache(U64 handle, const LLUUID& id) 
 {
 	if(!mEnabled)
 	{
 		LL_WARNS() << "Not reading cache for handle " << handle << "): Cache is currently disabled." << LL_ENDL;
-		return ;
+		return nullptr;
 	}
 	llassert_always(mInitialized);
 
@@ -1394,58 +1364,27 @@ void LLVOCache::readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::voca
 	if(iter == mHandleEntryMap.end()) //no cache
 	{
 		LL_WARNS() << "No handle map entry for " << handle << LL_ENDL;
-		return ;
+		return nullptr;
 	}
 
-	bool success = true ;
-	{
-		std::string filename;
-		getObjectCacheFilename(handle, filename);
-		LLAPRFile apr_file(filename, APR_READ|APR_BINARY, mLocalAPRFilePoolp);
-	
-		LLUUID cache_id ;
-		success = check_read(&apr_file, cache_id.mData, UUID_BYTES) ;
-	
-		if(success)
-		{		
-			if(cache_id != id)
-			{
-				LL_INFOS() << "Cache ID doesn't match for this region, discarding"<< LL_ENDL;
-				success = false ;
-			}
+	std::string filename;
+	getObjectCacheFilename(handle, filename);
+	// The region may be coming back before its last save has landed
+	waitForIO(filename);
 
-			if(success)
-			{
-				S32 num_entries;
-				success = check_read(&apr_file, &num_entries, sizeof(S32)) ;
-	
-				if(success)
-				{
-					for (S32 i = 0; i < num_entries && apr_file.eof() != APR_EOF; i++)
-					{
-						LLPointer<LLVOCacheEntry> entry = new LLVOCacheEntry(&apr_file);
-						if (!entry->getLocalID())
-						{
-							LL_WARNS() << "Aborting cache file load for " << filename << ", cache file corruption!" << LL_ENDL;
-							success = false ;
-							break ;
-						}
-						cache_entry_map[entry->getLocalID()] = entry;
-					}
-				}
-			}
-		}		
-	}
-	
-	if(!success)
+	LLPointer<LLVOCacheFile> cache_file = new LLVOCacheFile();
+	if(!cache_file->open(filename, id))
 	{
-		if(cache_entry_map.empty())
-		{
-			removeEntry(iter->second) ;
-		}
+		removeEntry(iter->second) ;
+		return nullptr;
 	}
 
-	return ;
+	// Pull the file in on the I/O thread while the region loads its entries
+	IOJob* job = new IOJob();
+	job->mPrefetchFile = cache_file;
+	addIOJob(job);
+
+	return cache_file;
 }
 	
 void LLVOCache::purgeEntries(U32 size)
@@ -1462,7 +1401,7 @@ void LLVOCache::purgeEntries(U32 size)
 	mNumEntries = mHandleEntryMap.size() ;
 }
 
-void LLVOCache::writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, BOOL dirty_cache, bool removal_enabled) 
+void LLVOCache::writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, LLPointer<LLVOCacheFile>& cache_file, BOOL dirty_cache, bool removal_enabled) 
 {
 	if(!mEnabled)
 	{
@@ -1518,39 +1457,248 @@ void LLVOCache::writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry:
 		return ; //nothing changed, no need to update.
 	}
 
-	//write to cache file
-	bool success = true ;
+	//serialize here, write to cache file on the I/O thread
+	std::vector<U8> records;
+	std::vector<LLVOCacheFile::IndexEntry> index;
+	for (LLVOCacheEntry::vocache_entry_map_t::const_iterator iter = cache_entry_map.begin(); iter != cache_entry_map.end(); ++iter)
 	{
-		std::string filename;
-		getObjectCacheFilename(handle, filename);
-		LLAPRFile apr_file(filename, APR_CREATE|APR_WRITE|APR_BINARY, mLocalAPRFilePoolp);
-	
-		success = check_write(&apr_file, (void*)id.mData, UUID_BYTES) ;
+		if(!removal_enabled || iter->second->isValid())
+		{
+			LLVOCacheFile::IndexEntry index_entry;
+			index_entry.mLocalID = iter->first;
+			index_entry.mOffset = (U32)records.size();
+			index.push_back(index_entry);
+			iter->second->writeToBuffer(records);
+		}
+	}
+	if(cache_file.notNull())
+	{
+		if(!removal_enabled)
+		{
+			// Entries the region never asked for were never validated either,
+			// so they only survive when invalid entries are kept.
+			cache_file->copyUntakenRecords(records, index);
+		}
+		// Its prefetch holds the only other reference, so once that is
+		// gone this unmaps the file before it gets replaced.
+		cancelPrefetch(cache_file);
+		llassert(cache_file->getNumRefs() == 1);
+		cache_file = nullptr;
+	}
 
-	
-		if(success)
+	IOJob* job = new IOJob();
+	getObjectCacheFilename(handle, job->mFilename);
+	LLVOCacheFile::buildFile(id, index, records, job->mData);
+	addIOJob(job);
+
+	return ;
+}
+
+void LLVOCache::addIOJob(IOJob* job)
+{
+	if(!mIOThread)
+	{
+		doIOJob(job);
+		delete job;
+		return;
+	}
+
+	{
+		LLMutexLock lock(&mIOCondition);
+		mIOQueue.push_back(job);
+	}
+	mIOThread->wake();
+}
+
+// Finds the oldest queued job for filename, or for any file if it is
+// empty, skipping files that are being written already so that writes to
+// one file land in order.  mIOCondition must be locked.
+std::deque<LLVOCache::IOJob*>::iterator LLVOCache::findIOJob(const std::string& filename)
+{
+	std::deque<IOJob*>::iterator iter = mIOQueue.begin();
+	for(; iter != mIOQueue.end(); ++iter)
+	{
+		const std::string& job_filename = (*iter)->mFilename;
+		if((filename.empty() || job_filename == filename)
+		   && (job_filename.empty() || !isRunningIO(job_filename)))
 		{
-			S32 num_entries = cache_entry_map.size() ;
-			success = check_write(&apr_file, &num_entries, sizeof(S32));
-	
-			for (LLVOCacheEntry::vocache_entry_map_t::const_iterator iter = cache_entry_map.begin(); success && iter != cache_entry_map.end(); ++iter)
-			{
-				if(!removal_enabled || iter->second->isValid())
-				{
-					success = iter->second->writeToFile(&apr_file) ;
-					if(!success)
-					{
-						break;
-					}
-				}
-			}
+			break;
 		}
 	}
+	return iter;
+}
 
-	if(!success)
+// mIOCondition must be locked
+bool LLVOCache::isRunningIO(const std::string& filename) const
+{
+	for(const IOJob* job : mRunningIOJobs)
 	{
-		removeEntry(entry) ;
+		if(filename.empty() || job->mFilename == filename)
+		{
+			return true;
+		}
 	}
+	return false;
+}
 
-	return ;
+// mIOCondition must be locked
+LLVOCache::IOJob* LLVOCache::startIOJob(std::deque<IOJob*>::iterator iter)
+{
+	IOJob* job = *iter;
+	mIOQueue.erase(iter);
+	mRunningIOJobs.push_back(job);
+	return job;
+}
+
+LLVOCache::IOJob* LLVOCache::claimIOJob()
+{
+	LLMutexLock lock(&mIOCondition);
+	std::deque<IOJob*>::iterator iter = findIOJob(LLStringUtil::null);
+	return (iter != mIOQueue.end()) ? startIOJob(iter) : nullptr;
+}
+
+void LLVOCache::finishIOJob(IOJob* job)
+{
+	LLMutexLock lock(&mIOCondition);
+	mRunningIOJobs.erase(std::find(mRunningIOJobs.begin(), mRunningIOJobs.end(), job));
+	delete job;
+	mIOCondition.broadcast();
+}
+
+bool LLVOCache::hasPendingIO()
+{
+	LLMutexLock lock(&mIOCondition);
+	return findIOJob(LLStringUtil::null) != mIOQueue.end();
+}
+
+// MAIN THREAD
+void LLVOCache::waitForIO(const std::string& filename)
+{
+	if(!mIOThread)
+	{
+		return;
+	}
+
+	// Queued jobs are run right here instead of being waited for, so this
+	// only ever waits on jobs the I/O thread is already running.
+	mIOCondition.lock();
+	while(true)
+	{
+		std::deque<IOJob*>::iterator iter = findIOJob(filename);
+		if(iter != mIOQueue.end())
+		{
+			IOJob* job = startIOJob(iter);
+			mIOCondition.unlock();
+			doIOJob(job);
+			finishIOJob(job);
+			mIOCondition.lock();
+		}
+		else if(isRunningIO(filename))
+		{
+			mIOCondition.wait();
+		}
+		else
+		{
+			break;
+		}
+	}
+	mIOCondition.unlock();
+
+	// Jobs for other files may have been held back behind ours
+	if(hasPendingIO())
+	{
+		mIOThread->wake();
+	}
+}
+
+// MAIN THREAD
+void LLVOCache::cancelPrefetch(const LLVOCacheFile* cache_file)
+{
+	if(!mIOThread)
+	{
+		return;
+	}
+
+	LLMutexLock lock(&mIOCondition);
+	for(std::deque<IOJob*>::iterator iter = mIOQueue.begin(); iter != mIOQueue.end(); )
+	{
+		if((*iter)->mPrefetchFile.get() == cache_file)
+		{
+			delete *iter;
+			iter = mIOQueue.erase(iter);
+		}
+		else
+		{
+			++iter;
+		}
+	}
+
+	while(true)
+	{
+		bool running = false;
+		for(const IOJob* job : mRunningIOJobs)
+		{
+			running = running || job->mPrefetchFile.get() == cache_file;
+		}
+		if(!running)
+		{
+			break;
+		}
+		mIOCondition.wait();
+	}
+}
+
+// Runs on the I/O thread, or on the main thread from waitForIO(), and
+// touches nothing but the job.
+void LLVOCache::doIOJob(IOJob* job)
+{
+	if(job->mPrefetchFile.notNull())
+	{
+		job->mPrefetchFile->prefetch();
+		return;
+	}
+
+	if(!LLVOCacheFile::writeFile(job->mFilename, job->mData))
+	{
+		// A missing file fails the next readFromCache(), which drops the entry
+		LL_WARNS() << "Failed to write object cache file " << job->mFilename << LL_ENDL;
+		LLFile::remove(job->mFilename, ENOENT);
+	}
+}
+
+//-------------------------------------------------------------------
+
+LLVOCache::IOThread::IOThread(LLVOCache* cache)
+:	LLThread("VOCache I/O"),
+	mCache(cache)
+{
+}
+
+// virtual
+bool LLVOCache::IOThread::runCondition()
+{
+	// mDataLock is locked here; the cache has its own lock
+	return mCache->hasPendingIO();
+}
+
+// virtual
+void LLVOCache::IOThread::run()
+{
+	while (true)
+	{
+		// Sleeps until addIOJob() wakes us with work
+		checkPause();
+
+		if (isQuitting())
+		{
+			break;
+		}
+
+		while (IOJob* job = mCache->claimIOJob())
+		{
+			mCache->doIOJob(job);
+			mCache->finishIOJob(job);
+		}
+	}
+	LL_INFOS() << "Object cache I/O thread EXITING." << LL_ENDL;
 }
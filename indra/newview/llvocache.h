@@ -27,11 +27,15 @@
 #ifndef LL_LLVOCACHE_H
 #define LL_LLVOCACHE_H
 
+#include <deque>
+
 #include "lluuid.h"
 #include "lldatapacker.h"
 #include "lldir.h"
 #include "llvieweroctree.h"
 #include "llapr.h"
+#include "llthread.h"
+#include "llvocachefile.h"
 
 //---------------------------------------------------------------------------
 // Cache entries
@@ -83,7 +87,7 @@ protected:
 	~LLVOCacheEntry();
 public:
 	LLVOCacheEntry(U32 local_id, U32 crc, LLDataPackerBinaryBuffer &dp);
-	LLVOCacheEntry(LLAPRFile* apr_file);
+	LLVOCacheEntry(const U8* data, U32 size);
 	LLVOCacheEntry();	
 
 	void updateEntry(U32 crc, LLDataPackerBinaryBuffer &dp);
@@ -106,7 +110,7 @@ public:
 	F32 getSceneContribution() const             { return mSceneContrib;}
 
 	void dump() const;
-	BOOL writeToFile(LLAPRFile* apr_file) const;
+	void writeToBuffer(std::vector<U8>& buffer) const;
 	LLDataPackerBinaryBuffer *getDP();
 	void recordHit();
 	void recordDupe() { mDupeCount++; }
@@ -219,7 +223,8 @@ private:
 };
 
 //
-//Note: LLVOCache is not thread-safe
+//Note: LLVOCache is not thread-safe.  Cache files are written, and
+//prefetched, by its I/O thread, everything else happens on the main thread.
 //
 class LLVOCache : public LLSingleton<LLVOCache>
 {
@@ -261,8 +266,13 @@ public:
 	void initCache(ELLPath location, U32 size, U32 cache_version) ;
 	void removeCache(ELLPath location, bool started = false) ;
 
-	void readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map) ;
-	void writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, BOOL dirty_cache, bool removal_enabled);
+	// Returns the region's mapped cache file, or NULL if there is none.
+	// Entries are read out of it lazily, see LLVOCacheFile::takeRecord().
+	LLPointer<LLVOCacheFile> readFromCache(U64 handle, const LLUUID& id) ;
+	// Writes the entries of cache_entry_map, plus the entries of cache_file
+	// that were never loaded, back in the background.  If the file gets
+	// written, cache_file is released first so nothing still maps it.
+	void writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, LLPointer<LLVOCacheFile>& cache_file, BOOL dirty_cache, bool removal_enabled);
 	void removeEntry(U64 handle) ;
 
 	void setReadOnly(bool read_only) {mReadOnly = read_only;} 
@@ -279,6 +289,42 @@ private:
 	void removeEntry(HeaderEntryInfo* entry) ;
 	void purgeEntries(U32 size);
 	BOOL updateEntry(const HeaderEntryInfo* entry);
+
+	// Work for the I/O thread: prefetch a mapped file, or replace a cache
+	// file with mData.  The main thread runs queued jobs itself when it
+	// has to wait for them.
+	struct IOJob
+	{
+		LLPointer<LLVOCacheFile> mPrefetchFile;
+		std::string mFilename;
+		std::vector<U8> mData;
+	};
+
+	class IOThread : public LLThread
+	{
+	public:
+		IOThread(LLVOCache* cache);
+
+	private:
+		bool runCondition() override;
+		void run() override;
+
+		LLVOCache* mCache;
+	};
+
+	void addIOJob(IOJob* job);
+	std::deque<IOJob*>::iterator findIOJob(const std::string& filename);
+	bool isRunningIO(const std::string& filename) const;
+	IOJob* startIOJob(std::deque<IOJob*>::iterator iter);
+	IOJob* claimIOJob();
+	void doIOJob(IOJob* job);
+	void finishIOJob(IOJob* job);
+	bool hasPendingIO();
+	// Returns once the writes to filename, or all jobs if filename is
+	// empty, are done.  Runs whatever is still queued on the calling thread.
+	void waitForIO(const std::string& filename = LLStringUtil::null);
+	// Drops the prefetch of cache_file and its reference to it.
+	void cancelPrefetch(const LLVOCacheFile* cache_file);
 	
 private:
 	bool                 mEnabled;
@@ -292,6 +338,12 @@ private:
 	LLVolatileAPRPool*   mLocalAPRFilePoolp ; 	
 	header_entry_queue_t mHeaderEntryQueue;
 	handle_entry_map_t   mHandleEntryMap;	
+
+	IOThread*            mIOThread;
+	// Guards mIOQueue and mRunningIOJobs
+	LLCondition          mIOCondition;
+	std::deque<IOJob*>   mIOQueue;
+	std::vector<IOJob*>  mRunningIOJobs;
 };
 
 #endif
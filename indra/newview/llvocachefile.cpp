@@ -0,0 +1,217 @@
+/**
+ * @file llvocachefile.cpp
+ * @brief On-disk format of one region's object cache.
+ *
+ * $LicenseInfo:firstyear=2003&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+#include "llvocachefile.h"
+
+#include <algorithm>
+
+#include "llerror.h"
+#include "llfile.h"
+
+// cache id and number of entries
+const U32 CACHE_FILE_HEADER_SIZE = UUID_BYTES + sizeof(S32);
+const U32 CACHE_FILE_PAGE_SIZE = 4096;
+
+LLVOCacheFile::LLVOCacheFile()
+:	mIndex(nullptr),
+	mNumEntries(0)
+{
+}
+
+LLVOCacheFile::~LLVOCacheFile()
+{
+	mFile.unmap();
+}
+
+bool LLVOCacheFile::open(const std::string& filename, const LLUUID& id)
+{
+	LLFILE* fp = LLFile::fopen(filename, "rb");
+	if (!fp)
+	{
+		return false;
+	}
+	fseek(fp, 0, SEEK_END);
+	long size = ftell(fp);
+	bool success = size >= (long)CACHE_FILE_HEADER_SIZE && mFile.map(fp, (U32)size, true, filename);
+	// The mapping keeps the file open
+	fclose(fp);
+
+	if (!success)
+	{
+		return false;
+	}
+
+	const U8* data = mFile.getData();
+	LLUUID cache_id;
+	memcpy(cache_id.mData, data, UUID_BYTES);
+	if (cache_id != id)
+	{
+		LL_INFOS() << "Cache ID doesn't match for this region, discarding" << LL_ENDL;
+		mFile.unmap();
+		return false;
+	}
+
+	S32 num_entries;
+	memcpy(&num_entries, data + UUID_BYTES, sizeof(S32));
+	if (num_entries < 0 || (U64)num_entries * sizeof(IndexEntry) > mFile.getSize() - CACHE_FILE_HEADER_SIZE)
+	{
+		LL_WARNS() << "Aborting cache file load for " << filename << ", cache file corruption!" << LL_ENDL;
+		mFile.unmap();
+		return false;
+	}
+
+	mIndex = (const IndexEntry*)(data + CACHE_FILE_HEADER_SIZE);
+	mNumEntries = num_entries;
+	mTaken.assign(num_entries, false);
+	return true;
+}
+
+bool LLVOCacheFile::takeRecord(U32 local_id, const U8*& data, U32& size)
+{
+	IndexEntry key;
+	key.mLocalID = local_id;
+	const IndexEntry* end = mIndex + mNumEntries;
+	const IndexEntry* iter = std::lower_bound(mIndex, end, key);
+	if (iter == end || iter->mLocalID != local_id)
+	{
+		return false;
+	}
+
+	size_t i = iter - mIndex;
+	if (mTaken[i])
+	{
+		return false;
+	}
+	mTaken[i] = true;
+
+	U32 record_size = 0;
+	if (iter->mOffset <= mFile.getSize())
+	{
+		record_size = getRecordSize(mFile.getData() + iter->mOffset, mFile.getSize() - iter->mOffset);
+	}
+	if (!record_size || memcmp(mFile.getData() + iter->mOffset, &local_id, sizeof(U32)))
+	{
+		LL_WARNS() << "Bogus record for cache entry " << local_id << LL_ENDL;
+		return false;
+	}
+
+	data = mFile.getData() + iter->mOffset;
+	size = record_size;
+	return true;
+}
+
+void LLVOCacheFile::copyUntakenRecords(std::vector<U8>& records, std::vector<IndexEntry>& index) const
+{
+	for (S32 i = 0; i < mNumEntries; ++i)
+	{
+		if (mTaken[i] || mIndex[i].mOffset > mFile.getSize())
+		{
+			continue;
+		}
+
+		const U8* data = mFile.getData() + mIndex[i].mOffset;
+		U32 record_size = getRecordSize(data, mFile.getSize() - mIndex[i].mOffset);
+		if (record_size && !memcmp(data, &mIndex[i].mLocalID, sizeof(U32)))
+		{
+			IndexEntry index_entry;
+			index_entry.mLocalID = mIndex[i].mLocalID;
+			index_entry.mOffset = (U32)records.size();
+			index.push_back(index_entry);
+			records.insert(records.end(), data, data + record_size);
+		}
+	}
+}
+
+void LLVOCacheFile::prefetch() const
+{
+	const volatile U8* data = mFile.getData();
+	U8 sum = 0;
+	for (U32 offset = 0; offset < mFile.getSize(); offset += CACHE_FILE_PAGE_SIZE)
+	{
+		sum += data[offset];
+	}
+	(void)sum;
+}
+
+//static
+U32 LLVOCacheFile::getRecordSize(const U8* data, U32 size)
+{
+	if (size < RECORD_HEADER_SIZE)
+	{
+		return 0;
+	}
+
+	S32 data_size;
+	memcpy(&data_size, data + RECORD_HEADER_SIZE - sizeof(S32), sizeof(S32));
+	if (data_size < 1 || data_size > MAX_RECORD_DATA_SIZE || (U32)data_size > size - RECORD_HEADER_SIZE)
+	{
+		return 0;
+	}
+	return RECORD_HEADER_SIZE + data_size;
+}
+
+//static
+void LLVOCacheFile::buildFile(const LLUUID& id, std::vector<IndexEntry>& index, const std::vector<U8>& records, std::vector<U8>& data)
+{
+	std::sort(index.begin(), index.end());
+
+	S32 num_entries = (S32)index.size();
+	U32 records_offset = CACHE_FILE_HEADER_SIZE + num_entries * sizeof(IndexEntry);
+	for (IndexEntry& entry : index)
+	{
+		entry.mOffset += records_offset;
+	}
+
+	data.resize(records_offset + records.size());
+	memcpy(&data[0], id.mData, UUID_BYTES);
+	memcpy(&data[UUID_BYTES], &num_entries, sizeof(S32));
+	if (num_entries > 0)
+	{
+		memcpy(&data[CACHE_FILE_HEADER_SIZE], &index[0], num_entries * sizeof(IndexEntry));
+		memcpy(&data[records_offset], &records[0], records.size());
+	}
+}
+
+//static
+bool LLVOCacheFile::writeFile(const std::string& filename, const std::vector<U8>& data)
+{
+	std::string temp_filename = filename + ".tmp";
+	LLFILE* fp = LLFile::fopen(temp_filename, "wb");
+	bool success = fp != nullptr;
+	if (success)
+	{
+		success = fwrite(&data[0], 1, data.size(), fp) == data.size()
+			&& LLMappedFile::sync(fp);
+		success = (fclose(fp) == 0) && success;
+	}
+	success = success && LLFile::replace(temp_filename, filename) == 0;
+	if (!success)
+	{
+		LLFile::remove(temp_filename, ENOENT);
+	}
+	return success;
+}
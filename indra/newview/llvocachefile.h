@@ -0,0 +1,104 @@
+/**
+ * @file llvocachefile.h
+ * @brief On-disk format of one region's object cache.
+ *
+ * $LicenseInfo:firstyear=2003&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLVOCACHEFILE_H
+#define LL_LLVOCACHEFILE_H
+
+#include <vector>
+
+#include "llmappedfile.h"
+#include "llrefcount.h"
+#include "lluuid.h"
+
+//
+// One region's object cache file, mapped read-only.  The file holds the
+// region's cache ID, an index of (local id, offset) pairs sorted by local
+// id, and then the records themselves, so single records can be found and
+// read without going through the rest of the file.
+//
+// A record is the header fields of an LLVOCacheEntry followed by its object
+// update data, as written by LLVOCacheEntry::writeToBuffer().
+//
+class LLVOCacheFile : public LLThreadSafeRefCount
+{
+public:
+	struct IndexEntry
+	{
+		U32 mLocalID;
+		U32 mOffset;
+
+		bool operator<(const IndexEntry& rhs) const { return mLocalID < rhs.mLocalID; }
+	};
+
+	// local id, crc, hit count, dupe count, crc change count and data size
+	static const U32 RECORD_HEADER_SIZE = 6 * sizeof(U32);
+	// Anything bigger is taken for corruption
+	static const S32 MAX_RECORD_DATA_SIZE = 10000;
+
+	LLVOCacheFile();
+
+	// Maps the file, FALSE if it is missing, corrupt or belongs to another region.
+	bool open(const std::string& filename, const LLUUID& id);
+
+	S32 getNumEntries() const { return mNumEntries; }
+
+	// Finds the record for local_id.  Each record is handed out at most
+	// once; later calls for the same id return false, as do calls for ids
+	// that are not in the file or whose record is damaged.  data stays
+	// valid for as long as the file is referenced.
+	bool takeRecord(U32 local_id, const U8*& data, U32& size);
+
+	// Appends the records that were never handed out by takeRecord() to
+	// records, byte for byte, and their offsets into records to index.
+	void copyUntakenRecords(std::vector<U8>& records, std::vector<IndexEntry>& index) const;
+
+	// Touches every page of the file so later loads don't block on the disk.
+	// Safe to call from any thread.
+	void prefetch() const;
+
+	// Size of the record at data, or 0 if its header is damaged or it runs
+	// past size.
+	static U32 getRecordSize(const U8* data, U32 size);
+
+	// Builds a file image from records and the index into them.  Sorts index.
+	static void buildFile(const LLUUID& id, std::vector<IndexEntry>& index, const std::vector<U8>& records, std::vector<U8>& data);
+
+	// Replaces filename with data through a synced temporary file, so a
+	// crash leaves either the old file or the new one.  Safe to call from
+	// any thread.
+	static bool writeFile(const std::string& filename, const std::vector<U8>& data);
+
+protected:
+	~LLVOCacheFile();
+
+private:
+	LLMappedFile      mFile;
+	const IndexEntry* mIndex;
+	S32               mNumEntries;
+	std::vector<bool> mTaken;
+};
+
+#endif
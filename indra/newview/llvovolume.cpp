@@ -53,6 +53,7 @@
 #include "lldrawpoolavatar.h"
 #include "lldrawpoolbump.h"
 #include "llface.h"
+#include "llfacegeometryjobs.h"
 #include "llspatialpartition.h"
 #include "llhudmanager.h"
 #include "llflexibleobject.h"
@@ -98,6 +99,10 @@ S32 LLVOVolume::mRenderComplexity_current = 0;
 LLPointer<LLObjectMediaDataClient> LLVOVolume::sObjectMediaClient = NULL;
 LLPointer<LLObjectMediaNavigateClient> LLVOVolume::sObjectMediaNavigateClient = NULL;
 
+// Objects waiting on a LOD from the volume manager's build threads
+typedef std::map<LLVolumeParams, std::set<LLUUID> > volume_build_map_t;
+static volume_build_map_t sVolumeBuildWaiters[LLVolumeLODGroup::NUM_LODS];
+
 static LLTrace::BlockTimerStatHandle FTM_GEN_TRIANGLES("Generate Triangles");
 static LLTrace::BlockTimerStatHandle FTM_GEN_VOLUME("Generate Volumes");
 static LLTrace::BlockTimerStatHandle FTM_VOLUME_TEXTURES("Volume Textures");
@@ -298,6 +303,11 @@ void LLVOVolume::cleanupClass()
 {
     sObjectMediaClient = NULL;
     sObjectMediaNavigateClient = NULL;
+
+	for (S32 i = 0; i < LLVolumeLODGroup::NUM_LODS; ++i)
+	{
+		sVolumeBuildWaiters[i].clear();
+	}
 }
 
 U32 LLVOVolume::processUpdateMessage(LLMessageSystem *mesgsys,
@@ -1010,6 +1020,14 @@ BOOL LLVOVolume::setVolume(const LLVolumeParams &params_in, const S32 detail, bo
 
 	}
 
+	if (mVolumep.notNull() && lod != last_lod && !mVolumeImpl && !isSculpted()
+		&& volume_params == mVolumep->getParams()
+		&& !LLPrimitive::getVolumeManager()->requestVolume(volume_params, lod))
+	{ //plain prim changing LOD, keep drawing the current one until the new one is built
+		sVolumeBuildWaiters[lod][volume_params].insert(getID());
+		return FALSE;
+	}
+
 	if ((LLPrimitive::setVolume(volume_params, lod, (mVolumeImpl && mVolumeImpl->isVolumeUnique()))) || mSculptChanged)
 	{
 		mFaceMappingChanged = TRUE;
@@ -1088,6 +1106,33 @@ void LLVOVolume::updateSculptTexture()
 	
 }
 
+// static
+void LLVOVolume::notifyVolumesBuilt()
+{
+	std::vector<std::pair<LLVolumeParams, S32> > built;
+	LLPrimitive::getVolumeManager()->publishBuiltVolumes(built);
+
+	for (const std::pair<LLVolumeParams, S32>& volume : built)
+	{
+		volume_build_map_t::iterator iter = sVolumeBuildWaiters[volume.second].find(volume.first);
+		if (iter == sVolumeBuildWaiters[volume.second].end())
+		{
+			continue;
+		}
+
+		for (const LLUUID& id : iter->second)
+		{
+			LLVOVolume* vobj = (LLVOVolume*) gObjectList.findObject(id);
+			if (vobj && vobj->mDrawable.notNull())
+			{ //setVolume() will find the new LOD built this time
+				vobj->mLODChanged = TRUE;
+				gPipeline.markRebuild(vobj->mDrawable, LLDrawable::REBUILD_VOLUME, FALSE);
+			}
+		}
+		sVolumeBuildWaiters[volume.second].erase(iter);
+	}
+}
+
 void LLVOVolume::notifyMeshLoaded()
 { 
 	mSculptChanged = TRUE;
@@ -4328,6 +4373,8 @@ bool can_batch_texture(const LLFace* facep)
 
 const static U32 MAX_FACE_COUNT = 4096U;
 int32_t LLVolumeGeometryManager::sInstanceCount = 0;
+LLFaceGeometryQueue* LLVolumeGeometryManager::sGeometryQueue = NULL;
+LLFaceGeometryBatch* LLVolumeGeometryManager::sGeometryBatch = NULL;
 LLFace** LLVolumeGeometryManager::sFullbrightFaces = NULL;
 LLFace** LLVolumeGeometryManager::sBumpFaces = NULL;
 LLFace** LLVolumeGeometryManager::sSimpleFaces = NULL;
@@ -4343,6 +4390,8 @@ LLVolumeGeometryManager::LLVolumeGeometryManager()
 	if (sInstanceCount == 0)
 	{
 		allocateFaces(MAX_FACE_COUNT);
+		sGeometryQueue = new LLFaceGeometryQueue(gSavedSettings.getU32("RenderGeometryThreads"));
+		sGeometryBatch = new LLFaceGeometryBatch();
 	}
 
 	++sInstanceCount;
@@ -4356,6 +4405,10 @@ LLVolumeGeometryManager::~LLVolumeGeometryManager()
 	if (sInstanceCount <= 0)
 	{
 		freeFaces();
+		delete sGeometryBatch;
+		sGeometryBatch = NULL;
+		delete sGeometryQueue;
+		sGeometryQueue = NULL;
 		sInstanceCount = 0;
 	}
 }
@@ -4648,6 +4701,7 @@ void LLVolumeGeometryManager::getGeometry(LLSpatialGroup* group)
 static LLTrace::BlockTimerStatHandle FTM_REBUILD_VOLUME_VB("Volume VB");
 static LLTrace::BlockTimerStatHandle FTM_REBUILD_VOLUME_FACE_LIST("Build Face List");
 static LLTrace::BlockTimerStatHandle FTM_REBUILD_VOLUME_GEN_DRAW_INFO("Gen Draw Info");
+static LLTrace::BlockTimerStatHandle FTM_REBUILD_VOLUME_RUN_JOBS("Run Geometry Jobs");
 
 static LLDrawPoolAvatar* get_avatar_drawpool(LLViewerObject* vobj)
 {
@@ -5481,6 +5535,16 @@ void LLVolumeGeometryManager::rebuildGeom(LLSpatialGroup* group)
 	genDrawInfo(group, spec_mask | additional_flags, sSpecFaces, spec_count, FALSE);
 	genDrawInfo(group, normspec_mask | additional_flags, sNormSpecFaces, normspec_count, FALSE);
 
+	{
+		LL_RECORD_BLOCK_TIME(FTM_REBUILD_VOLUME_RUN_JOBS);
+		sGeometryQueue->run(*sGeometryBatch);
+	}
+	for (U32 i = 0; i < mLockedBuffers.size(); ++i)
+	{
+		mLockedBuffers[i]->flush();
+	}
+	mLockedBuffers.clear();
+
 	if (!LLPipeline::sDelayVBUpdate)
 	{
 		//drawables have been rebuilt, clear rebuild status
@@ -5556,7 +5620,7 @@ void LLVolumeGeometryManager::rebuildMesh(LLSpatialGroup* group)
 							llassert(!face->isState(LLFace::RIGGED));
 
 							if (!face->getGeometryVolume(*volume, face->getTEOffset(), 
-								vobj->getRelativeXform(), vobj->getRelativeXformInvTrans(), face->getGeomIndex()))
+								vobj->getRelativeXform(), vobj->getRelativeXformInvTrans(), face->getGeomIndex(), false, sGeometryBatch))
 							{ //something's gone wrong with the vertex buffer accounting, rebuild this group 
 								group->dirtyGeom();
 								gPipeline.markRebuild(group, TRUE);
@@ -5581,6 +5645,11 @@ void LLVolumeGeometryManager::rebuildMesh(LLSpatialGroup* group)
 			}
 		}
 		
+		{
+			LL_RECORD_BLOCK_TIME(FTM_REBUILD_VOLUME_RUN_JOBS);
+			sGeometryQueue->run(*sGeometryBatch);
+		}
+
 		{
 			LL_RECORD_BLOCK_TIME(FTM_REBUILD_MESH_FLUSH);
 			for (LLVertexBuffer** iter = locked_buffer, ** end_iter = locked_buffer+buffer_count; iter != end_iter; ++iter)
@@ -6496,7 +6565,7 @@ void LLVolumeGeometryManager::genDrawInfo(LLSpatialGroup* group, U32 mask, LLFac
 				llassert(!facep->isState(LLFace::RIGGED));
 
 				if (!facep->getGeometryVolume(*volume, te_idx,
-					vobj->getRelativeXform(), vobj->getRelativeXformInvTrans(), index_offset,true))
+					vobj->getRelativeXform(), vobj->getRelativeXformInvTrans(), index_offset,true, sGeometryBatch))
 				{
 					LL_WARNS() << "Failed to get geometry for face!" << LL_ENDL;
 				}
@@ -6513,7 +6582,8 @@ void LLVolumeGeometryManager::genDrawInfo(LLSpatialGroup* group, U32 mask, LLFac
 			++face_iter;
 		}
 
-		buffer->flush();
+		// Geometry jobs may still be writing to it, rebuildGeom() flushes it
+		mLockedBuffers.push_back(buffer);
 	}
 
 	group->mBufferMap[mask].clear();
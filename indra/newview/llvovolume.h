@@ -96,6 +96,8 @@ public:
 	static		void	initClass();
 	static		void	cleanupClass();
 	static		void	preUpdateGeom();
+	// Rebuilds the objects waiting on LODs the volume manager built in the background
+	static		void	notifyVolumesBuilt();
 	
 	enum 
 	{
@@ -297,6 +297,9 @@ void LLWorld::removeRegion(const LLHost &host)
 		LL_WARNS() << "Trying to remove region that doesn't exist!" << LL_ENDL;
 		return;
 	}
+
+	// Let queued cache updates reach the region before it writes its cache
+	gObjectList.flushObjectUpdates();
 	
 	if (regionp == gAgent.getRegion())
 	{
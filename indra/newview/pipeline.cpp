@@ -2861,6 +2861,7 @@ void LLPipeline::rebuildPriorityGroups()
 	assertInitialized();
 
 	gMeshRepo.notifyLoadedMeshes();
+	LLVOVolume::notifyVolumesBuilt();
 
 	mGroupQ1Locked = true;
 	// Iterate through all drawables on the priority build queue,
@@ -0,0 +1,627 @@
+/**
+ * @file llfacegeometryjobs_test.cpp
+ * @brief Tests for LLFaceGeometryJob and LLFaceGeometryQueue.
+ *
+ * $LicenseInfo:firstyear=2001&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+// Precompiled header
+#include "../llviewerprecompiledheaders.h"
+
+#include "../test/lltut.h"
+
+#include "../llfacegeometryjobs.h"
+
+#include "llmatrix4a.h"
+#include "llmemory.h"
+#include "lltimer.h"
+#include "llvector4a.h"
+#include "llvolume.h"
+
+namespace
+{
+	const S32 NUM_FACES = 64;
+	const S32 VERTS_PER_FACE = 37;		// not a multiple of 4 or 8, to hit the tails
+	const S32 INDICES_PER_FACE = 3 * 35;
+	const S32 PADDED_VERTS = 40;		// room for FILL rounding and POSITIONS padding
+	const S32 PADDED_INDICES = 112;
+
+	const LLFaceGeometryJob::ETexGen TEXGENS[] = { LLFaceGeometryJob::TEX_COPY, LLFaceGeometryJob::TEX_XFORM, LLFaceGeometryJob::TEX_PLANAR };
+
+	// Source data for all the faces, like a set of LLVolumeFaces
+	struct Source
+	{
+		Source()
+		{
+			mPositions = (LLVector4a*) ll_aligned_malloc_16(NUM_FACES * VERTS_PER_FACE * sizeof(LLVector4a));
+			mNormals = (LLVector4a*) ll_aligned_malloc_16(NUM_FACES * VERTS_PER_FACE * sizeof(LLVector4a));
+			mWeights = (LLVector4a*) ll_aligned_malloc_16(NUM_FACES * VERTS_PER_FACE * sizeof(LLVector4a));
+			mTexCoords = (LLVector2*) ll_aligned_malloc_16(NUM_FACES * PADDED_VERTS * sizeof(LLVector2));
+			mIndices = (U16*) ll_aligned_malloc_16(NUM_FACES * PADDED_INDICES * sizeof(U16));
+
+			U32 seed = 12345;
+			for (S32 i = 0; i < NUM_FACES * VERTS_PER_FACE; ++i)
+			{
+				mPositions[i].set(next(seed), next(seed), next(seed), 1.f);
+				mNormals[i].set(next(seed), next(seed), next(seed), 0.f);
+				mNormals[i].normalize3fast();
+				mWeights[i].set(next(seed), next(seed), next(seed), next(seed));
+			}
+			for (S32 i = 0; i < NUM_FACES * PADDED_VERTS; ++i)
+			{
+				mTexCoords[i].set(next(seed), next(seed));
+			}
+			for (S32 i = 0; i < NUM_FACES * PADDED_INDICES; ++i)
+			{
+				mIndices[i] = (U16) (i % VERTS_PER_FACE);
+			}
+		}
+
+		~Source()
+		{
+			ll_aligned_free_16(mPositions);
+			ll_aligned_free_16(mNormals);
+			ll_aligned_free_16(mWeights);
+			ll_aligned_free_16(mTexCoords);
+			ll_aligned_free_16(mIndices);
+		}
+
+		static F32 next(U32& seed)
+		{
+			seed = seed * 1103515245 + 12345;
+			return (F32) ((seed >> 8) & 0xffff) / 4096.f - 8.f;
+		}
+
+		LLVector4a* mPositions;
+		LLVector4a* mNormals;
+		LLVector4a* mWeights;
+		LLVector2* mTexCoords;
+		U16* mIndices;
+	};
+
+	// Where each stream of a face goes in Output
+	const size_t POSITIONS_OFFSET = 0;
+	const size_t NORMALS_OFFSET = POSITIONS_OFFSET + PADDED_VERTS * sizeof(LLVector4a);
+	const size_t WEIGHTS_OFFSET = NORMALS_OFFSET + PADDED_VERTS * sizeof(LLVector4a);
+	const size_t COLORS_OFFSET = WEIGHTS_OFFSET + PADDED_VERTS * sizeof(LLVector4a);
+	const size_t EMISSIVE_OFFSET = COLORS_OFFSET + PADDED_VERTS * sizeof(U32);
+	const size_t TEXCOORDS_OFFSET = EMISSIVE_OFFSET + PADDED_VERTS * sizeof(U32);
+	const size_t INDICES_OFFSET = TEXCOORDS_OFFSET + PADDED_VERTS * sizeof(LLVector2);
+	const size_t FACE_SIZE = INDICES_OFFSET + PADDED_INDICES * sizeof(U16);
+
+	// Vertex buffer memory for all the faces
+	struct Output
+	{
+		Output()
+		{
+			mSize = NUM_FACES * FACE_SIZE;
+			mData = (U8*) ll_aligned_malloc_16(mSize);
+			memset(mData, 0xcd, mSize);
+		}
+
+		~Output()
+		{
+			ll_aligned_free_16(mData);
+		}
+
+		U8* face(S32 i) const
+		{
+			return mData + FACE_SIZE * i;
+		}
+
+		U8* mData;
+		size_t mSize;
+	};
+
+	// What getGeometryVolume() passes face i
+	void face_matrices(S32 i, LLMatrix4& mat_vert, LLMatrix3& mat_normal)
+	{
+		mat_vert.initAll(LLVector3(1.f, 2.f, 0.5f), LLQuaternion(0.1f * i, LLVector3(0.f, 0.f, 1.f)), LLVector3((F32) i, 3.f, -2.f));
+		mat_normal = LLMatrix3(LLQuaternion(0.1f * i, LLVector3(0.f, 0.f, 1.f)));
+	}
+
+	U32 fill_value(S32 i, S32 j)
+	{
+		return 0x01020304 * (i + j + 1);
+	}
+
+	// The per vertex texture coordinate code LLFace::getGeometryVolume()
+	// used before TEXCOORDS jobs, as a reference for them
+	void ref_planar(LLVector2& tc, const LLVector4a& normal, const LLVector4a& vec)
+	{
+		LLVector4a binormal;
+		F32 d = normal[0];
+
+		if (d >= 0.5f || d <= -0.5f)
+		{
+			binormal.set(0, d < 0 ? -1.f : 1.f, 0);
+		}
+		else
+		{
+			binormal.set(normal[1] > 0 ? -1.f : 1.f, 0, 0);
+		}
+		LLVector4a tangent;
+		tangent.setCross3(binormal, normal);
+
+		tc.mV[1] = -((tangent.dot3(vec).getF32())*2 - 0.5f);
+		tc.mV[0] = 1.0f+((binormal.dot3(vec).getF32())*2 - 0.5f);
+	}
+
+	void ref_xform(LLVector2& tex_coord, F32 cos_ang, F32 sin_ang, F32 off_s, F32 off_t, F32 mag_s, F32 mag_t)
+	{
+		F32 s = tex_coord.mV[0] - 0.5f;
+		F32 t = tex_coord.mV[1] - 0.5f;
+		F32 temp = s;
+		s = s * cos_ang + t * sin_ang;
+		t = -temp * sin_ang + t * cos_ang;
+		tex_coord.mV[0] = s * mag_s + off_s + 0.5f;
+		tex_coord.mV[1] = t * mag_t + off_t + 0.5f;
+	}
+
+	void ref_texcoords(const LLFaceGeometryJob& job, const LLVector4a* positions, const LLVector4a* normals,
+					   const LLVector2* tex_coords, S32 count, LLVector2* dst)
+	{
+		LLVector4a scalea;
+		scalea.load3(job.mScale.mV);
+		for (S32 i = 0; i < count; ++i)
+		{
+			LLVector2 tc(tex_coords[i]);
+			if (job.mTexGen == LLFaceGeometryJob::TEX_PLANAR)
+			{
+				LLVector4a vec = positions[i];
+				vec.mul(scalea);
+				ref_planar(tc, normals[i], vec);
+			}
+			if (job.mTexGen != LLFaceGeometryJob::TEX_COPY)
+			{
+				ref_xform(tc, job.mTexCos, job.mTexSin, job.mTexOffsetS, job.mTexOffsetT, job.mTexScaleS, job.mTexScaleT);
+			}
+			dst[i] = tc;
+		}
+	}
+
+	void ref_texcoords(const LLFaceGeometryJob& job, const LLVolumeFace& face, LLVector2* dst)
+	{
+		ref_texcoords(job, face.mPositions, face.mNormals, face.mTexCoords, face.mNumVertices, dst);
+	}
+
+	// A synthetic volume face with num_verts random vertices
+	void make_face(LLVolumeFace& face, S32 num_verts, U32 seed)
+	{
+		face.resizeVertices(num_verts);
+		for (S32 i = 0; i < num_verts; ++i)
+		{
+			face.mPositions[i].set(Source::next(seed), Source::next(seed), Source::next(seed), 1.f);
+			face.mNormals[i].set(Source::next(seed), Source::next(seed), Source::next(seed), 0.f);
+			face.mNormals[i].normalize3fast();
+			face.mTexCoords[i].set(Source::next(seed), Source::next(seed));
+		}
+	}
+
+	LLFaceGeometryJob make_texcoord_job(LLFaceGeometryJob::ETexGen texgen, const LLVolumeFace& face, LLVector2* dst)
+	{
+		LLFaceGeometryJob job(LLFaceGeometryJob::TEXCOORDS);
+		job.mCount = face.mNumVertices;
+		job.mSrc = face.mTexCoords;
+		job.mDst = dst;
+		job.mTexGen = texgen;
+		job.mPositions = face.mPositions;
+		job.mNormals = face.mNormals;
+		job.mScale.set(0.5f, 2.f, 3.f);
+		job.mTexCos = cosf(0.3f);
+		job.mTexSin = sinf(0.3f);
+		job.mTexOffsetS = 0.25f;
+		job.mTexOffsetT = -0.125f;
+		job.mTexScaleS = 2.f;
+		job.mTexScaleT = 0.5f;
+		return job;
+	}
+
+	void make_jobs(const Source& src, const Output& out, std::vector<LLFaceGeometryJob>& jobs)
+	{
+		for (S32 i = 0; i < NUM_FACES; ++i)
+		{
+			U8* dst = out.face(i);
+			S32 first = i * VERTS_PER_FACE;
+
+			LLMatrix4 mat_vert;
+			LLMatrix3 mat_normal;
+			face_matrices(i, mat_vert, mat_normal);
+
+			LLFaceGeometryJob positions(LLFaceGeometryJob::POSITIONS);
+			positions.mCount = VERTS_PER_FACE;
+			positions.mSrc = src.mPositions + first;
+			positions.mDst = dst + POSITIONS_OFFSET;
+			positions.mDstEnd = dst + NORMALS_OFFSET;
+			positions.mVertexMatrix = mat_vert;
+			positions.mTextureIndex = i % 8;
+			jobs.push_back(positions);
+
+			LLFaceGeometryJob normals(LLFaceGeometryJob::NORMALS);
+			normals.mCount = VERTS_PER_FACE;
+			normals.mSrc = src.mNormals + first;
+			normals.mDst = dst + NORMALS_OFFSET;
+			normals.mNormalMatrix = mat_normal;
+			jobs.push_back(normals);
+
+			LLFaceGeometryJob weights(LLFaceGeometryJob::WEIGHTS);
+			weights.mCount = VERTS_PER_FACE;
+			weights.mSrc = src.mWeights + first;
+			weights.mDst = dst + WEIGHTS_OFFSET;
+			jobs.push_back(weights);
+
+			for (S32 j = 0; j < 2; ++j)
+			{
+				LLFaceGeometryJob fill(LLFaceGeometryJob::FILL);
+				fill.mCount = VERTS_PER_FACE;
+				fill.mDst = dst + (j ? EMISSIVE_OFFSET : COLORS_OFFSET);
+				fill.mFillValue = fill_value(i, j);
+				jobs.push_back(fill);
+			}
+
+			LLFaceGeometryJob tex_coords(LLFaceGeometryJob::TEXCOORDS);
+			tex_coords.mCount = VERTS_PER_FACE;
+			tex_coords.mSrc = src.mTexCoords + i * PADDED_VERTS;
+			tex_coords.mDst = dst + TEXCOORDS_OFFSET;
+			tex_coords.mTexGen = TEXGENS[i % 3];
+			tex_coords.mPositions = src.mPositions + first;
+			tex_coords.mNormals = src.mNormals + first;
+			tex_coords.mScale.set(0.5f, 2.f, 3.f);
+			tex_coords.mTexCos = cosf(0.1f * i);
+			tex_coords.mTexSin = sinf(0.1f * i);
+			tex_coords.mTexOffsetS = 0.25f;
+			tex_coords.mTexOffsetT = -0.125f;
+			tex_coords.mTexScaleS = 2.f;
+			tex_coords.mTexScaleT = 0.5f;
+			jobs.push_back(tex_coords);
+
+			LLFaceGeometryJob indices(LLFaceGeometryJob::INDICES);
+			indices.mCount = INDICES_PER_FACE;
+			indices.mSrc = src.mIndices + i * PADDED_INDICES;
+			indices.mDst = dst + INDICES_OFFSET;
+			indices.mIndexOffset = (U16) first;
+			jobs.push_back(indices);
+		}
+	}
+
+	// The jobs run one after another, as getGeometryVolume() does without a batch
+	void run_serial(const Source& src, const Output& out)
+	{
+		std::vector<LLFaceGeometryJob> jobs;
+		make_jobs(src, out, jobs);
+		for (const LLFaceGeometryJob& job : jobs)
+		{
+			job.run();
+		}
+	}
+
+	// The jobs added to a batch, as rebuildGeom() does
+	void run_batched(const Source& src, const Output& out, LLFaceGeometryQueue& queue, LLFaceGeometryBatch& batch)
+	{
+		std::vector<LLFaceGeometryJob> jobs;
+		make_jobs(src, out, jobs);
+		for (const LLFaceGeometryJob& job : jobs)
+		{
+			batch.add(job);
+		}
+		queue.run(batch);
+	}
+
+	// The per vertex loops LLFace::getGeometryVolume() ran before there
+	// were geometry jobs, writing the same streams as make_jobs()
+	void run_reference(const Source& src, const Output& out)
+	{
+		std::vector<LLFaceGeometryJob> jobs;
+		make_jobs(src, out, jobs);
+
+		for (S32 i = 0; i < NUM_FACES; ++i)
+		{
+			U8* face = out.face(i);
+			S32 first = i * VERTS_PER_FACE;
+
+			LLMatrix4 mat_vert_in;
+			LLMatrix3 mat_norm_in;
+			face_matrices(i, mat_vert_in, mat_norm_in);
+
+			// Positions
+			{
+				const LLVector4a* src_pos = src.mPositions + first;
+				const LLVector4a* end = src_pos + VERTS_PER_FACE;
+
+				LLMatrix4a mat_vert;
+				mat_vert.loadu(mat_vert_in);
+
+				F32* dst = (F32*) (face + POSITIONS_OFFSET);
+				F32* end_f32 = dst + PADDED_VERTS*4;
+
+				LLVector4a res0;
+				LLVector4a texIdx;
+
+				F32 val = 0.f;
+				S32* vp = (S32*) &val;
+				*vp = i % 8;
+
+				LLVector4Logical mask;
+				mask.clear();
+				mask.setElement<3>();
+
+				texIdx.set(0,0,0,val);
+
+				LLVector4a tmp;
+
+				while (src_pos < end)
+				{
+					mat_vert.affineTransform(*src_pos++, res0);
+					tmp.setSelectWithMask(mask, texIdx, res0);
+					tmp.store4a((F32*) dst);
+					dst += 4;
+				}
+
+				while (dst < end_f32)
+				{
+					res0.store4a((F32*) dst);
+					dst += 4;
+				}
+			}
+
+			// Normals
+			{
+				LLMatrix4a mat_normal;
+				mat_normal.loadu(mat_norm_in);
+
+				F32* normals = (F32*) (face + NORMALS_OFFSET);
+				const LLVector4a* src_norm = src.mNormals + first;
+				const LLVector4a* end = src_norm + VERTS_PER_FACE;
+
+				while (src_norm < end)
+				{
+					LLVector4a normal;
+					mat_normal.rotate(*src_norm++, normal);
+					normal.store4a(normals);
+					normals += 4;
+				}
+			}
+
+			// Weights
+			{
+				LLVector4a* wght = (LLVector4a*) (face + WEIGHTS_OFFSET);
+				for (S32 v = 0; v < VERTS_PER_FACE; ++v)
+				{
+					*(wght++) = src.mWeights[first + v];
+				}
+			}
+
+			// Colors and emissive
+			for (S32 j = 0; j < 2; ++j)
+			{
+				LLVector4a fill;
+
+				U32 vec[4];
+				vec[0] = vec[1] = vec[2] = vec[3] = fill_value(i, j);
+
+				fill.loadua((F32*) vec);
+
+				F32* dst = (F32*) (face + (j ? EMISSIVE_OFFSET : COLORS_OFFSET));
+				S32 num_vecs = VERTS_PER_FACE/4;
+				if (VERTS_PER_FACE%4 > 0)
+				{
+					++num_vecs;
+				}
+
+				for (S32 v = 0; v < num_vecs; v++)
+				{
+					fill.store4a(dst);
+					dst += 4;
+				}
+			}
+
+			// Texture coordinates, from the job made for this face
+			const LLFaceGeometryJob& tex_job = jobs[i * 7 + 5];
+			ref_texcoords(tex_job, src.mPositions + first, src.mNormals + first, src.mTexCoords + i * PADDED_VERTS,
+						  VERTS_PER_FACE, (LLVector2*) (face + TEXCOORDS_OFFSET));
+
+			// Indices
+			{
+				U16* idx = (U16*) (face + INDICES_OFFSET);
+				for (S32 v = 0; v < INDICES_PER_FACE; ++v)
+				{
+					*idx++ = src.mIndices[i * PADDED_INDICES + v] + (U16) first;
+				}
+			}
+		}
+	}
+
+	// Every stream matches the reference byte for byte, except texture
+	// coordinates, whose kernels reassociate the transform
+	void ensure_matches_reference(const std::string& msg, const Output& out, const Output& ref)
+	{
+		for (S32 i = 0; i < NUM_FACES; ++i)
+		{
+			std::string face_msg = llformat("%s, face %d", msg.c_str(), i);
+			tut::ensure(face_msg + " vertex streams",
+						!memcmp(out.face(i), ref.face(i), TEXCOORDS_OFFSET));
+			tut::ensure(face_msg + " indices",
+						!memcmp(out.face(i) + INDICES_OFFSET, ref.face(i) + INDICES_OFFSET, INDICES_PER_FACE * sizeof(U16)));
+
+			const LLVector2* tc = (const LLVector2*) (out.face(i) + TEXCOORDS_OFFSET);
+			const LLVector2* ref_tc = (const LLVector2*) (ref.face(i) + TEXCOORDS_OFFSET);
+			for (S32 v = 0; v < VERTS_PER_FACE; ++v)
+			{
+				for (S32 j = 0; j < 2; ++j)
+				{
+					F32 tolerance = 1e-4f * llmax(1.f, fabsf(ref_tc[v].mV[j]));
+					tut::ensure(llformat("%s texture coordinate %d", face_msg.c_str(), v),
+								fabsf(tc[v].mV[j] - ref_tc[v].mV[j]) <= tolerance);
+				}
+			}
+		}
+	}
+}
+
+namespace tut
+{
+	struct facegeometryjobs
+	{
+		facegeometryjobs()
+		{
+			run_reference(mSource, mReference);
+		}
+
+		Source mSource;
+		Output mReference;
+	};
+
+	typedef test_group<facegeometryjobs> facegeometryjobs_t;
+	typedef facegeometryjobs_t::object facegeometryjobs_object_t;
+	tut::facegeometryjobs_t tut_facegeometryjobs("LLFaceGeometryJobs");
+
+	template<> template<>
+	void facegeometryjobs_object_t::test<1>()
+	{
+		set_test_name("jobs run inline match the serial getGeometryVolume() loops");
+
+		Output serial;
+		run_serial(mSource, serial);
+		ensure_matches_reference("serial", serial, mReference);
+	}
+
+	template<> template<>
+	void facegeometryjobs_object_t::test<2>()
+	{
+		set_test_name("batches run on worker threads match the serial loops");
+
+		Output serial;
+		run_serial(mSource, serial);
+
+		// Reusing the batch reuses its staging memory
+		LLFaceGeometryQueue queue(3);
+		LLFaceGeometryBatch batch;
+		for (S32 pass = 0; pass < 3; ++pass)
+		{
+			Output batched;
+			run_batched(mSource, batched, queue, batch);
+			ensure("batch emptied", batch.isEmpty());
+			ensure_matches_reference(llformat("batched pass %d", pass), batched, mReference);
+			ensure("batched output matches inline byte for byte", !memcmp(serial.mData, batched.mData, serial.mSize));
+		}
+	}
+
+	template<> template<>
+	void facegeometryjobs_object_t::test<3>()
+	{
+		set_test_name("a queue without threads runs batches inline");
+
+		Output serial;
+		run_serial(mSource, serial);
+
+		LLFaceGeometryQueue queue(0);
+		LLFaceGeometryBatch batch;
+		Output batched;
+		run_batched(mSource, batched, queue, batch);
+		ensure("batch emptied", batch.isEmpty());
+		ensure_matches_reference("inline batch", batched, mReference);
+		ensure("inline batch matches serial byte for byte", !memcmp(serial.mData, batched.mData, serial.mSize));
+	}
+
+	template<> template<>
+	void facegeometryjobs_object_t::test<4>()
+	{
+		set_test_name("texture coordinate kernels match the per vertex code");
+
+		const LLFaceGeometryJob::ETexGen texgens[] = { LLFaceGeometryJob::TEX_COPY, LLFaceGeometryJob::TEX_XFORM, LLFaceGeometryJob::TEX_PLANAR };
+
+		// Every tail length of the 2 and 4 wide loops
+		for (S32 num_verts = 1; num_verts <= 12; ++num_verts)
+		{
+			LLVolumeFace face;
+			make_face(face, num_verts, 777 + num_verts);
+
+			for (LLFaceGeometryJob::ETexGen texgen : texgens)
+			{
+				LLVector2* out = (LLVector2*) ll_aligned_malloc_16(16 * sizeof(LLVector2));
+				LLVector2 expected[16];
+
+				make_texcoord_job(texgen, face, out).run();
+				ref_texcoords(make_texcoord_job(texgen, face, out), face, expected);
+
+				for (S32 i = 0; i < num_verts; ++i)
+				{
+					for (S32 j = 0; j < 2; ++j)
+					{
+						F32 tolerance = 1e-4f * llmax(1.f, fabsf(expected[i].mV[j]));
+						ensure(llformat("texgen %d, %d verts, vertex %d", texgen, num_verts, i),
+							   fabsf(out[i].mV[j] - expected[i].mV[j]) <= tolerance);
+					}
+				}
+				ll_aligned_free_16(out);
+			}
+		}
+	}
+
+	template<> template<>
+	void facegeometryjobs_object_t::test<5>()
+	{
+		set_test_name("texture coordinate kernel timings");
+
+		// Not a pass/fail test, just numbers to compare against the per
+		// vertex code on whatever machine runs the tests
+		const S32 FACES = 64;
+		const S32 VERTS = 1023;
+		const S32 PASSES = 20;
+
+		std::vector<LLVolumeFace> faces(FACES);
+		for (S32 i = 0; i < FACES; ++i)
+		{
+			make_face(faces[i], VERTS, i);
+		}
+		LLVector2* out = (LLVector2*) ll_aligned_malloc_16((VERTS + 1) * sizeof(LLVector2));
+
+		const char* names[] = { "copy", "xform", "planar" };
+		const LLFaceGeometryJob::ETexGen texgens[] = { LLFaceGeometryJob::TEX_COPY, LLFaceGeometryJob::TEX_XFORM, LLFaceGeometryJob::TEX_PLANAR };
+		for (S32 k = 0; k < 3; ++k)
+		{
+			LLTimer timer;
+			for (S32 pass = 0; pass < PASSES; ++pass)
+			{
+				for (const LLVolumeFace& face : faces)
+				{
+					ref_texcoords(make_texcoord_job(texgens[k], face, out), face, out);
+				}
+			}
+			F64 ref_time = timer.getElapsedTimeF64();
+
+			timer.reset();
+			for (S32 pass = 0; pass < PASSES; ++pass)
+			{
+				for (const LLVolumeFace& face : faces)
+				{
+					make_texcoord_job(texgens[k], face, out).run();
+				}
+			}
+			F64 job_time = timer.getElapsedTimeF64();
+
+			LL_INFOS() << "Texture coordinates, " << names[k] << ": per vertex " << ref_time * 1000.0
+					   << " ms, kernel " << job_time * 1000.0 << " ms for "
+					   << FACES * VERTS * PASSES << " vertices" << LL_ENDL;
+		}
+		ll_aligned_free_16(out);
+	}
+}
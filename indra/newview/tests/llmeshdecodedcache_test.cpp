@@ -0,0 +1,213 @@
+/**
+ * @file llmeshdecodedcache_test.cpp
+ * @brief Tests for LLMeshDecodedCache.
+ *
+ * $LicenseInfo:firstyear=2026&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2026, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+// Precompiled header
+#include "../llviewerprecompiledheaders.h"
+
+#include "../test/lltut.h"
+
+#include "../llmeshdecodedcache.h"
+
+#include "lldir.h"
+#include "lldiriterator.h"
+#include "llfile.h"
+#include "llvolume.h"
+#include "llvolumemgr.h"
+
+#include <boost/filesystem.hpp>
+
+namespace
+{
+	LLPointer<LLVolume> make_volume()
+	{
+		LLVolumeParams volume_params;
+		volume_params.setType(LL_PCODE_PROFILE_SQUARE, LL_PCODE_PATH_LINE);
+		volume_params.setBeginAndEndS(0.f, 1.f);
+		volume_params.setBeginAndEndT(0.f, 1.f);
+		volume_params.setRatio(1.f, 1.f);
+		volume_params.setShear(0.f, 0.f);
+		return new LLVolume(volume_params, LLVolumeLODGroup::getVolumeScaleFromDetail(2));
+	}
+
+	LLVolumeParams make_mesh_params()
+	{
+		LLVolumeParams mesh_params;
+		mesh_params.setSculptID(LLUUID::generateNewID(), LL_SCULPT_TYPE_MESH);
+		return mesh_params;
+	}
+
+	S32 count_files(const std::string& dir)
+	{
+		S32 count = 0;
+		std::string name;
+		LLDirIterator iter(dir, "*");
+		while (iter.next(name))
+		{
+			++count;
+		}
+		return count;
+	}
+}
+
+namespace tut
+{
+	struct meshdecodedcache
+	{
+		meshdecodedcache()
+		:	mCacheDir(std::string(LLFile::tmpdir()) + "llmeshdecodedcache_test_" + LLUUID::generateNewID().asString()),
+			mVolume(make_volume())
+		{
+			mVolume->packDecodedFaces(mFaces);
+			// Header included
+			mFileSize = 48 + mFaces.size();
+		}
+
+		~meshdecodedcache()
+		{
+			gDirUtilp->deleteDirAndContents(mCacheDir);
+		}
+
+		std::string getFilename(const LLVolumeParams& mesh_params, S32 lod) const
+		{
+			return gDirUtilp->add(mCacheDir, llformat("%s_%d_%02x.mesh", mesh_params.getSculptID().asString().c_str(),
+													  lod, (U32) mesh_params.getSculptType()));
+		}
+
+		bool load(LLMeshDecodedCache& cache, const LLVolumeParams& mesh_params)
+		{
+			LLPointer<LLVolume> volume = make_volume();
+			return cache.loadLOD(mesh_params, 2, volume);
+		}
+
+		void store(LLMeshDecodedCache& cache, const LLVolumeParams& mesh_params)
+		{
+			std::vector<U8> faces;
+			ensure("packed", cache.packLOD(mVolume, faces));
+			cache.storeLOD(mesh_params, 2, faces);
+		}
+
+		std::string mCacheDir;
+		LLPointer<LLVolume> mVolume;
+		std::vector<U8> mFaces;
+		U64 mFileSize;
+	};
+
+	typedef test_group<meshdecodedcache> meshdecodedcache_t;
+	typedef meshdecodedcache_t::object meshdecodedcache_object_t;
+	tut::meshdecodedcache_t tut_meshdecodedcache("LLMeshDecodedCache");
+
+	template<> template<>
+	void meshdecodedcache_object_t::test<1>()
+	{
+		set_test_name("stored LODs load back until evicted least recently used first");
+
+		// Room for two files
+		LLMeshDecodedCache cache(mFileSize * 5 / 2, mCacheDir);
+		LLVolumeParams a = make_mesh_params();
+		LLVolumeParams b = make_mesh_params();
+		LLVolumeParams c = make_mesh_params();
+
+		ensure("miss", !load(cache, a));
+		store(cache, a);
+		store(cache, b);
+		llstat stat_data;
+		ensure_equals("stat", LLFile::stat(getFilename(a, 2), &stat_data), 0);
+		ensure_equals("file size", (U64) stat_data.st_size, mFileSize);
+
+		LLPointer<LLVolume> volume = make_volume();
+		ensure("hit", cache.loadLOD(a, 2, volume));
+		ensure_equals("faces", volume->getNumVolumeFaces(), mVolume->getNumVolumeFaces());
+		ensure_equals("vertices", volume->getVolumeFace(0).mNumVertices, mVolume->getVolumeFace(0).mNumVertices);
+		ensure("other lod misses", !cache.loadLOD(a, 1, volume));
+
+		// a was used after b, so b makes way for c
+		store(cache, c);
+		ensure("b evicted", !LLFile::isfile(getFilename(b, 2)));
+		ensure("a kept", load(cache, a));
+		ensure("c stored", load(cache, c));
+		ensure_equals("files", count_files(mCacheDir), 2);
+	}
+
+	template<> template<>
+	void meshdecodedcache_object_t::test<2>()
+	{
+		set_test_name("startup trims the oldest files to half the limit");
+
+		const U64 max_bytes = mFileSize * 5 / 2;
+		LLVolumeParams a = make_mesh_params();
+		LLVolumeParams b = make_mesh_params();
+		{
+			LLMeshDecodedCache cache(max_bytes, mCacheDir);
+			store(cache, a);
+			store(cache, b);
+		}
+
+		// a is older, and an interrupted write left a temp file behind
+		std::time_t now = std::time(nullptr);
+		boost::filesystem::last_write_time(getFilename(a, 2), now - 100);
+		boost::filesystem::last_write_time(getFilename(b, 2), now - 10);
+		LLFILE* fp = LLFile::fopen(getFilename(b, 2) + ".7.tmp", "wb");
+		ensure("temp file", fp != nullptr);
+		fclose(fp);
+
+		LLMeshDecodedCache cache(max_bytes, mCacheDir);
+		ensure("oldest removed", !LLFile::isfile(getFilename(a, 2)));
+		ensure("temp removed", !LLFile::isfile(getFilename(b, 2) + ".7.tmp"));
+		ensure_equals("files", count_files(mCacheDir), 1);
+		ensure("newest kept", load(cache, b));
+	}
+
+	template<> template<>
+	void meshdecodedcache_object_t::test<3>()
+	{
+		set_test_name("stale and damaged files are discarded");
+
+		LLMeshDecodedCache cache(mFileSize * 10, mCacheDir);
+		LLVolumeParams a = make_mesh_params();
+		LLVolumeParams b = make_mesh_params();
+		store(cache, a);
+
+		// A file for another mesh under b's name
+		ensure_equals("copy", LLFile::copy(getFilename(a, 2), getFilename(b, 2)), true);
+		ensure("wrong mesh", !load(cache, b));
+		ensure("wrong mesh removed", !LLFile::isfile(getFilename(b, 2)));
+
+		// Cut short, as a crash mid write would leave it
+		std::vector<U8> data(mFileSize);
+		LLFILE* fp = LLFile::fopen(getFilename(a, 2), "rb");
+		ensure("open", fp != nullptr);
+		ensure_equals("read", fread(&data[0], 1, data.size(), fp), data.size());
+		fclose(fp);
+		fp = LLFile::fopen(getFilename(a, 2), "wb");
+		fwrite(&data[0], 1, data.size() / 2, fp);
+		fclose(fp);
+		ensure("truncated", !load(cache, a));
+		ensure("truncated removed", !LLFile::isfile(getFilename(a, 2)));
+
+		// And unpacked again and replaced
+		store(cache, a);
+		ensure("restored", load(cache, a));
+	}
+}
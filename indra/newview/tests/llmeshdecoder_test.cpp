@@ -0,0 +1,253 @@
+/**
+ * @file llmeshdecoder_test.cpp
+ * @brief Tests for LLMeshDecoder.
+ *
+ * $LicenseInfo:firstyear=2026&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2026, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+// Precompiled header
+#include "../llviewerprecompiledheaders.h"
+
+#include "../test/lltut.h"
+
+#include "../llmeshdecoder.h"
+
+#include "lltimer.h"
+
+#include <atomic>
+#include <set>
+#include <thread>
+
+namespace
+{
+	// Records what it decodes, and holds a decode thread on the first
+	// request while the gate is closed
+	class TestResponder : public LLMeshDecoder::Responder
+	{
+	public:
+		TestResponder()
+		:	mMutex(),
+			mGateOpen(true),
+			mWaiting(false)
+		{
+		}
+
+		void decode(LLMeshDecoder::Request* request) override
+		{
+			mWaiting = true;
+			while (!mGateOpen)
+			{
+				ms_sleep(1);
+			}
+			mWaiting = false;
+
+			LLMutexLock lock(&mMutex);
+			mDecoded.push_back(request->mMeshID);
+			mThreadIDs.insert(std::this_thread::get_id());
+		}
+
+		std::vector<LLUUID> getDecoded()
+		{
+			LLMutexLock lock(&mMutex);
+			return mDecoded;
+		}
+
+		LLMutex mMutex;
+		std::vector<LLUUID> mDecoded;
+		std::set<std::thread::id> mThreadIDs;
+		std::atomic<bool> mGateOpen;
+		std::atomic<bool> mWaiting;
+	};
+
+	LLMeshDecoder::Request* make_request(const LLUUID& mesh_id)
+	{
+		LLMeshDecoder::Request* request = new LLMeshDecoder::Request(LLMeshDecoder::SKIN_INFO, mesh_id);
+		U8* data = (U8*) ll_aligned_malloc_16(64);
+		request->adoptData(data, 64);
+		return request;
+	}
+
+	// Polls for up to ten seconds
+	template<typename CONDITION>
+	bool wait_for(CONDITION condition)
+	{
+		for (S32 i = 0; i < 10000 && !condition(); ++i)
+		{
+			ms_sleep(1);
+		}
+		return condition();
+	}
+}
+
+namespace tut
+{
+	struct meshdecoder
+	{
+		TestResponder mResponder;
+	};
+
+	typedef test_group<meshdecoder> meshdecoder_t;
+	typedef meshdecoder_t::object meshdecoder_object_t;
+	tut::meshdecoder_t tut_meshdecoder("LLMeshDecoder");
+
+	template<> template<>
+	void meshdecoder_object_t::test<1>()
+	{
+		set_test_name("without threads requests are decoded as they are added");
+
+		LLMeshDecoder decoder(&mResponder, 0);
+		LLUUID mesh_id = LLUUID::generateNewID();
+		decoder.addRequest(make_request(mesh_id));
+
+		ensure_equals("decoded", mResponder.getDecoded().size(), (size_t) 1);
+		ensure_equals("mesh", mResponder.getDecoded()[0], mesh_id);
+		ensure("on this thread", mResponder.mThreadIDs.count(std::this_thread::get_id()) == 1);
+		ensure_equals("nothing left", decoder.getNumRequests(), 0);
+		ensure("slot free", decoder.hasRequestSlot());
+	}
+
+	template<> template<>
+	void meshdecoder_object_t::test<2>()
+	{
+		set_test_name("the pool decodes every request once, off the calling thread");
+
+		const S32 NUM_REQUESTS = 500;
+		std::set<LLUUID> added;
+		{
+			LLMeshDecoder decoder(&mResponder, 4);
+			for (S32 i = 0; i < NUM_REQUESTS; ++i)
+			{
+				LLUUID mesh_id = LLUUID::generateNewID();
+				added.insert(mesh_id);
+				decoder.addRequest(make_request(mesh_id));
+			}
+
+			ensure("drained", wait_for([&]() { return decoder.getNumRequests() == 0; }));
+			ensure("none pending", !decoder.hasPendingRequests());
+		}
+
+		std::vector<LLUUID> decoded = mResponder.getDecoded();
+		ensure_equals("decoded", decoded.size(), (size_t) NUM_REQUESTS);
+		ensure("each once", std::set<LLUUID>(decoded.begin(), decoded.end()) == added);
+		ensure("not on this thread", mResponder.mThreadIDs.count(std::this_thread::get_id()) == 0);
+	}
+
+	template<> template<>
+	void meshdecoder_object_t::test<3>()
+	{
+		set_test_name("highest scores first, arrival order among equals");
+
+		LLMeshDecoder decoder(&mResponder, 1);
+		mResponder.mGateOpen = false;
+
+		// Holds the only thread while the rest queue up
+		LLUUID first = LLUUID::generateNewID();
+		decoder.addRequest(make_request(first));
+		ensure("thread busy", wait_for([&]() { return (bool) mResponder.mWaiting; }));
+
+		std::vector<LLUUID> ids(6);
+		for (LLUUID& id : ids)
+		{
+			id.generate();
+			decoder.addRequest(make_request(id));
+		}
+
+		// Only the requests still queued are offered for scoring
+		std::map<LLUUID, F32> scores;
+		decoder.getPendingMeshIDs(scores);
+		ensure_equals("pending", scores.size(), ids.size());
+		ensure("in progress not offered", scores.find(first) == scores.end());
+
+		scores[ids[0]] = 1.f;
+		scores[ids[1]] = 5.f;
+		scores[ids[2]] = 0.f;
+		scores[ids[3]] = 5.f;
+		scores[ids[4]] = 3.f;
+		scores[ids[5]] = 1.f;
+		decoder.setScores(scores);
+
+		mResponder.mGateOpen = true;
+		ensure("drained", wait_for([&]() { return decoder.getNumRequests() == 0; }));
+
+		std::vector<LLUUID> decoded = mResponder.getDecoded();
+		ensure_equals("decoded", decoded.size(), ids.size() + 1);
+		ensure_equals("0", decoded[0], first);
+		ensure_equals("1", decoded[1], ids[1]);
+		ensure_equals("2", decoded[2], ids[3]);
+		ensure_equals("3", decoded[3], ids[4]);
+		ensure_equals("4", decoded[4], ids[0]);
+		ensure_equals("5", decoded[5], ids[5]);
+		ensure_equals("6", decoded[6], ids[2]);
+	}
+
+	template<> template<>
+	void meshdecoder_object_t::test<4>()
+	{
+		set_test_name("requests hold their slot until decoded");
+
+		LLMeshDecoder decoder(&mResponder, 1);
+		mResponder.mGateOpen = false;
+
+		for (S32 i = 0; i < LLMeshDecoder::MAX_REQUESTS; ++i)
+		{
+			ensure(llformat("slot %d", i), decoder.hasRequestSlot());
+			decoder.addRequest(make_request(LLUUID::generateNewID()));
+		}
+		ensure("thread busy", wait_for([&]() { return (bool) mResponder.mWaiting; }));
+
+		// The one being decoded still counts
+		ensure_equals("queued and in progress", decoder.getNumRequests(), (S32) LLMeshDecoder::MAX_REQUESTS);
+		ensure("full", !decoder.hasRequestSlot());
+		std::map<LLUUID, F32> scores;
+		decoder.getPendingMeshIDs(scores);
+		ensure_equals("queued", scores.size(), (size_t) LLMeshDecoder::MAX_REQUESTS - 1);
+
+		mResponder.mGateOpen = true;
+		ensure("drained", wait_for([&]() { return decoder.getNumRequests() == 0; }));
+		ensure("slot free", decoder.hasRequestSlot());
+		ensure_equals("decoded", mResponder.getDecoded().size(), (size_t) LLMeshDecoder::MAX_REQUESTS);
+	}
+
+	template<> template<>
+	void meshdecoder_object_t::test<5>()
+	{
+		set_test_name("requests left queued are freed on shutdown");
+
+		LLMeshDecoder* decoder = new LLMeshDecoder(&mResponder, 1);
+		mResponder.mGateOpen = false;
+		for (S32 i = 0; i < 8; ++i)
+		{
+			decoder->addRequest(make_request(LLUUID::generateNewID()));
+		}
+		ensure("thread busy", wait_for([&]() { return (bool) mResponder.mWaiting; }));
+
+		// Let the thread finish the one it holds while the decoder shuts down
+		std::thread opener([&]()
+			{
+				ms_sleep(50);
+				mResponder.mGateOpen = true;
+			});
+		delete decoder;
+		opener.join();
+
+		ensure("not all decoded", mResponder.getDecoded().size() < 8);
+	}
+}
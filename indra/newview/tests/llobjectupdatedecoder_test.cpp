@@ -0,0 +1,314 @@
+/**
+ * @file llobjectupdatedecoder_test.cpp
+ * @brief Tests for LLObjectUpdateDecoder.
+ *
+ * $LicenseInfo:firstyear=2001&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+// Precompiled header
+#include "../llviewerprecompiledheaders.h"
+
+#include "../test/lltut.h"
+
+#include "../llobjectupdatedecoder.h"
+
+#include <memory>
+
+#include "lldatapacker.h"
+#include "lluuid.h"
+
+namespace
+{
+	const U32 HAS_PARENT = 0x20;
+	const U32 HAS_OMEGA = 0x80;
+
+	// Laid out as LLViewerObject::initObjectDataMap() describes it
+	LLObjectUpdateDecoder::Offsets make_offsets()
+	{
+		LLObjectUpdateDecoder::Offsets offsets;
+		U32 count = sizeof(LLUUID);					// ID
+		offsets.mLocalID = count;
+		count += sizeof(U32);
+		count += sizeof(U8) + sizeof(U8);			// PCode, State
+		offsets.mCRC = count;
+		count += sizeof(U32);
+		count += sizeof(U8) + sizeof(U8);			// Material, ClickAction
+		offsets.mScale = count;
+		count += sizeof(LLVector3);
+		offsets.mPos = count;
+		count += sizeof(LLVector3);
+		offsets.mRot = count;
+		count += sizeof(LLVector3);
+		offsets.mSpecialCode = count;
+		count += sizeof(U32);
+		count += sizeof(LLUUID);					// Owner
+		count += sizeof(LLVector3);					// Omega
+		offsets.mParentID = count;
+		return offsets;
+	}
+
+	struct Block
+	{
+		U32 mLocalID;
+		U32 mCRC;
+		LLVector3 mScale;
+		LLVector3 mPos;
+		LLVector3 mRot;
+		U32 mSpecialCode;
+		U32 mParentID;
+	};
+
+	// Packs block the way the simulator does, followed by some of the
+	// fields that come after ParentID.  Returns the size used.
+	S32 pack_block(const Block& block, U8* buffer, S32 size)
+	{
+		LLDataPackerBinaryBuffer dp(buffer, size);
+		dp.packUUID(LLUUID::generateNewID(), "ID");
+		dp.packU32(block.mLocalID, "LocalID");
+		dp.packU8(9, "PCode");
+		dp.packU8(0, "State");
+		dp.packU32(block.mCRC, "CRC");
+		dp.packU8(3, "Material");
+		dp.packU8(0, "ClickAction");
+		dp.packVector3(block.mScale, "Scale");
+		dp.packVector3(block.mPos, "Pos");
+		dp.packVector3(block.mRot, "Rot");
+		dp.packU32(block.mSpecialCode, "SpecialCode");
+		dp.packUUID(LLUUID::generateNewID(), "Owner");
+		if (block.mSpecialCode & HAS_OMEGA)
+		{
+			dp.packVector3(LLVector3(0.f, 0.f, 1.f), "Omega");
+		}
+		if (block.mSpecialCode & HAS_PARENT)
+		{
+			dp.packU32(block.mParentID, "ParentID");
+		}
+		dp.packString(std::string("Text"), "Text");
+		return dp.getCurrentSize();
+	}
+
+	Block make_block(U32 special_code)
+	{
+		Block block;
+		block.mLocalID = 0x12345678;
+		block.mCRC = 0xdeadbeef;
+		block.mScale.set(0.5f, 2.f, 10.f);
+		block.mPos.set(128.25f, 3.5f, 4000.f);
+		LLQuaternion rot(0.3f, LLVector3(1.f, 2.f, 3.f));
+		block.mRot = rot.packToVector3();
+		block.mSpecialCode = special_code;
+		block.mParentID = 0x0badf00d;
+		return block;
+	}
+
+	void ensure_block(const std::string& msg, const LLCompressedObjectInfo& info, const Block& block)
+	{
+		tut::ensure_equals(msg + " local id", info.mLocalID, block.mLocalID);
+		tut::ensure_equals(msg + " crc", info.mCRC, block.mCRC);
+		tut::ensure_equals(msg + " scale", info.mScale, block.mScale);
+		tut::ensure_equals(msg + " position", info.mPosition, block.mPos);
+
+		LLQuaternion rot;
+		rot.unpackFromVector3(block.mRot);
+		tut::ensure_equals(msg + " rotation", info.mRotation, rot);
+
+		U32 parent_id = (block.mSpecialCode & HAS_PARENT) ? block.mParentID : 0;
+		tut::ensure_equals(msg + " parent", info.mParentID, parent_id);
+	}
+
+	// Fills a batch with count blocks, local ids first_id and up, and
+	// every fifth block too short to decode
+	void fill_batch(LLObjectUpdateBatch& batch, U32 first_id, S32 count, std::vector<Block>& blocks)
+	{
+		for (S32 i = 0; i < count; ++i)
+		{
+			U8 buffer[256];
+			Block block = make_block(i % 2 ? HAS_PARENT : 0);
+			block.mLocalID = first_id + i;
+			S32 size = pack_block(block, buffer, sizeof(buffer));
+			if (i % 5 == 4)
+			{
+				size = 8;
+			}
+			memcpy(batch.addBlock(i, size), buffer, size);
+			blocks.push_back(block);
+		}
+	}
+
+	void ensure_batch(const std::string& msg, const LLObjectUpdateBatch& batch, const std::vector<Block>& blocks)
+	{
+		tut::ensure_equals(msg + " blocks", batch.mBlocks.size(), blocks.size());
+		for (size_t i = 0; i < blocks.size(); ++i)
+		{
+			const LLObjectUpdateBatch::Block& decoded = batch.mBlocks[i];
+			std::string block_msg = llformat("%s block %d", msg.c_str(), (S32)i);
+			tut::ensure_equals(block_msg + " flags", decoded.mUpdateFlags, (U32)i);
+			tut::ensure_equals(block_msg + " decoded", decoded.mDecoded, i % 5 != 4);
+			if (decoded.mDecoded)
+			{
+				ensure_block(block_msg, decoded.mInfo, blocks[i]);
+			}
+		}
+	}
+}
+
+namespace tut
+{
+	struct objectupdatedecoder
+	{
+		objectupdatedecoder()
+		:	mDecoder(make_offsets())
+		{
+		}
+
+		LLObjectUpdateDecoder mDecoder;
+	};
+
+	typedef test_group<objectupdatedecoder> objectupdatedecoder_t;
+	typedef objectupdatedecoder_t::object objectupdatedecoder_object_t;
+	tut::objectupdatedecoder_t tut_objectupdatedecoder("LLObjectUpdateDecoder");
+
+	template<> template<>
+	void objectupdatedecoder_object_t::test<1>()
+	{
+		set_test_name("fields of a block with no parent");
+
+		for (U32 special_code : { 0U, HAS_OMEGA })
+		{
+			U8 buffer[256];
+			Block block = make_block(special_code);
+			S32 size = pack_block(block, buffer, sizeof(buffer));
+
+			LLCompressedObjectInfo info;
+			std::string msg = llformat("special code %x", special_code);
+			ensure(msg, mDecoder.decode(buffer, size, info));
+			ensure_block(msg, info, block);
+		}
+	}
+
+	template<> template<>
+	void objectupdatedecoder_object_t::test<2>()
+	{
+		set_test_name("parent id found with and without omega");
+
+		for (U32 special_code : { HAS_PARENT, HAS_PARENT | HAS_OMEGA })
+		{
+			U8 buffer[256];
+			Block block = make_block(special_code);
+			S32 size = pack_block(block, buffer, sizeof(buffer));
+
+			LLCompressedObjectInfo info;
+			std::string msg = llformat("special code %x", special_code);
+			ensure(msg, mDecoder.decode(buffer, size, info));
+			ensure_block(msg, info, block);
+		}
+	}
+
+	template<> template<>
+	void objectupdatedecoder_object_t::test<3>()
+	{
+		set_test_name("short blocks are left to the data packer");
+
+		LLObjectUpdateDecoder::Offsets offsets = make_offsets();
+		U8 buffer[256];
+		LLCompressedObjectInfo info;
+
+		ensure("no data", !mDecoder.decode(nullptr, 0, info));
+
+		Block block = make_block(0);
+		pack_block(block, buffer, sizeof(buffer));
+		S32 min_size = offsets.mSpecialCode + sizeof(U32);
+		ensure("no special code", !mDecoder.decode(buffer, min_size - 1, info));
+		ensure("just enough", mDecoder.decode(buffer, min_size, info));
+
+		// The parent id comes last, so the rest may be there without it
+		block = make_block(HAS_PARENT);
+		pack_block(block, buffer, sizeof(buffer));
+		S32 parent_end = offsets.mParentID - sizeof(LLVector3) + sizeof(U32);
+		ensure("no parent id", !mDecoder.decode(buffer, parent_end - 1, info));
+		ensure("parent id", mDecoder.decode(buffer, parent_end, info));
+		ensure_block("parent id", info, block);
+	}
+
+	template<> template<>
+	void objectupdatedecoder_object_t::test<4>()
+	{
+		set_test_name("batches come back in order from the decode threads");
+
+		const S32 NUM_BATCHES = 50;
+		const S32 BLOCKS_PER_BATCH = 20;
+		std::vector<std::vector<Block> > blocks(NUM_BATCHES);
+		{
+			LLObjectUpdateDecodeQueue queue(mDecoder, 3);
+			ensure("empty", queue.popBatch() == nullptr);
+
+			for (S32 n = 0; n < NUM_BATCHES; ++n)
+			{
+				LLObjectUpdateBatch* batch = new LLObjectUpdateBatch;
+				batch->mRegionHandle = n;
+				fill_batch(*batch, n * 1000, BLOCKS_PER_BATCH, blocks[n]);
+				queue.addBatch(batch);
+			}
+
+			for (S32 n = 0; n < NUM_BATCHES; ++n)
+			{
+				std::unique_ptr<LLObjectUpdateBatch> batch(queue.popBatch());
+				ensure("batch", batch.get() != nullptr);
+				ensure_equals("order", batch->mRegionHandle, (U64)n);
+				ensure_batch(llformat("batch %d", n), *batch, blocks[n]);
+			}
+			ensure("drained", queue.popBatch() == nullptr);
+			ensure("nothing pending", !queue.hasPendingBatches());
+
+			// Batches still queued at shutdown are freed with the queue
+			LLObjectUpdateBatch* batch = new LLObjectUpdateBatch;
+			std::vector<Block> unused;
+			fill_batch(*batch, 0, BLOCKS_PER_BATCH, unused);
+			queue.addBatch(batch);
+		}
+	}
+
+	template<> template<>
+	void objectupdatedecoder_object_t::test<5>()
+	{
+		set_test_name("without threads batches are decoded as they are popped");
+
+		LLObjectUpdateDecodeQueue queue(mDecoder, 0);
+		ensure_equals("threads", queue.getNumThreads(), 0U);
+
+		std::vector<Block> blocks;
+		LLObjectUpdateBatch* batch = new LLObjectUpdateBatch;
+		fill_batch(*batch, 1, 10, blocks);
+		ensure("empty blocks", batch->addBlock(99, 0) == nullptr);
+		ensure_equals("one buffer", batch->mData.size(), (size_t)(batch->mBlocks.back().mOffset));
+		queue.addBatch(batch);
+		ensure("pending", queue.hasPendingBatches());
+		ensure("not decoded yet", !batch->mBlocks[0].mDecoded);
+
+		std::unique_ptr<LLObjectUpdateBatch> popped(queue.popBatch());
+		ensure("same batch", popped.get() == batch);
+		ensure("nothing pending", !queue.hasPendingBatches());
+		ensure_equals("empty block kept", popped->mBlocks.size(), (size_t)11);
+		ensure("empty block not decoded", !popped->mBlocks.back().mDecoded);
+		popped->mBlocks.pop_back();
+		ensure_batch("inline", *popped, blocks);
+	}
+}
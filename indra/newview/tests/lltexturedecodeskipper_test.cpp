@@ -0,0 +1,85 @@
+/**
+ * @file lltexturedecodeskipper_test.cpp
+ * @brief Tests for LLTextureDecodeSkipper.
+ *
+ * $LicenseInfo:firstyear=2026&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2026, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+// Precompiled header
+#include "../llviewerprecompiledheaders.h"
+
+#include "../test/lltut.h"
+
+#include "../lltexturedecodeskipper.h"
+
+namespace tut
+{
+	struct texturedecodeskipper
+	{
+		LLTextureDecodeSkipper mSkipper;
+	};
+
+	typedef test_group<texturedecodeskipper> texturedecodeskipper_t;
+	typedef texturedecodeskipper_t::object texturedecodeskipper_object_t;
+	tut::texturedecodeskipper_t tut_texturedecodeskipper("LLTextureDecodeSkipper");
+
+	template<> template<>
+	void texturedecodeskipper_object_t::test<1>()
+	{
+		set_test_name("nothing is skipped until a decode is shown");
+
+		ensure("no shown decode", !mSkipper.skipDecode(false, 0, 3, 1000));
+		ensure_equals("shown", mSkipper.getShownDiscard(), -1);
+
+		mSkipper.decoded(3);
+		ensure_equals("shown", mSkipper.getShownDiscard(), 3);
+		ensure("superseded", mSkipper.skipDecode(false, 0, 2, 2000));
+	}
+
+	template<> template<>
+	void texturedecodeskipper_object_t::test<2>()
+	{
+		set_test_name("only levels the desired discard has moved past are skipped");
+
+		mSkipper.decoded(4);
+		ensure("wanted level", !mSkipper.skipDecode(false, 2, 2, 1000));
+		ensure("coarser wanted", !mSkipper.skipDecode(false, 3, 2, 1000));
+		ensure("all data", !mSkipper.skipDecode(true, 0, 2, 1000));
+		ensure("finer wanted", mSkipper.skipDecode(false, 1, 2, 1000));
+	}
+
+	template<> template<>
+	void texturedecodeskipper_object_t::test<3>()
+	{
+		set_test_name("a fetch that stops growing decodes what it has");
+
+		mSkipper.decoded(3);
+		ensure("first", mSkipper.skipDecode(false, 0, 2, 1000));
+		ensure("same size", !mSkipper.skipDecode(false, 0, 2, 1000));
+		ensure("smaller", !mSkipper.skipDecode(false, 0, 2, 500));
+		ensure("grew", mSkipper.skipDecode(false, 0, 1, 4000));
+
+		// A decode that was not skipped doesn't reset the growth check
+		mSkipper.decoded(1);
+		ensure("no growth after decode", !mSkipper.skipDecode(false, 0, 1, 4000));
+		ensure("grew after decode", mSkipper.skipDecode(false, 0, 1, 8000));
+	}
+}
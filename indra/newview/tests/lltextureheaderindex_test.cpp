@@ -0,0 +1,206 @@
+/**
+ * @file lltextureheaderindex_test.cpp
+ * @brief Tests for LLTextureHeaderIndex and LLEntrySeqLock.
+ *
+ * $LicenseInfo:firstyear=2026&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2026, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+// Precompiled header
+#include "../llviewerprecompiledheaders.h"
+
+#include "../test/lltut.h"
+
+#include "../lltextureheaderindex.h"
+
+#include <map>
+#include <thread>
+
+namespace
+{
+	// Few slots, so probe runs are long and wrap around the end of the table
+	const U32 NUM_ENTRIES = 24;
+
+	struct IDs
+	{
+		LLUUID operator()(S32 idx) const { return mIDs[idx]; }
+		const LLUUID* mIDs;
+	};
+
+	struct Record
+	{
+		U32 mValues[8];
+	};
+}
+
+namespace tut
+{
+	struct textureheaderindex
+	{
+		textureheaderindex()
+		{
+			mIndex.init(NUM_ENTRIES);
+			for (U32 i = 0; i < NUM_ENTRIES; ++i)
+			{
+				mIDs[i].generate();
+			}
+		}
+
+		IDs getID() const { return IDs{ mIDs }; }
+
+		LLTextureHeaderIndex mIndex;
+		LLUUID mIDs[NUM_ENTRIES];
+	};
+
+	typedef test_group<textureheaderindex> textureheaderindex_t;
+	typedef textureheaderindex_t::object textureheaderindex_object_t;
+	tut::textureheaderindex_t tut_textureheaderindex("LLTextureHeaderIndex");
+
+	template<> template<>
+	void textureheaderindex_object_t::test<1>()
+	{
+		set_test_name("inserted entries are found, others are not");
+
+		ensure_equals("empty", mIndex.find(mIDs[0], getID()), -1);
+		for (U32 i = 0; i < NUM_ENTRIES; ++i)
+		{
+			mIndex.insert(mIDs[i], (S32)i, getID());
+		}
+		for (U32 i = 0; i < NUM_ENTRIES; ++i)
+		{
+			ensure_equals("found", mIndex.find(mIDs[i], getID()), (S32)i);
+		}
+		for (S32 i = 0; i < 100; ++i)
+		{
+			ensure_equals("miss", mIndex.find(LLUUID::generateNewID(), getID()), -1);
+		}
+
+		mIndex.clear();
+		for (U32 i = 0; i < NUM_ENTRIES; ++i)
+		{
+			ensure_equals("cleared", mIndex.find(mIDs[i], getID()), -1);
+		}
+	}
+
+	template<> template<>
+	void textureheaderindex_object_t::test<2>()
+	{
+		set_test_name("removal keeps the rest of the probe runs reachable");
+
+		// Random inserts and removes, checked against a map after each step
+		std::map<S32, bool> indexed;
+		for (S32 step = 0; step < 5000; ++step)
+		{
+			S32 idx = rand() % NUM_ENTRIES;
+			if (indexed[idx])
+			{
+				mIndex.remove(mIDs[idx], idx);
+				indexed[idx] = false;
+			}
+			else
+			{
+				mIndex.insert(mIDs[idx], idx, getID());
+				indexed[idx] = true;
+			}
+			for (U32 i = 0; i < NUM_ENTRIES; ++i)
+			{
+				ensure_equals(llformat("step %d entry %u", step, i),
+							  mIndex.find(mIDs[i], getID()), indexed[i] ? (S32)i : -1);
+			}
+		}
+	}
+
+	template<> template<>
+	void textureheaderindex_object_t::test<3>()
+	{
+		set_test_name("an id moved to another entry replaces its old slot");
+
+		mIndex.insert(mIDs[3], 3, getID());
+		mIndex.insert(mIDs[4], 4, getID());
+
+		// The texture in entry 4 is copied to entry 5
+		LLUUID moved = mIDs[4];
+		mIDs[5] = moved;
+		mIndex.insert(moved, 5, getID());
+		ensure_equals("new entry", mIndex.find(moved, getID()), 5);
+
+		mIndex.remove(moved, 5);
+		ensure_equals("no stale slot left", mIndex.find(moved, getID()), -1);
+
+		// A slot whose entry now holds another id doesn't match
+		LLUUID old_id = mIDs[3];
+		mIDs[3].generate();
+		ensure_equals("reused entry", mIndex.find(old_id, getID()), -1);
+		ensure_equals("other entries", mIndex.find(mIDs[0], getID()), -1);
+	}
+
+	template<> template<>
+	void textureheaderindex_object_t::test<4>()
+	{
+		set_test_name("sequence locked reads never see a torn record");
+
+		const U32 NUM_RECORDS = 4;
+		const U32 NUM_WRITES = 200000;
+		Record records[NUM_RECORDS];
+		memset(records, 0, sizeof(records));
+		LLEntrySeqLock seqs;
+		seqs.init(NUM_RECORDS);
+
+		std::atomic<bool> done(false);
+		std::thread writer([&]()
+			{
+				for (U32 n = 1; n <= NUM_WRITES; ++n)
+				{
+					U32 idx = n % NUM_RECORDS;
+					seqs.beginWrite(idx);
+					for (U32 i = 0; i < 8; ++i)
+					{
+						((volatile U32*)records[idx].mValues)[i] = n;
+					}
+					seqs.endWrite(idx);
+				}
+				done = true;
+			});
+
+		U32 reads = 0;
+		U32 torn = 0;
+		while (!done || reads < 1000)
+		{
+			U32 idx = reads % NUM_RECORDS;
+			Record copy;
+			seqs.read(idx, &copy, &records[idx], sizeof(Record));
+			for (U32 i = 1; i < 8; ++i)
+			{
+				if (copy.mValues[i] != copy.mValues[0])
+				{
+					++torn;
+					break;
+				}
+			}
+			++reads;
+		}
+		writer.join();
+		ensure_equals("torn reads", torn, 0U);
+
+		Record copy;
+		seqs.read(NUM_WRITES % NUM_RECORDS, &copy, &records[NUM_WRITES % NUM_RECORDS], sizeof(Record));
+		ensure_equals("last write", copy.mValues[7], NUM_WRITES);
+	}
+}
@@ -0,0 +1,234 @@
+/**
+ * @file llvocachefile_test.cpp
+ * @brief Tests for the object cache file format.
+ *
+ * $LicenseInfo:firstyear=2001&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+// Precompiled header
+#include "../llviewerprecompiledheaders.h"
+
+#include "../test/lltut.h"
+
+#include "../llvocachefile.h"
+
+#include "llfile.h"
+
+#include <set>
+
+namespace
+{
+	const S32 NUM_RECORDS = 50;
+
+	// A record laid out as LLVOCacheEntry::writeToBuffer() does it
+	void append_record(std::vector<U8>& records, std::vector<LLVOCacheFile::IndexEntry>& index, U32 local_id, S32 data_size)
+	{
+		LLVOCacheFile::IndexEntry index_entry;
+		index_entry.mLocalID = local_id;
+		index_entry.mOffset = (U32)records.size();
+		index.push_back(index_entry);
+
+		U32 header[6] = { local_id, local_id * 7, 1, 2, 3, (U32)data_size };
+		const U8* header_bytes = (const U8*)header;
+		records.insert(records.end(), header_bytes, header_bytes + sizeof(header));
+		for (S32 i = 0; i < data_size; ++i)
+		{
+			records.push_back((U8)(local_id + i));
+		}
+	}
+
+	// Records for local ids 1000, 997, ..., written out of order
+	void make_records(std::vector<U8>& records, std::vector<LLVOCacheFile::IndexEntry>& index)
+	{
+		for (S32 i = 0; i < NUM_RECORDS; ++i)
+		{
+			append_record(records, index, 1000 - 3 * i, 1 + (i * 37) % 200);
+		}
+	}
+
+	std::vector<U8> record_bytes(const std::vector<U8>& records, const std::vector<LLVOCacheFile::IndexEntry>& index, U32 local_id)
+	{
+		for (const LLVOCacheFile::IndexEntry& entry : index)
+		{
+			if (entry.mLocalID == local_id)
+			{
+				U32 size = LLVOCacheFile::getRecordSize(&records[entry.mOffset], (U32)(records.size() - entry.mOffset));
+				return std::vector<U8>(records.begin() + entry.mOffset, records.begin() + entry.mOffset + size);
+			}
+		}
+		return std::vector<U8>();
+	}
+}
+
+namespace tut
+{
+	struct vocachefile
+	{
+		vocachefile()
+		:	mID(LLUUID::generateNewID()),
+			mFilename(std::string(LLFile::tmpdir()) + "llvocachefile_test_" + mID.asString() + ".slc")
+		{
+			make_records(mRecords, mIndex);
+			std::vector<LLVOCacheFile::IndexEntry> index(mIndex);
+			LLVOCacheFile::buildFile(mID, index, mRecords, mImage);
+		}
+
+		~vocachefile()
+		{
+			LLFile::remove(mFilename, ENOENT);
+			LLFile::remove(mFilename + ".tmp", ENOENT);
+		}
+
+		LLUUID mID;
+		std::string mFilename;
+		std::vector<U8> mRecords;
+		std::vector<LLVOCacheFile::IndexEntry> mIndex;
+		std::vector<U8> mImage;
+	};
+
+	typedef test_group<vocachefile> vocachefile_t;
+	typedef vocachefile_t::object vocachefile_object_t;
+	tut::vocachefile_t tut_vocachefile("LLVOCacheFile");
+
+	template<> template<>
+	void vocachefile_object_t::test<1>()
+	{
+		set_test_name("records written are read back byte for byte");
+
+		ensure("write", LLVOCacheFile::writeFile(mFilename, mImage));
+		ensure("no temp file left", !LLFile::isfile(mFilename + ".tmp"));
+
+		LLPointer<LLVOCacheFile> file = new LLVOCacheFile();
+		ensure("open", file->open(mFilename, mID));
+		ensure_equals("entries", file->getNumEntries(), NUM_RECORDS);
+
+		for (const LLVOCacheFile::IndexEntry& entry : mIndex)
+		{
+			const U8* data;
+			U32 size;
+			ensure(llformat("take %u", entry.mLocalID), file->takeRecord(entry.mLocalID, data, size));
+			std::vector<U8> expected = record_bytes(mRecords, mIndex, entry.mLocalID);
+			ensure_equals("size", size, (U32)expected.size());
+			ensure(llformat("bytes of %u", entry.mLocalID), !memcmp(data, &expected[0], size));
+			ensure("handed out once", !file->takeRecord(entry.mLocalID, data, size));
+		}
+
+		const U8* data;
+		U32 size;
+		ensure("missing id", !file->takeRecord(999, data, size));
+		ensure("before the first id", !file->takeRecord(0, data, size));
+		ensure("past the last id", !file->takeRecord(5000, data, size));
+	}
+
+	template<> template<>
+	void vocachefile_object_t::test<2>()
+	{
+		set_test_name("untaken records are carried over unchanged");
+
+		ensure("write", LLVOCacheFile::writeFile(mFilename, mImage));
+		LLPointer<LLVOCacheFile> file = new LLVOCacheFile();
+		ensure("open", file->open(mFilename, mID));
+
+		// Take every other record, as a region that only saw half its objects would
+		std::set<U32> taken;
+		for (size_t i = 0; i < mIndex.size(); i += 2)
+		{
+			const U8* data;
+			U32 size;
+			ensure("take", file->takeRecord(mIndex[i].mLocalID, data, size));
+			taken.insert(mIndex[i].mLocalID);
+		}
+
+		std::vector<U8> records;
+		std::vector<LLVOCacheFile::IndexEntry> index;
+		file->copyUntakenRecords(records, index);
+		ensure_equals("copied", index.size(), mIndex.size() - taken.size());
+		for (const LLVOCacheFile::IndexEntry& entry : index)
+		{
+			ensure("not taken", !taken.count(entry.mLocalID));
+			std::vector<U8> copied = record_bytes(records, index, entry.mLocalID);
+			std::vector<U8> expected = record_bytes(mRecords, mIndex, entry.mLocalID);
+			ensure(llformat("bytes of %u", entry.mLocalID), !expected.empty() && copied == expected);
+		}
+
+		// The copies make a file of their own, replacing the old one once it is unmapped
+		std::vector<U8> image;
+		LLVOCacheFile::buildFile(mID, index, records, image);
+		file = nullptr;
+		ensure("rewrite", LLVOCacheFile::writeFile(mFilename, image));
+
+		LLPointer<LLVOCacheFile> rewritten = new LLVOCacheFile();
+		ensure("reopen", rewritten->open(mFilename, mID));
+		ensure_equals("entries", rewritten->getNumEntries(), (S32)index.size());
+		for (const LLVOCacheFile::IndexEntry& entry : mIndex)
+		{
+			const U8* data;
+			U32 size;
+			ensure(llformat("only untaken %u", entry.mLocalID),
+				   rewritten->takeRecord(entry.mLocalID, data, size) == !taken.count(entry.mLocalID));
+		}
+	}
+
+	template<> template<>
+	void vocachefile_object_t::test<3>()
+	{
+		set_test_name("damaged files and records are refused");
+
+		LLPointer<LLVOCacheFile> file = new LLVOCacheFile();
+		ensure("missing file", !file->open(mFilename, mID));
+
+		ensure("write", LLVOCacheFile::writeFile(mFilename, mImage));
+		file = new LLVOCacheFile();
+		ensure("other region", !file->open(mFilename, LLUUID::generateNewID()));
+
+		std::vector<U8> image(mImage);
+		S32 num_entries = 1 << 20;
+		memcpy(&image[UUID_BYTES], &num_entries, sizeof(S32));
+		ensure("write", LLVOCacheFile::writeFile(mFilename, image));
+		file = new LLVOCacheFile();
+		ensure("index past the end", !file->open(mFilename, mID));
+
+		std::vector<U8> truncated(mImage.begin(), mImage.begin() + UUID_BYTES);
+		ensure("write", LLVOCacheFile::writeFile(mFilename, truncated));
+		file = new LLVOCacheFile();
+		ensure("no header", !file->open(mFilename, mID));
+
+		// Give the first record in the file a bogus size
+		image = mImage;
+		LLVOCacheFile::IndexEntry first;
+		memcpy(&first, &image[UUID_BYTES + sizeof(S32)], sizeof(first));
+		S32 bogus_size = LLVOCacheFile::MAX_RECORD_DATA_SIZE + 1;
+		memcpy(&image[first.mOffset + LLVOCacheFile::RECORD_HEADER_SIZE - sizeof(S32)], &bogus_size, sizeof(S32));
+		ensure("write", LLVOCacheFile::writeFile(mFilename, image));
+		file = new LLVOCacheFile();
+		ensure("open", file->open(mFilename, mID));
+
+		const U8* data;
+		U32 size;
+		ensure("bogus record", !file->takeRecord(first.mLocalID, data, size));
+		std::vector<U8> records;
+		std::vector<LLVOCacheFile::IndexEntry> index;
+		file->copyUntakenRecords(records, index);
+		ensure_equals("bogus record dropped", index.size(), mIndex.size() - 1);
+
+		ensure("record too short", !LLVOCacheFile::getRecordSize(&mRecords[0], LLVOCacheFile::RECORD_HEADER_SIZE));
+	}
+}
@@ -0,0 +1,288 @@
+/**
+ * @file llmessagedecoders_tut.cpp
+ * @brief Tests that the generated message decoders match the template reader.
+ *
+ * $LicenseInfo:firstyear=2007&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+
+#include <fstream>
+#include <sstream>
+
+#include "llapr.h"
+#include "llmessagedecoders.h"
+#include "llmessagetemplate.h"
+#include "llmessagetemplateparser.h"
+#include "lltemplatemessagebuilder.h"
+#include "lltemplatemessagereader.h"
+#include "message.h"
+#include "message_prehash.h"
+
+namespace tut
+{
+	static LLTemplateMessageBuilder::message_template_name_map_t nameMap;
+	static LLTemplateMessageReader::message_template_number_map_t numberMap;
+
+	struct LLMessageDecodersTestData
+	{
+		LLMessageDecodersTestData()
+		{
+			static bool init = false;
+			if (!init)
+			{
+				ll_init_apr();
+				start_messaging_system("notafile", 13036,
+									   1,
+									   0,
+									   0,
+									   FALSE,
+									   "notasharedsecret",
+									   NULL,
+									   false,
+									   5.f,
+									   100.f);
+
+				// The decoders are generated from the real template, so
+				// test against that
+				std::ifstream file(LL_MESSAGE_TEMPLATE_FILE);
+				std::stringstream contents;
+				contents << file.rdbuf();
+				LLTemplateTokenizer tokens(contents.str());
+				LLTemplateParser parser(tokens);
+				for (LLTemplateParser::message_iterator iter = parser.getMessagesBegin();
+					 iter != parser.getMessagesEnd();
+					 ++iter)
+				{
+					nameMap[(*iter)->mName] = *iter;
+					numberMap[(*iter)->mMessageNumber] = *iter;
+				}
+				init = true;
+			}
+			mBuilder = new LLTemplateMessageBuilder(nameMap);
+			mReader = new LLTemplateMessageReader(numberMap);
+		}
+
+		~LLMessageDecodersTestData()
+		{
+			delete mBuilder;
+			delete mReader;
+		}
+
+		// Builds the message into mBuffer, reads it with mReader, and
+		// returns its body for the decoder.  'trim' drops bytes off the end.
+		void read(const U8*& body, S32& size, S32 trim = 0)
+		{
+			memset(mBuffer, 0, LL_PACKET_ID_SIZE);
+			S32 built_size = mBuilder->buildMessage(mBuffer, MAX_BUFFER_SIZE, 0) - trim;
+			ensure("valid", mReader->validateMessage(mBuffer, built_size, LLHost()));
+			ensure("decoded", mReader->decodeData(mBuffer, LLHost(), TRUE));
+			ensure("body", mReader->getMessageBody(body, size));
+		}
+
+		LLTemplateMessageBuilder* mBuilder;
+		LLTemplateMessageReader* mReader;
+		U8 mBuffer[MAX_BUFFER_SIZE];
+	};
+
+	typedef test_group<LLMessageDecodersTestData> LLMessageDecodersTestGroup;
+	typedef LLMessageDecodersTestGroup::object LLMessageDecodersTestObject;
+	LLMessageDecodersTestGroup messageDecodersTestGroup("LLMessageDecoders");
+
+	template<> template<>
+	void LLMessageDecodersTestObject::test<1>()
+		// Single blocks of fixed size fields
+	{
+		LLQuaternion body_rot(0.1f, 0.2f, 0.3f, 0.927f);
+		body_rot.normalize();
+		mBuilder->newMessage(_PREHASH_AgentUpdate);
+		mBuilder->nextBlock(_PREHASH_AgentData);
+		mBuilder->addUUID(_PREHASH_AgentID, LLUUID("6a1de3a1-6c9d-4a5b-8ad3-0a43c5b0d4b1"));
+		mBuilder->addUUID(_PREHASH_SessionID, LLUUID("0e4a5f9c-8d31-4c7e-9a4e-8f2c2d1b6c70"));
+		mBuilder->addQuat(_PREHASH_BodyRotation, body_rot);
+		mBuilder->addQuat(_PREHASH_HeadRotation, LLQuaternion::DEFAULT);
+		mBuilder->addU8(_PREHASH_State, 3);
+		mBuilder->addVector3(_PREHASH_CameraCenter, LLVector3(128.f, 64.5f, 22.25f));
+		mBuilder->addVector3(_PREHASH_CameraAtAxis, LLVector3::x_axis);
+		mBuilder->addVector3(_PREHASH_CameraLeftAxis, LLVector3::y_axis);
+		mBuilder->addVector3(_PREHASH_CameraUpAxis, LLVector3::z_axis);
+		mBuilder->addF32(_PREHASH_Far, 256.f);
+		mBuilder->addU32(_PREHASH_ControlFlags, 0x80000401);
+		mBuilder->addU8(_PREHASH_Flags, 1);
+
+		const U8* body;
+		S32 size;
+		read(body, size);
+		LLDecodedAgentUpdate decoded;
+		ensure("parsed", decoded.parse(body, size));
+
+		LLUUID id;
+		mReader->getUUID(_PREHASH_AgentData, _PREHASH_AgentID, id);
+		ensure_equals("AgentID", decoded.mAgentData.mAgentID, id);
+		mReader->getUUID(_PREHASH_AgentData, _PREHASH_SessionID, id);
+		ensure_equals("SessionID", decoded.mAgentData.mSessionID, id);
+		LLQuaternion rot;
+		mReader->getQuat(_PREHASH_AgentData, _PREHASH_BodyRotation, rot);
+		ensure("BodyRotation", decoded.mAgentData.mBodyRotation == rot);
+		mReader->getQuat(_PREHASH_AgentData, _PREHASH_HeadRotation, rot);
+		ensure("HeadRotation", decoded.mAgentData.mHeadRotation == rot);
+		U8 u8;
+		mReader->getU8(_PREHASH_AgentData, _PREHASH_State, u8);
+		ensure_equals("State", decoded.mAgentData.mState, u8);
+		LLVector3 vec;
+		mReader->getVector3(_PREHASH_AgentData, _PREHASH_CameraCenter, vec);
+		ensure_equals("CameraCenter", decoded.mAgentData.mCameraCenter, vec);
+		mReader->getVector3(_PREHASH_AgentData, _PREHASH_CameraUpAxis, vec);
+		ensure_equals("CameraUpAxis", decoded.mAgentData.mCameraUpAxis, vec);
+		F32 far_clip;
+		mReader->getF32(_PREHASH_AgentData, _PREHASH_Far, far_clip);
+		ensure_equals("Far", decoded.mAgentData.mFar, far_clip);
+		U32 u32;
+		mReader->getU32(_PREHASH_AgentData, _PREHASH_ControlFlags, u32);
+		ensure_equals("ControlFlags", decoded.mAgentData.mControlFlags, u32);
+		mReader->getU8(_PREHASH_AgentData, _PREHASH_Flags, u8);
+		ensure_equals("Flags", decoded.mAgentData.mFlags, u8);
+	}
+
+	template<> template<>
+	void LLMessageDecodersTestObject::test<2>()
+		// Variable blocks, including an empty one
+	{
+		mBuilder->newMessage(_PREHASH_CoarseLocationUpdate);
+		for (U8 i = 0; i < 3; ++i)
+		{
+			mBuilder->nextBlock(_PREHASH_Location);
+			mBuilder->addU8(_PREHASH_X, 10 + i);
+			mBuilder->addU8(_PREHASH_Y, 20 + i);
+			mBuilder->addU8(_PREHASH_Z, 30 + i);
+		}
+		mBuilder->nextBlock(_PREHASH_Index);
+		mBuilder->addS16(_PREHASH_You, 1);
+		mBuilder->addS16(_PREHASH_Prey, -1);
+
+		const U8* body;
+		S32 size;
+		read(body, size);
+		LLDecodedCoarseLocationUpdate decoded;
+		ensure("parsed", decoded.parse(body, size));
+
+		ensure_equals("Location blocks", decoded.mNumLocation,
+					  mReader->getNumberOfBlocks(_PREHASH_Location));
+		for (S32 i = 0; i < decoded.mNumLocation; ++i)
+		{
+			U8 x, y, z;
+			mReader->getU8(_PREHASH_Location, _PREHASH_X, x, i);
+			mReader->getU8(_PREHASH_Location, _PREHASH_Y, y, i);
+			mReader->getU8(_PREHASH_Location, _PREHASH_Z, z, i);
+			ensure_equals("X", decoded.mLocation[i].mX, x);
+			ensure_equals("Y", decoded.mLocation[i].mY, y);
+			ensure_equals("Z", decoded.mLocation[i].mZ, z);
+		}
+		S16 you, prey;
+		mReader->getS16(_PREHASH_Index, _PREHASH_You, you);
+		mReader->getS16(_PREHASH_Index, _PREHASH_Prey, prey);
+		ensure_equals("You", decoded.mIndex.mYou, you);
+		ensure_equals("Prey", decoded.mIndex.mPrey, prey);
+		ensure_equals("AgentData blocks", decoded.mNumAgentData,
+					  mReader->getNumberOfBlocks(_PREHASH_AgentData));
+	}
+
+	template<> template<>
+	void LLMessageDecodersTestObject::test<3>()
+		// Variable length fields point into the body
+	{
+		U8 data[300];
+		for (S32 i = 0; i < 300; ++i)
+		{
+			data[i] = (U8)(i * 7);
+		}
+		mBuilder->newMessage(_PREHASH_ImprovedTerseObjectUpdate);
+		mBuilder->nextBlock(_PREHASH_RegionData);
+		mBuilder->addU64(_PREHASH_RegionHandle, (U64)0x0003e80000041000ULL);
+		mBuilder->addU16(_PREHASH_TimeDilation, 65000);
+		mBuilder->nextBlock(_PREHASH_ObjectData);
+		mBuilder->addBinaryData(_PREHASH_Data, data, 60);
+		mBuilder->addBinaryData(_PREHASH_TextureEntry, data, 300);
+		mBuilder->nextBlock(_PREHASH_ObjectData);
+		mBuilder->addBinaryData(_PREHASH_Data, data + 1, 44);
+		mBuilder->addBinaryData(_PREHASH_TextureEntry, data, 0);
+
+		const U8* body;
+		S32 size;
+		read(body, size);
+		LLDecodedImprovedTerseObjectUpdate decoded;
+		ensure("parsed", decoded.parse(body, size));
+
+		U64 handle;
+		mReader->getU64(_PREHASH_RegionData, _PREHASH_RegionHandle, handle);
+		ensure("RegionHandle", decoded.mRegionData.mRegionHandle == handle);
+		U16 dilation;
+		mReader->getU16(_PREHASH_RegionData, _PREHASH_TimeDilation, dilation);
+		ensure_equals("TimeDilation", decoded.mRegionData.mTimeDilation, dilation);
+		ensure_equals("ObjectData blocks", decoded.mNumObjectData, 2);
+		for (S32 i = 0; i < decoded.mNumObjectData; ++i)
+		{
+			const LLDecodedImprovedTerseObjectUpdate::ObjectDataBlock& block = decoded.mObjectData[i];
+			ensure_equals("Data size", block.mDataSize,
+						  mReader->getSize(_PREHASH_ObjectData, i, _PREHASH_Data));
+			ensure_equals("TextureEntry size", block.mTextureEntrySize,
+						  mReader->getSize(_PREHASH_ObjectData, i, _PREHASH_TextureEntry));
+			U8 expected[300];
+			mReader->getBinaryData(_PREHASH_ObjectData, _PREHASH_Data, expected, block.mDataSize, i);
+			ensure("Data", !memcmp(block.mData, expected, block.mDataSize));
+			ensure("Data points into the body", block.mData >= body && block.mData < body + size);
+			if (block.mTextureEntrySize)
+			{
+				mReader->getBinaryData(_PREHASH_ObjectData, _PREHASH_TextureEntry, expected, block.mTextureEntrySize, i);
+				ensure("TextureEntry", !memcmp(block.mTextureEntry, expected, block.mTextureEntrySize));
+			}
+		}
+	}
+
+	template<> template<>
+	void LLMessageDecodersTestObject::test<4>()
+		// A truncated message reads as zeros past the end, and says so
+	{
+		mBuilder->newMessage(_PREHASH_CoarseLocationUpdate);
+		mBuilder->nextBlock(_PREHASH_Location);
+		mBuilder->addU8(_PREHASH_X, 1);
+		mBuilder->addU8(_PREHASH_Y, 2);
+		mBuilder->addU8(_PREHASH_Z, 3);
+		mBuilder->nextBlock(_PREHASH_Index);
+		mBuilder->addS16(_PREHASH_You, 0x1234);
+		mBuilder->addS16(_PREHASH_Prey, 0x5678);
+
+		// Drops Prey and the AgentData count
+		const U8* body;
+		S32 size;
+		read(body, size, 3);
+		LLDecodedCoarseLocationUpdate decoded;
+		ensure("incomplete", !decoded.parse(body, size));
+		ensure_equals("Location blocks", decoded.mNumLocation, 1);
+		ensure_equals("X", decoded.mLocation[0].mX, 1);
+		ensure_equals("You", decoded.mIndex.mYou, 0x1234);
+		ensure_equals("Prey", decoded.mIndex.mPrey, 0);
+		ensure_equals("AgentData blocks", decoded.mNumAgentData, 0);
+	}
+}
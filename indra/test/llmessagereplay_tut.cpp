@@ -0,0 +1,263 @@
+/**
+ * @file llmessagereplay_tut.cpp
+ * @brief Tests for packet capture files and replaying them through the
+ * message system.
+ *
+ * $LicenseInfo:firstyear=2007&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltut.h"
+
+#include <sstream>
+
+#include "llapr.h"
+#include "llfile.h"
+#include "llmessagereplay.h"
+#include "llpacketcapture.h"
+#include "lltemplatemessagebuilder.h"
+#include "lluuid.h"
+#include "message.h"
+#include "message_prehash.h"
+
+namespace
+{
+	S32 sTestMessagesHandled = 0;
+
+	void handle_test_message(LLMessageSystem* msg, void**)
+	{
+		++sTestMessagesHandled;
+	}
+}
+
+namespace tut
+{
+	struct LLMessageReplayTestData
+	{
+		LLMessageReplayTestData()
+		:	mSender("127.0.0.1:13000")
+		{
+			static bool init = false;
+			if (!init)
+			{
+				ll_init_apr();
+				init = true;
+			}
+
+			// Replay needs the real templates to decode anything
+			start_messaging_system(LL_MESSAGE_TEMPLATE_FILE, 13037,
+								   1,
+								   0,
+								   0,
+								   FALSE,
+								   "notasharedsecret",
+								   NULL,
+								   false,
+								   5.f,
+								   100.f);
+			gMessageSystem->setHandlerFuncFast(_PREHASH_TestMessage, handle_test_message);
+			sTestMessagesHandled = 0;
+
+			std::ostringstream ostr;
+			LLUUID random;
+			random.generate();
+			ostr << LLFile::tmpdir() << "message-replay-test-" << random << ".pcap";
+			mFilename = ostr.str();
+		}
+
+		~LLMessageReplayTestData()
+		{
+			LLFile::remove(mFilename);
+
+			// not end_messaging_system()
+			delete static_cast<LLMessageSystem*>(gMessageSystem);
+			gMessageSystem = NULL;
+		}
+
+		// A TestMessage as it would come off the wire
+		S32 buildPacket(U8* buffer, U32 packet_id, U32 value)
+		{
+			LLTemplateMessageBuilder builder(gMessageSystem->mMessageTemplates);
+			builder.newMessage(_PREHASH_TestMessage);
+			builder.nextBlock(_PREHASH_TestBlock1);
+			builder.addU32(_PREHASH_Test1, value);
+			for (S32 i = 0; i < 4; ++i)
+			{
+				builder.nextBlock(_PREHASH_NeighborBlock);
+				builder.addU32(_PREHASH_Test0, value + i);
+				builder.addU32(_PREHASH_Test1, value + i);
+				builder.addU32(_PREHASH_Test2, value + i);
+			}
+			memset(buffer, 0, LL_PACKET_ID_SIZE);
+			S32 size = builder.buildMessage(buffer, MAX_BUFFER_SIZE, 0);
+			U32 net_packet_id = htonl(packet_id);
+			memcpy(buffer + PHL_PACKET_ID, &net_packet_id, sizeof(net_packet_id));
+			return size;
+		}
+
+		LLSD buildEvent(U32 value)
+		{
+			LLSD block;
+			block["Test1"] = (S32)value;
+			LLSD message;
+			message["sender"] = mSender.getIPandPort();
+			message["body"]["TestBlock1"].append(block);
+			return message;
+		}
+
+		const LLHost mSender;
+		std::string mFilename;
+	};
+
+	typedef test_group<LLMessageReplayTestData> LLMessageReplayTestGroup;
+	typedef LLMessageReplayTestGroup::object LLMessageReplayTestObject;
+	LLMessageReplayTestGroup messageReplayTestGroup("LLMessageReplay");
+
+	template<> template<>
+	void LLMessageReplayTestObject::test<1>()
+		// Records read back as written
+	{
+		U8 packet[MAX_BUFFER_SIZE];
+		S32 size = buildPacket(packet, 1, 42);
+		{
+			LLPacketCaptureWriter writer;
+			ensure("opened", writer.open(mFilename, 2.5f));
+			writer.writePacket(mSender, packet, size);
+			writer.writeEvent("TestMessage", buildEvent(43));
+			writer.writePacket(mSender, packet, size);
+			ensure_equals("written", writer.getRecordCount(), 3U);
+		}
+
+		LLPacketCapture::record_list_t records;
+		F32 template_version = 0.f;
+		ensure("loaded", LLPacketCapture::load(mFilename, records, &template_version));
+		ensure_equals("template version", template_version, 2.5f);
+		ensure_equals("records", records.size(), (size_t)3);
+
+		ensure_equals("packet type", records[0].mType, LLPacketCapture::PACKET);
+		ensure_equals("packet sender", records[0].mSender, mSender);
+		ensure_equals("packet size", records[0].mData.size(), (size_t)size);
+		ensure("packet data", !memcmp(&records[0].mData[0], packet, size));
+
+		ensure_equals("event type", records[1].mType, LLPacketCapture::EVENT);
+		ensure_equals("event name", records[1].mName, std::string("TestMessage"));
+		ensure_equals("event body", records[1].mMessage["body"]["TestBlock1"][0]["Test1"].asInteger(), 43);
+		ensure("in order", records[0].mTime <= records[1].mTime && records[1].mTime <= records[2].mTime);
+	}
+
+	template<> template<>
+	void LLMessageReplayTestObject::test<2>()
+		// A record cut off at the end is dropped, the rest still load
+	{
+		U8 packet[MAX_BUFFER_SIZE];
+		S32 size = buildPacket(packet, 1, 42);
+		{
+			LLPacketCaptureWriter writer;
+			writer.open(mFilename, 2.5f);
+			writer.writePacket(mSender, packet, size);
+			writer.writePacket(mSender, packet, size);
+		}
+
+		llstat stat_data;
+		ensure_equals("stat", LLFile::stat(mFilename, &stat_data), 0);
+		std::vector<char> data(stat_data.st_size);
+		{
+			llifstream in(mFilename.c_str(), std::ios::in | std::ios::binary);
+			in.read(&data[0], data.size());
+		}
+		{
+			llofstream out(mFilename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+			out.write(&data[0], data.size() - 3);
+		}
+
+		LLPacketCapture::record_list_t records;
+		ensure("loaded", LLPacketCapture::load(mFilename, records));
+		ensure_equals("records", records.size(), (size_t)1);
+
+		ensure("missing file", !LLPacketCapture::load(mFilename + ".missing", records));
+	}
+
+	template<> template<>
+	void LLMessageReplayTestObject::test<3>()
+		// Replay runs the handlers for packets and events, every pass
+	{
+		const S32 NUM_PACKETS = 10;
+		{
+			LLPacketCaptureWriter writer;
+			writer.open(mFilename, gMessageSystem->mMessageFileVersionNumber);
+			U8 packet[MAX_BUFFER_SIZE];
+			for (S32 i = 0; i < NUM_PACKETS; ++i)
+			{
+				S32 size = buildPacket(packet, i + 1, i);
+				writer.writePacket(mSender, packet, size);
+				if (i == NUM_PACKETS / 2)
+				{
+					writer.writeEvent("TestMessage", buildEvent(i));
+				}
+			}
+		}
+
+		LLMessageReplay replay(gMessageSystem);
+		ensure("loaded", replay.load(mFilename));
+		ensure_equals("records", replay.getNumRecords(), NUM_PACKETS + 1);
+
+		const S32 PASSES = 2;
+		replay.run(PASSES, 4);
+		ensure_equals("packets", replay.getPacketsReplayed(), (U32)(NUM_PACKETS * PASSES));
+		ensure_equals("events", replay.getEventsReplayed(), (U32)PASSES);
+		ensure_equals("messages", replay.getMessagesHandled(), (U32)(NUM_PACKETS * PASSES));
+		ensure_equals("handled", sTestMessagesHandled, (NUM_PACKETS + 1) * PASSES);
+
+		const LLMessageReplay::stats_list_t& stats = replay.getHandlerStats();
+		S32 message_count = 0;
+		S32 event_count = 0;
+		for (LLMessageReplay::stats_list_t::const_iterator iter = stats.begin(); iter != stats.end(); ++iter)
+		{
+			ensure_equals("name", iter->mName, std::string("TestMessage"));
+			(iter->mIsEvent ? event_count : message_count) += iter->mCount;
+		}
+		ensure_equals("timed messages", message_count, NUM_PACKETS * PASSES);
+		ensure_equals("timed events", event_count, PASSES);
+
+		ensure("stopped replaying", !gMessageSystem->mPacketRing.isReplaying());
+		ensure("circuits removed", !gMessageSystem->mCircuitInfo.findCircuit(mSender));
+	}
+
+	template<> template<>
+	void LLMessageReplayTestObject::test<4>()
+		// The message system captures what it dispatches from the event queue
+	{
+		ensure("started", gMessageSystem->startPacketCapture(mFilename));
+		ensure("capturing", gMessageSystem->isCapturingPackets());
+		LLMessageSystem::dispatch("TestMessage", buildEvent(7));
+		gMessageSystem->stopPacketCapture();
+		ensure("stopped", !gMessageSystem->isCapturingPackets());
+		ensure_equals("handled", sTestMessagesHandled, 1);
+
+		LLPacketCapture::record_list_t records;
+		ensure("loaded", LLPacketCapture::load(mFilename, records));
+		ensure_equals("records", records.size(), (size_t)1);
+		ensure_equals("event name", records[0].mName, std::string("TestMessage"));
+		ensure_equals("event body", records[0].mMessage["body"]["TestBlock1"][0]["Test1"].asInteger(), 7);
+	}
+}
@@ -0,0 +1,312 @@
+#!/usr/bin/env python
+"""\
+@file generate_message_decoders.py
+@brief Generates flat C++ decoders for hot template messages.
+
+$LicenseInfo:firstyear=2026&license=viewerlgpl$
+Second Life Viewer Source Code
+Copyright (C) 2026, Linden Research, Inc.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation;
+version 2.1 of the License only.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+$/LicenseInfo$
+"""
+
+"""generate_message_decoders reads message_template.msg and writes a
+header and source file with one LLDecoded<Message> struct per message
+named on the command line.  Each has a plain member per template
+variable and a parse() that fills them in template order straight from
+the packet, with none of LLTemplateMessageReader's per-field lookups
+or allocations.  The llmessage build runs it whenever the template or
+this script changes.
+"""
+
+import sys
+import os.path
+
+# Look for indra/lib/python in all possible parent directories, as
+# template_verifier.py does
+def add_indra_lib_path():
+    root = os.path.realpath(__file__)
+    while root != os.path.sep:
+        root = os.path.dirname(root)
+        dir = os.path.join(root, 'indra', 'lib', 'python')
+        if os.path.isdir(dir):
+            if dir not in sys.path:
+                sys.path.insert(0, dir)
+            break
+    else:
+        sys.stderr.write("This script is not inside a valid installation.\n")
+        sys.exit(1)
+
+add_indra_lib_path()
+
+import optparse
+
+from indra.ipc import llmessage
+
+# Most repeats of a Variable block, its count is one byte
+MAX_VARIABLE_BLOCKS = 255
+
+# template type -> (C++ type, LLMessageDecodeStream reader)
+FIELD_TYPES = {
+    'U8': ('U8', 'readU8'),
+    'U16': ('U16', 'readU16'),
+    'U32': ('U32', 'readU32'),
+    'U64': ('U64', 'readU64'),
+    'S8': ('S8', 'readS8'),
+    'S16': ('S16', 'readS16'),
+    'S32': ('S32', 'readS32'),
+    'S64': ('S64', 'readS64'),
+    'F32': ('F32', 'readF32'),
+    'F64': ('F64', 'readF64'),
+    'LLVector3': ('LLVector3', 'readVector3'),
+    'LLVector3d': ('LLVector3d', 'readVector3d'),
+    'LLVector4': ('LLVector4', 'readVector4'),
+    'LLQuaternion': ('LLQuaternion', 'readQuat'),
+    'LLUUID': ('LLUUID', 'readUUID'),
+    'BOOL': ('BOOL', 'readBOOL'),
+    'IPADDR': ('U32', 'readIPAddr'),
+    'IPPORT': ('U16', 'readIPPort'),
+    }
+
+HEADER_PREAMBLE = """\
+/**
+ * @file llmessagedecoders.h
+ * @brief Flat decoders for hot template messages.
+ *
+ * Generated by scripts/messages/generate_message_decoders.py from
+ * message_template.msg.  Do not edit.
+ */
+
+#ifndef LL_LLMESSAGEDECODERS_H
+#define LL_LLMESSAGEDECODERS_H
+
+#include "llmath.h"
+#include "llquaternion.h"
+#include "lluuid.h"
+#include "v3dmath.h"
+#include "v3math.h"
+#include "v4math.h"
+
+class LLMessageSystem;
+
+// Each decoder has a member per template variable.  Variable length
+// fields point into the packet, so they're only valid while it is,
+// normally for the duration of the message handler.  Fixed length
+// fields are copied.  Variable blocks hold up to %(max)d repeats, which
+// makes some decoders large enough to keep around rather than put on
+// the stack.
+//
+// parse(body, size) fills in every member.  A field the body is too
+// short for reads as zeros, as it does through LLTemplateMessageReader,
+// and parse() returns false.
+//
+// parse(msg) parses the message msg is handling.  It returns false if
+// that didn't come in as a template message, or if the body is too short,
+// after raising MX_RAN_OFF_END_OF_PACKET as the template reader would.
+""" % { 'max': MAX_VARIABLE_BLOCKS }
+
+HEADER_END = """\
+#endif // LL_LLMESSAGEDECODERS_H
+"""
+
+SOURCE_PREAMBLE = """\
+/**
+ * @file llmessagedecoders.cpp
+ * @brief Flat decoders for hot template messages.
+ *
+ * Generated by scripts/messages/generate_message_decoders.py from
+ * message_template.msg.  Do not edit.
+ */
+
+#include "linden_common.h"
+
+#include "llmessagedecoders.h"
+
+#include "llmessagedecodestream.h"
+#include "message.h"
+"""
+
+def member(name):
+    return 'm' + name
+
+def block_type(block):
+    return block.name + 'Block'
+
+def declare_field(var):
+    if var.type == 'Variable':
+        return ['const U8* %s;' % member(var.name),
+                'S32 %sSize;' % member(var.name)]
+    if var.type == 'Fixed':
+        return ['U8 %s[%d];' % (member(var.name), int(var.size))]
+    return ['%s %s;' % (FIELD_TYPES[var.type][0], member(var.name))]
+
+def read_field(var, target):
+    field = '%s.%s' % (target, member(var.name))
+    if var.type == 'Variable':
+        return 'stream.readVariable(%s, %sSize, %d);' % (field, field, int(var.size))
+    if var.type == 'Fixed':
+        return 'stream.readFixed(%s, %d);' % (field, int(var.size))
+    return 'stream.%s(%s);' % (FIELD_TYPES[var.type][1], field)
+
+def check_names(message):
+    names = set()
+    for block in message.blocks:
+        for name in (member(block.name), member('Num' + block.name)):
+            if name in names:
+                raise ValueError("%s: %s is generated twice" % (message.name, name))
+            names.add(name)
+        fields = set()
+        for var in block.variables:
+            for line in declare_field(var):
+                name = line.split()[-1].split('[')[0].rstrip(';')
+                if name in fields:
+                    raise ValueError("%s.%s: %s is generated twice"
+                                     % (message.name, block.name, name))
+                fields.add(name)
+
+def write_header(out, messages):
+    out.write(HEADER_PREAMBLE)
+    for message in messages:
+        check_names(message)
+        struct = 'LLDecoded' + message.name
+        out.write('\n// %s %s %d %s %s\n'
+                  % (message.name, message.priority, message.number,
+                     message.trust, message.coding))
+        out.write('struct %s\n{\n' % struct)
+        for block in message.blocks:
+            out.write('\tstruct %s\n\t{\n' % block_type(block))
+            for var in block.variables:
+                for line in declare_field(var):
+                    out.write('\t\t%s\n' % line)
+            out.write('\t};\n\n')
+        for block in message.blocks:
+            if block.repeat == 'Single':
+                out.write('\t%s %s;\n' % (block_type(block), member(block.name)))
+            elif block.repeat == 'Multiple':
+                out.write('\t%s %s[%d];\n'
+                          % (block_type(block), member(block.name), int(block.count)))
+            else:
+                out.write('\t%s %s[%d];\n'
+                          % (block_type(block), member(block.name), MAX_VARIABLE_BLOCKS))
+                out.write('\tS32 %s;\n' % member('Num' + block.name))
+        out.write('\n\tbool parse(const U8* body, S32 size);\n')
+        out.write('\tbool parse(LLMessageSystem* msg);\n')
+        out.write('};\n')
+    out.write('\n')
+    out.write(HEADER_END)
+
+def write_source(out, messages):
+    out.write(SOURCE_PREAMBLE)
+    for message in messages:
+        struct = 'LLDecoded' + message.name
+        out.write('\nbool %s::parse(const U8* body, S32 size)\n{\n' % struct)
+        out.write('\tLLMessageDecodeStream stream(body, size);\n')
+        for block in message.blocks:
+            out.write('\n')
+            if block.repeat == 'Single':
+                target = member(block.name)
+                for var in block.variables:
+                    out.write('\t%s\n' % read_field(var, target))
+                continue
+            if block.repeat == 'Multiple':
+                count = '%d' % int(block.count)
+            else:
+                count = member('Num' + block.name)
+                out.write('\t%s = stream.readBlockCount();\n' % count)
+            out.write('\tfor (S32 i = 0; i < %s; ++i)\n\t{\n' % count)
+            out.write('\t\t%s& block = %s[i];\n' % (block_type(block), member(block.name)))
+            for var in block.variables:
+                out.write('\t\t%s\n' % read_field(var, 'block'))
+            out.write('\t}\n')
+        out.write('\n\treturn stream.isComplete();\n}\n')
+
+        out.write('\nbool %s::parse(LLMessageSystem* msg)\n{\n' % struct)
+        out.write('\tconst U8* body;\n\tS32 size;\n')
+        out.write('\tif (!msg->getMessageBody(body, size))\n\t{\n\t\treturn false;\n\t}\n')
+        out.write('\tif (!parse(body, size))\n\t{\n')
+        out.write('\t\tmsg->logRanOffEndOfPacket(msg->getSender());\n')
+        out.write('\t\treturn false;\n\t}\n')
+        out.write('\treturn true;\n}\n')
+
+def write_if_changed(path, text):
+    # Only rewrite the file if it changed, but touch it either way.  The
+    # build lists it as an output of the template and this script, and
+    # runs us again on every build while it's older than they are.
+    if os.path.exists(path):
+        f = open(path)
+        try:
+            same = f.read() == text
+        finally:
+            f.close()
+        if same:
+            os.utime(path, None)
+            return
+    f = open(path, 'w')
+    try:
+        f.write(text)
+    finally:
+        f.close()
+
+class StringWriter:
+    def __init__(self):
+        self.parts = []
+    def write(self, s):
+        self.parts.append(s)
+    def getvalue(self):
+        return ''.join(self.parts)
+
+def main():
+    parser = optparse.OptionParser(
+        usage="usage: %prog --template FILE --header FILE --source FILE MESSAGE...")
+    parser.add_option('--template', help="message_template.msg to read")
+    parser.add_option('--header', help="header to write")
+    parser.add_option('--source', help="source file to write")
+    options, names = parser.parse_args()
+    if not (options.template and options.header and options.source and names):
+        parser.error("template, header, source and at least one message are required")
+
+    f = open(options.template)
+    try:
+        template = llmessage.parseTemplateFile(f)
+    finally:
+        f.close()
+
+    messages = []
+    for name in names:
+        if name not in template.messages:
+            sys.stderr.write("%s is not in %s\n" % (name, options.template))
+            return 1
+        message = template.messages[name]
+        for block in message.blocks:
+            for var in block.variables:
+                if var.type not in FIELD_TYPES and var.type not in ('Fixed', 'Variable'):
+                    sys.stderr.write("%s.%s.%s has unknown type %s\n"
+                                     % (name, block.name, var.name, var.type))
+                    return 1
+        messages.append(message)
+
+    header = StringWriter()
+    write_header(header, messages)
+    source = StringWriter()
+    write_source(source, messages)
+    write_if_changed(options.header, header.getvalue())
+    write_if_changed(options.source, source.getvalue())
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main())